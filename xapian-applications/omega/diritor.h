@@ -57,6 +57,7 @@ class CommitAndExit {
     CommitAndExit(const char * msg_, const std::string & path, int errno_);
     CommitAndExit(const char * msg_, int errno_);
     CommitAndExit(const char * msg_, const char * error);
+    explicit CommitAndExit(const std::string & msg_) : msg(msg_) { }
 
     const std::string & what() const { return msg; }
 };
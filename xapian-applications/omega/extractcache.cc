@@ -0,0 +1,138 @@
+/** @file
+ * @brief Cache of text and metadata extracted from files
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "extractcache.h"
+
+#include <cerrno>
+#include <cstdlib>
+
+#include "md5wrap.h"
+#include "str.h"
+
+using namespace std;
+
+/** Commit the cache once this many bytes of entries are pending.
+ *
+ *  Extracted text can be large, so we don't want to buffer it all in memory
+ *  until the end of the run.
+ */
+#define EXTRACT_CACHE_COMMIT_SIZE (32 * 1024 * 1024)
+
+/// Prefix for the user metadata keys of cache entries.
+#define EXTRACT_CACHE_PREFIX "X"
+
+/// Append @a s to @a out as a decimal length, a ':', and then the bytes.
+static void
+append_field(string& out, const string& s)
+{
+    out += str(s.size());
+    out += ':';
+    out += s;
+}
+
+/// Decode a field encoded by append_field().
+static bool
+read_field(const char*& p, const char* end, string& s)
+{
+    char* q;
+    errno = 0;
+    unsigned long long len = strtoull(p, &q, 10);
+    if (q == p || q == end || *q != ':' || errno) return false;
+    p = q + 1;
+    if (len > size_t(end - p)) return false;
+    s.assign(p, len);
+    p += len;
+    return true;
+}
+
+string
+ExtractedText::serialise() const
+{
+    string result;
+    for (const string* s : { &dump, &title, &keywords, &topic, &sample,
+			     &author, &to, &cc, &bcc, &message_id }) {
+	append_field(result, *s);
+    }
+    append_field(result, str(created));
+    append_field(result, str(pages));
+    return result;
+}
+
+bool
+ExtractedText::unserialise(const string& s)
+{
+    const char* p = s.data();
+    const char* end = p + s.size();
+    for (string* field : { &dump, &title, &keywords, &topic, &sample,
+			   &author, &to, &cc, &bcc, &message_id }) {
+	if (!read_field(p, end, *field)) return false;
+    }
+    string v;
+    if (!read_field(p, end, v)) return false;
+    created = time_t(strtoll(v.c_str(), NULL, 10));
+    if (!read_field(p, end, v)) return false;
+    pages = int(strtol(v.c_str(), NULL, 10));
+    return p == end;
+}
+
+void
+ExtractCache::open(const string& path)
+{
+    db = Xapian::WritableDatabase(path, Xapian::DB_CREATE_OR_OPEN);
+    opened = true;
+}
+
+string
+ExtractCache::key(const string& file_md5, const string& how)
+{
+    // Keys for user metadata have a limited length and filter commands can be
+    // long, so use a checksum of how the text is extracted.
+    string how_md5;
+    md5_string(how, how_md5);
+    string k(EXTRACT_CACHE_PREFIX);
+    k += file_md5;
+    k += how_md5;
+    return k;
+}
+
+bool
+ExtractCache::get(const string& k, ExtractedText& result) const
+{
+    const string value = db.get_metadata(k);
+    // Ignore an entry we can't decode - it'll get replaced by a new entry.
+    return !value.empty() && result.unserialise(value);
+}
+
+void
+ExtractCache::put(const string& k, const string& serialised)
+{
+    db.set_metadata(k, serialised);
+    pending_size += k.size() + serialised.size();
+    if (pending_size >= EXTRACT_CACHE_COMMIT_SIZE) commit();
+}
+
+void
+ExtractCache::commit()
+{
+    if (opened) db.commit();
+    pending_size = 0;
+}
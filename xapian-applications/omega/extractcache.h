@@ -0,0 +1,95 @@
+/** @file
+ * @brief Cache of text and metadata extracted from files
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OMEGA_INCLUDED_EXTRACTCACHE_H
+#define OMEGA_INCLUDED_EXTRACTCACHE_H
+
+#include <ctime>
+#include <string>
+
+#include <xapian.h>
+
+/// The text and metadata extracted from a file.
+struct ExtractedText {
+    std::string dump, title, keywords, topic, sample, author;
+    std::string to, cc, bcc, message_id;
+    time_t created = time_t(-1);
+    int pages = -1;
+
+    /// Encode as a string.
+    std::string serialise() const;
+
+    /** Decode from a string.
+     *
+     *  @return false if @a s isn't a valid encoding.
+     */
+    bool unserialise(const std::string& s);
+};
+
+/** Maintain a cache of the text and metadata extracted from files.
+ *
+ *  Entries are keyed by a checksum of the contents of the file plus a
+ *  checksum of a description of how the text was extracted, so a file which
+ *  is modified without its contents changing, or which has identical copies
+ *  elsewhere, only needs to be passed through an external filter once.
+ *
+ *  The cache is stored in the user metadata of a separate database, so it can
+ *  be shared between several omindex databases (though not by runs of omindex
+ *  at the same time).
+ */
+class ExtractCache {
+    Xapian::WritableDatabase db;
+
+    /// Set by open().
+    bool opened = false;
+
+    /// Approximate size of the entries added since the last commit.
+    size_t pending_size = 0;
+
+  public:
+    /// Open (creating if necessary) the cache database at @a path.
+    void open(const std::string& path);
+
+    /// Return true if open() has been called.
+    bool is_open() const { return opened; }
+
+    /** Calculate the key for a file.
+     *
+     *  @param file_md5	The MD5 checksum of the file's contents.
+     *  @param how	Description of how the text is extracted (e.g. the
+     *			filter command, its output format and character set).
+     */
+    static std::string key(const std::string& file_md5,
+			   const std::string& how);
+
+    /** Look up an entry.
+     *
+     *  @return true if an entry was found.
+     */
+    bool get(const std::string& k, ExtractedText& result) const;
+
+    /// Add an entry.
+    void put(const std::string& k, const std::string& serialised);
+
+    /// Commit any pending changes.
+    void commit();
+};
+
+#endif // OMEGA_INCLUDED_EXTRACTCACHE_H
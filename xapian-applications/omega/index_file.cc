@@ -32,6 +32,7 @@
 #include <algorithm>
 #include <iostream>
 #include <limits>
+#include <sstream>
 #include <string>
 #include <map>
 #include <vector>
@@ -40,10 +41,14 @@
 #include "safeunistd.h"
 #include <cassert>
 #include <cerrno>
+#include <csignal>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include "safefcntl.h"
+#include "safesysselect.h"
+#include "safesyssocket.h"
+#include "safesyswait.h"
 #include <ctime>
 
 #include <xapian.h>
@@ -53,6 +58,7 @@
 #include "atomparser.h"
 #include "datetime.h"
 #include "diritor.h"
+#include "extractcache.h"
 #include "failed.h"
 #include "gnumericparser.h"
 #include "hashterm.h"
@@ -71,6 +77,7 @@
 #include "utf8convert.h"
 #include "values.h"
 #include "worker.h"
+#include "worker_comms.h"
 #include "xlsxparser.h"
 #include "xpsparser.h"
 
@@ -90,6 +97,7 @@ static dup_action_type dup_action;
 static bool ignore_exclusions;
 static bool description_as_sample;
 static bool date_terms;
+static bool index_spelling;
 
 static time_t last_altered_max;
 static size_t sample_size;
@@ -103,8 +111,63 @@ static string site_term, host_term;
 
 static Failed failed;
 
+static ExtractCache extract_cache;
+
 map<string, Filter> commands;
 
+#if defined HAVE_SOCKETPAIR && defined HAVE_FORK && defined HAVE_WAITPID
+# define PARALLEL_EXTRACTION
+#endif
+
+/// Maximum number of extractions to run at once.
+static unsigned max_jobs = 1;
+
+/// A document being extracted by a child process.
+struct Extraction {
+    /// PID of the child process.
+    pid_t child;
+
+    /// Socket to read the results from.
+    FILE* sockt;
+
+    string urlterm;
+
+    string context;
+
+    time_t last_altered;
+
+    Xapian::docid did;
+
+    off_t size;
+
+    time_t last_mod;
+
+    /// Message to show before any output from the child (if verbose).
+    string message;
+};
+
+/// Extractions currently running.
+static vector<Extraction> extractions;
+
+/// Set in a child process extracting a document.
+static bool in_extractor = false;
+
+/// A failure to be recorded by the parent process.
+struct ExtractorFailure {
+    string urlterm;
+    time_t last_mod;
+    off_t size;
+};
+
+/// Failures found by this child process.
+static vector<ExtractorFailure> extractor_failures;
+
+/// Filters this child process found aren't installed.
+static vector<string> extractor_disabled_filters;
+
+/// Entries to be added to the extraction cache by the parent process.
+static vector<pair<string, string>> extractor_cache_entries;
+
 static void
 mark_as_seen(Xapian::docid did)
 {
@@ -118,7 +181,12 @@ void
 skip(const string& urlterm, const string& context, const string& msg,
      off_t size, time_t last_mod, unsigned flags)
 {
-    failed.add(urlterm, last_mod, size);
+    if (in_extractor) {
+	// Our parent process will record the failure.
+	extractor_failures.push_back({urlterm, last_mod, size});
+    } else {
+	failed.add(urlterm, last_mod, size);
+    }
 
     if (!verbose || (flags & SKIP_SHOW_FILENAME)) {
 	if (!verbose && (flags & SKIP_VERBOSE_ONLY)) return;
@@ -419,7 +487,8 @@ index_init(const string& dbpath, const Xapian::Stem& stemmer,
 	   bool overwrite, bool retry_failed_,
 	   bool delete_removed_documents, bool verbose_, bool use_ctime_,
 	   bool spelling, bool ignore_exclusions_, bool description_as_sample_,
-	   bool date_terms_)
+	   bool date_terms_, unsigned jobs,
+	   const string& extract_cache_path)
 {
     root = root_;
     site_term = site_term_;
@@ -434,6 +503,12 @@ index_init(const string& dbpath, const Xapian::Stem& stemmer,
     ignore_exclusions = ignore_exclusions_;
     description_as_sample = description_as_sample_;
     date_terms = date_terms_;
+    index_spelling = spelling;
+#ifdef PARALLEL_EXTRACTION
+    max_jobs = max(jobs, 1u);
+#else
+    (void)jobs;
+#endif
 
     if (!overwrite) {
 	db = Xapian::WritableDatabase(dbpath, Xapian::DB_CREATE_OR_OPEN);
@@ -465,6 +540,10 @@ index_init(const string& dbpath, const Xapian::Stem& stemmer,
 
     failed.init(db);
 
+    if (!extract_cache_path.empty()) {
+	extract_cache.open(extract_cache_path);
+    }
+
     if (overwrite) {
 	// There are no failures to retry, so setting this flag doesn't
 	// change the outcome, but does mean we avoid the overhead of
@@ -716,60 +795,68 @@ index_add_document(const string& urlterm, time_t last_altered,
     }
 }
 
-void
-index_mimetype(const string& file, const string& urlterm, const string& url,
-	       const string& ext,
-	       string mimetype,
-	       DirectoryIterator& d,
-	       string pathterm,
-	       string record)
+/// Return true if @a filter runs a worker or an external command.
+static bool
+runs_filter(const Filter& filter)
 {
-    string context(file, root.size(), string::npos);
-
-    // FIXME: We could be cleverer here and check mtime too when use_ctime is
-    // set - if the ctime has changed but the mtime is unchanged, we can just
-    // update the existing Document and avoid having to re-extract text, etc.
-    time_t last_altered = use_ctime ? d.get_ctime() : d.get_mtime();
-
-    Xapian::docid did = 0;
-    if (index_check_existing(urlterm, last_altered, did))
-	return;
+    if (filter.worker) return true;
+    const string& cmd = filter.cmd;
+    return !cmd.empty() && cmd != "false" && cmd != "true";
+}
 
-    if (!retry_failed) {
-	// We only store and check the mtime (last modified) - a change to the
-	// metadata won't generally cause a previous failure to now work
-	// (FIXME: except permissions).
-	time_t failed_last_mod;
-	off_t failed_size;
-	if (failed.contains(urlterm, failed_last_mod, failed_size)) {
-	    if (d.get_mtime() <= failed_last_mod &&
-		d.get_size() == failed_size) {
-		if (verbose)
-		    cout << "failed to extract text on earlier run" << endl;
-		return;
-	    }
-	    // The file has changed, so remove the entry for it.  If it fails
-	    // again on this attempt, we'll add a new one.
-	    failed.del(urlterm);
-	}
+/** Describe how @a filter extracts text for the extraction cache key.
+ *
+ *  This needs to include anything which affects the text and metadata
+ *  extracted.
+ */
+static string
+extraction_method(const Filter& filter, const string& mimetype)
+{
+    string how = mimetype;
+    how += '\0';
+    if (filter.worker) {
+	how += 'W';
+	how += filter.worker->get_filter_module();
+    } else {
+	how += 'C';
+	how += filter.cmd;
+	how += '\0';
+	how += filter.output_type;
+	how += '\0';
+	how += filter.output_charset;
+	how += '\0';
+	how += description_as_sample ? 'D' : 'B';
     }
+    return how;
+}
 
-    // If we didn't get the mime type from the extension, call libmagic to get
-    // it.
-    if (mimetype.empty()) {
-	mimetype = d.get_magic_mimetype();
-	if (mimetype.empty()) {
-	    skip(urlterm, file.substr(root.size()),
-		 "Unknown extension and unrecognised format",
-		 d.get_size(), d.get_mtime(), SKIP_SHOW_FILENAME);
-	    return;
-	}
+/// Add an entry to the extraction cache.
+static void
+add_to_extract_cache(const string& key, const string& value)
+{
+    if (in_extractor) {
+	// Our parent process will add the entry.
+	extractor_cache_entries.emplace_back(key, value);
+    } else {
+	extract_cache.put(key, value);
     }
+}
 
-    if (verbose)
-	cout << "Indexing \"" << file.substr(root.size()) << "\" as "
-	     << mimetype << " ... " << flush;
-
+/** Extract the text and metadata from a file and index it.
+ *
+ *  @param result	If non-NULL, the document is stored here instead of being
+ *			added to the database.
+ *
+ *  @return true if the document was indexed, false if the file was skipped.
+ */
+static bool
+index_document(const string& file, const string& urlterm, const string& url,
+	       const string& ext, const string& mimetype,
+	       map<string, Filter>::const_iterator cmd_it,
+	       DirectoryIterator& d, string pathterm, string record,
+	       const string& context, time_t last_altered, Xapian::docid did,
+	       Xapian::Document* result)
+{
     // Use `file` as the basis, as we don't want URL encoding in these terms,
     // but need to switch over the initial part so we get `/~olly/foo/bar` not
     // `/home/olly/public_html/foo/bar`.
@@ -791,23 +878,37 @@ index_mimetype(const string& file, const string& urlterm, const string& url,
     time_t created = time_t(-1);
     int pages = -1;
 
-    map<string, Filter>::const_iterator cmd_it = commands.find(mimetype);
-    if (cmd_it == commands.end()) {
-	size_t slash = mimetype.find('/');
-	if (slash != string::npos) {
-	    string wildtype(mimetype, 0, slash + 2);
-	    wildtype[slash + 1] = '*';
-	    cmd_it = commands.find(wildtype);
-	    if (cmd_it == commands.end()) {
-		cmd_it = commands.find("*/*");
-	    }
-	}
-	if (cmd_it == commands.end()) {
-	    cmd_it = commands.find("*");
-	}
-    }
     try {
-	if (cmd_it != commands.end() && cmd_it->second.worker) {
+	// Key for this file in the extraction cache, or empty if we aren't
+	// using the cache for it.
+	string cache_key;
+	ExtractedText cached;
+	bool use_cached = false;
+	if (extract_cache.is_open() && cmd_it != commands.end() &&
+	    runs_filter(cmd_it->second) && d.md5(md5)) {
+	    cache_key = ExtractCache::key(md5, extraction_method(cmd_it->second,
+								 mimetype));
+	    use_cached = extract_cache.get(cache_key, cached);
+	}
+
+	if (use_cached) {
+	    // We've already extracted text in the same way from a file with
+	    // identical contents.
+	    if (verbose)
+		cout << "using cached text, ";
+	    dump = std::move(cached.dump);
+	    title = std::move(cached.title);
+	    keywords = std::move(cached.keywords);
+	    topic = std::move(cached.topic);
+	    sample = std::move(cached.sample);
+	    author = std::move(cached.author);
+	    to = std::move(cached.to);
+	    cc = std::move(cached.cc);
+	    bcc = std::move(cached.bcc);
+	    message_id = std::move(cached.message_id);
+	    created = cached.created;
+	    pages = cached.pages;
+	} else if (cmd_it != commands.end() && cmd_it->second.worker) {
 	    // Use a worker process to extract the content.
 	    Worker* wrk = cmd_it->second.worker;
 	    int r = wrk->extract(file, mimetype, dump, title, keywords, author,
@@ -826,7 +927,7 @@ index_mimetype(const string& file, const string& urlterm, const string& url,
 		    }
 		    commands[filter_entry] = Filter();
 		}
-		return;
+		return false;
 	    }
 	} else if (cmd_it != commands.end()) {
 	    // Easy "run a command and read text or HTML from stdout or a
@@ -836,7 +937,7 @@ index_mimetype(const string& file, const string& urlterm, const string& url,
 	    if (cmd.empty()) {
 		skip(urlterm, context, "required filter not installed",
 		     d.get_size(), d.get_mtime(), SKIP_VERBOSE_ONLY);
-		return;
+		return false;
 	    }
 	    if (cmd == "false") {
 		// Allow setting 'false' as a filter to mean that a MIME type
@@ -846,7 +947,7 @@ index_mimetype(const string& file, const string& urlterm, const string& url,
 		m += "'";
 		skip(urlterm, context, m, d.get_size(), d.get_mtime(),
 		     SKIP_VERBOSE_ONLY);
-		return;
+		return false;
 	    }
 	    bool use_shell = filter.use_shell();
 	    bool input_on_stdin = filter.input_on_stdin();
@@ -958,7 +1059,7 @@ index_mimetype(const string& file, const string& urlterm, const string& url,
 		    } catch (const ReadError&) {
 			skip_cmd_failed(urlterm, context, cmd,
 					d.get_size(), d.get_mtime());
-			return;
+			return false;
 		    }
 		    dump = p.dump;
 		    title = p.title;
@@ -981,7 +1082,7 @@ index_mimetype(const string& file, const string& urlterm, const string& url,
 	    } catch (const ReadError&) {
 		skip_cmd_failed(urlterm, context, cmd,
 				d.get_size(), d.get_mtime());
-		return;
+		return false;
 	    }
 	} else if (mimetype == "text/html" || mimetype == "text/x-php") {
 	    const string& text = d.file_to_string();
@@ -1001,7 +1102,7 @@ index_mimetype(const string& file, const string& urlterm, const string& url,
 	    if (!p.indexing_allowed) {
 		skip_meta_tag(urlterm, context,
 			      d.get_size(), d.get_mtime());
-		return;
+		return false;
 	    }
 	    dump = p.dump;
 	    title = p.title;
@@ -1039,7 +1140,7 @@ index_mimetype(const string& file, const string& urlterm, const string& url,
 	    } catch (const ReadError&) {
 		skip_cmd_failed(urlterm, context, cmd,
 				d.get_size(), d.get_mtime());
-		return;
+		return false;
 	    }
 	    get_pdf_metainfo(d.get_fd(), author, title, keywords, topic, pages);
 	} else if (mimetype == "application/postscript") {
@@ -1058,7 +1159,7 @@ index_mimetype(const string& file, const string& urlterm, const string& url,
 		msg += ")";
 		skip(urlterm, context, msg,
 		     d.get_size(), d.get_mtime());
-		return;
+		return false;
 	    }
 	    const char* cmd[] = {
 		"ps2pdf", "-", NULL, NULL
@@ -1075,7 +1176,7 @@ index_mimetype(const string& file, const string& urlterm, const string& url,
 		skip_cmd_failed(urlterm, context, cmd,
 				d.get_size(), d.get_mtime());
 		unlink(tmpfile.c_str());
-		return;
+		return false;
 	    } catch (...) {
 		unlink(tmpfile.c_str());
 		throw;
@@ -1104,7 +1205,7 @@ index_mimetype(const string& file, const string& urlterm, const string& url,
 	    } catch (const ReadError&) {
 		skip_cmd_failed(urlterm, context, cmd,
 				d.get_size(), d.get_mtime());
-		return;
+		return false;
 	    }
 
 	    const char* cmd2[] = {
@@ -1151,7 +1252,7 @@ index_mimetype(const string& file, const string& urlterm, const string& url,
 		} catch (const ReadError&) {
 		    skip_cmd_failed(urlterm, context, cmd,
 				    d.get_size(), d.get_mtime());
-		    return;
+		    return false;
 		}
 	    } else if (startswith(tail, "presentationml.")) {
 		// There may be no notesSlides or no comments.
@@ -1163,7 +1264,7 @@ index_mimetype(const string& file, const string& urlterm, const string& url,
 		// Don't know how to index this type.
 		skip_unknown_mimetype(urlterm, context, mimetype,
 				      d.get_size(), d.get_mtime());
-		return;
+		return false;
 	    }
 
 	    if (args) {
@@ -1180,7 +1281,7 @@ index_mimetype(const string& file, const string& urlterm, const string& url,
 		} catch (const ReadError&) {
 		    skip_cmd_failed(urlterm, context, cmd,
 				    d.get_size(), d.get_mtime());
-		    return;
+		    return false;
 		}
 	    }
 
@@ -1242,7 +1343,7 @@ index_mimetype(const string& file, const string& urlterm, const string& url,
 	    } catch (const ReadError&) {
 		skip_cmd_failed(urlterm, context, cmd,
 				d.get_size(), d.get_mtime());
-		return;
+		return false;
 	    }
 
 	    const char* cmd2[] = {
@@ -1342,7 +1443,24 @@ index_mimetype(const string& file, const string& urlterm, const string& url,
 	    // Don't know how to index this type.
 	    skip_unknown_mimetype(urlterm, context, mimetype,
 				  d.get_size(), d.get_mtime());
-	    return;
+	    return false;
+	}
+
+	if (!cache_key.empty() && !use_cached) {
+	    ExtractedText e;
+	    e.dump = dump;
+	    e.title = title;
+	    e.keywords = keywords;
+	    e.topic = topic;
+	    e.sample = sample;
+	    e.author = author;
+	    e.to = to;
+	    e.cc = cc;
+	    e.bcc = bcc;
+	    e.message_id = message_id;
+	    e.created = created;
+	    e.pages = pages;
+	    add_to_extract_cache(cache_key, e.serialise());
 	}
 
 	// Compute the MD5 of the file if we haven't already.
@@ -1356,7 +1474,7 @@ index_mimetype(const string& file, const string& urlterm, const string& url,
 		     "failed to read file to calculate MD5 checksum",
 		     d.get_size(), d.get_mtime());
 	    }
-	    return;
+	    return false;
 	}
 
 	// Remove any trailing formfeeds, so we don't consider them when
@@ -1381,7 +1499,7 @@ index_mimetype(const string& file, const string& urlterm, const string& url,
 		    skip(urlterm, context,
 			 "no text extracted from document body",
 			 d.get_size(), d.get_mtime());
-		    return;
+		    return false;
 	    }
 	}
 
@@ -1583,7 +1701,12 @@ index_mimetype(const string& file, const string& urlterm, const string& url,
 	}
 	newdocument.add_boolean_term(ext_term);
 
-	index_add_document(urlterm, last_altered, did, newdocument);
+	if (result) {
+	    *result = newdocument;
+	} else {
+	    index_add_document(urlterm, last_altered, did, newdocument);
+	}
+	return true;
     } catch (const ReadError&) {
 	skip(urlterm, context, string("can't read file: ") + strerror(errno),
 	     d.get_size(), d.get_mtime());
@@ -1599,6 +1722,7 @@ index_mimetype(const string& file, const string& urlterm, const string& url,
 	m += "\" not installed";
 	skip(urlterm, context, m, d.get_size(), d.get_mtime());
 	commands[filter_entry] = Filter();
+	if (in_extractor) extractor_disabled_filters.push_back(filter_entry);
     } catch (const FileNotFound&) {
 	skip(urlterm, context, "File removed during indexing",
 	     d.get_size(), d.get_mtime(),
@@ -1614,6 +1738,339 @@ index_mimetype(const string& file, const string& urlterm, const string& url,
 	     SKIP_SHOW_FILENAME);
 	throw CommitAndExit("Caught std::bad_alloc", "");
     }
+    return false;
+}
+
+#ifdef PARALLEL_EXTRACTION
+/// Result codes sent by an extraction process.
+enum {
+    EXTRACTION_SKIPPED,
+    EXTRACTION_DOCUMENT,
+    EXTRACTION_FATAL
+};
+
+/** Extract a file in a child process and send the results to our parent.
+ *
+ *  Doesn't return.
+ */
+[[noreturn]] static void
+run_extraction(int fd, const string& file, const string& urlterm,
+	       const string& url, const string& ext, const string& mimetype,
+	       map<string, Filter>::const_iterator cmd_it,
+	       DirectoryIterator& d, const string& pathterm,
+	       const string& record, const string& context,
+	       time_t last_altered, Xapian::docid did)
+{
+    in_extractor = true;
+    // Our parent process adds the spelling data, as any we add to the
+    // database here would be lost.
+    indexer.set_flags(Xapian::TermGenerator::flags(0));
+    // Use our own temporary directory, as other extractions may be running.
+    reset_tmpdir();
+    // Capture our output so our parent can show it along with the rest of the
+    // output for this file.
+    ostringstream output;
+    cout.rdbuf(output.rdbuf());
+
+    unsigned status = EXTRACTION_SKIPPED;
+    string payload;
+    try {
+	Xapian::Document doc;
+	if (index_document(file, urlterm, url, ext, mimetype, cmd_it, d,
+			   pathterm, record, context, last_altered, did,
+			   &doc)) {
+	    status = EXTRACTION_DOCUMENT;
+	    payload = doc.serialise();
+	}
+    } catch (const CommitAndExit& e) {
+	status = EXTRACTION_FATAL;
+	payload = e.what();
+    } catch (const Xapian::Error& e) {
+	status = EXTRACTION_FATAL;
+	payload = e.get_description();
+    } catch (const std::exception& e) {
+	status = EXTRACTION_FATAL;
+	payload = e.what();
+    } catch (...) {
+	status = EXTRACTION_FATAL;
+	payload = "Caught unknown exception";
+    }
+    remove_tmpdir();
+
+    FILE* sockt = fdopen(fd, "w");
+    bool ok = sockt != NULL;
+    ok = ok && write_unsigned(sockt, (unsigned long)extractor_failures.size());
+    for (auto&& f : extractor_failures) {
+	ok = ok && write_string(sockt, f.urlterm);
+	ok = ok && write_unsigned(sockt, (unsigned long)f.last_mod);
+	ok = ok && write_unsigned(sockt, (unsigned long)f.size);
+    }
+    ok = ok && write_unsigned(sockt,
+			      (unsigned long)extractor_disabled_filters.size());
+    for (auto&& filter_entry : extractor_disabled_filters) {
+	ok = ok && write_string(sockt, filter_entry);
+    }
+    ok = ok && write_unsigned(sockt,
+			      (unsigned long)extractor_cache_entries.size());
+    for (auto&& entry : extractor_cache_entries) {
+	ok = ok && write_string(sockt, entry.first);
+	ok = ok && write_string(sockt, entry.second);
+    }
+    ok = ok && write_string(sockt, output.str());
+    ok = ok && write_unsigned(sockt, status);
+    ok = ok && write_string(sockt, payload);
+    ok = ok && fflush(sockt) == 0;
+    _exit(ok ? 0 : 1);
+}
+
+/// Wait for an extraction to finish and index its results.
+static void
+finish_extraction()
+{
+    vector<Extraction>::iterator it;
+    while (true) {
+	fd_set fds;
+	FD_ZERO(&fds);
+	int maxfd = -1;
+	for (auto&& e : extractions) {
+	    int fd = fileno(e.sockt);
+	    FD_SET(fd, &fds);
+	    maxfd = max(maxfd, fd);
+	}
+	if (select(maxfd + 1, &fds, NULL, NULL, NULL) < 0) {
+	    if (errno == EINTR) continue;
+	    throw CommitAndExit("select() failed", errno);
+	}
+	it = find_if(extractions.begin(), extractions.end(),
+		     [&fds](const Extraction& e) {
+			 return FD_ISSET(fileno(e.sockt), &fds);
+		     });
+	if (it != extractions.end()) break;
+    }
+    Extraction e = std::move(*it);
+    extractions.erase(it);
+
+    unsigned long n;
+    bool ok = read_unsigned(e.sockt, n);
+    while (ok && n--) {
+	string urlterm;
+	unsigned long last_mod, size;
+	ok = read_string(e.sockt, urlterm) &&
+	     read_unsigned(e.sockt, last_mod) &&
+	     read_unsigned(e.sockt, size);
+	if (ok) failed.add(urlterm, time_t(last_mod), off_t(size));
+    }
+    ok = ok && read_unsigned(e.sockt, n);
+    while (ok && n--) {
+	string filter_entry;
+	ok = read_string(e.sockt, filter_entry);
+	if (ok) commands[filter_entry] = Filter();
+    }
+    ok = ok && read_unsigned(e.sockt, n);
+    while (ok && n--) {
+	string key, value;
+	ok = read_string(e.sockt, key) && read_string(e.sockt, value);
+	if (ok) extract_cache.put(key, value);
+    }
+    string output;
+    ok = ok && read_string(e.sockt, output);
+    unsigned status = EXTRACTION_SKIPPED;
+    ok = ok && read_unsigned(e.sockt, status);
+    string payload;
+    ok = ok && read_string(e.sockt, payload);
+    fclose(e.sockt);
+
+    int wstatus;
+    pid_t pid;
+    while ((pid = waitpid(e.child, &wstatus, 0)) < 0 && errno == EINTR) { }
+
+    if (verbose)
+	cout << e.message;
+    cout << output;
+    if (!ok) {
+	string msg = "extraction process failed";
+	if (pid == e.child && WIFSIGNALED(wstatus)) {
+	    msg = "extraction process killed by signal ";
+	    msg += str(WTERMSIG(wstatus));
+	}
+	skip(e.urlterm, e.context, msg, e.size, e.last_mod);
+	return;
+    }
+
+    switch (status) {
+	case EXTRACTION_DOCUMENT: {
+	    auto doc = Xapian::Document::unserialise(payload);
+	    if (index_spelling) {
+		// The TermGenerator adds spelling data for each occurrence of
+		// an unprefixed term, and we index those with a wdf increment
+		// of 1.
+		for (auto t = doc.termlist_begin(); t != doc.termlist_end();
+		     ++t) {
+		    const string& term = *t;
+		    if (!C_isupper(term[0]))
+			db.add_spelling(term, t.get_wdf());
+		}
+	    }
+	    index_add_document(e.urlterm, e.last_altered, e.did, doc);
+	    break;
+	}
+	case EXTRACTION_FATAL:
+	    cout << flush;
+	    throw CommitAndExit(payload);
+    }
+    cout << flush;
+}
+
+/** Start extracting a file in a child process.
+ *
+ *  If max_jobs extractions are already running, waits for one to finish
+ *  first.
+ *
+ *  @return false if we couldn't start a child process.
+ */
+static bool
+start_extraction(const string& file, const string& urlterm, const string& url,
+		 const string& ext, const string& mimetype,
+		 map<string, Filter>::const_iterator cmd_it,
+		 DirectoryIterator& d, const string& pathterm,
+		 const string& record, const string& context,
+		 time_t last_altered, Xapian::docid did, const string& message)
+{
+    while (extractions.size() >= max_jobs) {
+	finish_extraction();
+    }
+
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, PF_UNSPEC, fds) < 0) {
+	return false;
+    }
+
+    // Flush any buffered output so the child doesn't write it too.
+    cout << flush;
+    pid_t child = fork();
+    if (child == 0) {
+	// Child process.
+	close(fds[0]);
+	for (auto&& e : extractions) {
+	    fclose(e.sockt);
+	}
+	extractions.clear();
+	run_extraction(fds[1], file, urlterm, url, ext, mimetype, cmd_it, d,
+		       pathterm, record, context, last_altered, did);
+    }
+
+    close(fds[1]);
+    FILE* sockt = NULL;
+    if (child != -1) {
+	sockt = fdopen(fds[0], "r");
+	if (!sockt) {
+	    kill(child, SIGKILL);
+	    while (waitpid(child, NULL, 0) < 0 && errno == EINTR) { }
+	}
+    }
+    if (!sockt) {
+	close(fds[0]);
+	return false;
+    }
+
+    extractions.push_back({child, sockt, urlterm, context, last_altered, did,
+			   d.get_size(), d.get_mtime(), message});
+    return true;
+}
+#endif
+
+void
+index_mimetype(const string& file, const string& urlterm, const string& url,
+	       const string& ext,
+	       string mimetype,
+	       DirectoryIterator& d,
+	       string pathterm,
+	       string record)
+{
+    string context(file, root.size(), string::npos);
+
+    // FIXME: We could be cleverer here and check mtime too when use_ctime is
+    // set - if the ctime has changed but the mtime is unchanged, we can just
+    // update the existing Document and avoid having to re-extract text, etc.
+    time_t last_altered = use_ctime ? d.get_ctime() : d.get_mtime();
+
+    Xapian::docid did = 0;
+    if (index_check_existing(urlterm, last_altered, did))
+	return;
+
+    if (!retry_failed) {
+	// We only store and check the mtime (last modified) - a change to the
+	// metadata won't generally cause a previous failure to now work
+	// (FIXME: except permissions).
+	time_t failed_last_mod;
+	off_t failed_size;
+	if (failed.contains(urlterm, failed_last_mod, failed_size)) {
+	    if (d.get_mtime() <= failed_last_mod &&
+		d.get_size() == failed_size) {
+		if (verbose)
+		    cout << "failed to extract text on earlier run" << endl;
+		return;
+	    }
+	    // The file has changed, so remove the entry for it.  If it fails
+	    // again on this attempt, we'll add a new one.
+	    failed.del(urlterm);
+	}
+    }
+
+    // If we didn't get the mime type from the extension, call libmagic to get
+    // it.
+    if (mimetype.empty()) {
+	mimetype = d.get_magic_mimetype();
+	if (mimetype.empty()) {
+	    skip(urlterm, file.substr(root.size()),
+		 "Unknown extension and unrecognised format",
+		 d.get_size(), d.get_mtime(), SKIP_SHOW_FILENAME);
+	    return;
+	}
+    }
+
+    map<string, Filter>::const_iterator cmd_it = commands.find(mimetype);
+    if (cmd_it == commands.end()) {
+	size_t slash = mimetype.find('/');
+	if (slash != string::npos) {
+	    string wildtype(mimetype, 0, slash + 2);
+	    wildtype[slash + 1] = '*';
+	    cmd_it = commands.find(wildtype);
+	    if (cmd_it == commands.end()) {
+		cmd_it = commands.find("*/*");
+	    }
+	}
+	if (cmd_it == commands.end()) {
+	    cmd_it = commands.find("*");
+	}
+    }
+
+    string message;
+    if (verbose) {
+	message = "Indexing \"";
+	message += context;
+	message += "\" as ";
+	message += mimetype;
+	message += " ... ";
+    }
+
+#ifdef PARALLEL_EXTRACTION
+    // A worker process can only extract one file at a time, so files which
+    // use one are extracted by this process.
+    if (max_jobs > 1 && (cmd_it == commands.end() || !cmd_it->second.worker)) {
+	if (start_extraction(file, urlterm, url, ext, mimetype, cmd_it, d,
+			     pathterm, record, context, last_altered, did,
+			     message)) {
+	    return;
+	}
+    }
+#endif
+
+    if (verbose)
+	cout << message << flush;
+
+    (void)index_document(file, urlterm, url, ext, mimetype, cmd_it, d,
+			 pathterm, record, context, last_altered, did, nullptr);
 }
 
 void
@@ -1645,15 +2102,37 @@ index_handle_deletion()
     }
 }
 
+void
+index_finish_extractions()
+{
+#ifdef PARALLEL_EXTRACTION
+    while (!extractions.empty()) {
+	finish_extraction();
+    }
+#endif
+}
+
 void
 index_commit()
 {
     db.commit();
+    extract_cache.commit();
 }
 
 void
 index_done()
 {
+#ifdef PARALLEL_EXTRACTION
+    // Abandon any extractions still running (e.g. if we're exiting because of
+    // an error).
+    for (auto&& e : extractions) {
+	kill(e.child, SIGTERM);
+	fclose(e.sockt);
+	while (waitpid(e.child, NULL, 0) < 0 && errno == EINTR) { }
+    }
+    extractions.clear();
+#endif
+
     // If we created a temporary directory then delete it.
     remove_tmpdir();
 }
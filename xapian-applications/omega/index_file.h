@@ -121,7 +121,12 @@ index_add_default_filters();
 void
 index_add_default_libraries();
 
-/// Initialise.
+/** Initialise.
+ *
+ *  @param jobs	Maximum number of files to extract text from at once.
+ *  @param extract_cache_path	Path to the database to cache extracted text
+ *				in, or empty to not use a cache.
+ */
 void
 index_init(const std::string& dbpath, const Xapian::Stem& stemmer,
 	   const std::string& root_,
@@ -132,7 +137,8 @@ index_init(const std::string& dbpath, const Xapian::Stem& stemmer,
 	   bool overwrite, bool retry_failed_,
 	   bool delete_removed_documents, bool verbose_, bool use_ctime_,
 	   bool spelling, bool ignore_exclusions_, bool description_as_sample,
-	   bool date_terms);
+	   bool date_terms, unsigned jobs,
+	   const std::string& extract_cache_path);
 
 void
 index_remove_failed_entry(const std::string& urlterm);
@@ -152,6 +158,9 @@ index_mimetype(const std::string& file,
 	       std::string pathterm,
 	       std::string record);
 
+/// Wait for any files still being extracted and index them.
+void index_finish_extractions();
+
 /// Delete any previously indexed documents we haven't seen.
 void index_handle_deletion();
 
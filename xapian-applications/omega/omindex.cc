@@ -361,6 +361,8 @@ main(int argc, char **argv)
     bool description_as_sample = false;
     string baseurl;
     size_t depth_limit = 0;
+    unsigned jobs = 1;
+    string extract_cache_path;
     size_t title_size = TITLE_SIZE;
     size_t sample_size = SAMPLE_SIZE;
     empty_body_type empty_body = EMPTY_BODY_WARN;
@@ -373,7 +375,8 @@ main(int argc, char **argv)
 	OPT_DATE_TERMS,
 	OPT_NO_DATE_TERMS,
 	OPT_READ_FILTERS,
-	OPT_READ_WORKERS
+	OPT_READ_WORKERS,
+	OPT_EXTRACT_CACHE
     };
     constexpr auto NO_ARG = no_argument;
     constexpr auto REQ_ARG = required_argument;
@@ -392,6 +395,8 @@ main(int argc, char **argv)
 	{ "read-filters",	REQ_ARG,	NULL, OPT_READ_FILTERS },
 	{ "read-workers",	REQ_ARG,	NULL, OPT_READ_WORKERS },
 	{ "depth-limit",	REQ_ARG,	NULL, 'l' },
+	{ "jobs",		REQ_ARG,	NULL, 'j' },
+	{ "extract-cache",	REQ_ARG,	NULL, OPT_EXTRACT_CACHE },
 	{ "follow",		NO_ARG,		NULL, 'f' },
 	{ "ignore-exclusions",	NO_ARG,		NULL, 'i' },
 	{ "stemmer",		REQ_ARG,	NULL, 's' },
@@ -426,7 +431,7 @@ main(int argc, char **argv)
     string dbpath;
     int getopt_ret;
     while ((getopt_ret = gnu_getopt_long(argc, argv,
-					 "hvd:D:U:M:G:F:W:l:s:pfRSVe:im:E:T:C",
+					 "hvd:D:U:M:G:F:W:l:j:s:pfRSVe:im:E:T:C",
 					 longopts, NULL)) != -1) {
 	switch (getopt_ret) {
 	case 'h': {
@@ -479,6 +484,14 @@ main(int argc, char **argv)
 "                            text/x-bar:omindex_libbar).  Lines starting with #\n"
 "                            are treated as comments and ignored.\n"
 "  -l, --depth-limit=LIMIT   set recursion limit (0 = unlimited)\n"
+"  -j, --jobs=N              extract text from up to N files at once using\n"
+"                            sub-processes (default: 1).  Files handled by a\n"
+"                            worker (see --worker) are still extracted one at\n"
+"                            a time\n"
+"      --extract-cache=PATH  cache text extracted by filters and workers in the\n"
+"                            database PATH, keyed by a checksum of the file's\n"
+"                            contents, so files with unchanged contents don't\n"
+"                            need to be passed through the filter again\n"
 "  -f, --follow              follow symbolic links\n"
 "  -i, --ignore-exclusions   ignore meta robots tags and similar exclusions\n"
 "  -S, --spelling            index data for spelling correction\n"
@@ -551,6 +564,16 @@ main(int argc, char **argv)
 	    depth_limit = size_t(arg);
 	    break;
 	}
+	case 'j':
+	    if (!parse_unsigned(optarg, jobs) || jobs == 0) {
+		cerr << PROG_NAME": bad --jobs argument: "
+			"'" << optarg << "'" << endl;
+		return 1;
+	    }
+	    break;
+	case OPT_EXTRACT_CACHE:
+	    extract_cache_path = optarg;
+	    break;
 	case 'f': // Turn on following of symlinks
 	    follow_symlinks = true;
 	    break;
@@ -844,8 +867,10 @@ main(int argc, char **argv)
 		   sample_size, title_size, max_ext_len,
 		   overwrite, retry_failed, delete_removed_documents, verbose,
 		   use_ctime, spelling, ignore_exclusions,
-		   description_as_sample, date_terms);
+		   description_as_sample, date_terms, jobs,
+		   extract_cache_path);
 	index_directory(root, baseurl, depth_limit, mime_map);
+	index_finish_extractions();
 	index_handle_deletion();
 	index_commit();
 	exitcode = 0;
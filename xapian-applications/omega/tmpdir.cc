@@ -64,3 +64,9 @@ remove_tmpdir()
     if (!tmpdir.empty())
 	rmdir(tmpdir.c_str());
 }
+
+void
+reset_tmpdir()
+{
+    tmpdir.clear();
+}
@@ -67,4 +67,10 @@ inline std::string get_tmpfile(const std::string & leaf) {
  */
 void remove_tmpdir();
 
+/** Forget the directory without removing it.
+ *
+ *  Used in a child process so it creates its own directory if it needs one.
+ */
+void reset_tmpdir();
+
 #endif // OMEGA_INCLUDED_TMPDIR_H
@@ -142,4 +142,9 @@ class Worker {
     std::string get_error() const {
 	return error;
     }
+
+    /// Returns the pathname of the assistant program.
+    const std::string& get_filter_module() const {
+	return filter_module;
+    }
 };
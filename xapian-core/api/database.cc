@@ -26,6 +26,9 @@
 #include "backends/databaseinternal.h"
 #include "backends/empty_database.h"
 #include "backends/multi/multi_database.h"
+#ifdef XAPIAN_HAS_GLASS_BACKEND
+# include "backends/glass/glass_blockcache.h"
+#endif
 #include "debuglog.h"
 #include "editdistance.h"
 #include "omassert.h"
@@ -400,20 +403,47 @@ string
 Database::get_spelling_suggestion(string_view word,
 				  unsigned max_edit_distance) const
 {
-    if (word.size() <= 1 || max_edit_distance == 0)
-	return string();
+    vector<string> words{string(word)};
+    return std::move(get_spelling_suggestions(words, max_edit_distance)[0]);
+}
+
+namespace {
+
+/// The candidate corrections for a word.
+struct SpellingCandidates {
+    /// The greatest edit distance we'd consider for this word.
+    int max_edist;
+
+    /// The edit distance of the entries in candidates.
+    int edist;
+
+    /// Is the word itself a spelling target?
+    bool exact = false;
 
-    max_edit_distance = min(max_edit_distance, unsigned(word.size() - 1));
+    /** The candidates with the smallest edit distance.
+     *
+     *  These are in the order the spelling termlist returned them in.
+     */
+    vector<string> candidates;
+};
 
-    unique_ptr<TermList> merger(internal->open_spelling_termlist(word));
+/** Find the closest candidate corrections for a word.
+ *
+ *  @param db		The database.
+ *  @param word		The word.
+ *  @param[out] result	The candidates found.
+ */
+void
+find_spelling_candidates(const Database::Internal& db,
+			 const string& word,
+			 SpellingCandidates& result)
+{
+    unique_ptr<TermList> merger(db.open_spelling_termlist(word));
     if (!merger)
-	return string();
+	return;
 
     EditDistanceCalculator edcalc(word);
-    string result;
-    int edist_best = max_edit_distance;
-    Xapian::doccount freq_best = 0;
-    Xapian::doccount freq_exact = 0;
+    int edist_best = result.max_edist;
     while (true) {
 	TermList* ret = merger->next();
 	if (rare(ret == merger.get())) {
@@ -442,30 +472,94 @@ Database::get_spelling_suggestion(string_view word,
 	int edist = edcalc(term, edist_best);
 	LOGVALUE(SPELLING, edist);
 
-	if (edist <= edist_best) {
-	    Xapian::doccount freq = internal->get_spelling_frequency(term);
+	if (edist > edist_best)
+	    continue;
 
-	    LOGVALUE(SPELLING, freq);
-	    LOGVALUE(SPELLING, freq_best);
-	    // Even if we have an exact match, there may be a much more
-	    // frequent potential correction which will still be interesting.
-	    if (rare(edist == 0)) {
-		freq_exact = freq;
-		continue;
-	    }
+	// Even if we have an exact match, there may be a much more frequent
+	// potential correction which will still be interesting.
+	if (rare(edist == 0)) {
+	    result.exact = true;
+	    continue;
+	}
+
+	if (edist < edist_best) {
+	    result.candidates.clear();
+	    edist_best = edist;
+	}
+	result.candidates.push_back(term);
+    }
+    result.edist = edist_best;
+}
+
+}
+
+vector<string>
+Database::get_spelling_suggestions(const vector<string>& words,
+				   unsigned max_edit_distance) const
+{
+    vector<string> suggestions(words.size());
+    vector<SpellingCandidates> candidates(words.size());
+
+    // First find the candidates for all the words, without looking at their
+    // frequencies.  We only need the frequencies of candidates with the
+    // smallest edit distance, and can then look those up together with a
+    // single pass through the spelling table.
+    vector<string> lookups;
+    for (size_t i = 0; i != words.size(); ++i) {
+	const string& word = words[i];
+	if (word.size() <= 1 || max_edit_distance == 0)
+	    continue;
 
-	    if (edist < edist_best || freq > freq_best) {
+	SpellingCandidates& c = candidates[i];
+	c.max_edist = min(max_edit_distance, unsigned(word.size() - 1));
+	find_spelling_candidates(*internal, word, c);
+	if (c.candidates.empty())
+	    continue;
+	if (c.exact)
+	    lookups.push_back(word);
+	lookups.insert(lookups.end(), c.candidates.begin(), c.candidates.end());
+    }
+    if (lookups.empty())
+	return suggestions;
+
+    sort(lookups.begin(), lookups.end());
+    lookups.erase(unique(lookups.begin(), lookups.end()), lookups.end());
+    vector<Xapian::doccount> freqs;
+    internal->get_spelling_frequencies(lookups, freqs);
+    auto get_freq = [&](const string& term) {
+	auto it = lower_bound(lookups.begin(), lookups.end(), term);
+	AssertRel(it, !=, lookups.end());
+	return freqs[it - lookups.begin()];
+    };
+
+    for (size_t i = 0; i != words.size(); ++i) {
+	const SpellingCandidates& c = candidates[i];
+	if (c.candidates.empty())
+	    continue;
+
+	// Pick the most frequent candidate, preferring the earliest in the
+	// event of a tie.  A candidate at the maximum edit distance needs a
+	// non-zero frequency.
+	const string* best = nullptr;
+	Xapian::doccount freq_best = 0;
+	for (auto&& term : c.candidates) {
+	    Xapian::doccount freq = get_freq(term);
+	    LOGVALUE(SPELLING, freq);
+	    if (freq > freq_best || (!best && c.edist < c.max_edist)) {
 		LOGLINE(SPELLING, "Best so far: \"" << term <<
-				  "\" edist " << edist << " freq " << freq);
-		result = term;
-		edist_best = edist;
+				  "\" edist " << c.edist << " freq " << freq);
+		best = &term;
 		freq_best = freq;
 	    }
 	}
+	if (!best)
+	    continue;
+
+	if (c.exact && freq_best < get_freq(words[i]))
+	    continue;
+	suggestions[i] = *best;
     }
-    if (freq_best < freq_exact)
-	return string();
-    return result;
+    return suggestions;
 }
 
 TermIterator
@@ -529,6 +623,27 @@ Database::get_revision() const
     return internal->get_revision();
 }
 
+void
+Database::set_block_cache_size(size_t size)
+{
+#ifdef XAPIAN_HAS_GLASS_BACKEND
+    Glass::BlockCache::get().set_capacity(size);
+#else
+    (void)size;
+#endif
+}
+
+void
+Database::get_block_cache_stats(unsigned long long& hits,
+				unsigned long long& misses)
+{
+#ifdef XAPIAN_HAS_GLASS_BACKEND
+    Glass::BlockCache::get().get_stats(hits, misses);
+#else
+    hits = misses = 0;
+#endif
+}
+
 string
 Database::reconstruct_text(Xapian::docid did,
 			   size_t length,
@@ -545,6 +660,12 @@ WritableDatabase::commit()
     internal->commit();
 }
 
+void
+WritableDatabase::set_flush_memory_limit(size_t limit)
+{
+    internal->set_flush_memory_limit(limit);
+}
+
 void
 WritableDatabase::begin_transaction(bool flushed)
 {
@@ -563,6 +684,13 @@ WritableDatabase::add_document(const Document& doc)
     return internal->add_document(doc);
 }
 
+Xapian::docid
+WritableDatabase::add_documents(const vector<Document>& docs,
+				unsigned n_threads)
+{
+    return internal->add_documents(docs, n_threads);
+}
+
 void
 WritableDatabase::delete_document(Xapian::docid did)
 {
@@ -192,6 +192,51 @@ seqcmp_editdist(const Char* ptr1, int len1, const Char* ptr2, int len2,
     return p;
 }
 
+// This is the algorithm from "A Bit-Vector Algorithm for Computing
+// Levenshtein and Damerau Edit Distances" by Heikki Hyyrö (2003), which
+// extends Myers' bit-parallel Levenshtein algorithm to handle transpositions.
+// It processes a column of the dynamic programming matrix per character of
+// the candidate, with the vertical deltas for the column held as bit-vectors,
+// so it's O(len) for targets which fit in a bitvec.
+int
+EditDistanceCalculator::calc_bit_parallel(const unsigned* ptr, int len,
+					  int max_distance) const
+{
+    int m = target.size();
+    const bitvec top = bitvec(1) << (m - 1);
+    // Positive and negative vertical deltas.
+    bitvec vp = ~bitvec(0);
+    bitvec vn = 0;
+    // Diagonal zero deltas and match vector for the previous column.
+    bitvec d0 = 0;
+    bitvec pm_prev = 0;
+    // The edit distance between the target and ptr[0..j].
+    int score = m;
+    for (int j = 0; j != len; ++j) {
+	bitvec pm = get_peq(ptr[j]);
+	bitvec tr = ((~d0 & pm) << 1) & pm_prev;
+	d0 = (((pm & vp) + vp) ^ vp) | pm | vn | tr;
+	bitvec hp = vn | ~(d0 | vp);
+	bitvec hn = d0 & vp;
+	if (hp & top) {
+	    ++score;
+	} else if (hn & top) {
+	    --score;
+	}
+	// Each remaining character can reduce the distance by at most 1.
+	int lower_bound = score - (len - 1 - j);
+	if (lower_bound > max_distance) {
+	    return lower_bound;
+	}
+	hp = (hp << 1) | 1;
+	hn <<= 1;
+	vp = hn | ~(d0 | hp);
+	vn = hp & d0;
+	pm_prev = pm;
+    }
+    return score;
+}
+
 int
 EditDistanceCalculator::calc(const unsigned* ptr, int len,
 			     int max_distance) const
@@ -220,6 +265,10 @@ EditDistanceCalculator::calc(const unsigned* ptr, int len,
 	return ed_lower_bound;
     }
 
+    if (!peq_low.empty()) {
+	return calc_bit_parallel(ptr, len, max_distance);
+    }
+
     if (!array) {
 	// Allocate space for the largest case we need to consider, which is
 	// when the second sequence is len + max_distance long.  Any second
@@ -234,3 +283,146 @@ EditDistanceCalculator::calc(const unsigned* ptr, int len,
     return seqcmp_editdist<unsigned>(ptr, len, &target[0], target.size(),
 				     array, max_distance);
 }
+
+EditDistanceAutomaton::EditDistanceAutomaton(string_view target_,
+					     int max_distance_)
+    : max_distance(max_distance_)
+{
+    using Xapian::Utf8Iterator;
+    target.assign(Utf8Iterator(target_), Utf8Iterator());
+    target_chars = target;
+    sort(target_chars.begin(), target_chars.end());
+    target_chars.erase(unique(target_chars.begin(), target_chars.end()),
+		       target_chars.end());
+    // Row 0 is the distance from the empty string to each prefix of target.
+    for (size_t j = 0; j <= target.size(); ++j) {
+	rows.push_back(int(j));
+    }
+}
+
+bool
+EditDistanceAutomaton::step(unsigned ch, int* out) const
+{
+    size_t m = target.size();
+    size_t i = chars.size();
+    const int* prev = &rows[i * (m + 1)];
+    out[0] = int(i + 1);
+    int row_min = out[0];
+    for (size_t j = 1; j <= m; ++j) {
+	int d = prev[j - 1] + (target[j - 1] != ch);
+	d = min(d, prev[j] + 1);
+	d = min(d, out[j - 1] + 1);
+	if (i > 0 && j > 1 && ch == target[j - 2] && chars[i - 1] == target[j - 1]) {
+	    // Transposition.
+	    d = min(d, rows[(i - 1) * (m + 1) + j - 2] + 1);
+	}
+	out[j] = d;
+	row_min = min(row_min, d);
+    }
+    // No entry in later rows can be less than the smallest entry in this one.
+    return row_min <= max_distance;
+}
+
+unsigned
+EditDistanceAutomaton::next_viable(unsigned ch) const
+{
+    // Any character not in the target has the same effect, and isn't better
+    // than any character which is, so our caller only needs us to consider
+    // characters in the target.
+    vector<int> row(target.size() + 1);
+    auto i = upper_bound(target_chars.begin(), target_chars.end(), ch);
+    for ( ; i != target_chars.end(); ++i) {
+	if (step(*i, row.data())) return *i;
+    }
+    return 0;
+}
+
+/// The smallest string greater than all those starting with @a s.
+static void
+next_after_prefix(string& s)
+{
+    while (!s.empty() && s.back() == '\xff') s.pop_back();
+    if (!s.empty()) ++s.back();
+}
+
+bool
+EditDistanceAutomaton::check(const string& term, string& next)
+{
+    AssertRel(last_term, <, term);
+    size_t m = target.size();
+
+    // Reuse the rows for the characters the term shares with the previous
+    // one.
+    size_t common = 0;
+    size_t common_max = min(term.size(), last_term.size());
+    while (common != common_max && term[common] == last_term[common]) ++common;
+    size_t depth = 0;
+    while (depth != chars.size()) {
+	size_t end = ends[depth];
+	if (end & INVALID_UTF8) {
+	    // How a byte which isn't valid UTF-8 decodes depends on up to three
+	    // bytes after it.
+	    end = (end & ~INVALID_UTF8) + 3;
+	}
+	if (end > common) break;
+	++depth;
+    }
+    chars.resize(depth);
+    ends.resize(depth);
+    rows.resize((depth + 1) * (m + 1));
+    last_term = term;
+
+    size_t start = depth ? ends[depth - 1] & ~INVALID_UTF8 : 0;
+    Xapian::Utf8Iterator it(term.data() + start, term.size() - start);
+    while (it != Xapian::Utf8Iterator()) {
+	unsigned ch = it.strict_deref();
+	bool valid = !(ch & 0x80000000);
+	if (!valid) ch &= 0xff;
+	size_t end = term.size() - (++it).left();
+	rows.resize(rows.size() + m + 1);
+	if (step(ch, &rows[rows.size() - (m + 1)])) {
+	    chars.push_back(ch);
+	    ends.push_back(valid ? end : (end | INVALID_UTF8));
+	    start = end;
+	    continue;
+	}
+	rows.resize(rows.size() - (m + 1));
+
+	// No term starting with term[0, end) can be within the edit distance.
+	// Work out how much further we can skip, bearing in mind that terms
+	// aren't necessarily valid UTF-8, but that a byte >= 0x80 always
+	// decodes to a character >= 0x80.
+	bool unsafe = !valid;
+	for (size_t d = chars.size(); !unsafe && d-- > 0; ) {
+	    size_t e = ends[d];
+	    if (e & INVALID_UTF8) {
+		unsafe = ((e & ~INVALID_UTF8) + 3 > start);
+	    } else if (e + 3 <= start) {
+		break;
+	    }
+	}
+	if (unsafe) {
+	    // Changing the bytes after an invalid byte can change how it
+	    // decodes, so just move on to the next term.
+	    next = term;
+	    next += '\0';
+	    return false;
+	}
+	next.assign(term, 0, start);
+	if (ch < 0x80) {
+	    unsigned viable = next_viable(ch);
+	    if (viable == 0) {
+		next_after_prefix(next);
+	    } else if (viable < 0x80) {
+		next += char(viable);
+	    } else {
+		next += '\x80';
+	    }
+	} else {
+	    if (next_viable(0x7f) != 0) next.assign(term, 0, end);
+	    next_after_prefix(next);
+	}
+	return false;
+    }
+    return true;
+}
@@ -24,6 +24,9 @@
 
 #include <cstdlib>
 #include <climits>
+#include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 #include "omassert.h"
@@ -100,6 +103,38 @@ class EditDistanceCalculator {
 
     static constexpr unsigned FREQS_MASK = sizeof(freqs_bitmap) * 8 - 1;
 
+    /// Type used for the bit-vectors in calc_bit_parallel().
+    typedef unsigned long long bitvec;
+
+    /// The longest target calc_bit_parallel() can handle.
+    static constexpr size_t BITVEC_BITS = sizeof(bitvec) * 8;
+
+    /** Positions of each codepoint < 256 in the target.
+     *
+     *  Bit i is set in entry ch if target[i] == ch.  Only filled in if the
+     *  target is short enough for calc_bit_parallel().
+     */
+    std::vector<bitvec> peq_low;
+
+    /// As peq_low, but for codepoints >= 256.
+    std::vector<std::pair<unsigned, bitvec>> peq_high;
+
+    /// Return the bit-vector of positions of @a ch in the target.
+    bitvec get_peq(unsigned ch) const {
+	if (ch < 256) return peq_low[ch];
+	for (auto&& entry : peq_high) {
+	    if (entry.first == ch) return entry.second;
+	}
+	return 0;
+    }
+
+    /** Calculate edit distance using a bit-parallel algorithm.
+     *
+     *  Only usable if the target is at most BITVEC_BITS long.
+     */
+    int calc_bit_parallel(const unsigned* ptr, int len,
+			  int max_distance) const;
+
     /** Calculate edit distance.
      *
      *  Internal helper - the cheap case is inlined from the header.
@@ -122,6 +157,24 @@ class EditDistanceCalculator {
 	    target_freqs2 |= (target_freqs & bit);
 	    target_freqs |= bit;
 	}
+	if (!target.empty() && target.size() <= BITVEC_BITS) {
+	    peq_low.resize(256);
+	    for (size_t i = 0; i != target.size(); ++i) {
+		unsigned ch = target[i];
+		bitvec bit = bitvec(1) << i;
+		if (ch < 256) {
+		    peq_low[ch] |= bit;
+		    continue;
+		}
+		auto j = peq_high.begin();
+		while (j != peq_high.end() && j->first != ch) ++j;
+		if (j == peq_high.end()) {
+		    peq_high.emplace_back(ch, bit);
+		} else {
+		    j->second |= bit;
+		}
+	    }
+	}
     }
 
     ~EditDistanceCalculator() {
@@ -187,4 +240,91 @@ class EditDistanceCalculator {
     }
 };
 
+/** Find terms which could be within an edit distance of a target.
+ *
+ *  This simulates a Levenshtein automaton (extended to handle transpositions
+ *  like EditDistanceCalculator does) using rows of the dynamic programming
+ *  matrix as the states.  Terms are fed in ascending order, and once the
+ *  prefix of a term can't be extended to anything within the edit distance
+ *  we work out the next term which might be so the caller can skip over
+ *  whole ranges of terms.
+ *
+ *  Terms which aren't ruled out may still be too far from the target, so
+ *  need to be checked with EditDistanceCalculator.
+ */
+class EditDistanceAutomaton {
+    /// Don't allow assignment.
+    EditDistanceAutomaton& operator=(const EditDistanceAutomaton&) = delete;
+
+    /// Don't allow copying.
+    EditDistanceAutomaton(const EditDistanceAutomaton&) = delete;
+
+    /// Target in UTF-32.
+    std::vector<unsigned> target;
+
+    /// The distinct characters in the target, in ascending order.
+    std::vector<unsigned> target_chars;
+
+    int max_distance;
+
+    /// The characters of the current term which we've processed.
+    std::vector<unsigned> chars;
+
+    /** Byte offset of the end of each character in chars.
+     *
+     *  The top bit is set if the character is invalid UTF-8, since how it
+     *  decodes can then depend on the bytes after it.
+     */
+    std::vector<size_t> ends;
+
+    /** The matrix rows after each character in chars.
+     *
+     *  Row i is the edit distance from the first i characters of the term
+     *  to each prefix of the target, and is stored at offset
+     *  i * (target.size() + 1).
+     */
+    std::vector<int> rows;
+
+    /// The previous term.
+    std::string last_term;
+
+    static constexpr size_t INVALID_UTF8 = size_t(1) << (sizeof(size_t) * 8 - 1);
+
+    /** Calculate the row after appending @a ch to the processed characters.
+     *
+     *  @param out	Where to store the row (must have space for
+     *			target.size() + 1 entries).
+     *
+     *  @return true if the resulting prefix could be extended to something
+     *		within the edit distance.
+     */
+    bool step(unsigned ch, int* out) const;
+
+    /** Find the smallest character > @a ch which step() would accept.
+     *
+     *  @return The character found, or 0 if there isn't one.
+     */
+    unsigned next_viable(unsigned ch) const;
+
+  public:
+    /** Constructor.
+     *
+     *  @param target_		Target string.
+     *  @param max_distance_	The edit distance to find terms within.
+     */
+    EditDistanceAutomaton(std::string_view target_, int max_distance_);
+
+    /** Check if a term could be within the edit distance.
+     *
+     *  @param term	The term to check, which must be greater than the
+     *			previous term passed.
+     *  @param[out] next	If false is returned, set to the next string to
+     *			consider, or to an empty string if no later term can
+     *			be within the edit distance.
+     *
+     *  @return false if @a term can't be within the edit distance.
+     */
+    bool check(const std::string& term, std::string& next);
+};
+
 #endif // XAPIAN_INCLUDED_EDITDISTANCE_H
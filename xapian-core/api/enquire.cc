@@ -165,7 +165,10 @@ void
 Enquire::set_collapse_key(valueno collapse_key, doccount collapse_max)
 {
     internal->collapse_key = collapse_key;
-    internal->collapse_max = collapse_max;
+    // Normalise so that the matcher can just check collapse_max to see if
+    // collapsing is enabled.
+    internal->collapse_max =
+	(collapse_key == BAD_VALUENO) ? 0 : collapse_max;
 }
 
 void
@@ -196,6 +199,12 @@ Enquire::set_time_limit(double time_limit)
     internal->time_limit = time_limit;
 }
 
+void
+Enquire::set_match_threads(unsigned n_threads)
+{
+    internal->match_threads = n_threads ? n_threads : 1;
+}
+
 MSet
 Enquire::get_mset(doccount first,
 		  doccount maxitems,
@@ -325,7 +334,8 @@ Enquire::Internal::get_mset(doccount first,
 			       sort_by,
 			       sort_val_reverse,
 			       time_limit,
-			       matchspies);
+			       matchspies,
+			       match_threads);
 
     if (first_orig != first) {
 	mset.internal->set_first(first_orig);
@@ -79,6 +79,8 @@ class Enquire::Internal : public Xapian::Internal::intrusive_base {
 
     double time_limit = 0.0;
 
+    unsigned match_threads = 1;
+
     enum { EXPAND_PROB, EXPAND_BO1 } eweight = EXPAND_PROB;
 
     double expand_k = 1.0;
@@ -113,6 +115,10 @@ class Enquire::Internal : public Xapian::Internal::intrusive_base {
     void request_document(docid did) const {
 	db.internal->request_document(did);
     }
+
+    void request_documents(const std::vector<docid>& dids) const {
+	db.internal->request_documents(dids);
+    }
 };
 
 }
@@ -41,6 +41,7 @@
 #include <string>
 #include <string_view>
 #include <unordered_set>
+#include <vector>
 
 using namespace std;
 
@@ -420,10 +421,12 @@ MSet::Internal::fetch(Xapian::doccount first_, Xapian::doccount last) const
 	last = items.size() - 1;
     }
     if (first_ <= last) {
-	Xapian::doccount n = last - first_;
-	for (Xapian::doccount i = 0; i <= n; ++i) {
-	    enquire->request_document(items[i].get_docid());
+	vector<Xapian::docid> dids;
+	dids.reserve(last - first_ + 1);
+	for (Xapian::doccount i = first_; i <= last; ++i) {
+	    dids.push_back(items[i].get_docid());
 	}
+	enquire->request_documents(dids);
     }
 }
 
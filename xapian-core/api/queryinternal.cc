@@ -29,7 +29,9 @@
 #include "xapian/unicode.h"
 
 #include "api/editdistance.h"
+#include "api/vectortermlist.h"
 #include "backends/postlist.h"
+#include "backends/wildcardindex.h"
 #include "heap.h"
 #include "matcher/andmaybepostlist.h"
 #include "matcher/andnotpostlist.h"
@@ -56,6 +58,7 @@
 #include "str.h"
 #include "stringutils.h"
 #include "unicode/description_append.h"
+#include "wordpairs.h"
 
 #include <algorithm>
 #include <limits>
@@ -224,8 +227,36 @@ Context::expand_wildcard(const QueryWildcard* query,
 			 double factor,
 			 TermFreqs* termfreqs)
 {
-    unique_ptr<TermList> t(qopt->db.open_allterms(query->get_fixed_prefix()));
-    bool skip_ucase = query->get_fixed_prefix().empty();
+    string prefix = query->get_fixed_prefix();
+    bool skip_ucase = prefix.empty();
+    unique_ptr<TermList> t;
+    const string& infix = query->get_infix();
+    vector<string> terms;
+    if (infix.size() >= WILDCARD_INDEX_MIN_LITERAL &&
+	infix.size() > prefix.size() &&
+	qopt->db.get_wildcard_candidates(infix, terms)) {
+	// The wildcard index doesn't find terms which only contain infix at
+	// the start.
+	unique_ptr<TermList> a(qopt->db.open_allterms(infix));
+	while (a->next() == NULL) {
+	    terms.push_back(a->get_termname());
+	}
+	// Filter out terms which can't match, and sort so we expand to the
+	// same terms in the same order as when checking every term (which
+	// matters for WILDCARD_LIMIT_FIRST).
+	auto cant_match = [&](const string& term) {
+	    if (skip_ucase) return term[0] >= 'A' && term[0] <= 'Z';
+	    return !startswith(term, prefix);
+	};
+	terms.erase(remove_if(terms.begin(), terms.end(), cant_match),
+		    terms.end());
+	sort(terms.begin(), terms.end());
+	terms.erase(unique(terms.begin(), terms.end()), terms.end());
+	t.reset(new VectorTermList(terms.begin(), terms.end()));
+	skip_ucase = false;
+    } else {
+	t.reset(qopt->db.open_allterms(prefix));
+    }
     auto max_type = query->get_max_type();
     Xapian::termcount expansions_left = query->get_max_expansion();
     // If there's no expansion limit, set expansions_left to the maximum
@@ -313,6 +344,9 @@ Context::expand_edit_distance(const QueryEditDistance* query,
     string pfx(query->get_pattern(), 0, query->get_fixed_prefix_len());
     unique_ptr<TermList> t(qopt->db.open_allterms(pfx));
     bool skip_ucase = pfx.empty();
+    EditDistanceAutomaton automaton(query->get_pattern(),
+				    query->get_threshold());
+    string next;
     auto max_type = query->get_max_type();
     Xapian::termcount expansions_left = query->get_max_expansion();
     // If there's no expansion limit, set expansions_left to the maximum
@@ -348,6 +382,13 @@ done_skip_to:
 	    }
 	}
 
+	if (!automaton.check(term, next)) {
+	    // Skip over terms which can't be within the edit distance.
+	    if (next.empty()) break;
+	    res = t->skip_to(next);
+	    goto done_skip_to;
+	}
+
 	if (!query->test(term)) continue;
 
 	if (max_type < Xapian::Query::WILDCARD_LIMIT_MOST_FREQUENT) {
@@ -1884,6 +1925,7 @@ default_case:
 		tail = i + 1;
 		if (!suffix.empty()) {
 		    min_check_len = 0;
+		    if (suffix.size() > infix.size()) infix = suffix;
 		    suffix.clear();
 		}
 		break;
@@ -1895,6 +1937,7 @@ default_case:
 		tail = i + 1;
 		if (!suffix.empty()) {
 		    min_check_len = 0;
+		    if (suffix.size() > infix.size()) infix = suffix;
 		    suffix.clear();
 		}
 		++qm_count;
@@ -1905,6 +1948,7 @@ default_case:
 
 	++i;
     }
+    if (suffix.size() > infix.size()) infix = suffix;
 
     if (had_star) {
 	max_len = numeric_limits<decltype(max_len)>::max();
@@ -2875,8 +2919,39 @@ QueryWindowed::postlist_windowed(Query::op op,
 	return false;
     }
 
+    // If every document in this shard has word pair terms, we can use them
+    // to find candidates for an exact phrase.
+    vector<string> pairs;
+    bool pairs_exact = false;
+    if (op == Query::OP_PHRASE && window == subqueries.size() &&
+	qopt->has_word_pairs()) {
+	pairs_exact = (subqueries.size() == 2);
+	string pair;
+	for (size_t j = 1; j != subqueries.size(); ++j) {
+	    auto a = subqueries[j - 1].internal.get();
+	    auto b = subqueries[j].internal.get();
+	    if (a->get_type() != Query::LEAF_TERM ||
+		b->get_type() != Query::LEAF_TERM) {
+		pairs_exact = false;
+		continue;
+	    }
+	    const string& a_term = static_cast<QueryTerm*>(a)->get_term();
+	    const string& b_term = static_cast<QueryTerm*>(b)->get_term();
+	    if (a_term.empty() || b_term.empty() ||
+		!make_word_pair(pair, a_term, b_term)) {
+		pairs_exact = false;
+		continue;
+	    }
+	    pairs.push_back(pair);
+	}
+	sort(pairs.begin(), pairs.end());
+	pairs.erase(unique(pairs.begin(), pairs.end()), pairs.end());
+    }
+
     bool old_need_positions = qopt->need_positions;
-    qopt->need_positions = true;
+    // If there are only two terms and we have their word pair term, then a
+    // document matches if it contains the word pair term.
+    qopt->need_positions = !pairs_exact;
 
     bool result = true;
     QueryVector::const_iterator i;
@@ -2903,11 +2978,22 @@ QueryWindowed::postlist_windowed(Query::op op,
 	    break;
 	}
     }
-    if (result) {
+    if (result && !pairs_exact) {
 	// Record the positional filter to apply higher up the tree.
 	ctx.add_pos_filter(op, subqueries.size(), window);
     }
 
+    if (result) {
+	// The word pair terms are added after the positional filter's
+	// subqueries.  They're unweighted and only used to filter.
+	qopt->need_positions = false;
+	for (const string& pair : pairs) {
+	    result = ctx.add_postlist(qopt->open_post_list(pair, 1, 0.0, NULL),
+				      NULL);
+	    if (!result) break;
+	}
+    }
+
     qopt->need_positions = old_need_positions;
     return result;
 }
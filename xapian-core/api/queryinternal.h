@@ -526,6 +526,12 @@ class QueryWildcard : public Query::Internal {
 
     std::string prefix, suffix;
 
+    /** The longest run of literal text after the fixed prefix.
+     *
+     *  Used to look up candidate terms in a wildcard index.
+     */
+    std::string infix;
+
     bool test_wildcard_(const std::string& candidate, size_t o, size_t p,
 			size_t i) const;
 
@@ -585,6 +591,9 @@ class QueryWildcard : public Query::Internal {
     /// Return the fixed prefix from the wildcard pattern.
     std::string get_fixed_prefix() const { return prefix; }
 
+    /// Return the longest run of literal text after the fixed prefix.
+    const std::string& get_infix() const { return infix; }
+
     std::string get_description() const;
 };
 
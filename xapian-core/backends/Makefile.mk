@@ -17,7 +17,8 @@ noinst_HEADERS +=\
 	backends/slowvaluelist.h\
 	backends/uuids.h\
 	backends/valuelist.h\
-	backends/valuestats.h
+	backends/valuestats.h\
+	backends/wildcardindex.h
 
 EXTRA_DIST +=\
 	backends/Makefile
@@ -35,7 +36,8 @@ lib_src +=\
 	backends/postlist.cc\
 	backends/slowvaluelist.cc\
 	backends/uuids.cc\
-	backends/valuelist.cc
+	backends/valuelist.cc\
+	backends/wildcardindex.cc
 
 if BUILD_BACKEND_REMOTE
 lib_src +=\
@@ -71,3 +73,4 @@ include backends/honey/Makefile.mk
 include backends/inmemory/Makefile.mk
 include backends/multi/Makefile.mk
 include backends/remote/Makefile.mk
+include backends/tiered/Makefile.mk
@@ -28,6 +28,7 @@ enum {
     BACKEND_INMEMORY = 1,
     BACKEND_GLASS = 2,
     BACKEND_HONEY = 3,
+    BACKEND_TIERED = 4,
     BACKEND_MAX_
 };
 
@@ -38,6 +39,7 @@ inline const char * backend_name(int code) {
 	"inmemory\0"
 	"glass\0\0\0\0"
 	"honey\0\0\0\0"
+	"tiered\0\0\0"
 	"?";
     return p + code * 9;
 }
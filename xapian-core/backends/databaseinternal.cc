@@ -36,6 +36,7 @@
 #include <memory>
 #include <string>
 #include <string_view>
+#include <vector>
 
 using namespace std;
 using Xapian::Internal::intrusive_ptr;
@@ -105,6 +106,11 @@ Database::Internal::commit()
     invalid_operation("WritableDatabase::commit() called with a read-only shard");
 }
 
+void
+Database::Internal::set_flush_memory_limit(size_t)
+{
+}
+
 void
 Database::Internal::cancel()
 {
@@ -178,6 +184,18 @@ Database::Internal::add_document(const Xapian::Document &)
 		      "read-only shard");
 }
 
+Xapian::docid
+Database::Internal::add_documents(const vector<Xapian::Document>& docs,
+				  unsigned)
+{
+    Xapian::docid first = 0;
+    for (auto&& doc : docs) {
+	Xapian::docid did = add_document(doc);
+	if (first == 0) first = did;
+    }
+    return first;
+}
+
 void
 Database::Internal::delete_document(Xapian::docid)
 {
@@ -285,6 +303,14 @@ Database::Internal::open_spelling_termlist(string_view) const
     return NULL;
 }
 
+bool
+Database::Internal::get_wildcard_candidates(string_view, vector<string>&) const
+{
+    // Only implemented for some database backends - others will just expand
+    // wildcards by checking every term.
+    return false;
+}
+
 TermList *
 Database::Internal::open_spelling_wordlist() const
 {
@@ -303,6 +329,17 @@ Database::Internal::get_spelling_frequency(string_view) const
     return 0;
 }
 
+void
+Database::Internal::get_spelling_frequencies(const vector<string>& words,
+					     vector<doccount>& freqs) const
+{
+    freqs.clear();
+    freqs.reserve(words.size());
+    for (auto&& word : words) {
+	freqs.push_back(get_spelling_frequency(word));
+    }
+}
+
 void
 Database::Internal::add_spelling(string_view, Xapian::termcount) const
 {
@@ -385,6 +422,14 @@ Database::Internal::request_document(Xapian::docid) const
 {
 }
 
+void
+Database::Internal::request_documents(const vector<Xapian::docid>& dids) const
+{
+    for (Xapian::docid did : dids) {
+	request_document(did);
+    }
+}
+
 void
 Database::Internal::write_changesets_to_fd(int, string_view, bool,
 					   ReplicationInfo*)
@@ -35,6 +35,7 @@
 
 #include <string>
 #include <string_view>
+#include <vector>
 
 typedef Xapian::TermIterator::Internal TermList;
 typedef Xapian::PositionIterator::Internal PositionList;
@@ -253,6 +254,21 @@ class Database::Internal : public Xapian::Internal::intrusive_base {
 
     virtual TermList* open_allterms(std::string_view prefix) const = 0;
 
+    /** Find terms containing @a literal using a wildcard index.
+     *
+     *  Terms which contain @a literal only at the start may not be found, so
+     *  the caller should find those using open_allterms().
+     *
+     *  @param literal	The text to look for (at least two bytes long).
+     *  @param terms	The terms found are appended to this, in no particular
+     *			order and possibly with duplicates.
+     *
+     *  @return false if there's no wildcard index (and the default
+     *		implementation always returns false).
+     */
+    virtual bool get_wildcard_candidates(std::string_view literal,
+					 std::vector<std::string>& terms) const;
+
     virtual PositionList* open_position_list(docid did,
 					     std::string_view term) const = 0;
 
@@ -290,6 +306,18 @@ class Database::Internal : public Xapian::Internal::intrusive_base {
     /** Return the number of times @a word was added as a spelling. */
     virtual doccount get_spelling_frequency(std::string_view word) const;
 
+    /** Look up the number of times each of several words was added as a
+     *  spelling.
+     *
+     *  @param words	The words to look up, in ascending byte order.
+     *  @param freqs	Set to the frequency of each entry in @a words.
+     *
+     *  The default implementation calls get_spelling_frequency() for each
+     *  word.
+     */
+    virtual void get_spelling_frequencies(const std::vector<std::string>& words,
+					  std::vector<doccount>& freqs) const;
+
     /** Add a word to the spelling dictionary.
      *
      *  If the word is already present, its frequency is increased.
@@ -384,6 +412,13 @@ class Database::Internal : public Xapian::Internal::intrusive_base {
     /** Cancel pending modifications to the database. */
     virtual void cancel();
 
+    /** Set memory limit for batched modifications.
+     *
+     *  The default implementation does nothing, which is suitable for
+     *  backends which don't batch modifications in memory.
+     */
+    virtual void set_flush_memory_limit(size_t limit);
+
     /** Begin transaction. */
     virtual void begin_transaction(bool flushed);
 
@@ -396,6 +431,17 @@ class Database::Internal : public Xapian::Internal::intrusive_base {
 
     virtual docid add_document(const Document& document);
 
+    /** Add several documents.
+     *
+     *  The default implementation calls add_document() for each document in
+     *  turn and ignores @a n_threads.
+     *
+     *  @return The docid of the first document added (or 0 if @a docs is
+     *	    empty).
+     */
+    virtual docid add_documents(const std::vector<Document>& docs,
+				unsigned n_threads);
+
     virtual void delete_document(docid did);
 
     /** Delete any documents indexed by a term from the database. */
@@ -425,6 +471,19 @@ class Database::Internal : public Xapian::Internal::intrusive_base {
      */
     virtual void request_document(docid did) const;
 
+    /** Request several documents.
+     *
+     *  This is like calling request_document() for each of @a dids in
+     *  turn, but allows the backend to batch up the work - for glass the
+     *  B-tree is descended for all the documents together so the reads
+     *  needed at each level are issued at the same time, rather than being
+     *  a chain of dependent reads for each document.
+     *
+     *  The default implementation calls request_document() for each
+     *  document.
+     */
+    virtual void request_documents(const std::vector<docid>& dids) const;
+
     /** Write a set of changesets to a file descriptor.
      *
      *  This call may reopen the database, leaving it pointing to a more
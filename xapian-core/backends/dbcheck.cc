@@ -39,6 +39,10 @@
 #include "honey/honey_version.h"
 #endif
 
+#ifdef XAPIAN_HAS_TIERED_BACKEND
+#include "tiered/tiered_database.h"
+#endif
+
 #include "backends.h"
 #include "databasehelpers.h"
 #include "filetests.h"
@@ -233,6 +237,30 @@ check_db_dir(string_view path, int opts, std::ostream *out)
 #endif
     }
 
+    filename.resize(path.size());
+    filename += "/iamtiered";
+    if (stat(filename.c_str(), &sb) == 0) {
+#ifndef XAPIAN_HAS_TIERED_BACKEND
+	(void)opts;
+	(void)out;
+	auto msg = "Tiered database support isn't enabled";
+	throw Xapian::FeatureUnavailableError(msg);
+#else
+	// Check each of the glass and honey databases it's made of.
+	TieredDatabase db(path, 0, true);
+	size_t errors = 0;
+	for (auto&& name : db.get_shard_names()) {
+	    filename.resize(path.size());
+	    filename += '/';
+	    filename += name;
+	    if (out)
+		*out << name << ":" << endl;
+	    errors += check_db_dir(filename, opts, out);
+	}
+	return errors;
+#endif
+    }
+
     filename.resize(path.size());
     filename += "/iamchert";
     if (stat(filename.c_str(), &sb) == 0) {
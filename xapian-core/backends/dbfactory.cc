@@ -46,6 +46,9 @@
 # include "honey/honey_database.h"
 #endif
 #include "honey/honey_defs.h"
+#ifdef XAPIAN_HAS_TIERED_BACKEND
+# include "tiered/tiered_database.h"
+#endif
 #ifdef XAPIAN_HAS_INMEMORY_BACKEND
 # include "inmemory/inmemory_database.h"
 #endif
@@ -53,31 +56,62 @@
 // Database::Internal.
 #include "backends/databaseinternal.h"
 
+#include <memory>
 #include <string>
 
 using namespace std;
 
 namespace Xapian {
 
+#ifdef XAPIAN_HAS_GLASS_BACKEND
+/// Open a glass database to read, taking account of @a flags.
+template<typename T>
+static GlassDatabase*
+open_glass(T path_or_fd, int flags)
+{
+    unique_ptr<GlassDatabase> db(new GlassDatabase(path_or_fd));
+    if (flags & DB_MMAP)
+	db->set_mmap();
+    return db.release();
+}
+#endif
+
+#ifdef XAPIAN_HAS_HONEY_BACKEND
+/// Open a honey database to read, taking account of @a flags.
+template<typename T>
+static HoneyDatabase*
+open_honey(T path_or_fd, int flags)
+{
+    unique_ptr<HoneyDatabase> db(new HoneyDatabase(path_or_fd));
+    if (flags & DB_MMAP)
+	db->set_mmap();
+    return db.release();
+}
+#endif
+
 static void
-open_stub(Database& db, string_view file)
+open_stub(Database& db, string_view file, int flags)
 {
+    // Flags which should be applied to the databases listed in the stub.
+    flags &= DB_MMAP;
     read_stub_file(file,
-		   [&db](string_view path) {
-		       db.add_database(Database(path));
+		   [&db, flags](string_view path) {
+		       db.add_database(Database(path, flags));
 		   },
-		   [&db](string_view path) {
+		   [&db, flags](string_view path) {
 #ifdef XAPIAN_HAS_GLASS_BACKEND
-		       db.add_database(Database(new GlassDatabase(path)));
+		       db.add_database(Database(open_glass(path, flags)));
 #else
 		       (void)path;
+		       (void)flags;
 #endif
 		   },
-		   [&db](string_view path) {
+		   [&db, flags](string_view path) {
 #ifdef XAPIAN_HAS_HONEY_BACKEND
-		       db.add_database(Database(new HoneyDatabase(path)));
+		       db.add_database(Database(open_honey(path, flags)));
 #else
 		       (void)path;
+		       (void)flags;
 #endif
 		   },
 		   [&db](string_view prog, string_view args) {
@@ -163,20 +197,20 @@ Database::Database(string_view path, int flags)
     switch (type) {
 	case DB_BACKEND_GLASS:
 #ifdef XAPIAN_HAS_GLASS_BACKEND
-	    internal = new GlassDatabase(path);
+	    internal = open_glass(path, flags);
 	    return;
 #else
 	    throw FeatureUnavailableError("Glass backend disabled");
 #endif
 	case DB_BACKEND_HONEY:
 #ifdef XAPIAN_HAS_HONEY_BACKEND
-	    internal = new HoneyDatabase(path);
+	    internal = open_honey(path, flags);
 	    return;
 #else
 	    throw FeatureUnavailableError("Honey backend disabled");
 #endif
 	case DB_BACKEND_STUB:
-	    open_stub(*this, path);
+	    open_stub(*this, path, flags);
 	    return;
 	case DB_BACKEND_INMEMORY:
 #ifdef XAPIAN_HAS_INMEMORY_BACKEND
@@ -184,6 +218,13 @@ Database::Database(string_view path, int flags)
 	    return;
 #else
 	    throw FeatureUnavailableError("Inmemory backend disabled");
+#endif
+	case DB_BACKEND_TIERED:
+#ifdef XAPIAN_HAS_TIERED_BACKEND
+	    internal = new TieredDatabase(path, flags, true);
+	    return;
+#else
+	    throw FeatureUnavailableError("Tiered backend disabled");
 #endif
     }
 
@@ -208,7 +249,7 @@ Database::Database(string_view path, int flags)
 	    case BACKEND_GLASS:
 #ifdef XAPIAN_HAS_GLASS_BACKEND
 		// Single file glass format.
-		internal = new GlassDatabase(fd);
+		internal = open_glass(fd, flags);
 		return;
 #else
 		throw FeatureUnavailableError("Glass backend disabled");
@@ -216,14 +257,14 @@ Database::Database(string_view path, int flags)
 	    case BACKEND_HONEY:
 #ifdef XAPIAN_HAS_HONEY_BACKEND
 		// Single file honey format.
-		internal = new HoneyDatabase(fd);
+		internal = open_honey(fd, flags);
 		return;
 #else
 		throw FeatureUnavailableError("Honey backend disabled");
 #endif
 	}
 
-	open_stub(*this, path);
+	open_stub(*this, path, flags);
 	return;
     }
 
@@ -235,7 +276,7 @@ Database::Database(string_view path, int flags)
 #ifdef XAPIAN_HAS_GLASS_BACKEND
     filename += "/iamglass";
     if (file_exists(filename)) {
-	internal = new GlassDatabase(path);
+	internal = open_glass(path, flags);
 	return;
     }
 #endif
@@ -244,7 +285,16 @@ Database::Database(string_view path, int flags)
     filename.resize(path.size());
     filename += "/iamhoney";
     if (file_exists(filename)) {
-	internal = new HoneyDatabase(path);
+	internal = open_honey(path, flags);
+	return;
+    }
+#endif
+
+#ifdef XAPIAN_HAS_TIERED_BACKEND
+    filename.resize(path.size());
+    filename += "/iamtiered";
+    if (file_exists(filename)) {
+	internal = new TieredDatabase(path, flags, true);
 	return;
     }
 #endif
@@ -253,7 +303,7 @@ Database::Database(string_view path, int flags)
     filename.resize(path.size());
     filename += "/XAPIANDB";
     if (usual(file_exists(filename))) {
-	open_stub(*this, filename);
+	open_stub(*this, filename, flags);
 	return;
     }
 
@@ -270,6 +320,13 @@ Database::Database(string_view path, int flags)
     if (file_exists(filename)) {
 	throw FeatureUnavailableError("Honey backend disabled");
     }
+#endif
+#ifndef XAPIAN_HAS_TIERED_BACKEND
+    filename.resize(path.size());
+    filename += "/iamtiered";
+    if (file_exists(filename)) {
+	throw FeatureUnavailableError("Tiered backend disabled");
+    }
 #endif
     filename.resize(path.size());
     filename += "/iamchert";
@@ -313,11 +370,11 @@ database_factory(int fd, int flags)
     switch (type) {
 #ifdef XAPIAN_HAS_GLASS_BACKEND
 	case DB_BACKEND_GLASS:
-	    return new GlassDatabase(fd);
+	    return open_glass(fd, flags);
 #endif
 #ifdef XAPIAN_HAS_HONEY_BACKEND
 	case DB_BACKEND_HONEY:
-	    return new HoneyDatabase(fd);
+	    return open_honey(fd, flags);
 #endif
     }
 #endif
@@ -387,6 +444,17 @@ WritableDatabase::WritableDatabase(std::string_view path,
 					    "updating existing databases");
 	    }
 
+	    filename.resize(path.size());
+	    filename += "/iamtiered";
+	    if (file_exists(filename)) {
+		// Existing tiered DB.
+#ifdef XAPIAN_HAS_TIERED_BACKEND
+		type = DB_BACKEND_TIERED;
+#else
+		throw FeatureUnavailableError("Tiered backend disabled");
+#endif
+	    }
+
 	    filename.resize(path.size());
 	    filename += "/iamchert";
 	    if (file_exists(filename)) {
@@ -426,6 +494,13 @@ WritableDatabase::WritableDatabase(std::string_view path,
 	case DB_BACKEND_HONEY:
 	    throw InvalidArgumentError("Honey backend doesn't support "
 				       "updating existing databases");
+	case DB_BACKEND_TIERED:
+#ifdef XAPIAN_HAS_TIERED_BACKEND
+	    internal = new TieredDatabase(path, flags, false);
+	    return;
+#else
+	    throw FeatureUnavailableError("Tiered backend disabled");
+#endif
 	case DB_BACKEND_INMEMORY:
 #ifdef XAPIAN_HAS_INMEMORY_BACKEND
 	    internal = new InMemoryDatabase();
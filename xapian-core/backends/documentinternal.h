@@ -252,6 +252,14 @@ class Document::Internal : public Xapian::Internal::intrusive_base {
      */
     Xapian::docid get_docid() const { return did; }
 
+    /** Get the database this document came from.
+     *
+     *  If this document didn't come from a database, this will be NULL.
+     */
+    const Xapian::Database::Internal* get_database() const {
+	return database.get();
+    }
+
     /// Internal method used by MSet::diversify().
     Xapian::doccount get_index() const { return index; }
 
@@ -0,0 +1,126 @@
+/** @file
+ * @brief Process-wide cache of blocks from read-only glass tables
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "glass_blockcache.h"
+
+#include "parseint.h"
+
+#include "xapian/error.h"
+
+#include <cstdlib>
+
+using namespace std;
+
+namespace Glass {
+
+size_t
+BlockCache::KeyHash::operator()(const Key& key) const
+{
+    // The UUID is the same for all blocks of a database so contributes
+    // nothing useful to distinguishing them - the inode and block number do
+    // the real work.
+    size_t h = size_t(key.n);
+    h = h * 1000003 ^ size_t(key.ino);
+    h = h * 1000003 ^ size_t(key.rev);
+    h = h * 1000003 ^ size_t(key.dev);
+    h = h * 1000003 ^ size_t(key.offset);
+    // Mix the high bits down, since the shard is picked using the low bits.
+    return h ^ (h >> 16);
+}
+
+void
+BlockCache::Shard::trim(size_t capacity)
+{
+    while (used > capacity) {
+	const Entry& victim = lru.back();
+	used -= victim.size;
+	index.erase(victim.key);
+	lru.pop_back();
+    }
+}
+
+BlockCache::BlockCache() : shard_capacity(0), hits(0), misses(0)
+{
+    const char* p = getenv("XAPIAN_BLOCK_CACHE_SIZE");
+    if (p && *p) {
+	size_t size;
+	if (!parse_unsigned(p, size)) {
+	    throw Xapian::InvalidArgumentError("XAPIAN_BLOCK_CACHE_SIZE must "
+					       "be a non-negative integer");
+	}
+	shard_capacity = size / NUM_SHARDS;
+    }
+}
+
+BlockCache&
+BlockCache::get()
+{
+    static BlockCache cache;
+    return cache;
+}
+
+BlockCache::Block
+BlockCache::find(const Key& key)
+{
+    Shard& shard = get_shard(key);
+    lock_guard<mutex> lock(shard.mutex);
+    auto i = shard.index.find(key);
+    if (i == shard.index.end()) {
+	++misses;
+	return Block();
+    }
+    ++hits;
+    // Move to the front of the LRU list.
+    shard.lru.splice(shard.lru.begin(), shard.lru, i->second);
+    return i->second->block;
+}
+
+void
+BlockCache::add(const Key& key, Block block, size_t size)
+{
+    size_t capacity = shard_capacity.load();
+    if (size > capacity) return;
+    Shard& shard = get_shard(key);
+    lock_guard<mutex> lock(shard.mutex);
+    auto i = shard.index.find(key);
+    if (i != shard.index.end()) {
+	// Another thread added this block since we looked for it.
+	return;
+    }
+    shard.lru.push_front(Entry{key, std::move(block), size});
+    shard.index.emplace(key, shard.lru.begin());
+    shard.used += size;
+    shard.trim(capacity);
+}
+
+void
+BlockCache::set_capacity(size_t size)
+{
+    size_t capacity = size / NUM_SHARDS;
+    shard_capacity = capacity;
+    for (auto& shard : shards) {
+	lock_guard<mutex> lock(shard.mutex);
+	shard.trim(capacity);
+    }
+}
+
+}
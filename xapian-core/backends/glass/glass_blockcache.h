@@ -0,0 +1,172 @@
+/** @file
+ * @brief Process-wide cache of blocks from read-only glass tables
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef XAPIAN_INCLUDED_GLASS_BLOCKCACHE_H
+#define XAPIAN_INCLUDED_GLASS_BLOCKCACHE_H
+
+#include "glass_defs.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include <sys/types.h>
+
+namespace Glass {
+
+/** Process-wide cache of blocks from read-only glass tables.
+ *
+ *  Blocks are shared between all Database objects in the process which are
+ *  open on the same table files, so many threads searching the same
+ *  database each with their own Database object only read and hold one copy
+ *  of each hot block.  Blocks are keyed on the identity of the file, the
+ *  revision being read and the block number - a block's contents are fixed
+ *  for a given revision, so there's no need for invalidation.
+ *
+ *  The cache is split into shards, each with its own lock and LRU list, to
+ *  reduce lock contention.  Its capacity defaults to the value of the
+ *  environment variable XAPIAN_BLOCK_CACHE_SIZE (in bytes), or 0 (which
+ *  disables the cache) if that isn't set.
+ */
+class BlockCache {
+  public:
+    /// Identifies a block of a particular revision of a table.
+    struct Key {
+	/// UUID of the database.
+	char uuid[16];
+
+	/// Device the table's file is on.
+	dev_t dev;
+
+	/// Inode of the table's file.
+	ino_t ino;
+
+	/// Offset of the database in the file (non-zero for single-file).
+	off_t offset;
+
+	/// Revision of the table being read.
+	glass_revision_number_t rev;
+
+	/// Block number.
+	uint4 n;
+
+	bool operator==(const Key& o) const {
+	    return n == o.n && rev == o.rev && ino == o.ino &&
+		   dev == o.dev && offset == o.offset &&
+		   std::memcmp(uuid, o.uuid, sizeof(uuid)) == 0;
+	}
+    };
+
+    /// Reference counted block, safe to share between threads.
+    typedef std::shared_ptr<const uint8_t> Block;
+
+  private:
+    struct KeyHash {
+	size_t operator()(const Key& key) const;
+    };
+
+    struct Entry {
+	Key key;
+
+	Block block;
+
+	size_t size;
+    };
+
+    /// One shard of the cache.
+    struct Shard {
+	std::mutex mutex;
+
+	/// Most recently used entries first.
+	std::list<Entry> lru;
+
+	std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+
+	/// Total size of the blocks in this shard.
+	size_t used = 0;
+
+	/// Evict least recently used entries until used <= capacity.
+	void trim(size_t capacity);
+    };
+
+    static constexpr unsigned NUM_SHARDS = 16;
+
+    Shard shards[NUM_SHARDS];
+
+    /// Capacity of each shard in bytes.
+    std::atomic<size_t> shard_capacity;
+
+    std::atomic<unsigned long long> hits, misses;
+
+    BlockCache();
+
+    /// Don't allow copying.
+    BlockCache(const BlockCache&) = delete;
+
+    /// Don't allow assignment.
+    BlockCache& operator=(const BlockCache&) = delete;
+
+    Shard& get_shard(const Key& key) {
+	return shards[KeyHash()(key) % NUM_SHARDS];
+    }
+
+  public:
+    /// Return the process-wide cache.
+    static BlockCache& get();
+
+    /// Is the cache enabled?
+    bool enabled() const { return shard_capacity.load() != 0; }
+
+    /** Look up a block.
+     *
+     *  @return The block, or NULL if it's not in the cache.
+     */
+    Block find(const Key& key);
+
+    /** Add a block.
+     *
+     *  @param key	The block's key.
+     *  @param block	The block.
+     *  @param size	The size of @a block in bytes.
+     */
+    void add(const Key& key, Block block, size_t size);
+
+    /** Set the capacity.
+     *
+     *  @param size	Capacity in bytes (0 disables the cache and discards
+     *			any cached blocks).
+     */
+    void set_capacity(size_t size);
+
+    /// Get the number of successful and unsuccessful lookups.
+    void get_stats(unsigned long long& hits_out,
+		   unsigned long long& misses_out) const {
+	hits_out = hits.load();
+	misses_out = misses.load();
+    }
+};
+
+}
+
+#endif // XAPIAN_INCLUDED_GLASS_BLOCKCACHE_H
@@ -26,8 +26,10 @@
 #include "xapian/types.h"
 
 #include <algorithm>
+#include <functional>
 #include <iterator>
 #include <memory>
+#include <mutex>
 #include <queue>
 
 #include <cerrno>
@@ -42,12 +44,16 @@
 #include "internaltypes.h"
 #include "pack.h"
 #include "backends/valuestats.h"
+#include "backends/wildcardindex.h"
+#include "runtasks.h"
 
 #include "../byte_length_strings.h"
 #include "../prefix_compressed_strings.h"
 
 using namespace std;
 
+typedef WildcardKeys<GlassTable, GlassCursor> GlassWildcardKeys;
+
 // Put all the helpers in a namespace to avoid symbols colliding with those of
 // the same name in other flint-derived backends.
 namespace GlassCompact {
@@ -70,6 +76,12 @@ is_valuechunk_key(const string & key)
     return key.size() > 1 && key[0] == '\0' && key[1] == '\xd8';
 }
 
+static inline bool
+is_wildcard_index_key(const string & key)
+{
+    return key.size() > 1 && key[0] == '\0' && key[1] == '\xdc';
+}
+
 static inline bool
 is_doclenchunk_key(const string & key)
 {
@@ -79,20 +91,33 @@ is_doclenchunk_key(const string & key)
 class PostlistCursor : private GlassCursor {
     Xapian::docid offset;
 
+    /// End of the range of keys to iterate (empty for no limit).
+    string hi;
+
   public:
     string key, tag;
     Xapian::docid firstdid;
     Xapian::termcount tf, cf;
 
-    PostlistCursor(const GlassTable *in, Xapian::docid offset_)
-	: GlassCursor(in), offset(offset_), firstdid(0)
+    /** Iterate entries with keys in the range [lo, hi).
+     *
+     *  An empty @a lo means from the start and an empty @a hi means to the
+     *  end.
+     */
+    PostlistCursor(const GlassTable *in, Xapian::docid offset_,
+		   const string& lo, const string& hi_)
+	: GlassCursor(in), offset(offset_), hi(hi_), firstdid(0)
     {
-	rewind();
-	next();
+	if (lo.empty()) {
+	    rewind();
+	} else {
+	    find_entry_lt(lo);
+	}
     }
 
     bool next() {
 	if (!GlassCursor::next()) return false;
+	if (!hi.empty() && current_key >= hi) return false;
 	// We put all chunks into the non-initial chunk form here, then fix up
 	// the first chunk for each term in the merged database as we merge.
 	read_tag();
@@ -101,6 +126,7 @@ class PostlistCursor : private GlassCursor {
 	tf = cf = 0;
 	if (is_user_metadata_key(key)) return true;
 	if (is_valuestats_key(key)) return true;
+	if (is_wildcard_index_key(key)) return true;
 	if (is_valuechunk_key(key)) {
 	    const char * p = key.data();
 	    const char * end = p + key.length();
@@ -184,11 +210,24 @@ encode_valuestats(Xapian::doccount freq,
     return value;
 }
 
+/** Merge postlist tables.
+ *
+ *  If @a lo or @a hi are non-empty, only entries with keys in the range
+ *  [lo, hi) are merged.  These must be keys for the first chunk of a term
+ *  so that all the chunks for a term are in the same range.
+ *
+ *  @param wildcard_keys	NULL if the output shouldn't have a wildcard
+ *				index, otherwise wildcard index keys to add to
+ *				those from the inputs.
+ */
 static void
 merge_postlists(Xapian::Compactor * compactor,
 		GlassTable * out, vector<Xapian::docid>::const_iterator offset,
 		vector<const GlassTable*>::const_iterator b,
-		vector<const GlassTable*>::const_iterator e)
+		vector<const GlassTable*>::const_iterator e,
+		GlassWildcardKeys* wildcard_keys,
+		const string& lo = string(),
+		const string& hi = string())
 {
     priority_queue<PostlistCursor *, vector<PostlistCursor *>, PostlistCursorGt> pq;
     for ( ; b != e; ++b, ++offset) {
@@ -198,7 +237,13 @@ merge_postlists(Xapian::Compactor * compactor,
 	    continue;
 	}
 
-	pq.push(new PostlistCursor(in, *offset));
+	auto cursor = new PostlistCursor(in, *offset, lo, hi);
+	if (cursor->next()) {
+	    pq.push(cursor);
+	} else {
+	    // Nothing in the range.
+	    delete cursor;
+	}
     }
 
     string last_key;
@@ -335,6 +380,36 @@ merge_postlists(Xapian::Compactor * compactor,
 	}
     }
 
+    {
+	// Merge the wildcard index entries, dropping duplicates (or all of
+	// them if the output won't have a wildcard index).
+	while (true) {
+	    PostlistCursor * cur = NULL;
+	    if (!pq.empty() && is_wildcard_index_key(pq.top()->key))
+		cur = pq.top();
+	    const string* w = wildcard_keys ? wildcard_keys->get() : NULL;
+	    string key;
+	    if (cur && (!w || cur->key <= *w)) {
+		key = cur->key;
+		pq.pop();
+		if (cur->next()) {
+		    pq.push(cur);
+		} else {
+		    delete cur;
+		}
+	    } else if (w) {
+		key = *w;
+		wildcard_keys->next();
+	    } else {
+		break;
+	    }
+	    if (wildcard_keys && key != last_key) {
+		out->add(key, WILDCARD_INDEX_TAG);
+		last_key = key;
+	    }
+	}
+    }
+
     Xapian::termcount tf = 0, cf = 0; // Initialise to avoid warnings.
     vector<pair<Xapian::docid, string>> tags;
     while (true) {
@@ -597,8 +672,14 @@ static void
 multimerge_postlists(Xapian::Compactor * compactor,
 		     GlassTable * out, const char * tmpdir,
 		     vector<const GlassTable *> tmp,
-		     vector<Xapian::docid> off)
+		     vector<Xapian::docid> off,
+		     GlassWildcardKeys* wildcard_keys)
 {
+    // Keep any wildcard index entries from the inputs in the temporary tables
+    // if the output needs them, but only add wildcard_keys in the final pass.
+    GlassWildcardKeys no_keys;
+    no_keys.start();
+    GlassWildcardKeys* tmp_wildcard_keys = wildcard_keys ? &no_keys : NULL;
     unsigned int c = 0;
     while (tmp.size() > 3) {
 	vector<const GlassTable *> tmpout;
@@ -628,7 +709,8 @@ multimerge_postlists(Xapian::Compactor * compactor,
 	    tmptab->create_and_open(flags, root_info);
 
 	    merge_postlists(compactor, tmptab, off.begin() + i,
-			    tmp.begin() + i, tmp.begin() + j);
+			    tmp.begin() + i, tmp.begin() + j,
+			    tmp_wildcard_keys);
 	    if (c > 0) {
 		for (unsigned int k = i; k < j; ++k) {
 		    unlink(tmp[k]->get_path().c_str());
@@ -645,7 +727,8 @@ multimerge_postlists(Xapian::Compactor * compactor,
 	swap(off, newoff);
 	++c;
     }
-    merge_postlists(compactor, out, off.begin(), tmp.begin(), tmp.end());
+    merge_postlists(compactor, out, off.begin(), tmp.begin(), tmp.end(),
+		    wildcard_keys);
     if (c > 0) {
 	for (size_t k = 0; k < tmp.size(); ++k) {
 	    unlink(tmp[k]->get_path().c_str());
@@ -655,6 +738,59 @@ multimerge_postlists(Xapian::Compactor * compactor,
     }
 }
 
+/** Pick keys to split merging the postlist tables into @a n ranges.
+ *
+ *  The keys are picked so that each range holds a similar number of entries
+ *  in total across the inputs, based on the branch keys near the root of
+ *  each input table.
+ *
+ *  @return Up to (n - 1) keys in ascending order.  Each is the key of the
+ *	    first chunk of a term.
+ */
+static vector<string>
+postlist_split_keys(const vector<const GlassTable*>& inputs, unsigned n)
+{
+    // Candidate keys, each with an estimate of the number of entries in its
+    // input between it and the previous candidate from the same input.
+    vector<pair<string, double>> samples;
+    double total = 0;
+    for (auto in : inputs) {
+	vector<string> keys;
+	// Get more keys than we need so that we can divide more evenly.
+	in->get_split_keys(n * 4, keys);
+	if (keys.empty()) continue;
+	double entries = in->get_entry_count();
+	total += entries;
+	double weight = entries / (keys.size() + 1);
+	for (const string& key : keys) {
+	    // User metadata, value statistics, value chunks, the wildcard
+	    // index and document length chunks have keys starting with a zero
+	    // byte (as do terms starting with a zero byte) so these always go
+	    // in the first range.
+	    if (key[0] == '\0') continue;
+	    const char* p = key.data();
+	    const char* end = p + key.size();
+	    string term;
+	    (void)unpack_string_preserving_sort(&p, end, term);
+	    samples.emplace_back(pack_glass_postlist_key(term), weight);
+	}
+    }
+
+    sort(samples.begin(), samples.end());
+    vector<string> splits;
+    double entries_before = 0;
+    unsigned next = 1;
+    for (auto&& sample : samples) {
+	entries_before += sample.second;
+	if (entries_before < total * next / n) continue;
+	if (splits.empty() || sample.first != splits.back())
+	    splits.push_back(sample.first);
+	while (next < n && entries_before >= total * next / n) ++next;
+	if (next == n) break;
+    }
+    return splits;
+}
+
 class PositionCursor : private GlassCursor {
     Xapian::docid offset;
 
@@ -861,6 +997,57 @@ GlassDatabase::compact(Xapian::Compactor * compactor,
 	version_file_out->merge_stats(db->version_file);
     }
 
+    // The output has a wildcard index if requested or if all the inputs have
+    // one.  We need to generate the entries for any inputs without one.
+    unique_ptr<GlassWildcardKeys> wildcard_keys;
+    {
+	vector<const GlassDatabase*> unindexed;
+	for (auto src : sources) {
+	    auto db = static_cast<const GlassDatabase*>(src);
+	    if (!db->postlist_table.has_wildcard_index())
+		unindexed.push_back(db);
+	}
+	if ((flags & Xapian::DBCOMPACT_WILDCARD_INDEX) ||
+	    (unindexed.empty() && !sources.empty())) {
+	    // Sorted runs of keys which don't fit in memory are written to
+	    // temporary tables.
+	    //
+	    // FIXME: For a single file output we've nowhere to put temporary
+	    // tables (as for multipass) so keep all the keys in memory.
+	    auto new_run = [&](unsigned n) {
+		string dest = destdir;
+		dest += "/tmpwildcard";
+		dest += str(n);
+		dest += '.';
+		GlassTable* tmptab = new GlassTable("postlist", dest, false);
+		RootInfo root_info;
+		root_info.init(65536, 0);
+		const int tmp_flags = Xapian::DB_DANGEROUS|Xapian::DB_NO_SYNC;
+		tmptab->create_and_open(tmp_flags, root_info);
+		return tmptab;
+	    };
+	    auto end_run = [](GlassTable* tmptab) {
+		RootInfo root_info;
+		tmptab->flush_db();
+		tmptab->commit(1, &root_info);
+	    };
+	    if (single_file) {
+		wildcard_keys.reset(new GlassWildcardKeys);
+	    } else {
+		wildcard_keys.reset(new GlassWildcardKeys(new_run, end_run));
+	    }
+	    string_view prefix(GLASS_WILDCARD_INDEX_PREFIX, 2);
+	    wildcard_keys->add(string(prefix));
+	    for (auto db : unindexed) {
+		wildcard_index_add_terms(*db, prefix,
+					 [&](const string& key) {
+					     wildcard_keys->add(key);
+					 });
+	    }
+	    wildcard_keys->start();
+	}
+    }
+
     string fl_serialised;
     if (single_file) {
 	GlassFreeList fl;
@@ -868,27 +1055,25 @@ GlassDatabase::compact(Xapian::Compactor * compactor,
 	fl.pack(fl_serialised);
     }
 
-    vector<GlassTable *> tabs;
-    tabs.reserve(tables_end - tables);
-    file_size_type prev_size = block_size;
-    for (const table_list * t = tables; t < tables_end; ++t) {
-	// The postlist table requires an N-way merge, adjusting the
-	// headers of various blocks.  The spelling and synonym tables also
-	// need special handling.  The other tables have keys sorted in
-	// docid order, so we can merge them by simply copying all the keys
-	// from each source table in turn.
-	if (compactor)
-	    compactor->set_status(t->name, string());
+    unsigned n_threads = compactor ? compactor->get_threads() : 0;
+    if (single_file) {
+	// The tables are written one after another to the same file.
+	n_threads = 1;
+    }
+
+    struct table_job {
+	const table_list* t;
 
+	// Path of the output table (empty for single file output).
 	string dest;
-	if (!single_file) {
-	    dest = destdir;
-	    dest += '/';
-	    dest += t->name;
-	    dest += '.';
-	}
 
-	bool output_will_exist = !t->lazy;
+	vector<const GlassTable*> inputs;
+
+	GlassTable* out = nullptr;
+
+	RootInfo* root_info = nullptr;
+
+	file_size_type in_size = 0;
 
 	// Sometimes stat can fail for benign reasons (e.g. >= 2GB file
 	// on certain systems).
@@ -898,9 +1083,28 @@ GlassDatabase::compact(Xapian::Compactor * compactor,
 	// amongst the inputs.
 	bool single_file_in = false;
 
-	file_size_type in_size = 0;
+	// If there's no output table, the status to report.
+	string skip_status;
+    };
 
-	vector<const GlassTable*> inputs;
+    vector<unique_ptr<GlassTable>> tabs;
+    tabs.reserve(tables_end - tables);
+    file_size_type prev_size = block_size;
+
+    // Find the inputs for a table and create the output table, or return
+    // false if there's no output table.
+    auto prepare = [&](table_job& job) {
+	const table_list* t = job.t;
+	if (!single_file) {
+	    job.dest = destdir;
+	    job.dest += '/';
+	    job.dest += t->name;
+	    job.dest += '.';
+	}
+
+	bool output_will_exist = !t->lazy;
+
+	auto& inputs = job.inputs;
 	inputs.reserve(sources.size());
 	size_t inputs_present = 0;
 	for (auto src : sources) {
@@ -927,7 +1131,7 @@ GlassDatabase::compact(Xapian::Compactor * compactor,
 		    break;
 		default:
 		    Assert(false);
-		    return;
+		    return false;
 	    }
 
 	    if (db->single_file()) {
@@ -936,19 +1140,19 @@ GlassDatabase::compact(Xapian::Compactor * compactor,
 		} else {
 		    // FIXME: Find actual size somehow?
 		    // in_size += table->size() / 1024;
-		    single_file_in = true;
+		    job.single_file_in = true;
 		    output_will_exist = true;
 		    ++inputs_present;
 		}
 	    } else {
 		auto db_size = file_size(table->get_path());
 		if (errno == 0) {
-		    in_size += db_size / 1024;
+		    job.in_size += db_size / 1024;
 		    output_will_exist = true;
 		    ++inputs_present;
 		} else if (errno != ENOENT) {
 		    // We get ENOENT for an optional table.
-		    bad_stat = true;
+		    job.bad_stat = true;
 		    output_will_exist = true;
 		    ++inputs_present;
 		}
@@ -959,22 +1163,18 @@ GlassDatabase::compact(Xapian::Compactor * compactor,
 	// If any inputs lack a termlist table, suppress it in the output.
 	if (t->type == Glass::TERMLIST && inputs_present != sources.size()) {
 	    if (inputs_present != 0) {
-		if (compactor) {
-		    string m = str(inputs_present);
-		    m += " of ";
-		    m += str(sources.size());
-		    m += " inputs present, so suppressing output";
-		    compactor->set_status(t->name, m);
-		}
-		continue;
+		job.skip_status = str(inputs_present);
+		job.skip_status += " of ";
+		job.skip_status += str(sources.size());
+		job.skip_status += " inputs present, so suppressing output";
+		return false;
 	    }
 	    output_will_exist = false;
 	}
 
 	if (!output_will_exist) {
-	    if (compactor)
-		compactor->set_status(t->name, "doesn't exist");
-	    continue;
+	    job.skip_status = "doesn't exist";
+	    return false;
 	}
 
 	GlassTable * out;
@@ -982,10 +1182,12 @@ GlassDatabase::compact(Xapian::Compactor * compactor,
 	    out = new GlassTable(t->name, fd, version_file_out->get_offset(),
 				 false, false);
 	} else {
-	    out = new GlassTable(t->name, dest, false, t->lazy);
+	    out = new GlassTable(t->name, job.dest, false, t->lazy);
 	}
-	tabs.push_back(out);
+	tabs.emplace_back(out);
+	job.out = out;
 	RootInfo * root_info = version_file_out->root_to_set(t->type);
+	job.root_info = root_info;
 	if (single_file) {
 	    root_info->set_free_list(fl_serialised);
 	    out->open(FLAGS, version_file_out->get_root(t->type), version_file_out->get_revision());
@@ -994,15 +1196,26 @@ GlassDatabase::compact(Xapian::Compactor * compactor,
 	}
 
 	out->set_full_compaction(compaction != compactor->STANDARD);
+	return true;
+    };
 
-	switch (t->type) {
+    // The postlist table requires an N-way merge, adjusting the headers of
+    // various blocks.  The spelling and synonym tables also need special
+    // handling.  The other tables have keys sorted in docid order, so we can
+    // merge them by simply copying all the keys from each source table in
+    // turn.
+    auto merge = [&](table_job& job) {
+	GlassTable* out = job.out;
+	const auto& inputs = job.inputs;
+	switch (job.t->type) {
 	    case Glass::POSTLIST: {
 		if (multipass && inputs.size() > 3) {
 		    multimerge_postlists(compactor, out, destdir,
-					 inputs, offset);
+					 inputs, offset, wildcard_keys.get());
 		} else {
 		    merge_postlists(compactor, out, offset.begin(),
-				    inputs.begin(), inputs.end());
+				    inputs.begin(), inputs.end(),
+				    wildcard_keys.get());
 		}
 		break;
 	    }
@@ -1020,22 +1233,35 @@ GlassDatabase::compact(Xapian::Compactor * compactor,
 		merge_docid_keyed(out, inputs, offset);
 		break;
 	}
+    };
 
+    auto commit = [&](table_job& job) {
+	GlassTable* out = job.out;
 	if (out->is_modified()) {
 	    // Commit as revision 1.
 	    out->flush_db();
-	    out->commit(1, root_info);
+	    out->commit(1, job.root_info);
 	    out->sync();
 	}
-	if (single_file) fl_serialised = root_info->get_free_list();
+	if (single_file) fl_serialised = job.root_info->get_free_list();
+    };
+
+    auto report = [&](const table_job& job) {
+	const table_list* t = job.t;
+	if (!job.out) {
+	    if (compactor)
+		compactor->set_status(t->name, job.skip_status);
+	    return;
+	}
 
+	bool bad_stat = job.bad_stat;
 	file_size_type out_size = 0;
-	if (!bad_stat && !single_file_in) {
+	if (!bad_stat && !job.single_file_in) {
 	    file_size_type db_size;
 	    if (single_file) {
 		db_size = file_size(fd);
 	    } else {
-		db_size = file_size(dest + GLASS_TABLE_EXTENSION);
+		db_size = file_size(job.dest + GLASS_TABLE_EXTENSION);
 	    }
 	    if (errno == 0) {
 		if (single_file) {
@@ -1053,10 +1279,11 @@ GlassDatabase::compact(Xapian::Compactor * compactor,
 	if (bad_stat) {
 	    if (compactor)
 		compactor->set_status(t->name, "Done (couldn't stat all the DB files)");
-	} else if (single_file_in) {
+	} else if (job.single_file_in) {
 	    if (compactor)
 		compactor->set_status(t->name, "Done (table sizes unknown for single file DB input)");
 	} else {
+	    file_size_type in_size = job.in_size;
 	    string status;
 	    if (out_size == in_size) {
 		status = "Size unchanged (";
@@ -1083,6 +1310,149 @@ GlassDatabase::compact(Xapian::Compactor * compactor,
 	    if (compactor)
 		compactor->set_status(t->name, status);
 	}
+    };
+
+    vector<table_job> jobs(tables_end - tables);
+    for (size_t i = 0; i != jobs.size(); ++i) {
+	jobs[i].t = tables + i;
+    }
+
+    if (n_threads <= 1) {
+	for (auto&& job : jobs) {
+	    if (compactor)
+		compactor->set_status(job.t->name, string());
+	    if (prepare(job)) {
+		merge(job);
+		commit(job);
+	    }
+	    report(job);
+	}
+    } else {
+	// Report on each table as it is finished.  The tables finish in
+	// different threads, so make sure only one reports at once.
+	mutex status_mutex;
+	auto done = [&](const table_job& job) {
+	    lock_guard<mutex> status_lock(status_mutex);
+	    if (compactor)
+		compactor->set_status(job.t->name, string());
+	    report(job);
+	};
+
+	// Merge the tables concurrently, and split merging the postlist table
+	// into ranges of terms.  The first range is merged directly into the
+	// output table, and the others into temporary tables which are copied
+	// onto the end once all the merging is done.
+	vector<function<void()>> tasks;
+	table_job* postlist_job = nullptr;
+	vector<string> splits;
+	// Remove any temporary tables we don't get to copy from (e.g. if an
+	// exception is thrown).
+	struct RangeTables : public vector<unique_ptr<GlassTable>> {
+	    ~RangeTables() {
+		for (auto&& tmptab : *this) {
+		    if (tmptab) unlink(tmptab->get_path().c_str());
+		}
+	    }
+	} range_tabs;
+	vector<RootInfo> range_root_infos;
+	vector<unique_ptr<GlassTable>> range_inputs_owned;
+	vector<vector<const GlassTable*>> range_inputs;
+	for (auto&& job : jobs) {
+	    if (!prepare(job)) {
+		done(job);
+		continue;
+	    }
+	    if (job.t->type != Glass::POSTLIST ||
+		(multipass && job.inputs.size() > 3)) {
+		tasks.emplace_back([&]() {
+		    merge(job);
+		    commit(job);
+		    done(job);
+		});
+		continue;
+	    }
+
+	    postlist_job = &job;
+	    splits = postlist_split_keys(job.inputs, n_threads);
+	    tasks.emplace_back([&]() {
+		merge_postlists(compactor, job.out, offset.begin(),
+				job.inputs.begin(), job.inputs.end(),
+				wildcard_keys.get(),
+				string(), splits.empty() ? string() : splits[0]);
+	    });
+
+	    // A GlassTable object can't be used by more than one thread at
+	    // once, so each range after the first reads its own copy of each
+	    // input table.
+	    range_tabs.resize(splits.size());
+	    range_root_infos.resize(splits.size());
+	    range_inputs.resize(splits.size());
+	    for (size_t r = 0; r != splits.size(); ++r) {
+		for (auto src : sources) {
+		    auto db = static_cast<const GlassDatabase*>(src);
+		    GlassTable* in;
+		    if (db->single_file()) {
+			in = new GlassTable("postlist",
+					    db->version_file.get_fd(),
+					    db->version_file.get_offset(),
+					    true);
+		    } else {
+			in = new GlassTable("postlist",
+					    db->db_dir + "/postlist.",
+					    true);
+		    }
+		    range_inputs_owned.emplace_back(in);
+		    in->open(db->postlist_table.get_flags(),
+			     db->version_file.get_root(Glass::POSTLIST),
+			     db->version_file.get_revision());
+		    range_inputs[r].push_back(in);
+		}
+
+		string dest = destdir;
+		dest += "/tmprange";
+		dest += str(r + 1);
+		dest += '.';
+		GlassTable* tmptab = new GlassTable("postlist", dest, false);
+		range_tabs[r].reset(tmptab);
+
+		// Use maximum blocksize for temporary tables.  And don't
+		// compress entries in temporary tables, even if the final table
+		// would do so.
+		RootInfo& root_info = range_root_infos[r];
+		root_info.init(65536, 0);
+		tmptab->create_and_open(Xapian::DB_DANGEROUS|Xapian::DB_NO_SYNC,
+					root_info);
+
+		tasks.emplace_back([&, r, tmptab]() {
+		    const auto& inputs = range_inputs[r];
+		    merge_postlists(compactor, tmptab, offset.begin(),
+				    inputs.begin(), inputs.end(),
+				    NULL,
+				    splits[r],
+				    r + 1 < splits.size() ? splits[r + 1] : string());
+		    tmptab->flush_db();
+		    tmptab->commit(1, &range_root_infos[r]);
+		});
+	    }
+	}
+
+	run_tasks(tasks, n_threads);
+
+	if (postlist_job) {
+	    GlassTable* out = postlist_job->out;
+	    for (auto&& tmptab : range_tabs) {
+		GlassCursor cur(tmptab.get());
+		cur.rewind();
+		while (cur.next()) {
+		    bool compressed = cur.read_tag(true);
+		    out->add(cur.current_key, cur.current_tag, compressed);
+		}
+		unlink(tmptab->get_path().c_str());
+		tmptab.reset();
+	    }
+	    commit(*postlist_job);
+	    done(*postlist_job);
+	}
     }
 
     // If compacting to a single file output and all the tables are empty, pad
@@ -1113,9 +1483,7 @@ GlassDatabase::compact(Xapian::Compactor * compactor,
     }
     // Commit with revision 1.
     version_file_out->sync(tmpfile, 1, FLAGS);
-    for (unsigned j = 0; j != tabs.size(); ++j) {
-	delete tabs[j];
-    }
+    tabs.clear();
 
     if (!single_file) lock.release();
 }
@@ -25,12 +25,15 @@
 #include "glass_defs.h"
 
 #include "alignment_cast.h"
+#include "io_utils.h"
 #include "omassert.h"
 
 #include <algorithm>
 #include <cstring>
+#include <memory>
 #include <string>
 #include <string_view>
+#include <utility>
 
 using std::string;
 
@@ -38,6 +41,30 @@ using std::string;
 
 namespace Glass {
 
+/** A read-only memory mapping of a table's file.
+ *
+ *  Cursors pointing at blocks in the mapping hold a reference to it, so it
+ *  remains valid if the table is reopened or closed.
+ */
+class MappedFile {
+    /// Don't allow copying.
+    MappedFile(const MappedFile&) = delete;
+
+    /// Don't allow assignment.
+    MappedFile& operator=(const MappedFile&) = delete;
+
+  public:
+    /// Start of the mapping (offset 0 in the file).
+    const char* base;
+
+    /// Length of the mapping in bytes.
+    size_t size;
+
+    MappedFile(const char* base_, size_t size_) : base(base_), size(size_) { }
+
+    ~MappedFile() { io_munmap(base, size); }
+};
+
 class Cursor {
     // Prevent copying
     Cursor(const Cursor &);
@@ -46,6 +73,21 @@ class Cursor {
     /// Pointer to reference counted data.
     char * data;
 
+    /** Owner of the current block if it's shared read-only storage.
+     *
+     *  If non-NULL, the current block is at shared_p rather than in data,
+     *  and is owned by this object (a MappedFile or an entry in the block
+     *  cache) which may be shared with other cursors, including in other
+     *  threads.
+     */
+    std::shared_ptr<const void> owner;
+
+    /// Pointer to the current block if owner is set.
+    const uint8_t* shared_p = NULL;
+
+    /// The number of the current block if owner is set.
+    uint4 shared_n = BLK_UNUSED;
+
   public:
     /// Constructor.
     Cursor() : data(0), c(-1), rewrite(false) { }
@@ -53,6 +95,7 @@ class Cursor {
     ~Cursor() { destroy(); }
 
     uint8_t * init(unsigned block_size) {
+	owner.reset();
 	if (data && refs() > 1) {
 	    --refs();
 	    data = NULL;
@@ -66,7 +109,31 @@ class Cursor {
 	return reinterpret_cast<uint8_t*>(data + 8);
     }
 
+    /** Point at block @a n at @a p which is owned by @a o.
+     *
+     *  The block is used in place rather than copied, so it must not be
+     *  modified.
+     */
+    const uint8_t * set_shared(std::shared_ptr<const void> o, uint4 n,
+			       const uint8_t* p) {
+	destroy();
+	owner = std::move(o);
+	shared_p = p;
+	shared_n = n;
+	rewrite = false;
+	c = -1;
+	return p;
+    }
+
     const uint8_t * clone(const Cursor & o) {
+	if (o.owner) {
+	    destroy();
+	    owner = o.owner;
+	    shared_p = o.shared_p;
+	    shared_n = o.shared_n;
+	    return shared_p;
+	}
+	owner.reset();
 	if (data != o.data) {
 	    destroy();
 	    data = o.data;
@@ -77,11 +144,15 @@ class Cursor {
 
     void swap(Cursor & o) {
 	std::swap(data, o.data);
+	std::swap(owner, o.owner);
+	std::swap(shared_p, o.shared_p);
+	std::swap(shared_n, o.shared_n);
 	std::swap(c, o.c);
 	std::swap(rewrite, o.rewrite);
     }
 
     void destroy() {
+	owner.reset();
 	if (data) {
 	    if (--refs() == 0)
 		delete [] data;
@@ -100,11 +171,16 @@ class Cursor {
      *  Returns BLK_UNUSED if no block is currently loaded.
      */
     uint4 get_n() const {
+	if (owner) return shared_n;
 	Assert(data);
 	return *alignment_cast<uint4*>(data + 4);
     }
 
     void set_n(uint4 n) {
+	if (owner) {
+	    shared_n = n;
+	    return;
+	}
 	Assert(data);
 	// Assert(refs() == 1);
 	*alignment_cast<uint4*>(data + 4) = n;
@@ -115,11 +191,22 @@ class Cursor {
      * Returns NULL if no block is currently loaded.
      */
     const uint8_t * get_p() const {
+	if (owner) return shared_p;
 	if (rare(!data)) return NULL;
 	return reinterpret_cast<uint8_t*>(data + 8);
     }
 
     uint8_t * get_modifiable_p(unsigned block_size) {
+	if (owner) {
+	    // Copy the block out of the shared storage.
+	    auto keep = owner;
+	    const uint8_t* p = shared_p;
+	    uint4 n = shared_n;
+	    uint8_t* q = init(block_size);
+	    std::memcpy(q, p, block_size);
+	    set_n(n);
+	    return q;
+	}
 	if (rare(!data)) return NULL;
 	if (refs() > 1) {
 	    char * new_data = new char[block_size + 8];
@@ -66,10 +66,14 @@
 #include <sys/types.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cerrno>
 #include <cstdlib>
+#include <exception>
 #include <memory>
 #include <string>
+#include <system_error>
+#include <thread>
 
 using namespace std;
 using namespace Xapian;
@@ -91,6 +95,20 @@ using Xapian::Internal::intrusive_ptr;
 // byte in the term).
 #define MAX_SAFE_TERM_LENGTH 245
 
+/** Maximum number of documents each thread inverts in a round in
+ *  add_documents().
+ *
+ *  The flush thresholds are checked after each round.
+ */
+static constexpr size_t ADD_DOCUMENTS_ROUND_PER_THREAD = 256;
+
+/** Maximum number of documents each thread inverts in the first round in
+ *  add_documents() when there's a flush memory limit.
+ *
+ *  This round is used to estimate the memory used per document.
+ */
+static constexpr size_t ADD_DOCUMENTS_FIRST_ROUND = 16;
+
 /* This opens the tables, determining the current and next revision numbers,
  * and stores handles to the tables.
  */
@@ -247,6 +265,17 @@ GlassDatabase::open_tables(int flags)
 	RETURN(false);
     }
 
+    if (readonly) {
+	// Share blocks with other readers of this database in this process.
+	const char* uuid = version_file.get_uuid();
+	docdata_table.set_block_cache(uuid);
+	spelling_table.set_block_cache(uuid);
+	synonym_table.set_block_cache(uuid);
+	termlist_table.set_block_cache(uuid);
+	position_table.set_block_cache(uuid);
+	postlist_table.set_block_cache(uuid);
+    }
+
     docdata_table.open(flags, version_file.get_root(Glass::DOCDATA), rev);
     spelling_table.open(flags, version_file.get_root(Glass::SPELLING), rev);
     synonym_table.open(flags, version_file.get_root(Glass::SYNONYM), rev);
@@ -378,17 +407,45 @@ GlassDatabase::request_document(Xapian::docid did) const
     docdata_table.readahead_for_document(did);
 }
 
+void
+GlassDatabase::request_documents(const vector<Xapian::docid>& dids) const
+{
+    if (dids.size() == 1) {
+	// Descending the B-tree for a single document isn't worthwhile.
+	docdata_table.readahead_for_document(dids[0]);
+	return;
+    }
+    docdata_table.readahead_for_documents(dids);
+}
+
 void
 GlassDatabase::readahead_for_query(const Xapian::Query &query) const
 {
+    vector<string> keys;
     Xapian::TermIterator t;
     for (t = query.get_unique_terms_begin(); t != Xapian::TermIterator(); ++t) {
-	const string & term = *t;
-	if (!postlist_table.readahead_key(GlassPostListTable::make_key(term)))
-	    break;
+	keys.push_back(GlassPostListTable::make_key(*t));
+    }
+    if (keys.size() == 1) {
+	postlist_table.readahead_key(keys[0]);
+    } else {
+	postlist_table.readahead_keys(keys);
     }
 }
 
+void
+GlassDatabase::set_mmap()
+{
+    LOGCALL_VOID(DB, "GlassDatabase::set_mmap", NO_ARGS);
+    if (!readonly) return;
+    postlist_table.set_mmap();
+    position_table.set_mmap();
+    termlist_table.set_mmap();
+    synonym_table.set_mmap();
+    spelling_table.set_mmap();
+    docdata_table.set_mmap();
+}
+
 bool
 GlassDatabase::reopen()
 {
@@ -931,6 +988,13 @@ GlassDatabase::open_allterms(string_view prefix) const
 				 prefix));
 }
 
+bool
+GlassDatabase::get_wildcard_candidates(string_view literal,
+				       vector<string>& terms) const
+{
+    return postlist_table.get_wildcard_candidates(literal, terms);
+}
+
 TermList*
 GlassDatabase::open_spelling_termlist(string_view word) const
 {
@@ -952,6 +1016,13 @@ GlassDatabase::get_spelling_frequency(string_view word) const
     return spelling_table.get_word_frequency(word);
 }
 
+void
+GlassDatabase::get_spelling_frequencies(const vector<string>& words,
+					vector<Xapian::doccount>& freqs) const
+{
+    spelling_table.get_word_frequencies(words, freqs);
+}
+
 TermList *
 GlassDatabase::open_synonym_termlist(string_view term) const
 {
@@ -1070,6 +1141,7 @@ GlassWritableDatabase::GlassWritableDatabase(string_view dir, int flags,
 	: GlassDatabase(dir, flags, block_size),
 	  change_count(0),
 	  flush_threshold(0),
+	  flush_memory_limit(0),
 	  modify_shortcut_document(NULL),
 	  modify_shortcut_docid(0)
 {
@@ -1084,6 +1156,14 @@ GlassWritableDatabase::GlassWritableDatabase(string_view dir, int flags,
     }
     if (flush_threshold == 0)
 	flush_threshold = 10000;
+
+    p = getenv("XAPIAN_FLUSH_MEMORY_LIMIT");
+    if (p && *p) {
+	if (!parse_unsigned(p, flush_memory_limit)) {
+	    throw Xapian::InvalidArgumentError("XAPIAN_FLUSH_MEMORY_LIMIT must "
+					       "be a non-negative integer");
+	}
+    }
 }
 
 GlassWritableDatabase::~GlassWritableDatabase()
@@ -1102,12 +1182,12 @@ GlassWritableDatabase::commit()
 }
 
 void
-GlassWritableDatabase::check_flush_threshold()
+GlassWritableDatabase::check_flush_threshold(Xapian::doccount n_changes)
 {
-    // FIXME: this should be done by checking memory usage, not the number of
-    // changes.  We could also look at the amount of data the inverter object
-    // currently holds.
-    if (++change_count >= flush_threshold) {
+    change_count += n_changes;
+    if (change_count >= flush_threshold ||
+	(flush_memory_limit &&
+	 inverter.get_memory_used() >= flush_memory_limit)) {
 	flush_postlist_changes();
 	if (!transaction_active()) apply();
     }
@@ -1213,6 +1293,186 @@ GlassWritableDatabase::add_document_(Xapian::docid did,
     RETURN(did);
 }
 
+Xapian::docid
+GlassWritableDatabase::add_documents(const vector<Xapian::Document>& docs,
+				     unsigned n_threads)
+{
+    LOGCALL(DB, Xapian::docid, "GlassWritableDatabase::add_documents", docs.size() | n_threads);
+    if (docs.empty())
+	RETURN(0);
+    // Make sure the docid counter doesn't overflow.
+    if (GLASS_MAX_DOCID - version_file.get_last_docid() < docs.size())
+	throw Xapian::DatabaseError("Run out of docids - you'll have to use copydatabase to eliminate any gaps before you can add more documents");
+
+    if (n_threads > docs.size())
+	n_threads = docs.size();
+    if (n_threads > 1) {
+	// A document read from a database may lazily read its terms from that
+	// database, which isn't safe to do from several threads at once.
+	for (auto&& doc : docs) {
+	    if (doc.get_docid() != 0) {
+		n_threads = 1;
+		break;
+	    }
+	}
+    }
+    if (n_threads <= 1) {
+	Xapian::docid first = add_document_(version_file.get_next_docid(),
+					    docs[0]);
+	for (size_t i = 1; i != docs.size(); ++i) {
+	    add_document_(version_file.get_next_docid(), docs[i]);
+	}
+	RETURN(first);
+    }
+
+    // The documents are processed in rounds, and after each round we check
+    // the flush thresholds just as add_document() does after each document.
+    // Each round is split into a contiguous range for each thread, which
+    // inverts them into its own Inverter object and encodes their termlists.
+    // These operations don't modify the tables, so can safely run in
+    // parallel.
+    struct Chunk {
+	size_t begin, end;
+	Inverter inverter;
+	vector<string> termlists;
+	vector<Xapian::termcount> doclens;
+	Xapian::termcount wdf_max = 0;
+	exception_ptr error;
+    };
+
+    Xapian::docid first = version_file.get_last_docid() + 1;
+    bool want_termlists = termlist_table.is_open();
+
+    auto invert = [&](Chunk& chunk) {
+	chunk.doclens.reserve(chunk.end - chunk.begin);
+	if (want_termlists)
+	    chunk.termlists.reserve(chunk.end - chunk.begin);
+	for (size_t i = chunk.begin; i != chunk.end; ++i) {
+	    const Xapian::Document& document = docs[i];
+	    Xapian::docid did = first + i;
+	    Xapian::termcount new_doclen = 0;
+	    Xapian::TermIterator term = document.termlist_begin();
+	    for ( ; term != document.termlist_end(); ++term) {
+		termcount wdf = term.get_wdf();
+		new_doclen += wdf;
+		chunk.wdf_max = max(chunk.wdf_max, wdf);
+
+		string tname = *term;
+		if (tname.size() > MAX_SAFE_TERM_LENGTH)
+		    throw Xapian::InvalidArgumentError("Term too long (> " STRINGIZE(MAX_SAFE_TERM_LENGTH) "): " + tname);
+
+		chunk.inverter.add_posting(did, tname, wdf);
+		chunk.inverter.set_positionlist(position_table, did, tname,
+						term);
+	    }
+	    if (want_termlists) {
+		chunk.termlists.push_back(
+		    GlassTermListTable::encode_termlist(document, new_doclen));
+	    }
+	    chunk.inverter.set_doclength(did, new_doclen, true);
+	    chunk.doclens.push_back(new_doclen);
+	}
+    };
+
+    // Approximate memory used by the changes for each document inverted so
+    // far, used to size rounds so we don't go far over flush_memory_limit.
+    double mem_per_doc = 0.0;
+    size_t done = 0;
+    while (done != docs.size()) {
+	size_t round_size = docs.size() - done;
+	round_size = min(round_size,
+			 size_t(n_threads) * ADD_DOCUMENTS_ROUND_PER_THREAD);
+	if (change_count < flush_threshold)
+	    round_size = min(round_size,
+			     size_t(flush_threshold - change_count));
+	if (flush_memory_limit && mem_per_doc == 0.0) {
+	    // Use a small first round to estimate the memory used per
+	    // document.
+	    round_size = min(round_size,
+			     size_t(n_threads) * ADD_DOCUMENTS_FIRST_ROUND);
+	} else if (flush_memory_limit) {
+	    size_t mem_used = inverter.get_memory_used();
+	    size_t mem_left = flush_memory_limit - min(mem_used,
+						       flush_memory_limit);
+	    round_size = min(round_size, size_t(mem_left / mem_per_doc) + 1);
+	}
+
+	unsigned round_threads = unsigned(min(size_t(n_threads), round_size));
+	vector<Chunk> chunks(round_threads);
+	for (unsigned c = 0; c != round_threads; ++c) {
+	    chunks[c].begin = done + round_size * c / round_threads;
+	    chunks[c].end = done + round_size * (c + 1) / round_threads;
+	}
+
+	atomic<unsigned> next_chunk{0};
+	auto worker = [&]() {
+	    unsigned c;
+	    while ((c = next_chunk++) < chunks.size()) {
+		try {
+		    invert(chunks[c]);
+		} catch (...) {
+		    chunks[c].error = current_exception();
+		}
+	    }
+	};
+
+	vector<thread> threads;
+	if (round_threads > 1) {
+	    threads.reserve(round_threads - 1);
+	    try {
+		while (threads.size() != round_threads - 1) {
+		    threads.emplace_back(worker);
+		}
+	    } catch (const system_error&) {
+		// Failing to create a thread isn't fatal - we just end up
+		// using fewer threads.
+	    }
+	}
+	worker();
+	for (auto&& t : threads) {
+	    t.join();
+	}
+
+	size_t round_mem = 0;
+	try {
+	    for (auto&& chunk : chunks) {
+		if (chunk.error)
+		    rethrow_exception(chunk.error);
+	    }
+
+	    // Now apply the changes in document order.
+	    for (auto&& chunk : chunks) {
+		version_file.check_wdf(chunk.wdf_max);
+		for (size_t i = chunk.begin; i != chunk.end; ++i) {
+		    Xapian::docid did = version_file.get_next_docid();
+		    AssertEq(did, first + i);
+		    const Xapian::Document& document = docs[i];
+		    docdata_table.replace_document_data(did,
+							document.get_data());
+		    value_manager.add_document(did, document, value_stats);
+		    if (want_termlists) {
+			termlist_table.set_termlist(
+			    did, chunk.termlists[i - chunk.begin]);
+		    }
+		    version_file.add_document(chunk.doclens[i - chunk.begin]);
+		}
+		round_mem += chunk.inverter.get_memory_used();
+		inverter.merge(chunk.inverter);
+	    }
+	} catch (...) {
+	    // Discard any partial changes, as add_document_() does.
+	    cancel();
+	    throw;
+	}
+
+	done += round_size;
+	mem_per_doc = max(mem_per_doc, double(round_mem) / round_size);
+	check_flush_threshold(round_size);
+    }
+
+    RETURN(first);
+}
+
 void
 GlassWritableDatabase::delete_document(Xapian::docid did)
 {
@@ -1653,6 +1913,21 @@ GlassWritableDatabase::open_allterms(string_view prefix) const
     RETURN(GlassDatabase::open_allterms(prefix));
 }
 
+bool
+GlassWritableDatabase::get_wildcard_candidates(string_view literal,
+					       vector<string>& terms) const
+{
+    if (change_count) {
+	// Flush the posting list changes so the wildcard index is up to date
+	// (but don't commit - there may be a transaction in progress).
+	inverter.flush_post_lists(postlist_table, string_view());
+	// As in open_allterms(), the positions, document lengths and stats
+	// haven't been written, so set change_count to 1.
+	change_count = 1;
+    }
+    return GlassDatabase::get_wildcard_candidates(literal, terms);
+}
+
 void
 GlassWritableDatabase::cancel()
 {
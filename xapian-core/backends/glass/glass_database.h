@@ -45,6 +45,7 @@
 
 #include <map>
 #include <string_view>
+#include <vector>
 
 class GlassTermList;
 class GlassAllDocsPostList;
@@ -235,6 +236,9 @@ class GlassDatabase : public Xapian::Database::Internal {
 
     ~GlassDatabase();
 
+    /// Memory map the tables to read from them (see Xapian::DB_MMAP).
+    void set_mmap();
+
     /// Get a postlist table cursor (used by GlassValueList).
     GlassCursor * get_postlist_cursor() const {
 	return postlist_table.cursor_get();
@@ -279,10 +283,16 @@ class GlassDatabase : public Xapian::Database::Internal {
     TermList * open_term_list_direct(Xapian::docid did) const;
     TermList* open_allterms(std::string_view prefix) const;
 
+    bool get_wildcard_candidates(std::string_view literal,
+				 std::vector<std::string>& terms) const;
+
     TermList* open_spelling_termlist(std::string_view word) const;
     TermList * open_spelling_wordlist() const;
     Xapian::doccount get_spelling_frequency(std::string_view word) const;
 
+    void get_spelling_frequencies(const std::vector<std::string>& words,
+				  std::vector<Xapian::doccount>& freqs) const;
+
     TermList* open_synonym_termlist(std::string_view term) const;
     TermList* open_synonym_keylist(std::string_view prefix) const;
 
@@ -300,6 +310,7 @@ class GlassDatabase : public Xapian::Database::Internal {
     string get_uuid() const;
 
     void request_document(Xapian::docid /*did*/) const;
+    void request_documents(const std::vector<Xapian::docid>& dids) const;
     void readahead_for_query(const Xapian::Query &query) const;
     //@}
 
@@ -351,6 +362,11 @@ class GlassWritableDatabase : public GlassDatabase {
     /// If change_count reaches this threshold we automatically flush.
     Xapian::doccount flush_threshold;
 
+    /** If the inverter's approximate memory use reaches this many bytes we
+     *  automatically flush (0 means no limit).
+     */
+    size_t flush_memory_limit;
+
     /** A pointer to the last document which was returned by
      *  open_document(), or NULL if there is no such valid document.  This
      *  is used purely for comparing with a supplied document to help with
@@ -366,8 +382,10 @@ class GlassWritableDatabase : public GlassDatabase {
     /** Check if we should autoflush.
      *
      *  Called at the end of each document changing operation.
+     *
+     *  @param n_changes	The number of documents changed (default: 1).
      */
-    void check_flush_threshold();
+    void check_flush_threshold(Xapian::doccount n_changes = 1);
 
     /// Flush any unflushed postlist changes, but don't commit them.
     void flush_postlist_changes();
@@ -387,9 +405,15 @@ class GlassWritableDatabase : public GlassDatabase {
     /** Cancel pending modifications to the database. */
     void cancel();
 
+    void set_flush_memory_limit(size_t limit) {
+	flush_memory_limit = limit;
+    }
+
     Xapian::docid add_document(const Xapian::Document& document);
     Xapian::docid add_document_(Xapian::docid did,
 				const Xapian::Document& document);
+    Xapian::docid add_documents(const std::vector<Xapian::Document>& docs,
+				unsigned n_threads);
     // Stop the default implementation of delete_document(term) and
     // replace_document(term) from being hidden.  This isn't really
     // a problem as we only try to call them through the base class
@@ -448,6 +472,9 @@ class GlassWritableDatabase : public GlassDatabase {
 				     std::string_view term) const;
     TermList* open_allterms(std::string_view prefix) const;
 
+    bool get_wildcard_candidates(std::string_view literal,
+				 std::vector<std::string>& terms) const;
+
     void add_spelling(std::string_view word, Xapian::termcount freqinc) const;
     Xapian::termcount remove_spelling(std::string_view word,
 				      Xapian::termcount freqdec) const;
@@ -34,6 +34,7 @@
 #include "glass_version.h"
 #include "pack.h"
 #include "backends/valuestats.h"
+#include "backends/wildcardindex.h"
 
 #include <xapian.h>
 
@@ -123,6 +124,24 @@ check_glass_table(const char* tablename, string_view db_dir, int fd,
 		continue;
 	    }
 
+	    if (key.size() >= 2 && key[0] == '\0' && key[1] == '\xdc') {
+		// Wildcard index entry, or the marker that the index is
+		// present.
+		if (key.size() == 2) continue;
+		string term;
+		if (wildcard_index_decode(string_view(key).substr(2), term) == 0) {
+		    if (out)
+			*out << "Bad wildcard index key" << endl;
+		    ++errors;
+		} else if (!table->key_exists(pack_glass_postlist_key(term))) {
+		    if (out)
+			*out << "Wildcard index entry for term '" << term
+			     << "' which isn't present" << endl;
+		    ++errors;
+		}
+		continue;
+	    }
+
 	    if (key.size() >= 2 && key[0] == '\0' && key[1] == '\xe0') {
 		// doclen chunk
 		const char * pos, * end;
@@ -27,6 +27,7 @@
 #include "pack.h"
 
 #include <string>
+#include <vector>
 
 class GlassDocDataTable : public GlassLazyTable {
   public:
@@ -105,6 +106,15 @@ class GlassDocDataTable : public GlassLazyTable {
     void readahead_for_document(Xapian::docid did) const {
 	readahead_key(make_key(did));
     }
+
+    void readahead_for_documents(const std::vector<Xapian::docid>& dids) const {
+	std::vector<std::string> keys;
+	keys.reserve(dids.size());
+	for (Xapian::docid did : dids) {
+	    keys.push_back(make_key(did));
+	}
+	readahead_keys(keys);
+    }
 };
 
 #endif // XAPIAN_INCLUDED_GLASS_DOCDATA_H
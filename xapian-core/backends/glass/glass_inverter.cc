@@ -52,6 +52,8 @@ Inverter::store_positions(const GlassPositionListTable & position_table,
 	    auto j = m.find(did);
 	    if (j != m.end()) {
 		// Update existing entry.
+		mem_used += s.size();
+		release_memory(j->second.size());
 		swap(j->second, s);
 		return;
 	    }
@@ -106,8 +108,18 @@ Inverter::set_positionlist(Xapian::docid did,
 			   string_view s)
 {
     has_positions_cache = s.empty() ? -1 : 1;
-    pos_changes.insert(make_pair(term, map<Xapian::docid, string>()))
-	.first->second[did] = s;
+    auto r = pos_changes.insert(make_pair(term, map<Xapian::docid, string>()));
+    if (r.second) {
+	mem_used += pos_term_size(term);
+    }
+    auto j = r.first->second.insert(make_pair(did, string(s)));
+    if (j.second) {
+	mem_used += pos_entry_size(s);
+    } else {
+	mem_used += s.size();
+	release_memory(j.first->second.size());
+	j.first->second = s;
+    }
 }
 
 void
@@ -156,11 +168,40 @@ Inverter::has_positions(const GlassPositionListTable & position_table) const
     return has_positions_cache;
 }
 
+void
+Inverter::merge(Inverter& o)
+{
+    // Splice in the entries for terms we don't have changes for, then merge
+    // the changes for the terms which we do (which merge() leaves in o).
+    postlist_changes.merge(o.postlist_changes);
+    for (auto& i : o.postlist_changes) {
+	postlist_changes.find(i.first)->second.merge(i.second);
+	// The entry for the term in o is no longer needed.
+	o.release_memory(term_size(i.first));
+    }
+
+    pos_changes.merge(o.pos_changes);
+    for (auto& i : o.pos_changes) {
+	pos_changes.find(i.first)->second.merge(i.second);
+	o.release_memory(pos_term_size(i.first));
+    }
+
+    doclen_changes.merge(o.doclen_changes);
+
+    // If positions were added we must now have positions; otherwise o
+    // doesn't tell us anything new.
+    if (o.has_positions_cache == 1) has_positions_cache = 1;
+    mem_used += o.mem_used;
+    o.clear();
+}
+
 void
 Inverter::flush_doclengths(GlassPostListTable & table)
 {
     table.merge_doclen_changes(doclen_changes);
+    release_memory(doclen_changes.size() * POSTING_SIZE);
     doclen_changes.clear();
+    check_if_empty();
 }
 
 void
@@ -171,7 +212,9 @@ Inverter::flush_post_list(GlassPostListTable& table, string_view term)
 
     // Flush buffered changes for just this term's postlist.
     table.merge_changes(term, i->second);
+    release_memory(postlist_entry_size(i->first, i->second));
     postlist_changes.erase(i);
+    check_if_empty();
 }
 
 void
@@ -179,8 +222,10 @@ Inverter::flush_all_post_lists(GlassPostListTable & table)
 {
     for (auto i = postlist_changes.begin(); i != postlist_changes.end(); ++i) {
 	table.merge_changes(i->first, i->second);
+	release_memory(postlist_entry_size(i->first, i->second));
     }
     postlist_changes.clear();
+    check_if_empty();
 }
 
 void
@@ -207,11 +252,13 @@ Inverter::flush_post_lists(GlassPostListTable& table, string_view pfx)
 
     for (auto i = begin; i != end; ++i) {
 	table.merge_changes(i->first, i->second);
+	release_memory(postlist_entry_size(i->first, i->second));
     }
 
     // Erase all the entries in one go, as that's:
     //  O(log(postlist_changes.size()) + O(number of elements removed)
     postlist_changes.erase(begin, end);
+    check_if_empty();
 }
 
 void
@@ -234,8 +281,11 @@ Inverter::flush_pos_lists(GlassPositionListTable & table)
 		table.set_positionlist(did, term, s);
 	    else
 		table.delete_positionlist(did, term);
+	    release_memory(pos_entry_size(s));
 	}
+	release_memory(pos_term_size(term));
     }
     pos_changes.clear();
     has_positions_cache = -1;
+    check_if_empty();
 }
@@ -25,6 +25,7 @@
 
 #include "api/smallvector.h"
 
+#include <algorithm>
 #include <map>
 #include <string>
 #include <string_view>
@@ -118,11 +119,24 @@ class Inverter {
 	    pl_changes[did] = new_wdf;
 	}
 
+	/** Merge in changes from @a o.
+	 *
+	 *  The changes in @a o must be for different documents.
+	 */
+	void merge(PostingChanges& o) {
+	    UNSIGNED_OVERFLOW_OK(tf_delta += o.tf_delta);
+	    UNSIGNED_OVERFLOW_OK(cf_delta += o.cf_delta);
+	    pl_changes.merge(o.pl_changes);
+	}
+
 	/// Get the term frequency delta.
 	Xapian::termcount get_tfdelta() const { return tf_delta; }
 
 	/// Get the collection frequency delta.
 	Xapian::termcount get_cfdelta() const { return cf_delta; }
+
+	/// Get the number of documents with buffered changes.
+	size_t size() const { return pl_changes.size(); }
     };
 
     /// Buffered changes to postlists.
@@ -141,6 +155,66 @@ class Inverter {
 	     std::map<Xapian::docid, std::string>,
 	     std::less<>> pos_changes;
 
+    /** Approximate number of bytes used by the buffered changes.
+     *
+     *  This is reduced by the size of any changes flushed (and reset once
+     *  all changes have been flushed).
+     */
+    size_t mem_used = 0;
+
+    /// Approximate per-entry overhead of a std::map node.
+    static constexpr size_t MAP_NODE_OVERHEAD = 4 * sizeof(void*);
+
+    /// Approximate memory used by a buffered posting.
+    static constexpr size_t POSTING_SIZE =
+	MAP_NODE_OVERHEAD + sizeof(Xapian::docid) + sizeof(Xapian::termcount);
+
+    /// Approximate memory used by a postlist_changes entry for @a term.
+    static size_t term_size(std::string_view term) {
+	return MAP_NODE_OVERHEAD + sizeof(std::string) +
+	       sizeof(PostingChanges) + term.size();
+    }
+
+    /// Approximate memory used by a pos_changes entry for @a term.
+    static size_t pos_term_size(std::string_view term) {
+	return MAP_NODE_OVERHEAD + sizeof(std::string) + term.size() +
+	       sizeof(std::map<Xapian::docid, std::string>);
+    }
+
+    /// Approximate memory used by a positional data entry @a s.
+    static size_t pos_entry_size(std::string_view s) {
+	return MAP_NODE_OVERHEAD + sizeof(Xapian::docid) +
+	       sizeof(std::string) + s.size();
+    }
+
+    /// Approximate memory used by the postlist_changes entry for @a term.
+    static size_t postlist_entry_size(std::string_view term,
+				      const PostingChanges& changes) {
+	return term_size(term) + changes.size() * POSTING_SIZE;
+    }
+
+    /// Reduce mem_used by @a bytes which have been freed.
+    void release_memory(size_t bytes) {
+	mem_used -= std::min(bytes, mem_used);
+    }
+
+    /** Account for a change to a postlist_changes entry.
+     *
+     *  @param i		The changes for the term.
+     *  @param old_size	i.size() before the change.
+     */
+    void posting_changed(const PostingChanges& i, size_t old_size) {
+	if (i.size() != old_size) mem_used += POSTING_SIZE;
+    }
+
+    /// Reset mem_used if there are no buffered changes left.
+    void check_if_empty() {
+	if (postlist_changes.empty() && pos_changes.empty() &&
+	    doclen_changes.empty()) {
+	    mem_used = 0;
+	}
+    }
+
     void store_positions(const GlassPositionListTable & position_table,
 			 Xapian::docid did,
 			 std::string_view tname,
@@ -162,8 +236,11 @@ class Inverter {
 	if (i == postlist_changes.end()) {
 	    postlist_changes.insert(
 		std::make_pair(term, PostingChanges(did, wdf)));
+	    mem_used += term_size(term) + POSTING_SIZE;
 	} else {
+	    size_t old_size = i->second.size();
 	    i->second.add_posting(did, wdf);
+	    posting_changed(i->second, old_size);
 	}
     }
 
@@ -173,8 +250,11 @@ class Inverter {
 	if (i == postlist_changes.end()) {
 	    postlist_changes.insert(
 		std::make_pair(term, PostingChanges(did, wdf, false)));
+	    mem_used += term_size(term) + POSTING_SIZE;
 	} else {
+	    size_t old_size = i->second.size();
 	    i->second.remove_posting(did, wdf);
+	    posting_changed(i->second, old_size);
 	}
     }
 
@@ -185,8 +265,11 @@ class Inverter {
 	if (i == postlist_changes.end()) {
 	    postlist_changes.insert(
 		std::make_pair(term, PostingChanges(did, old_wdf, new_wdf)));
+	    mem_used += term_size(term) + POSTING_SIZE;
 	} else {
+	    size_t old_size = i->second.size();
 	    i->second.update_posting(did, old_wdf, new_wdf);
+	    posting_changed(i->second, old_size);
 	}
     }
 
@@ -210,18 +293,42 @@ class Inverter {
 	postlist_changes.clear();
 	pos_changes.clear();
 	has_positions_cache = -1;
+	mem_used = 0;
     }
 
+    /// Get the approximate number of bytes used by the buffered changes.
+    size_t get_memory_used() const { return mem_used; }
+
+    /** Merge in the changes buffered by @a o.
+     *
+     *  This allows documents to be inverted in parallel into separate
+     *  Inverter objects.  The changes in @a o must be for documents which
+     *  this object doesn't have changes buffered for.
+     *
+     *  @a o is left empty.
+     */
+    void merge(Inverter& o);
+
     void set_doclength(Xapian::docid did, Xapian::termcount doclen, bool add) {
 	if (add) {
 	    Assert(doclen_changes.find(did) == doclen_changes.end() || doclen_changes[did] == DELETED_POSTING);
 	}
-	doclen_changes[did] = doclen;
+	auto r = doclen_changes.insert(std::make_pair(did, doclen));
+	if (r.second) {
+	    mem_used += POSTING_SIZE;
+	} else {
+	    r.first->second = doclen;
+	}
     }
 
     void delete_doclength(Xapian::docid did) {
 	Assert(doclen_changes.find(did) == doclen_changes.end() || doclen_changes[did] != DELETED_POSTING);
-	doclen_changes[did] = DELETED_POSTING;
+	auto r = doclen_changes.insert(std::make_pair(did, DELETED_POSTING));
+	if (r.second) {
+	    mem_used += POSTING_SIZE;
+	} else {
+	    r.first->second = DELETED_POSTING;
+	}
     }
 
     bool get_doclength(Xapian::docid did, Xapian::termcount & doclen) const {
@@ -29,6 +29,7 @@
 #include "debuglog.h"
 #include "pack.h"
 #include "str.h"
+#include "backends/wildcardindex.h"
 #include "unicode/description_append.h"
 
 using Xapian::Internal::intrusive_ptr;
@@ -796,6 +797,29 @@ GlassPostList::next_in_chunk()
     RETURN(true);
 }
 
+unsigned
+GlassPostList::peek_postings(Xapian::docid* dids,
+			     Xapian::termcount* wdfs,
+			     unsigned max) const
+{
+    LOGCALL(DB, unsigned, "GlassPostList::peek_postings", max);
+    Assert(have_started);
+    Assert(!is_at_end);
+    Assert(max > 0);
+    dids[0] = did;
+    wdfs[0] = wdf;
+    const char* p = pos;
+    Xapian::docid d = did;
+    unsigned n = 1;
+    while (n != max && p != end) {
+	read_did_increase(&p, end, &d);
+	dids[n] = d;
+	read_wdf(&p, end, &wdfs[n]);
+	++n;
+    }
+    RETURN(n);
+}
+
 void
 GlassPostList::next_chunk()
 {
@@ -1211,6 +1235,32 @@ next_doclen_chunk:
     delete to;
 }
 
+void
+GlassPostListTable::update_wildcard_index(string_view term, bool adding)
+{
+    if (wildcard_index < 0) wildcard_index = has_wildcard_index();
+    if (!wildcard_index) return;
+    string_view prefix(GLASS_WILDCARD_INDEX_PREFIX, 2);
+    wildcard_index_keys(prefix, term, [&](const string& key) {
+	if (adding) {
+	    add(key, WILDCARD_INDEX_TAG);
+	} else {
+	    del(key);
+	}
+    });
+}
+
+bool
+GlassPostListTable::get_wildcard_candidates(string_view literal,
+					    vector<string>& terms) const
+{
+    if (!has_wildcard_index()) return false;
+    unique_ptr<GlassCursor> cursor(cursor_get());
+    wildcard_index_lookup(*cursor, string_view(GLASS_WILDCARD_INDEX_PREFIX, 2),
+			  literal, terms);
+    return true;
+}
+
 void
 GlassPostListTable::merge_changes(string_view term,
 				  const Inverter::PostingChanges& changes)
@@ -1244,6 +1294,7 @@ GlassPostListTable::merge_changes(string_view term,
 
 	UNSIGNED_OVERFLOW_OK(termfreq += changes.get_tfdelta());
 	if (termfreq == 0) {
+	    update_wildcard_index(term, false);
 	    // All postings deleted!  So we can shortcut by zapping the
 	    // posting list.
 	    if (islast) {
@@ -1269,6 +1320,7 @@ GlassPostListTable::merge_changes(string_view term,
 	newhdr += make_start_of_chunk(islast, firstdid, lastdid);
 	if (pos == end) {
 	    add(current_key, newhdr);
+	    update_wildcard_index(term, true);
 	} else {
 	    Assert(size_t(pos - tag.data()) <= tag.size());
 	    tag.replace(0, pos - tag.data(), newhdr);
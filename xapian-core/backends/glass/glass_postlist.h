@@ -36,10 +36,14 @@
 #include <map>
 #include <string>
 #include <string_view>
+#include <vector>
 
 class GlassCursor;
 class GlassDatabase;
 
+/// Key prefix for the wildcard index (see backends/wildcardindex.h).
+#define GLASS_WILDCARD_INDEX_PREFIX "\0\xdc"
+
 namespace Glass {
     class PostlistChunkReader;
     class PostlistChunkWriter;
@@ -194,6 +198,10 @@ class GlassPostList : public LeafPostList {
     /// Return true if and only if we're off the end of the list.
     bool at_end() const { return is_at_end; }
 
+    unsigned peek_postings(Xapian::docid* dids,
+			   Xapian::termcount* wdfs,
+			   unsigned max) const;
+
     Xapian::termcount get_wdf_upper_bound() const;
 
     void get_docid_range(Xapian::docid& first, Xapian::docid& last) const;
@@ -212,6 +220,15 @@ class GlassPostListTable : public GlassTable {
     /// PostList for looking up document lengths.
     mutable std::unique_ptr<GlassPostList> doclen_pl;
 
+    /** Is there a wildcard index to keep up to date?
+     *
+     *  -1 means we haven't checked yet.
+     */
+    int wildcard_index = -1;
+
+    /// Add or remove the wildcard index entries for a term, if needed.
+    void update_wildcard_index(std::string_view term, bool adding);
+
   public:
     /** Create a new table object.
      *
@@ -238,6 +255,7 @@ class GlassPostListTable : public GlassTable {
     void open(int flags_, const RootInfo & root_info,
 	      glass_revision_number_t rev) {
 	doclen_pl.reset(0);
+	wildcard_index = -1;
 	GlassTable::open(flags_, root_info, rev);
     }
 
@@ -268,6 +286,18 @@ class GlassPostListTable : public GlassTable {
 	return key_exists(make_key(term));
     }
 
+    /// Does this table have a wildcard index?
+    bool has_wildcard_index() const {
+	return key_exists(std::string_view(GLASS_WILDCARD_INDEX_PREFIX, 2));
+    }
+
+    /** Find terms containing @a literal using the wildcard index.
+     *
+     *  @return false if there's no wildcard index.
+     */
+    bool get_wildcard_candidates(std::string_view literal,
+				 std::vector<std::string>& terms) const;
+
     /** Returns frequencies for a term.
      *
      *  @param term		The term to get frequencies for
@@ -25,6 +25,7 @@
 
 #include "expand/expandweight.h"
 #include "expand/termlistmerger.h"
+#include "glass_cursor.h"
 #include "glass_spelling.h"
 #include "omassert.h"
 #include "pack.h"
@@ -33,6 +34,7 @@
 
 #include <algorithm>
 #include <map>
+#include <memory>
 #include <queue>
 #include <vector>
 #include <set>
@@ -376,6 +378,35 @@ GlassSpellingTable::get_word_frequency(string_view word) const
     return 0;
 }
 
+void
+GlassSpellingTable::get_word_frequencies(const vector<string>& words,
+					 vector<Xapian::doccount>& freqs) const
+{
+    freqs.clear();
+    freqs.reserve(words.size());
+    unique_ptr<GlassCursor> cursor(cursor_get());
+    string key = "W";
+    for (auto&& word : words) {
+	auto i = wordfreq_changes.find(word);
+	if (i != wordfreq_changes.end()) {
+	    // Modified frequency for word:
+	    freqs.push_back(i->second);
+	    continue;
+	}
+
+	Xapian::termcount freq = 0;
+	key.replace(1, string::npos, word);
+	if (cursor && cursor->find_exact(key)) {
+	    const string& data = cursor->current_tag;
+	    const char* p = data.data();
+	    if (!unpack_uint_last(&p, p + data.size(), &freq)) {
+		throw Xapian::DatabaseCorruptError("Bad spelling word freq");
+	    }
+	}
+	freqs.push_back(freq);
+    }
+}
+
 ///////////////////////////////////////////////////////////////////////////
 
 Xapian::termcount
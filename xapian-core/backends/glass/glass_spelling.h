@@ -30,6 +30,7 @@
 #include <set>
 #include <string>
 #include <string_view>
+#include <vector>
 #include <cstring> // For memcpy() and memcmp().
 
 namespace Glass {
@@ -109,6 +110,17 @@ class GlassSpellingTable : public GlassLazyTable {
 
     Xapian::doccount get_word_frequency(std::string_view word) const;
 
+    /** Look up the frequencies of several words.
+     *
+     *  @param words	The words to look up, in ascending byte order.
+     *  @param freqs	Set to the frequency of each entry in @a words.
+     *
+     *  This makes a single pass through the table with a cursor, which is
+     *  more efficient than a separate lookup for each word.
+     */
+    void get_word_frequencies(const std::vector<std::string>& words,
+			      std::vector<Xapian::doccount>& freqs) const;
+
     void set_wordfreq_upper_bound(Xapian::termcount ub) {
 	wordfreq_upper_bound = ub;
     }
@@ -29,6 +29,7 @@
 
 #include "omassert.h"
 #include "posixy_wrapper.h"
+#include "safesysstat.h"
 #include "str.h"
 #include "stringutils.h" // For STRINGIZE().
 
@@ -37,6 +38,7 @@
 #include <cerrno>
 #include <cstring>   /* for memmove */
 #include <climits>   /* for CHAR_BIT */
+#include <memory>
 
 #include "glass_freelist.h"
 #include "glass_changes.h"
@@ -53,6 +55,7 @@
 #include <algorithm>  // for std::min()
 #include <string>
 #include <string_view>
+#include <utility>
 
 #include "xapian/constants.h"
 
@@ -174,6 +177,13 @@ GlassTable::read_block(uint4 n, uint8_t * p) const
 
     io_read_block(handle, reinterpret_cast<char *>(p), block_size, n, offset);
 
+    check_block(n, p);
+}
+
+/// Check block n, which has been read to address p, looks valid.
+void
+GlassTable::check_block(uint4 n, const uint8_t * p) const
+{
     if (GET_LEVEL(p) != LEVEL_FREELIST) {
 	int dir_end = DIR_END(p);
 	if (rare(dir_end < DIR_START || unsigned(dir_end) > block_size)) {
@@ -184,6 +194,54 @@ GlassTable::read_block(uint4 n, uint8_t * p) const
     }
 }
 
+/** Load block n into cursor entry @a cur for reading.
+ *
+ *  If the table is memory mapped and block n is inside the mapping, then
+ *  @a cur points into the mapping.  Otherwise if the table uses the shared
+ *  block cache then @a cur points to the cached copy of block n (which is
+ *  read and added to the cache if not already present); failing that,
+ *  block n is read into a buffer owned by @a cur.
+ */
+const uint8_t*
+GlassTable::load_block(Glass::Cursor& cur, uint4 n) const
+{
+    LOGCALL(DB, const uint8_t*, "GlassTable::load_block", Literal("cur") | n);
+    if (mapping) {
+	size_t end = size_t(offset) + (size_t(n) + 1) * block_size;
+	if (usual(end <= mapping->size)) {
+	    if (rare(handle == -2))
+		GlassTable::throw_database_closed();
+	    AssertRel(n,<,free_list.get_first_unused_block());
+	    auto p = reinterpret_cast<const uint8_t*>(mapping->base + end -
+						      block_size);
+	    check_block(n, p);
+	    RETURN(cur.set_shared(mapping, n, p));
+	}
+    }
+    if (use_block_cache) {
+	auto& cache = Glass::BlockCache::get();
+	if (cache.enabled()) {
+	    cache_key.rev = revision_number;
+	    cache_key.n = n;
+	    Glass::BlockCache::Block block = cache.find(cache_key);
+	    if (!block) {
+		uint8_t* p = new uint8_t[block_size];
+		block.reset(p, std::default_delete<uint8_t[]>());
+		read_block(n, p);
+		cache.add(cache_key, block, block_size);
+	    } else if (rare(handle == -2)) {
+		GlassTable::throw_database_closed();
+	    }
+	    const uint8_t* p = block.get();
+	    RETURN(cur.set_shared(std::move(block), n, p));
+	}
+    }
+    uint8_t* q = cur.init(block_size);
+    read_block(n, q);
+    cur.set_n(n);
+    RETURN(q);
+}
+
 /** write_block(n, p, appending) writes block n in the DB file from address p.
  *
  *  If appending is true (not specified it defaults to false), then this
@@ -331,10 +389,7 @@ GlassTable::block_to_cursor(Glass::Cursor * C_, int j, uint4 n) const
     if (n == C[j].get_n()) {
 	p = C_[j].clone(C[j]);
     } else {
-	uint8_t * q = C_[j].init(block_size);
-	read_block(n, q);
-	p = q;
-	C_[j].set_n(n);
+	p = load_block(C_[j], n);
     }
 
     if (j < level) {
@@ -1483,6 +1538,99 @@ GlassTable::readahead_key(string_view key) const
     RETURN(true);
 }
 
+bool
+GlassTable::readahead_keys(vector<string>& keys) const
+{
+    LOGCALL(DB, bool, "GlassTable::readahead_keys", keys.size());
+
+    // See readahead_key() for what a negative handle means.
+    if (handle < 0)
+	RETURN(false);
+
+    // If the table only has one level, there are no branch blocks to preread.
+    if (level == 0)
+	RETURN(false);
+
+    // Overlong keys cannot be found.
+    keys.erase(remove_if(keys.begin(), keys.end(),
+			 [](const string& key) {
+			     return key.size() > GLASS_BTREE_MAX_KEY_LEN;
+			 }),
+	       keys.end());
+    sort(keys.begin(), keys.end());
+    keys.erase(unique(keys.begin(), keys.end()), keys.end());
+
+    // The blocks at the current level, each with the index in keys of the
+    // first key leading to it.  Since keys is sorted, the keys leading to
+    // each block are contiguous.
+    vector<pair<uint4, size_t>> blocks;
+    vector<pair<uint4, size_t>> children;
+    if (!keys.empty())
+	blocks.emplace_back(C[level].get_n(), 0);
+    Glass::Cursor cur;
+    for (int j = level; j > 0 && !blocks.empty(); --j) {
+	children.clear();
+	for (size_t b = 0; b != blocks.size(); ++b) {
+	    // The root block is always in the cursor.  We've already issued
+	    // a preread hint for the blocks at lower levels.
+	    const uint8_t* p = (j == level) ?
+		C[level].get_p() :
+		load_block(cur, blocks[b].first);
+	    size_t k_end = b + 1 == blocks.size() ?
+		keys.size() :
+		blocks[b + 1].second;
+	    int c = -1;
+	    for (size_t k = blocks[b].second; k != k_end; ++k) {
+		form_key(keys[k]);
+		c = find_in_branch(p, kt, c);
+		uint4 n = BItem(p, c).block_given_by();
+		if (children.empty() || children.back().first != n)
+		    children.emplace_back(n, k);
+	    }
+	}
+	for (auto& child : children) {
+	    if (!io_readahead_block(handle, block_size, child.first, offset))
+		RETURN(false);
+	}
+	swap(blocks, children);
+    }
+    RETURN(true);
+}
+
+void
+GlassTable::get_split_keys(size_t n, vector<string>& keys) const
+{
+    LOGCALL_VOID(DB, "GlassTable::get_split_keys", n | Literal("keys"));
+    keys.clear();
+    // The table isn't open (see readahead_key() for the cases), or only has
+    // a single level so has no branch blocks to look at.
+    if (handle < 0 || level == 0)
+	return;
+
+    unique_ptr<uint8_t[]> buf(new uint8_t[block_size]);
+    vector<uint4> blocks(1, root);
+    for (int j = level; ; --j) {
+	keys.clear();
+	vector<uint4> children;
+	for (uint4 b : blocks) {
+	    read_block(b, buf.get());
+	    const uint8_t* p = buf.get();
+	    for (int c = DIR_START; c < DIR_END(p); c += D2) {
+		BItem item(p, c);
+		// The leftmost item in a level has an empty key.
+		if (item.key().length() > 0) {
+		    keys.emplace_back();
+		    item.key().read(&keys.back());
+		}
+		children.push_back(item.block_given_by());
+	    }
+	}
+	if (j == 1 || keys.size() >= n)
+	    break;
+	blocks.swap(children);
+    }
+}
+
 bool
 GlassTable::get_exact_entry(string_view key, string& tag) const
 {
@@ -1736,7 +1884,9 @@ GlassTable::GlassTable(const char* tablename_, string_view path_,
 	  comp_stream(Z_DEFAULT_STRATEGY),
 	  lazy(lazy_),
 	  last_readahead(BLK_UNUSED),
-	  offset(0)
+	  offset(0),
+	  use_mmap(false),
+	  use_block_cache(false)
 {
     LOGCALL_CTOR(DB, "GlassTable", tablename_ | path_ | readonly_ | lazy_);
 }
@@ -1771,7 +1921,9 @@ GlassTable::GlassTable(const char * tablename_, int fd, off_t offset_,
 	  comp_stream(Z_DEFAULT_STRATEGY),
 	  lazy(lazy_),
 	  last_readahead(BLK_UNUSED),
-	  offset(offset_)
+	  offset(offset_),
+	  use_mmap(false),
+	  use_block_cache(false)
 {
     LOGCALL_CTOR(DB, "GlassTable", tablename_ | fd | offset_ | readonly_ | lazy_);
 }
@@ -1834,6 +1986,9 @@ void GlassTable::close(bool permanent) {
 	}
     }
 
+    // Cursors using blocks in the mapping keep it alive until they're done.
+    mapping = nullptr;
+
     if (permanent) {
 	handle = -2;
 	// Don't delete the resources in the table, since they may
@@ -2012,11 +2167,57 @@ GlassTable::do_open_to_read(const RootInfo * root_info,
 	}
     }
 
+    if (use_mmap) map_file();
+
+    if (use_block_cache) {
+	struct stat statbuf;
+	if (fstat(handle, &statbuf) == 0) {
+	    cache_key.dev = statbuf.st_dev;
+	    cache_key.ino = statbuf.st_ino;
+	    cache_key.offset = offset;
+	} else {
+	    // Without the file's identity we can't safely share blocks.
+	    use_block_cache = false;
+	}
+    }
+
     basic_open(root_info, rev);
 
     read_root();
 }
 
+void
+GlassTable::set_mmap()
+{
+    LOGCALL_VOID(DB, "GlassTable::set_mmap", NO_ARGS);
+    if (writable) return;
+    use_mmap = true;
+    if (!mapping && handle >= 0) map_file();
+}
+
+void
+GlassTable::set_block_cache(const char* uuid)
+{
+    LOGCALL_VOID(DB, "GlassTable::set_block_cache", NO_ARGS);
+    if (writable) return;
+    std::memcpy(cache_key.uuid, uuid, sizeof(cache_key.uuid));
+    use_block_cache = true;
+}
+
+void
+GlassTable::map_file()
+{
+    LOGCALL_VOID(DB, "GlassTable::map_file", NO_ARGS);
+    size_t size;
+    const char* base = io_mmap_rd(handle, size);
+    if (base) {
+	mapping = std::make_shared<Glass::MappedFile>(base, size);
+    } else {
+	// Just read blocks as usual.
+	mapping = nullptr;
+    }
+}
+
 void
 GlassTable::open(int flags_, const RootInfo & root_info,
 		 glass_revision_number_t rev)
@@ -2070,10 +2271,7 @@ GlassTable::prev_for_sequential(Glass::Cursor * C_, int /*dummy*/) const
 		// Block isn't in the built-in cursor, so the form on disk
 		// is valid, so read it to check if it's the next level 0
 		// block.
-		uint8_t * q = C_[0].init(block_size);
-		read_block(n, q);
-		p = q;
-		C_[0].set_n(n);
+		p = load_block(C_[0], n);
 	    }
 	    if (REVISION(p) > revision_number + writable) {
 		throw_overwritten();
@@ -2128,9 +2326,7 @@ GlassTable::next_for_sequential(Glass::Cursor * C_, int /*dummy*/) const
 		    p = q;
 		}
 	    } else {
-		uint8_t * q = C_[0].init(block_size);
-		read_block(n, q);
-		p = q;
+		p = load_block(C_[0], n);
 	    }
 	    if (REVISION(p) > revision_number + writable) {
 		throw_overwritten();
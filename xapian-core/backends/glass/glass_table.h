@@ -26,6 +26,7 @@
 #include <xapian/constants.h>
 #include <xapian/error.h>
 
+#include "glass_blockcache.h"
 #include "glass_freelist.h"
 #include "glass_cursor.h"
 #include "glass_defs.h"
@@ -39,8 +40,10 @@
 #include "common/compression_stream.h"
 
 #include <algorithm>
+#include <memory>
 #include <string>
 #include <string_view>
+#include <vector>
 
 namespace Glass {
 
@@ -447,6 +450,9 @@ class GlassTable {
     void do_open_to_read(const RootInfo * root_info,
 			 glass_revision_number_t rev);
 
+    /// Memory map the table's file for reading.
+    void map_file();
+
     /** Perform the opening operation to write. */
     void do_open_to_write(const RootInfo * root_info,
 			  glass_revision_number_t rev = 0);
@@ -488,6 +494,20 @@ class GlassTable {
 
     bool readahead_key(std::string_view key) const;
 
+    /** Readahead the leaf blocks containing several keys.
+     *
+     *  Unlike readahead_key(), this descends the B-tree.  At each level a
+     *  preread hint is issued for all the blocks needed at the level below
+     *  before any of them are actually read, so the reads are in progress
+     *  together rather than forming a chain of dependent reads per key.
+     *
+     *  @param keys	The keys to readahead.  This vector is sorted and
+     *			duplicates are removed.
+     *
+     *  Returns false if we can't readahead for this table.
+     */
+    bool readahead_keys(std::vector<std::string>& keys) const;
+
     /** Determine whether the btree exists on disk.
      */
     bool exists() const;
@@ -506,6 +526,32 @@ class GlassTable {
     void open(int flags_, const RootInfo & root_info,
 	      glass_revision_number_t rev);
 
+    /** Memory map the table when open to read.
+     *
+     *  Blocks are then used directly from a read-only shared mapping of the
+     *  file rather than read into buffers owned by each cursor, so cursors
+     *  in the same process share one copy of hot blocks.  Blocks beyond the
+     *  end of the file when it was mapped (e.g. written since by a
+     *  concurrent writer) are still read into buffers.  The mapping is
+     *  updated when the table is reopened.
+     *
+     *  Ignored for a table opened to write.
+     */
+    void set_mmap();
+
+    /** Share blocks with other tables open on the same file.
+     *
+     *  Blocks read when the table is open to read are looked up in and
+     *  added to the process-wide block cache (if it is enabled).
+     *
+     *  Ignored for a table opened to write.
+     *
+     *  @param uuid	The 16 byte UUID of the database (used to make sure
+     *			we never confuse blocks from a file which has been
+     *			deleted with one which reuses its inode).
+     */
+    void set_block_cache(const char* uuid);
+
     /** Return true if this table is open.
      *
      *  NB If the table is lazy and doesn't yet exist, returns false.
@@ -691,6 +737,22 @@ class GlassTable {
 	return (item_count == 0);
     }
 
+    /** Get keys which divide the table into parts of similar size.
+     *
+     *  The keys are taken from the branch items in the root block, or from
+     *  the level below that if the root has fewer than @a n items, so only
+     *  a few blocks need to be read.  Each key returned starts a subtree
+     *  of the B-tree, so the subtrees at the level the keys were found at
+     *  each hold roughly (get_entry_count() / (keys.size() + 1)) entries.
+     *
+     *  The keys are separators rather than actual keys in the table, and
+     *  may not be returned if the table only has a single level.
+     *
+     *  @param n	The number of keys wanted.
+     *  @param[out] keys	The keys in ascending order.
+     */
+    void get_split_keys(size_t n, std::vector<std::string>& keys) const;
+
     /** Get a cursor for reading from the table.
      *
      *  The cursor is owned by the caller - it is the caller's
@@ -743,6 +805,8 @@ class GlassTable {
     bool find(Glass::Cursor *) const;
     int delete_kt();
     void read_block(uint4 n, uint8_t *p) const;
+    void check_block(uint4 n, const uint8_t *p) const;
+    const uint8_t* load_block(Glass::Cursor& cur, uint4 n) const;
     void write_block(uint4 n, const uint8_t *p,
 		     bool appending = false) const;
     [[noreturn]]
@@ -915,6 +979,21 @@ class GlassTable {
     /// offset to start of table in file.
     off_t offset;
 
+    /// Should we memory map the table when open to read?
+    bool use_mmap;
+
+    /// Memory mapping of the file, or NULL if not mapped.
+    std::shared_ptr<const Glass::MappedFile> mapping;
+
+    /// Should blocks be looked up in and added to the shared block cache?
+    bool use_block_cache;
+
+    /** Key for this table's blocks in the shared block cache.
+     *
+     *  The block number is filled in for each lookup.
+     */
+    mutable Glass::BlockCache::Key cache_key;
+
     /* Debugging methods */
 //    void report_block_full(int m, int n, const uint8_t * p);
 };
@@ -41,17 +41,22 @@ GlassTermListTable::set_termlist(Xapian::docid did,
 				 Xapian::termcount doclen)
 {
     LOGCALL_VOID(DB, "GlassTermListTable::set_termlist", did | doc | doclen);
+    add(make_key(did), encode_termlist(doc, doclen));
+}
 
+string
+GlassTermListTable::encode_termlist(const Xapian::Document& doc,
+				    Xapian::termcount doclen)
+{
+    string tag;
     Xapian::doccount termlist_size = doc.termlist_count();
     if (termlist_size == 0) {
 	// doclen is sum(wdf) so should be zero if there are no terms.
 	Assert(doclen == 0);
 	Assert(doc.termlist_begin() == doc.termlist_end());
-	add(make_key(did), {});
-	return;
+	return tag;
     }
 
-    string tag;
     pack_uint(tag, doclen);
 
     Xapian::TermIterator t = doc.termlist_begin();
@@ -105,5 +110,5 @@ GlassTermListTable::set_termlist(Xapian::docid did,
 	}
     }
     AssertEq(termlist_size, 0);
-    add(make_key(did), tag);
+    return tag;
 }
@@ -28,6 +28,7 @@
 #include "pack.h"
 
 #include <string>
+#include <string_view>
 
 namespace Xapian {
 class Document;
@@ -67,6 +68,27 @@ class GlassTermListTable : public GlassTable {
     void set_termlist(Xapian::docid did, const Xapian::Document & doc,
 		      Xapian::termcount doclen);
 
+    /** Encode the termlist data for a document.
+     *
+     *  This doesn't access the table, so can be called from any thread.
+     *
+     *  @param doc	The Xapian::Document object to read term data from.
+     *  @param doclen	The document length.
+     *
+     *  @return The encoded termlist data.
+     */
+    static std::string encode_termlist(const Xapian::Document& doc,
+				       Xapian::termcount doclen);
+
+    /** Set the encoded termlist data for document @a did.
+     *
+     *  @param did	The docid to set the termlist data for.
+     *  @param tag	Termlist data from encode_termlist().
+     */
+    void set_termlist(Xapian::docid did, std::string_view tag) {
+	add(make_key(did), tag);
+    }
+
     /** Delete the termlist data for document @a did.
      *
      *  @param did  The docid to delete the termlist data for.
@@ -281,6 +281,9 @@ class GlassVersion {
     bool single_file() const { return db_dir.empty(); }
 
     off_t get_offset() const { return offset; }
+
+    /// The fd of a single-file database.
+    int get_fd() const { return fd; }
 };
 
 #endif // XAPIAN_INCLUDED_GLASS_VERSION_H
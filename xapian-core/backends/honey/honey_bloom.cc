@@ -0,0 +1,116 @@
+/** @file
+ * @brief Bloom filter over the keys in a honey table
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "honey_bloom.h"
+
+#include "wordaccess.h"
+#include "xapian/error.h"
+
+#include <algorithm>
+
+using namespace std;
+
+/** Number of bits in the filter per key.
+ *
+ *  With the optimal number of hash functions (BLOOM_HASHES) this gives a
+ *  false positive rate of about 0.8%.
+ */
+#define BLOOM_BITS_PER_KEY 10
+
+/// Number of hash functions to use.
+#define BLOOM_HASHES 7
+
+uint64_t
+HoneyBloomFilter::hash(string_view key)
+{
+    // FNV-1a followed by the 64-bit finaliser from MurmurHash3 to mix the
+    // bits of short keys well.  The hash is used in the on-disk format, so
+    // it must not change.
+    uint64_t h = 14695981039346656037ull;
+    for (unsigned char ch : key) {
+	h ^= ch;
+	h *= 1099511628211ull;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+string
+HoneyBloomFilter::build()
+{
+    // Round up to a whole number of bytes, and use at least 64 bits so tiny
+    // filters aren't mostly ones.
+    uint64_t n_bits = max(uint64_t(key_hashes.size()) * BLOOM_BITS_PER_KEY,
+			  uint64_t(64));
+    uint64_t n_bytes = (n_bits + 7) / 8;
+    if (n_bytes > 0xffffffff)
+	throw Xapian::DatabaseError("Too many keys for bloom filter");
+    n_bits = n_bytes * 8;
+    n_hashes = BLOOM_HASHES;
+
+    string result(HEADER_SIZE + n_bytes, '\0');
+    result[0] = char(n_hashes);
+    unaligned_write4(reinterpret_cast<unsigned char*>(&result[1]),
+		     uint32_t(n_bytes));
+    char* p = &result[HEADER_SIZE];
+    for (uint64_t h : key_hashes) {
+	// Use double hashing to derive the hash functions from one hash.
+	uint64_t delta = (h >> 33) | 1;
+	for (unsigned i = 0; i != n_hashes; ++i) {
+	    uint64_t bit = h % n_bits;
+	    p[bit >> 3] |= char(1 << (bit & 7));
+	    h += delta;
+	}
+    }
+    key_hashes = vector<uint64_t>();
+    bits.assign(p, n_bytes);
+    return result;
+}
+
+bool
+HoneyBloomFilter::unserialise_header(const char* p, size_t& size)
+{
+    n_hashes = static_cast<unsigned char>(p[0]);
+    size = unaligned_read4(reinterpret_cast<const unsigned char*>(p + 1));
+    return n_hashes != 0 && size != 0;
+}
+
+bool
+HoneyBloomFilter::may_contain(string_view key) const
+{
+    if (bits.empty())
+	return true;
+    uint64_t n_bits = uint64_t(bits.size()) * 8;
+    uint64_t h = hash(key);
+    uint64_t delta = (h >> 33) | 1;
+    for (unsigned i = 0; i != n_hashes; ++i) {
+	uint64_t bit = h % n_bits;
+	if (!(static_cast<unsigned char>(bits[bit >> 3]) & (1 << (bit & 7))))
+	    return false;
+	h += delta;
+    }
+    return true;
+}
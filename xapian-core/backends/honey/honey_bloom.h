@@ -0,0 +1,98 @@
+/** @file
+ * @brief Bloom filter over the keys in a honey table
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef XAPIAN_INCLUDED_HONEY_BLOOM_H
+#define XAPIAN_INCLUDED_HONEY_BLOOM_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/** Bloom filter over the keys in a honey table.
+ *
+ *  This allows most lookups of keys which aren't in the table to be answered
+ *  without reading from the table.
+ *
+ *  The serialised form is a byte giving the number of hash functions, the
+ *  size of the bit array in bytes as a 4 byte big-endian integer, and then
+ *  the bit array.
+ */
+class HoneyBloomFilter {
+    /// The bit array (empty if there's no filter).
+    std::string bits;
+
+    /// The number of hash functions.
+    unsigned n_hashes = 0;
+
+    /// Hashes of the keys added while building the filter.
+    std::vector<std::uint64_t> key_hashes;
+
+    static std::uint64_t hash(std::string_view key);
+
+  public:
+    /// The size of the header of the serialised form.
+    static constexpr unsigned HEADER_SIZE = 5;
+
+    /// Return true if there's no filter.
+    bool empty() const { return bits.empty(); }
+
+    /// The size of the bit array in bytes (0 if there's no filter).
+    std::size_t size() const { return bits.size(); }
+
+    /// Remove the filter, and any keys added.
+    void clear() {
+	bits = std::string();
+	n_hashes = 0;
+	key_hashes = std::vector<std::uint64_t>();
+    }
+
+    /// Add a key to the filter being built.
+    void add(std::string_view key) { key_hashes.push_back(hash(key)); }
+
+    /** Build a filter from the added keys and return it in serialised form.
+     *
+     *  The keys added are discarded.
+     */
+    std::string build();
+
+    /** Decode the header of a serialised filter.
+     *
+     *  @param p	    Pointer to HEADER_SIZE bytes.
+     *  @param[out] size    The size of the bit array which follows.
+     *
+     *  @return false if the header isn't valid.
+     */
+    bool unserialise_header(const char* p, std::size_t& size);
+
+    /** Set the bit array.
+     *
+     *  Must be called after a successful call to unserialise_header().
+     */
+    void set_bits(std::string&& bits_) { bits = std::move(bits_); }
+
+    /** Might @a key be present?
+     *
+     *  Returns true if there's no filter.
+     */
+    bool may_contain(std::string_view key) const;
+};
+
+#endif // XAPIAN_INCLUDED_HONEY_BLOOM_H
@@ -26,7 +26,11 @@
 #include "xapian/types.h"
 
 #include <algorithm>
+#include <functional>
+#include <future>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <queue>
 #include <type_traits>
 
@@ -45,8 +49,10 @@
 #include "internaltypes.h"
 #include "overflow.h"
 #include "pack.h"
+#include "runtasks.h"
 #include "stringutils.h"
 #include "backends/valuestats.h"
+#include "backends/wildcardindex.h"
 #include "wordaccess.h"
 
 #include "../byte_length_strings.h"
@@ -61,6 +67,8 @@
 using namespace std;
 using Honey::encode_valuestats;
 
+typedef WildcardKeys<HoneyTable, HoneyCursor> HoneyWildcardKeys;
+
 [[noreturn]]
 static void
 throw_database_corrupt(const char* item, const char* pos)
@@ -96,6 +104,12 @@ is_valuechunk_key(const string& key)
     return key.size() > 1 && key[0] == '\0' && key[1] == '\xd8';
 }
 
+static inline bool
+is_wildcard_index_key(const string& key)
+{
+    return key.size() > 1 && key[0] == '\0' && key[1] == '\xdc';
+}
+
 static inline bool
 is_doclenchunk_key(const string& key)
 {
@@ -309,6 +323,9 @@ class PostlistCursor<const GlassTable&> : private GlassCursor {
 
     Xapian::valueno slot;
 
+    /// End of the range of keys to iterate (empty for no limit).
+    string hi;
+
   public:
     string key, tag;
     Xapian::docid firstdid;
@@ -318,10 +335,20 @@ class PostlistCursor<const GlassTable&> : private GlassCursor {
     Xapian::termcount wdf_max;
     bool have_wdfs;
 
-    PostlistCursor(const GlassTable* in, Xapian::docid offset_)
-	: GlassCursor(in), offset(offset_), firstdid(0)
+    /** Iterate entries with keys in the range [lo, hi).
+     *
+     *  An empty @a lo means from the start and an empty @a hi means to the
+     *  end.
+     */
+    PostlistCursor(const GlassTable* in, Xapian::docid offset_,
+		   const string& lo, const string& hi_)
+	: GlassCursor(in), offset(offset_), hi(hi_), firstdid(0)
     {
-	rewind();
+	if (lo.empty()) {
+	    rewind();
+	} else {
+	    find_entry_lt(lo);
+	}
     }
 
     bool next() {
@@ -416,6 +443,7 @@ start_value_chunk:
 	}
 
 	if (!GlassCursor::next()) return false;
+	if (!hi.empty() && current_key >= hi) return false;
 
 	if (GlassCompact::is_valuestats_key(current_key)) {
 	    // Set value_stats_count to one more than the number of entries so
@@ -455,6 +483,12 @@ start_value_chunk:
 	    return true;
 	}
 
+	if (GlassCompact::is_wildcard_index_key(key)) {
+	    // The format of the rest of the key is the same for honey.
+	    key[1] = Honey::KEY_WILDCARD_INDEX;
+	    return true;
+	}
+
 	if (GlassCompact::is_doclenchunk_key(key)) {
 	    const char* d = key.data();
 	    const char* e = d + key.size();
@@ -591,6 +625,12 @@ template<>
 class PostlistCursor<const HoneyTable&> : private HoneyCursor {
     Xapian::docid offset;
 
+    /// End of the range of keys to iterate (empty for no limit).
+    string hi;
+
+    /// Is the cursor already on the first entry to return?
+    bool positioned = false;
+
   public:
     string key, tag;
     Xapian::docid firstdid;
@@ -601,14 +641,33 @@ class PostlistCursor<const HoneyTable&> : private HoneyCursor {
     Xapian::termcount wdf_max;
     bool have_wdfs;
 
-    PostlistCursor(const HoneyTable* in, Xapian::docid offset_)
-	: HoneyCursor(in), offset(offset_), firstdid(0)
+    /** Iterate entries with keys in the range [lo, hi).
+     *
+     *  An empty @a lo means from the start and an empty @a hi means to the
+     *  end.
+     */
+    PostlistCursor(const HoneyTable* in, Xapian::docid offset_,
+		   const string& lo, const string& hi_)
+	: HoneyCursor(in), offset(offset_), hi(hi_), firstdid(0)
     {
-	rewind();
+	if (lo.empty()) {
+	    rewind();
+	} else {
+	    // HoneyCursor doesn't support find_entry_lt() so we position on
+	    // the first entry in the range instead.
+	    find_entry_ge(lo);
+	    positioned = true;
+	}
     }
 
     bool next() {
-	if (!HoneyCursor::next()) return false;
+	if (positioned) {
+	    positioned = false;
+	    if (after_end()) return false;
+	} else {
+	    if (!HoneyCursor::next()) return false;
+	}
+	if (!hi.empty() && current_key >= hi) return false;
 	// We put all chunks into the non-initial chunk form here, then fix up
 	// the first chunk for each term in the merged database as we merge.
 	read_tag();
@@ -617,6 +676,7 @@ class PostlistCursor<const HoneyTable&> : private HoneyCursor {
 	switch (key_type(key)) {
 	    case Honey::KEY_USER_METADATA:
 	    case Honey::KEY_VALUE_STATS:
+	    case Honey::KEY_WILDCARD_INDEX:
 		return true;
 	    case Honey::KEY_VALUE_CHUNK: {
 		const char* p = key.data();
@@ -673,9 +733,12 @@ class PostlistCursor<const HoneyTable&> : private HoneyCursor {
 	    e = d + tag.size();
 
 	    Xapian::docid lastdid;
+	    // We recalculate the block bounds when merging.
+	    Xapian::termcount chunk_wdf_max, chunk_doclen_min;
 	    if (!decode_initial_chunk_header(&d, e, tf, cf,
 					     firstdid, lastdid, chunk_lastdid,
-					     first_wdf, wdf_max)) {
+					     first_wdf, wdf_max,
+					     chunk_wdf_max, chunk_doclen_min)) {
 		throw Xapian::DatabaseCorruptError("Bad postlist initial "
 						   "chunk header");
 	    }
@@ -728,15 +791,19 @@ class PostlistCursor<const HoneyTable&> : private HoneyCursor {
 	    d = tag.data();
 	    e = d + tag.size();
 
+	    // We recalculate the block bounds when merging.
+	    Xapian::termcount chunk_wdf_max, chunk_doclen_min;
 	    if (have_wdfs) {
 		if (!decode_delta_chunk_header(&d, e, chunk_lastdid, firstdid,
-					       first_wdf)) {
+					       first_wdf, chunk_wdf_max,
+					       chunk_doclen_min)) {
 		    throw Xapian::DatabaseCorruptError("Bad postlist delta "
 						       "chunk header");
 		}
 	    } else {
 		if (!decode_delta_chunk_header_no_wdf(&d, e, chunk_lastdid,
-						      firstdid)) {
+						      firstdid,
+						      chunk_doclen_min)) {
 		    throw Xapian::DatabaseCorruptError("Bad postlist delta "
 						       "chunk header");
 		}
@@ -752,8 +819,9 @@ class PostlistCursor<const HoneyTable&> : private HoneyCursor {
 template<>
 class PostlistCursor<HoneyTable&> : public PostlistCursor<const HoneyTable&> {
   public:
-    PostlistCursor(HoneyTable* in, Xapian::docid offset_)
-	: PostlistCursor<const HoneyTable&>(in, offset_) {}
+    PostlistCursor(HoneyTable* in, Xapian::docid offset_,
+		   const string& lo, const string& hi_)
+	: PostlistCursor<const HoneyTable&>(in, offset_, lo, hi_) {}
 };
 
 template<typename T>
@@ -768,11 +836,87 @@ class PostlistCursorGt {
     }
 };
 
+/** Look up document lengths in the merged doclen chunks.
+ *
+ *  Used to calculate the document length lower bound stored for each posting
+ *  chunk.  We keep the encoded chunks, so this needs about as much memory as
+ *  the doclen data in the output table.
+ *
+ *  Copies share the chunks, and once all the chunks have been added each
+ *  copy can be used by a different thread.
+ */
+class DoclenLookup {
+    typedef map<Xapian::docid, string> chunk_map;
+
+    /// Encoded doclen chunks, indexed by the last docid in each.
+    shared_ptr<chunk_map> chunks = make_shared<chunk_map>();
+
+    /// The chunk the previous lookup was in.
+    chunk_map::const_iterator cached = chunks->end();
+
+    /// The first docid in @a cached.
+    Xapian::docid cached_first = 0;
+
+  public:
+    /// Add a doclen chunk in the format used in the postlist table.
+    void add(Xapian::docid chunk_last, const string& chunk) {
+	chunks->emplace(chunk_last, chunk);
+	cached = chunks->end();
+    }
+
+    /** Return the length of document @a did.
+     *
+     *  If @a did isn't found, 0 is returned (which is always a valid lower
+     *  bound).
+     */
+    Xapian::termcount get(Xapian::docid did) {
+	if (cached == chunks->end() ||
+	    did < cached_first || did > cached->first) {
+	    cached = chunks->lower_bound(did);
+	    if (cached == chunks->end()) return 0;
+	    const string& chunk = cached->second;
+	    size_t width = static_cast<unsigned char>(chunk[0]) / 8;
+	    cached_first = cached->first - (chunk.size() - 1) / width + 1;
+	    if (did < cached_first) return 0;
+	}
+	const string& chunk = cached->second;
+	size_t width = static_cast<unsigned char>(chunk[0]) / 8;
+	const char* q = chunk.data() + 1 + (did - cached_first) * width;
+	Xapian::termcount len = 0;
+	Xapian::termcount missing = 0;
+	for (size_t i = 0; i != width; ++i) {
+	    len = (len << 8) | static_cast<unsigned char>(q[i]);
+	    missing = (missing << 8) | 0xff;
+	}
+	// All bits set is used for a docid which isn't in use.
+	return len == missing ? 0 : len;
+    }
+};
+
+/** Merge postlist tables.
+ *
+ *  If @a lo or @a hi are non-empty, only entries with keys in the range
+ *  [lo, hi) are merged.  These must be keys for the first chunk of a term
+ *  so that all the chunks for a term are in the same range.
+ *
+ *  @param wildcard_keys	NULL if the output shouldn't have a wildcard
+ *				index, otherwise wildcard index keys to add to
+ *				those from the inputs.
+ *  @param doclens_out	If non-NULL, set to the merged document lengths once
+ *			they have been merged.
+ *  @param doclens_in	If valid, the document lengths to use, for merging a
+ *			range which doesn't include them.
+ */
 // U : vector<HoneyTable*>::const_iterator
 template<typename T, typename U> void
 merge_postlists(Xapian::Compactor* compactor,
 		T* out, vector<Xapian::docid>::const_iterator offset,
-		U b, U e)
+		U b, U e,
+		HoneyWildcardKeys* wildcard_keys,
+		const string& lo = string(),
+		const string& hi = string(),
+		promise<DoclenLookup>* doclens_out = nullptr,
+		shared_future<DoclenLookup> doclens_in = {})
 {
     typedef decltype(**b) table_type; // E.g. HoneyTable
     typedef PostlistCursor<table_type> cursor_type;
@@ -780,7 +924,7 @@ merge_postlists(Xapian::Compactor* compactor,
     priority_queue<cursor_type*, vector<cursor_type*>, gt_type> pq;
     for ( ; b != e; ++b, ++offset) {
 	auto in = *b;
-	auto cursor = new cursor_type(in, *offset);
+	auto cursor = new cursor_type(in, *offset, lo, hi);
 	if (cursor->next()) {
 	    pq.push(cursor);
 	} else {
@@ -928,7 +1072,40 @@ merge_postlists(Xapian::Compactor* compactor,
 	}
     }
 
-    // Merge doclen chunks.
+    {
+	// Merge the wildcard index entries, dropping duplicates (or all of
+	// them if the output won't have a wildcard index).
+	while (true) {
+	    cursor_type* cur = nullptr;
+	    if (!pq.empty() &&
+		key_type(pq.top()->key) == Honey::KEY_WILDCARD_INDEX)
+		cur = pq.top();
+	    const string* w = wildcard_keys ? wildcard_keys->get() : nullptr;
+	    string key;
+	    if (cur && (!w || cur->key <= *w)) {
+		key = cur->key;
+		pq.pop();
+		if (cur->next()) {
+		    pq.push(cur);
+		} else {
+		    delete cur;
+		}
+	    } else if (w) {
+		key = *w;
+		wildcard_keys->next();
+	    } else {
+		break;
+	    }
+	    if (wildcard_keys && key != last_key) {
+		out->add(key, WILDCARD_INDEX_TAG);
+		last_key = key;
+	    }
+	}
+    }
+
+    // Merge doclen chunks, keeping a copy so we can calculate the document
+    // length bounds for the posting chunks.
+    DoclenLookup doclens;
     while (!pq.empty()) {
 	cursor_type* cur = pq.top();
 	if (key_type(cur->key) != Honey::KEY_DOCLEN_CHUNK) break;
@@ -996,6 +1173,12 @@ merge_postlists(Xapian::Compactor* compactor,
 	    }
 	}
 	out->add(Honey::make_doclenchunk_key(chunk_lastdid), tag);
+	doclens.add(chunk_lastdid, tag);
+    }
+    if (doclens_in.valid()) {
+	doclens = doclens_in.get();
+    } else if (doclens_out) {
+	doclens_out->set_value(doclens);
     }
 
     struct HoneyPostListChunk {
@@ -1052,6 +1235,48 @@ merge_postlists(Xapian::Compactor* compactor,
 	    return data.size() * 2u;
 	}
 
+	/** Calculate bounds on the wdf and document length for this chunk.
+	 *
+	 *  @param doclens	    Document length lookup.
+	 *  @param[out] chunk_wdf_max	  Upper bound on wdf of the postings.
+	 *  @param[out] chunk_doclen_min  Lower bound on document length of the
+	 *				  postings.
+	 */
+	void get_bounds(DoclenLookup& doclens,
+			Xapian::termcount& chunk_wdf_max,
+			Xapian::termcount& chunk_doclen_min) const {
+	    chunk_wdf_max = first_wdf;
+	    chunk_doclen_min = doclens.get(first);
+	    if (data.empty()) {
+		if (tf == 2) {
+		    chunk_wdf_max = max(first_wdf, cf - first_wdf);
+		    chunk_doclen_min = min(chunk_doclen_min, doclens.get(last));
+		}
+		return;
+	    }
+
+	    if (!have_wdfs) {
+		// The wdfs are implicit, so use the bound we were given.
+		chunk_wdf_max = max(first_wdf, wdf_max);
+	    }
+	    Xapian::docid did = first;
+	    const char* pos = data.data();
+	    const char* pos_end = pos + data.size();
+	    while (pos != pos_end) {
+		Xapian::docid delta;
+		if (!unpack_uint(&pos, pos_end, &delta))
+		    throw_database_corrupt("Decoding docid delta", pos);
+		did += delta + 1;
+		if (have_wdfs) {
+		    Xapian::termcount wdf;
+		    if (!unpack_uint(&pos, pos_end, &wdf))
+			throw_database_corrupt("Decoding wdf", pos);
+		    chunk_wdf_max = max(chunk_wdf_max, wdf);
+		}
+		chunk_doclen_min = min(chunk_doclen_min, doclens.get(did));
+	    }
+	}
+
 	/// Append postings to tag, which should only contain the chunk header.
 	void append_postings_to(string& tag, bool want_wdfs) {
 	    if (data.empty()) {
@@ -1179,10 +1404,30 @@ merge_postlists(Xapian::Compactor* compactor,
 
 		chunk_lastdid = tags[j - 1].last;
 
+		// Calculate the bounds for the chunk formed from tags [i,j).
+		auto chunk_bounds = [&](size_t i, size_t j_,
+					Xapian::termcount& chunk_wdf_max,
+					Xapian::termcount& chunk_doclen_min) {
+		    tags[i].get_bounds(doclens, chunk_wdf_max,
+				       chunk_doclen_min);
+		    while (++i != j_) {
+			Xapian::termcount w, l;
+			tags[i].get_bounds(doclens, w, l);
+			chunk_wdf_max = max(chunk_wdf_max, w);
+			chunk_doclen_min = min(chunk_doclen_min, l);
+		    }
+		    chunk_wdf_max = min(chunk_wdf_max, wdf_max);
+		};
+
+		Xapian::termcount chunk_wdf_max, chunk_doclen_min;
+		chunk_bounds(0, j, chunk_wdf_max, chunk_doclen_min);
+
 		string first_tag;
 		encode_initial_chunk_header(tf, cf, tags[0].first, last_did,
 					    chunk_lastdid,
-					    first_wdf, wdf_max, first_tag);
+					    first_wdf, wdf_max,
+					    chunk_wdf_max, chunk_doclen_min,
+					    first_tag);
 
 		if (tf > 2) {
 		    // If tf <= 2 there's no explicit posting data.
@@ -1215,15 +1460,19 @@ merge_postlists(Xapian::Compactor* compactor,
 			}
 
 			last_did = tags[j - 1].last;
+			chunk_bounds(i, j, chunk_wdf_max, chunk_doclen_min);
 			string tag;
 			if (have_wdfs) {
 			    encode_delta_chunk_header(tags[i].first,
 						      last_did,
 						      tags[i].first_wdf,
+						      chunk_wdf_max,
+						      chunk_doclen_min,
 						      tag);
 			} else {
 			    encode_delta_chunk_header_no_wdf(tags[i].first,
 							     last_did,
+							     chunk_doclen_min,
 							     tag);
 			}
 
@@ -1269,12 +1518,39 @@ merge_postlists(Xapian::Compactor* compactor,
     }
 }
 
+/** Can compressed tags from @a in be copied to @a out as they are?
+ *
+ *  They can if both tables use the same compression method and dictionary.
+ */
+static bool
+can_copy_compressed(const HoneyTable* in, const HoneyTable* out)
+{
+    if (in->get_compression() != out->get_compression()) return false;
+    auto in_dict = in->get_dictionary();
+    auto out_dict = out->get_dictionary();
+    if (!in_dict || !out_dict) return in_dict == out_dict;
+    return in_dict->get_data() == out_dict->get_data();
+}
+
+#ifdef XAPIAN_HAS_GLASS_BACKEND
+static bool
+can_copy_compressed(const GlassTable*, const HoneyTable* out)
+{
+    // Glass always compresses tags with zlib.
+    return out->get_compression() == COMPRESSION_ZLIB && !out->get_dictionary();
+}
+#endif
+
 template<typename T> struct MergeCursor;
 
 #ifdef XAPIAN_HAS_GLASS_BACKEND
 template<>
 struct MergeCursor<const GlassTable&> : public GlassCursor {
-    explicit MergeCursor(const GlassTable* in) : GlassCursor(in) {
+    /// Can tags be copied to the output without decompressing them?
+    bool copy_compressed;
+
+    MergeCursor(const GlassTable* in, const HoneyTable* out)
+	: GlassCursor(in), copy_compressed(can_copy_compressed(in, out)) {
 	rewind();
     }
 };
@@ -1282,7 +1558,11 @@ struct MergeCursor<const GlassTable&> : public GlassCursor {
 
 template<>
 struct MergeCursor<const HoneyTable&> : public HoneyCursor {
-    explicit MergeCursor(const HoneyTable* in) : HoneyCursor(in) {
+    /// Can tags be copied to the output without decompressing them?
+    bool copy_compressed;
+
+    MergeCursor(const HoneyTable* in, const HoneyTable* out)
+	: HoneyCursor(in), copy_compressed(can_copy_compressed(in, out)) {
 	rewind();
     }
 };
@@ -1309,7 +1589,7 @@ merge_spellings(HoneyTable* out,
     priority_queue<cursor_type*, vector<cursor_type*>, gt_type> pq;
     for ( ; b != e; ++b) {
 	auto in = *b;
-	auto cursor = new cursor_type(in);
+	auto cursor = new cursor_type(in, out);
 	if (cursor->next()) {
 	    pq.push(cursor);
 	} else {
@@ -1411,7 +1691,7 @@ merge_spellings(HoneyTable* out,
 		    break;
 		}
 		default:
-		    compressed = cur->read_tag(true);
+		    compressed = cur->read_tag(cur->copy_compressed);
 		    break;
 	    }
 	    out->add(key, cur->current_tag, compressed);
@@ -1511,7 +1791,7 @@ merge_spellings(HoneyTable* out,
     priority_queue<cursor_type*, vector<cursor_type*>, gt_type> pq;
     for ( ; b != e; ++b) {
 	auto in = *b;
-	auto cursor = new cursor_type(in);
+	auto cursor = new cursor_type(in, out);
 	if (cursor->next()) {
 	    pq.push(cursor);
 	} else {
@@ -1528,7 +1808,7 @@ merge_spellings(HoneyTable* out,
 	if (pq.empty() || pq.top()->current_key > key) {
 	    // No need to merge the tags, just copy the (possibly compressed)
 	    // tag value.
-	    bool compressed = cur->read_tag(true);
+	    bool compressed = cur->read_tag(cur->copy_compressed);
 	    out->add(key, cur->current_tag, compressed);
 	    if (cur->next()) {
 		pq.push(cur);
@@ -1626,7 +1906,7 @@ merge_synonyms(T* out, U b, U e)
     priority_queue<cursor_type*, vector<cursor_type*>, gt_type> pq;
     for ( ; b != e; ++b) {
 	auto in = *b;
-	auto cursor = new cursor_type(in);
+	auto cursor = new cursor_type(in, out);
 	if (cursor->next()) {
 	    pq.push(cursor);
 	} else {
@@ -1643,7 +1923,7 @@ merge_synonyms(T* out, U b, U e)
 	if (pq.empty() || pq.top()->current_key > key) {
 	    // No need to merge the tags, just copy the (possibly compressed)
 	    // tag value.
-	    bool compressed = cur->read_tag(true);
+	    bool compressed = cur->read_tag(cur->copy_compressed);
 	    out->add(key, cur->current_tag, compressed);
 	    if (cur->next()) {
 		pq.push(cur);
@@ -1707,12 +1987,19 @@ template<typename T, typename U> void
 multimerge_postlists(Xapian::Compactor* compactor,
 		     T* out, const char* tmpdir,
 		     const vector<U*>& in,
-		     vector<Xapian::docid> off)
+		     vector<Xapian::docid> off,
+		     HoneyWildcardKeys* wildcard_keys)
 {
     if (in.size() <= 3) {
-	merge_postlists(compactor, out, off.begin(), in.begin(), in.end());
+	merge_postlists(compactor, out, off.begin(), in.begin(), in.end(),
+			wildcard_keys);
 	return;
     }
+    // Keep any wildcard index entries from the inputs in the temporary tables
+    // if the output needs them, but only add wildcard_keys in the final pass.
+    HoneyWildcardKeys no_keys;
+    no_keys.start();
+    HoneyWildcardKeys* tmp_wildcard_keys = wildcard_keys ? &no_keys : nullptr;
     unsigned int c = 0;
     vector<HoneyTable*> tmp;
     tmp.reserve(in.size() / 2);
@@ -1741,7 +2028,8 @@ multimerge_postlists(Xapian::Compactor* compactor,
 	    tmptab->create_and_open(flags, root_info);
 
 	    merge_postlists(compactor, tmptab, off.begin() + i,
-			    in.begin() + i, in.begin() + j);
+			    in.begin() + i, in.begin() + j,
+			    tmp_wildcard_keys);
 	    tmp.push_back(tmptab);
 	    tmptab->flush_db();
 	    tmptab->commit(1, &root_info);
@@ -1777,7 +2065,8 @@ multimerge_postlists(Xapian::Compactor* compactor,
 	    tmptab->create_and_open(flags, root_info);
 
 	    merge_postlists(compactor, tmptab, off.begin() + i,
-			    tmp.begin() + i, tmp.begin() + j);
+			    tmp.begin() + i, tmp.begin() + j,
+			    tmp_wildcard_keys);
 	    if (c > 0) {
 		for (unsigned int k = i; k < j; ++k) {
 		    // FIXME: unlink(tmp[k]->get_path().c_str());
@@ -1793,7 +2082,8 @@ multimerge_postlists(Xapian::Compactor* compactor,
 	swap(off, newoff);
 	++c;
     }
-    merge_postlists(compactor, out, off.begin(), tmp.begin(), tmp.end());
+    merge_postlists(compactor, out, off.begin(), tmp.begin(), tmp.end(),
+		    wildcard_keys);
     if (c > 0) {
 	for (size_t k = 0; k < tmp.size(); ++k) {
 	    // FIXME: unlink(tmp[k]->get_path().c_str());
@@ -1803,6 +2093,238 @@ multimerge_postlists(Xapian::Compactor* compactor,
     }
 }
 
+/** Pick keys to split merging postlist tables into @a n ranges.
+ *
+ *  @param samples	Candidate keys, each with an estimate of the amount of
+ *			data between it and the previous candidate from the
+ *			same input.
+ *  @param total	Estimate of the total amount of data.
+ *
+ *  @return Up to (n - 1) keys in ascending order.
+ */
+static vector<string>
+pick_split_keys(vector<pair<string, double>>& samples, double total,
+		unsigned n)
+{
+    sort(samples.begin(), samples.end());
+    vector<string> splits;
+    double before = 0;
+    unsigned next = 1;
+    for (auto&& sample : samples) {
+	before += sample.second;
+	if (before < total * next / n) continue;
+	if (splits.empty() || sample.first != splits.back())
+	    splits.push_back(sample.first);
+	while (next < n && before >= total * next / n) ++next;
+	if (next == n) break;
+    }
+    return splits;
+}
+
+#ifdef XAPIAN_HAS_GLASS_BACKEND
+/** Pick keys to split merging glass postlist tables into @a n ranges.
+ *
+ *  The keys are picked based on the branch keys near the root of each input
+ *  table, and each is the key of the first chunk of a term.
+ */
+static vector<string>
+postlist_split_keys(const vector<const GlassTable*>& inputs, unsigned n)
+{
+    vector<pair<string, double>> samples;
+    double total = 0;
+    for (auto in : inputs) {
+	vector<string> keys;
+	// Get more keys than we need so that we can divide more evenly.
+	in->get_split_keys(n * 4, keys);
+	if (keys.empty()) continue;
+	double entries = in->get_entry_count();
+	total += entries;
+	double weight = entries / (keys.size() + 1);
+	for (const string& key : keys) {
+	    // User metadata, value statistics, value chunks and document
+	    // length chunks have keys starting with a zero byte (as do terms
+	    // starting with a zero byte) so these always go in the first
+	    // range.
+	    if (key[0] == '\0') continue;
+	    const char* p = key.data();
+	    const char* end = p + key.size();
+	    string term;
+	    (void)unpack_string_preserving_sort(&p, end, term);
+	    samples.emplace_back(pack_honey_postlist_key(term), weight);
+	}
+    }
+    return pick_split_keys(samples, total, n);
+}
+#endif
+
+/** Pick keys to split merging honey postlist tables into @a n ranges.
+ *
+ *  The keys are picked based on the index of each input table, which means
+ *  splitting on the first byte of the key for an array index, or at the
+ *  partitions of a partitioned index.  Each is adjusted to the key of the
+ *  first chunk of a term so a term's chunks all end up in the same range.
+ */
+static vector<string>
+postlist_split_keys(const vector<const HoneyTable*>& inputs, unsigned n)
+{
+    vector<pair<string, double>> samples;
+    double total = 0;
+    for (auto in : inputs) {
+	vector<pair<string, off_t>> ranges;
+	in->get_key_ranges(ranges);
+	for (size_t i = 0; i != ranges.size(); ++i) {
+	    double size = ranges[i].second;
+	    total += size;
+	    if (i + 1 == ranges.size()) continue;
+	    const string& key = ranges[i + 1].first;
+	    // Keys starting with a zero byte always go in the first range -
+	    // see above.
+	    if (key[0] == '\0') continue;
+	    const char* p = key.data();
+	    const char* end = p + key.size();
+	    string term;
+	    (void)unpack_string_preserving_sort(&p, end, term);
+	    samples.emplace_back(pack_honey_postlist_key(term), size);
+	}
+    }
+    return pick_split_keys(samples, total, n);
+}
+
+/** Merge postlist tables concurrently in ranges of terms.
+ *
+ *  The first range (which includes the user metadata, value statistics,
+ *  value chunks and document lengths) is merged directly into the output
+ *  table, and the others into temporary tables which finish() copies onto
+ *  the end of the output table.  The other ranges need the merged document
+ *  lengths, so wait for the first range to get that far.
+ */
+template<typename T>
+class PostlistRanges {
+    /// The keys each range after the first starts at.
+    vector<string> splits;
+
+    /// Copies of the input tables for each range after the first.
+    vector<vector<const T*>> range_inputs;
+
+    vector<unique_ptr<T>> range_inputs_owned;
+
+    /// Temporary output tables for each range after the first.
+    vector<unique_ptr<HoneyTable>> range_tabs;
+
+    vector<Honey::RootInfo> range_root_infos;
+
+    promise<DoclenLookup> doclens;
+
+  public:
+    /** Add tasks to merge the postlist tables.
+     *
+     *  @param open_input   Function to open a copy of the postlist table
+     *			    for source i, since a table object can't be used
+     *			    by more than one thread at once.
+     */
+    void add_tasks(vector<function<void()>>& tasks,
+		   Xapian::Compactor* compactor,
+		   HoneyTable* out,
+		   const char* destdir,
+		   const vector<const T*>& inputs,
+		   const vector<Xapian::docid>& offset,
+		   HoneyWildcardKeys* wildcard_keys,
+		   unsigned n,
+		   const function<T*(size_t)>& open_input) {
+	splits = postlist_split_keys(inputs, n);
+	if (splits.empty()) {
+	    tasks.emplace_back([compactor, out, &inputs, &offset,
+				wildcard_keys]() {
+		merge_postlists(compactor, out, offset.begin(),
+				inputs.begin(), inputs.end(), wildcard_keys);
+	    });
+	    return;
+	}
+
+	// This needs to be the first task so that the tasks waiting for it
+	// can't use up all the threads.
+	tasks.emplace_back([this, compactor, out, &inputs, &offset,
+			    wildcard_keys]() {
+	    try {
+		merge_postlists(compactor, out, offset.begin(),
+				inputs.begin(), inputs.end(), wildcard_keys,
+				string(), splits[0], &doclens);
+	    } catch (...) {
+		// Don't leave the other tasks waiting for the document
+		// lengths.
+		try {
+		    doclens.set_exception(current_exception());
+		} catch (const future_error&) {
+		    // We'd already set the document lengths.
+		}
+		throw;
+	    }
+	});
+
+	shared_future<DoclenLookup> doclens_in = doclens.get_future();
+	range_inputs.resize(splits.size());
+	range_tabs.resize(splits.size());
+	range_root_infos.resize(splits.size());
+	for (size_t r = 0; r != splits.size(); ++r) {
+	    for (size_t i = 0; i != inputs.size(); ++i) {
+		T* in = open_input(i);
+		range_inputs_owned.emplace_back(in);
+		range_inputs[r].push_back(in);
+	    }
+
+	    string dest = destdir;
+	    dest += "/tmprange";
+	    dest += str(r + 1);
+	    dest += '.';
+	    HoneyTable* tmptab = new HoneyTable("postlist", dest, false);
+	    range_tabs[r].reset(tmptab);
+
+	    // Don't compress entries in temporary tables, even if the final
+	    // table would do so.
+	    Honey::RootInfo& root_info = range_root_infos[r];
+	    root_info.init(0);
+	    tmptab->create_and_open(Xapian::DB_DANGEROUS|Xapian::DB_NO_SYNC,
+				    root_info);
+
+	    tasks.emplace_back([this, compactor, r, tmptab, &offset,
+				doclens_in]() {
+		const auto& in = range_inputs[r];
+		merge_postlists(compactor, tmptab, offset.begin(),
+				in.begin(), in.end(), nullptr,
+				splits[r],
+				r + 1 < splits.size() ? splits[r + 1] : string(),
+				nullptr, doclens_in);
+		tmptab->flush_db();
+		tmptab->commit(1, &range_root_infos[r]);
+	    });
+	}
+    }
+
+    /** Copy the ranges merged to temporary tables onto the end of @a out.
+     *
+     *  Must be called after all the tasks have been run.
+     */
+    void finish(HoneyTable* out) {
+	for (auto&& tmptab : range_tabs) {
+	    HoneyCursor cur(tmptab.get());
+	    cur.rewind();
+	    while (cur.next()) {
+		bool compressed = cur.read_tag(true);
+		out->add(cur.current_key, cur.current_tag, compressed);
+	    }
+	    unlink(tmptab->get_path().c_str());
+	    tmptab.reset();
+	}
+    }
+
+    /// Clean up if we didn't get to call finish().
+    ~PostlistRanges() {
+	for (auto&& tmptab : range_tabs) {
+	    if (tmptab) unlink(tmptab->get_path().c_str());
+	}
+    }
+};
+
 template<typename T> class PositionCursor;
 
 #ifdef XAPIAN_HAS_GLASS_BACKEND
@@ -1933,6 +2455,7 @@ merge_docid_keyed(T* out, const vector<U*>& inputs,
 	auto in = inputs[i];
 	HoneyCursor cur(in);
 	cur.rewind();
+	bool copy_compressed = can_copy_compressed(in, out);
 
 	string key;
 	while (cur.next()) {
@@ -1957,7 +2480,7 @@ merge_docid_keyed(T* out, const vector<U*>& inputs,
 	    } else {
 		key = cur.current_key;
 	    }
-	    bool compressed = cur.read_tag(true);
+	    bool compressed = cur.read_tag(copy_compressed);
 	    out->add(key, cur.current_tag, compressed);
 	}
     }
@@ -1978,6 +2501,7 @@ merge_docid_keyed(T* out, const vector<const GlassTable*>& inputs,
 
 	GlassCursor cur(in);
 	cur.rewind();
+	bool copy_compressed = can_copy_compressed(in, out);
 
 	string key;
 	while (cur.next()) {
@@ -2152,7 +2676,7 @@ next_without_next:
 		if (!next_result) break;
 		if (next_already_done) goto next_without_next;
 	    } else {
-		bool compressed = cur.read_tag(true);
+		bool compressed = cur.read_tag(copy_compressed);
 		out->add(key, cur.current_tag, compressed);
 	    }
 	}
@@ -2164,6 +2688,134 @@ next_without_next:
 
 using namespace HoneyCompact;
 
+/** Should a bloom filter be built for a table of type @a type?
+ *
+ *  Only worthwhile for tables where lookups of keys which aren't present are
+ *  common.
+ */
+static bool
+uses_bloom_filter(Honey::table_type type)
+{
+    return type == Honey::POSTLIST ||
+	   type == Honey::SPELLING ||
+	   type == Honey::SYNONYM;
+}
+
+/// Maximum size of compression dictionary to train.
+#define COMPRESSION_DICT_MAX_SIZE (112 * 1024)
+
+/// Maximum number of tags to train a compression dictionary from.
+#define COMPRESSION_DICT_MAX_SAMPLES 10000
+
+/** The compression method to use for a table of type @a type.
+ *
+ *  With just one of DBCOMPACT_ZSTD and DBCOMPACT_LZ4 that method is used for
+ *  all tables.  With both, the document data uses zstd (which benefits most
+ *  from a dictionary and gets the best ratio) and the other tables use LZ4
+ *  (which decompresses fastest).
+ */
+static compression_method
+compression_for_table(Honey::table_type type, unsigned flags)
+{
+    // Tags in these tables aren't compressed.
+    if (type == Honey::POSTLIST || type == Honey::POSITION)
+	return COMPRESSION_ZLIB;
+    bool zstd = (flags & Xapian::DBCOMPACT_ZSTD);
+    bool lz4 = (flags & Xapian::DBCOMPACT_LZ4);
+    if (zstd && (!lz4 || type == Honey::DOCDATA))
+	return COMPRESSION_ZSTD;
+    if (lz4)
+	return COMPRESSION_LZ4;
+    return COMPRESSION_ZLIB;
+}
+
+#ifdef XAPIAN_HAS_GLASS_BACKEND
+static string
+existing_dictionary(const vector<const GlassTable*>&)
+{
+    return string();
+}
+#endif
+
+/** Return the zstd dictionary shared by @a inputs.
+ *
+ *  If every input is compressed with zstd using the same dictionary, we can
+ *  keep using it and copy tags across without recompressing them.
+ *
+ *  @return The dictionary, or an empty string if there isn't a shared one.
+ */
+static string
+existing_dictionary(const vector<const HoneyTable*>& inputs)
+{
+    const CompressionDictionary* dict = nullptr;
+    for (auto in : inputs) {
+	if (in->get_compression() != COMPRESSION_ZSTD) return string();
+	auto in_dict = in->get_dictionary();
+	if (!in_dict) return string();
+	if (dict && dict->get_data() != in_dict->get_data()) return string();
+	dict = in_dict;
+    }
+    return dict ? dict->get_data() : string();
+}
+
+/** Train a compression dictionary from tags sampled from @a inputs.
+ *
+ *  @return The dictionary, or an empty string if there wasn't enough data to
+ *	    train one.
+ */
+template<typename T>
+static string
+train_dictionary(const vector<const T*>& inputs, const HoneyTable* out)
+{
+    // Spread the samples evenly over all the entries.
+    honey_tablesize_t total = 0;
+    for (auto in : inputs) {
+	if (!in->empty()) total += in->get_entry_count();
+    }
+    honey_tablesize_t step = total / COMPRESSION_DICT_MAX_SAMPLES + 1;
+
+    vector<string> samples;
+    size_t sample_bytes = 0;
+    honey_tablesize_t n = 0;
+    for (auto in : inputs) {
+	if (in->empty()) continue;
+	MergeCursor<const T&> cur(in, out);
+	while (cur.next()) {
+	    if (n++ % step) continue;
+	    cur.read_tag();
+	    sample_bytes += cur.current_tag.size();
+	    samples.push_back(std::move(cur.current_tag));
+	    // zstd suggests about 100 times as much sample data as the size of
+	    // dictionary wanted.
+	    if (sample_bytes >= 100 * COMPRESSION_DICT_MAX_SIZE) break;
+	}
+	if (sample_bytes >= 100 * COMPRESSION_DICT_MAX_SIZE) break;
+    }
+    // Don't build a dictionary which is large compared to the sample data.
+    size_t dict_size = min(size_t(COMPRESSION_DICT_MAX_SIZE),
+			   sample_bytes / 10);
+    if (dict_size < 1024) return string();
+    return CompressionDictionary::train(samples, dict_size);
+}
+
+/// Set how output table @a out of type @a type compresses tags.
+template<typename T>
+static void
+set_table_compression(HoneyTable* out, Honey::table_type type,
+		      unsigned flags, const vector<const T*>& inputs)
+{
+    compression_method method = compression_for_table(type, flags);
+    string dictionary;
+    if (method == COMPRESSION_ZSTD && type == Honey::DOCDATA) {
+	// Document data is typically lots of short records with much in
+	// common, which is the case where a dictionary helps most.
+	dictionary = existing_dictionary(inputs);
+	if (dictionary.empty())
+	    dictionary = train_dictionary(inputs, out);
+    }
+    out->set_compression(method, std::move(dictionary));
+}
+
 void
 HoneyDatabase::compact(Xapian::Compactor* compactor,
 		       const char* destdir,
@@ -2201,6 +2853,17 @@ HoneyDatabase::compact(Xapian::Compactor* compactor,
 
     bool single_file = (flags & Xapian::DBCOMPACT_SINGLE_FILE);
     bool multipass = (flags & Xapian::DBCOMPACT_MULTIPASS);
+    bool bloom_filter = (flags & Xapian::DBCOMPACT_BLOOM_FILTER);
+    if ((flags & Xapian::DBCOMPACT_ZSTD) &&
+	!compression_method_supported(COMPRESSION_ZSTD)) {
+	throw Xapian::FeatureUnavailableError("zstd compression support not "
+					      "enabled");
+    }
+    if ((flags & Xapian::DBCOMPACT_LZ4) &&
+	!compression_method_supported(COMPRESSION_LZ4)) {
+	throw Xapian::FeatureUnavailableError("LZ4 compression support not "
+					      "enabled");
+    }
     if (single_file) {
 	// FIXME: Support this combination - we need to put temporary files
 	// somewhere.
@@ -2259,12 +2922,17 @@ HoneyDatabase::compact(Xapian::Compactor* compactor,
     bool bad_totals = false;
     file_size_type in_total = 0, out_total = 0;
 
+    // Sources without a wildcard index.
+    vector<const Xapian::Database::Internal*> unindexed;
+
     version_file_out->create();
     for (size_t i = 0; i != sources.size(); ++i) {
 	bool source_single_file = false;
 	if (source_backend == Xapian::DB_BACKEND_GLASS) {
 #ifdef XAPIAN_HAS_GLASS_BACKEND
 	    auto db = static_cast<const GlassDatabase*>(sources[i]);
+	    if (!db->postlist_table.has_wildcard_index())
+		unindexed.push_back(db);
 	    auto& v_in = db->version_file;
 	    auto& v_out = version_file_out;
 	    // Glass backend doesn't track unique term bounds, hence setting
@@ -2287,6 +2955,8 @@ HoneyDatabase::compact(Xapian::Compactor* compactor,
 	    auto db = static_cast<const HoneyDatabase*>(sources[i]);
 	    version_file_out->merge_stats(db->version_file);
 	    source_single_file = db->single_file();
+	    if (!db->postlist_table.has_wildcard_index())
+		unindexed.push_back(db);
 	}
 	if (source_single_file) {
 	    // Add single file input DB sizes to in_total here.  For other
@@ -2304,6 +2974,50 @@ HoneyDatabase::compact(Xapian::Compactor* compactor,
 	}
     }
 
+    // The output has a wildcard index if requested or if all the inputs have
+    // one.  We need to generate the entries for any inputs without one.
+    unique_ptr<HoneyWildcardKeys> wildcard_keys;
+    if ((flags & Xapian::DBCOMPACT_WILDCARD_INDEX) ||
+	(unindexed.empty() && !sources.empty())) {
+	// Sorted runs of keys which don't fit in memory are written to
+	// temporary tables.
+	//
+	// FIXME: For a single file output we've nowhere to put temporary
+	// tables (as for multipass) so keep all the keys in memory.
+	auto new_run = [&](unsigned n) {
+	    string dest = destdir;
+	    dest += "/tmpwildcard";
+	    dest += str(n);
+	    dest += '.';
+	    HoneyTable* tmptab = new HoneyTable("postlist", dest, false);
+	    Honey::RootInfo root_info;
+	    root_info.init(0);
+	    const int tmp_flags = Xapian::DB_DANGEROUS|Xapian::DB_NO_SYNC;
+	    tmptab->create_and_open(tmp_flags, root_info);
+	    return tmptab;
+	};
+	auto end_run = [](HoneyTable* tmptab) {
+	    Honey::RootInfo root_info;
+	    root_info.init(0);
+	    tmptab->flush_db();
+	    tmptab->commit(1, &root_info);
+	};
+	if (single_file) {
+	    wildcard_keys.reset(new HoneyWildcardKeys);
+	} else {
+	    wildcard_keys.reset(new HoneyWildcardKeys(new_run, end_run));
+	}
+	string_view prefix(KEY_WILDCARD_INDEX_PREFIX, 2);
+	wildcard_keys->add(string(prefix));
+	for (auto db : unindexed) {
+	    wildcard_index_add_terms(*db, prefix,
+				     [&](const string& key) {
+					 wildcard_keys->add(key);
+				     });
+	}
+	wildcard_keys->start();
+    }
+
     string fl_serialised;
 #if 0
     if (single_file) {
@@ -2313,32 +3027,34 @@ HoneyDatabase::compact(Xapian::Compactor* compactor,
     }
 #endif
 
+    unsigned n_threads = compactor ? compactor->get_threads() : 0;
+    if (single_file) {
+	// The tables are written one after another to the same file.
+	n_threads = 1;
+    }
+
     // FIXME: sort out indentation.
 if (source_backend == Xapian::DB_BACKEND_GLASS) {
 #ifndef XAPIAN_HAS_GLASS_BACKEND
     throw Xapian::FeatureUnavailableError("Glass backend disabled");
 #else
-    vector<HoneyTable*> tabs;
+    vector<unique_ptr<HoneyTable>> tabs;
     tabs.reserve(std::end(tables) - std::begin(tables));
     file_size_type prev_size = 0;
-    for (const auto& t : tables) {
-	// The postlist table requires an N-way merge, adjusting the
-	// headers of various blocks.  The spelling and synonym tables also
-	// need special handling.  The other tables have keys sorted in
-	// docid order, so we can merge them by simply copying all the keys
-	// from each source table in turn.
-	if (compactor)
-	    compactor->set_status(t.name, string());
 
+    struct table_job {
+	const table_list* t;
+
+	// Path of the output table (empty for single file output).
 	string dest;
-	if (!single_file) {
-	    dest = destdir;
-	    dest += '/';
-	    dest += t.name;
-	    dest += '.';
-	}
 
-	bool output_will_exist = !t.lazy;
+	vector<const GlassTable*> inputs;
+
+	HoneyTable* out = nullptr;
+
+	Honey::RootInfo* root_info = nullptr;
+
+	file_size_type in_size = 0;
 
 	// Sometimes stat can fail for benign reasons (e.g. >= 2GB file
 	// on certain systems).
@@ -2348,9 +3064,24 @@ if (source_backend == Xapian::DB_BACKEND_GLASS) {
 	// amongst the inputs.
 	bool single_file_in = false;
 
-	file_size_type in_size = 0;
+	// If there's no output table, the status to report.
+	string skip_status;
+    };
 
-	vector<const GlassTable*> inputs;
+    // Find the inputs for a table and create the output table, or return
+    // false if there's no output table.
+    auto prepare = [&](table_job& job) {
+	const table_list& t = *job.t;
+	if (!single_file) {
+	    job.dest = destdir;
+	    job.dest += '/';
+	    job.dest += t.name;
+	    job.dest += '.';
+	}
+
+	bool output_will_exist = !t.lazy;
+
+	auto& inputs = job.inputs;
 	inputs.reserve(sources.size());
 	size_t inputs_present = 0;
 	for (auto src : sources) {
@@ -2377,7 +3108,7 @@ if (source_backend == Xapian::DB_BACKEND_GLASS) {
 		    break;
 		default:
 		    Assert(false);
-		    return;
+		    return false;
 	    }
 
 	    if (db->single_file()) {
@@ -2387,7 +3118,7 @@ if (source_backend == Xapian::DB_BACKEND_GLASS) {
 		} else {
 		    // FIXME: Find actual size somehow?
 		    // in_size += table->size() / 1024;
-		    single_file_in = true;
+		    job.single_file_in = true;
 		    output_will_exist = true;
 		    ++inputs_present;
 		}
@@ -2397,12 +3128,12 @@ if (source_backend == Xapian::DB_BACKEND_GLASS) {
 		    if (add_overflows(in_total, db_size, in_total)) {
 			bad_totals = true;
 		    }
-		    in_size += db_size / 1024;
+		    job.in_size += db_size / 1024;
 		    output_will_exist = true;
 		    ++inputs_present;
 		} else if (errno != ENOENT) {
 		    // We get ENOENT for an optional table.
-		    bad_totals = bad_stat = true;
+		    bad_totals = job.bad_stat = true;
 		    output_will_exist = true;
 		    ++inputs_present;
 		}
@@ -2413,22 +3144,18 @@ if (source_backend == Xapian::DB_BACKEND_GLASS) {
 	// If any inputs lack a termlist table, suppress it in the output.
 	if (t.type == Honey::TERMLIST && inputs_present != sources.size()) {
 	    if (inputs_present != 0) {
-		if (compactor) {
-		    string m = str(inputs_present);
-		    m += " of ";
-		    m += str(sources.size());
-		    m += " inputs present, so suppressing output";
-		    compactor->set_status(t.name, m);
-		}
-		continue;
+		job.skip_status = str(inputs_present);
+		job.skip_status += " of ";
+		job.skip_status += str(sources.size());
+		job.skip_status += " inputs present, so suppressing output";
+		return false;
 	    }
 	    output_will_exist = false;
 	}
 
 	if (!output_will_exist) {
-	    if (compactor)
-		compactor->set_status(t.name, "doesn't exist");
-	    continue;
+	    job.skip_status = "doesn't exist";
+	    return false;
 	}
 
 	HoneyTable* out;
@@ -2447,10 +3174,12 @@ if (source_backend == Xapian::DB_BACKEND_GLASS) {
 	    out = new HoneyTable(t.name, fd, version_file_out->get_offset(),
 				 false, false);
 	} else {
-	    out = new HoneyTable(t.name, dest, false, t.lazy);
+	    out = new HoneyTable(t.name, job.dest, false, t.lazy);
 	}
-	tabs.push_back(out);
+	tabs.emplace_back(out);
+	job.out = out;
 	Honey::RootInfo* root_info = version_file_out->root_to_set(t.type);
+	job.root_info = root_info;
 	if (single_file) {
 	    root_info->set_free_list(fl_serialised);
 	    root_info->set_offset(table_start_offset);
@@ -2460,15 +3189,29 @@ if (source_backend == Xapian::DB_BACKEND_GLASS) {
 	} else {
 	    out->create_and_open(FLAGS, *root_info);
 	}
+	if (bloom_filter && uses_bloom_filter(t.type))
+	    out->set_bloom_filter();
+	set_table_compression(out, t.type, flags, inputs);
+	return true;
+    };
 
-	switch (t.type) {
+    // The postlist table requires an N-way merge, adjusting the headers of
+    // various blocks.  The spelling and synonym tables also need special
+    // handling.  The other tables have keys sorted in docid order, so we can
+    // merge them by simply copying all the keys from each source table in
+    // turn.
+    auto merge = [&](table_job& job) {
+	HoneyTable* out = job.out;
+	const auto& inputs = job.inputs;
+	switch (job.t->type) {
 	    case Honey::POSTLIST: {
 		if (multipass && inputs.size() > 3) {
 		    multimerge_postlists(compactor, out, destdir,
-					 inputs, offset);
+					 inputs, offset, wildcard_keys.get());
 		} else {
 		    merge_postlists(compactor, out, offset.begin(),
-				    inputs.begin(), inputs.end());
+				    inputs.begin(), inputs.end(),
+				    wildcard_keys.get());
 		}
 		break;
 	    }
@@ -2481,31 +3224,50 @@ if (source_backend == Xapian::DB_BACKEND_GLASS) {
 	    case Honey::POSITION:
 		merge_positions(out, inputs, offset);
 		break;
-	    default: {
-		// DocData, Termlist
+	    case Honey::TERMLIST: {
 		auto& v_out = version_file_out;
 		auto ut_lb = v_out->get_unique_terms_lower_bound();
 		auto ut_ub = v_out->get_unique_terms_upper_bound();
-		merge_docid_keyed(out, inputs, offset, ut_lb, ut_ub, t.type);
+		merge_docid_keyed(out, inputs, offset, ut_lb, ut_ub,
+				  Honey::TERMLIST);
 		version_file_out->set_unique_terms_lower_bound(ut_lb);
 		version_file_out->set_unique_terms_upper_bound(ut_ub);
 		break;
 	    }
+	    default: {
+		// DocData
+		Xapian::termcount ut_lb = 0, ut_ub = 0;
+		merge_docid_keyed(out, inputs, offset, ut_lb, ut_ub,
+				  job.t->type);
+		break;
+	    }
 	}
+    };
 
+    auto commit = [&](table_job& job) {
 	// Commit as revision 1.
-	out->flush_db();
-	out->commit(1, root_info);
-	out->sync();
-	if (single_file) fl_serialised = root_info->get_free_list();
+	job.out->flush_db();
+	job.out->commit(1, job.root_info);
+	job.out->sync();
+	if (single_file) fl_serialised = job.root_info->get_free_list();
+    };
 
+    auto report = [&](const table_job& job) {
+	const table_list& t = *job.t;
+	if (!job.out) {
+	    if (compactor)
+		compactor->set_status(t.name, job.skip_status);
+	    return;
+	}
+
+	bool bad_stat = job.bad_stat;
 	file_size_type out_size = 0;
-	if (!bad_stat && !single_file_in) {
+	if (!bad_stat && !job.single_file_in) {
 	    file_size_type db_size;
 	    if (single_file) {
 		db_size = file_size(fd);
 	    } else {
-		db_size = file_size(dest + HONEY_TABLE_EXTENSION);
+		db_size = file_size(job.dest + HONEY_TABLE_EXTENSION);
 	    }
 	    if (errno == 0) {
 		if (single_file) {
@@ -2525,12 +3287,13 @@ if (source_backend == Xapian::DB_BACKEND_GLASS) {
 	    if (compactor)
 		compactor->set_status(t.name,
 				      "Done (couldn't stat all the DB files)");
-	} else if (single_file_in) {
+	} else if (job.single_file_in) {
 	    if (compactor)
 		compactor->set_status(t.name,
 				      "Done (table sizes unknown for single "
 				      "file DB input)");
 	} else {
+	    file_size_type in_size = job.in_size;
 	    string status;
 	    if (out_size == in_size) {
 		status = "Size unchanged (";
@@ -2557,6 +3320,86 @@ if (source_backend == Xapian::DB_BACKEND_GLASS) {
 	    if (compactor)
 		compactor->set_status(t.name, status);
 	}
+    };
+
+    vector<table_job> jobs(std::end(tables) - std::begin(tables));
+    for (size_t i = 0; i != jobs.size(); ++i) {
+	jobs[i].t = tables + i;
+    }
+
+    if (n_threads <= 1) {
+	for (auto&& job : jobs) {
+	    if (compactor)
+		compactor->set_status(job.t->name, string());
+	    if (prepare(job)) {
+		merge(job);
+		commit(job);
+	    }
+	    report(job);
+	}
+    } else {
+	// Open a copy of the postlist table of source i.
+	auto open_postlist = [&](size_t i) {
+	    auto db = static_cast<const GlassDatabase*>(sources[i]);
+	    unique_ptr<GlassTable> in;
+	    if (db->single_file()) {
+		in.reset(new GlassTable("postlist",
+					db->version_file.get_fd(),
+					db->version_file.get_offset(),
+					true));
+	    } else {
+		in.reset(new GlassTable("postlist", db->db_dir + "/postlist.",
+					true));
+	    }
+	    in->open(db->postlist_table.get_flags(),
+		     db->version_file.get_root(Glass::POSTLIST),
+		     db->version_file.get_revision());
+	    return in.release();
+	};
+
+	// Report on each table as it is finished.  The tables finish in
+	// different threads, so make sure only one reports at once.
+	mutex status_mutex;
+	auto done = [&](const table_job& job) {
+	    lock_guard<mutex> status_lock(status_mutex);
+	    if (compactor)
+		compactor->set_status(job.t->name, string());
+	    report(job);
+	};
+
+	// Merge the tables concurrently, and split merging the postlist table
+	// into ranges of terms.
+	vector<function<void()>> tasks;
+	table_job* postlist_job = nullptr;
+	PostlistRanges<GlassTable> postlist_ranges;
+	for (auto&& job : jobs) {
+	    if (!prepare(job)) {
+		done(job);
+		continue;
+	    }
+	    if (job.t->type != Honey::POSTLIST ||
+		(multipass && job.inputs.size() > 3)) {
+		tasks.emplace_back([&]() {
+		    merge(job);
+		    commit(job);
+		    done(job);
+		});
+		continue;
+	    }
+
+	    postlist_job = &job;
+	    postlist_ranges.add_tasks(tasks, compactor, job.out, destdir,
+				      job.inputs, offset, wildcard_keys.get(),
+				      n_threads, open_postlist);
+	}
+
+	run_tasks(tasks, n_threads);
+
+	if (postlist_job) {
+	    postlist_ranges.finish(postlist_job->out);
+	    commit(*postlist_job);
+	    done(*postlist_job);
+	}
     }
 
     // If compacting to a single file output and all the tables are empty, pad
@@ -2600,32 +3443,26 @@ if (source_backend == Xapian::DB_BACKEND_GLASS) {
     }
     // Commit with revision 1.
     version_file_out->sync(tmpfile, 1, FLAGS);
-    for (unsigned j = 0; j != tabs.size(); ++j) {
-	delete tabs[j];
-    }
+    tabs.clear();
 #endif
 } else {
-    vector<HoneyTable*> tabs;
+    vector<unique_ptr<HoneyTable>> tabs;
     tabs.reserve(std::end(tables) - std::begin(tables));
     file_size_type prev_size = HONEY_MIN_DB_SIZE;
-    for (const auto& t : tables) {
-	// The postlist table requires an N-way merge, adjusting the
-	// headers of various blocks.  The spelling and synonym tables also
-	// need special handling.  The other tables have keys sorted in
-	// docid order, so we can merge them by simply copying all the keys
-	// from each source table in turn.
-	if (compactor)
-	    compactor->set_status(t.name, string());
 
+    struct table_job {
+	const table_list* t;
+
+	// Path of the output table (empty for single file output).
 	string dest;
-	if (!single_file) {
-	    dest = destdir;
-	    dest += '/';
-	    dest += t.name;
-	    dest += '.';
-	}
 
-	bool output_will_exist = !t.lazy;
+	vector<const HoneyTable*> inputs;
+
+	HoneyTable* out = nullptr;
+
+	Honey::RootInfo* root_info = nullptr;
+
+	file_size_type in_size = 0;
 
 	// Sometimes stat can fail for benign reasons (e.g. >= 2GB file
 	// on certain systems).
@@ -2635,9 +3472,24 @@ if (source_backend == Xapian::DB_BACKEND_GLASS) {
 	// amongst the inputs.
 	bool single_file_in = false;
 
-	file_size_type in_size = 0;
+	// If there's no output table, the status to report.
+	string skip_status;
+    };
 
-	vector<const HoneyTable*> inputs;
+    // Find the inputs for a table and create the output table, or return
+    // false if there's no output table.
+    auto prepare = [&](table_job& job) {
+	const table_list& t = *job.t;
+	if (!single_file) {
+	    job.dest = destdir;
+	    job.dest += '/';
+	    job.dest += t.name;
+	    job.dest += '.';
+	}
+
+	bool output_will_exist = !t.lazy;
+
+	auto& inputs = job.inputs;
 	inputs.reserve(sources.size());
 	size_t inputs_present = 0;
 	for (auto src : sources) {
@@ -2664,7 +3516,7 @@ if (source_backend == Xapian::DB_BACKEND_GLASS) {
 		    break;
 		default:
 		    Assert(false);
-		    return;
+		    return false;
 	    }
 
 	    if (db->single_file()) {
@@ -2674,7 +3526,7 @@ if (source_backend == Xapian::DB_BACKEND_GLASS) {
 		} else {
 		    // FIXME: Find actual size somehow?
 		    // in_size += table->size() / 1024;
-		    single_file_in = true;
+		    job.single_file_in = true;
 		    output_will_exist = true;
 		    ++inputs_present;
 		}
@@ -2684,12 +3536,12 @@ if (source_backend == Xapian::DB_BACKEND_GLASS) {
 		    if (add_overflows(in_total, db_size, in_total)) {
 			bad_totals = true;
 		    }
-		    in_size += db_size / 1024;
+		    job.in_size += db_size / 1024;
 		    output_will_exist = true;
 		    ++inputs_present;
 		} else if (errno != ENOENT) {
 		    // We get ENOENT for an optional table.
-		    bad_totals = bad_stat = true;
+		    bad_totals = job.bad_stat = true;
 		    output_will_exist = true;
 		    ++inputs_present;
 		}
@@ -2700,22 +3552,18 @@ if (source_backend == Xapian::DB_BACKEND_GLASS) {
 	// If any inputs lack a termlist table, suppress it in the output.
 	if (t.type == Honey::TERMLIST && inputs_present != sources.size()) {
 	    if (inputs_present != 0) {
-		if (compactor) {
-		    string m = str(inputs_present);
-		    m += " of ";
-		    m += str(sources.size());
-		    m += " inputs present, so suppressing output";
-		    compactor->set_status(t.name, m);
-		}
-		continue;
+		job.skip_status = str(inputs_present);
+		job.skip_status += " of ";
+		job.skip_status += str(sources.size());
+		job.skip_status += " inputs present, so suppressing output";
+		return false;
 	    }
 	    output_will_exist = false;
 	}
 
 	if (!output_will_exist) {
-	    if (compactor)
-		compactor->set_status(t.name, "doesn't exist");
-	    continue;
+	    job.skip_status = "doesn't exist";
+	    return false;
 	}
 
 	HoneyTable* out;
@@ -2734,10 +3582,12 @@ if (source_backend == Xapian::DB_BACKEND_GLASS) {
 	    out = new HoneyTable(t.name, fd, version_file_out->get_offset(),
 				 false, false);
 	} else {
-	    out = new HoneyTable(t.name, dest, false, t.lazy);
+	    out = new HoneyTable(t.name, job.dest, false, t.lazy);
 	}
-	tabs.push_back(out);
+	tabs.emplace_back(out);
+	job.out = out;
 	Honey::RootInfo* root_info = version_file_out->root_to_set(t.type);
+	job.root_info = root_info;
 	if (single_file) {
 	    root_info->set_free_list(fl_serialised);
 	    root_info->set_offset(table_start_offset);
@@ -2747,15 +3597,29 @@ if (source_backend == Xapian::DB_BACKEND_GLASS) {
 	} else {
 	    out->create_and_open(FLAGS, *root_info);
 	}
+	if (bloom_filter && uses_bloom_filter(t.type))
+	    out->set_bloom_filter();
+	set_table_compression(out, t.type, flags, inputs);
+	return true;
+    };
 
-	switch (t.type) {
+    // The postlist table requires an N-way merge, adjusting the headers of
+    // various blocks.  The spelling and synonym tables also need special
+    // handling.  The other tables have keys sorted in docid order, so we can
+    // merge them by simply copying all the keys from each source table in
+    // turn.
+    auto merge = [&](table_job& job) {
+	HoneyTable* out = job.out;
+	const auto& inputs = job.inputs;
+	switch (job.t->type) {
 	    case Honey::POSTLIST: {
 		if (multipass && inputs.size() > 3) {
 		    multimerge_postlists(compactor, out, destdir,
-					 inputs, offset);
+					 inputs, offset, wildcard_keys.get());
 		} else {
 		    merge_postlists(compactor, out, offset.begin(),
-				    inputs.begin(), inputs.end());
+				    inputs.begin(), inputs.end(),
+				    wildcard_keys.get());
 		}
 		break;
 	    }
@@ -2773,20 +3637,32 @@ if (source_backend == Xapian::DB_BACKEND_GLASS) {
 		merge_docid_keyed(out, inputs, offset);
 		break;
 	}
+    };
 
+    auto commit = [&](table_job& job) {
 	// Commit as revision 1.
-	out->flush_db();
-	out->commit(1, root_info);
-	out->sync();
-	if (single_file) fl_serialised = root_info->get_free_list();
+	job.out->flush_db();
+	job.out->commit(1, job.root_info);
+	job.out->sync();
+	if (single_file) fl_serialised = job.root_info->get_free_list();
+    };
+
+    auto report = [&](const table_job& job) {
+	const table_list& t = *job.t;
+	if (!job.out) {
+	    if (compactor)
+		compactor->set_status(t.name, job.skip_status);
+	    return;
+	}
 
+	bool bad_stat = job.bad_stat;
 	file_size_type out_size = 0;
-	if (!bad_stat && !single_file_in) {
+	if (!bad_stat && !job.single_file_in) {
 	    file_size_type db_size;
 	    if (single_file) {
 		db_size = file_size(fd);
 	    } else {
-		db_size = file_size(dest + HONEY_TABLE_EXTENSION);
+		db_size = file_size(job.dest + HONEY_TABLE_EXTENSION);
 	    }
 	    if (errno == 0) {
 		if (single_file) {
@@ -2806,12 +3682,13 @@ if (source_backend == Xapian::DB_BACKEND_GLASS) {
 	    if (compactor)
 		compactor->set_status(t.name,
 				      "Done (couldn't stat all the DB files)");
-	} else if (single_file_in) {
+	} else if (job.single_file_in) {
 	    if (compactor)
 		compactor->set_status(t.name,
 				      "Done (table sizes unknown for single "
 				      "file DB input)");
 	} else {
+	    file_size_type in_size = job.in_size;
 	    string status;
 	    if (out_size == in_size) {
 		status = "Size unchanged (";
@@ -2838,6 +3715,86 @@ if (source_backend == Xapian::DB_BACKEND_GLASS) {
 	    if (compactor)
 		compactor->set_status(t.name, status);
 	}
+    };
+
+    vector<table_job> jobs(std::end(tables) - std::begin(tables));
+    for (size_t i = 0; i != jobs.size(); ++i) {
+	jobs[i].t = tables + i;
+    }
+
+    if (n_threads <= 1) {
+	for (auto&& job : jobs) {
+	    if (compactor)
+		compactor->set_status(job.t->name, string());
+	    if (prepare(job)) {
+		merge(job);
+		commit(job);
+	    }
+	    report(job);
+	}
+    } else {
+	// Open a copy of the postlist table of source i.
+	auto open_postlist = [&](size_t i) {
+	    auto db = static_cast<const HoneyDatabase*>(sources[i]);
+	    unique_ptr<HoneyTable> in;
+	    if (db->single_file()) {
+		in.reset(new HoneyTable("postlist",
+					db->version_file.get_fd(),
+					db->version_file.get_offset(),
+					true));
+	    } else {
+		in.reset(new HoneyTable("postlist", db->path + "/postlist.",
+					true));
+	    }
+	    in->open(db->postlist_table.get_flags(),
+		     db->version_file.get_root(Honey::POSTLIST),
+		     db->version_file.get_revision());
+	    return in.release();
+	};
+
+	// Report on each table as it is finished.  The tables finish in
+	// different threads, so make sure only one reports at once.
+	mutex status_mutex;
+	auto done = [&](const table_job& job) {
+	    lock_guard<mutex> status_lock(status_mutex);
+	    if (compactor)
+		compactor->set_status(job.t->name, string());
+	    report(job);
+	};
+
+	// Merge the tables concurrently, and split merging the postlist table
+	// into ranges of terms.
+	vector<function<void()>> tasks;
+	table_job* postlist_job = nullptr;
+	PostlistRanges<HoneyTable> postlist_ranges;
+	for (auto&& job : jobs) {
+	    if (!prepare(job)) {
+		done(job);
+		continue;
+	    }
+	    if (job.t->type != Honey::POSTLIST ||
+		(multipass && job.inputs.size() > 3)) {
+		tasks.emplace_back([&]() {
+		    merge(job);
+		    commit(job);
+		    done(job);
+		});
+		continue;
+	    }
+
+	    postlist_job = &job;
+	    postlist_ranges.add_tasks(tasks, compactor, job.out, destdir,
+				      job.inputs, offset, wildcard_keys.get(),
+				      n_threads, open_postlist);
+	}
+
+	run_tasks(tasks, n_threads);
+
+	if (postlist_job) {
+	    postlist_ranges.finish(postlist_job->out);
+	    commit(*postlist_job);
+	    done(*postlist_job);
+	}
     }
 
     // If compacting to a single file output and all the tables are empty, pad
@@ -2871,9 +3828,7 @@ if (source_backend == Xapian::DB_BACKEND_GLASS) {
     }
     // Commit with revision 1.
     version_file_out->sync(tmpfile, 1, FLAGS);
-    for (unsigned j = 0; j != tabs.size(); ++j) {
-	delete tabs[j];
-    }
+    tabs.clear();
 }
 
     if (!single_file) lock.release();
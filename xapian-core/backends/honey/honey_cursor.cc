@@ -146,14 +146,8 @@ HoneyCursor::read_tag(bool keep_compressed)
     }
     if (!keep_compressed && current_compressed) {
 	// Need to decompress.
-	comp_stream.decompress_start();
 	string new_tag;
-	if (!comp_stream.decompress_chunk(current_tag.data(),
-					  current_tag.size(),
-					  new_tag)) {
-	    // Decompression didn't complete.
-	    abort();
-	}
+	table->decompress(current_tag.data(), current_tag.size(), new_tag);
 	swap(current_tag, new_tag);
 	current_compressed = false;
 #ifdef DEBUGGING
@@ -188,16 +182,23 @@ HoneyCursor::do_find(string_view key, bool greater_than)
     }
 
     bool use_index = true;
-    if (!is_at_end && !last_key.empty() && last_key[0] == key[0]) {
+    bool partitioned = !table->index_top.empty();
+    if (!is_at_end && !last_key.empty() &&
+	(partitioned || last_key[0] == key[0])) {
 	int cmp0 = last_key.compare(key);
 	if (cmp0 == 0) {
 	    current_key = last_key;
 	    return true;
 	}
 	if (cmp0 < 0) {
-	    // We're going forwards to a key with the same first character, so
-	    // an array index won't help us.
-	    use_index = false;
+	    if (!partitioned) {
+		// We're going forwards to a key with the same first
+		// character, so an array index won't help us.
+		use_index = false;
+	    } else if (key < next_index_key) {
+		// There's no index entry between here and key.
+		use_index = false;
+	    }
 	}
     }
 
@@ -205,7 +206,29 @@ HoneyCursor::do_find(string_view key, bool greater_than)
 	HoneyTable::throw_database_closed();
     }
 
-    if (use_index) {
+    if (use_index && partitioned) {
+	off_t ptr, next_ptr;
+	bool found = table->find_in_partitions(store, key, last_key, ptr,
+					       next_index_key, next_ptr);
+	if (!found) {
+	    // key isn't present - position on the first key after it.
+	    store.set_pos(next_ptr);
+	    last_key = current_key = next_index_key;
+	    bool res = next_from_index();
+	    (void)res;
+	    Assert(res);
+	    return false;
+	}
+	store.set_pos(ptr);
+	current_key = last_key;
+	bool res = next_from_index();
+	(void)res;
+	Assert(res);
+	if (current_key == key)
+	    return true;
+	store.skip(val_size);
+	val_size = 0;
+    } else if (use_index) {
 	store.rewind(root);
 	int index_type = store.read();
 	switch (index_type) {
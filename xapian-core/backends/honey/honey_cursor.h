@@ -39,11 +39,20 @@ class HoneyCursor {
 
     BufferedFile store;
 
+    /** The index key after the last one a partitioned index lookup found.
+     *
+     *  If last_key < key < next_index_key there's no index entry between
+     *  them, so it's quicker to just scan forwards.  Empty if not known.
+     */
+    std::string next_index_key;
+
+    /// The table we're a cursor on.
+    const HoneyTable* table;
+
   public:
     std::string current_key, current_tag;
     mutable size_t val_size = 0;
     bool current_compressed = false;
-    mutable CompressionStream comp_stream;
     bool is_at_end = false;
     mutable std::string last_key;
 
@@ -54,22 +63,23 @@ class HoneyCursor {
     off_t offset;
 
     // Forward to next constructor form.
-    explicit HoneyCursor(const HoneyTable* table)
-	: store(table->store),
-	  comp_stream(Z_DEFAULT_STRATEGY),
-	  root(table->get_root()),
-	  offset(table->get_offset())
+    explicit HoneyCursor(const HoneyTable* table_)
+	: store(table_->store),
+	  table(table_),
+	  root(table_->get_root()),
+	  offset(table_->get_offset())
     {
 	store.set_pos(offset); // FIXME root
     }
 
     HoneyCursor(const HoneyCursor& o)
 	: store(o.store),
+	  next_index_key(o.next_index_key),
+	  table(o.table),
 	  current_key(o.current_key),
 	  current_tag(o.current_tag), // FIXME really copy?
 	  val_size(o.val_size),
 	  current_compressed(o.current_compressed),
-	  comp_stream(Z_DEFAULT_STRATEGY),
 	  is_at_end(o.is_at_end),
 	  last_key(o.last_key),
 	  root(o.root),
@@ -85,6 +95,7 @@ class HoneyCursor {
     void rewind() {
 	store.set_pos(offset); // FIXME root
 	current_key = last_key = std::string();
+	next_index_key.resize(0);
 	is_at_end = false;
 	val_size = 0;
     }
@@ -124,19 +135,19 @@ class HoneyCursor {
 };
 
 class MutableHoneyCursor : public HoneyCursor {
-    HoneyTable* table;
+    HoneyTable* mutable_table;
 
   public:
     MutableHoneyCursor(HoneyTable* table_)
 	: HoneyCursor(table_),
-	  table(table_)
+	  mutable_table(table_)
     { }
 
     bool del() {
 	Assert(!is_at_end);
 	std::string key_to_del = current_key;
 	bool res = next();
-	table->del(key_to_del);
+	mutable_table->del(key_to_del);
 	return res;
     }
 };
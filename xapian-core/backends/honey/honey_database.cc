@@ -25,6 +25,7 @@
 #include "honey_alltermslist.h"
 #include "honey_document.h"
 #include "honey_metadata.h"
+#include "honey_postlist.h"
 #include "honey_termlist.h"
 #include "honey_spellingwordslist.h"
 #include "honey_valuelist.h"
@@ -108,8 +109,11 @@ HoneyDatabase::~HoneyDatabase()
 void
 HoneyDatabase::readahead_for_query(const Xapian::Query& query) const
 {
-    (void)query;
-    // FIXME: Implement - pre-read the start of the postlist table?
+    Xapian::TermIterator t;
+    for (t = query.get_unique_terms_begin(); t != Xapian::TermIterator(); ++t) {
+	if (!postlist_table.readahead_key(Honey::make_postingchunk_key(*t)))
+	    break;
+    }
 }
 
 Xapian::doccount
@@ -329,6 +333,13 @@ HoneyDatabase::open_allterms(string_view prefix) const
     return new HoneyAllTermsList(this, prefix);
 }
 
+bool
+HoneyDatabase::get_wildcard_candidates(string_view literal,
+				       vector<string>& terms) const
+{
+    return postlist_table.get_wildcard_candidates(literal, terms);
+}
+
 PositionList*
 HoneyDatabase::open_position_list(Xapian::docid did, string_view term) const
 {
@@ -369,6 +380,13 @@ HoneyDatabase::get_spelling_frequency(string_view word) const
     return spelling_table.get_word_frequency(word);
 }
 
+void
+HoneyDatabase::get_spelling_frequencies(const vector<string>& words,
+					vector<Xapian::doccount>& freqs) const
+{
+    spelling_table.get_word_frequencies(words, freqs);
+}
+
 void
 HoneyDatabase::add_spelling(string_view word, Xapian::termcount freqinc) const
 {
@@ -456,6 +474,17 @@ HoneyDatabase::reopen()
     return false;
 }
 
+void
+HoneyDatabase::set_mmap()
+{
+    docdata_table.set_mmap();
+    postlist_table.set_mmap();
+    position_table.set_mmap();
+    spelling_table.set_mmap();
+    synonym_table.set_mmap();
+    termlist_table.set_mmap();
+}
+
 void
 HoneyDatabase::close()
 {
@@ -471,7 +500,7 @@ void
 HoneyDatabase::request_document(Xapian::docid did) const
 {
     Assert(did != 0);
-    (void)did; // FIXME
+    docdata_table.readahead_for_document(did);
 }
 
 Xapian::rev
@@ -95,6 +95,9 @@ class HoneyDatabase : public Xapian::Database::Internal {
 
     ~HoneyDatabase();
 
+    /// Memory map the tables to read from them (see Xapian::DB_MMAP).
+    void set_mmap();
+
     void readahead_for_query(const Xapian::Query& query) const;
 
     Xapian::doccount get_doccount() const;
@@ -205,6 +208,9 @@ class HoneyDatabase : public Xapian::Database::Internal {
 
     TermList* open_allterms(std::string_view prefix) const;
 
+    bool get_wildcard_candidates(std::string_view literal,
+				 std::vector<std::string>& terms) const;
+
     PositionList* open_position_list(Xapian::docid did,
 				     std::string_view term) const;
 
@@ -243,6 +249,9 @@ class HoneyDatabase : public Xapian::Database::Internal {
     /** Return the number of times @a word was added as a spelling. */
     Xapian::doccount get_spelling_frequency(std::string_view word) const;
 
+    void get_spelling_frequencies(const std::vector<std::string>& words,
+				  std::vector<Xapian::doccount>& freqs) const;
+
     /** Add a word to the spelling dictionary.
      *
      *  If the word is already present, its frequency is increased.
@@ -22,8 +22,58 @@
 
 #include "honey_dbcheck.h"
 
+#include "honey_cursor.h"
+#include "honey_defs.h"
+#include "honey_table.h"
+#include "honey_version.h"
+
+#include "xapian/constants.h"
+#include "xapian/error.h"
+
+#include <cstring>
+#include <memory>
+#include <ostream>
+
 using namespace std;
 
+/** Check the bloom filter of @a table.
+ *
+ *  Every key in the table must pass the filter.  If @a show_stats is true we
+ *  also report how many keys which aren't in the table the filter rejects,
+ *  which shows how effective it is.
+ */
+static size_t
+check_bloom_filter(const HoneyTable& table, bool show_stats, ostream* out)
+{
+    size_t errors = 0;
+    Xapian::termcount absent = 0, rejected = 0;
+    HoneyCursor cursor(&table);
+    HoneyCursor probe(&table);
+    cursor.rewind();
+    while (cursor.next()) {
+	const string& key = cursor.current_key;
+	if (!table.may_contain(key)) {
+	    if (out)
+		*out << "Key rejected by bloom filter" << endl;
+	    ++errors;
+	}
+	if (!show_stats) continue;
+	// A key which sorts just after key - a cursor doesn't consult the
+	// bloom filter so we can use one to check it really is absent.
+	string other = key;
+	other += '\xff';
+	if (!probe.find_entry_ge(other)) {
+	    ++absent;
+	    if (!table.may_contain(other))
+		++rejected;
+	}
+    }
+    if (show_stats)
+	*out << "bloomfilter=" << table.get_bloom_filter_size()
+	     << " rejected=" << rejected << '/' << absent << endl;
+    return errors;
+}
+
 size_t
 check_honey_table(const char* tablename,
 		  string_view db_dir,
@@ -34,14 +84,52 @@ check_honey_table(const char* tablename,
 		  vector<Xapian::termcount>& doclens,
 		  ostream* out)
 {
-    (void)tablename;
-    (void)db_dir;
-    (void)fd;
-    (void)offset_;
-    (void)version_file;
-    (void)opts;
+    // FIXME: Check the contents of the tables against each other.
     (void)doclens;
-    (void)out;
-    // Dummy implementation for now.
-    return 0;
+    Honey::table_type tab_type;
+    if (strcmp(tablename, "postlist") == 0) {
+	tab_type = Honey::POSTLIST;
+    } else if (strcmp(tablename, "docdata") == 0) {
+	tab_type = Honey::DOCDATA;
+    } else if (strcmp(tablename, "termlist") == 0) {
+	tab_type = Honey::TERMLIST;
+    } else if (strcmp(tablename, "position") == 0) {
+	tab_type = Honey::POSITION;
+    } else if (strcmp(tablename, "spelling") == 0) {
+	tab_type = Honey::SPELLING;
+    } else if (strcmp(tablename, "synonym") == 0) {
+	tab_type = Honey::SYNONYM;
+    } else {
+	string e = "Unknown table: ";
+	e += tablename;
+	throw Xapian::DatabaseError(e);
+    }
+
+    bool show_stats = out && (opts & Xapian::DBCHECK_SHOW_STATS);
+    if (show_stats)
+	*out << tablename << ":\n";
+    const Honey::RootInfo& root_info = version_file.get_root(tab_type);
+    if (root_info.get_num_entries() == 0) {
+	if (show_stats)
+	    *out << "items=0" << endl;
+	return 0;
+    }
+
+    unique_ptr<HoneyTable> table;
+    if (fd < 0) {
+	string filename(db_dir);
+	filename += '/';
+	filename += tablename;
+	filename += '.';
+	table.reset(new HoneyTable("", filename, true));
+    } else {
+	table.reset(new HoneyTable("", fd, offset_, true));
+    }
+    table->open(0, root_info, version_file.get_revision());
+    if (show_stats)
+	*out << "items=" << root_info.get_num_entries()
+	     << " index=" << table->get_index_type() << endl;
+    if (table->get_bloom_filter_size() == 0)
+	return 0;
+    return check_bloom_filter(*table, show_stats, out);
 }
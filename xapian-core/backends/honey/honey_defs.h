@@ -82,7 +82,8 @@ enum {
     KEY_VALUE_STATS_HI = 0x08,
     KEY_VALUE_CHUNK = 0x09,
     KEY_VALUE_CHUNK_HI = 0xe1, // (0xe1 for slots > 26)
-    /* 0xe2-0xe6 inclusive unused currently. */
+    KEY_WILDCARD_INDEX = 0xe2,
+    /* 0xe3-0xe6 inclusive unused currently. */
     /* 0xe7-0xee inclusive reserved for doc max wdf chunks. */
     /* 0xef-0xf6 inclusive reserved for unique terms chunks. */
     KEY_DOCLEN_CHUNK = 0xf7,
@@ -92,6 +93,9 @@ enum {
 
 #define KEY_DOCLEN_PREFIX "\0\xf7"
 
+/// Key prefix for the wildcard index (see backends/wildcardindex.h).
+#define KEY_WILDCARD_INDEX_PREFIX "\0\xe2"
+
 static_assert(((KEY_VALUE_CHUNK_HI - KEY_VALUE_CHUNK) & 0x07) == 0,
 	      "No wasted values");
 
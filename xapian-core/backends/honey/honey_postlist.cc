@@ -44,9 +44,41 @@ HoneyPostList::update_reader()
     cursor->read_tag();
     const string& tag = cursor->current_tag;
     reader.assign(tag.data(), tag.size(), chunk_last);
+    chunk_maxweight = -1.0;
     return true;
 }
 
+bool
+HoneyPostList::chunk_below(double w_min)
+{
+    if (w_min <= 0.0 || !weight) return false;
+    if (chunk_maxweight < 0.0) {
+	chunk_maxweight = get_block_maxweight(reader.get_chunk_wdf_max(),
+					      reader.get_chunk_doclen_min());
+    }
+    return chunk_maxweight < w_min;
+}
+
+void
+HoneyPostList::skip_chunks(double w_min)
+{
+    do {
+	if (reader.get_chunk_last() >= last_did) {
+	    // We've reached the end.
+	    delete cursor;
+	    cursor = NULL;
+	    return;
+	}
+
+	if (rare(!cursor->next()))
+	    throw Xapian::DatabaseCorruptError("Hit end of table looking for "
+					       "postlist chunk");
+
+	if (rare(!update_reader()))
+	    throw Xapian::DatabaseCorruptError("Missing postlist chunk");
+    } while (chunk_below(w_min));
+}
+
 // Return T with just its top bit set (for unsigned T).
 #define TOP_BIT_SET(T) ((static_cast<T>(-1) >> 1) + 1)
 
@@ -77,9 +109,12 @@ HoneyPostList::HoneyPostList(const HoneyDatabase* db_,
     Xapian::docid first_did;
     Xapian::termcount first_wdf;
     Xapian::docid chunk_last;
+    Xapian::termcount chunk_wdf_max;
+    Xapian::termcount chunk_doclen_min;
     if (!decode_initial_chunk_header(&p, pend, tf, cf,
 				     first_did, last_did,
-				     chunk_last, first_wdf, wdf_max))
+				     chunk_last, first_wdf, wdf_max,
+				     chunk_wdf_max, chunk_doclen_min))
 	throw Xapian::DatabaseCorruptError("Postlist initial chunk header");
 
     Xapian::termcount cf_info = cf;
@@ -111,7 +146,8 @@ HoneyPostList::HoneyPostList(const HoneyDatabase* db_,
     termfreq = tf;
     collfreq = cf;
     reader.init(tf, cf_info);
-    reader.assign(p, pend - p, first_did, last_did, first_wdf);
+    reader.assign(p, pend - p, first_did, chunk_last, first_wdf,
+		  chunk_wdf_max, chunk_doclen_min);
 }
 
 HoneyPostList::~HoneyPostList()
@@ -154,6 +190,24 @@ HoneyPostList::get_wdf() const
     return reader.get_wdf();
 }
 
+unsigned
+HoneyPostList::peek_postings(Xapian::docid* dids,
+			     Xapian::termcount* wdfs,
+			     unsigned max) const
+{
+    Assert(!at_end());
+    Assert(max > 0);
+    // Decode ahead using a copy of the reader - it only holds pointers into
+    // the current chunk, which stays valid until the cursor moves.
+    Honey::PostingChunkReader r = reader;
+    unsigned n = 0;
+    do {
+	dids[n] = r.get_docid();
+	wdfs[n] = r.get_wdf();
+    } while (++n != max && r.next());
+    return n;
+}
+
 bool
 HoneyPostList::at_end() const
 {
@@ -167,37 +221,28 @@ HoneyPostList::open_position_list() const
 }
 
 PostList*
-HoneyPostList::next(double)
+HoneyPostList::next(double w_min)
 {
     if (!started) {
 	started = true;
+	if (chunk_below(w_min))
+	    skip_chunks(w_min);
 	return NULL;
     }
 
     Assert(!reader.at_end());
 
-    if (reader.next())
-	return NULL;
-
-    if (reader.get_docid() >= last_did) {
-	// We've reached the end.
-	delete cursor;
-	cursor = NULL;
+    // If no posting in the rest of this chunk can be competitive, move
+    // straight on to the next chunk without decoding them.
+    if (!chunk_below(w_min) && reader.next())
 	return NULL;
-    }
-
-    if (rare(!cursor->next()))
-	throw Xapian::DatabaseCorruptError("Hit end of table looking for "
-					   "postlist chunk");
-
-    if (rare(!update_reader()))
-	throw Xapian::DatabaseCorruptError("Missing postlist chunk");
 
+    skip_chunks(w_min);
     return NULL;
 }
 
 PostList*
-HoneyPostList::skip_to(Xapian::docid did, double)
+HoneyPostList::skip_to(Xapian::docid did, double w_min)
 {
     if (!started) {
 	started = true;
@@ -210,8 +255,11 @@ HoneyPostList::skip_to(Xapian::docid did, double)
 
     Assert(!reader.at_end());
 
-    if (reader.skip_to(did))
+    if (reader.skip_to(did)) {
+	if (chunk_below(w_min))
+	    skip_chunks(w_min);
 	return NULL;
+    }
 
     if (did > last_did) {
 	// We've reached the end.
@@ -238,6 +286,9 @@ HoneyPostList::skip_to(Xapian::docid did, double)
 	throw Xapian::DatabaseCorruptError("Postlist chunk doesn't contain "
 					   "its last entry");
 
+    if (chunk_below(w_min))
+	skip_chunks(w_min);
+
     return NULL;
 }
 
@@ -301,10 +352,26 @@ PostingChunkReader::assign(const char* p_, size_t len,
 			   Xapian::docid chunk_last)
 {
     const char* pend = p_ + len;
-    if (collfreq_info ?
-	!decode_delta_chunk_header(&p_, pend, chunk_last, did, wdf) :
-	!decode_delta_chunk_header_no_wdf(&p_, pend, chunk_last, did)) {
-	throw Xapian::DatabaseCorruptError("Postlist delta chunk header");
+    // The "constant wdf apart from maybe the first entry" case - we may not
+    // have advanced past the first entry if we skipped the rest of the
+    // initial chunk.
+    if (collfreq_info & TOP_BIT_SET(decltype(collfreq_info))) {
+	wdf = collfreq_info &~ TOP_BIT_SET(decltype(collfreq_info));
+	collfreq_info = 0;
+    }
+
+    if (collfreq_info) {
+	if (!decode_delta_chunk_header(&p_, pend, chunk_last, did, wdf,
+				       chunk_wdf_max, chunk_doclen_min)) {
+	    throw Xapian::DatabaseCorruptError("Postlist delta chunk header");
+	}
+    } else {
+	if (!decode_delta_chunk_header_no_wdf(&p_, pend, chunk_last, did,
+					      chunk_doclen_min)) {
+	    throw Xapian::DatabaseCorruptError("Postlist delta chunk header");
+	}
+	// Every posting in the chunk has the same wdf.
+	chunk_wdf_max = wdf;
     }
     p = p_;
     end = pend;
@@ -314,13 +381,17 @@ PostingChunkReader::assign(const char* p_, size_t len,
 void
 PostingChunkReader::assign(const char* p_, size_t len, Xapian::docid did_,
 			   Xapian::docid last_did_in_chunk,
-			   Xapian::termcount wdf_)
+			   Xapian::termcount wdf_,
+			   Xapian::termcount chunk_wdf_max_,
+			   Xapian::termcount chunk_doclen_min_)
 {
     p = p_;
     end = p_ + len;
     did = did_;
     last_did = last_did_in_chunk;
     wdf = wdf_;
+    chunk_wdf_max = chunk_wdf_max_;
+    chunk_doclen_min = chunk_doclen_min_;
 }
 
 bool
@@ -111,6 +111,12 @@ class PostingChunkReader {
      */
     Xapian::termcount collfreq_info;
 
+    /// Upper bound on the wdf of any posting in this chunk.
+    Xapian::termcount chunk_wdf_max;
+
+    /// Lower bound on the document length of any posting in this chunk.
+    Xapian::termcount chunk_doclen_min;
+
   public:
     /// Create an uninitialised PostingChunkReader.
     PostingChunkReader() { }
@@ -132,7 +138,9 @@ class PostingChunkReader {
 
     void assign(const char* p_, size_t len, Xapian::docid did_,
 		Xapian::docid last_did_in_chunk,
-		Xapian::termcount wdf_);
+		Xapian::termcount wdf_,
+		Xapian::termcount chunk_wdf_max_,
+		Xapian::termcount chunk_doclen_min_);
 
     bool at_end() const { return p == NULL; }
 
@@ -140,6 +148,17 @@ class PostingChunkReader {
 
     Xapian::termcount get_wdf() const { return wdf; }
 
+    /// The last docid in the current chunk.
+    Xapian::docid get_chunk_last() const { return last_did; }
+
+    /// Upper bound on the wdf of any posting in the current chunk.
+    Xapian::termcount get_chunk_wdf_max() const { return chunk_wdf_max; }
+
+    /// Lower bound on the length of any document in the current chunk.
+    Xapian::termcount get_chunk_doclen_min() const {
+	return chunk_doclen_min;
+    }
+
     /// Advance, returning false if we've run out of data.
     bool next();
 
@@ -183,6 +202,26 @@ class HoneyPostList : public LeafPostList {
     /// Update @a reader to use the chunk currently pointed to by @a cursor.
     bool update_reader();
 
+    /** Upper bound on the weight contribution from the current chunk.
+     *
+     *  Calculated lazily from the block bounds stored in the chunk header -
+     *  negative if not yet calculated for the current chunk.
+     */
+    double chunk_maxweight = -1.0;
+
+    /** Check if no posting in the current chunk can have weight >= @a w_min.
+     *
+     *  If true is returned, the caller can skip the rest of the chunk.
+     */
+    bool chunk_below(double w_min);
+
+    /** Move to the start of the next chunk which could contain a posting
+     *  with weight contribution >= @a w_min.
+     *
+     *  Deletes @a cursor and sets it to NULL if there are no such chunks.
+     */
+    void skip_chunks(double w_min);
+
   public:
     /// Create HoneyPostList from already positioned @a cursor_.
     HoneyPostList(const HoneyDatabase* db_,
@@ -207,6 +246,10 @@ class HoneyPostList : public LeafPostList {
 
     PostList* skip_to(Xapian::docid did, double w_min);
 
+    unsigned peek_postings(Xapian::docid* dids,
+			   Xapian::termcount* wdfs,
+			   unsigned max) const;
+
     Xapian::termcount get_wdf_upper_bound() const;
 
     void get_docid_range(Xapian::docid& first, Xapian::docid& last) const;
@@ -31,6 +31,8 @@ encode_initial_chunk_header(Xapian::doccount termfreq,
 			    Xapian::docid chunk_last,
 			    Xapian::termcount first_wdf,
 			    Xapian::termcount wdf_max,
+			    Xapian::termcount chunk_wdf_max,
+			    Xapian::termcount chunk_doclen_min,
 			    std::string& out)
 {
     Assert(termfreq != 0);
@@ -54,6 +56,8 @@ encode_initial_chunk_header(Xapian::doccount termfreq,
 	AssertEq(last, chunk_last);
 	AssertEq(collfreq, wdf_max);
 	AssertEq(collfreq, first_wdf);
+	(void)chunk_wdf_max;
+	(void)chunk_doclen_min;
     } else if (termfreq == 2) {
 	// A term which only occurs in two documents.  By Zipf's Law these
 	// are also fairly common (typically 10-15% of words in a large
@@ -87,13 +91,19 @@ encode_initial_chunk_header(Xapian::doccount termfreq,
 	} else {
 	    AssertEq(collfreq - first_wdf, wdf_max);
 	}
+	// There's only one chunk and it's tiny, so block bounds would not
+	// help.
+	(void)chunk_wdf_max;
+	(void)chunk_doclen_min;
     } else if (collfreq == 0) {
 	AssertEq(first_wdf, 0);
 	AssertEq(wdf_max, 0);
+	AssertEq(chunk_wdf_max, 0);
 	pack_uint(out, 0u);
 	pack_uint(out, termfreq - 3);
 	pack_uint(out, last - first - (termfreq - 1));
 	pack_uint(out, chunk_last - first);
+	pack_uint(out, chunk_doclen_min);
     } else {
 	AssertRel(collfreq, >=, termfreq);
 	pack_uint(out, collfreq - termfreq + 1);
@@ -108,6 +118,16 @@ encode_initial_chunk_header(Xapian::doccount termfreq,
 	    AssertRel(wdf_max, >=, first_wdf);
 	    pack_uint(out, wdf_max - first_wdf);
 	}
+
+	// Block bounds for the initial chunk.  If this is the only chunk then
+	// chunk_wdf_max must be wdf_max so we don't store it.
+	AssertRel(chunk_wdf_max, <=, wdf_max);
+	if (chunk_last != last) {
+	    pack_uint(out, wdf_max - chunk_wdf_max);
+	} else {
+	    AssertEq(chunk_wdf_max, wdf_max);
+	}
+	pack_uint(out, chunk_doclen_min);
     }
 }
 
@@ -119,12 +139,17 @@ decode_initial_chunk_header(const char** p, const char* end,
 			    Xapian::docid& last,
 			    Xapian::docid& chunk_last,
 			    Xapian::termcount& first_wdf,
-			    Xapian::termcount& wdf_max)
+			    Xapian::termcount& wdf_max,
+			    Xapian::termcount& chunk_wdf_max,
+			    Xapian::termcount& chunk_doclen_min)
 {
     if (!unpack_uint(p, end, &first)) {
 	return false;
     }
     ++first;
+    // We don't store a document length lower bound for terms with termfreq
+    // <= 2, so use 0 which is always a valid lower bound.
+    chunk_doclen_min = 0;
     if (*p == end) {
 	collfreq = 0;
     } else if (!unpack_uint(p, end, &collfreq)) {
@@ -134,7 +159,7 @@ decode_initial_chunk_header(const char** p, const char* end,
 	// Single occurrence term.
 	termfreq = 1;
 	chunk_last = last = first;
-	wdf_max = first_wdf = collfreq;
+	chunk_wdf_max = wdf_max = first_wdf = collfreq;
 	return true;
     }
 
@@ -146,7 +171,7 @@ decode_initial_chunk_header(const char** p, const char* end,
 	chunk_last = last = first + termfreq + 1;
 	termfreq = 2;
 	first_wdf = collfreq / 2;
-	wdf_max = std::max(first_wdf, collfreq - first_wdf);
+	chunk_wdf_max = wdf_max = std::max(first_wdf, collfreq - first_wdf);
 	return true;
     }
 
@@ -159,7 +184,7 @@ decode_initial_chunk_header(const char** p, const char* end,
 	first_wdf = last;
 	chunk_last = last = first + termfreq + 1;
 	termfreq = 2;
-	wdf_max = std::max(first_wdf, collfreq - first_wdf);
+	chunk_wdf_max = wdf_max = std::max(first_wdf, collfreq - first_wdf);
 	return true;
     }
 
@@ -188,6 +213,18 @@ decode_initial_chunk_header(const char** p, const char* end,
 	}
     }
 
+    chunk_wdf_max = wdf_max;
+    if (collfreq != 0 && chunk_last != last) {
+	Xapian::termcount delta;
+	if (!unpack_uint(p, end, &delta)) {
+	    return false;
+	}
+	chunk_wdf_max -= delta;
+    }
+    if (!unpack_uint(p, end, &chunk_doclen_min)) {
+	return false;
+    }
+
     return true;
 }
 
@@ -243,46 +280,72 @@ decode_initial_chunk_header_freqs(const char** p, const char* end,
     return true;
 }
 
+/** Encode the header for a continuation chunk.
+ *
+ *  As well as the docid range, we store bounds on the wdf and document length
+ *  for the postings in the chunk.  These allow the matcher to calculate an
+ *  upper bound on the weight contribution of any posting in the chunk, and
+ *  to skip the whole chunk if that can't be competitive.
+ */
 inline void
 encode_delta_chunk_header(Xapian::docid chunk_first,
 			  Xapian::docid chunk_last,
 			  Xapian::termcount chunk_first_wdf,
+			  Xapian::termcount chunk_wdf_max,
+			  Xapian::termcount chunk_doclen_min,
 			  std::string& out)
 {
     Assert(chunk_first_wdf != 0);
+    AssertRel(chunk_wdf_max, >=, chunk_first_wdf);
     pack_uint(out, chunk_last - chunk_first);
     pack_uint(out, chunk_first_wdf - 1);
+    pack_uint(out, chunk_wdf_max - chunk_first_wdf);
+    pack_uint(out, chunk_doclen_min);
 }
 
 inline bool
 decode_delta_chunk_header(const char** p, const char* end,
 			  Xapian::docid chunk_last,
 			  Xapian::docid& chunk_first,
-			  Xapian::termcount& chunk_first_wdf)
+			  Xapian::termcount& chunk_first_wdf,
+			  Xapian::termcount& chunk_wdf_max,
+			  Xapian::termcount& chunk_doclen_min)
 {
     if (!unpack_uint(p, end, &chunk_first) ||
-	!unpack_uint(p, end, &chunk_first_wdf)) {
+	!unpack_uint(p, end, &chunk_first_wdf) ||
+	!unpack_uint(p, end, &chunk_wdf_max) ||
+	!unpack_uint(p, end, &chunk_doclen_min)) {
 	return false;
     }
     chunk_first = chunk_last - chunk_first;
     ++chunk_first_wdf;
+    chunk_wdf_max += chunk_first_wdf;
     return true;
 }
 
+/** Encode the header for a continuation chunk without explicit wdf values.
+ *
+ *  The wdf is the same for every posting in such a chunk, so we only need to
+ *  store the document length bound.
+ */
 inline void
 encode_delta_chunk_header_no_wdf(Xapian::docid chunk_first,
 				 Xapian::docid chunk_last,
+				 Xapian::termcount chunk_doclen_min,
 				 std::string& out)
 {
     pack_uint(out, chunk_last - chunk_first);
+    pack_uint(out, chunk_doclen_min);
 }
 
 inline bool
 decode_delta_chunk_header_no_wdf(const char** p, const char* end,
 				 Xapian::docid chunk_last,
-				 Xapian::docid& chunk_first)
+				 Xapian::docid& chunk_first,
+				 Xapian::termcount& chunk_doclen_min)
 {
-    if (!unpack_uint(p, end, &chunk_first)) {
+    if (!unpack_uint(p, end, &chunk_first) ||
+	!unpack_uint(p, end, &chunk_doclen_min)) {
 	return false;
     }
     chunk_first = chunk_last - chunk_first;
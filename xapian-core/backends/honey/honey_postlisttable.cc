@@ -28,6 +28,7 @@
 #include "honey_defs.h"
 #include "honey_postlist.h"
 #include "honey_postlist_encodings.h"
+#include "backends/wildcardindex.h"
 
 #include <memory>
 #include <string_view>
@@ -43,8 +44,12 @@ HoneyPostListTable::open_post_list(const HoneyDatabase* db,
     Assert(!term.empty());
     // Try to position cursor first so we avoid creating HoneyPostList objects
     // for terms which don't exist.
+    string key = Honey::make_postingchunk_key(term);
+    if (!may_contain(key)) {
+	return nullptr;
+    }
     unique_ptr<HoneyCursor> cursor(cursor_get());
-    if (!cursor->find_exact(Honey::make_postingchunk_key(term))) {
+    if (!cursor->find_exact(key)) {
 	return nullptr;
     }
 
@@ -143,8 +148,22 @@ HoneyPostListTable::get_wdf_upper_bound(std::string_view term) const
     Xapian::docid chunk_last;
     Xapian::termcount first_wdf;
     Xapian::termcount wdf_max;
+    Xapian::termcount chunk_wdf_max;
+    Xapian::termcount chunk_doclen_min;
     if (!decode_initial_chunk_header(&p, pend, tf, cf, first, last, chunk_last,
-				     first_wdf, wdf_max))
+				     first_wdf, wdf_max,
+				     chunk_wdf_max, chunk_doclen_min))
 	throw Xapian::DatabaseCorruptError("Postlist initial chunk header");
     return wdf_max;
 }
+
+bool
+HoneyPostListTable::get_wildcard_candidates(string_view literal,
+					    vector<string>& terms) const
+{
+    if (!has_wildcard_index()) return false;
+    unique_ptr<HoneyCursor> cursor(cursor_get());
+    wildcard_index_lookup(*cursor, string_view(KEY_WILDCARD_INDEX_PREFIX, 2),
+			  literal, terms);
+    return true;
+}
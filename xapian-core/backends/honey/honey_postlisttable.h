@@ -31,6 +31,7 @@
 
 #include <string>
 #include <string_view>
+#include <vector>
 
 class HoneyDatabase;
 class PostingChanges;
@@ -55,6 +56,18 @@ class HoneyPostListTable : public HoneyTable {
 	return key_exists(pack_honey_postlist_key(term));
     }
 
+    /// Does this table have a wildcard index?
+    bool has_wildcard_index() const {
+	return key_exists(std::string(KEY_WILDCARD_INDEX_PREFIX, 2));
+    }
+
+    /** Find terms containing @a literal using the wildcard index.
+     *
+     *  @return false if there's no wildcard index.
+     */
+    bool get_wildcard_candidates(std::string_view literal,
+				 std::vector<std::string>& terms) const;
+
     HoneyPostList* open_post_list(const HoneyDatabase* db,
 				  std::string_view term,
 				  bool need_read_pos) const;
@@ -25,6 +25,7 @@
 
 #include "expand/expandweight.h"
 #include "expand/termlistmerger.h"
+#include "honey_cursor.h"
 #include "honey_spelling.h"
 #include "omassert.h"
 #include "pack.h"
@@ -33,6 +34,7 @@
 
 #include <algorithm>
 #include <map>
+#include <memory>
 #include <queue>
 #include <vector>
 #include <set>
@@ -374,6 +376,35 @@ HoneySpellingTable::get_word_frequency(string_view word) const
     return 0;
 }
 
+void
+HoneySpellingTable::get_word_frequencies(const vector<string>& words,
+					 vector<Xapian::doccount>& freqs) const
+{
+    freqs.clear();
+    freqs.reserve(words.size());
+    unique_ptr<HoneyCursor> cursor(cursor_get());
+    for (auto&& word : words) {
+	auto i = wordfreq_changes.find(word);
+	if (i != wordfreq_changes.end()) {
+	    // Modified frequency for word:
+	    freqs.push_back(i->second);
+	    continue;
+	}
+
+	Xapian::termcount freq = 0;
+	// The words are in ascending order, so the cursor only moves forwards.
+	if (cursor && cursor->find_exact(make_spelling_wordlist_key(word))) {
+	    cursor->read_tag();
+	    const string& data = cursor->current_tag;
+	    const char* p = data.data();
+	    if (!unpack_uint_last(&p, p + data.size(), &freq)) {
+		throw Xapian::DatabaseCorruptError("Bad spelling word freq");
+	    }
+	}
+	freqs.push_back(freq);
+    }
+}
+
 ///////////////////////////////////////////////////////////////////////////
 
 Xapian::termcount
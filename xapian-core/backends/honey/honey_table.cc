@@ -37,6 +37,13 @@
 
 using Honey::RootInfo;
 
+/** The most we'll readahead for a single key.
+ *
+ *  If the range of the table the index tells us a key is in is larger than
+ *  this, it's better not to readahead at all.
+ */
+#define HONEY_READAHEAD_MAX (128 * 1024)
+
 using namespace std;
 
 void
@@ -52,6 +59,18 @@ HoneyTable::create_and_open(int flags_, const RootInfo& root_info)
     }
     if (!store.open(path, read_only))
 	throw Xapian::DatabaseOpeningError("Failed to open HoneyTable", errno);
+    bloom.clear();
+    bloom_offset = read_only ? root_info.get_bloom_offset() : 0;
+    if (bloom_offset)
+	read_bloom_filter();
+    compression = root_info.get_compression();
+    dict.clear();
+    dict_offset = read_only ? root_info.get_dict_offset() : 0;
+    if (dict_offset)
+	read_dictionary();
+    index_top.clear();
+    if (read_only)
+	read_index();
 }
 
 void
@@ -68,6 +87,200 @@ HoneyTable::open(int flags_, const RootInfo& root_info, honey_revision_number_t)
 					       errno);
     }
     store.set_pos(offset);
+    bloom.clear();
+    bloom_offset = read_only ? root_info.get_bloom_offset() : 0;
+    if (bloom_offset && store.is_open())
+	read_bloom_filter();
+    compression = root_info.get_compression();
+    dict.clear();
+    dict_offset = read_only ? root_info.get_dict_offset() : 0;
+    if (dict_offset && store.is_open())
+	read_dictionary();
+    index_top.clear();
+    if (read_only && store.is_open())
+	read_index();
+}
+
+void
+HoneyTable::read_bloom_filter()
+{
+    BufferedFile f(store);
+    f.rewind(root + bloom_offset);
+    char header[HoneyBloomFilter::HEADER_SIZE];
+    f.read(header, sizeof(header));
+    size_t size;
+    if (!bloom.unserialise_header(header, size))
+	throw Xapian::DatabaseCorruptError("Bad bloom filter header");
+    string bits(size, '\0');
+    f.read(&bits[0], size);
+    bloom.set_bits(std::move(bits));
+}
+
+int
+HoneyTable::get_index_type() const
+{
+    if (!index_top.empty()) return 0x03;
+    if (root < 0) return EOF;
+    BufferedFile f(store);
+    f.rewind(root);
+    return f.read();
+}
+
+void
+HoneyTable::set_compression(compression_method method, string&& dictionary)
+{
+    Assert(num_entries == 0);
+    if (!compression_method_supported(method)) {
+	string msg = compression_method_name(method);
+	msg += " compression support not enabled";
+	throw Xapian::FeatureUnavailableError(msg);
+    }
+    compression = method;
+    dict.set(std::move(dictionary), true);
+}
+
+/** Read a pack_uint() encoded value from @a f.
+ *
+ *  @param msg	Message for the DatabaseCorruptError thrown if it's bad.
+ */
+template<typename U>
+static void
+read_uint(const BufferedFile& f, U& result, const char* msg)
+{
+    char buf[16];
+    char* e = buf;
+    while (true) {
+	int b = f.read();
+	if (b == EOF || e == buf + sizeof(buf))
+	    throw Xapian::DatabaseCorruptError(msg);
+	*e++ = char(b);
+	if (b < 128) break;
+    }
+    const char* p = buf;
+    if (!unpack_uint(&p, e, &result) || p != e)
+	throw Xapian::DatabaseCorruptError(msg);
+}
+
+void
+HoneyTable::read_dictionary()
+{
+    BufferedFile f(store);
+    f.rewind(root + dict_offset);
+    size_t size;
+    read_uint(f, size, "Bad compression dictionary");
+    string data(size, '\0');
+    f.read(&data[0], size);
+    dict.set(std::move(data), false);
+}
+
+void
+HoneyTable::read_index()
+{
+    if (root < 0) return;
+    BufferedFile f(store);
+    f.rewind(root);
+    if (f.read() != 0x03) return;
+    size_t top_size, leaf_size;
+    read_uint(f, top_size, "Bad table index header");
+    read_uint(f, leaf_size, "Bad table index header");
+    string top(top_size, '\0');
+    f.read(&top[0], top_size);
+    index_top.unserialise(top, f.get_pos(), leaf_size);
+}
+
+void
+SSTIndexTop::unserialise(string_view top, off_t leaf_base, size_t leaf_size)
+{
+    clear();
+    const char* p = top.data();
+    const char* end = p + top.size();
+    string separator;
+    while (p != end) {
+	if (end - p < 2)
+	    throw Xapian::DatabaseCorruptError("Bad table index");
+	size_t reuse = static_cast<unsigned char>(*p++);
+	size_t len = static_cast<unsigned char>(*p++);
+	if (reuse > separator.size() || size_t(end - p) < len)
+	    throw Xapian::DatabaseCorruptError("Bad table index");
+	separator.resize(reuse);
+	separator.append(p, len);
+	p += len;
+	size_t leaf_offset;
+	make_unsigned_t<off_t> data_ptr;
+	if (!unpack_uint(&p, end, &leaf_offset) ||
+	    !unpack_uint(&p, end, &data_ptr) ||
+	    leaf_offset > leaf_size ||
+	    (!leaf_starts.empty() && leaf_base + off_t(leaf_offset) <=
+				     leaf_starts.back())) {
+	    throw Xapian::DatabaseCorruptError("Bad table index");
+	}
+	separators += separator;
+	separator_ends.push_back(separators.size());
+	leaf_starts.push_back(leaf_base + leaf_offset);
+	data_ptrs.push_back(data_ptr);
+    }
+    leaf_starts.push_back(leaf_base + leaf_size);
+}
+
+bool
+HoneyTable::find_in_partitions(BufferedFile& f,
+			       string_view key,
+			       string& index_key,
+			       off_t& ptr,
+			       string& next_key,
+			       off_t& next_ptr) const
+{
+    Assert(!index_top.empty());
+    size_t i = index_top.find(key);
+    if (i == size_t(-1)) {
+	// The key is before the first key in the table.
+	i = 0;
+    }
+
+    off_t leaf_start = index_top.get_leaf_start(i);
+    string leaf(size_t(index_top.get_leaf_end(i) - leaf_start), '\0');
+    f.set_pos(leaf_start);
+    f.read(&leaf[0], leaf.size());
+
+    const char* p = leaf.data();
+    const char* end = p + leaf.size();
+    bool found = false;
+    string k;
+    while (p != end) {
+	if (end - p < 2)
+	    throw Xapian::DatabaseCorruptError("Bad table index");
+	size_t reuse = static_cast<unsigned char>(*p++);
+	size_t len = static_cast<unsigned char>(*p++);
+	if (reuse > k.size() || size_t(end - p) < len)
+	    throw Xapian::DatabaseCorruptError("Bad table index");
+	k.resize(reuse);
+	k.append(p, len);
+	p += len;
+	make_unsigned_t<off_t> v;
+	if (!unpack_uint(&p, end, &v))
+	    throw Xapian::DatabaseCorruptError("Bad table index");
+	if (k > key) {
+	    // If the first entry is already after key, key is in the gap
+	    // between the previous partition and this one, so isn't present.
+	    swap(next_key, k);
+	    next_ptr = v;
+	    return found;
+	}
+	index_key = k;
+	ptr = v;
+	found = true;
+    }
+
+    // Any following entry is the first in the next partition.  We don't
+    // have its full key, but its separator is just as good a boundary.
+    if (++i == index_top.size()) {
+	next_key.resize(0);
+	next_ptr = root;
+    } else {
+	next_key = index_top.get_separator(i);
+	next_ptr = index_top.get_data_ptr(i);
+    }
+    return found;
 }
 
 void
@@ -82,8 +295,8 @@ HoneyTable::add(std::string_view key,
 	throw_database_closed();
     if (!compressed && compress_min > 0 && val_size > compress_min) {
 	size_t compressed_size = val_size;
-	CompressionStream comp_stream; // FIXME: reuse
-	const char* p = comp_stream.compress(val, &compressed_size);
+	const char* p = comp_stream.compress(compression, get_dictionary(),
+					     val, &compressed_size);
 	if (p) {
 	    add(key, p, compressed_size, true);
 	    return;
@@ -97,33 +310,21 @@ HoneyTable::add(std::string_view key,
 					   str(key.size()));
     if (key <= last_key)
 	throw Xapian::InvalidOperationError("New key <= previous key");
+    if (build_bloom)
+	bloom.add(key);
     size_t reuse = common_prefix_length(last_key, key);
 
-#ifdef SSTINDEX_ARRAY
     if (reuse == 0) {
-	index.maybe_add_entry(key, store.get_pos());
-    }
-#elif defined SSTINDEX_BINARY_CHOP
-    // For a binary chop index, the index point is before the key info - the
-    // index key must have the same N first bytes as the previous key, where
-    // N >= the keep length.
-    index.maybe_add_entry(key, store.get_pos());
-#elif defined SSTINDEX_SKIPLIST
-    // Handled below.
-#else
-# error SSTINDEX type not specified
-#endif
+	index.add_array_entry(key, store.get_pos());
+    }
 
     store.write(static_cast<unsigned char>(reuse));
     store.write(static_cast<unsigned char>(key.size() - reuse));
     store.write(key.data() + reuse, key.size() - reuse);
     ++num_entries;
 
-#ifdef SSTINDEX_SKIPLIST
-    // For a skiplist index, the index provides the full key, so the index
-    // point is after the key at the level below.
-    index.maybe_add_entry(key, store.get_pos());
-#endif
+    // A leaf entry provides the full key, so points to just after the key.
+    index.maybe_add_leaf_entry(key, last_key, store.get_pos());
 
     // Encode "compressed?" flag in bottom bit.
     // FIXME: Don't do this if a table is uncompressed?  That saves a byte
@@ -137,6 +338,27 @@ HoneyTable::add(std::string_view key,
     last_key = key;
 }
 
+void
+HoneyTable::flush_db()
+{
+    root = index.write(store);
+    if (build_bloom && num_entries) {
+	// The bloom filter goes after the index.
+	bloom_offset = store.get_pos() - root;
+	string serialised = bloom.build();
+	store.write(serialised.data(), serialised.size());
+    }
+    if (!dict.empty()) {
+	// The dictionary goes after the index and any bloom filter.
+	dict_offset = store.get_pos() - root;
+	string size;
+	pack_uint(size, dict.get_data().size());
+	store.write(size.data(), size.size());
+	store.write(dict.get_data().data(), dict.get_data().size());
+    }
+    store.flush();
+}
+
 void
 HoneyTable::commit(honey_revision_number_t, RootInfo* root_info)
 {
@@ -146,12 +368,135 @@ HoneyTable::commit(honey_revision_number_t, RootInfo* root_info)
     root_info->set_num_entries(num_entries);
     // offset should already be set.
     root_info->set_root(root);
+    root_info->set_bloom_offset(bloom_offset);
+    root_info->set_compression(compression);
+    root_info->set_dict_offset(dict_offset);
     // Not really meaningful.
     // root_info->set_free_list(std::string());
 
     read_only = true;
     store.rewind(offset);
     last_key = string();
+    index_top.clear();
+    read_index();
+}
+
+void
+HoneyTable::get_key_ranges(vector<pair<string, off_t>>& ranges) const
+{
+    if (root < 0 || !store.is_open()) return;
+    if (!index_top.empty()) {
+	for (size_t i = 0; i != index_top.size(); ++i) {
+	    off_t start = index_top.get_data_ptr(i);
+	    off_t end = (i + 1 == index_top.size() ?
+			 root : index_top.get_data_ptr(i + 1));
+	    ranges.emplace_back(string(index_top.get_separator(i)),
+				end - start);
+	}
+	return;
+    }
+    BufferedFile f(store);
+    f.rewind(root);
+    if (f.read() != 0x00) return;
+    int first = f.read();
+    int range = f.read();
+    if (first == EOF || range == EOF) return;
+    vector<off_t> ptrs(range + 1);
+    for (auto& ptr : ptrs) {
+	ptr = f.read_uint4_be();
+    }
+    // The entry for an initial byte which no key has points to the next key
+    // so gives an empty range, and the data ends where the index starts.
+    for (int i = 0; i <= range; ++i) {
+	off_t end = (i == range ? root : ptrs[i + 1]);
+	if (end > ptrs[i])
+	    ranges.emplace_back(string(1, char(first + i)), end - ptrs[i]);
+    }
+}
+
+bool
+HoneyTable::readahead_key(string_view key) const
+{
+    if (!read_only || root < 0 || !store.is_open())
+	return false;
+    if (key.empty())
+	return true;
+
+    BufferedFile f(store);
+    off_t start, end;
+    if (!index_top.empty()) {
+	string index_key, next_key;
+	if (!find_in_partitions(f, key, index_key, start, next_key, end)) {
+	    // The key isn't present.
+	    return true;
+	}
+	goto have_range;
+    }
+    f.rewind(root);
+    switch (f.read()) {
+	case 0x00: {
+	    int first = f.read();
+	    int range = f.read();
+	    if (first == EOF || range == EOF)
+		return false;
+	    unsigned char i = static_cast<unsigned char>(key[0]) - first;
+	    if (i > range) {
+		// No keys start with key[0].
+		return true;
+	    }
+	    f.skip(i * 4);
+	    start = f.read_uint4_be();
+	    end = (i == range ? root : off_t(f.read_uint4_be()));
+	    break;
+	}
+	case 0x01: {
+	    size_t j = f.read_uint4_be();
+	    if (j == 0)
+		return true;
+	    size_t n_index = j;
+	    off_t base = f.get_pos();
+	    char kkey[SSTINDEX_BINARY_CHOP_KEY_SIZE];
+	    size_t i = 0;
+	    while (j - i > 1) {
+		size_t k = i + (j - i) / 2;
+		f.set_pos(base + k * SSTINDEX_BINARY_CHOP_ENTRY_SIZE);
+		f.read(kkey, SSTINDEX_BINARY_CHOP_KEY_SIZE);
+		size_t kkey_len = SSTINDEX_BINARY_CHOP_KEY_SIZE;
+		while (kkey_len > 0 && kkey[kkey_len - 1] == '\0')
+		    --kkey_len;
+		int r = key.compare(0, SSTINDEX_BINARY_CHOP_KEY_SIZE,
+				    kkey, kkey_len);
+		if (r < 0) {
+		    j = k;
+		} else {
+		    i = k;
+		    if (r == 0)
+			break;
+		}
+	    }
+	    f.set_pos(base + i * SSTINDEX_BINARY_CHOP_ENTRY_SIZE +
+		      SSTINDEX_BINARY_CHOP_KEY_SIZE);
+	    start = f.read_uint4_be();
+	    if (i + 1 == n_index) {
+		end = root;
+	    } else {
+		f.skip(SSTINDEX_BINARY_CHOP_KEY_SIZE);
+		end = f.read_uint4_be();
+	    }
+	    break;
+	}
+	default:
+	    // FIXME: Support the skiplist index.
+	    return false;
+    }
+
+have_range:
+    if (end <= start || end - start > HONEY_READAHEAD_MAX) {
+	// Either there's nothing to readahead, or we don't know which part of
+	// a large range the key is in.
+	return true;
+    }
+    return f.readahead(start, end - start);
 }
 
 bool
@@ -203,6 +548,14 @@ HoneyTable::read_key(std::string& key,
     }
 #endif
 
+    read_val_size(val_size, compressed);
+    return true;
+}
+
+void
+HoneyTable::read_val_size(size_t& val_size, bool& compressed) const
+{
+    char buf[8];
     int r;
     {
 	// FIXME: rework to take advantage of buffering that's happening anyway?
@@ -225,7 +578,6 @@ HoneyTable::read_key(std::string& key,
     compressed = val_size & 1;
     val_size >>= 1;
     Assert(p == end);
-    return true;
 }
 
 void
@@ -252,13 +604,18 @@ HoneyTable::get_exact_entry(std::string_view key, std::string* tag) const
 	    throw_database_closed();
 	return false;
     }
-    store.rewind(root);
+    if (!bloom.may_contain(key))
+	return false;
     if (rare(key.empty()))
 	return false;
     bool exact_match = false;
     bool compressed = false;
     size_t val_size = 0;
-    int index_type = store.read();
+    int index_type = 0x03;
+    if (index_top.empty()) {
+	store.rewind(root);
+	index_type = store.read();
+    }
     switch (index_type) {
 	case EOF:
 	    return false;
@@ -411,6 +768,18 @@ HoneyTable::get_exact_entry(std::string_view key, std::string* tag) const
 
 	    break;
 	}
+	case 0x03: {
+	    string next_key;
+	    off_t ptr, next_ptr;
+	    if (!find_in_partitions(store, key, last_key, ptr,
+				    next_key, next_ptr)) {
+		return false;
+	    }
+	    store.set_pos(ptr);
+	    read_val_size(val_size, compressed);
+	    exact_match = (last_key == key);
+	    break;
+	}
 	default: {
 	    string m = "HoneyTable: Unknown index type ";
 	    m += str(index_type);
@@ -436,13 +805,7 @@ HoneyTable::get_exact_entry(std::string_view key, std::string* tag) const
 	if (compressed) {
 	    std::string v;
 	    read_val(v, val_size);
-	    CompressionStream comp_stream;
-	    comp_stream.decompress_start();
-	    tag->resize(0);
-	    if (!comp_stream.decompress_chunk(v.data(), v.size(), *tag)) {
-		// Decompression didn't complete.
-		abort();
-	    }
+	    decompress(v.data(), v.size(), *tag);
 	} else {
 	    read_val(*tag, val_size);
 	}
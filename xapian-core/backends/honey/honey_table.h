@@ -25,10 +25,6 @@
 # error config.h must be included first in each C++ source file
 #endif
 
-#define SSTINDEX_ARRAY
-//#define SSTINDEX_BINARY_CHOP
-//#define SSTINDEX_SKIPLIST
-
 #define SSTINDEX_BINARY_CHOP_KEY_SIZE 4
 #define SSTINDEX_BINARY_CHOP_PTR_SIZE 4
 #define SSTINDEX_BINARY_CHOP_ENTRY_SIZE \
@@ -39,6 +35,8 @@
 
 #include <algorithm>
 #include <string_view>
+#include <utility>
+#include <vector>
 #if 0
 #include <iostream> // FIXME
 #endif
@@ -55,6 +53,7 @@
 #include "safeunistd.h"
 
 #include "compression_stream.h"
+#include "honey_bloom.h"
 #include "honey_defs.h"
 #include "honey_version.h"
 #include "internaltypes.h"
@@ -80,12 +79,30 @@ class BufferedFileCommon {
     unsigned _refs = 0;
     off_t offset = 0;
 
+    /** Read-only memory mapping of the file, or NULL.
+     *
+     *  If set, reads are satisfied from here rather than with pread().
+     */
+    const char* map = nullptr;
+
+    /// Size of the memory mapping in bytes.
+    size_t map_size = 0;
+
     BufferedFileCommon(int fd_, off_t offset_)
 	: fd(fd_), _refs(1), offset(offset_) {}
 
+    ~BufferedFileCommon() { unmap(); }
+
     BufferedFileCommon(const BufferedFileCommon&) = delete;
 
     BufferedFileCommon& operator=(const BufferedFileCommon&) = delete;
+
+    void unmap() {
+	if (map) {
+	    io_munmap(map, map_size);
+	    map = nullptr;
+	}
+    }
 };
 
 class BufferedFile {
@@ -133,6 +150,7 @@ class BufferedFile {
 
     void close(bool fd_owned) {
 	if (common && common->fd >= 0) {
+	    common->unmap();
 	    if (fd_owned) ::close(common->fd);
 	    common->fd = -1;
 	}
@@ -140,11 +158,22 @@ class BufferedFile {
 
     void force_close(bool fd_owned) {
 	if (common) {
+	    common->unmap();
 	    if (fd_owned && common->fd >= 0) ::close(common->fd);
 	    common->fd = FORCED_CLOSE;
 	}
     }
 
+    /** Memory map the file to read from it.
+     *
+     *  The mapping is shared by all copies of this BufferedFile.  If mapping
+     *  fails we just carry on reading with pread().
+     */
+    void map() {
+	if (read_only && common && common->fd >= 0 && !common->map)
+	    common->map = io_mmap_rd(common->fd, common->map_size);
+    }
+
     bool is_open() const { return common && common->fd >= 0; }
 
     bool was_forced_closed() const {
@@ -185,7 +214,10 @@ class BufferedFile {
 	    if (delta > buf_end) {
 		buf_end = 0;
 	    } else {
+		// pos is the offset of the end of the buffered data, so stays
+		// the same.
 		buf_end -= delta;
+		return;
 	    }
 	}
 	pos = pos_;
@@ -274,6 +306,10 @@ class BufferedFile {
 
     int read() const {
 	if (buf_end == 0) {
+	    if (common->map) {
+		if (size_t(pos) >= common->map_size) return EOF;
+		return static_cast<unsigned char>(common->map[pos++]);
+	    }
 	    // The buffer is currently empty, so we need to read at least one
 	    // byte.
 	    size_t r = io_pread(common->fd, buf, sizeof(buf), pos, 0);
@@ -289,6 +325,14 @@ class BufferedFile {
 	return static_cast<unsigned char>(buf[sizeof(buf) - buf_end--]);
     }
 
+    /** Readahead @a len bytes starting at @a pos_.
+     *
+     *  Returns false if we can't readahead on this file.
+     */
+    bool readahead(off_t pos_, size_t len) const {
+	return io_readahead_block(common->fd, len, 0, pos_ + common->offset);
+    }
+
     uint4 read_uint4_be() const {
 	uint4 res = read() << 24;
 	res |= read() << 16;
@@ -309,6 +353,14 @@ class BufferedFile {
 	    len -= buf_end;
 	    buf_end = 0;
 	}
+	if (common->map) {
+	    size_t start = size_t(pos + common->offset);
+	    if (usual(start + len <= common->map_size)) {
+		memcpy(p, common->map + start, len);
+		pos += len;
+		return;
+	    }
+	}
 	// FIXME: refill buffer if len < sizeof(buf)
 	size_t r = io_pread(common->fd, p, len, pos + common->offset, len);
 	// io_pread() should throw an exception if it read < len bytes.
@@ -337,48 +389,105 @@ class BufferedFile {
 
 class HoneyCursor;
 
+/** Index for a HoneyTable, built as entries are added.
+ *
+ *  Two layouts are built at the same time, and write() picks which to store
+ *  based on how the keys turned out to be distributed.  The first byte of
+ *  the index says which it is:
+ *
+ *  0x00: An array of pointers to the first key with each initial byte.  This
+ *  is small and a lookup only needs one read, but a seek then has to scan
+ *  through all the keys with the same initial byte, which is slow when there
+ *  are a lot of them (e.g. a postlist table where most terms have the same
+ *  prefix).
+ *
+ *  0x03: A two-level partitioned index.  The leaf level has an entry for
+ *  about every INDEXBLOCK bytes of the table giving the full key and the
+ *  offset just after it, front-coded within partitions of PARTITION_ENTRIES
+ *  entries.  The top level gives a separator for each partition (the
+ *  shortest prefix of its first key which sorts after the key before it in
+ *  the table) with the offsets of the partition's leaf entries and first
+ *  key.  The top level is kept in memory once the table is opened, so a seek
+ *  is a binary chop there, then a scan of one partition, then a scan of at
+ *  most about INDEXBLOCK bytes of the table.
+ *
+ *  Types 0x01 (binary chop) and 0x02 (skiplist) were written by earlier
+ *  versions and can still be read.
+ */
 class SSTIndex {
-    std::string data;
-#if defined SSTINDEX_BINARY_CHOP
-    size_t block = size_t(-1);
-#elif defined SSTINDEX_SKIPLIST
-    size_t block = 0;
-#endif
-#if defined SSTINDEX_BINARY_CHOP || defined SSTINDEX_SKIPLIST
-    std::string last_index_key;
-#endif
     // Put an index entry every this much:
     // FIXME: tune - seems 64K is common elsewhere
     enum { INDEXBLOCK = 4096 };
-    SSTIndex* parent_index = NULL;
 
-#ifdef SSTINDEX_ARRAY
+    /// Number of leaf entries in each partition of a partitioned index.
+    enum { PARTITION_ENTRIES = 64 };
+
+    /** Use a partitioned index if any initial byte has more than this.
+     *
+     *  A seek using the array index scans all the keys with the same initial
+     *  byte, and beyond about this size that costs more than reading a
+     *  partition of the leaf level.
+     */
+    enum { ARRAY_RANGE_MAX = 16 * INDEXBLOCK };
+
     unsigned char first, last = static_cast<unsigned char>(-1);
     off_t* pointers = NULL;
-#endif
+
+    /// Top level of the partitioned index.
+    std::string top;
+
+    /// Leaf level of the partitioned index.
+    std::string leaves;
+
+    /// The last separator added to the top level.
+    std::string last_separator;
+
+    /// The last key added to the leaf level in the current partition.
+    std::string last_leaf_key;
+
+    /// The INDEXBLOCK sized block the last leaf entry was in.
+    size_t block = size_t(-1);
+
+    /// The number of leaf entries.
+    size_t leaf_entries = 0;
+
+    /// Size of the index written by write().
+    size_t index_size = 0;
+
+    /** Should write() store a partitioned index?
+     *
+     *  @param root	Where the index will be written (which is also where
+     *			the last range of keys ends).
+     */
+    bool use_partitioned(off_t root) const {
+	if (!pointers) return false;
+	for (unsigned ch = first; ch <= last; ++ch) {
+	    off_t end = (ch == last ? root : pointers[ch + 1]);
+	    if (end - pointers[ch] > ARRAY_RANGE_MAX)
+		return true;
+	    // The array index stores 4 byte offsets.
+	    if (sizeof(off_t) > 4 && pointers[ch] > off_t(0xffffffff))
+		return true;
+	}
+	return false;
+    }
 
   public:
     SSTIndex() {
-#ifdef SSTINDEX_ARRAY
 	// Header added in write() method.
-#elif defined SSTINDEX_BINARY_CHOP
-	data.assign(5, '\x01');
-#elif defined SSTINDEX_SKIPLIST
-	data.assign(1, '\x02');
-#else
-# error SSTINDEX type not specified
-#endif
     }
 
     ~SSTIndex() {
-#ifdef SSTINDEX_ARRAY
 	delete [] pointers;
-#endif
     }
 
-    void maybe_add_entry(std::string_view key, off_t ptr) {
+    /** Add an entry for the first key with a new initial byte.
+     *
+     *  @param key	The key.
+     *  @param ptr	The offset of the start of the key's entry.
+     */
+    void add_array_entry(std::string_view key, off_t ptr) {
 	Assert(!key.empty());
-#ifdef SSTINDEX_ARRAY
 	unsigned char initial = key[0];
 	if (!pointers) {
 	    pointers = new off_t[256]();
@@ -394,156 +503,161 @@ class SSTIndex {
 	}
 	pointers[initial] = ptr;
 	last = initial;
-#elif defined SSTINDEX_BINARY_CHOP
-	// We store entries truncated to a maximum width (and trailing zeros
-	// are used to indicate keys shorter than that max width).  These then
-	// point to the first key that maps to this truncated value.
-	//
-	// We need constant width entries to allow binary chop to work, but
-	// there are other ways to achieve this which could be explored.  We
-	// could allow the full key width of 256 bytes, but that would take a
-	// lot more space.  We could store a pointer (offset) to the key data,
-	// but that's more complex to read, and adds the pointer overhead.  We
-	// could use a "SKO" - a fixed width entry which encodes variable
-	// length pointer and key with short keys in the entry and long keys
-	// pointed to (or prefix included and rest pointed to).
-	if (last_index_key.size() == SSTINDEX_BINARY_CHOP_KEY_SIZE) {
-	    if (startswith(key, last_index_key)) {
-		return;
-	    }
-	}
-
-	// Ensure the truncated key doesn't end in a zero byte.
-	if (key.size() >= SSTINDEX_BINARY_CHOP_KEY_SIZE) {
-	    // FIXME: Start from char N if we have N array index levels above.
-	    last_index_key.assign(key, 0, SSTINDEX_BINARY_CHOP_KEY_SIZE);
-	    if (key[SSTINDEX_BINARY_CHOP_KEY_SIZE - 1] == '\0')
-		return;
-	} else {
-	    last_index_key = key;
-	    if (key.back() == '\0')
-		return;
-	    // Pad with zero bytes.
-	    last_index_key.resize(SSTINDEX_BINARY_CHOP_KEY_SIZE);
-	}
-
-	// Thin entries to at most one per INDEXBLOCK sized block.
-	size_t cur_block = ptr / INDEXBLOCK;
-	if (cur_block == block)
-	    return;
-
-#if 0
-	{
-	    std::string esc;
-	    description_append(esc, last_index_key);
-	    std::cout << "Adding «" << esc << "» -> file offset " << ptr
-		      << std::endl;
-	}
-#endif
-	data += last_index_key;
-	size_t c = data.size();
-	data.resize(c + 4);
-	unaligned_write4(reinterpret_cast<unsigned char*>(&data[c]), ptr);
+    }
 
-	block = cur_block;
-#elif defined SSTINDEX_SKIPLIST
+    /** Add a leaf entry for @a key if we've moved on to a new block.
+     *
+     *  @param key	The key.
+     *  @param prev_key	The key before @a key in the table.
+     *  @param ptr	The offset just after @a key in the table.
+     */
+    void maybe_add_leaf_entry(std::string_view key,
+			      std::string_view prev_key,
+			      off_t ptr) {
 	size_t cur_block = ptr / INDEXBLOCK;
 	if (cur_block == block) return;
-
-	size_t reuse = common_prefix_length(last_index_key, key);
-
-	data += char(reuse);
-	data += char(key.size() - reuse);
-	data.append(key, reuse, key.size() - reuse);
-	pack_uint(data, static_cast<std::make_unsigned_t<off_t>>(ptr));
-
 	block = cur_block;
-	// FIXME: deal with parent_index...
 
-	last_index_key = key;
-#else
-# error SSTINDEX type not specified
-#endif
+	auto uptr = static_cast<std::make_unsigned_t<off_t>>(ptr);
+	if (leaf_entries % PARTITION_ENTRIES == 0) {
+	    // Start a new partition.  The separator only needs to sort after
+	    // prev_key, which usually needs much less than all of key.
+	    std::string_view sep =
+		key.substr(0, common_prefix_length(prev_key, key) + 1);
+	    size_t reuse = common_prefix_length(last_separator, sep);
+	    top += char(reuse);
+	    top += char(sep.size() - reuse);
+	    top.append(sep.data() + reuse, sep.size() - reuse);
+	    pack_uint(top, leaves.size());
+	    pack_uint(top, uptr);
+	    last_separator = sep;
+	    last_leaf_key.resize(0);
+	}
+
+	size_t reuse = common_prefix_length(last_leaf_key, key);
+	leaves += char(reuse);
+	leaves += char(key.size() - reuse);
+	leaves.append(key.data() + reuse, key.size() - reuse);
+	pack_uint(leaves, uptr);
+	last_leaf_key = key;
+	++leaf_entries;
     }
 
     off_t write(BufferedFile& store) {
 	off_t root = store.get_pos();
 
-#ifdef SSTINDEX_ARRAY
-	if (!pointers) {
-	    first = last = 0;
-	    pointers = new off_t[1]();
-	}
-	data.resize(0);
-	data.resize(3 + (last - first + 1) * 4);
-	data[0] = 0;
-	data[1] = first;
-	data[2] = last - first;
-	for (unsigned ch = first; ch <= last; ++ch) {
-	    size_t o = 3 + (ch - first) * 4;
-	    // FIXME: Just make offsets 8 bytes?  Or allow different widths?
-	    off_t ptr = pointers[ch];
-	    if (sizeof(off_t) > 4 && ptr > off_t(0xffffffff))
-		throw Xapian::DatabaseError("Index offset needs >4 bytes");
-	    Assert(o + 4 <= data.size());
-	    unaligned_write4(reinterpret_cast<unsigned char*>(&data[o]), ptr);
+	std::string data;
+	if (use_partitioned(root)) {
+	    data = '\x03';
+	    pack_uint(data, top.size());
+	    pack_uint(data, leaves.size());
+	    data += top;
+	    data += leaves;
+	} else {
+	    if (!pointers) {
+		first = last = 0;
+		pointers = new off_t[1]();
+	    }
+	    data.resize(3 + (last - first + 1) * 4);
+	    data[0] = 0;
+	    data[1] = first;
+	    data[2] = last - first;
+	    for (unsigned ch = first; ch <= last; ++ch) {
+		size_t o = 3 + (ch - first) * 4;
+		// FIXME: Just make offsets 8 bytes?  Or allow different widths?
+		off_t ptr = pointers[ch];
+		Assert(o + 4 <= data.size());
+		unaligned_write4(reinterpret_cast<unsigned char*>(&data[o]),
+				 ptr);
+	    }
 	}
 	delete [] pointers;
 	pointers = NULL;
-#elif defined SSTINDEX_BINARY_CHOP
-	if (last_index_key.size() == SSTINDEX_BINARY_CHOP_KEY_SIZE) {
-	    // Increment final byte(s) to give a key which is definitely
-	    // at or above any key which this could be truncated from.
-	    size_t i = last_index_key.size();
-	    unsigned char ch;
-	    do {
-		if (i == 0) {
-		    // We can't increment "\xff\xff\xff\xff" to give an upper
-		    // bound - just skip adding one in this case as the table
-		    // will handle it OK and there's not much to be gained by
-		    // adding one as few keys are larger.
-		    goto skip_adding_upper_bound;
-		}
-		--i;
-		ch = static_cast<unsigned char>(last_index_key[i]) + 1;
-		last_index_key[i] = ch;
-	    } while (ch == 0);
-	} else {
-	    // Pad with zeros, which gives an upper bound.
-	    last_index_key.resize(SSTINDEX_BINARY_CHOP_KEY_SIZE);
-	}
-
-	{
-	    data += last_index_key;
-	    size_t c = data.size();
-	    data.resize(c + 4);
-	    unaligned_write4(reinterpret_cast<unsigned char*>(&data[c]), root);
-	}
-
-skip_adding_upper_bound:
-	// Fill in bytes 1 to 4 with the number of entries.
-	size_t n_index = (data.size() - 5) / SSTINDEX_BINARY_CHOP_ENTRY_SIZE;
-	data[1] = n_index >> 24;
-	data[2] = n_index >> 16;
-	data[3] = n_index >> 8;
-	data[4] = n_index;
-#elif defined SSTINDEX_SKIPLIST
-	// Already built in data.
-#else
-# error SSTINDEX type not specified
-#endif
+	std::string().swap(top);
+	std::string().swap(leaves);
 
 	store.write(data.data(), data.size());
-	// FIXME: parent stuff...
+	index_size = data.size();
 	return root;
     }
 
-    size_t size() const {
-	// FIXME: For SSTINDEX_ARRAY, data.size() only correct after calling
-	// write().
-	size_t s = data.size();
-	if (parent_index) s += parent_index->size();
-	return s;
+    /// The size of the index (only valid after calling write()).
+    size_t size() const { return index_size; }
+};
+
+/** The top level of a partitioned table index.
+ *
+ *  This is read when the table is opened and kept in memory.
+ */
+class SSTIndexTop {
+    /// The separator of each partition, concatenated.
+    std::string separators;
+
+    /** The offset in separators of the end of each partition's separator.
+     *
+     *  We store offsets rather than a vector of strings to keep the memory
+     *  used down.
+     */
+    std::vector<size_t> separator_ends;
+
+    /** File offset of the leaf entries for each partition.
+     *
+     *  Has an extra entry for the end of the last partition.
+     */
+    std::vector<off_t> leaf_starts;
+
+    /// File offset just after the first key of each partition.
+    std::vector<off_t> data_ptrs;
+
+  public:
+    bool empty() const { return separator_ends.empty(); }
+
+    size_t size() const { return separator_ends.size(); }
+
+    void clear() {
+	separators.resize(0);
+	separator_ends.clear();
+	leaf_starts.clear();
+	data_ptrs.clear();
+    }
+
+    /** Unserialise the top level of a partitioned index.
+     *
+     *  @param top		The serialised top level.
+     *  @param leaf_base	File offset of the start of the leaf level.
+     *  @param leaf_size	Size of the leaf level in bytes.
+     */
+    void unserialise(std::string_view top, off_t leaf_base, size_t leaf_size);
+
+    std::string_view get_separator(size_t i) const {
+	size_t start = (i == 0 ? 0 : separator_ends[i - 1]);
+	return std::string_view(separators).substr(start,
+						   separator_ends[i] - start);
+    }
+
+    off_t get_leaf_start(size_t i) const { return leaf_starts[i]; }
+
+    off_t get_leaf_end(size_t i) const { return leaf_starts[i + 1]; }
+
+    off_t get_data_ptr(size_t i) const { return data_ptrs[i]; }
+
+    /** Find the partition @a key would be in.
+     *
+     *  Returns the last partition with a separator <= @a key, or size_t(-1)
+     *  if @a key sorts before all of them (so is before the first key).
+     */
+    size_t find(std::string_view key) const {
+	size_t i = 0, j = size();
+	// Invariant: separators before i are <= key; those from j are > key.
+	while (i != j) {
+	    size_t k = i + (j - i) / 2;
+	    if (get_separator(k) <= key) {
+		i = k + 1;
+	    } else {
+		j = k;
+	    }
+	}
+	return i - 1;
     }
 };
 
@@ -575,10 +689,66 @@ class HoneyTable {
      */
     off_t offset = 0;
 
+    /// Bloom filter over the keys (empty if there isn't one).
+    HoneyBloomFilter bloom;
+
+    /// Build a bloom filter while adding entries?
+    bool build_bloom = false;
+
+    /// Offset of the bloom filter from root, or 0 if there isn't one.
+    off_t bloom_offset = 0;
+
+    /// Read the bloom filter at bloom_offset.
+    void read_bloom_filter();
+
+    /// How tags in this table are compressed.
+    compression_method compression = COMPRESSION_ZLIB;
+
+    /// Dictionary to compress tags with (empty if there isn't one).
+    CompressionDictionary dict;
+
+    /// Offset of the dictionary from root, or 0 if there isn't one.
+    off_t dict_offset = 0;
+
+    /// Read the dictionary at dict_offset.
+    void read_dictionary();
+
+    /// Used to compress tags when adding entries.
+    CompressionStream comp_stream;
+
+    /// The top level of the index if it's partitioned (otherwise empty).
+    SSTIndexTop index_top;
+
+    /// Read the top level of the index if it's partitioned.
+    void read_index();
+
+    /** Find where to start looking for @a key using a partitioned index.
+     *
+     *  @param f		File to read the index with.
+     *  @param key		The key to look for.
+     *  @param[out] index_key	The last index key <= @a key.
+     *  @param[out] ptr		The offset just after index_key in the table.
+     *  @param[out] next_key	The next index key (empty if there isn't one).
+     *  @param[out] next_ptr	The offset just after next_key in the table
+     *				(or root if there isn't one).
+     *
+     *  @return true if there's an index key <= @a key.  If not, @a key isn't
+     *		in the table and next_key is the first key after it.
+     */
+    bool find_in_partitions(BufferedFile& f,
+			    std::string_view key,
+			    std::string& index_key,
+			    off_t& ptr,
+			    std::string& next_key,
+			    off_t& next_ptr) const;
+
     bool get_exact_entry(std::string_view key, std::string* tag) const;
 
     bool read_key(std::string& key, size_t& val_size, bool& compressed) const;
 
+    /// Read the size of the value at the current position.
+    void read_val_size(size_t& val_size, bool& compressed) const;
+
     void read_val(std::string& val, size_t val_size) const;
 
   public:
@@ -627,6 +797,12 @@ class HoneyTable {
 	    store.close(fd_owned);
     }
 
+    /** Memory map the table to read from it.
+     *
+     *  Only has an effect for a table opened read-only.
+     */
+    void set_mmap() { store.map(); }
+
     const std::string& get_path() const { return path; }
 
     void add(std::string_view key,
@@ -640,11 +816,61 @@ class HoneyTable {
 	add(key, val.data(), val.size(), compressed);
     }
 
-    void flush_db() {
-	root = index.write(store);
-	store.flush();
+    /** Build a bloom filter over the keys added.
+     *
+     *  Must be called before any entries are added.
+     */
+    void set_bloom_filter() { build_bloom = true; }
+
+    /** Set how to compress tags added.
+     *
+     *  Must be called before any entries are added.
+     *
+     *  @param method		The compression method to use.
+     *  @param dictionary	Dictionary to prime compression with (empty
+     *				for none).  Only supported by zstd.
+     */
+    void set_compression(compression_method method,
+			 std::string&& dictionary = std::string());
+
+    /// How tags in this table are compressed.
+    compression_method get_compression() const { return compression; }
+
+    /// The dictionary tags are compressed with (NULL if there isn't one).
+    const CompressionDictionary* get_dictionary() const {
+	return dict.empty() ? nullptr : &dict;
+    }
+
+    /** Decompress a tag read from this table.
+     *
+     *  Uses state kept for the current thread so repeated calls don't each
+     *  need to set up a new decompressor.
+     */
+    void decompress(const char* p, size_t len, std::string& tag) const {
+	auto& stream = CompressionStream::get_thread_local();
+	stream.decompress(compression, get_dictionary(), p, len, tag);
     }
 
+    /** Might @a key be in this table?
+     *
+     *  Returns true unless the table's bloom filter (if it has one) shows
+     *  that @a key isn't present.
+     */
+    bool may_contain(std::string_view key) const {
+	return bloom.may_contain(key);
+    }
+
+    /// The size of the bloom filter in bytes (0 if there isn't one).
+    size_t get_bloom_filter_size() const { return bloom.size(); }
+
+    /** The type code of this table's index.
+     *
+     *  Returns EOF if the table has no index.
+     */
+    int get_index_type() const;
+
+    void flush_db();
+
     void cancel(const Honey::RootInfo&, honey_revision_number_t) {
 	std::abort();
     }
@@ -672,8 +898,16 @@ class HoneyTable {
 	std::abort();
     }
 
-    // readahead probably not useful?  (FIXME)
-    bool readahead_key(const std::string&) const { return false; }
+    /** Readahead the part of the table which @a key is in.
+     *
+     *  The index is used to find the range of the table to readahead.
+     *  With the array index this range is all the keys with the same first
+     *  byte so we only readahead if the range is fairly small.  With the
+     *  partitioned index it's the block between two leaf entries.
+     *
+     *  Returns false if we can't readahead for this table.
+     */
+    bool readahead_key(std::string_view key) const;
 
     bool is_modified() const { return !read_only && !empty(); }
 
@@ -701,6 +935,19 @@ class HoneyTable {
     off_t get_root() const { return root; }
 
     off_t get_offset() const { return offset; }
+
+    /** Get approximate sizes of ranges of keys in the table.
+     *
+     *  This is intended for splitting work on a table into similar sized
+     *  parts.  With the array index, each range is all the keys with the
+     *  same first byte.  With the partitioned index, each range is a
+     *  partition and starts with its separator.  With other index types
+     *  nothing is returned currently.
+     *
+     *  @param[out] ranges  Filled with pairs of (first key in range, size of
+     *			    the range in bytes) in ascending key order.
+     */
+    void get_key_ranges(std::vector<std::pair<std::string, off_t>>& ranges) const;
 };
 
 #endif // XAPIAN_INCLUDED_HONEY_TABLE_H
@@ -51,8 +51,10 @@
 using namespace std;
 
 /// Honey format version (date of change):
-#define HONEY_FORMAT_VERSION DATE_TO_VERSION(2018,4,3)
-// 2018,4,3   2.0.0 outlaw mixed-wdf terms
+#define HONEY_FORMAT_VERSION DATE_TO_VERSION(2026,10,18)
+// 2026,10,18 2.0.0 store wdf and doclen bounds for each posting chunk;
+//                  record compression method and dictionary for each table
+// 2018,4,3         outlaw mixed-wdf terms
 // 2018,3,28        don't special case first entry in SSTable
 // 2018,3,27        new key format for value stats, value chunks, doclen chunks
 // 2018,3,26        use known suffix from spelling B and T keys
@@ -488,7 +490,10 @@ RootInfo::init(uint4 compress_min_)
     offset = 0;
     root = 0;
     num_entries = 0;
+    bloom_offset = 0;
     compress_min = compress_min_;
+    compression = COMPRESSION_ZLIB;
+    dict_offset = 0;
     fl_serialised.resize(0);
 }
 
@@ -500,31 +505,42 @@ RootInfo::serialise(string& s) const
     AssertRel(root, >=, offset);
     pack_uint(s, uoffset);
     pack_uint(s, root - uoffset);
-    pack_uint(s, 0u);
+    // This was always zero before bloom filters were added, which means no
+    // filter.
+    AssertRel(bloom_offset, >=, 0);
+    pack_uint(s, std::make_unsigned_t<off_t>(bloom_offset));
     pack_uint(s, num_entries);
     pack_uint(s, 2048u >> 11);
     pack_uint(s, compress_min);
+    pack_uint(s, unsigned(compression));
+    AssertRel(dict_offset, >=, 0);
+    pack_uint(s, std::make_unsigned_t<off_t>(dict_offset));
     pack_string(s, fl_serialised);
 }
 
 bool
 RootInfo::unserialise(const char** p, const char* end)
 {
-    std::make_unsigned_t<off_t> uoffset, uroot;
-    unsigned dummy_val;
+    std::make_unsigned_t<off_t> uoffset, uroot, ubloom_offset, udict_offset;
     unsigned dummy_blocksize;
+    unsigned ucompression;
     if (!unpack_uint(p, end, &uoffset) ||
 	!unpack_uint(p, end, &uroot) ||
-	!unpack_uint(p, end, &dummy_val) ||
+	!unpack_uint(p, end, &ubloom_offset) ||
 	!unpack_uint(p, end, &num_entries) ||
 	!unpack_uint(p, end, &dummy_blocksize) ||
 	!unpack_uint(p, end, &compress_min) ||
+	!unpack_uint(p, end, &ucompression) ||
+	!unpack_uint(p, end, &udict_offset) ||
 	!unpack_string(p, end, fl_serialised)) return false;
+    if (ucompression > COMPRESSION_LZ4) return false;
     offset = uoffset;
     root = uoffset + uroot;
+    bloom_offset = ubloom_offset;
+    compression = compression_method(ucompression);
+    dict_offset = udict_offset;
     // Not meaningful, but still there so that existing honey databases
     // continue to work.
-    (void)dummy_val;
     (void)dummy_blocksize;
     // Map old default to new default.
     if (compress_min == 4) {
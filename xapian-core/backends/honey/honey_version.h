@@ -31,6 +31,7 @@
 #include <string_view>
 
 #include "backends/uuids.h"
+#include "compression_stream.h"
 #include "internaltypes.h"
 #include "min_non_zero.h"
 #include "xapian/types.h"
@@ -41,8 +42,21 @@ class RootInfo {
     off_t offset;
     off_t root;
     honey_tablesize_t num_entries;
+    /** Offset from root to the table's bloom filter.
+     *
+     *  Zero if there's no filter (the index is never empty, so a filter
+     *  can't be at offset zero).
+     */
+    off_t bloom_offset;
     /// Should be >= 4 or 0 for no compression.
     uint4 compress_min;
+    /// How tags in the table are compressed.
+    compression_method compression;
+    /** Offset from root to the table's compression dictionary.
+     *
+     *  Zero if there's no dictionary.
+     */
+    off_t dict_offset;
     std::string fl_serialised;
 
   public:
@@ -55,12 +69,18 @@ class RootInfo {
     off_t get_offset() const { return offset; }
     off_t get_root() const { return root; }
     honey_tablesize_t get_num_entries() const { return num_entries; }
+    off_t get_bloom_offset() const { return bloom_offset; }
     uint4 get_compress_min() const { return compress_min; }
+    compression_method get_compression() const { return compression; }
+    off_t get_dict_offset() const { return dict_offset; }
     const std::string& get_free_list() const { return fl_serialised; }
 
     void set_num_entries(honey_tablesize_t n) { num_entries = n; }
     void set_offset(off_t offset_) { offset = offset_; }
     void set_root(off_t root_) { root = root_; }
+    void set_bloom_offset(off_t o) { bloom_offset = o; }
+    void set_compression(compression_method m) { compression = m; }
+    void set_dict_offset(off_t o) { dict_offset = o; }
     void set_free_list(const std::string& s) { fl_serialised = s; }
 };
 
@@ -283,6 +303,9 @@ class HoneyVersion {
 
     bool single_file() const { return db_dir.empty(); }
 
+    /// The fd of a single-file database.
+    int get_fd() const { return fd; }
+
     off_t get_offset() const { return offset; }
 };
 
@@ -180,6 +180,24 @@ InMemoryPostList::at_end() const
     return (pos == end);
 }
 
+unsigned
+InMemoryPostList::peek_postings(Xapian::docid* dids,
+				Xapian::termcount* wdfs,
+				unsigned max) const
+{
+    if (db->is_closed()) InMemoryDatabase::throw_database_closed();
+    Assert(started);
+    Assert(!at_end());
+    unsigned n = 0;
+    for (auto i = pos; i != end && n != max; ++i) {
+	if (!i->valid) continue;
+	dids[n] = i->did;
+	wdfs[n] = i->wdf;
+	++n;
+    }
+    return n;
+}
+
 void
 InMemoryPostList::get_docid_range(Xapian::docid& first,
 				  Xapian::docid& last) const
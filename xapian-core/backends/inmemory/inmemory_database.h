@@ -166,6 +166,10 @@ class InMemoryPostList : public LeafPostList {
     // True if we're off the end of the list.
     bool at_end() const;
 
+    unsigned peek_postings(Xapian::docid* dids,
+			   Xapian::termcount* wdfs,
+			   unsigned max) const;
+
     Xapian::termcount get_wdf_upper_bound() const;
 
     void get_docid_range(Xapian::docid& first, Xapian::docid& last) const;
@@ -30,9 +30,103 @@
 
 using namespace std;
 
+/// The number of postings to calculate weights for in one go.
+static constexpr unsigned WEIGHT_BLOCK_SIZE = 32;
+
+/** How many postings to weight individually after a poorly used block.
+ *
+ *  If most of the weights in a block go unused then the postlist is being
+ *  skipped through rather than iterated over, so calculating weights ahead
+ *  of time is wasted work.
+ */
+static constexpr unsigned WEIGHT_BLOCK_BACKOFF = 64;
+
+struct LeafPostList::WeightBlock {
+    /// The docids of the postings in the block.
+    Xapian::docid did[WEIGHT_BLOCK_SIZE];
+
+    /// The weights of the postings in the block.
+    double weight[WEIGHT_BLOCK_SIZE];
+
+    /// Index of the posting we're currently at.
+    unsigned pos = 0;
+
+    /// Number of postings in the block.
+    unsigned len = 0;
+
+    /// Number of weights from the block which have been used.
+    unsigned used = 0;
+
+    /// Number of postings to weight individually before trying a new block.
+    unsigned backoff = 0;
+};
+
 LeafPostList::~LeafPostList()
 {
     delete weight;
+    delete block;
+}
+
+bool
+LeafPostList::get_block_weight(double& result) const
+{
+    Xapian::docid did = get_docid();
+    WeightBlock* b = block;
+    if (b) {
+	while (b->pos < b->len && b->did[b->pos] < did) ++b->pos;
+	if (b->pos < b->len && b->did[b->pos] == did) {
+	    ++b->used;
+	    result = b->weight[b->pos];
+	    return true;
+	}
+	if (b->len) {
+	    if (b->used * 2 < b->len) b->backoff = WEIGHT_BLOCK_BACKOFF;
+	    b->len = 0;
+	}
+	if (b->backoff) {
+	    --b->backoff;
+	    return false;
+	}
+    } else {
+	// Looking up document statistics for postings ahead of the current
+	// one costs more than scoring them in a block saves, especially as
+	// many of them will be skipped over, so only use blocks for weighting
+	// schemes which just need the wdf.  Other schemes get the statistics
+	// the matcher has already fetched for the current document.
+	if (weight->get_sumpart_needs_doclength_() ||
+	    weight->get_sumpart_needs_uniqueterms_() ||
+	    weight->get_sumpart_needs_wdfdocmax_()) {
+	    no_block = true;
+	    return false;
+	}
+	b = new WeightBlock;
+	block = b;
+    }
+
+    Xapian::termcount wdfs[WEIGHT_BLOCK_SIZE];
+    unsigned n = peek_postings(b->did, wdfs, WEIGHT_BLOCK_SIZE);
+    if (n == 0) {
+	no_block = true;
+	delete block;
+	block = nullptr;
+	return false;
+    }
+    AssertEq(b->did[0], did);
+    AssertEq(wdfs[0], get_wdf());
+
+    // The weighting scheme doesn't use the other statistics.
+    static const Xapian::termcount zeros[WEIGHT_BLOCK_SIZE] = { 0 };
+    weight->get_sumpart_block(n, wdfs, zeros, zeros, zeros, b->weight);
+#ifdef XAPIAN_ASSERTIONS
+    for (unsigned i = 0; i != n; ++i) {
+	AssertRel(b->weight[i], <=, weight->get_maxpart());
+    }
+#endif
+    b->pos = 0;
+    b->len = n;
+    b->used = 1;
+    result = b->weight[0];
+    return true;
 }
 
 double
@@ -41,6 +135,11 @@ LeafPostList::get_weight(Xapian::termcount doclen,
 			 Xapian::termcount wdfdocmax) const
 {
     if (!weight) return 0;
+    if (weight->use_sumpart_block_() && !no_block) {
+	double result;
+	if (get_block_weight(result))
+	    return result;
+    }
     double sumpart = weight->get_sumpart(get_wdf(), doclen,
 					 unique_terms, wdfdocmax);
     AssertRel(sumpart, <=, weight->get_maxpart());
@@ -53,6 +152,16 @@ LeafPostList::recalc_maxweight()
     return weight ? weight->get_maxpart() : 0;
 }
 
+double
+LeafPostList::get_block_maxweight(Xapian::termcount wdf_max,
+				  Xapian::termcount doclen_min) const
+{
+    if (!weight) return 0;
+    double block_max = weight->get_block_maxpart(wdf_max, doclen_min);
+    AssertRel(block_max, <=, weight->get_maxpart());
+    return block_max;
+}
+
 Xapian::termcount
 LeafPostList::count_matching_subqs() const
 {
@@ -70,3 +179,9 @@ LeafPostList::open_nearby_postlist(std::string_view, bool, LeafPostList*&) const
 {
     return false;
 }
+
+unsigned
+LeafPostList::peek_postings(Xapian::docid*, Xapian::termcount*, unsigned) const
+{
+    return 0;
+}
@@ -44,6 +44,29 @@ class LeafPostList : public PostList {
     /// Don't allow copying.
     LeafPostList(const LeafPostList &) = delete;
 
+    /** Weights calculated ahead of time for a block of postings.
+     *
+     *  Only used for weighting schemes which implement get_sumpart_block().
+     */
+    struct WeightBlock;
+
+    /// Allocated on first use.
+    mutable WeightBlock* block = nullptr;
+
+    /** Set if blocks aren't used.
+     *
+     *  Either peek_postings() isn't supported, or the weighting scheme needs
+     *  per-document statistics other than the wdf.
+     */
+    mutable bool no_block = false;
+
+    /** Get the weight for the current posting via a WeightBlock.
+     *
+     *  @return true if @a result was set; false if the caller should use
+     *		get_sumpart() instead.
+     */
+    bool get_block_weight(double& result) const;
+
   protected:
     const Xapian::Weight* weight = nullptr;
 
@@ -111,6 +134,19 @@ class LeafPostList : public PostList {
 
     double recalc_maxweight();
 
+    /** Get an upper bound on the weight contribution for a block of postings.
+     *
+     *  Backends which store bounds for blocks of postings can use this to
+     *  avoid decoding blocks which can't contain a posting with weight >=
+     *  the w_min passed to next() or skip_to().
+     *
+     *  @param wdf_max	    Upper bound on the wdf of any posting in the block.
+     *  @param doclen_min   Lower bound on the length of any document in the
+     *			    block.
+     */
+    double get_block_maxweight(Xapian::termcount wdf_max,
+			       Xapian::termcount doclen_min) const;
+
     Xapian::termcount count_matching_subqs() const;
 
     void gather_position_lists(OrPositionList* orposlist);
@@ -142,6 +178,27 @@ class LeafPostList : public PostList {
 				      bool need_read_pos,
 				      LeafPostList*& pl) const;
 
+    /** Decode postings from the current one onwards without advancing.
+     *
+     *  This allows weights to be calculated for a block of postings in one
+     *  go.  Only postings which can be decoded without further I/O should be
+     *  returned (e.g. those in the current chunk).
+     *
+     *  The default implementation returns 0 to indicate this isn't
+     *  supported.
+     *
+     *  @param[out] dids	Array to store the docids in.
+     *  @param[out] wdfs	Array to store the wdfs in.
+     *  @param max		Maximum number of postings to return (the
+     *				size of @a dids and @a wdfs).
+     *
+     *  @return The number of postings returned, which should be at least 1
+     *		(for the current posting) if this method is supported.
+     */
+    virtual unsigned peek_postings(Xapian::docid* dids,
+				   Xapian::termcount* wdfs,
+				   unsigned max) const;
+
     virtual Xapian::termcount get_wdf_upper_bound() const = 0;
 
     /** Get the term name. */
@@ -32,6 +32,7 @@
 
 #include <memory>
 #include <string_view>
+#include <vector>
 
 using namespace std;
 
@@ -475,6 +476,23 @@ MultiDatabase::get_spelling_frequency(string_view word) const
     return result;
 }
 
+void
+MultiDatabase::get_spelling_frequencies(const vector<string>& words,
+					vector<Xapian::doccount>& freqs) const
+{
+    freqs.assign(words.size(), 0);
+    vector<Xapian::doccount> shard_freqs;
+    for (auto&& shard : shards) {
+	shard->get_spelling_frequencies(words, shard_freqs);
+	for (size_t i = 0; i != words.size(); ++i) {
+	    auto old_result = freqs[i];
+	    freqs[i] += shard_freqs[i];
+	    if (freqs[i] < old_result)
+		throw Xapian::DatabaseError("Spelling frequency overflowed!");
+	}
+    }
+}
+
 TermList*
 MultiDatabase::open_synonym_termlist(string_view term) const
 {
@@ -599,6 +617,14 @@ MultiDatabase::commit()
     }
 }
 
+void
+MultiDatabase::set_flush_memory_limit(size_t limit)
+{
+    for (auto&& shard : shards) {
+	shard->set_flush_memory_limit(limit);
+    }
+}
+
 void
 MultiDatabase::cancel()
 {
@@ -709,6 +735,22 @@ MultiDatabase::request_document(Xapian::docid did) const
     shard->request_document(shard_did);
 }
 
+void
+MultiDatabase::request_documents(const vector<Xapian::docid>& dids) const
+{
+    auto n_shards = shards.size();
+    vector<vector<Xapian::docid>> shard_dids(n_shards);
+    for (Xapian::docid did : dids) {
+	Assert(did != 0);
+	shard_dids[shard_number(did, n_shards)].push_back(shard_docid(did,
+								      n_shards));
+    }
+    for (size_t i = 0; i != n_shards; ++i) {
+	if (!shard_dids[i].empty())
+	    shards[i]->request_documents(shard_dids[i]);
+    }
+}
+
 void
 MultiDatabase::add_spelling(string_view word,
 			    Xapian::termcount freqinc) const
@@ -130,6 +130,9 @@ class MultiDatabase : public Xapian::Database::Internal {
 
     Xapian::doccount get_spelling_frequency(std::string_view word) const;
 
+    void get_spelling_frequencies(const std::vector<std::string>& words,
+				  std::vector<Xapian::doccount>& freqs) const;
+
     TermList* open_synonym_termlist(std::string_view term) const;
 
     TermList* open_synonym_keylist(std::string_view prefix) const;
@@ -157,6 +160,8 @@ class MultiDatabase : public Xapian::Database::Internal {
 
     void cancel();
 
+    void set_flush_memory_limit(size_t limit);
+
     void begin_transaction(bool flushed);
 
     void end_transaction(bool do_commit);
@@ -174,6 +179,8 @@ class MultiDatabase : public Xapian::Database::Internal {
 
     void request_document(Xapian::docid did) const;
 
+    void request_documents(const std::vector<Xapian::docid>& dids) const;
+
     void add_spelling(std::string_view word, Xapian::termcount freqinc) const;
 
     Xapian::termcount remove_spelling(std::string_view word,
@@ -46,6 +46,7 @@
 #include "weight/weightinternal.h"
 
 #include <cerrno>
+#include <map>
 #include <memory>
 #include <string>
 #include <string_view>
@@ -58,6 +59,22 @@
 using namespace std;
 using Xapian::Internal::intrusive_ptr;
 
+/** Maximum number of pipelined documents to hold before they're opened.
+ *
+ *  This bounds the memory used if documents are requested (e.g. by
+ *  MSet::fetch()) but then never opened.
+ */
+static constexpr size_t MAX_FETCHED_DOCUMENTS = 1000;
+
+/** Maximum number of pipelined document requests awaiting a reply.
+ *
+ *  Each request and reply is a separate write, and if the server's replies
+ *  fill the connection's buffers while we're still sending requests then
+ *  both ends block.  Over a Unix domain socket each write takes up a
+ *  whole buffer (around 1KB on Linux), so keep this small enough to fit.
+ */
+static constexpr size_t MAX_AWAITING_REPLIES = 64;
+
 /// Return true if further replies should be expected.
 static inline bool
 is_intermediate_reply(int reply_code)
@@ -279,7 +296,14 @@ bool
 RemoteDatabase::reopen()
 {
     mru_slot = Xapian::BAD_VALUENO;
-    return update_stats(MSG_REOPEN);
+    bool changed = update_stats(MSG_REOPEN);
+    // The server answers messages in order, so all the replies to pipelined
+    // requests will have been stashed by now.  Discard them as they may be
+    // for an older revision.
+    fetched_documents.clear();
+    pending_documents.clear();
+    awaiting_replies = 0;
+    return changed;
 }
 
 void
@@ -315,6 +339,41 @@ RemoteDatabase::open_document(Xapian::docid did, bool /*lazy*/) const
 {
     Assert(did);
 
+    auto i = fetched_documents.find(did);
+    if (i != fetched_documents.end()) {
+	// We've already requested this document via request_document().
+	while (i->second.second.empty()) {
+	    string message;
+	    get_message(message, REPLY_DOCUMENT);
+	    stash_document(message);
+	}
+	string reply = std::move(i->second.second);
+	pending_documents.erase(i->second.first);
+	fetched_documents.erase(i);
+
+	const char* p = reply.data();
+	const char* p_end = p + reply.size();
+	if (*p++ != '\0') {
+	    unserialise_error(string(p, p_end), "REMOTE:", link.get_context());
+	}
+	string doc_data;
+	if (!unpack_string(&p, p_end, doc_data)) {
+	    unpack_throw_serialisation_error(p);
+	}
+	map<Xapian::valueno, string> values;
+	while (p != p_end) {
+	    Xapian::valueno slot;
+	    string value;
+	    if (!unpack_uint(&p, p_end, &slot) ||
+		!unpack_string(&p, p_end, value)) {
+		unpack_throw_serialisation_error(p);
+	    }
+	    values.emplace(slot, std::move(value));
+	}
+	return new RemoteDocument(this, did, std::move(doc_data),
+				  std::move(values));
+    }
+
     string message;
     pack_uint_last(message, did);
     send_message(MSG_DOCUMENT, message);
@@ -598,7 +657,14 @@ RemoteDatabase::get_message(string &result,
 {
     double end_time = RealTime::end_time(timeout);
     int type = link.get_message(result, end_time);
-    if (pending_reply && !is_intermediate_reply(type)) {
+    while (type == REPLY_DOCUMENT && required_type != REPLY_DOCUMENT) {
+	// A reply to a pipelined request which has arrived before the reply
+	// we want.
+	stash_document(result);
+	type = link.get_message(result, end_time);
+    }
+    if (pending_reply && !is_intermediate_reply(type) &&
+	type != REPLY_DOCUMENT) {
 	pending_reply = false;
     }
     if (type < 0)
@@ -629,7 +695,8 @@ RemoteDatabase::get_message(string &result,
 }
 
 void
-RemoteDatabase::send_message(message_type type, string_view message) const
+RemoteDatabase::send_message(message_type type, string_view message,
+			     bool expect_reply) const
 {
     double end_time = RealTime::end_time(timeout);
     while (pending_reply) {
@@ -637,12 +704,16 @@ RemoteDatabase::send_message(message_type type, string_view message) const
 	int reply_code = link.get_message(dummy, end_time);
 	if (reply_code < 0)
 	    throw_connection_closed_unexpectedly();
+	if (reply_code == REPLY_DOCUMENT) {
+	    stash_document(dummy);
+	    continue;
+	}
 	if (!is_intermediate_reply(reply_code)) {
 	    pending_reply = false;
 	}
     }
     link.send_message(static_cast<unsigned char>(type), message, end_time);
-    pending_reply = true;
+    if (expect_reply) pending_reply = true;
 }
 
 void
@@ -800,6 +871,7 @@ RemoteDatabase::cancel()
 
     cached_stats_valid = false;
     mru_slot = Xapian::BAD_VALUENO;
+    discard_fetched_documents();
 
     send_message(MSG_CANCEL, {});
     string dummy;
@@ -813,6 +885,7 @@ RemoteDatabase::add_document(const Xapian::Document & doc)
 {
     cached_stats_valid = false;
     mru_slot = Xapian::BAD_VALUENO;
+    discard_fetched_documents();
     uncommitted_changes = true;
 
     send_message(MSG_ADDDOCUMENT, serialise_document(doc));
@@ -834,6 +907,7 @@ RemoteDatabase::delete_document(Xapian::docid did)
 {
     cached_stats_valid = false;
     mru_slot = Xapian::BAD_VALUENO;
+    discard_fetched_documents();
     uncommitted_changes = true;
 
     string message;
@@ -848,6 +922,7 @@ RemoteDatabase::delete_document(std::string_view unique_term)
 {
     cached_stats_valid = false;
     mru_slot = Xapian::BAD_VALUENO;
+    discard_fetched_documents();
     uncommitted_changes = true;
 
     send_message(MSG_DELETEDOCUMENTTERM, unique_term);
@@ -861,6 +936,7 @@ RemoteDatabase::replace_document(Xapian::docid did,
 {
     cached_stats_valid = false;
     mru_slot = Xapian::BAD_VALUENO;
+    discard_fetched_documents();
     uncommitted_changes = true;
 
     string message;
@@ -878,6 +954,7 @@ RemoteDatabase::replace_document(std::string_view unique_term,
 {
     cached_stats_valid = false;
     mru_slot = Xapian::BAD_VALUENO;
+    discard_fetched_documents();
     uncommitted_changes = true;
 
     string message;
@@ -928,11 +1005,81 @@ RemoteDatabase::set_metadata(string_view key, string_view value)
 void
 RemoteDatabase::request_document(Xapian::docid did) const
 {
+    Assert(did);
+
+    if (fetched_documents.count(did)) {
+	// Already requested.
+	return;
+    }
+
+    if (fetched_documents.size() >= MAX_FETCHED_DOCUMENTS)
+	discard_oldest_document();
+    while (awaiting_replies >= MAX_AWAITING_REPLIES) {
+	string reply;
+	get_message(reply, REPLY_DOCUMENT);
+	stash_document(reply);
+    }
+
+    unsigned request_id = next_request_id++;
     string message;
-    pack_uint(message, did);
-    send_message(MSG_REQUESTDOCUMENT, message);
+    pack_uint(message, request_id);
+    pack_uint_last(message, did);
+    // Don't wait for the reply - it's read when the document is opened.
+    send_message(MSG_REQUESTDOCUMENT, message, false);
+    pending_documents.emplace(request_id, did);
+    fetched_documents.emplace(did, make_pair(request_id, string()));
+    ++awaiting_replies;
+}
 
-    get_message(message, REPLY_DONE);
+void
+RemoteDatabase::stash_document(const string& message) const
+{
+    const char* p = message.data();
+    const char* p_end = p + message.size();
+    unsigned request_id;
+    if (!unpack_uint(&p, p_end, &request_id) || p == p_end) {
+	unpack_throw_serialisation_error(p);
+    }
+    auto i = pending_documents.find(request_id);
+    if (i == pending_documents.end()) {
+	throw Xapian::NetworkError("Unexpected REPLY_DOCUMENT");
+    }
+    --awaiting_replies;
+    if (i->second == 0) {
+	// This request was discarded.
+	pending_documents.erase(i);
+	return;
+    }
+    fetched_documents[i->second].second.assign(p, p_end);
+}
+
+void
+RemoteDatabase::discard_oldest_document() const
+{
+    auto i = pending_documents.begin();
+    while (i->second == 0) ++i;
+    auto j = fetched_documents.find(i->second);
+    if (j->second.second.empty()) {
+	// Still waiting for the reply, so mark it to be ignored.
+	i->second = 0;
+    } else {
+	pending_documents.erase(i);
+    }
+    fetched_documents.erase(j);
+}
+
+void
+RemoteDatabase::discard_fetched_documents() const
+{
+    for (auto&& fetched : fetched_documents) {
+	auto i = pending_documents.find(fetched.second.first);
+	if (fetched.second.second.empty()) {
+	    i->second = 0;
+	} else {
+	    pending_documents.erase(i);
+	}
+    }
+    fetched_documents.clear();
 }
 
 void
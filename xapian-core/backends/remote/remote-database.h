@@ -30,6 +30,7 @@
 #include "backends/valuestats.h"
 #include "xapian/weight.h"
 
+#include <map>
 #include <utility>
 
 namespace Xapian {
@@ -82,6 +83,51 @@ class RemoteDatabase : public Xapian::Database::Internal {
      */
     mutable bool pending_reply = false;
 
+    /// Id to use for the next pipelined document request.
+    mutable unsigned next_request_id = 0;
+
+    /** Pipelined document requests which haven't been opened yet.
+     *
+     *  Maps request id to docid, so the oldest requests come first.  A
+     *  docid of 0 means the request has been discarded and its reply should
+     *  be ignored when it arrives.
+     */
+    mutable std::map<unsigned, Xapian::docid> pending_documents;
+
+    /** Number of pipelined document requests we've not had a reply to.
+     *
+     *  This is limited to MAX_AWAITING_REPLIES.
+     */
+    mutable size_t awaiting_replies = 0;
+
+    /** Replies to pipelined document requests, by docid.
+     *
+     *  The value is the request id and the reply.  An empty reply means the
+     *  document has been requested but the reply hasn't been received yet.
+     *
+     *  This holds at most MAX_FETCHED_DOCUMENTS entries - if more are
+     *  requested without being opened the oldest are discarded, and will be
+     *  fetched again if they are opened later.
+     */
+    mutable std::map<Xapian::docid,
+		     std::pair<unsigned, std::string>> fetched_documents;
+
+    /// Store a REPLY_DOCUMENT message until the document is opened.
+    void stash_document(const std::string& message) const;
+
+    /** Discard the oldest pipelined document request.
+     *
+     *  Must only be called if fetched_documents isn't empty.
+     */
+    void discard_oldest_document() const;
+
+    /** Discard all pipelined document requests.
+     *
+     *  Used when the database is modified, since replies to earlier requests
+     *  may no longer be valid.
+     */
+    void discard_fetched_documents() const;
+
     /// The UUID of the remote database.
     mutable std::string uuid;
 
@@ -146,8 +192,14 @@ class RemoteDatabase : public Xapian::Database::Internal {
 	return get_message(message, required_type, REPLY_DONE) != REPLY_DONE;
     }
 
-    /// Send a message to the server.
-    void send_message(message_type type, std::string_view data) const;
+    /** Send a message to the server.
+     *
+     *  @param expect_reply	If false, the message is pipelined and its
+     *				reply is matched up by request id instead of
+     *				being expected next.
+     */
+    void send_message(message_type type, std::string_view data,
+		      bool expect_reply = true) const;
 
     /// Close the socket
     void do_close();
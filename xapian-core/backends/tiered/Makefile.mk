@@ -0,0 +1,22 @@
+EXTRA_DIST +=\
+	backends/tiered/Makefile
+
+if BUILD_BACKEND_TIERED
+noinst_HEADERS +=\
+	backends/tiered/tiered_alltermslist.h\
+	backends/tiered/tiered_database.h\
+	backends/tiered/tiered_merge.h\
+	backends/tiered/tiered_metadata.h\
+	backends/tiered/tiered_postlist.h\
+	backends/tiered/tiered_termlist.h\
+	backends/tiered/tiered_valuelist.h
+
+lib_src +=\
+	backends/tiered/tiered_alltermslist.cc\
+	backends/tiered/tiered_database.cc\
+	backends/tiered/tiered_merge.cc\
+	backends/tiered/tiered_metadata.cc\
+	backends/tiered/tiered_postlist.cc\
+	backends/tiered/tiered_termlist.cc\
+	backends/tiered/tiered_valuelist.cc
+endif
@@ -0,0 +1,81 @@
+/** @file
+ * @brief Iterate all terms in a tiered database with hidden documents
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "tiered_alltermslist.h"
+
+using namespace std;
+
+TieredAllTermsList::~TieredAllTermsList()
+{
+    delete sub;
+}
+
+bool
+TieredAllTermsList::update(TermList* result, bool& at_end)
+{
+    if (result) {
+	if (result == sub) {
+	    at_end = true;
+	    return false;
+	}
+	// Prune.
+	delete sub;
+	sub = result;
+    }
+    current_term = sub->get_termname();
+    // MultiAllTermsList::get_termfreq() advances past the current term, so
+    // only call it if our get_termfreq() is called.
+    if (!exact_freqs)
+	return true;
+    db->get_freqs(current_term, &termfreq, NULL);
+    return termfreq != 0;
+}
+
+Xapian::termcount
+TieredAllTermsList::get_approx_size() const
+{
+    return sub->get_approx_size();
+}
+
+Xapian::doccount
+TieredAllTermsList::get_termfreq() const
+{
+    return exact_freqs ? termfreq : sub->get_termfreq();
+}
+
+TermList*
+TieredAllTermsList::next()
+{
+    bool at_end = false;
+    while (!update(sub->next(), at_end)) {
+	if (at_end) return this;
+    }
+    return NULL;
+}
+
+TermList*
+TieredAllTermsList::skip_to(string_view term)
+{
+    bool at_end = false;
+    if (update(sub->skip_to(term), at_end)) return NULL;
+    return at_end ? this : next();
+}
@@ -0,0 +1,86 @@
+/** @file
+ * @brief Iterate all terms in a tiered database with hidden documents
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef XAPIAN_INCLUDED_TIERED_ALLTERMSLIST_H
+#define XAPIAN_INCLUDED_TIERED_ALLTERMSLIST_H
+
+#include "backends/alltermslist.h"
+#include "backends/databaseinternal.h"
+
+#include <string_view>
+
+/** Iterate all terms in a tiered database.
+ *
+ *  If there are hidden documents then the term frequencies from the tiers
+ *  include them, so this calculates the actual term frequency for each term
+ *  and skips terms which only index hidden documents.
+ */
+class TieredAllTermsList : public AllTermsList {
+    /// Don't allow assignment.
+    void operator=(const TieredAllTermsList&) = delete;
+
+    /// Don't allow copying.
+    TieredAllTermsList(const TieredAllTermsList&) = delete;
+
+    /// The database.
+    Xapian::Internal::intrusive_ptr<const Xapian::Database::Internal> db;
+
+    /// Merged termlist from the tiers.
+    TermList* sub;
+
+    /// The term frequency of the current term.
+    Xapian::doccount termfreq = 0;
+
+    /// Do we need to calculate the term frequencies?
+    bool exact_freqs;
+
+    /** Handle the result of calling next() or skip_to() on @a sub.
+     *
+     *  @return true if we're on a term which indexes a visible document;
+     *		false if we need to advance further.  Sets @a at_end if
+     *		there are no more terms.
+     */
+    bool update(TermList* result, bool& at_end);
+
+  public:
+    /** Construct.
+     *
+     *  @param db_		The database.
+     *  @param sub_		Merged termlist from the tiers (we take
+     *				ownership).
+     *  @param exact_freqs_	Are any documents hidden?
+     */
+    TieredAllTermsList(const Xapian::Database::Internal* db_,
+		       TermList* sub_,
+		       bool exact_freqs_)
+	: db(db_), sub(sub_), exact_freqs(exact_freqs_) {}
+
+    ~TieredAllTermsList();
+
+    Xapian::termcount get_approx_size() const;
+
+    Xapian::doccount get_termfreq() const;
+
+    TermList* next();
+
+    TermList* skip_to(std::string_view term);
+};
+
+#endif // XAPIAN_INCLUDED_TIERED_ALLTERMSLIST_H
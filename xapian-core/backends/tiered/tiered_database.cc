@@ -0,0 +1,1596 @@
+/** @file
+ * @brief Database made of a writable glass head over honey segments
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "tiered_database.h"
+
+#include "xapian/constants.h"
+#include "xapian/error.h"
+#include "xapian/termiterator.h"
+
+#include "backends/backends.h"
+#include "backends/documentinternal.h"
+#include "backends/glass/glass_database.h"
+#include "backends/honey/honey_database.h"
+#include "backends/leafpostlist.h"
+#include "backends/multi/multi_alltermslist.h"
+#include "backends/uuids.h"
+#include "filetests.h"
+#include "fileutils.h"
+#include "io_utils.h"
+#include "min_non_zero.h"
+#include "omassert.h"
+#include "pack.h"
+#include "parseint.h"
+#include "posixy_wrapper.h"
+#include "safedirent.h"
+#include "safeunistd.h"
+#include "str.h"
+#include "stringutils.h"
+#include "tiered_alltermslist.h"
+#include "tiered_merge.h"
+#include "tiered_metadata.h"
+#include "tiered_postlist.h"
+#include "tiered_termlist.h"
+#include "tiered_valuelist.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <memory>
+
+using namespace std;
+using Xapian::Internal::intrusive_ptr;
+
+/// Name of the manifest file.
+#define TIERED_MANIFEST "/iamtiered"
+
+/// Version of the manifest format.
+#define TIERED_MANIFEST_VERSION 1
+
+/** How many times a reader retries opening if the manifest changes.
+ *
+ *  A writer removes segments once they've been merged, so a reader can fail
+ *  to open segments listed in a manifest it has just read.
+ */
+#define TIERED_OPEN_RETRIES 10
+
+/// Default number of documents in the head before it is frozen.
+#define TIERED_DEFAULT_FREEZE_THRESHOLD 100000
+
+/// Default number of segments of a similar size which get merged.
+#define TIERED_DEFAULT_MERGE_FACTOR 4
+
+/// Default number of changes after which we commit automatically.
+#define TIERED_DEFAULT_FLUSH_THRESHOLD 10000
+
+/** Metadata key recording that @a did was written in a later epoch.
+ *
+ *  The value is the epoch.
+ */
+static string
+hide_key(Xapian::docid did)
+{
+    string key{TIERED_METADATA_PREFIX};
+    key += 'h';
+    pack_uint_preserving_sort(key, did);
+    return key;
+}
+
+/// Metadata key for the highest docid used.
+static string
+last_docid_key()
+{
+    string key{TIERED_METADATA_PREFIX};
+    key += 'l';
+    return key;
+}
+
+/// Decode a key from hide_key().
+static Xapian::docid
+decode_hide_key(string_view key)
+{
+    const char* p = key.data() + TIERED_METADATA_PREFIX.size() + 1;
+    const char* end = key.data() + key.size();
+    Xapian::docid did;
+    if (!unpack_uint_preserving_sort(&p, end, &did) || p != end || did == 0)
+	throw Xapian::DatabaseCorruptError("Bad tiered docid key");
+    return did;
+}
+
+/// Decode an epoch value stored in the metadata.
+static unsigned
+decode_epoch(string_view value)
+{
+    const char* p = value.data();
+    const char* end = p + value.size();
+    unsigned epoch;
+    if (!unpack_uint(&p, end, &epoch) || p != end)
+	throw Xapian::DatabaseCorruptError("Bad tiered epoch");
+    return epoch;
+}
+
+/// Parse an unsigned number from the environment variable @a name.
+static unsigned
+env_unsigned(const char* name, unsigned default_value)
+{
+    unsigned result = 0;
+    const char* p = getenv(name);
+    if (p && *p) {
+	if (!parse_unsigned(p, result)) {
+	    throw Xapian::InvalidArgumentError(string(name) + " must be a "
+					       "non-negative integer");
+	}
+    }
+    return result ? result : default_value;
+}
+
+/** Return the number in the name of a head or segment directory.
+ *
+ *  Returns 0 if @a name isn't such a name.
+ */
+static unsigned
+shard_number(const string& name)
+{
+    if (name.size() < 2 || (name[0] != 'g' && name[0] != 'h'))
+	return 0;
+    unsigned n;
+    if (name[1] == '0' || !parse_unsigned(name.c_str() + 1, n))
+	return 0;
+    return n;
+}
+
+/** List the entries in directory @a dir.
+ *
+ *  Returns an empty list if @a dir doesn't exist.
+ */
+static vector<string>
+list_directory(const string& dir)
+{
+    vector<string> result;
+    DIR* d = opendir(dir.c_str());
+    if (d == NULL) {
+	if (errno == ENOENT) return result;
+	throw Xapian::DatabaseError("Cannot open directory '" + dir + "'",
+				    errno);
+    }
+    while (true) {
+	errno = 0;
+	struct dirent* entry = readdir(d);
+	if (entry == NULL) {
+	    int save_errno = errno;
+	    closedir(d);
+	    if (save_errno == 0) break;
+	    throw Xapian::DatabaseError("Cannot read entry from directory at "
+					"'" + dir + "'", save_errno);
+	}
+	string name(entry->d_name);
+	if (name != "." && name != "..")
+	    result.push_back(std::move(name));
+    }
+    return result;
+}
+
+bool
+TieredDatabase::Segment::is_hidden(Xapian::docid did) const
+{
+    return binary_search(hidden.begin(), hidden.end(), did);
+}
+
+bool
+TieredDatabase::Segment::has_document(Xapian::docid did) const
+{
+    if (!in_range(did) || is_hidden(did))
+	return false;
+    // If there are no gaps in the docids, we know it's here.
+    if (doccount == last - first + 1)
+	return true;
+    try {
+	(void)db->get_doclength(did);
+	return true;
+    } catch (const Xapian::DocNotFoundError&) {
+	return false;
+    }
+}
+
+TieredDatabase::TieredDatabase(string_view path_, int flags_, bool readonly)
+    : Xapian::Database::Internal(readonly ?
+				 TRANSACTION_READONLY :
+				 TRANSACTION_NONE),
+      path(path_), flags(flags_), lock(path)
+{
+    if (readonly) {
+	for (int tries = 0; ; ++tries) {
+	    string contents = read_manifest();
+	    try {
+		load(contents);
+		return;
+	    } catch (const Xapian::DatabaseOpeningError&) {
+		// If the manifest has changed, the writer may have removed
+		// segments we were trying to open.
+		if (tries == TIERED_OPEN_RETRIES || read_manifest() == contents)
+		    throw;
+	    }
+	}
+    }
+
+    freeze_threshold = env_unsigned("XAPIAN_TIERED_FREEZE_THRESHOLD",
+				    TIERED_DEFAULT_FREEZE_THRESHOLD);
+    merge_factor = max(env_unsigned("XAPIAN_TIERED_MERGE_FACTOR",
+				    TIERED_DEFAULT_MERGE_FACTOR), 2u);
+    // Use the same variable as glass so we commit at the same points.
+    flush_threshold = env_unsigned("XAPIAN_FLUSH_THRESHOLD",
+				   TIERED_DEFAULT_FLUSH_THRESHOLD);
+
+    int action = flags & Xapian::DB_ACTION_MASK_;
+    bool exists = database_exists(path);
+    if (!exists) {
+	if (action == Xapian::DB_OPEN) {
+	    throw Xapian::DatabaseNotFoundError("No tiered database found at "
+						"path '" + path + "'");
+	}
+	// Create the directory for the database, if it doesn't exist
+	// already.
+	if (mkdir(path.c_str(), 0755) < 0) {
+	    int mkdir_errno = errno;
+	    if (mkdir_errno != EEXIST || !dir_exists(path)) {
+		throw Xapian::DatabaseCreateError(path + ": mkdir failed",
+						  mkdir_errno);
+	    }
+	}
+	get_database_write_lock(true);
+	create();
+	return;
+    }
+
+    if (action == Xapian::DB_CREATE) {
+	throw Xapian::DatabaseCreateError("Can't create new database at '" +
+					  path + "': a database already "
+					  "exists and I was told not to "
+					  "overwrite it");
+    }
+
+    get_database_write_lock(false);
+    if (action == Xapian::DB_CREATE_OR_OVERWRITE) {
+	create();
+    } else {
+	open();
+    }
+}
+
+TieredDatabase::~TieredDatabase()
+{
+    dtor_called();
+    try {
+	check_job(true);
+    } catch (...) {
+	// We can't safely throw exceptions from a destructor.
+    }
+}
+
+bool
+TieredDatabase::database_exists(const string& path_)
+{
+    return file_exists(path_ + TIERED_MANIFEST);
+}
+
+void
+TieredDatabase::check_open() const
+{
+    if (closed)
+	throw Xapian::DatabaseClosedError("Database has been closed");
+}
+
+void
+TieredDatabase::get_database_write_lock(bool creating)
+{
+    string explanation;
+    bool retry = flags & Xapian::DB_RETRY_LOCK;
+    FlintLock::reason why = lock.lock(true, retry, explanation);
+    if (why != FlintLock::SUCCESS) {
+	if (why == FlintLock::UNKNOWN && !creating && !database_exists(path)) {
+	    throw Xapian::DatabaseNotFoundError("No tiered database found at "
+						"path '" + path + "'");
+	}
+	lock.throw_databaselockerror(why, path, explanation);
+    }
+}
+
+void
+TieredDatabase::create()
+{
+    // Start numbering after any existing heads or segments so we don't
+    // disturb readers of a database we're overwriting.
+    unsigned n = 0;
+    for (auto&& name : list_directory(path)) {
+	n = max(n, shard_number(name));
+    }
+    next_number = n + 1;
+
+    Uuid new_uuid;
+    new_uuid.generate();
+    uuid = new_uuid.to_string();
+
+    string name = "g" + str(next_number);
+    removedir(path + '/' + name);
+    head = open_head(name);
+    head_name = name;
+    head_epoch = next_number++;
+    segments.clear();
+    last_docid = 0;
+    write_manifest();
+    remove_unused_files();
+}
+
+void
+TieredDatabase::open()
+{
+    load(read_manifest());
+    remove_unused_files();
+    start_job();
+}
+
+string
+TieredDatabase::read_manifest() const
+{
+    string filename = path + TIERED_MANIFEST;
+    int fd = posixy_open(filename.c_str(), O_RDONLY|O_BINARY);
+    if (fd < 0) {
+	if (errno == ENOENT) {
+	    throw Xapian::DatabaseNotFoundError("No tiered database found at "
+						"path '" + path + "'");
+	}
+	throw Xapian::DatabaseOpeningError("Couldn't open " + filename, errno);
+    }
+    string contents;
+    try {
+	char buf[4096];
+	size_t n;
+	do {
+	    n = io_read(fd, buf, sizeof(buf));
+	    contents.append(buf, n);
+	} while (n == sizeof(buf));
+    } catch (...) {
+	(void)::close(fd);
+	throw;
+    }
+    (void)::close(fd);
+    return contents;
+}
+
+void
+TieredDatabase::write_manifest()
+{
+    string s = "tiered " + str(TIERED_MANIFEST_VERSION) + "\n";
+    s += "uuid ";
+    s += uuid;
+    s += "\nnext ";
+    s += str(next_number);
+    s += "\nhead ";
+    s += head_name;
+    s += ' ';
+    s += str(head_epoch);
+    s += '\n';
+    for (auto&& seg : segments) {
+	s += "segment ";
+	s += seg.name;
+	s += ' ';
+	s += str(seg.epoch);
+	s += '\n';
+    }
+
+    string tmpfile = path + TIERED_MANIFEST ".tmp";
+    int fd = io_open_stream_wr(tmpfile, true);
+    if (rare(fd < 0)) {
+	throw Xapian::DatabaseError("Couldn't write new manifest: " + tmpfile,
+				    errno);
+    }
+    try {
+	io_write(fd, s.data(), s.size());
+    } catch (...) {
+	(void)::close(fd);
+	(void)unlink(tmpfile.c_str());
+	throw;
+    }
+    if ((flags & Xapian::DB_NO_SYNC) == 0 &&
+	((flags & Xapian::DB_FULL_SYNC) ? !io_full_sync(fd) : !io_sync(fd))) {
+	int save_errno = errno;
+	(void)::close(fd);
+	(void)unlink(tmpfile.c_str());
+	throw Xapian::DatabaseError("Couldn't sync new manifest", save_errno);
+    }
+    if (::close(fd) != 0) {
+	int save_errno = errno;
+	(void)unlink(tmpfile.c_str());
+	throw Xapian::DatabaseError("Couldn't write new manifest", save_errno);
+    }
+    if (!io_tmp_rename(tmpfile, path + TIERED_MANIFEST)) {
+	throw Xapian::DatabaseError("Couldn't update manifest", errno);
+    }
+    manifest = std::move(s);
+}
+
+void
+TieredDatabase::load(const string& contents)
+{
+    const char* p = contents.data();
+    const char* end = p + contents.size();
+    auto bad_manifest = [this]() {
+	throw Xapian::DatabaseCorruptError("Bad manifest for tiered "
+					   "database at '" + path + "'");
+    };
+    // Read a space or newline terminated word from the manifest.
+    auto word = [&](char terminator) {
+	const char* start = p;
+	while (p != end && *p != ' ' && *p != '\n') ++p;
+	if (p == end || *p != terminator || p == start) bad_manifest();
+	return string(start, p++);
+    };
+    auto number = [&](char terminator) {
+	unsigned n;
+	string w = word(terminator);
+	if (!parse_unsigned(w.c_str(), n)) bad_manifest();
+	return n;
+    };
+    auto shard_name = [&]() {
+	string name = word(' ');
+	if (shard_number(name) == 0) bad_manifest();
+	return name;
+    };
+
+    if (word(' ') != "tiered") bad_manifest();
+    if (number('\n') != TIERED_MANIFEST_VERSION) {
+	throw Xapian::DatabaseVersionError("Tiered database at '" + path +
+					   "' has unsupported manifest "
+					   "version");
+    }
+    if (word(' ') != "uuid") bad_manifest();
+    string new_uuid = word('\n');
+    if (new_uuid.size() != Uuid::STRING_SIZE) bad_manifest();
+    if (word(' ') != "next") bad_manifest();
+    unsigned new_next_number = number('\n');
+    if (word(' ') != "head") bad_manifest();
+    string new_head_name = shard_name();
+    unsigned new_head_epoch = number('\n');
+
+    vector<Segment> new_segments;
+    while (p != end) {
+	if (word(' ') != "segment") bad_manifest();
+	Segment seg;
+	seg.name = shard_name();
+	seg.epoch = number('\n');
+	auto old = find_if(segments.begin(), segments.end(),
+			   [&](const Segment& s) { return s.name == seg.name; });
+	if (old != segments.end()) {
+	    seg.db = old->db;
+	} else {
+	    seg.db = open_shard(seg.name);
+	}
+	init_segment(seg);
+	new_segments.push_back(std::move(seg));
+    }
+
+    intrusive_ptr<Xapian::Database::Internal> new_head;
+    if (head && new_head_name == head_name) {
+	new_head = head;
+	(void)new_head->reopen();
+    } else if (is_read_only()) {
+	new_head = open_shard(new_head_name);
+    } else {
+	new_head = open_head(new_head_name);
+    }
+
+    head = new_head;
+    head_name = std::move(new_head_name);
+    head_epoch = new_head_epoch;
+    next_number = new_next_number;
+    uuid = std::move(new_uuid);
+    segments = std::move(new_segments);
+    manifest = contents;
+    find_all_hidden();
+    find_last_docid();
+}
+
+Xapian::Database::Internal*
+TieredDatabase::open_shard(const string& name) const
+{
+    string shard_path = path + '/' + name;
+    if (name[0] == 'g') {
+	unique_ptr<GlassDatabase> db(new GlassDatabase(shard_path));
+	if (is_read_only() && (flags & Xapian::DB_MMAP))
+	    db->set_mmap();
+	return db.release();
+    }
+    unique_ptr<HoneyDatabase> db(new HoneyDatabase(shard_path));
+    if (is_read_only() && (flags & Xapian::DB_MMAP))
+	db->set_mmap();
+    return db.release();
+}
+
+Xapian::Database::Internal*
+TieredDatabase::open_head(const string& name) const
+{
+    // Glass needs the termlist to replace and delete documents.
+    int head_flags = flags & ~(Xapian::DB_ACTION_MASK_ |
+			       Xapian::DB_BACKEND_MASK_ |
+			       Xapian::DB_NO_TERMLIST);
+    return new GlassWritableDatabase(path + '/' + name,
+				     head_flags | Xapian::DB_CREATE_OR_OPEN,
+				     0);
+}
+
+void
+TieredDatabase::init_segment(Segment& seg)
+{
+    seg.doccount = seg.db->get_doccount();
+    seg.db->get_used_docid_range(seg.first, seg.last);
+}
+
+void
+TieredDatabase::find_hidden(Segment& seg) const
+{
+    seg.hidden.clear();
+    seg.hidden_doccount = 0;
+    seg.hidden_length = 0;
+    if (seg.doccount == 0)
+	return;
+
+    string prefix{TIERED_METADATA_PREFIX};
+    prefix += 'h';
+    Xapian::TermIterator t(head->open_metadata_keylist(prefix));
+    t.skip_to(hide_key(seg.first));
+    for ( ; t != Xapian::TermIterator(); ++t) {
+	const string& key = *t;
+	Xapian::docid did = decode_hide_key(key);
+	if (did > seg.last)
+	    break;
+	if (decode_epoch(head->get_metadata(key)) <= seg.epoch)
+	    continue;
+	seg.hidden.push_back(did);
+	try {
+	    seg.hidden_length += seg.db->get_doclength(did);
+	    ++seg.hidden_doccount;
+	} catch (const Xapian::DocNotFoundError&) {
+	}
+    }
+}
+
+void
+TieredDatabase::find_all_hidden()
+{
+    for (auto&& seg : segments) {
+	find_hidden(seg);
+    }
+}
+
+void
+TieredDatabase::find_last_docid()
+{
+    last_docid = head->get_lastdocid();
+    for (auto&& seg : segments) {
+	last_docid = max(last_docid, seg.db->get_lastdocid());
+    }
+    string value = head->get_metadata(last_docid_key());
+    if (!value.empty()) {
+	const char* p = value.data();
+	Xapian::docid did;
+	if (!unpack_uint(&p, p + value.size(), &did))
+	    throw Xapian::DatabaseCorruptError("Bad tiered last docid");
+	last_docid = max(last_docid, did);
+    }
+}
+
+void
+TieredDatabase::hide(Xapian::docid did)
+{
+    bool any = false;
+    for (auto&& seg : segments) {
+	if (!seg.in_range(did))
+	    continue;
+	any = true;
+	auto i = lower_bound(seg.hidden.begin(), seg.hidden.end(), did);
+	if (i != seg.hidden.end() && *i == did)
+	    continue;
+	try {
+	    seg.hidden_length += seg.db->get_doclength(did);
+	    ++seg.hidden_doccount;
+	} catch (const Xapian::DocNotFoundError&) {
+	}
+	seg.hidden.insert(i, did);
+    }
+    if (any) {
+	string value;
+	pack_uint(value, head_epoch);
+	head->set_metadata(hide_key(did), value);
+    }
+}
+
+const TieredDatabase::Segment*
+TieredDatabase::find_segment(Xapian::docid did) const
+{
+    for (auto i = segments.rbegin(); i != segments.rend(); ++i) {
+	if (i->has_document(did))
+	    return &*i;
+    }
+    return NULL;
+}
+
+void
+TieredDatabase::count_hidden(const Segment& seg,
+			     string_view term,
+			     Xapian::doccount& tf,
+			     Xapian::termcount& cf)
+{
+    tf = 0;
+    cf = 0;
+    if (seg.hidden_doccount == 0)
+	return;
+    unique_ptr<LeafPostList> pl(seg.db->open_leaf_post_list(term, false));
+    if (!pl)
+	return;
+    for (Xapian::docid did : seg.hidden) {
+	(void)pl->skip_to(did, 0.0);
+	if (pl->at_end())
+	    break;
+	if (pl->get_docid() == did) {
+	    ++tf;
+	    cf += pl->get_wdf();
+	}
+    }
+}
+
+void
+TieredDatabase::check_freeze()
+{
+    if (transaction_active() || head->get_doccount() < freeze_threshold)
+	return;
+    freeze();
+}
+
+void
+TieredDatabase::changed()
+{
+    check_job();
+    check_freeze();
+    if (++change_count >= flush_threshold && !transaction_active())
+	commit();
+}
+
+void
+TieredDatabase::freeze()
+{
+    head->commit();
+
+    string new_head_name = "g" + str(next_number);
+    removedir(path + '/' + new_head_name);
+    intrusive_ptr<Xapian::Database::Internal> new_head(open_head(new_head_name));
+
+    // Copy the user metadata, spellings and synonyms, which are only read
+    // from the head.  Documents aren't hidden by a later epoch in their own
+    // segment, so we can drop records of writes which are now only relevant
+    // to the segment we're creating.
+    for (Xapian::TermIterator t(head->open_metadata_keylist(""sv));
+	 t != Xapian::TermIterator();
+	 ++t) {
+	const string& key = *t;
+	string value = head->get_metadata(key);
+	if (startswith(key, TIERED_METADATA_PREFIX)) {
+	    if (key.size() == TIERED_METADATA_PREFIX.size() ||
+		key[TIERED_METADATA_PREFIX.size()] != 'h')
+		continue;
+	    Xapian::docid did = decode_hide_key(key);
+	    unsigned epoch = decode_epoch(value);
+	    bool needed = false;
+	    for (auto&& seg : segments) {
+		if (seg.in_range(did) && seg.epoch < epoch) {
+		    needed = true;
+		    break;
+		}
+	    }
+	    if (!needed)
+		continue;
+	}
+	new_head->set_metadata(key, value);
+    }
+    string value;
+    pack_uint(value, last_docid);
+    new_head->set_metadata(last_docid_key(), value);
+
+    for (Xapian::TermIterator t(head->open_spelling_wordlist());
+	 t != Xapian::TermIterator();
+	 ++t) {
+	new_head->add_spelling(*t, t.get_termfreq());
+    }
+
+    for (Xapian::TermIterator t(head->open_synonym_keylist(""sv));
+	 t != Xapian::TermIterator();
+	 ++t) {
+	const string& term = *t;
+	for (Xapian::TermIterator s(head->open_synonym_termlist(term));
+	     s != Xapian::TermIterator();
+	     ++s) {
+	    new_head->add_synonym(term, *s);
+	}
+    }
+    new_head->commit();
+
+    Segment seg;
+    seg.name = head_name;
+    seg.epoch = head_epoch;
+    head->close();
+    seg.db = open_shard(seg.name);
+    init_segment(seg);
+    segments.push_back(std::move(seg));
+
+    head = new_head;
+    head_name = std::move(new_head_name);
+    head_epoch = next_number++;
+    write_manifest();
+    start_job();
+}
+
+void
+TieredDatabase::check_job(bool wait)
+{
+    if (!job || (!wait && !job->done()))
+	return;
+
+    unique_ptr<TieredMerge> finished = std::move(job);
+    finished->wait();
+
+    Segment new_seg;
+    new_seg.name = finished->get_output_name();
+    if (!new_seg.name.empty()) {
+	new_seg.epoch = finished->get_epoch();
+	new_seg.db = open_shard(new_seg.name);
+	init_segment(new_seg);
+	find_hidden(new_seg);
+    }
+
+    // Put the new segment where the first source was.
+    const auto& sources = finished->get_sources();
+    vector<Segment> new_segments;
+    for (auto&& seg : segments) {
+	auto is_source = [&](const TieredMerge::Source& source) {
+	    return source.name == seg.name;
+	};
+	if (find_if(sources.begin(), sources.end(), is_source) ==
+	    sources.end()) {
+	    new_segments.push_back(std::move(seg));
+	} else if (!new_seg.name.empty()) {
+	    new_segments.push_back(std::move(new_seg));
+	    new_seg.name.clear();
+	}
+    }
+    segments = std::move(new_segments);
+    write_manifest();
+
+    for (auto&& source : sources) {
+	removedir(path + '/' + source.name);
+    }
+
+    if (!wait)
+	start_job();
+}
+
+void
+TieredDatabase::start_job()
+{
+    if (job || closed)
+	return;
+
+    vector<const Segment*> chosen;
+    // Convert frozen heads to honey first, oldest first.
+    for (auto&& seg : segments) {
+	if (seg.name[0] == 'g') {
+	    chosen.push_back(&seg);
+	    break;
+	}
+    }
+
+    if (chosen.empty()) {
+	// Merge merge_factor segments from the lowest level which has that
+	// many, where the level is the number of times the number of live
+	// documents can be divided by merge_factor after dividing by
+	// freeze_threshold.
+	vector<vector<const Segment*>> levels;
+	for (auto&& seg : segments) {
+	    Xapian::doccount n = (seg.doccount - seg.hidden_doccount) /
+				 freeze_threshold;
+	    size_t level = 0;
+	    while (n >= merge_factor) {
+		n /= merge_factor;
+		++level;
+	    }
+	    if (level >= levels.size())
+		levels.resize(level + 1);
+	    levels[level].push_back(&seg);
+	}
+	for (auto&& level : levels) {
+	    if (level.size() >= merge_factor) {
+		chosen.assign(level.begin(), level.begin() + merge_factor);
+		break;
+	    }
+	}
+    }
+
+    if (chosen.empty()) {
+	// Rewrite a segment if most of its documents are hidden.
+	for (auto&& seg : segments) {
+	    if (seg.hidden_doccount > seg.doccount / 2) {
+		chosen.push_back(&seg);
+		break;
+	    }
+	}
+	if (chosen.empty())
+	    return;
+    }
+
+    vector<TieredMerge::Source> sources;
+    unsigned epoch = 0;
+    for (const Segment* seg : chosen) {
+	sources.push_back({seg->name, seg->hidden});
+	epoch = max(epoch, seg->epoch);
+    }
+    string output_name = "h" + str(next_number++);
+    job.reset(new TieredMerge(path, std::move(sources), output_name, epoch));
+    job->start();
+}
+
+void
+TieredDatabase::remove_unused_files()
+{
+    for (auto&& name : list_directory(path)) {
+	string base = name;
+	if (endswith(base, ".tmp"))
+	    base.resize(base.size() - 4);
+	if (shard_number(base) == 0)
+	    continue;
+	if (name == head_name)
+	    continue;
+	auto in_use = [&](const Segment& seg) { return seg.name == name; };
+	if (find_if(segments.begin(), segments.end(), in_use) !=
+	    segments.end())
+	    continue;
+	removedir(path + '/' + name);
+    }
+}
+
+bool
+TieredDatabase::reopen()
+{
+    check_open();
+    if (!is_read_only()) {
+	check_job();
+	return false;
+    }
+
+    for (int tries = 0; ; ++tries) {
+	string contents = read_manifest();
+	if (contents == manifest) {
+	    if (!head->reopen())
+		return false;
+	    find_all_hidden();
+	    find_last_docid();
+	    return true;
+	}
+	try {
+	    load(contents);
+	    return true;
+	} catch (const Xapian::DatabaseOpeningError&) {
+	    if (tries == TIERED_OPEN_RETRIES || read_manifest() == contents)
+		throw;
+	}
+    }
+}
+
+void
+TieredDatabase::close()
+{
+    if (closed)
+	return;
+    if (!is_read_only()) {
+	if (!transaction_active())
+	    commit();
+	check_job(true);
+    }
+    head->close();
+    for (auto&& seg : segments) {
+	seg.db->close();
+    }
+    lock.release();
+    closed = true;
+}
+
+PostList*
+TieredDatabase::open_post_list(string_view term) const
+{
+    return TieredDatabase::open_leaf_post_list(term, false);
+}
+
+LeafPostList*
+TieredDatabase::open_leaf_post_list(string_view term,
+				    bool need_read_pos) const
+{
+    check_open();
+    Xapian::doccount tf;
+    Xapian::termcount cf;
+    if (term.empty()) {
+	tf = get_doccount();
+	cf = get_total_length();
+    } else {
+	get_freqs(term, &tf, &cf);
+    }
+    if (tf == 0)
+	return NULL;
+
+    vector<TieredPostList::Sub> subs;
+    try {
+	LeafPostList* pl = head->open_leaf_post_list(term, need_read_pos);
+	if (pl)
+	    subs.push_back({head, pl, {}});
+	for (auto&& seg : segments) {
+	    pl = seg.db->open_leaf_post_list(term, need_read_pos);
+	    if (pl)
+		subs.push_back({seg.db, pl, seg.hidden});
+	}
+    } catch (...) {
+	for (auto&& sub : subs)
+	    delete sub.pl;
+	throw;
+    }
+
+    // If there are no segments we don't need to merge.  We can't do this
+    // just because only the head has postings for this term as the matcher
+    // may use the returned postlist to open postlists for other terms via
+    // open_nearby_postlist().
+    if (segments.empty())
+	return subs[0].pl;
+    return new TieredPostList(term, std::move(subs), tf, cf);
+}
+
+TermList*
+TieredDatabase::open_term_list(Xapian::docid did) const
+{
+    check_open();
+    return new TieredTermList(this, did, find_shard(did)->open_term_list(did));
+}
+
+TermList*
+TieredDatabase::open_term_list_direct(Xapian::docid did) const
+{
+    return TieredDatabase::open_term_list(did);
+}
+
+TermList*
+TieredDatabase::open_allterms(string_view prefix) const
+{
+    check_open();
+    bool any_hidden = false;
+    size_t count = 0;
+    TermList** termlists = new TermList*[segments.size() + 1];
+    try {
+	termlists[count] = head->open_allterms(prefix);
+	if (termlists[count]) ++count;
+	for (auto&& seg : segments) {
+	    termlists[count] = seg.db->open_allterms(prefix);
+	    if (termlists[count]) ++count;
+	    if (seg.hidden_doccount) any_hidden = true;
+	}
+    } catch (...) {
+	while (count)
+	    delete termlists[--count];
+	delete [] termlists;
+	throw;
+    }
+    if (count == 1 && !any_hidden) {
+	TermList* result = termlists[0];
+	delete [] termlists;
+	return result;
+    }
+    // MultiAllTermsList can prune itself, but callers of open_allterms()
+    // on a single database don't expect that, so always wrap it.
+    TermList* multi = new MultiAllTermsList(count, termlists);
+    return new TieredAllTermsList(this, multi, any_hidden);
+}
+
+bool
+TieredDatabase::get_wildcard_candidates(string_view literal,
+					vector<string>& terms) const
+{
+    check_open();
+    // We can only use the wildcard indexes if every tier has one.
+    if (!head->get_wildcard_candidates(literal, terms))
+	return false;
+    for (auto&& seg : segments) {
+	if (!seg.db->get_wildcard_candidates(literal, terms))
+	    return false;
+    }
+    return true;
+}
+
+bool
+TieredDatabase::has_positions() const
+{
+    check_open();
+    if (head->has_positions())
+	return true;
+    for (auto&& seg : segments) {
+	if (seg.db->has_positions())
+	    return true;
+    }
+    return false;
+}
+
+PositionList*
+TieredDatabase::open_position_list(Xapian::docid did,
+				   string_view term) const
+{
+    check_open();
+    return find_shard(did)->open_position_list(did, term);
+}
+
+Xapian::doccount
+TieredDatabase::get_doccount() const
+{
+    check_open();
+    Xapian::doccount result = head->get_doccount();
+    for (auto&& seg : segments) {
+	result += seg.doccount - seg.hidden_doccount;
+    }
+    return result;
+}
+
+Xapian::docid
+TieredDatabase::get_lastdocid() const
+{
+    check_open();
+    return last_docid;
+}
+
+Xapian::totallength
+TieredDatabase::get_total_length() const
+{
+    check_open();
+    Xapian::totallength result = head->get_total_length();
+    for (auto&& seg : segments) {
+	result += seg.db->get_total_length() - seg.hidden_length;
+    }
+    return result;
+}
+
+void
+TieredDatabase::get_freqs(string_view term,
+			  Xapian::doccount* tf_ptr,
+			  Xapian::termcount* cf_ptr) const
+{
+    Assert(!term.empty());
+    check_open();
+    Xapian::doccount tf;
+    Xapian::termcount cf;
+    head->get_freqs(term, &tf, &cf);
+    for (auto&& seg : segments) {
+	Xapian::doccount seg_tf;
+	Xapian::termcount seg_cf;
+	seg.db->get_freqs(term, &seg_tf, &seg_cf);
+	if (seg_tf) {
+	    Xapian::doccount hidden_tf;
+	    Xapian::termcount hidden_cf;
+	    count_hidden(seg, term, hidden_tf, hidden_cf);
+	    tf += seg_tf - hidden_tf;
+	    cf += seg_cf - hidden_cf;
+	}
+    }
+    if (tf_ptr)
+	*tf_ptr = tf;
+    if (cf_ptr)
+	*cf_ptr = cf;
+}
+
+Xapian::doccount
+TieredDatabase::get_value_freq(Xapian::valueno slot) const
+{
+    check_open();
+    Xapian::doccount result = head->get_value_freq(slot);
+    for (auto&& seg : segments) {
+	Xapian::doccount seg_freq = seg.db->get_value_freq(slot);
+	if (seg_freq && seg.hidden_doccount) {
+	    unique_ptr<ValueList> vl(seg.db->open_value_list(slot));
+	    for (Xapian::docid did : seg.hidden) {
+		vl->skip_to(did);
+		if (vl->at_end())
+		    break;
+		if (vl->get_docid() == did)
+		    --seg_freq;
+	    }
+	}
+	result += seg_freq;
+    }
+    return result;
+}
+
+string
+TieredDatabase::get_value_lower_bound(Xapian::valueno slot) const
+{
+    check_open();
+    // The bounds from segments with hidden documents may be looser than
+    // they need to be, but they're still bounds.
+    string result = head->get_value_lower_bound(slot);
+    for (auto&& seg : segments) {
+	string seg_result = seg.db->get_value_lower_bound(slot);
+	if (seg_result.empty())
+	    continue;
+	if (result.empty() || seg_result < result)
+	    result = std::move(seg_result);
+    }
+    return result;
+}
+
+string
+TieredDatabase::get_value_upper_bound(Xapian::valueno slot) const
+{
+    check_open();
+    string result = head->get_value_upper_bound(slot);
+    for (auto&& seg : segments) {
+	string seg_result = seg.db->get_value_upper_bound(slot);
+	if (seg_result > result)
+	    result = std::move(seg_result);
+    }
+    return result;
+}
+
+Xapian::termcount
+TieredDatabase::get_doclength_lower_bound() const
+{
+    check_open();
+    Xapian::termcount result = head->get_doclength_lower_bound();
+    for (auto&& seg : segments) {
+	result = min_non_zero(result, seg.db->get_doclength_lower_bound());
+    }
+    return result;
+}
+
+Xapian::termcount
+TieredDatabase::get_doclength_upper_bound() const
+{
+    check_open();
+    Xapian::termcount result = head->get_doclength_upper_bound();
+    for (auto&& seg : segments) {
+	result = max(result, seg.db->get_doclength_upper_bound());
+    }
+    return result;
+}
+
+Xapian::termcount
+TieredDatabase::get_wdf_upper_bound(string_view term) const
+{
+    check_open();
+    Xapian::termcount result = head->get_wdf_upper_bound(term);
+    for (auto&& seg : segments) {
+	result = max(result, seg.db->get_wdf_upper_bound(term));
+    }
+    return result;
+}
+
+Xapian::termcount
+TieredDatabase::get_unique_terms_lower_bound() const
+{
+    check_open();
+    Xapian::termcount result = head->get_unique_terms_lower_bound();
+    for (auto&& seg : segments) {
+	result = min_non_zero(result, seg.db->get_unique_terms_lower_bound());
+    }
+    return result;
+}
+
+Xapian::termcount
+TieredDatabase::get_unique_terms_upper_bound() const
+{
+    check_open();
+    Xapian::termcount result = head->get_unique_terms_upper_bound();
+    for (auto&& seg : segments) {
+	result = max(result, seg.db->get_unique_terms_upper_bound());
+    }
+    return result;
+}
+
+ValueList*
+TieredDatabase::open_value_list(Xapian::valueno slot) const
+{
+    check_open();
+    vector<TieredValueList::Sub> subs;
+    try {
+	subs.push_back({head, head->open_value_list(slot), {}});
+	for (auto&& seg : segments) {
+	    subs.push_back({seg.db, seg.db->open_value_list(slot), seg.hidden});
+	}
+    } catch (...) {
+	for (auto&& sub : subs)
+	    delete sub.vl;
+	throw;
+    }
+    return new TieredValueList(slot, std::move(subs));
+}
+
+Xapian::termcount
+TieredDatabase::get_doclength(Xapian::docid did) const
+{
+    check_open();
+    return find_shard(did)->get_doclength(did);
+}
+
+Xapian::termcount
+TieredDatabase::get_unique_terms(Xapian::docid did) const
+{
+    check_open();
+    return find_shard(did)->get_unique_terms(did);
+}
+
+Xapian::termcount
+TieredDatabase::get_wdfdocmax(Xapian::docid did) const
+{
+    check_open();
+    return find_shard(did)->get_wdfdocmax(did);
+}
+
+Xapian::Document::Internal*
+TieredDatabase::open_document(Xapian::docid did, bool lazy) const
+{
+    check_open();
+    const Segment* seg = find_segment(did);
+    if (seg) {
+	// find_segment() has checked the document is there.
+	return seg->db->open_document(did, true);
+    }
+    return head->open_document(did, lazy);
+}
+
+bool
+TieredDatabase::term_exists(string_view term) const
+{
+    check_open();
+    if (term.empty())
+	return get_doccount() != 0;
+    if (head->term_exists(term))
+	return true;
+    for (auto&& seg : segments) {
+	if (!seg.db->term_exists(term))
+	    continue;
+	if (seg.hidden_doccount == 0)
+	    return true;
+	Xapian::doccount seg_tf, hidden_tf;
+	Xapian::termcount hidden_cf;
+	seg.db->get_freqs(term, &seg_tf, NULL);
+	count_hidden(seg, term, hidden_tf, hidden_cf);
+	if (seg_tf != hidden_tf)
+	    return true;
+    }
+    return false;
+}
+
+void
+TieredDatabase::readahead_for_query(const Xapian::Query& query) const
+{
+    check_open();
+    head->readahead_for_query(query);
+    for (auto&& seg : segments) {
+	seg.db->readahead_for_query(query);
+    }
+}
+
+TermList*
+TieredDatabase::open_spelling_termlist(string_view word) const
+{
+    check_open();
+    return head->open_spelling_termlist(word);
+}
+
+TermList*
+TieredDatabase::open_spelling_wordlist() const
+{
+    check_open();
+    return head->open_spelling_wordlist();
+}
+
+Xapian::doccount
+TieredDatabase::get_spelling_frequency(string_view word) const
+{
+    check_open();
+    return head->get_spelling_frequency(word);
+}
+
+void
+TieredDatabase::get_spelling_frequencies(const vector<string>& words,
+					 vector<Xapian::doccount>& freqs) const
+{
+    check_open();
+    head->get_spelling_frequencies(words, freqs);
+}
+
+TermList*
+TieredDatabase::open_synonym_termlist(string_view term) const
+{
+    check_open();
+    return head->open_synonym_termlist(term);
+}
+
+TermList*
+TieredDatabase::open_synonym_keylist(string_view prefix) const
+{
+    check_open();
+    return head->open_synonym_keylist(prefix);
+}
+
+string
+TieredDatabase::get_metadata(string_view key) const
+{
+    check_open();
+    if (startswith(key, TIERED_METADATA_PREFIX))
+	return string();
+    return head->get_metadata(key);
+}
+
+TermList*
+TieredDatabase::open_metadata_keylist(string_view prefix) const
+{
+    check_open();
+    TermList* keys = head->open_metadata_keylist(prefix);
+    if (!keys)
+	return NULL;
+    return new TieredMetadataTermList(keys);
+}
+
+bool
+TieredDatabase::locked() const
+{
+    return lock.test();
+}
+
+Xapian::Database::Internal*
+TieredDatabase::update_lock(int new_flags)
+{
+    check_open();
+    if (is_read_only()) {
+	if (new_flags == Xapian::DB_READONLY_)
+	    return this;
+	new_flags &= ~(Xapian::DB_ACTION_MASK_ | Xapian::DB_BACKEND_MASK_);
+	return new TieredDatabase(path, new_flags | Xapian::DB_OPEN, false);
+    }
+
+    if (new_flags != Xapian::DB_READONLY_)
+	return this;
+
+    close();
+    return new TieredDatabase(path, flags & Xapian::DB_MMAP, true);
+}
+
+int
+TieredDatabase::get_backend_info(string* path_ptr) const
+{
+    if (path_ptr)
+	*path_ptr = path;
+    return BACKEND_TIERED;
+}
+
+string
+TieredDatabase::get_uuid() const
+{
+    return uuid;
+}
+
+vector<string>
+TieredDatabase::get_shard_names() const
+{
+    vector<string> result;
+    result.reserve(segments.size() + 1);
+    result.push_back(head_name);
+    for (auto&& seg : segments) {
+	result.push_back(seg.name);
+    }
+    return result;
+}
+
+void
+TieredDatabase::get_used_docid_range(Xapian::docid& first,
+				     Xapian::docid& last) const
+{
+    check_open();
+    head->get_used_docid_range(first, last);
+    for (auto&& seg : segments) {
+	first = min_non_zero(first, seg.first);
+	last = max(last, seg.last);
+    }
+}
+
+void
+TieredDatabase::commit()
+{
+    check_open();
+    head->commit();
+    change_count = 0;
+    check_job();
+    check_freeze();
+}
+
+void
+TieredDatabase::cancel()
+{
+    check_open();
+    head->cancel();
+    change_count = 0;
+    // Undo any uncommitted hiding of documents in the segments.
+    find_all_hidden();
+    find_last_docid();
+}
+
+void
+TieredDatabase::set_flush_memory_limit(size_t limit)
+{
+    check_open();
+    head->set_flush_memory_limit(limit);
+}
+
+void
+TieredDatabase::begin_transaction(bool flushed)
+{
+    check_open();
+    Xapian::Database::Internal::begin_transaction(flushed);
+    // The base class implementation handles committing if flushed is true,
+    // so we just need to stop the head from flushing automatically.
+    head->begin_transaction(false);
+}
+
+void
+TieredDatabase::end_transaction(bool do_commit)
+{
+    if (transaction_active()) {
+	check_open();
+	head->end_transaction(do_commit);
+    }
+    Xapian::Database::Internal::end_transaction(do_commit);
+}
+
+Xapian::docid
+TieredDatabase::add_document(const Xapian::Document& doc)
+{
+    check_open();
+    Xapian::docid did = last_docid + 1;
+    if (rare(did == 0)) {
+	throw Xapian::DatabaseError("Run out of docids - you'll have to use "
+				    "copydatabase to eliminate any gaps "
+				    "before you can add more documents");
+    }
+    head->replace_document(did, doc);
+    last_docid = did;
+    changed();
+    return did;
+}
+
+void
+TieredDatabase::delete_document(Xapian::docid did)
+{
+    check_open();
+    if (find_segment(did)) {
+	hide(did);
+    } else {
+	head->delete_document(did);
+    }
+    changed();
+}
+
+void
+TieredDatabase::replace_document(Xapian::docid did,
+				 const Xapian::Document& doc)
+{
+    check_open();
+    const Xapian::Document::Internal& doc_internal = *doc.internal;
+    if (doc_internal.get_docid() == did && !doc_internal.modified() &&
+	doc_internal.get_database() == find_shard(did)) {
+	// Replacing a document with the unmodified current version.
+	return;
+    }
+    // Hide any older copies first, so if the head flushes automatically the
+    // change to the metadata is committed along with the new version.
+    string key = hide_key(did);
+    string old_value = head->get_metadata(key);
+    hide(did);
+    try {
+	head->replace_document(did, doc);
+    } catch (...) {
+	head->set_metadata(key, old_value);
+	for (auto&& seg : segments) {
+	    if (seg.in_range(did))
+		find_hidden(seg);
+	}
+	throw;
+    }
+    last_docid = max(last_docid, did);
+    changed();
+}
+
+void
+TieredDatabase::request_document(Xapian::docid did) const
+{
+    check_open();
+    find_shard(did)->request_document(did);
+}
+
+void
+TieredDatabase::add_spelling(string_view word,
+			     Xapian::termcount freqinc) const
+{
+    check_open();
+    head->add_spelling(word, freqinc);
+}
+
+Xapian::termcount
+TieredDatabase::remove_spelling(string_view word,
+				Xapian::termcount freqdec) const
+{
+    check_open();
+    return head->remove_spelling(word, freqdec);
+}
+
+void
+TieredDatabase::add_synonym(string_view term, string_view synonym) const
+{
+    check_open();
+    head->add_synonym(term, synonym);
+}
+
+void
+TieredDatabase::remove_synonym(string_view term, string_view synonym) const
+{
+    check_open();
+    head->remove_synonym(term, synonym);
+}
+
+void
+TieredDatabase::clear_synonyms(string_view term) const
+{
+    check_open();
+    head->clear_synonyms(term);
+}
+
+void
+TieredDatabase::set_metadata(string_view key, string_view value)
+{
+    check_open();
+    if (startswith(key, TIERED_METADATA_PREFIX)) {
+	throw Xapian::InvalidArgumentError("Metadata keys starting with "
+					   "\"\\0tiered\" are reserved");
+    }
+    head->set_metadata(key, value);
+}
+
+string
+TieredDatabase::get_description() const
+{
+    string desc = "Tiered(";
+    if (!is_read_only()) {
+	desc += "writable, ";
+    }
+    desc += path;
+    desc += ", ";
+    desc += str(segments.size());
+    desc += " segments)";
+    return desc;
+}
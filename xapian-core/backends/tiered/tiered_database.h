@@ -0,0 +1,388 @@
+/** @file
+ * @brief Database made of a writable glass head over honey segments
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef XAPIAN_INCLUDED_TIERED_DATABASE_H
+#define XAPIAN_INCLUDED_TIERED_DATABASE_H
+
+#include "api/termlist.h"
+#include "backends/databaseinternal.h"
+#include "backends/flint_lock.h"
+#include "backends/valuelist.h"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class LeafPostList;
+class TieredMerge;
+
+/** Database made of a writable glass head over immutable segments.
+ *
+ *  Documents are written to a small glass database (the "head").  When the
+ *  head gets big enough it is frozen - it becomes a read-only segment and a
+ *  new empty head is started.  Frozen glass segments are converted to honey
+ *  in a background thread, and honey segments of similar sizes are merged
+ *  (also in the background) to keep the number of segments down.
+ *
+ *  Document ids are the same in every tier, so replacing or deleting a
+ *  document which is in a segment hides the copy there.  This is recorded
+ *  in the head's user metadata (so it's committed atomically with the
+ *  change which caused it) as the docid and the "epoch" of the write.  The
+ *  epoch is the number of the head at the time, and each segment records
+ *  the epoch of the newest head it contains documents from, so the copy of
+ *  a document in a segment is stale if there's a later write to it.
+ *
+ *  The manifest file "iamtiered" lists the head and segments, and is
+ *  atomically replaced when they change.
+ */
+class TieredDatabase : public Xapian::Database::Internal {
+  public:
+    /// A read-only segment.
+    struct Segment {
+	/// Name of the segment's directory within the database directory.
+	std::string name;
+
+	/// The epoch of the newest write in this segment.
+	unsigned epoch = 0;
+
+	Xapian::Internal::intrusive_ptr<Xapian::Database::Internal> db;
+
+	/// The range of docids used in this segment.
+	Xapian::docid first = 0, last = 0;
+
+	/// The number of documents in this segment.
+	Xapian::doccount doccount = 0;
+
+	/** Docids in [first, last] whose copy here (if any) is stale.
+	 *
+	 *  In ascending order.
+	 */
+	std::vector<Xapian::docid> hidden;
+
+	/// Number of documents in this segment which are hidden.
+	Xapian::doccount hidden_doccount = 0;
+
+	/// Total length of documents in this segment which are hidden.
+	Xapian::totallength hidden_length = 0;
+
+	bool in_range(Xapian::docid did) const {
+	    return did >= first && did <= last;
+	}
+
+	bool is_hidden(Xapian::docid did) const;
+
+	/** Does this segment have an unhidden copy of @a did?
+	 *
+	 *  Returns false if @a did isn't in this segment.
+	 */
+	bool has_document(Xapian::docid did) const;
+    };
+
+  private:
+    /// The database directory.
+    std::string path;
+
+    /// Flags the database was opened with.
+    int flags;
+
+    /// The UUID of the database.
+    std::string uuid;
+
+    /// The contents of the manifest when we last read or wrote it.
+    std::string manifest;
+
+    /// Lock held by a writer.
+    FlintLock lock;
+
+    /// The head.
+    Xapian::Internal::intrusive_ptr<Xapian::Database::Internal> head;
+
+    /// Name of the head's directory.
+    std::string head_name;
+
+    /// The epoch of the head.
+    unsigned head_epoch = 0;
+
+    /// The number to use for the next head or segment.
+    unsigned next_number = 1;
+
+    /// The segments, oldest first.
+    std::vector<Segment> segments;
+
+    /// The highest docid used.
+    Xapian::docid last_docid = 0;
+
+    /// Freeze the head when it has this many documents.
+    Xapian::doccount freeze_threshold = 0;
+
+    /// Merge segments when there are this many of a similar size.
+    unsigned merge_factor = 0;
+
+    /** Commit automatically after this many changes.
+     *
+     *  Freezing commits the head, but doesn't reset the count so automatic
+     *  commits happen at the same points as they would with glass.
+     */
+    Xapian::doccount flush_threshold = 0;
+
+    /// Changes since the last commit().
+    Xapian::doccount change_count = 0;
+
+    /// Background job building a new segment (or NULL).
+    std::unique_ptr<TieredMerge> job;
+
+    /// Has close() been called?
+    bool closed = false;
+
+    /// Throw DatabaseClosedError if the database has been closed.
+    void check_open() const;
+
+    /// Get the write lock.
+    void get_database_write_lock(bool creating);
+
+    /// Create a new database.
+    void create();
+
+    /// Open an existing database.
+    void open();
+
+    /// Read the manifest file.
+    std::string read_manifest() const;
+
+    /// Atomically replace the manifest with one for the current state.
+    void write_manifest();
+
+    /** Open the head and segments listed in @a contents.
+     *
+     *  Segments which are already open are reused.
+     */
+    void load(const std::string& contents);
+
+    /// Open the shard @a name read-only.
+    Xapian::Database::Internal* open_shard(const std::string& name) const;
+
+    /// Open the head @a name for writing.
+    Xapian::Database::Internal* open_head(const std::string& name) const;
+
+    /// Set the range and document count of @a seg.
+    static void init_segment(Segment& seg);
+
+    /// Find which documents in @a seg are hidden.
+    void find_hidden(Segment& seg) const;
+
+    /// Find which documents in each segment are hidden.
+    void find_all_hidden();
+
+    /// Recalculate last_docid.
+    void find_last_docid();
+
+    /// Hide any copies of @a did in the segments.
+    void hide(Xapian::docid did);
+
+    /** Find the segment which has @a did.
+     *
+     *  Returns NULL if no segment has it (it may be in the head).
+     */
+    const Segment* find_segment(Xapian::docid did) const;
+
+    /// Find the shard which has @a did (the head if no segment does).
+    const Xapian::Database::Internal* find_shard(Xapian::docid did) const {
+	const Segment* seg = find_segment(did);
+	return seg ? seg->db.get() : head.get();
+    }
+
+    /// Count the hidden documents in @a seg which @a term indexes.
+    static void count_hidden(const Segment& seg,
+			     std::string_view term,
+			     Xapian::doccount& tf,
+			     Xapian::termcount& cf);
+
+    /// Freeze the head if it's big enough.
+    void check_freeze();
+
+    /// Housekeeping after a document is added, replaced or deleted.
+    void changed();
+
+    /// Turn the head into a segment and start a new one.
+    void freeze();
+
+    /** Install the result of a background job which has finished.
+     *
+     *  @param wait	If true, wait for the job to finish and don't start
+     *			another (used when closing).
+     */
+    void check_job(bool wait = false);
+
+    /// Start a background job if there's anything to do.
+    void start_job();
+
+    /// Remove files from earlier runs which aren't in use.
+    void remove_unused_files();
+
+  public:
+    /** Open a tiered database.
+     *
+     *  @param path_	The database directory.
+     *  @param flags_	The flags passed to Database or WritableDatabase.
+     *  @param readonly	Open read-only?
+     */
+    TieredDatabase(std::string_view path_, int flags_, bool readonly);
+
+    ~TieredDatabase();
+
+    /// Return true if there's a tiered database at @a path_.
+    static bool database_exists(const std::string& path_);
+
+    bool reopen();
+
+    void close();
+
+    PostList* open_post_list(std::string_view term) const;
+
+    LeafPostList* open_leaf_post_list(std::string_view term,
+				      bool need_read_pos) const;
+
+    TermList* open_term_list(Xapian::docid did) const;
+
+    TermList* open_term_list_direct(Xapian::docid did) const;
+
+    TermList* open_allterms(std::string_view prefix) const;
+
+    bool get_wildcard_candidates(std::string_view literal,
+				 std::vector<std::string>& terms) const;
+
+    bool has_positions() const;
+
+    PositionList* open_position_list(Xapian::docid did,
+				     std::string_view term) const;
+
+    Xapian::doccount get_doccount() const;
+
+    Xapian::docid get_lastdocid() const;
+
+    Xapian::totallength get_total_length() const;
+
+    void get_freqs(std::string_view term,
+		   Xapian::doccount* tf_ptr,
+		   Xapian::termcount* cf_ptr) const;
+
+    Xapian::doccount get_value_freq(Xapian::valueno slot) const;
+
+    std::string get_value_lower_bound(Xapian::valueno slot) const;
+
+    std::string get_value_upper_bound(Xapian::valueno slot) const;
+
+    Xapian::termcount get_doclength_lower_bound() const;
+
+    Xapian::termcount get_doclength_upper_bound() const;
+
+    Xapian::termcount get_wdf_upper_bound(std::string_view term) const;
+
+    Xapian::termcount get_unique_terms_lower_bound() const;
+
+    Xapian::termcount get_unique_terms_upper_bound() const;
+
+    ValueList* open_value_list(Xapian::valueno slot) const;
+
+    Xapian::termcount get_doclength(Xapian::docid did) const;
+
+    Xapian::termcount get_unique_terms(Xapian::docid did) const;
+
+    Xapian::termcount get_wdfdocmax(Xapian::docid did) const;
+
+    Xapian::Document::Internal* open_document(Xapian::docid did,
+					      bool lazy) const;
+
+    bool term_exists(std::string_view term) const;
+
+    void readahead_for_query(const Xapian::Query& query) const;
+
+    TermList* open_spelling_termlist(std::string_view word) const;
+
+    TermList* open_spelling_wordlist() const;
+
+    Xapian::doccount get_spelling_frequency(std::string_view word) const;
+
+    void get_spelling_frequencies(const std::vector<std::string>& words,
+				  std::vector<Xapian::doccount>& freqs) const;
+
+    TermList* open_synonym_termlist(std::string_view term) const;
+
+    TermList* open_synonym_keylist(std::string_view prefix) const;
+
+    std::string get_metadata(std::string_view key) const;
+
+    TermList* open_metadata_keylist(std::string_view prefix) const;
+
+    bool locked() const;
+
+    Xapian::Database::Internal* update_lock(int flags);
+
+    int get_backend_info(std::string* path_ptr) const;
+
+    std::string get_uuid() const;
+
+    /// Return the names of the head and segments (in that order).
+    std::vector<std::string> get_shard_names() const;
+
+    void get_used_docid_range(Xapian::docid& first,
+			      Xapian::docid& last) const;
+
+    void commit();
+
+    void cancel();
+
+    void set_flush_memory_limit(size_t limit);
+
+    void begin_transaction(bool flushed);
+
+    void end_transaction(bool do_commit);
+
+    Xapian::docid add_document(const Xapian::Document& doc);
+
+    void delete_document(Xapian::docid did);
+
+    using Xapian::Database::Internal::delete_document;
+
+    void replace_document(Xapian::docid did, const Xapian::Document& doc);
+
+    using Xapian::Database::Internal::replace_document;
+
+    void request_document(Xapian::docid did) const;
+
+    void add_spelling(std::string_view word, Xapian::termcount freqinc) const;
+
+    Xapian::termcount remove_spelling(std::string_view word,
+				      Xapian::termcount freqdec) const;
+
+    void add_synonym(std::string_view term, std::string_view synonym) const;
+
+    void remove_synonym(std::string_view term,
+			std::string_view synonym) const;
+
+    void clear_synonyms(std::string_view term) const;
+
+    void set_metadata(std::string_view key, std::string_view value);
+
+    std::string get_description() const;
+};
+
+#endif // XAPIAN_INCLUDED_TIERED_DATABASE_H
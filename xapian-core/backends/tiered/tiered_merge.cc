@@ -0,0 +1,129 @@
+/** @file
+ * @brief Build a honey segment for a tiered database in the background
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "tiered_merge.h"
+
+#include "xapian/constants.h"
+#include "xapian/database.h"
+#include "xapian/document.h"
+#include "xapian/postingiterator.h"
+
+#include "fileutils.h"
+
+#include <algorithm>
+#include <system_error>
+
+using namespace std;
+
+/// Flags to compact with.
+static constexpr int COMPACT_FLAGS = Xapian::DB_BACKEND_HONEY |
+				     Xapian::DBCOMPACT_NO_RENUMBER |
+				     Xapian::DBCOMPACT_BLOOM_FILTER;
+
+TieredMerge::~TieredMerge()
+{
+    if (thread.joinable())
+	thread.join();
+}
+
+void
+TieredMerge::run()
+{
+    try {
+	string output = dir + '/' + output_name;
+	// Remove any partial output from an earlier attempt.
+	removedir(output);
+
+	bool any_hidden = false;
+	for (auto&& source : sources) {
+	    if (!source.hidden.empty()) {
+		any_hidden = true;
+		break;
+	    }
+	}
+
+	if (!any_hidden) {
+	    // Nothing to omit, so the docid ranges can't overlap and we can
+	    // just compact the sources together.
+	    Xapian::Database db;
+	    for (auto&& source : sources) {
+		db.add_database(Xapian::Database(dir + '/' + source.name));
+	    }
+	    if (db.get_doccount() == 0) {
+		empty = true;
+	    } else {
+		db.compact(output, COMPACT_FLAGS);
+	    }
+	} else {
+	    // Copy the documents we're keeping to a temporary glass database
+	    // and compact that.
+	    string tmp = output + ".tmp";
+	    removedir(tmp);
+	    {
+		Xapian::WritableDatabase tmp_db(tmp,
+						Xapian::DB_CREATE_OR_OVERWRITE |
+						Xapian::DB_BACKEND_GLASS |
+						Xapian::DB_NO_SYNC);
+		for (auto&& source : sources) {
+		    Xapian::Database db(dir + '/' + source.name);
+		    const auto& hidden = source.hidden;
+		    for (auto i = db.postlist_begin(""sv);
+			 i != db.postlist_end(""sv);
+			 ++i) {
+			Xapian::docid did = *i;
+			if (binary_search(hidden.begin(), hidden.end(), did))
+			    continue;
+			tmp_db.replace_document(did, db.get_document(did));
+		    }
+		}
+		tmp_db.commit();
+		empty = (tmp_db.get_doccount() == 0);
+	    }
+	    if (!empty)
+		Xapian::Database(tmp).compact(output, COMPACT_FLAGS);
+	    removedir(tmp);
+	}
+    } catch (...) {
+	error = current_exception();
+    }
+    finished = true;
+}
+
+void
+TieredMerge::start()
+{
+    try {
+	thread = std::thread([this]() { run(); });
+    } catch (const std::system_error&) {
+	// Failing to create a thread isn't fatal - just do the work now.
+	run();
+    }
+}
+
+void
+TieredMerge::wait()
+{
+    if (thread.joinable())
+	thread.join();
+    if (error)
+	rethrow_exception(error);
+}
@@ -0,0 +1,121 @@
+/** @file
+ * @brief Build a honey segment for a tiered database in the background
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef XAPIAN_INCLUDED_TIERED_MERGE_H
+#define XAPIAN_INCLUDED_TIERED_MERGE_H
+
+#include "xapian/types.h"
+
+#include <atomic>
+#include <exception>
+#include <string>
+#include <thread>
+#include <vector>
+
+/** Build a honey segment for a tiered database in the background.
+ *
+ *  The sources are one or more existing segments, and the output has the
+ *  documents from them which aren't hidden, with the same docids.  The work
+ *  is done using the public API on separate database objects, so it doesn't
+ *  touch the TieredDatabase object while it runs - the TieredDatabase polls
+ *  done() and installs the result in the thread which is using it.
+ */
+class TieredMerge {
+  public:
+    /// A segment to read from.
+    struct Source {
+	/// Name of the segment's directory.
+	std::string name;
+
+	/// Docids to omit (in ascending order).
+	std::vector<Xapian::docid> hidden;
+    };
+
+  private:
+    /// Don't allow assignment.
+    void operator=(const TieredMerge&) = delete;
+
+    /// Don't allow copying.
+    TieredMerge(const TieredMerge&) = delete;
+
+    /// The tiered database directory.
+    std::string dir;
+
+    /// The segments to read from.
+    std::vector<Source> sources;
+
+    /// Name of the output segment's directory.
+    std::string output_name;
+
+    /// Epoch of the output segment.
+    unsigned epoch;
+
+    /// The background thread (if we managed to start one).
+    std::thread thread;
+
+    /// Set when the work has finished (successfully or not).
+    std::atomic<bool> finished{false};
+
+    /// Any exception thrown while doing the work.
+    std::exception_ptr error;
+
+    /// Set if there were no documents to put in the output.
+    bool empty = false;
+
+    /// Do the work.
+    void run();
+
+  public:
+    TieredMerge(const std::string& dir_,
+		std::vector<Source>&& sources_,
+		const std::string& output_name_,
+		unsigned epoch_)
+	: dir(dir_), sources(std::move(sources_)),
+	  output_name(output_name_), epoch(epoch_) {}
+
+    /// Waits for the work to finish.
+    ~TieredMerge();
+
+    /** Start the work.
+     *
+     *  If a thread can't be created the work is done before this returns.
+     */
+    void start();
+
+    /// Has the work finished?
+    bool done() const { return finished; }
+
+    /** Wait for the work to finish.
+     *
+     *  Any exception thrown while doing the work is rethrown.
+     */
+    void wait();
+
+    const std::vector<Source>& get_sources() const { return sources; }
+
+    /// Name of the output segment (empty if there were no documents).
+    std::string get_output_name() const {
+	return empty ? std::string() : output_name;
+    }
+
+    unsigned get_epoch() const { return epoch; }
+};
+
+#endif // XAPIAN_INCLUDED_TIERED_MERGE_H
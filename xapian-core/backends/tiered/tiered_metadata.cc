@@ -0,0 +1,77 @@
+/** @file
+ * @brief Iterate the user metadata keys in a tiered database
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "tiered_metadata.h"
+
+#include "stringutils.h"
+
+#include <string>
+
+using namespace std;
+
+TieredMetadataTermList::~TieredMetadataTermList()
+{
+    delete sub;
+}
+
+TermList*
+TieredMetadataTermList::update(TermList* result)
+{
+    if (result) {
+	if (result == sub) return this;
+	// Prune.
+	delete sub;
+	sub = result;
+    }
+    current_term = sub->get_termname();
+    if (startswith(current_term, TIERED_METADATA_PREFIX)) {
+	// The backend's keys all have the same prefix so skip past them all.
+	string end{TIERED_METADATA_PREFIX};
+	end.back() += 1;
+	return update(sub->skip_to(end));
+    }
+    return NULL;
+}
+
+Xapian::termcount
+TieredMetadataTermList::get_approx_size() const
+{
+    return sub->get_approx_size();
+}
+
+Xapian::doccount
+TieredMetadataTermList::get_termfreq() const
+{
+    return sub->get_termfreq();
+}
+
+TermList*
+TieredMetadataTermList::next()
+{
+    return update(sub->next());
+}
+
+TermList*
+TieredMetadataTermList::skip_to(string_view key)
+{
+    return update(sub->skip_to(key));
+}
@@ -0,0 +1,69 @@
+/** @file
+ * @brief Iterate the user metadata keys in a tiered database
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef XAPIAN_INCLUDED_TIERED_METADATA_H
+#define XAPIAN_INCLUDED_TIERED_METADATA_H
+
+#include "backends/alltermslist.h"
+
+#include <string_view>
+
+using namespace std::string_view_literals;
+
+/** Prefix of the user metadata keys used by the tiered backend itself.
+ *
+ *  These are stored in the head along with the user's metadata.
+ */
+constexpr std::string_view TIERED_METADATA_PREFIX = "\0tiered"sv;
+
+/// Iterate the user metadata keys, skipping those used by the backend.
+class TieredMetadataTermList : public AllTermsList {
+    /// Don't allow assignment.
+    void operator=(const TieredMetadataTermList&) = delete;
+
+    /// Don't allow copying.
+    TieredMetadataTermList(const TieredMetadataTermList&) = delete;
+
+    /// The head's metadata keylist.
+    TermList* sub;
+
+    /** Handle the result of calling next() or skip_to() on @a sub.
+     *
+     *  @return The value to return, or @a sub if we're on a key used by the
+     *		backend.
+     */
+    TermList* update(TermList* result);
+
+  public:
+    /// Construct, taking ownership of @a sub_.
+    explicit TieredMetadataTermList(TermList* sub_) : sub(sub_) {}
+
+    ~TieredMetadataTermList();
+
+    Xapian::termcount get_approx_size() const;
+
+    Xapian::doccount get_termfreq() const;
+
+    TermList* next();
+
+    TermList* skip_to(std::string_view key);
+};
+
+#endif // XAPIAN_INCLUDED_TIERED_METADATA_H
@@ -0,0 +1,198 @@
+/** @file
+ * @brief Merge postlists from the tiers of a tiered database
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "tiered_postlist.h"
+
+#include "omassert.h"
+#include "str.h"
+
+#include <algorithm>
+
+using namespace std;
+
+bool
+TieredPostList::Sub::skip_hidden()
+{
+    while (!pl->at_end()) {
+	if (!binary_search(hidden.begin(), hidden.end(), pl->get_docid()))
+	    return true;
+	pl->next();
+    }
+    return false;
+}
+
+TieredPostList::TieredPostList(string_view term_,
+			       vector<Sub>&& subs_,
+			       Xapian::doccount tf,
+			       Xapian::termcount cf)
+    : LeafPostList(term_), subs(std::move(subs_))
+{
+    termfreq = tf;
+    collfreq = cf;
+    for (auto&& sub : subs) {
+	wdf_upper_bound = max(wdf_upper_bound, sub.pl->get_wdf_upper_bound());
+    }
+}
+
+TieredPostList::~TieredPostList()
+{
+    for (auto&& sub : subs) {
+	delete sub.pl;
+    }
+}
+
+void
+TieredPostList::update_current()
+{
+    size_t j = 0;
+    for (size_t i = 0; i != subs.size(); ++i) {
+	if (subs[i].pl->at_end()) {
+	    delete subs[i].pl;
+	    continue;
+	}
+	if (i != j) subs[j] = std::move(subs[i]);
+	++j;
+    }
+    subs.resize(j);
+
+    if (subs.empty()) return;
+    current = 0;
+    did = subs[0].pl->get_docid();
+    for (size_t i = 1; i != subs.size(); ++i) {
+	Xapian::docid sub_did = subs[i].pl->get_docid();
+	if (sub_did < did) {
+	    did = sub_did;
+	    current = i;
+	}
+    }
+}
+
+Xapian::docid
+TieredPostList::get_docid() const
+{
+    Assert(!at_end());
+    return did;
+}
+
+Xapian::termcount
+TieredPostList::get_wdf() const
+{
+    Assert(!at_end());
+    return subs[current].pl->get_wdf();
+}
+
+bool
+TieredPostList::at_end() const
+{
+    return subs.empty();
+}
+
+PositionList*
+TieredPostList::read_position_list()
+{
+    Assert(!at_end());
+    return subs[current].pl->read_position_list();
+}
+
+PositionList*
+TieredPostList::open_position_list() const
+{
+    Assert(!at_end());
+    return subs[current].pl->open_position_list();
+}
+
+PostList*
+TieredPostList::next(double)
+{
+    if (did == 0) {
+	for (auto&& sub : subs) {
+	    sub.pl->next();
+	    sub.skip_hidden();
+	}
+    } else {
+	Sub& sub = subs[current];
+	sub.pl->next();
+	sub.skip_hidden();
+    }
+    update_current();
+    return NULL;
+}
+
+PostList*
+TieredPostList::skip_to(Xapian::docid target, double)
+{
+    if (target <= did) return NULL;
+    for (auto&& sub : subs) {
+	// Postlists which haven't been started need skip_to() calling even if
+	// target is 1.
+	if (did != 0 && sub.pl->get_docid() >= target) continue;
+	sub.pl->skip_to(target);
+	sub.skip_hidden();
+    }
+    update_current();
+    return NULL;
+}
+
+Xapian::termcount
+TieredPostList::get_wdf_upper_bound() const
+{
+    return wdf_upper_bound;
+}
+
+void
+TieredPostList::get_docid_range(Xapian::docid& first,
+				Xapian::docid& last) const
+{
+    Assert(did == 0);
+    // The union of the ranges of the tiers.
+    Xapian::docid union_first = 0, union_last = 0;
+    for (auto&& sub : subs) {
+	Xapian::docid f = first, l = last;
+	sub.pl->get_docid_range(f, l);
+	if (f > l) continue;
+	if (union_last == 0) {
+	    union_first = f;
+	    union_last = l;
+	} else {
+	    union_first = min(union_first, f);
+	    union_last = max(union_last, l);
+	}
+    }
+    if (union_last == 0) {
+	// No tier has any postings.
+	last = 0;
+	return;
+    }
+    first = max(first, union_first);
+    last = min(last, union_last);
+}
+
+string
+TieredPostList::get_description() const
+{
+    string desc = "TieredPostList(";
+    desc += term;
+    desc += ", ";
+    desc += str(subs.size());
+    desc += " tiers)";
+    return desc;
+}
@@ -0,0 +1,111 @@
+/** @file
+ * @brief Merge postlists from the tiers of a tiered database
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef XAPIAN_INCLUDED_TIERED_POSTLIST_H
+#define XAPIAN_INCLUDED_TIERED_POSTLIST_H
+
+#include "backends/databaseinternal.h"
+#include "backends/leafpostlist.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+/** Merge postlists from the tiers of a tiered database.
+ *
+ *  Docids are the same in every tier and each document is only visible in
+ *  one tier, so this is a simple merge by docid, skipping postings for
+ *  documents which are hidden in the tier they're from.
+ */
+class TieredPostList : public LeafPostList {
+  public:
+    /// A postlist from one tier.
+    struct Sub {
+	/// Keep the shard the postlist is from alive.
+	Xapian::Internal::intrusive_ptr<const Xapian::Database::Internal> db;
+
+	LeafPostList* pl;
+
+	/// Docids to skip (in ascending order).
+	std::vector<Xapian::docid> hidden;
+
+	/// Skip any hidden postings; return false if at the end.
+	bool skip_hidden();
+    };
+
+  private:
+    /// Don't allow assignment.
+    void operator=(const TieredPostList&) = delete;
+
+    /// Don't allow copying.
+    TieredPostList(const TieredPostList&) = delete;
+
+    /// Postlists which aren't at the end.
+    std::vector<Sub> subs;
+
+    /// Index in subs of the postlist with the current docid.
+    size_t current = 0;
+
+    /// The current docid (0 before we start).
+    Xapian::docid did = 0;
+
+    /// Upper bound on the wdf.
+    Xapian::termcount wdf_upper_bound = 0;
+
+    /// Remove subs which are at the end and update current and did.
+    void update_current();
+
+  public:
+    /** Construct.
+     *
+     *  @param term_	The term (empty for all documents).
+     *  @param subs_	The postlists to merge (we take ownership).
+     *  @param tf	The term frequency, excluding hidden documents.
+     *  @param cf	The collection frequency, excluding hidden documents.
+     */
+    TieredPostList(std::string_view term_,
+		   std::vector<Sub>&& subs_,
+		   Xapian::doccount tf,
+		   Xapian::termcount cf);
+
+    ~TieredPostList();
+
+    Xapian::docid get_docid() const;
+
+    Xapian::termcount get_wdf() const;
+
+    bool at_end() const;
+
+    PositionList* read_position_list();
+
+    PositionList* open_position_list() const;
+
+    PostList* next(double w_min);
+
+    PostList* skip_to(Xapian::docid target, double w_min);
+
+    Xapian::termcount get_wdf_upper_bound() const;
+
+    void get_docid_range(Xapian::docid& first, Xapian::docid& last) const;
+
+    std::string get_description() const;
+};
+
+#endif // XAPIAN_INCLUDED_TIERED_POSTLIST_H
@@ -0,0 +1,100 @@
+/** @file
+ * @brief Termlist for a document in a tiered database
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "tiered_termlist.h"
+
+#include "expand/expandweight.h"
+#include "omassert.h"
+
+using namespace std;
+
+TieredTermList::~TieredTermList()
+{
+    delete real_termlist;
+}
+
+Xapian::termcount
+TieredTermList::get_approx_size() const
+{
+    return real_termlist->get_approx_size();
+}
+
+void
+TieredTermList::accumulate_stats(Xapian::Internal::ExpandStats& stats) const
+{
+    // Report the statistics for the whole database so the expansion sees
+    // this as a single shard.
+    stats.accumulate(0, get_wdf(), db->get_doclength(did), get_termfreq(),
+		     db->get_doccount());
+}
+
+Xapian::termcount
+TieredTermList::get_wdf() const
+{
+    return real_termlist->get_wdf();
+}
+
+Xapian::doccount
+TieredTermList::get_termfreq() const
+{
+    Xapian::doccount result;
+    db->get_freqs(real_termlist->get_termname(), &result, NULL);
+    return result;
+}
+
+TermList*
+TieredTermList::next()
+{
+    TermList* res = real_termlist->next();
+    if (res) {
+	// No more entries (prune shouldn't happen).
+	Assert(res == real_termlist);
+	return this;
+    }
+    current_term = real_termlist->get_termname();
+    return NULL;
+}
+
+TermList*
+TieredTermList::skip_to(string_view term)
+{
+    TermList* res = real_termlist->skip_to(term);
+    if (res) {
+	// No more entries (prune shouldn't happen).
+	Assert(res == real_termlist);
+	return this;
+    }
+    current_term = real_termlist->get_termname();
+    return NULL;
+}
+
+Xapian::termcount
+TieredTermList::positionlist_count() const
+{
+    return real_termlist->positionlist_count();
+}
+
+PositionList*
+TieredTermList::positionlist_begin() const
+{
+    return real_termlist->positionlist_begin();
+}
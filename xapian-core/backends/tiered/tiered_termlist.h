@@ -0,0 +1,76 @@
+/** @file
+ * @brief Termlist for a document in a tiered database
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef XAPIAN_INCLUDED_TIERED_TERMLIST_H
+#define XAPIAN_INCLUDED_TIERED_TERMLIST_H
+
+#include "api/termlist.h"
+#include "backends/databaseinternal.h"
+
+#include <string_view>
+
+/** Termlist for a document in a tiered database.
+ *
+ *  Most methods just forward to the termlist from the tier the document is
+ *  in, but the statistics are for the whole tiered database.
+ */
+class TieredTermList : public TermList {
+    /// Don't allow assignment.
+    void operator=(const TieredTermList&) = delete;
+
+    /// Don't allow copying.
+    TieredTermList(const TieredTermList&) = delete;
+
+    /// The termlist from the tier.
+    TermList* real_termlist;
+
+    /// The tiered database.
+    Xapian::Internal::intrusive_ptr_nonnull<const Xapian::Database::Internal> db;
+
+    /// The document id.
+    Xapian::docid did;
+
+  public:
+    /// Construct, taking ownership of @a real_termlist_.
+    TieredTermList(const Xapian::Database::Internal* db_,
+		   Xapian::docid did_,
+		   TermList* real_termlist_)
+	: real_termlist(real_termlist_), db(db_), did(did_) {}
+
+    ~TieredTermList();
+
+    Xapian::termcount get_approx_size() const;
+
+    void accumulate_stats(Xapian::Internal::ExpandStats& stats) const;
+
+    Xapian::termcount get_wdf() const;
+
+    Xapian::doccount get_termfreq() const;
+
+    TermList* next();
+
+    TermList* skip_to(std::string_view term);
+
+    Xapian::termcount positionlist_count() const;
+
+    PositionList* positionlist_begin() const;
+};
+
+#endif // XAPIAN_INCLUDED_TIERED_TERMLIST_H
@@ -0,0 +1,139 @@
+/** @file
+ * @brief Merge value streams from the tiers of a tiered database
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "tiered_valuelist.h"
+
+#include "omassert.h"
+#include "str.h"
+
+#include <algorithm>
+
+using namespace std;
+
+void
+TieredValueList::Sub::skip_hidden()
+{
+    while (!vl->at_end() &&
+	   binary_search(hidden.begin(), hidden.end(), vl->get_docid())) {
+	vl->next();
+    }
+}
+
+TieredValueList::~TieredValueList()
+{
+    for (auto&& sub : subs) {
+	delete sub.vl;
+    }
+}
+
+void
+TieredValueList::update_current()
+{
+    size_t j = 0;
+    for (size_t i = 0; i != subs.size(); ++i) {
+	if (subs[i].vl->at_end()) {
+	    delete subs[i].vl;
+	    continue;
+	}
+	if (i != j) subs[j] = std::move(subs[i]);
+	++j;
+    }
+    subs.resize(j);
+
+    if (subs.empty()) return;
+    current = 0;
+    did = subs[0].vl->get_docid();
+    for (size_t i = 1; i != subs.size(); ++i) {
+	Xapian::docid sub_did = subs[i].vl->get_docid();
+	if (sub_did < did) {
+	    did = sub_did;
+	    current = i;
+	}
+    }
+}
+
+Xapian::docid
+TieredValueList::get_docid() const
+{
+    Assert(!at_end());
+    return did;
+}
+
+string
+TieredValueList::get_value() const
+{
+    Assert(!at_end());
+    return subs[current].vl->get_value();
+}
+
+Xapian::valueno
+TieredValueList::get_valueno() const
+{
+    return slot;
+}
+
+bool
+TieredValueList::at_end() const
+{
+    return subs.empty();
+}
+
+void
+TieredValueList::next()
+{
+    if (did == 0) {
+	for (auto&& sub : subs) {
+	    sub.vl->next();
+	    sub.skip_hidden();
+	}
+    } else {
+	Sub& sub = subs[current];
+	sub.vl->next();
+	sub.skip_hidden();
+    }
+    update_current();
+}
+
+void
+TieredValueList::skip_to(Xapian::docid target)
+{
+    if (target <= did) return;
+    for (auto&& sub : subs) {
+	// Value streams which haven't been started need skip_to() calling
+	// even if target is 1.
+	if (did != 0 && sub.vl->get_docid() >= target) continue;
+	sub.vl->skip_to(target);
+	sub.skip_hidden();
+    }
+    update_current();
+}
+
+string
+TieredValueList::get_description() const
+{
+    string desc = "TieredValueList(slot=";
+    desc += str(slot);
+    desc += ", ";
+    desc += str(subs.size());
+    desc += " tiers)";
+    return desc;
+}
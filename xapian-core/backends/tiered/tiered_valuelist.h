@@ -0,0 +1,91 @@
+/** @file
+ * @brief Merge value streams from the tiers of a tiered database
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef XAPIAN_INCLUDED_TIERED_VALUELIST_H
+#define XAPIAN_INCLUDED_TIERED_VALUELIST_H
+
+#include "backends/databaseinternal.h"
+#include "backends/valuelist.h"
+
+#include <string>
+#include <vector>
+
+/// Merge value streams from the tiers of a tiered database.
+class TieredValueList : public ValueList {
+  public:
+    /// A value stream from one tier.
+    struct Sub {
+	/// Keep the shard the value stream is from alive.
+	Xapian::Internal::intrusive_ptr<const Xapian::Database::Internal> db;
+
+	ValueList* vl;
+
+	/// Docids to skip (in ascending order).
+	std::vector<Xapian::docid> hidden;
+
+	/// Skip any hidden entries.
+	void skip_hidden();
+    };
+
+  private:
+    /// Don't allow assignment.
+    void operator=(const TieredValueList&) = delete;
+
+    /// Don't allow copying.
+    TieredValueList(const TieredValueList&) = delete;
+
+    /// Value streams which aren't at the end.
+    std::vector<Sub> subs;
+
+    /// Index in subs of the value stream with the current docid.
+    size_t current = 0;
+
+    /// The current docid (0 before we start).
+    Xapian::docid did = 0;
+
+    /// The value slot.
+    Xapian::valueno slot;
+
+    /// Remove subs which are at the end and update current and did.
+    void update_current();
+
+  public:
+    /// Construct, taking ownership of the value streams in @a subs_.
+    TieredValueList(Xapian::valueno slot_, std::vector<Sub>&& subs_)
+	: subs(std::move(subs_)), slot(slot_) {}
+
+    ~TieredValueList();
+
+    Xapian::docid get_docid() const;
+
+    std::string get_value() const;
+
+    Xapian::valueno get_valueno() const;
+
+    bool at_end() const;
+
+    void next();
+
+    void skip_to(Xapian::docid target);
+
+    std::string get_description() const;
+};
+
+#endif // XAPIAN_INCLUDED_TIERED_VALUELIST_H
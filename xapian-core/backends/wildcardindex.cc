@@ -0,0 +1,40 @@
+/** @file
+ * @brief Index of terms for expanding wildcards with a leading wildcard
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "wildcardindex.h"
+
+#include "api/termlist.h"
+
+#include <memory>
+
+using namespace std;
+
+void
+wildcard_index_add_terms(const Xapian::Database::Internal& db,
+			 string_view prefix,
+			 const function<void(const string&)>& add)
+{
+    unique_ptr<TermList> t(db.open_allterms(string_view()));
+    while (t->next() == NULL) {
+	wildcard_index_keys(prefix, t->get_termname(), add);
+    }
+}
@@ -0,0 +1,297 @@
+/** @file
+ * @brief Index of terms for expanding wildcards with a leading wildcard
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef XAPIAN_INCLUDED_WILDCARDINDEX_H
+#define XAPIAN_INCLUDED_WILDCARDINDEX_H
+
+#include "xapian/error.h"
+
+#include "backends/databaseinternal.h"
+#include "safeunistd.h"
+#include "stringutils.h"
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/* The wildcard index is a permuterm index stored in the postlist table.
+ *
+ * The key for the index entries starts with a backend-specific two byte
+ * prefix.  The entry with just this prefix as its key marks that the index
+ * is present and complete.
+ *
+ * For each term there's an entry for each rotation which starts part way
+ * through the term with at least WILDCARD_INDEX_MIN_LITERAL bytes before the
+ * end of the term.  The key is the prefix, the rotated term, and then a byte
+ * giving how far into the term the rotation starts.  This last byte makes the
+ * keys for different terms unique (e.g. "abab" and "baba" have a rotation in
+ * common).  Terms are limited to 245 bytes by the glass backend so this byte
+ * and the whole key always fit.
+ *
+ * Rotations starting at the start of the term aren't needed since we can find
+ * terms starting with some literal text by looking at the terms directly.
+ *
+ * The tag isn't used, but honey doesn't allow an empty tag.
+ */
+
+/// Literal text looked up in the wildcard index must be at least this long.
+constexpr size_t WILDCARD_INDEX_MIN_LITERAL = 2;
+
+/// The tag used for wildcard index entries.
+#define WILDCARD_INDEX_TAG std::string(1, '\0')
+
+/** Call @a f with the wildcard index key for each rotation of @a term.
+ *
+ *  @param prefix	The backend-specific key prefix.
+ */
+template<typename F>
+inline void
+wildcard_index_keys(std::string_view prefix, std::string_view term, F f)
+{
+    std::string key;
+    for (size_t i = 1; i + WILDCARD_INDEX_MIN_LITERAL <= term.size(); ++i) {
+	key.assign(prefix);
+	key.append(term, i);
+	key.append(term, 0, i);
+	key += char(i);
+	f(key);
+    }
+}
+
+/** Decode a wildcard index key.
+ *
+ *  @param rotated	The key without the prefix (which mustn't be the key
+ *			which marks that the index is present).
+ *  @param[out] term	Set to the term the key is for.
+ *
+ *  @return The length of the rotation before it wraps around to the start of
+ *	    the term, or 0 if the key isn't valid.
+ */
+inline size_t
+wildcard_index_decode(std::string_view rotated, std::string& term)
+{
+    size_t start = static_cast<unsigned char>(rotated.back());
+    rotated.remove_suffix(1);
+    if (rare(start == 0 || start + WILDCARD_INDEX_MIN_LITERAL > rotated.size()))
+	return 0;
+    size_t tail_len = rotated.size() - start;
+    term.assign(rotated, tail_len);
+    term.append(rotated, 0, tail_len);
+    return tail_len;
+}
+
+/** Find terms containing @a literal using the wildcard index.
+ *
+ *  Terms which start with @a literal aren't found (unless @a literal also
+ *  occurs later in the term).
+ *
+ *  @param cursor	A cursor on the postlist table.
+ *  @param prefix	The backend-specific key prefix.
+ *  @param literal	The text to look for, which must be at least
+ *			WILDCARD_INDEX_MIN_LITERAL bytes long.
+ *  @param terms	The terms found are appended to this, in no particular
+ *			order and possibly with duplicates.
+ */
+template<typename C>
+inline void
+wildcard_index_lookup(C& cursor,
+		      std::string_view prefix,
+		      std::string_view literal,
+		      std::vector<std::string>& terms)
+{
+    std::string key(prefix);
+    key += literal;
+    (void)cursor.find_entry_ge(key);
+    std::string term;
+    while (!cursor.after_end() && startswith(cursor.current_key, key)) {
+	std::string_view rotated = cursor.current_key;
+	rotated.remove_prefix(prefix.size());
+	size_t tail_len = wildcard_index_decode(rotated, term);
+	if (rare(tail_len == 0))
+	    throw Xapian::DatabaseCorruptError("Bad wildcard index key");
+	// The rotation may match across the end of the term and on to its
+	// start, which doesn't count.
+	if (tail_len >= literal.size()) terms.push_back(term);
+	cursor.next();
+    }
+}
+
+/** Generate the wildcard index entries for all the terms in a database.
+ *
+ *  Used when compacting an input without a wildcard index to a database with
+ *  one.  The keys are passed to @a add in no particular order.
+ */
+void wildcard_index_add_terms(const Xapian::Database::Internal& db,
+			      std::string_view prefix,
+			      const std::function<void(const std::string&)>& add);
+
+/** Sort wildcard index keys generated during compaction.
+ *
+ *  There's an entry for every rotation of every term, so the keys for a
+ *  large database won't necessarily fit in memory.  Keys are collected in
+ *  memory until they use about run_size bytes, then that run is sorted and
+ *  written to a temporary table.  Once all the keys have been added, the
+ *  runs are merged as the keys are read back.
+ *
+ *  @param T	The table class to use for the temporary tables.
+ *  @param C	The cursor class for T.
+ */
+template<typename T, typename C>
+class WildcardKeys {
+    struct CursorGt {
+	bool operator()(const C* a, const C* b) const {
+	    return a->current_key > b->current_key;
+	}
+    };
+
+    /** Create and open temporary table number @a n for writing.
+     *
+     *  If not set, the keys are all kept in memory.
+     */
+    std::function<T*(unsigned n)> new_run;
+
+    /// Flush and commit a temporary table.
+    std::function<void(T*)> end_run;
+
+    /// Approximate memory to use for a run of keys.
+    size_t run_size = 0;
+
+    /// The keys in memory.
+    std::vector<std::string> keys;
+
+    /// Approximate memory used by keys.
+    size_t keys_size = 0;
+
+    /// The next key in keys to return.
+    size_t i = 0;
+
+    /// Temporary tables holding the sorted runs.
+    std::vector<std::unique_ptr<T>> runs;
+
+    /// Cursors on the runs.
+    std::vector<std::unique_ptr<C>> cursors;
+
+    /// Cursors which aren't yet exhausted, ordered by their current key.
+    std::priority_queue<C*, std::vector<C*>, CursorGt> pq;
+
+    /// The current key.
+    std::string current;
+
+    /// Is there a current key?
+    bool have_current = false;
+
+    void sort_keys() {
+	std::sort(keys.begin(), keys.end());
+	keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    }
+
+    void write_run() {
+	sort_keys();
+	T* run = new_run(runs.size());
+	runs.emplace_back(run);
+	for (auto& key : keys) {
+	    run->add(key, WILDCARD_INDEX_TAG);
+	}
+	end_run(run);
+	std::vector<std::string>().swap(keys);
+	keys_size = 0;
+    }
+
+  public:
+    /// Construct an object which keeps all the keys in memory.
+    WildcardKeys() { }
+
+    WildcardKeys(std::function<T*(unsigned)> new_run_,
+		 std::function<void(T*)> end_run_,
+		 size_t run_size_ = 32 * 1024 * 1024)
+	: new_run(new_run_), end_run(end_run_), run_size(run_size_) { }
+
+    ~WildcardKeys() {
+	cursors.clear();
+	for (auto& run : runs) {
+	    std::string path = run->get_path();
+	    run.reset();
+	    unlink(path.c_str());
+	}
+    }
+
+    /// Add a key.
+    void add(const std::string& key) {
+	keys.push_back(key);
+	keys_size += key.size() + sizeof(std::string);
+	if (new_run && keys_size >= run_size) write_run();
+    }
+
+    /// Finish adding keys and start reading them back.
+    void start() {
+	sort_keys();
+	for (auto& run : runs) {
+	    C* cursor = new C(run.get());
+	    cursors.emplace_back(cursor);
+	    cursor->rewind();
+	    if (cursor->next()) pq.push(cursor);
+	}
+	next();
+    }
+
+    /** The current key in ascending order, or NULL once all have been read.
+     *
+     *  Duplicate keys are only returned once.
+     */
+    const std::string* get() const {
+	return have_current ? &current : NULL;
+    }
+
+    /// The number of runs written to temporary tables.
+    size_t get_run_count() const { return runs.size(); }
+
+    /// Advance to the next key.
+    void next() {
+	while (true) {
+	    C* cursor = pq.empty() ? NULL : pq.top();
+	    bool in_memory = (i != keys.size());
+	    if (cursor && in_memory && keys[i] <= cursor->current_key) {
+		cursor = NULL;
+	    } else if (!cursor && !in_memory) {
+		have_current = false;
+		return;
+	    }
+	    const std::string& key = cursor ? cursor->current_key : keys[i];
+	    bool dup = (have_current && key == current);
+	    if (!dup) current = key;
+	    if (cursor) {
+		pq.pop();
+		if (cursor->next()) pq.push(cursor);
+	    } else {
+		++i;
+	    }
+	    if (!dup) {
+		have_current = true;
+		return;
+	    }
+	}
+    }
+};
+
+#endif // XAPIAN_INCLUDED_WILDCARDINDEX_H
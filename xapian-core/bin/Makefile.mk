@@ -66,6 +66,7 @@ bin_xapian_inspect_CPPFLAGS =\
 bin_xapian_inspect_SOURCES = bin/xapian-inspect.cc\
 	api/constinfo.cc\
 	api/error.cc\
+	backends/glass/glass_blockcache.cc\
 	backends/glass/glass_changes.cc\
 	backends/glass/glass_cursor.cc\
 	backends/glass/glass_freelist.cc\
@@ -88,6 +89,7 @@ bin_xapian_inspect_honey_CPPFLAGS =\
 bin_xapian_inspect_honey_SOURCES = bin/xapian-inspect-honey.cc\
 	api/constinfo.cc\
 	api/error.cc\
+	backends/honey/honey_bloom.cc\
 	backends/honey/honey_cursor.cc\
 	backends/honey/honey_freelist.cc\
 	backends/honey/honey_table.cc\
@@ -102,7 +104,8 @@ bin_xapian_inspect_honey_SOURCES = bin/xapian-inspect-honey.cc\
 	unicode/unicode-data.cc\
 	unicode/utf8itor.cc
 
-# XAPIAN_LIBS gives us zlib and any library needed for UUIDs.
+# XAPIAN_LIBS gives us zlib (plus zstd and LZ4 if used) and any library needed
+# for UUIDs.
 bin_xapian_inspect_LDADD = libgetopt.la $(XAPIAN_LIBS)
 bin_xapian_inspect_honey_LDADD = libgetopt.la $(XAPIAN_LIBS)
 
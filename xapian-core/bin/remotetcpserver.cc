@@ -60,3 +60,73 @@ RemoteTcpServer::handle_one_connection(int socket)
 	// ignore other exceptions
     }
 }
+
+namespace {
+
+/// A connection being serviced by RemoteTcpServer::run_threaded().
+class RemoteTcpConnection : public TcpServer::ThreadedConnection {
+    /** The RemoteServer for this connection.
+     *
+     *  This opens its own Database, so the client sees a consistent
+     *  revision until it asks to reopen, just as with a forked server.
+     */
+    RemoteServer sserv;
+
+    bool verbose;
+
+  public:
+    RemoteTcpConnection(const vector<string>& dbpaths, int socket,
+			double active_timeout, double idle_timeout,
+			const Xapian::Registry& reg, bool verbose_)
+	: sserv(dbpaths, socket, socket, active_timeout, idle_timeout),
+	  verbose(verbose_)
+    {
+	sserv.set_registry(reg);
+    }
+
+    bool handle_requests(TcpServer::ThreadedWorker&) {
+	try {
+	    // Only process complete messages so a client which has only sent
+	    // part of a message doesn't tie up this thread waiting for the
+	    // rest.
+	    bool open = sserv.read_available();
+	    while (sserv.message_buffered()) {
+		if (!sserv.run_one()) return false;
+	    }
+	    return open;
+	} catch (const Xapian::NetworkTimeoutError &e) {
+	    if (verbose)
+		cerr << "Connection timed out: " << e.get_description() << '\n';
+	} catch (const Xapian::Error &e) {
+	    cerr << "Got exception " << e.get_description() << '\n';
+	} catch (...) {
+	    // ignore other exceptions
+	}
+	return false;
+    }
+
+    void idle_timeout() {
+	sserv.idle_timeout_expired();
+    }
+};
+
+}
+
+unique_ptr<TcpServer::ThreadedWorker>
+RemoteTcpServer::create_worker()
+{
+    if (writable) {
+	throw Xapian::UnimplementedError("Threaded mode doesn't support "
+					 "writable databases");
+    }
+    // All the per-connection state is in RemoteTcpConnection.
+    return unique_ptr<ThreadedWorker>(new ThreadedWorker);
+}
+
+unique_ptr<TcpServer::ThreadedConnection>
+RemoteTcpServer::open_connection(int socket, ThreadedWorker&)
+{
+    return unique_ptr<ThreadedConnection>(
+	new RemoteTcpConnection(dbpaths, socket, active_timeout, idle_timeout,
+				reg, verbose));
+}
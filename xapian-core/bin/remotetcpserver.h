@@ -26,6 +26,7 @@
 #include <xapian/database.h>
 #include <xapian/registry.h>
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -89,6 +90,17 @@ class RemoteTcpServer : public TcpServer {
      *  This method may be called by multiple threads.
      */
     void handle_one_connection(int socket);
+
+    /** Create the per-thread state for run_threaded().
+     *
+     *  Each connection opens its own Database, so there's no per-thread
+     *  state.  Only read-only access is supported in this mode.
+     */
+    std::unique_ptr<ThreadedWorker> create_worker();
+
+    /// Start servicing a connection for run_threaded().
+    std::unique_ptr<ThreadedConnection>
+    open_connection(int socket, ThreadedWorker& worker);
 };
 
 #endif // XAPIAN_INCLUDED_REMOTETCPSERVER_H
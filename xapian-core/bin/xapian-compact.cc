@@ -28,6 +28,7 @@
 #include <iostream>
 
 #include "gnu_getopt.h"
+#include "parseint.h"
 
 #include "backends/glass/glass_defs.h"
 
@@ -39,6 +40,10 @@ using namespace std;
 #define OPT_HELP 1
 #define OPT_VERSION 2
 #define OPT_NO_RENUMBER 3
+#define OPT_WILDCARD_INDEX 4
+#define OPT_BLOOM_FILTER 5
+#define OPT_ZSTD 6
+#define OPT_LZ4 7
 
 static void show_usage() {
     cout << "Usage: " PROG_NAME " [OPTIONS] SOURCE_DATABASE... DESTINATION_DATABASE\n\n"
@@ -60,6 +65,19 @@ static void show_usage() {
 "                     option is only supported when merging databases if they\n"
 "                     have disjoint ranges of used document ids\n"
 "  -s, --single-file  Produce a single file database\n"
+"      --wildcard-index\n"
+"                     Build an index to speed up wildcards which start with a\n"
+"                     wildcard (e.g. *ation)\n"
+"      --bloom-filter Build bloom filters so lookups of absent terms don't\n"
+"                     need to read the database (honey only)\n"
+"      --zstd         Compress with zstd instead of zlib, using a trained\n"
+"                     dictionary for document data (honey only)\n"
+"      --lz4          Compress with LZ4 instead of zlib (honey only).  With\n"
+"                     --zstd too, zstd is used for document data and LZ4 for\n"
+"                     everything else\n"
+"  -j, --threads=N    Use up to N threads to compact tables concurrently and\n"
+"                     to merge the postlist table in ranges of terms (ignored\n"
+"                     with --single-file)\n"
 "  --help             display this help and exit\n"
 "  --version          output version information and exit\n";
 }
@@ -111,7 +129,7 @@ MyCompactor::resolve_duplicate_metadata(const string & key,
 int
 main(int argc, char **argv)
 {
-    const char * opts = "b:B:nFmqs";
+    const char * opts = "b:B:nFmqsj:";
     static const struct option long_opts[] = {
 	{"fuller",	no_argument, 0, 'F'},
 	{"no-full",	no_argument, 0, 'n'},
@@ -120,6 +138,11 @@ main(int argc, char **argv)
 	{"backend",	required_argument, 0, 'B'},
 	{"no-renumber", no_argument, 0, OPT_NO_RENUMBER},
 	{"single-file", no_argument, 0, 's'},
+	{"wildcard-index", no_argument, 0, OPT_WILDCARD_INDEX},
+	{"bloom-filter", no_argument, 0, OPT_BLOOM_FILTER},
+	{"zstd",	no_argument, 0, OPT_ZSTD},
+	{"lz4",		no_argument, 0, OPT_LZ4},
+	{"threads",	required_argument, 0, 'j'},
 	{"quiet",	no_argument, 0, 'q'},
 	{"help",	no_argument, 0, OPT_HELP},
 	{"version",	no_argument, 0, OPT_VERSION},
@@ -183,9 +206,31 @@ main(int argc, char **argv)
 	    case 's':
 		flags |= Xapian::DBCOMPACT_SINGLE_FILE;
 		break;
+	    case OPT_WILDCARD_INDEX:
+		flags |= Xapian::DBCOMPACT_WILDCARD_INDEX;
+		break;
+	    case OPT_BLOOM_FILTER:
+		flags |= Xapian::DBCOMPACT_BLOOM_FILTER;
+		break;
+	    case OPT_ZSTD:
+		flags |= Xapian::DBCOMPACT_ZSTD;
+		break;
+	    case OPT_LZ4:
+		flags |= Xapian::DBCOMPACT_LZ4;
+		break;
 	    case 'q':
 		compactor.set_quiet(true);
 		break;
+	    case 'j': {
+		unsigned n_threads;
+		if (!parse_unsigned(optarg, n_threads)) {
+		    cerr << PROG_NAME": Bad value '" << optarg << "' passed "
+			    "for threads\n";
+		    exit(1);
+		}
+		compactor.set_threads(n_threads);
+		break;
+	    }
 	    case OPT_HELP:
 		cout << PROG_NAME " - " PROG_DESC "\n\n";
 		show_usage();
@@ -55,7 +55,7 @@ static void register_user_weighting_schemes(RemoteTcpServer &server) {
 #define OPT_HELP 1
 #define OPT_VERSION 2
 
-static const char * opts = "I:p:a:i:t:oqw";
+static const char * opts = "I:p:a:i:t:oqT:w";
 static const struct option long_opts[] = {
     {"interface",	required_argument,	0, 'I'},
     {"port",		required_argument,	0, 'p'},
@@ -64,6 +64,7 @@ static const struct option long_opts[] = {
     {"timeout",		required_argument,	0, 't'},
     {"one-shot",	no_argument,		0, 'o'},
     {"quiet",		no_argument,		0, 'q'},
+    {"threads",		required_argument,	0, 'T'},
     {"writable",	no_argument,		0, 'w'},
     {"help",		no_argument,		0, OPT_HELP},
     {"version",		no_argument,		0, OPT_VERSION},
@@ -83,6 +84,9 @@ static void show_usage() {
 "  --timeout MSECS         set both timeout values\n"
 "  --one-shot              serve a single connection and exit\n"
 "  --quiet                 disable information messages to stdout\n"
+"  --threads N             serve connections from a pool of N threads instead\n"
+"                          of a process per connection (read-only, and only\n"
+"                          supported on platforms with epoll)\n"
 "  --writable              allow updates\n"
 "  --help                  display this help and exit\n"
 "  --version               output version information and exit\n";
@@ -97,6 +101,7 @@ int main(int argc, char **argv) {
     bool one_shot = false;
     bool verbose = true;
     bool writable = false;
+    unsigned n_threads = 0;
     bool syntax_error = false;
 
     int c;
@@ -153,6 +158,12 @@ int main(int argc, char **argv) {
 	    case 'q':
 		verbose = false;
 		break;
+	    case 'T':
+		if (!parse_unsigned(optarg, n_threads) || n_threads == 0) {
+		    cerr << "Error: number of threads must be >= 1\n";
+		    exit(1);
+		}
+		break;
 	    case 'w':
 		writable = true;
 		break;
@@ -171,6 +182,11 @@ int main(int argc, char **argv) {
 	exit(1);
     }
 
+    if (writable && n_threads) {
+	cerr << "Error: --threads can't be used with --writable\n";
+	exit(1);
+    }
+
     vector<string> dbnames(argv + optind, argv + argc);
     try {
 	if (!one_shot) {
@@ -206,6 +222,8 @@ int main(int argc, char **argv) {
 
 	if (one_shot) {
 	    server.run_once();
+	} else if (n_threads) {
+	    server.run_threaded(n_threads, idle_timeout);
 	} else {
 	    server.run();
 	}
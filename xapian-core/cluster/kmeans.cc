@@ -24,8 +24,17 @@
 #include "xapian/error.h"
 
 #include "debuglog.h"
+#include "runtasks.h"
 
+#include <algorithm>
+#include <cmath>
+#include <functional>
 #include <limits>
+#include <numeric>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 // Threshold value for checking convergence in KMeans
@@ -36,6 +45,9 @@
  */
 #define MAX_ITERS 1000
 
+/// Each thread finds the closest centroid for at least this many points.
+#define MIN_POINTS_PER_TASK 64
+
 using namespace Xapian;
 using namespace std;
 
@@ -55,28 +67,219 @@ KMeans::get_description() const
     return "KMeans()";
 }
 
-void
-KMeans::initialise_clusters(ClusterSet& cset, doccount num_of_points)
-{
-    LOGCALL_VOID(API, "KMeans::initialise_clusters", cset | num_of_points);
-    // Initial centroids are selected by picking points at roughly even
-    // intervals within the MSet. This is cheap and helps pick diverse
-    // elements since the MSet is usually sorted by some sort of key
-    for (unsigned int i = 0; i < k; ++i) {
-	unsigned int x = (i * num_of_points) / k;
-	cset.add_cluster(Cluster(Centroid(points[x])));
-    }
-}
-
 void
 KMeans::initialise_points(const MSet& source)
 {
     LOGCALL_VOID(API, "KMeans::initialise_points", source);
     TermListGroup tlg(source, stopper.get());
+    points.clear();
     for (MSetIterator it = source.begin(); it != source.end(); ++it)
 	points.push_back(Point(tlg, it.get_document()));
 }
 
+namespace {
+
+/// The TF-IDF weights of a Point, stored as a sparse vector.
+struct SparsePoint {
+    /// Term number and weight for each term in the Point.
+    vector<pair<size_t, double>> weights;
+
+    /// The squared magnitude.
+    double magnitude;
+};
+
+/** The cluster centroids, stored as dense vectors indexed by term number.
+ *
+ *  This means we can find the distance from a point to a centroid in time
+ *  proportional to the number of terms in the point.
+ *
+ *  Each centroid is stored as a scale factor times a vector so that
+ *  mini-batch updates can scale a centroid without touching every term.
+ */
+class Centroids {
+    /// Number of distinct terms.
+    size_t n_terms;
+
+    /// The (unscaled) weights for all the centroids.
+    vector<double> weights;
+
+    /// The scale factor for each centroid.
+    vector<double> scales;
+
+    /// The squared magnitude of each (unscaled) centroid.
+    vector<double> magnitudes;
+
+  public:
+    Centroids(unsigned k, size_t n_terms_)
+	: n_terms(n_terms_), weights(k * n_terms_), scales(k, 1.0),
+	  magnitudes(k) { }
+
+    unsigned size() const { return unsigned(scales.size()); }
+
+    /// Return the unscaled weights for centroid @a c.
+    double* row(unsigned c) { return &weights[c * n_terms]; }
+
+    const double* row(unsigned c) const { return &weights[c * n_terms]; }
+
+    /// Return the scale factor for centroid @a c.
+    double scale(unsigned c) const { return scales[c]; }
+
+    /// Return the squared magnitude of (scaled) centroid @a c.
+    double magnitude(unsigned c) const {
+	return scales[c] * scales[c] * magnitudes[c];
+    }
+
+    /// Set centroid @a c to the sparse vector @a p.
+    void set(unsigned c, const SparsePoint& p) {
+	clear(c);
+	double* r = row(c);
+	for (auto&& w : p.weights) r[w.first] = w.second;
+	magnitudes[c] = p.magnitude;
+    }
+
+    /// Set centroid @a c to zero.
+    void clear(unsigned c) {
+	fill_n(row(c), n_terms, 0.0);
+	scales[c] = 1.0;
+	magnitudes[c] = 0.0;
+    }
+
+    /// Copy centroid @a c from @a o.
+    void copy(unsigned c, const Centroids& o) {
+	copy_n(o.row(c), n_terms, row(c));
+	scales[c] = o.scales[c];
+	magnitudes[c] = o.magnitudes[c];
+    }
+
+    /// Multiply centroid @a c by @a factor.
+    void multiply(unsigned c, double factor) {
+	scales[c] *= factor;
+	if (scales[c] < 1e-6) normalise(c);
+    }
+
+    /// Add @a weight times the vector for @a p to centroid @a c.
+    void add(unsigned c, const SparsePoint& p, double weight) {
+	double* r = row(c);
+	weight /= scales[c];
+	double& m = magnitudes[c];
+	for (auto&& w : p.weights) {
+	    double old_weight = r[w.first];
+	    double new_weight = old_weight + weight * w.second;
+	    r[w.first] = new_weight;
+	    m += new_weight * new_weight - old_weight * old_weight;
+	}
+	// Rounding errors could make this slightly negative.
+	if (m < 0) m = 0;
+    }
+
+    /// Fold the scale factor into centroid @a c and recalculate its magnitude.
+    void normalise(unsigned c) {
+	double* r = row(c);
+	double s = scales[c];
+	double m = 0;
+	for (size_t t = 0; t != n_terms; ++t) {
+	    r[t] *= s;
+	    m += r[t] * r[t];
+	}
+	scales[c] = 1.0;
+	magnitudes[c] = m;
+    }
+
+    /** Return the cosine distance between point @a p and centroid @a c.
+     *
+     *  This gives the same result as CosineDistance::similarity().
+     */
+    double distance(const SparsePoint& p, unsigned c) const {
+	double m = magnitude(c);
+	if (p.magnitude == 0 || m == 0)
+	    return 0.0;
+	const double* r = row(c);
+	double inner_product = 0;
+	for (auto&& w : p.weights) inner_product += w.second * r[w.first];
+	return 1 - (scales[c] * inner_product / sqrt(p.magnitude * m));
+    }
+
+    /// Return the cosine distance between centroid @a c here and in @a o.
+    double distance(const Centroids& o, unsigned c) const {
+	double m = magnitude(c);
+	double o_m = o.magnitude(c);
+	if (m == 0 || o_m == 0)
+	    return 0.0;
+	const double* r = row(c);
+	const double* o_r = o.row(c);
+	double inner_product = 0;
+	for (size_t t = 0; t != n_terms; ++t) inner_product += r[t] * o_r[t];
+	inner_product *= scales[c] * o.scales[c];
+	return 1 - (inner_product / sqrt(m * o_m));
+    }
+
+    /// Return the centroid @a c which is closest to point @a p.
+    unsigned closest(const SparsePoint& p) const {
+	double closest_cluster_distance = numeric_limits<double>::max();
+	unsigned closest_cluster = 0;
+	for (unsigned c = 0; c != size(); ++c) {
+	    double dist = distance(p, c);
+	    if (closest_cluster_distance > dist) {
+		closest_cluster_distance = dist;
+		closest_cluster = c;
+	    }
+	}
+	return closest_cluster;
+    }
+};
+
+}
+
+/** Assign points to the cluster with the closest centroid.
+ *
+ *  @param indices	The points to assign.
+ *  @param n		The number of entries in @a indices.
+ *  @param assignment	The cluster each point is assigned to, which is
+ *			updated.
+ *
+ *  @return true if any of the points were assigned to a different cluster.
+ */
+static bool
+assign_points(const vector<SparsePoint>& points,
+	      const Centroids& centroids,
+	      const doccount* indices, size_t n,
+	      vector<unsigned>& assignment,
+	      unsigned n_threads)
+{
+    auto assign = [&](size_t begin, size_t end) {
+	bool changed = false;
+	for (size_t i = begin; i != end; ++i) {
+	    doccount j = indices[i];
+	    unsigned c = centroids.closest(points[j]);
+	    if (assignment[j] != c) {
+		assignment[j] = c;
+		changed = true;
+	    }
+	}
+	return changed;
+    };
+
+    size_t n_tasks = min(size_t(max(n_threads, 1u)),
+			 (n + MIN_POINTS_PER_TASK - 1) / MIN_POINTS_PER_TASK);
+    if (n_tasks <= 1)
+	return assign(0, n);
+
+    // Each task handles a contiguous range of points, and only writes to the
+    // entries in assignment for those points.
+    vector<char> changed(n_tasks);
+    vector<function<void()>> tasks;
+    tasks.reserve(n_tasks);
+    for (size_t t = 0; t != n_tasks; ++t) {
+	size_t begin = n * t / n_tasks;
+	size_t end = n * (t + 1) / n_tasks;
+	tasks.emplace_back([&, t, begin, end]() {
+	    changed[t] = assign(begin, end);
+	});
+    }
+    run_tasks(tasks, n_threads);
+    return find(changed.begin(), changed.end(), 1) != changed.end();
+}
+
 ClusterSet
 KMeans::cluster(const MSet& mset)
 {
@@ -85,51 +288,163 @@ KMeans::cluster(const MSet& mset)
     if (k >= size)
 	k = size;
     initialise_points(mset);
-    ClusterSet cset;
-    initialise_clusters(cset, size);
-    CosineDistance distance;
-    vector<Centroid> previous_centroids;
-    for (unsigned int i = 0; i < max_iters; ++i) {
-	// Assign each point to the cluster corresponding to its
-	// closest cluster centroid
-	cset.clear_clusters();
-	for (unsigned int j = 0; j < size; ++j) {
-	    double closest_cluster_distance = numeric_limits<double>::max();
-	    unsigned int closest_cluster = 0;
-	    for (unsigned int c = 0; c < k; ++c) {
-		const Centroid& centroid = cset[c].get_centroid();
-		double dist = distance.similarity(points[j], centroid);
-		if (closest_cluster_distance > dist) {
-		    closest_cluster_distance = dist;
-		    closest_cluster = c;
+
+    // Number the distinct terms and convert the points to sparse vectors so
+    // we don't need to look up terms by name while clustering.
+    unordered_map<string, size_t> term_numbers;
+    vector<string> terms;
+    vector<SparsePoint> sparse_points(size);
+    for (doccount j = 0; j < size; ++j) {
+	const Point& point = points[j];
+	SparsePoint& sparse_point = sparse_points[j];
+	sparse_point.weights.reserve(point.termlist_size());
+	for (TermIterator it = point.termlist_begin();
+	     it != point.termlist_end();
+	     ++it) {
+	    const string& term = *it;
+	    auto r = term_numbers.emplace(term, terms.size());
+	    if (r.second) terms.push_back(term);
+	    sparse_point.weights.emplace_back(r.first->second,
+					      point.get_weight(term));
+	}
+	// Sort by term number so we access the centroids in order.
+	sort(sparse_point.weights.begin(), sparse_point.weights.end());
+	sparse_point.magnitude = point.get_magnitude();
+    }
+
+    // Initial centroids are selected by picking points at roughly even
+    // intervals within the MSet. This is cheap and helps pick diverse
+    // elements since the MSet is usually sorted by some sort of key
+    Centroids centroids(k, terms.size());
+    for (unsigned c = 0; c < k; ++c) {
+	doccount x = (c * size) / k;
+	centroids.set(c, sparse_points[x]);
+    }
+
+    // The cluster each point is assigned to (k means none yet).
+    vector<unsigned> assignment(size, k);
+    vector<doccount> all_points(size);
+    iota(all_points.begin(), all_points.end(), 0);
+
+    if (batch_size == 0 || batch_size >= size) {
+	Centroids previous_centroids(k, terms.size());
+	vector<doccount> cluster_sizes(k);
+	for (unsigned int i = 0; i < max_iters; ++i) {
+	    // Assign each point to the cluster corresponding to its closest
+	    // cluster centroid.  If no points change cluster, the centroids
+	    // won't change either so we've converged.
+	    if (!assign_points(sparse_points, centroids, all_points.data(), size,
+			       assignment, threads))
+		break;
+
+	    // Remember the previous centroids.
+	    swap(centroids, previous_centroids);
+
+	    // Recalculate the centroids for current iteration.
+	    fill(cluster_sizes.begin(), cluster_sizes.end(), 0);
+	    for (unsigned c = 0; c < k; ++c) centroids.clear(c);
+	    for (doccount j = 0; j < size; ++j) {
+		unsigned c = assignment[j];
+		++cluster_sizes[c];
+		centroids.add(c, sparse_points[j], 1.0);
+	    }
+	    for (unsigned c = 0; c < k; ++c) {
+		if (cluster_sizes[c] == 0) {
+		    // Leave the centroid of an empty cluster where it was.
+		    centroids.copy(c, previous_centroids);
+		} else {
+		    centroids.multiply(c, 1.0 / cluster_sizes[c]);
+		    centroids.normalise(c);
 		}
 	    }
-	    cset.add_to_cluster(points[j], closest_cluster);
-	}
 
-	// Remember the previous centroids
-	previous_centroids.clear();
-	for (unsigned int j = 0; j < k; ++j)
-	    previous_centroids.push_back(cset[j].get_centroid());
-
-	// Recalculate the centroids for current iteration
-	cset.recalculate_centroids();
-
-	// Check whether centroids have converged
-	bool has_converged = true;
-	for (unsigned int j = 0; j < k; ++j) {
-	    const Centroid& centroid = cset[j].get_centroid();
-	    double dist = distance.similarity(previous_centroids[j], centroid);
-	    // If distance between any two centroids has changed by
-	    // more than the threshold, then KMeans hasn't converged
-	    if (dist > CONVERGENCE_THRESHOLD) {
-		has_converged = false;
+	    // Check whether centroids have converged.
+	    bool has_converged = true;
+	    for (unsigned c = 0; c < k; ++c) {
+		// If any centroid has moved more than the threshold, then
+		// KMeans hasn't converged.
+		if (centroids.distance(previous_centroids, c) >
+		    CONVERGENCE_THRESHOLD) {
+		    has_converged = false;
+		    break;
+		}
+	    }
+	    if (has_converged)
 		break;
+	}
+    } else {
+	// Mini-batch KMeans.  We use a fixed seed so the results are
+	// repeatable.
+	mt19937 rng(42);
+	vector<doccount> order(all_points);
+	// Number of points the centroid of each cluster has been moved
+	// towards so far.
+	vector<doccount> cluster_counts(k);
+	size_t pos = size;
+	bool changed = false;
+	for (unsigned int i = 0; i < max_iters; ++i) {
+	    if (pos == size) {
+		// Stop if a pass over all the points didn't change the closest
+		// centroid for any of them.
+		if (i > 0 && !changed)
+		    break;
+		shuffle(order.begin(), order.end(), rng);
+		pos = 0;
+		changed = false;
+	    }
+	    size_t n = min(size_t(batch_size), size - pos);
+	    const doccount* batch = order.data() + pos;
+	    pos += n;
+	    if (assign_points(sparse_points, centroids, batch, n, assignment,
+			      threads))
+		changed = true;
+
+	    // Move each centroid towards the points assigned to it.  The
+	    // learning rate for each point is 1 / the number of points the
+	    // centroid has been moved towards, so each centroid is the mean
+	    // of those points.
+	    for (size_t b = 0; b != n; ++b) {
+		doccount j = batch[b];
+		unsigned c = assignment[j];
+		doccount count = ++cluster_counts[c];
+		if (count == 1) {
+		    centroids.clear(c);
+		} else {
+		    centroids.multiply(c, double(count - 1) / count);
+		}
+		centroids.add(c, sparse_points[j], 1.0 / count);
+	    }
+	}
+
+	// Assign every point to the cluster with the closest centroid.
+	for (unsigned c = 0; c < k; ++c) centroids.normalise(c);
+	(void)assign_points(sparse_points, centroids, all_points.data(), size,
+			    assignment, threads);
+    }
+
+    // Build the ClusterSet.  The centroid of each cluster is the mean of its
+    // points, except for an empty cluster which keeps its last centroid.
+    ClusterSet result;
+    vector<Cluster> clusters(k);
+    for (doccount j = 0; j < size; ++j) {
+	clusters[assignment[j]].add_point(points[j]);
+    }
+    for (unsigned c = 0; c < k; ++c) {
+	Cluster& cluster = clusters[c];
+	if (cluster.size() == 0) {
+	    centroids.normalise(c);
+	    Centroid centroid;
+	    const double* r = centroids.row(c);
+	    for (size_t t = 0; t != terms.size(); ++t) {
+		if (r[t] != 0.0) centroid.add_weight(terms[t], r[t]);
 	    }
+	    // Calculate the magnitude.
+	    centroid.divide(1.0);
+	    cluster.set_centroid(centroid);
+	} else {
+	    cluster.recalculate();
 	}
-	// If converged, then break from the loop
-	if (has_converged)
-	    break;
+	result.add_cluster(cluster);
     }
-    return cset;
+    return result;
 }
@@ -30,6 +30,7 @@ noinst_HEADERS +=\
 	common/realtime.h\
 	common/replicate_utils.h\
 	common/replicationprotocol.h\
+	common/runtasks.h\
 	common/safedirent.h\
 	common/safefcntl.h\
 	common/safenetdb.h\
@@ -46,7 +47,8 @@ noinst_HEADERS +=\
 	common/socket_utils.h\
 	common/str.h\
 	common/stringutils.h\
-	common/wordaccess.h
+	common/wordaccess.h\
+	common/wordpairs.h
 
 EXTRA_DIST +=\
 	common/Makefile\
@@ -1,5 +1,5 @@
 /** @file
- * @brief class wrapper around zlib
+ * @brief class wrapper around zlib, zstd and LZ4
  */
 /* Copyright (C) 2007,2009,2012,2013,2014,2016,2019 Olly Betts
  * Copyright (C) 2009 Richard Boulton
@@ -24,13 +24,136 @@
 #include "compression_stream.h"
 
 #include "omassert.h"
+#include "pack.h"
 #include "str.h"
 #include "stringutils.h"
 
 #include "xapian/error.h"
 
+#include <climits>
+#include <cstring>
+
+#ifdef HAVE_ZSTD
+# include <zdict.h>
+#endif
+#ifdef HAVE_LZ4
+# include <lz4.h>
+#endif
+
 using namespace std;
 
+/** The zstd compression level to use.
+ *
+ *  This is zstd's default, which compresses better than zlib does at its
+ *  default level while being rather faster.
+ */
+#define ZSTD_LEVEL 3
+
+bool
+compression_method_supported(compression_method method)
+{
+    switch (method) {
+	case COMPRESSION_ZLIB:
+	    return true;
+	case COMPRESSION_ZSTD:
+#ifdef HAVE_ZSTD
+	    return true;
+#else
+	    return false;
+#endif
+	case COMPRESSION_LZ4:
+#ifdef HAVE_LZ4
+	    return true;
+#else
+	    return false;
+#endif
+    }
+    return false;
+}
+
+const char*
+compression_method_name(compression_method method)
+{
+    switch (method) {
+	case COMPRESSION_ZLIB:
+	    return "zlib";
+	case COMPRESSION_ZSTD:
+	    return "zstd";
+	case COMPRESSION_LZ4:
+	    return "LZ4";
+    }
+    return "unknown";
+}
+
+[[noreturn]]
+static void
+throw_unsupported(compression_method method)
+{
+    string msg = compression_method_name(method);
+    msg += " compression support not enabled";
+    throw Xapian::FeatureUnavailableError(msg);
+}
+
+void
+CompressionDictionary::clear()
+{
+#ifdef HAVE_ZSTD
+    ZSTD_freeCDict(cdict);
+    cdict = nullptr;
+    ZSTD_freeDDict(ddict);
+    ddict = nullptr;
+#endif
+    data.resize(0);
+}
+
+void
+CompressionDictionary::set(string&& data_, bool for_compression)
+{
+    clear();
+    if (data_.empty()) return;
+#ifdef HAVE_ZSTD
+    if (for_compression) {
+	cdict = ZSTD_createCDict(data_.data(), data_.size(), ZSTD_LEVEL);
+	if (!cdict) throw std::bad_alloc();
+    }
+    ddict = ZSTD_createDDict(data_.data(), data_.size());
+    if (!ddict) throw std::bad_alloc();
+#else
+    // Trying to use the dictionary will fail as zstd isn't supported, but
+    // that shouldn't stop us opening a database with a table which has one.
+    (void)for_compression;
+#endif
+    data = std::move(data_);
+}
+
+string
+CompressionDictionary::train(const vector<string>& samples, size_t max_size)
+{
+#ifdef HAVE_ZSTD
+    string all;
+    vector<size_t> sizes;
+    sizes.reserve(samples.size());
+    for (auto&& sample : samples) {
+	all += sample;
+	sizes.push_back(sample.size());
+    }
+    string result(max_size, '\0');
+    size_t r = ZDICT_trainFromBuffer(&result[0], max_size,
+				     all.data(), sizes.data(),
+				     unsigned(sizes.size()));
+    if (ZDICT_isError(r)) {
+	// Most likely there wasn't enough sample data.
+	return string();
+    }
+    result.resize(r);
+    return result;
+#else
+    (void)samples;
+    (void)max_size;
+    return string();
+#endif
+}
+
 CompressionStream::~CompressionStream() {
     if (deflate_zstream) {
 	// Errors which we care about have already been handled, so just ignore
@@ -46,19 +169,30 @@ CompressionStream::~CompressionStream() {
 	delete inflate_zstream;
     }
 
+#ifdef HAVE_ZSTD
+    ZSTD_freeCCtx(zstd_cctx);
+    ZSTD_freeDCtx(zstd_dctx);
+#endif
+
     delete [] out;
 }
 
-const char*
-CompressionStream::compress(const char* buf, size_t* p_size) {
-    lazy_alloc_deflate_zstream();
-    size_t size = *p_size;
+void
+CompressionStream::reserve_out(size_t size)
+{
     if (!out || out_len < size) {
 	out_len = size;
 	delete [] out;
 	out = NULL;
 	out = new char[size];
     }
+}
+
+const char*
+CompressionStream::compress(const char* buf, size_t* p_size) {
+    lazy_alloc_deflate_zstream();
+    size_t size = *p_size;
+    reserve_out(size);
     deflate_zstream->avail_in = static_cast<uInt>(size);
     deflate_zstream->next_in = reinterpret_cast<const Bytef*>(buf);
     deflate_zstream->next_out = reinterpret_cast<Bytef*>(out);
@@ -82,6 +216,64 @@ CompressionStream::compress(const char* buf, size_t* p_size) {
     return out;
 }
 
+const char*
+CompressionStream::compress(compression_method method,
+			    const CompressionDictionary* dict,
+			    const char* buf, size_t* p_size)
+{
+    switch (method) {
+	case COMPRESSION_ZLIB:
+	    return compress(buf, p_size);
+	case COMPRESSION_ZSTD: {
+#ifdef HAVE_ZSTD
+	    if (!zstd_cctx) {
+		zstd_cctx = ZSTD_createCCtx();
+		if (!zstd_cctx) throw std::bad_alloc();
+	    }
+	    size_t size = *p_size;
+	    reserve_out(size);
+	    (void)ZSTD_CCtx_reset(zstd_cctx, ZSTD_reset_session_and_parameters);
+	    (void)ZSTD_CCtx_setParameter(zstd_cctx, ZSTD_c_compressionLevel,
+					 ZSTD_LEVEL);
+	    // We know which dictionary a table uses, so don't spend bytes
+	    // recording its id in every tag.
+	    (void)ZSTD_CCtx_setParameter(zstd_cctx, ZSTD_c_dictIDFlag, 0);
+	    if (dict && dict->cdict)
+		(void)ZSTD_CCtx_refCDict(zstd_cctx, dict->cdict);
+	    // As with zlib, limiting the output buffer to the input size means
+	    // zstd will give up if the data doesn't compress.
+	    size_t r = ZSTD_compress2(zstd_cctx, out, size, buf, size);
+	    if (ZSTD_isError(r) || r >= size) return NULL;
+	    *p_size = r;
+	    return out;
+#else
+	    break;
+#endif
+	}
+	case COMPRESSION_LZ4: {
+#ifdef HAVE_LZ4
+	    size_t size = *p_size;
+	    if (size > size_t(LZ4_MAX_INPUT_SIZE)) return NULL;
+	    string header;
+	    pack_uint(header, size);
+	    if (header.size() >= size) return NULL;
+	    reserve_out(size);
+	    int room = int(size - header.size());
+	    int r = LZ4_compress_default(buf, out + header.size(),
+					 int(size), room);
+	    if (r <= 0 || size_t(r) >= size_t(room)) return NULL;
+	    memcpy(out, header.data(), header.size());
+	    *p_size = header.size() + r;
+	    return out;
+#else
+	    break;
+#endif
+	}
+    }
+    (void)dict;
+    throw_unsupported(method);
+}
+
 bool
 CompressionStream::decompress_chunk(const char* p, int len, string& buf)
 {
@@ -112,6 +304,89 @@ CompressionStream::decompress_chunk(const char* p, int len, string& buf)
     }
 }
 
+void
+CompressionStream::decompress(compression_method method,
+			      const CompressionDictionary* dict,
+			      const char* p, size_t len, string& buf)
+{
+    switch (method) {
+	case COMPRESSION_ZLIB:
+	    decompress_start();
+	    buf.resize(0);
+	    if (!decompress_chunk(p, int(len), buf)) {
+		throw Xapian::DatabaseCorruptError("Compressed tag truncated");
+	    }
+	    return;
+	case COMPRESSION_ZSTD: {
+#ifdef HAVE_ZSTD
+	    unsigned long long size = ZSTD_getFrameContentSize(p, len);
+	    // Each block in a zstd frame has a 3 byte header and decompresses
+	    // to at most 128KB, so a larger content size means the frame is
+	    // corrupt - check before we try to allocate that much.
+	    if (size == ZSTD_CONTENTSIZE_UNKNOWN ||
+		size == ZSTD_CONTENTSIZE_ERROR ||
+		size > (len / 3 + 1) * (128ull * 1024)) {
+		throw Xapian::DatabaseCorruptError("Bad zstd compressed tag");
+	    }
+	    if (!zstd_dctx) {
+		zstd_dctx = ZSTD_createDCtx();
+		if (!zstd_dctx) throw std::bad_alloc();
+	    }
+	    buf.resize(size);
+	    size_t r;
+	    if (dict && dict->ddict) {
+		r = ZSTD_decompress_usingDDict(zstd_dctx, &buf[0], size,
+					       p, len, dict->ddict);
+	    } else {
+		r = ZSTD_decompressDCtx(zstd_dctx, &buf[0], size, p, len);
+	    }
+	    if (ZSTD_isError(r) || r != size) {
+		string msg = "zstd decompression failed";
+		if (ZSTD_isError(r)) {
+		    msg += " (";
+		    msg += ZSTD_getErrorName(r);
+		    msg += ')';
+		}
+		throw Xapian::DatabaseCorruptError(msg);
+	    }
+	    return;
+#else
+	    break;
+#endif
+	}
+	case COMPRESSION_LZ4: {
+#ifdef HAVE_LZ4
+	    const char* end = p + len;
+	    size_t size;
+	    // LZ4 can't compress by more than a factor of 255, so a larger
+	    // size means the tag is corrupt.
+	    if (!unpack_uint(&p, end, &size) ||
+		size > size_t(LZ4_MAX_INPUT_SIZE) ||
+		size / 255 > size_t(end - p)) {
+		throw Xapian::DatabaseCorruptError("Bad LZ4 compressed tag");
+	    }
+	    buf.resize(size);
+	    int r = LZ4_decompress_safe(p, &buf[0], int(end - p), int(size));
+	    if (r < 0 || size_t(r) != size) {
+		throw Xapian::DatabaseCorruptError("LZ4 decompression failed");
+	    }
+	    return;
+#else
+	    break;
+#endif
+	}
+    }
+    (void)dict;
+    throw_unsupported(method);
+}
+
+CompressionStream&
+CompressionStream::get_thread_local()
+{
+    static thread_local CompressionStream stream;
+    return stream;
+}
+
 void
 CompressionStream::lazy_alloc_deflate_zstream() {
     if (usual(deflate_zstream)) {
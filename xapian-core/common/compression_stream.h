@@ -1,5 +1,5 @@
 /** @file
- * @brief class wrapper around zlib
+ * @brief class wrapper around zlib, zstd and LZ4
  */
 /* Copyright (C) 2012 Dan Colish
  * Copyright (C) 2012,2013,2014,2016 Olly Betts
@@ -24,8 +24,86 @@
 
 #include "internaltypes.h"
 #include <string>
+#include <vector>
 #include <zlib.h>
 
+#ifdef HAVE_ZSTD
+# include <zstd.h>
+#endif
+
+/// Methods which can be used to compress tags.
+enum compression_method {
+    /// Raw deflate using zlib.
+    COMPRESSION_ZLIB = 0,
+    /// A zstd frame, optionally using a dictionary.
+    COMPRESSION_ZSTD = 1,
+    /// An LZ4 block, preceded by the pack_uint() encoded uncompressed size.
+    COMPRESSION_LZ4 = 2
+};
+
+/// Is support for compression method @a method compiled in?
+bool compression_method_supported(compression_method method);
+
+/// Return a name for compression method @a method.
+const char* compression_method_name(compression_method method);
+
+/** A dictionary to prime compression with.
+ *
+ *  Only zstd currently uses a dictionary.  The digested forms are built when
+ *  the dictionary is set, so a CompressionDictionary can be shared between
+ *  CompressionStream objects in different threads.
+ */
+class CompressionDictionary {
+    /// The serialised dictionary (empty if none).
+    std::string data;
+
+#ifdef HAVE_ZSTD
+    ZSTD_CDict* cdict = nullptr;
+
+    ZSTD_DDict* ddict = nullptr;
+#endif
+
+    friend class CompressionStream;
+
+    /// Don't allow assignment.
+    CompressionDictionary& operator=(const CompressionDictionary&) = delete;
+
+    /// Don't allow copying.
+    CompressionDictionary(const CompressionDictionary&) = delete;
+
+  public:
+    CompressionDictionary() { }
+
+    ~CompressionDictionary() { clear(); }
+
+    bool empty() const { return data.empty(); }
+
+    const std::string& get_data() const { return data; }
+
+    /// Remove any dictionary.
+    void clear();
+
+    /** Set the dictionary.
+     *
+     *  @param data_		The serialised dictionary.
+     *  @param for_compression	Whether to prepare to compress with it
+     *				(we always prepare to decompress).
+     */
+    void set(std::string&& data_, bool for_compression);
+
+    /** Train a dictionary from example tags.
+     *
+     *  @param samples	The example tags.
+     *  @param max_size	The maximum size of dictionary to build.
+     *
+     *  @return The serialised dictionary, or an empty string if there isn't
+     *		enough data to train a dictionary from (or dictionaries aren't
+     *		supported).
+     */
+    static std::string train(const std::vector<std::string>& samples,
+			     size_t max_size);
+};
+
 class CompressionStream {
     int compress_strategy;
 
@@ -45,6 +123,17 @@ class CompressionStream {
     /// Allocate the zstream for inflating, if not already allocated.
     void lazy_alloc_inflate_zstream();
 
+#ifdef HAVE_ZSTD
+    /// zstd state object for compressing.
+    ZSTD_CCtx* zstd_cctx = nullptr;
+
+    /// zstd state object for decompressing.
+    ZSTD_DCtx* zstd_dctx = nullptr;
+#endif
+
+    /// Ensure the output buffer can hold at least @a size bytes.
+    void reserve_out(size_t size);
+
   public:
     /* Create a new CompressionStream object.
      *
@@ -59,10 +148,46 @@ class CompressionStream {
 
     const char* compress(const char* buf, size_t* p_size);
 
+    /** Compress using a particular method.
+     *
+     *  @param method	The compression method to use.
+     *  @param dict	Dictionary to use (NULL or empty for none).
+     *  @param buf	The data to compress.
+     *  @param p_size	Pointer to the size of the data, which is updated to
+     *			the compressed size on success.
+     *
+     *  @return Pointer to the compressed data (valid until the next call), or
+     *		NULL if the data didn't get smaller.
+     */
+    const char* compress(compression_method method,
+			 const CompressionDictionary* dict,
+			 const char* buf, size_t* p_size);
+
     void decompress_start() { lazy_alloc_inflate_zstream(); }
 
     /** Returns true if this was the final chunk. */
     bool decompress_chunk(const char* p, int len, std::string& buf);
+
+    /** Decompress a whole tag.
+     *
+     *  @param method	The compression method used.
+     *  @param dict	Dictionary used (NULL or empty for none).
+     *  @param p	The compressed data.
+     *  @param len	The length of the compressed data.
+     *  @param buf	String to put the decompressed data in (any existing
+     *			contents are replaced).
+     */
+    void decompress(compression_method method,
+		    const CompressionDictionary* dict,
+		    const char* p, size_t len, std::string& buf);
+
+    /** Return a CompressionStream for the current thread.
+     *
+     *  This allows decompression to reuse the same state objects rather than
+     *  setting up new ones each time.  The object returned shouldn't be used
+     *  for anything which needs to keep state between calls.
+     */
+    static CompressionStream& get_thread_local();
 };
 
 #endif // XAPIAN_INCLUDED_COMPRESSION_STREAM_H
@@ -40,6 +40,11 @@
 # include "safewindows.h"
 #endif
 
+#ifdef HAVE_MMAP
+# include <sys/mman.h>
+# include "safesysstat.h"
+#endif
+
 // Trying to include the correct headers with the correct defines set to
 // get pread() and pwrite() prototyped on every platform without breaking any
 // other platform is a real can of worms.  So instead we probe for what
@@ -417,6 +422,29 @@ throw_block_error(const char * s, off_t b, int e = 0)
     throw Xapian::DatabaseError(m, e);
 }
 
+#ifdef HAVE_MMAP
+const char*
+io_mmap_rd(int fd, size_t& size)
+{
+    struct stat statbuf;
+    if (fstat(fd, &statbuf) < 0 || statbuf.st_size <= 0 ||
+	(sizeof(off_t) > sizeof(size_t) &&
+	 statbuf.st_size > off_t(std::numeric_limits<size_t>::max()))) {
+	return NULL;
+    }
+    size = size_t(statbuf.st_size);
+    void* p = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) return NULL;
+    return static_cast<const char*>(p);
+}
+
+void
+io_munmap(const char* p, size_t size)
+{
+    (void)munmap(const_cast<char*>(p), size);
+}
+#endif
+
 #ifdef HAVE_POSIX_FADVISE
 bool
 io_readahead_block(int fd, size_t n, off_t b, off_t o)
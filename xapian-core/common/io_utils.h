@@ -190,6 +190,23 @@ bool io_readahead_block(int fd, size_t n, off_t b, off_t o = 0);
 inline bool io_readahead_block(int, size_t, off_t, off_t = 0) { return false; }
 #endif
 
+/** Map the current contents of file descriptor fd into memory read-only.
+ *
+ *  On success, returns a pointer to the mapping and sets size to its length
+ *  (the size of the file).  Returns NULL if the file is empty, mapping isn't
+ *  supported, or it fails - callers should fall back to reading.
+ */
+#ifdef HAVE_MMAP
+const char* io_mmap_rd(int fd, size_t& size);
+
+/// Unmap a mapping returned by io_mmap_rd().
+void io_munmap(const char* p, size_t size);
+#else
+inline const char* io_mmap_rd(int, size_t&) { return NULL; }
+
+inline void io_munmap(const char*, size_t) { }
+#endif
+
 /// Read block b size n bytes into buffer p from file descriptor fd, offset o.
 void io_read_block(int fd, char * p, size_t n, off_t b, off_t o = 0);
 
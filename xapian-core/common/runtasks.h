@@ -0,0 +1,81 @@
+/** @file
+ * @brief Run a list of tasks using several threads
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef XAPIAN_INCLUDED_RUNTASKS_H
+#define XAPIAN_INCLUDED_RUNTASKS_H
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+/** Run tasks using up to @a n_threads threads.
+ *
+ *  The calling thread is one of the threads used, and tasks are started in
+ *  the order they appear in @a tasks (so put the longest running tasks
+ *  first).  Failing to create a thread isn't fatal - we just end up using
+ *  fewer threads.
+ *
+ *  If any tasks throw an exception, the other tasks are still run, and then
+ *  the exception from the first such task in @a tasks is rethrown.
+ */
+inline void
+run_tasks(const std::vector<std::function<void()>>& tasks, unsigned n_threads)
+{
+    std::vector<std::exception_ptr> errors(tasks.size());
+    std::atomic<size_t> next_task{0};
+    auto worker = [&]() {
+	size_t i;
+	while ((i = next_task++) < tasks.size()) {
+	    try {
+		tasks[i]();
+	    } catch (...) {
+		errors[i] = std::current_exception();
+	    }
+	}
+    };
+
+    if (n_threads > tasks.size())
+	n_threads = tasks.size();
+    std::vector<std::thread> threads;
+    if (n_threads > 1) {
+	threads.reserve(n_threads - 1);
+	try {
+	    while (threads.size() != n_threads - 1) {
+		threads.emplace_back(worker);
+	    }
+	} catch (const std::system_error&) {
+	    // Failing to create a thread isn't fatal.
+	}
+    }
+    worker();
+    for (auto&& t : threads) {
+	t.join();
+    }
+
+    for (auto&& error : errors) {
+	if (error)
+	    std::rethrow_exception(error);
+    }
+}
+
+#endif // XAPIAN_INCLUDED_RUNTASKS_H
@@ -0,0 +1,62 @@
+/** @file
+ * @brief Terms indexing pairs of adjacent words
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef XAPIAN_INCLUDED_WORDPAIRS_H
+#define XAPIAN_INCLUDED_WORDPAIRS_H
+
+#include <string>
+#include <string_view>
+
+/* TermGenerator::FLAG_WORD_PAIRS indexes each pair of terms at adjacent
+ * positions as a term without positional information (a "word pair term").
+ * Every document indexed this way also gets WORD_PAIR_MARKER with wdf 0, so
+ * if all the documents in a shard have this term, every exact phrase which
+ * matches a document in it has all its word pair terms in that document.
+ */
+
+/// The term each document with word pair terms is indexed by.
+#define WORD_PAIR_MARKER std::string("Z\0", 2)
+
+/** Word pair terms longer than this aren't indexed.
+ *
+ *  This is the longest term glass supports.
+ */
+constexpr size_t WORD_PAIR_MAX_LENGTH = 245;
+
+/** Build the word pair term for @a first followed by @a second.
+ *
+ *  @return false if the term would be too long to index (in which case
+ *	    @a result is left unchanged).
+ */
+inline bool
+make_word_pair(std::string& result,
+	       std::string_view first,
+	       std::string_view second)
+{
+    if (first.size() + second.size() + 3 > WORD_PAIR_MAX_LENGTH)
+	return false;
+    result = WORD_PAIR_MARKER;
+    result += first;
+    result += '\0';
+    result += second;
+    return true;
+}
+
+#endif // XAPIAN_INCLUDED_WORDPAIRS_H
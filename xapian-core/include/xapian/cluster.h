@@ -603,18 +603,15 @@ class XAPIAN_VISIBILITY_DEFAULT KMeans : public Clusterer {
     /// Specifies the maximum number of iterations that KMeans will have
     unsigned int max_iters;
 
+    /// Maximum number of threads to use.
+    unsigned threads = 0;
+
+    /// Number of points in each mini-batch (0 means use all the points).
+    Xapian::doccount batch_size = 0;
+
     /// Pointer to stopper object for identifying stopwords
     Xapian::Internal::opt_intrusive_ptr<const Xapian::Stopper> stopper;
 
-    /** Initialise 'k' clusters by selecting 'k' centroids and assigning
-     *  them to different clusters
-     *
-     *  @param cset		ClusterSet object to be initialised by assigning
-     *				centroids to each cluster
-     *  @param num_of_points	Number of points passed to clusterer
-     */
-    void initialise_clusters(ClusterSet &cset, Xapian::doccount num_of_points);
-
     /** Initialise the Points to be fed into the Clusterer with the MSet object
      *  'source'. The TF-IDF weights for the documents are calculated and stored
      *  within the Points to be used later during distance calculations
@@ -650,6 +647,54 @@ class XAPIAN_VISIBILITY_DEFAULT KMeans : public Clusterer {
      */
     void set_stopper(const Xapian::Stopper* stop = NULL) { stopper = stop; }
 
+    /** Set the maximum number of threads to use.
+     *
+     *  With more than one thread, the points are divided between the threads
+     *  to find the closest centroid to each.  The clusters found don't depend
+     *  on the number of threads.
+     *
+     *  @param n_threads	Maximum number of threads to use (including the
+     *			calling thread).  0 is treated the same as 1, which
+     *			means not to use any extra threads (this is the
+     *			default).
+     *
+     *  @since Added in Xapian 2.0.0.
+     */
+    void set_threads(unsigned n_threads) { threads = n_threads; }
+
+    /** Get the maximum number of threads to use.
+     *
+     *  @since Added in Xapian 2.0.0.
+     */
+    unsigned get_threads() const { return threads; }
+
+    /** Use mini-batch KMeans.
+     *
+     *  Instead of assigning every point to a cluster on each iteration, each
+     *  iteration picks @a batch_size_ points and moves the centroids of their
+     *  closest clusters towards them, using a learning rate for each cluster
+     *  which decreases as more points are assigned to it (Sculley, "Web-scale
+     *  k-means clustering", 2010).  Every point is then assigned to the
+     *  cluster with the closest centroid at the end.
+     *
+     *  This is much faster for large MSets, at the cost of somewhat worse
+     *  clusters.  The points in each batch are picked in a pseudo-random
+     *  order, which is the same for every call to cluster(), so the results
+     *  are repeatable.  Clustering stops when a pass over every point doesn't
+     *  change which cluster any of them is closest to, or after the maximum
+     *  number of iterations.
+     *
+     *  @param batch_size_	Number of points in each mini-batch.  0 (the
+     *				default) means to assign every point on each
+     *				iteration (standard KMeans), as does a value
+     *				which is at least the number of points.
+     *
+     *  @since Added in Xapian 2.0.0.
+     */
+    void set_batch_size(Xapian::doccount batch_size_) {
+	batch_size = batch_size_;
+    }
+
     /// Return a string describing this object
     std::string get_description() const override;
 };
@@ -37,6 +37,9 @@ class Database;
 /** Compact a database, or merge and compact several.
  */
 class XAPIAN_VISIBILITY_DEFAULT Compactor {
+    /// Maximum number of threads to use.
+    unsigned threads = 0;
+
   public:
     /** Compaction level. */
     typedef enum {
@@ -56,6 +59,37 @@ class XAPIAN_VISIBILITY_DEFAULT Compactor {
 
     virtual ~Compactor();
 
+    /** Set the maximum number of threads to use.
+     *
+     *  With more than one thread, tables are compacted concurrently, and
+     *  the postlist table is split into ranges of terms which are merged
+     *  concurrently (unless merging in multiple passes).  The ranges are
+     *  then joined to give the same output as compacting with one thread.
+     *
+     *  Compacting to a single file database always uses one thread.
+     *
+     *  If you use more than one thread then set_status() and
+     *  resolve_duplicate_metadata() may be called from a thread other than
+     *  the one which called compact(), though only one call to each will
+     *  happen at once.  The status of each table is reported as soon as it
+     *  is finished, so the order tables are reported in may differ from
+     *  when using one thread.
+     *
+     *  @param n_threads	Maximum number of threads to use (including the
+     *			calling thread).  0 is treated the same as 1, which
+     *			means not to use any extra threads (this is the
+     *			default).
+     *
+     *  @since Added in Xapian 2.0.0.
+     */
+    void set_threads(unsigned n_threads) { threads = n_threads; }
+
+    /** Get the maximum number of threads to use.
+     *
+     *  @since Added in Xapian 2.0.0.
+     */
+    unsigned get_threads() const { return threads; }
+
     /** Update progress.
      *
      *  Subclass this method if you want to get progress updates during
@@ -143,6 +143,30 @@ const int DB_NO_TERMLIST	 = 0x20;
  */
 const int DB_RETRY_LOCK		 = 0x40;
 
+/** When opening a Database, memory map the files to read from them.
+ *
+ *  For backends which support it (currently glass and honey), this means
+ *  that B-tree blocks and table data are used directly from a read-only
+ *  shared mapping of each file rather than being copied into buffers for
+ *  each cursor.  This avoids the copy and means that cursors in the same
+ *  process share one copy of hot blocks, but it can be slower for databases
+ *  which don't fit in memory.
+ *
+ *  With glass, data added to a file after it was mapped (e.g. by a
+ *  concurrent writer) is read in the usual way until the database is
+ *  reopened.  A glass database being modified in place by a concurrent
+ *  writer can still overwrite blocks from older revisions while they're
+ *  being used - this is reported as Xapian::DatabaseModifiedError where
+ *  detected, as usual, but it is safest to only use this flag with glass
+ *  databases which aren't updated while being searched, or are updated by
+ *  replacing them.
+ *
+ *  This flag is ignored when opening a WritableDatabase.
+ *
+ *  @since Added in Xapian 2.0.0.
+ */
+const int DB_MMAP		 = 0x80;
+
 /** Use the glass backend.
  *
  *  When opening a WritableDatabase, this means create a glass database if a
@@ -196,6 +220,34 @@ const int DB_BACKEND_INMEMORY	 = 0x400;
  */
 const int DB_BACKEND_HONEY	 = 0x500;
 
+/** Use the tiered backend.
+ *
+ *  A tiered database is a directory containing a small writable glass
+ *  database (the "head") and read-only honey segments.  Changes are written
+ *  to the head, and once it contains enough documents it is frozen into a
+ *  segment and a new head is started.  Frozen heads are converted to honey
+ *  and segments of a similar size are merged in a background thread.
+ *  Replacing or deleting a document which is in a segment hides the old
+ *  copy, so the database presents a single consistent view.
+ *
+ *  When opening a WritableDatabase, this means create a tiered database if
+ *  a new database is created.  If there's an existing database (of any
+ *  type) at the specified path, this flag has no effect.
+ *
+ *  When opening a Database, this flag means to only open it if it's a
+ *  tiered database.
+ *
+ *  The number of documents in the head before it is frozen can be set with
+ *  the environment variable XAPIAN_TIERED_FREEZE_THRESHOLD (default
+ *  100000), and the number of segments of a similar size which are merged
+ *  with XAPIAN_TIERED_MERGE_FACTOR (default 4).
+ *
+ *  Requires both the glass and honey backends.
+ *
+ *  @since Added in Xapian 2.0.0.
+ */
+const int DB_BACKEND_TIERED	 = 0x600;
+
 #ifdef XAPIAN_LIB_BUILD
 /** @internal Bit mask for backend codes. */
 const int DB_BACKEND_MASK_	 = 0x700;
@@ -262,6 +314,64 @@ const int DBCOMPACT_MULTIPASS = 8;
  */
 const int DBCOMPACT_SINGLE_FILE = 16;
 
+/** Build an index of the terms to speed up wildcards with a leading wildcard.
+ *
+ *  This allows patterns such as `*ation` or `*net*` to find matching terms
+ *  without scanning every term in the database.  The index is stored in the
+ *  postlist table, so it makes the database larger.
+ *
+ *  If all the inputs already have such an index then the output will too,
+ *  even if this flag isn't specified.  Glass databases with an index keep it
+ *  up to date as they are modified.
+ *
+ *  Supported by the glass and honey backends.
+ */
+const int DBCOMPACT_WILDCARD_INDEX = 32;
+
+/** Build bloom filters over the keys in tables.
+ *
+ *  A bloom filter is built for the tables where lookups of keys which aren't
+ *  present are common (currently the postlist, spelling and synonym tables).
+ *  Each is loaded into memory when the database is opened, and allows most
+ *  lookups of keys which aren't present to be answered without reading the
+ *  table - for example, get_termfreq() for a term which isn't indexed.  This
+ *  is particularly useful for sharded databases where most query terms are
+ *  absent from most shards.
+ *
+ *  The filters use about 10 bits per key in those tables.
+ *
+ *  Supported by the honey backend.
+ */
+const int DBCOMPACT_BLOOM_FILTER = 64;
+
+/** Compress tags in tables with zstd instead of zlib.
+ *
+ *  zstd compresses better than zlib and decompresses much faster.  The
+ *  document data is compressed using a dictionary trained from a sample of
+ *  the input documents and stored in the database, which gives much better
+ *  compression for short document data.
+ *
+ *  If combined with DBCOMPACT_LZ4 then zstd is only used for the document
+ *  data.
+ *
+ *  Supported by the honey backend, if Xapian was built with zstd support
+ *  (otherwise Xapian::FeatureUnavailableError is thrown).
+ */
+const int DBCOMPACT_ZSTD = 128;
+
+/** Compress tags in tables with LZ4 instead of zlib.
+ *
+ *  LZ4 doesn't compress as well as zlib but decompresses very much faster,
+ *  so is a good choice for tables which are read a lot when searching.
+ *
+ *  If combined with DBCOMPACT_ZSTD then LZ4 is used for all the tables
+ *  except the document data.
+ *
+ *  Supported by the honey backend, if Xapian was built with LZ4 support
+ *  (otherwise Xapian::FeatureUnavailableError is thrown).
+ */
+const int DBCOMPACT_LZ4 = 2048;
+
 /** Assume document id is valid.
  *
  *  By default, Database::get_document() checks that the document id passed is
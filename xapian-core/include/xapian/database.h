@@ -491,6 +491,27 @@ class XAPIAN_VISIBILITY_DEFAULT Database {
     std::string get_spelling_suggestion(std::string_view word,
 					unsigned max_edit_distance = 2) const;
 
+    /** Suggest spelling corrections for several words.
+     *
+     *  This gives the same results as calling get_spelling_suggestion() for
+     *  each word, but is more efficient - in particular the frequencies of
+     *  the candidate corrections for all the words are looked up together.
+     *
+     *  @param words			The potentially misspelled words.
+     *  @param max_edit_distance	Only consider words which are at most
+     *					@a max_edit_distance edits from the
+     *					word being corrected (default is 2).
+     *
+     *  @return A vector with an entry for each entry in @a words, which
+     *		is the suggested correction, or an empty string if there
+     *		isn't one.
+     *
+     *  @since Added in Xapian 2.0.0.
+     */
+    std::vector<std::string>
+    get_spelling_suggestions(const std::vector<std::string>& words,
+			     unsigned max_edit_distance = 2) const;
+
     /** An iterator which returns all the spelling correction targets.
      *
      *  This returns all the words which are considered as targets for the
@@ -686,6 +707,36 @@ class XAPIAN_VISIBILITY_DEFAULT Database {
 	return check_(NULL, fd, opts, out);
     }
 
+    /** Set the capacity of the process-wide block cache.
+     *
+     *  Blocks read from glass databases opened read-only are shared via this
+     *  cache between all Database objects in the process open on the same
+     *  files, which reduces the number of reads and the memory used when
+     *  many threads each search their own Database object on the same
+     *  database.
+     *
+     *  The initial capacity is taken from the environment variable
+     *  XAPIAN_BLOCK_CACHE_SIZE if set, and otherwise is 0.
+     *
+     *  @param size	Capacity in bytes.  0 disables the cache and discards
+     *			any cached blocks.
+     *
+     *  @since Added in Xapian 2.0.0.
+     */
+    static void set_block_cache_size(size_t size);
+
+    /** Get statistics for the process-wide block cache.
+     *
+     *  @param[out] hits	Set to the number of block lookups which were
+     *				found in the cache.
+     *  @param[out] misses	Set to the number of block lookups which had to
+     *				read the block.
+     *
+     *  @since Added in Xapian 2.0.0.
+     */
+    static void get_block_cache_stats(unsigned long long& hits,
+				      unsigned long long& misses);
+
     /** Produce a compact version of this database.
      *
      *  @param output	Path to write the compact version to.  This can be the
@@ -711,6 +762,20 @@ class XAPIAN_VISIBILITY_DEFAULT Database {
      *   - Xapian::DBCOMPACT_SINGLE_FILE
      *		Produce a single-file database (only supported for glass
      *		currently).
+     *   - Xapian::DBCOMPACT_WILDCARD_INDEX
+     *		Build an index of the terms which speeds up expanding wildcard
+     *		patterns which start with a wildcard (e.g. `*ation`).
+     *   - Xapian::DBCOMPACT_BLOOM_FILTER
+     *		Build bloom filters so lookups of terms which aren't present
+     *		can usually be answered without reading the database (only
+     *		supported for honey).
+     *   - Xapian::DBCOMPACT_ZSTD
+     *		Compress tags with zstd instead of zlib, using a trained
+     *		dictionary for the document data (only supported for honey).
+     *   - Xapian::DBCOMPACT_LZ4
+     *		Compress tags with LZ4 instead of zlib (only supported for
+     *		honey).  If combined with DBCOMPACT_ZSTD, zstd is used for the
+     *		document data and LZ4 for the other tables.
      *   - At most one of:
      *     - Xapian::Compactor::STANDARD - Don't split items unnecessarily.
      *     - Xapian::Compactor::FULL     - Split items whenever it saves space
@@ -1113,12 +1178,38 @@ class XAPIAN_VISIBILITY_DEFAULT WritableDatabase : public Database {
      *  conservative, and if you have a machine with plenty of memory,
      *  you can improve indexing throughput dramatically by setting
      *  XAPIAN_FLUSH_THRESHOLD in the environment to a larger value.
+     *  Batched modifications can also be committed based on the memory they
+     *  use - see set_flush_memory_limit().
      *
      *  @since This method was new in Xapian 1.1.0 - in earlier versions it
      *	       was called flush().
      */
     void commit();
 
+    /** Set a memory limit for batched modifications.
+     *
+     *  When the approximate amount of memory used to hold batched
+     *  modifications reaches this limit they are automatically committed
+     *  (or, if a transaction is active, written out to the tables without
+     *  committing), as if the document count threshold had been reached.
+     *  The document count threshold (see commit()) still applies too.
+     *
+     *  This allows indexing at a roughly fixed memory use, with batches as
+     *  large as that allows, whatever the size of the documents being
+     *  indexed.
+     *
+     *  The initial limit is taken from XAPIAN_FLUSH_MEMORY_LIMIT in the
+     *  environment if set, and otherwise is 0.
+     *
+     *  Currently this is only supported by the glass backend and is ignored
+     *  by other backends.
+     *
+     *  @param limit	Limit in bytes (0 means no limit).
+     *
+     *  @since Added in Xapian 2.0.0.
+     */
+    void set_flush_memory_limit(size_t limit);
+
     /** Begin a transaction.
      *
      *  A Xapian transaction is a set of consecutive modifications to be
@@ -1225,6 +1316,37 @@ class XAPIAN_VISIBILITY_DEFAULT WritableDatabase : public Database {
      */
     Xapian::docid add_document(const Xapian::Document& doc);
 
+    /** Add several documents to the database.
+     *
+     *  This is equivalent to calling add_document() for each document in
+     *  turn, so the documents are allocated consecutive document IDs starting
+     *  from (get_lastdocid() + 1), but for a glass database the work of
+     *  inverting the documents (building the postlist, position and termlist
+     *  changes) can be split between several threads.  The per-thread
+     *  changes are then merged into the current batch of changes.
+     *
+     *  WritableDatabase objects aren't safe to use from several threads at
+     *  once, but for bulk indexing the documents can be built (e.g. using
+     *  a TermGenerator object per thread) in several producer threads, and
+     *  passed in batches to a single thread which calls this method.
+     *
+     *  The documents are only processed in parallel if none of them were
+     *  read from a database (since lazily reading information from a
+     *  database isn't safe to do from several threads at once).
+     *
+     *  @param docs	The Document objects to be added.
+     *  @param n_threads	Maximum number of threads to use (including the
+     *			calling thread).  0 is treated the same as 1, which
+     *			means not to use any extra threads.
+     *
+     *  @return The document ID allocated to the first document (or 0 if
+     *	    @a docs is empty).
+     *
+     *  @since Added in Xapian 2.0.0.
+     */
+    Xapian::docid add_documents(const std::vector<Xapian::Document>& docs,
+				unsigned n_threads);
+
     /** Delete a document from the database.
      *
      *  This method removes the document with the specified document ID
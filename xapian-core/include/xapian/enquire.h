@@ -357,6 +357,41 @@ class XAPIAN_VISIBILITY_DEFAULT Enquire {
      */
     void set_time_limit(double time_limit);
 
+    /** Set the number of threads to use to match local shards.
+     *
+     *  By default the shards of a sharded database are matched in turn in
+     *  the thread which calls get_mset().  Setting this to more than 1 allows
+     *  up to that many threads (including the calling thread) to be used,
+     *  with each local shard matched by a single thread and the results
+     *  merged.  If the results are ordered primarily by relevance, the
+     *  minimum weight needed to make the MSet is shared between the threads
+     *  so they can still skip documents which can't make the MSet.
+     *
+     *  @param n_threads  maximum number of threads to use (default: 1, which
+     *			  means not to use any extra threads; 0 is treated
+     *			  the same as 1)
+     *
+     *  Collapsing and any percentage cutoff are applied when the results
+     *  are merged, in the same way as for remote shards.  Calls to any
+     *  MatchDecider or MatchSpy objects are serialised, so these don't need
+     *  to be thread-safe, but any KeyMaker or PostingSource subclass used
+     *  must be safe to call concurrently from different threads on its
+     *  clones (a PostingSource is cloned for each shard, but a KeyMaker is
+     *  shared).
+     *
+     *  Limitations:
+     *
+     *  Shards are matched in turn regardless of this setting if the same
+     *  shard has been added more than once, and remote shards are always
+     *  handled by the remote server.
+     *
+     *  The estimated number of matches may be less tight than when shards
+     *  are matched in turn.
+     *
+     *  @since Added in Xapian 2.0.0.
+     */
+    void set_match_threads(unsigned n_threads);
+
     /** Run the query.
      *
      *  Run the query using the settings in this Enquire object and those
@@ -146,7 +146,33 @@ class XAPIAN_VISIBILITY_DEFAULT TermGenerator {
 	 *
 	 *  @since Added in Xapian 2.0.0.
 	 */
-	FLAG_WORD_BREAKS = 4096 // Value matches QueryParser flag
+	FLAG_WORD_BREAKS = 4096, // Value matches QueryParser flag
+
+	/** Index pairs of adjacent words to speed up phrase searches.
+	 *
+	 *  For each pair of terms indexed at adjacent positions, a term
+	 *  is also indexed which consists of "Z", a zero byte, the first term,
+	 *  a zero byte, and the second term (pairs which would give a term
+	 *  longer than 245 bytes are skipped).  Each document is also indexed
+	 *  by the term "Z" followed by a zero byte.  These terms are indexed
+	 *  with wdf 0 and without positional information, so they don't
+	 *  affect document lengths.
+	 *
+	 *  If every document in a database has these terms, then exact
+	 *  phrase searches (OP_PHRASE with a window equal to the number of
+	 *  terms) use them to find candidate documents, which avoids having
+	 *  to check positional information for most documents which contain
+	 *  all the terms but not the phrase.  A phrase of two terms can be
+	 *  matched without checking positional information at all.
+	 *
+	 *  For this to give correct results, all the text in a document with
+	 *  positional information needs to be indexed by a TermGenerator with
+	 *  this flag set, in order of increasing position (so you mustn't
+	 *  use set_termpos() to move to an earlier position).
+	 *
+	 *  @since Added in Xapian 2.0.0.
+	 */
+	FLAG_WORD_PAIRS = 0x80000
     };
 
     /// Stemming strategies, for use with set_stemming_strategy().
@@ -158,6 +158,13 @@ const char * dummy[] = {
 "/* #undef XAPIAN_HAS_REMOTE_BACKEND */",
 #endif
 "",
+"/// XAPIAN_HAS_TIERED_BACKEND Defined if the tiered backend is enabled.",
+#ifdef XAPIAN_HAS_TIERED_BACKEND
+"#define XAPIAN_HAS_TIERED_BACKEND 1",
+#else
+"/* #undef XAPIAN_HAS_TIERED_BACKEND */",
+#endif
+"",
 "/// XAPIAN_AT_LEAST(A,B,C) checks for xapian-core >= A.B.C - use like so:",
 "///",
 "/// @code",
@@ -147,6 +147,13 @@ class XAPIAN_VISIBILITY_DEFAULT Weight {
 	 *  @since 2.0.0
 	 */
 	DB_WDF_MAX = 65536,
+	/** @private @internal Flag set by weighting schemes with an efficient
+	 *  get_sumpart_block() implementation.
+	 *
+	 *  The matcher only calls get_sumpart_block() for objects with this
+	 *  flag set, and uses get_sumpart() for others.
+	 */
+	HAS_SUMPART_BLOCK_ = 0x40000000,
 	/** @private @internal Flag only set for BoolWeight.
 	 *  This allows us to efficiently indentify BoolWeight objects.
 	 */
@@ -376,6 +383,39 @@ class XAPIAN_VISIBILITY_DEFAULT Weight {
 			       Xapian::termcount uniqterms,
 			       Xapian::termcount wdfdocmax) const = 0;
 
+    /** Calculate the weight contribution for a block of postings.
+     *
+     *  The result must be the same as calling get_sumpart() for each posting
+     *  in turn, and the default implementation does exactly that.  This
+     *  method allows a weighting scheme to calculate the weights for a block
+     *  of postings with a single virtual method call, and to use SIMD
+     *  instructions to do so.
+     *
+     *  The matcher currently only uses this method for built-in weighting
+     *  schemes which provide an optimised implementation, and only when they
+     *  need no per-document statistics other than the wdf (looking those up
+     *  for postings ahead of the current one costs more than it saves).
+     *  Otherwise get_sumpart() is called.
+     *
+     *  @param n	  The number of postings in the block.
+     *  @param wdf	  Array of @a n wdf values.
+     *  @param doclen	  Array of @a n document lengths.
+     *  @param uniqterms  Array of @a n unique term counts.
+     *  @param wdfdocmax  Array of @a n maximum wdf values.
+     *  @param[out] out	  Array to store the @a n weights in.
+     *
+     *  As for get_sumpart(), values in the arrays for statistics the
+     *  weighting scheme didn't ask for may be 0.
+     *
+     *  @since Added in Xapian 2.0.0.
+     */
+    virtual void get_sumpart_block(size_t n,
+				   const Xapian::termcount* wdf,
+				   const Xapian::termcount* doclen,
+				   const Xapian::termcount* uniqterms,
+				   const Xapian::termcount* wdfdocmax,
+				   double* out) const;
+
     /** Return an upper bound on what get_sumpart() can return for any document.
      *
      *  This information is used by the matcher to perform various
@@ -383,6 +423,28 @@ class XAPIAN_VISIBILITY_DEFAULT Weight {
      */
     virtual double get_maxpart() const = 0;
 
+    /** Return an upper bound on what get_sumpart() can return for a block of
+     *  postings.
+     *
+     *  Some backends store bounds on the wdf and document length for blocks
+     *  of postings, and the matcher uses this method to avoid decoding blocks
+     *  which can't contain a competitive document.
+     *
+     *  The default implementation returns get_maxpart(), which is always a
+     *  valid bound.  Subclasses whose get_sumpart() is non-decreasing in the
+     *  wdf and non-increasing in the document length can calculate a tighter
+     *  bound.
+     *
+     *  @param wdf_max	  An upper bound on the wdf of any posting in the
+     *			  block.
+     *  @param doclen_min A lower bound on the length of any document in the
+     *			  block.
+     *
+     *  @since Added in Xapian 2.0.0.
+     */
+    virtual double get_block_maxpart(Xapian::termcount wdf_max,
+				     Xapian::termcount doclen_min) const;
+
     /** Calculate the term-independent weight component for a document.
      *
      *  The default implementation always returns 0 (in Xapian < 2.0.0 this
@@ -524,6 +586,16 @@ class XAPIAN_VISIBILITY_DEFAULT Weight {
 	return stats_needed & IS_BOOLWEIGHT_;
     }
 
+    /** @private @internal Return true if get_sumpart_block() should be used.
+     *
+     *  This is only true for weighting schemes which implement
+     *  get_sumpart_block() more efficiently than by calling get_sumpart()
+     *  for each posting.
+     */
+    bool use_sumpart_block_() const {
+	return stats_needed & HAS_SUMPART_BLOCK_;
+    }
+
     /** @private @internal Return true if the max WDF of document is needed.
      *
      *  If this method returns true, then the max WDF will be
@@ -1028,6 +1100,7 @@ class XAPIAN_VISIBILITY_DEFAULT TfIdfWeight : public Weight {
 	need_stat(TERMFREQ);
 	need_stat(WDF);
 	need_stat(WDF_MAX);
+	need_stat(HAS_SUMPART_BLOCK_);
 	need_stat(COLLECTION_SIZE);
     }
 
@@ -1040,6 +1113,12 @@ class XAPIAN_VISIBILITY_DEFAULT TfIdfWeight : public Weight {
 		       Xapian::termcount doclen,
 		       Xapian::termcount uniqterm,
 		       Xapian::termcount wdfdocmax) const;
+    void get_sumpart_block(size_t n,
+			   const Xapian::termcount* wdf,
+			   const Xapian::termcount* doclen,
+			   const Xapian::termcount* uniqterms,
+			   const Xapian::termcount* wdfdocmax,
+			   double* out) const;
     double get_maxpart() const;
 
     TfIdfWeight * create_from_parameters(const char * params) const;
@@ -1110,6 +1189,7 @@ class XAPIAN_VISIBILITY_DEFAULT BM25Weight : public Weight {
 	need_stat(RELTERMFREQ);
 	need_stat(WDF);
 	need_stat(WDF_MAX);
+	need_stat(HAS_SUMPART_BLOCK_);
 	if (param_k2 != 0 || (param_k1 != 0 && param_b != 0)) {
 	    need_stat(DOC_LENGTH_MIN);
 	    need_stat(AVERAGE_LENGTH);
@@ -1132,6 +1212,7 @@ class XAPIAN_VISIBILITY_DEFAULT BM25Weight : public Weight {
 	need_stat(RELTERMFREQ);
 	need_stat(WDF);
 	need_stat(WDF_MAX);
+	need_stat(HAS_SUMPART_BLOCK_);
 	need_stat(DOC_LENGTH_MIN);
 	need_stat(AVERAGE_LENGTH);
 	need_stat(DOC_LENGTH);
@@ -1147,7 +1228,15 @@ class XAPIAN_VISIBILITY_DEFAULT BM25Weight : public Weight {
 		       Xapian::termcount doclen,
 		       Xapian::termcount uniqterm,
 		       Xapian::termcount wdfdocmax) const;
+    void get_sumpart_block(size_t n,
+			   const Xapian::termcount* wdf,
+			   const Xapian::termcount* doclen,
+			   const Xapian::termcount* uniqterms,
+			   const Xapian::termcount* wdfdocmax,
+			   double* out) const;
     double get_maxpart() const;
+    double get_block_maxpart(Xapian::termcount wdf_max,
+			     Xapian::termcount doclen_min) const;
 
     double get_sumextra(Xapian::termcount doclen,
 			Xapian::termcount uniqterms,
@@ -1233,6 +1322,7 @@ class XAPIAN_VISIBILITY_DEFAULT BM25PlusWeight : public Weight {
 	need_stat(RELTERMFREQ);
 	need_stat(WDF);
 	need_stat(WDF_MAX);
+	need_stat(HAS_SUMPART_BLOCK_);
 	if (param_k2 != 0 || (param_k1 != 0 && param_b != 0)) {
 	    need_stat(DOC_LENGTH_MIN);
 	    need_stat(AVERAGE_LENGTH);
@@ -1255,6 +1345,7 @@ class XAPIAN_VISIBILITY_DEFAULT BM25PlusWeight : public Weight {
 	need_stat(RELTERMFREQ);
 	need_stat(WDF);
 	need_stat(WDF_MAX);
+	need_stat(HAS_SUMPART_BLOCK_);
 	need_stat(DOC_LENGTH_MIN);
 	need_stat(AVERAGE_LENGTH);
 	need_stat(DOC_LENGTH);
@@ -1270,7 +1361,15 @@ class XAPIAN_VISIBILITY_DEFAULT BM25PlusWeight : public Weight {
 		       Xapian::termcount doclen,
 		       Xapian::termcount uniqterms,
 		       Xapian::termcount wdfdocmax) const;
+    void get_sumpart_block(size_t n,
+			   const Xapian::termcount* wdf,
+			   const Xapian::termcount* doclen,
+			   const Xapian::termcount* uniqterms,
+			   const Xapian::termcount* wdfdocmax,
+			   double* out) const;
     double get_maxpart() const;
+    double get_block_maxpart(Xapian::termcount wdf_max,
+			     Xapian::termcount doclen_min) const;
 
     double get_sumextra(Xapian::termcount doclen,
 			Xapian::termcount uniqterms,
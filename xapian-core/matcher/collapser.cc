@@ -40,23 +40,22 @@ CollapseData::check_item(const vector<Result>& results,
     }
 
     // We already have collapse_max items better than result so we need to
-    // eliminate the lowest ranked.
-    if (collapse_count == 0 && collapse_max != 1) {
-	// Be lazy about building the heap - if we see <= collapse_max items
-	// with a particular collapse key, we never need to use the heap.
+    // eliminate the lowest ranked.  Entries can be pushed out of the
+    // proto-mset at any point, which changes how they compare, so we build
+    // the heap afresh each time (collapse_max is expected to be small).
+    if (collapse_max != 1) {
 	Heap::make(items.begin(), items.end(),
-		   [&](pair<Xapian::doccount, Xapian::docid> a,
-		       pair<Xapian::doccount, Xapian::docid> b) {
-		       return mcmp(results[a.first], results[b.first]);
+		   [&](const pair<Xapian::doccount, Xapian::docid>& a,
+		       const pair<Xapian::doccount, Xapian::docid>& b) {
+		       return item_cmp(results, mcmp, a, b);
 		   });
     }
     ++collapse_count;
 
-    Xapian::doccount old_item_candidate = items.front().first;
-    const Result& old_result = results[old_item_candidate];
-    if (items.front().second != old_result.get_docid()) {
+    if (!in_results(results, items.front())) {
 	// The previous result with this collapse key we were going to replace
-	// has been pushed out of the protomset by higher ranking results.
+	// has been pushed out of the protomset by higher ranking results (or
+	// never made it in).
 	//
 	// Awkwardly that means we don't know its exact weight, but we
 	// only need next_best_weight to know if we can zero collapse_count
@@ -71,9 +70,14 @@ CollapseData::check_item(const vector<Result>& results,
 	// weight.
 	next_best_weight = result.get_weight();
 
-	return REPLACE;
+	// The new result needs adding to the proto-mset rather than replacing
+	// an entry in it, and add_item() will then reuse the dropped entry's
+	// slot in items.
+	return ADD;
     }
 
+    Xapian::doccount old_item_candidate = items.front().first;
+    const Result& old_result = results[old_item_candidate];
     if (mcmp(old_result, result)) {
 	// If this is the "best runner-up", update next_best_weight.
 	if (result.get_weight() > next_best_weight)
@@ -85,11 +89,6 @@ CollapseData::check_item(const vector<Result>& results,
     next_best_weight = old_result.get_weight();
 
     items.front() = { old_item, result.get_docid() };
-    Heap::replace(items.begin(), items.end(),
-		  [&](pair<Xapian::doccount, Xapian::docid> a,
-		      pair<Xapian::doccount, Xapian::docid> b) {
-		      return mcmp(results[a.first], results[b.first]);
-		  });
 
     return REPLACE;
 }
@@ -103,23 +102,18 @@ CollapseData::set_item(Xapian::doccount item)
 }
 
 void
-CollapseData::add_item(const vector<Result>& results,
-		       Xapian::doccount item,
-		       Xapian::doccount collapse_max,
-		       MSetCmp mcmp)
+CollapseData::add_item(Xapian::doccount item,
+		       Xapian::docid did,
+		       Xapian::doccount collapse_max)
 {
-    const Result& result = results[item];
     if (items.size() < collapse_max) {
-	items.emplace_back(item, result.get_docid());
+	items.emplace_back(item, did);
 	return;
     }
 
-    items.front() = { item, result.get_docid() };
-    Heap::replace(items.begin(), items.end(),
-		  [&](pair<Xapian::doccount, Xapian::docid> a,
-		      pair<Xapian::doccount, Xapian::docid> b) {
-		      return mcmp(results[a.first], results[b.first]);
-		  });
+    // check_item() found the lowest ranked entry had been dropped from the
+    // proto-mset and left it at the front of the heap.
+    items.front() = { item, did };
 }
 
 collapse_result
@@ -150,19 +144,23 @@ Collapser::check(Result& result,
 
     collapse_result res;
     CollapseData& collapse_data = *ptr;
+    Xapian::doccount old_collapse_count = collapse_data.get_collapse_count();
     res = collapse_data.check_item(results, result, collapse_max, mcmp,
 				   old_item);
-    if (res == ADD) {
-	++entry_count;
-    } else if (res == REJECT || res == REPLACE) {
+    if (collapse_data.get_collapse_count() != old_collapse_count) {
+	// A result with this collapse key was rejected or replaced (or had
+	// already been dropped from the proto-mset).
 	++dups_ignored;
+    } else if (res == ADD) {
+	++entry_count;
     }
     return res;
 }
 
 void
 Collapser::process(collapse_result action,
-		   Xapian::doccount item)
+		   Xapian::doccount item,
+		   Xapian::docid did)
 {
     switch (action) {
 	case NEW:
@@ -172,7 +170,7 @@ Collapser::process(collapse_result action,
 	    return;
 	case ADD: {
 	    Assert(ptr);
-	    ptr->add_item(results, item, collapse_max, mcmp);
+	    ptr->add_item(item, did, collapse_max);
 	    break;
 	}
 	default:
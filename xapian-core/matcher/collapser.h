@@ -42,7 +42,9 @@ typedef enum {
 class CollapseData {
     /** Currently kept MSet entries for this value of the collapse key.
      *
-     *  If collapse_max > 1, then this is a min-heap once collapse_count > 0.
+     *  If collapse_max > 1, then check_item() arranges this as a min-heap
+     *  once there are collapse_max entries.  An entry which has been pushed
+     *  out of the proto-mset (or was never added to it) ranks lowest.
      *
      *  The first member of the pair is the index into proto_mset.results
      *  and the second is the docid of the entry (used to detect if the
@@ -60,6 +62,28 @@ class CollapseData {
     /// The number of documents we've rejected.
     Xapian::doccount collapse_count = 0;
 
+    /// Is the entry @a item still in @a results?
+    static bool in_results(const std::vector<Result>& results,
+			   const std::pair<Xapian::doccount,
+					   Xapian::docid>& item) {
+	return item.first < results.size() &&
+	       results[item.first].get_docid() == item.second;
+    }
+
+    /** Heap comparison for items.
+     *
+     *  Entries no longer in results rank below all those which still are.
+     */
+    static bool item_cmp(const std::vector<Result>& results, MSetCmp mcmp,
+			 const std::pair<Xapian::doccount,
+					 Xapian::docid>& a,
+			 const std::pair<Xapian::doccount,
+					 Xapian::docid>& b) {
+	if (!in_results(results, a)) return false;
+	if (!in_results(results, b)) return true;
+	return mcmp(results[a.first], results[b.first]);
+    }
+
   public:
     /// Construct with the given item.
     CollapseData(Xapian::doccount item, Xapian::docid did)
@@ -68,10 +92,10 @@ class CollapseData {
 
     /** Check a new result with this collapse key value.
      *
-     *  If this method determines the action to take is ADD or REPLACE, then
-     *  the proto-mset should be updated and then add_item() called to complete
-     *  the update of the CollapseData (if the result doesn't actually get
-     *  added, then it's OK not to follow up with a call to add_item()).
+     *  If this method determines the action to take is ADD, then the
+     *  proto-mset should be updated and then add_item() called to complete
+     *  the update of the CollapseData (even if the result doesn't actually
+     *  get added).
      *
      *  @param results		The results so far.
      *  @param result		The new result.
@@ -95,15 +119,14 @@ class CollapseData {
 
     /** Complete update of new result with this collapse key value.
      *
-     *  @param results		The results so far.
-     *  @param item		The new item (index into results).
+     *  @param item		The new item (index into results, or
+     *				Xapian::doccount(-1) if it wasn't added).
+     *  @param did		The docid of the new item.
      *  @param collapse_max	Max no. of items for each collapse key value.
-     *  @param mcmp		Result comparison functor.
      */
-    void add_item(const std::vector<Result>& results,
-		  Xapian::doccount item,
-		  Xapian::doccount collapse_max,
-		  MSetCmp mcmp);
+    void add_item(Xapian::doccount item,
+		  Xapian::docid did,
+		  Xapian::doccount collapse_max);
 
     /** Process relocation of entry in results.
      *
@@ -197,8 +220,7 @@ class Collapser {
      *
      *  If this method determines the action to take is NEW or ADD then the
      *  proto-mset should be updated and then process() called to complete the
-     *  update (if the result doesn't actually get added, then it's OK not
-     *  to follow up with a call to process()).
+     *  update (even if the result doesn't actually get added).
      *
      *  @param result	The new result.
      *  @param vsdoc	Document for getting values.
@@ -209,11 +231,19 @@ class Collapser {
 			  Xapian::Document::Internal & vsdoc);
 
     /** Handle a new Result.
+     *
+     *  This should also be called if the proto-mset didn't keep the result,
+     *  so that later results with the same collapse key are counted as
+     *  duplicates.
      *
      *  @param action	The collapse_result returned by check().
-     *  @param item	The new item (index into results).
+     *  @param item	The new item (index into results, or
+     *			Xapian::doccount(-1) if it wasn't added).
+     *  @param did	The docid of the new item.
      */
-    void process(collapse_result action, Xapian::doccount item);
+    void process(collapse_result action,
+		 Xapian::doccount item,
+		 Xapian::docid did);
 
     /** Process relocation of entry in results.
      *
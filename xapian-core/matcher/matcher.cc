@@ -45,8 +45,13 @@
 #endif
 
 #include <algorithm>
+#include <atomic>
 #include <cerrno>
 #include <cfloat> // For DBL_EPSILON.
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <thread>
 #include <vector>
 
 #ifdef HAVE_POLL_H
@@ -178,6 +183,94 @@ Matcher::for_all_remotes(Action action)
 }
 #endif
 
+namespace {
+
+/// Wrapper to serialise calls to a MatchDecider from parallel matches.
+class LockingMatchDecider : public Xapian::MatchDecider {
+    const Xapian::MatchDecider& mdecider;
+
+    mutable mutex decider_mutex;
+
+  public:
+    explicit LockingMatchDecider(const Xapian::MatchDecider& mdecider_)
+	: mdecider(mdecider_) {}
+
+    bool operator()(const Xapian::Document& doc) const override {
+	lock_guard<mutex> lock(decider_mutex);
+	return mdecider(doc);
+    }
+};
+
+}
+
+/// Feed the candidates from @a pltree to @a proto_mset.
+static void
+run_match(ProtoMSet& proto_mset,
+	  PostListTree& pltree,
+	  ValueStreamDocument& vsdoc,
+	  const Xapian::Document& doc,
+	  SpyMaster& spymaster,
+	  const Xapian::KeyMaker* sorter,
+	  Xapian::valueno sort_key,
+	  Xapian::Enquire::Internal::sort_setting sort_by)
+{
+    while (true) {
+	double min_weight = proto_mset.get_min_weight();
+	if (!pltree.next(min_weight)) {
+	    break;
+	}
+
+	// The weight calculation can be expensive enough that it's worth being
+	// lazy and only calculating it once we know we need to.  If sort_by
+	// is DOCID then all weights are zero.
+	double weight = 0.0;
+	bool calculated_weight = (sort_by == DOCID);
+	if (!calculated_weight) {
+	    if (sort_by != VAL || min_weight > 0.0) {
+		weight = pltree.get_weight();
+		if (weight < min_weight) {
+		    continue;
+		}
+		calculated_weight = true;
+	    }
+	}
+
+	Xapian::docid did = pltree.get_docid();
+	vsdoc.set_document(did);
+	Result new_item(weight, did);
+
+	if (sort_by != DOCID && sort_by != REL) {
+	    if (sorter) {
+		new_item.set_sort_key((*sorter)(doc));
+	    } else {
+		new_item.set_sort_key(vsdoc.get_value(sort_key));
+	    }
+
+	    if (proto_mset.early_reject(new_item, calculated_weight, spymaster,
+					doc))
+		continue;
+	}
+
+	// Apply any MatchSpy objects.
+	if (spymaster) {
+	    if (!calculated_weight) {
+		weight = pltree.get_weight();
+		new_item.set_weight(weight);
+		calculated_weight = true;
+	    }
+	    spymaster(doc, weight);
+	}
+
+	if (!calculated_weight) {
+	    weight = pltree.get_weight();
+	    new_item.set_weight(weight);
+	}
+
+	if (!proto_mset.process(std::move(new_item), vsdoc))
+	    break;
+    }
+}
+
 Matcher::Matcher(const Xapian::Database& db_,
 		 const Xapian::Query& query,
 		 Xapian::termcount query_length,
@@ -258,6 +351,21 @@ Matcher::Matcher(const Xapian::Database& db_,
     if (!locals.empty() && locals.size() != n_shards)
 	locals.resize(n_shards);
 
+    if (locals.size() > 1) {
+	// The same shard can be added to a Database more than once, but then
+	// parallel matches would share a Database::Internal object.
+	vector<const Xapian::Database::Internal*> local_dbs;
+	auto multidb = static_cast<const MultiDatabase*>(db.internal.get());
+	for (Xapian::doccount i = 0; i != n_shards; ++i) {
+	    if (locals[i])
+		local_dbs.push_back(multidb->shards[i]);
+	}
+	sort(local_dbs.begin(), local_dbs.end());
+	locals_can_run_in_parallel =
+	    local_dbs.size() > 1 &&
+	    adjacent_find(local_dbs.begin(), local_dbs.end()) == local_dbs.end();
+    }
+
 #ifdef XAPIAN_HAS_REMOTE_BACKEND
 # ifndef HAVE_POLL
 #  ifndef __WIN32__
@@ -508,69 +616,199 @@ Matcher::get_local_mset(Xapian::doccount first,
 			 time_limit);
     proto_mset.set_new_min_weight(weight_threshold);
 
-    while (true) {
-	double min_weight = proto_mset.get_min_weight();
-	if (!pltree.next(min_weight)) {
-	    break;
-	}
+    run_match(proto_mset, pltree, vsdoc, doc, spymaster,
+	      sorter, sort_key, sort_by);
 
-	// The weight calculation can be expensive enough that it's worth being
-	// lazy and only calculating it once we know we need to.  If sort_by
-	// is DOCID then all weights are zero.
-	double weight = 0.0;
-	bool calculated_weight = (sort_by == DOCID);
-	if (!calculated_weight) {
-	    if (sort_by != VAL || min_weight > 0.0) {
-		weight = pltree.get_weight();
-		if (weight < min_weight) {
-		    continue;
-		}
-		calculated_weight = true;
-	    }
-	}
+    // Explicitly delete all PostList objects so they report any stats to
+    // the EstimateOp objects.
+    pltree.delete_postlists();
 
-	Xapian::docid did = pltree.get_docid();
-	vsdoc.set_document(did);
-	Result new_item(weight, did);
+    return proto_mset.finalise(mdecider,
+			       locals,
+			       estimates);
+}
 
-	if (sort_by != DOCID && sort_by != REL) {
-	    if (sorter) {
-		new_item.set_sort_key((*sorter)(doc));
-	    } else {
-		new_item.set_sort_key(vsdoc.get_value(sort_key));
-	    }
+void
+Matcher::get_local_msets(Xapian::doccount maxitems,
+			 Xapian::doccount check_at_least,
+			 const Xapian::Weight& wtscheme,
+			 const Xapian::MatchDecider* mdecider,
+			 const Xapian::KeyMaker* sorter,
+			 Xapian::valueno collapse_key,
+			 Xapian::doccount collapse_max,
+			 double weight_threshold,
+			 Xapian::Enquire::docid_order order,
+			 Xapian::valueno sort_key,
+			 Xapian::Enquire::Internal::sort_setting sort_by,
+			 bool sort_val_reverse,
+			 double time_limit,
+			 const vector<opt_ptr_spy>& matchspies,
+			 unsigned n_threads,
+			 vector<Xapian::MSet>& msets)
+{
+    AssertRel(n_threads, >, 1);
+    Assert(locals_can_run_in_parallel);
 
-	    if (proto_mset.early_reject(new_item, calculated_weight, spymaster,
-					doc))
-		continue;
-	}
+    // Everything needed to match a single shard.  Postlists reference their
+    // PostListTree, so each shard needs its own.
+    struct ShardMatch {
+	ValueStreamDocument vsdoc;
 
-	// Apply any MatchSpy objects.
-	if (spymaster) {
-	    if (!calculated_weight) {
-		weight = pltree.get_weight();
-		new_item.set_weight(weight);
-		calculated_weight = true;
-	    }
-	    spymaster(doc, weight);
-	}
+	PostListTree pltree;
 
-	if (!calculated_weight) {
-	    weight = pltree.get_weight();
-	    new_item.set_weight(weight);
+	/** Postlists indexed by shard.
+	 *
+	 *  Only the entry for the shard being matched is non-NULL, which means
+	 *  PostListTree::get_docid() returns unsharded docids.
+	 */
+	vector<PostList*> postlists;
+
+	Xapian::VecUniquePtr<EstimateOp> estimates;
+
+	Xapian::MSet mset;
+
+	exception_ptr error;
+
+	ShardMatch(Xapian::Database& db_, const Xapian::Weight& wtscheme_)
+	    : vsdoc(db_), pltree(vsdoc, db_, wtscheme_) {
+	    ++vsdoc._refs;
 	}
+    };
+
+    // MatchDecider and MatchSpy subclasses aren't required to be thread-safe
+    // so serialise calls to them.
+    unique_ptr<LockingMatchDecider> locking_mdecider;
+    if (mdecider)
+	locking_mdecider.reset(new LockingMatchDecider(*mdecider));
+    mutex spy_mutex;
+
+    // Build the postlist trees in this thread - the Query and Weight objects
+    // aren't safe to share between threads.
+    Xapian::doccount n_shards = locals.size();
+    vector<unique_ptr<ShardMatch>> shard_matches;
+    Xapian::termcount total_subqs = 0;
+    double max_possible = 0.0;
+    for (Xapian::doccount i = 0; i != n_shards; ++i) {
+	if (!locals[i])
+	    continue;
+	unique_ptr<ShardMatch> m(new ShardMatch(db, wtscheme));
+	// Pick the highest total subqueries answer amongst the shards, as in
+	// get_local_mset().
+	Xapian::termcount total_subqs_i = 0;
+	PostListAndEstimate plest = locals[i]->get_postlist(&m->pltree,
+							    &total_subqs_i);
+	total_subqs = max(total_subqs, total_subqs_i);
+	if (plest.pl == nullptr)
+	    continue;
+	if (mdecider) {
+	    plest.est.reset(new EstimateOp(EstimateOp::DECIDER,
+					   plest.est.release()));
+	    plest.pl = new DeciderPostList(plest.pl, plest.est.get(),
+					   locking_mdecider.get(), &m->vsdoc,
+					   &m->pltree);
+	}
+	m->postlists.resize(n_shards);
+	m->postlists[i] = plest.pl;
+	m->pltree.set_postlists(&m->postlists[0], n_shards);
+	m->estimates.reserve(n_shards);
+	for (Xapian::doccount j = 0; j != n_shards; ++j) {
+	    m->estimates.push_back(j == i ? plest.est.release() : nullptr);
+	}
+	max_possible = max(max_possible, m->pltree.recalc_maxweight());
+	shard_matches.push_back(std::move(m));
+    }
 
-	if (!proto_mset.process(std::move(new_item), vsdoc))
-	    break;
+    if (max_possible == 0.0) {
+	// All the weights are zero.
+	if (sort_by == REL) {
+	    // We're only sorting by DOCID.
+	    sort_by = DOCID;
+	} else if (sort_by == REL_VAL || sort_by == VAL_REL) {
+	    // Normalise REL_VAL and VAL_REL to VAL, to avoid needlessly
+	    // fetching and comparing weights.
+	    sort_by = VAL;
+	}
     }
 
-    // Explicitly delete all PostList objects so they report any stats to
-    // the EstimateOp objects.
-    pltree.delete_postlists();
+    bool sort_forward = (order != Xapian::Enquire::DESCENDING);
+    auto mcmp = get_msetcmp_function(sort_by, sort_forward, sort_val_reverse);
 
-    return proto_mset.finalise(mdecider,
-			       locals,
-			       estimates);
+    // Each shard gives ascending unsharded docids, so when sorting by
+    // ascending docid each shard can stop once its ProtoMSet is full.
+    bool stop_once_full = (sort_forward && sort_by == DOCID);
+
+    // A document can only make the merged MSet if its weight is at least the
+    // lowest weight in a full ProtoMSet for any of the shards, so if we're
+    // ordering primarily by weight that threshold can be shared.  This isn't
+    // true when collapsing, since documents in a full ProtoMSet can be
+    // collapsed away when merging.
+    bool share_min_weight = (sort_by == REL || sort_by == REL_VAL) &&
+			    collapse_max == 0;
+    atomic<double> shared_min_weight(weight_threshold);
+
+    auto match_shard = [&](ShardMatch& m) {
+	// Any percentage cutoff is applied when merging, as for remote shards.
+	ProtoMSet proto_mset(0, maxitems, check_at_least,
+			     mcmp, sort_by, total_subqs,
+			     m.pltree,
+			     collapse_key, collapse_max,
+			     0, 0.0,
+			     max_possible,
+			     stop_once_full,
+			     time_limit);
+	proto_mset.set_new_min_weight(weight_threshold);
+	if (share_min_weight)
+	    proto_mset.set_shared_min_weight(&shared_min_weight);
+
+	Xapian::Document doc(&m.vsdoc);
+	SpyMaster spymaster(&matchspies, &spy_mutex);
+	run_match(proto_mset, m.pltree, m.vsdoc, doc, spymaster,
+		  sorter, sort_key, sort_by);
+
+	// Explicitly delete all PostList objects so they report any stats to
+	// the EstimateOp objects.
+	m.pltree.delete_postlists();
+
+	m.mset = proto_mset.finalise(mdecider, locals, m.estimates);
+    };
+
+    atomic<size_t> next_shard(0);
+    auto worker = [&]() {
+	size_t j;
+	while ((j = next_shard++) < shard_matches.size()) {
+	    ShardMatch& m = *shard_matches[j];
+	    try {
+		match_shard(m);
+	    } catch (...) {
+		m.error = current_exception();
+	    }
+	}
+    };
+
+    if (n_threads > shard_matches.size())
+	n_threads = shard_matches.size();
+    vector<thread> threads;
+    if (n_threads > 1) {
+	threads.reserve(n_threads - 1);
+	try {
+	    while (threads.size() != n_threads - 1) {
+		threads.emplace_back(worker);
+	    }
+	} catch (const system_error&) {
+	    // Failing to create a thread isn't fatal - we just end up using
+	    // fewer threads.
+	}
+    }
+    worker();
+    for (auto&& t : threads) {
+	t.join();
+    }
+
+    for (auto&& m : shard_matches) {
+	if (m->error)
+	    rethrow_exception(m->error);
+	msets.push_back(std::move(m->mset));
+    }
 }
 
 Xapian::MSet
@@ -590,7 +828,8 @@ Matcher::get_mset(Xapian::doccount first,
 		  Xapian::Enquire::Internal::sort_setting sort_by,
 		  bool sort_val_reverse,
 		  double time_limit,
-		  const vector<opt_intrusive_ptr<Xapian::MatchSpy>>& matchspies)
+		  const vector<opt_intrusive_ptr<Xapian::MatchSpy>>& matchspies,
+		  unsigned match_threads)
 {
     AssertRel(check_at_least, >=, first + maxitems);
 
@@ -630,17 +869,34 @@ Matcher::get_mset(Xapian::doccount first,
 #endif
 
     Xapian::MSet local_mset;
+    // MSet objects from matching local shards in parallel.
+    vector<Xapian::MSet> local_msets;
+    // Do we need to merge MSet objects?
+    bool merging = false;
+#ifdef XAPIAN_HAS_REMOTE_BACKEND
+    if (!remotes.empty())
+	merging = true;
+#endif
     if (!locals.empty()) {
 	for (auto&& submatch : locals) {
 	    if (submatch)
 		submatch->start_match(stats);
 	}
 
+	// Parallel matching needs check_at_least > 0 so there's actually a
+	// match to run.  The MSet objects for the shards get merged in the
+	// same way as those from remote shards, which handles collapsing and
+	// any percentage cutoff.
+	bool parallel = (match_threads > 1 &&
+			 locals_can_run_in_parallel &&
+			 check_at_least > 0);
+	if (parallel)
+	    merging = true;
+
 	Xapian::doccount local_first = first;
 	Xapian::doccount local_maxitems = maxitems;
 	double local_percent_threshold_factor = percent_threshold_factor;
-#ifdef XAPIAN_HAS_REMOTE_BACKEND
-	if (!remotes.empty()) {
+	if (merging) {
 	    // We need to fetch the first "first" results too, as merging may
 	    // push those down into the part of the merged MSet we care about.
 	    local_first = 0;
@@ -656,27 +912,40 @@ Matcher::get_mset(Xapian::doccount first,
 	    }
 	    local_percent_threshold_factor = 0.0;
 	}
-#endif
-	local_mset = get_local_mset(local_first, local_maxitems, check_at_least,
-				    wtscheme, mdecider,
-				    sorter, collapse_key, collapse_max,
-				    percent_threshold,
-				    local_percent_threshold_factor,
-				    weight_threshold, order, sort_key, sort_by,
-				    sort_val_reverse, time_limit, matchspies);
+
+	if (parallel) {
+	    get_local_msets(local_maxitems, check_at_least,
+			    wtscheme, mdecider, sorter,
+			    collapse_key, collapse_max,
+			    weight_threshold,
+			    order, sort_key, sort_by, sort_val_reverse,
+			    time_limit, matchspies, match_threads,
+			    local_msets);
+	} else {
+	    local_mset = get_local_mset(local_first, local_maxitems,
+					check_at_least,
+					wtscheme, mdecider,
+					sorter, collapse_key, collapse_max,
+					percent_threshold,
+					local_percent_threshold_factor,
+					weight_threshold, order, sort_key,
+					sort_by, sort_val_reverse, time_limit,
+					matchspies);
+	    local_msets.push_back(local_mset);
+	}
     }
 
-#ifdef XAPIAN_HAS_REMOTE_BACKEND
-    if (remotes.empty()) {
-	// Another easy case - only local databases.
+    if (!merging) {
+	// Another easy case - only local databases, matched in turn.
 	return local_mset;
     }
 
-    // We need to merge MSet objects.  We only need the number of remote shards
-    // + 1 if there are any local shards, so reserving n_shards may be more
-    // than we need.
+    // We need to merge MSet objects.
     vector<pair<Xapian::MSet, Xapian::doccount>> msets;
     Xapian::MSet merged_mset;
+    // Did every shard return all its matches?
+    bool all_shards_complete = true;
+#ifdef XAPIAN_HAS_REMOTE_BACKEND
     for_all_remotes(
 	[&](RemoteSubMatch* submatch) {
 	    Xapian::MSet remote_mset = submatch->get_mset(matchspies);
@@ -688,6 +957,8 @@ Matcher::get_mset(Xapian::doccount first,
 	    } else {
 		merged_stats->merge(*(remote_mset.internal->stats));
 	    }
+	    if (remote_mset.get_matches_upper_bound() > remote_mset.size())
+		all_shards_complete = false;
 	    if (remote_mset.empty()) {
 		return;
 	    }
@@ -695,13 +966,21 @@ Matcher::get_mset(Xapian::doccount first,
 						 db.internal->size());
 	    msets.push_back({remote_mset, 0});
 	});
+#endif
 
     if (!locals.empty()) {
-	if (!local_mset.empty())
-	    msets.push_back({local_mset, 0});
-	merged_mset.internal->merge_stats(local_mset.internal.get(),
-					  collapse_max != 0);
-	merged_mset.internal->stats->merge(stats);
+	for (auto&& shard_mset : local_msets) {
+	    if (shard_mset.get_matches_upper_bound() > shard_mset.size())
+		all_shards_complete = false;
+	    if (!shard_mset.empty())
+		msets.push_back({shard_mset, 0});
+	    merged_mset.internal->merge_stats(shard_mset.internal.get(),
+					      collapse_max != 0);
+	}
+	// If there are no remote shards then the caller will use stats.
+	auto& merged_stats = merged_mset.internal->stats;
+	if (merged_stats)
+	    merged_stats->merge(stats);
     }
 
     if (merged_mset.internal->max_possible == 0.0) {
@@ -738,6 +1017,9 @@ Matcher::get_mset(Xapian::doccount first,
 
     CollapserLite collapser(collapse_max);
     merged_mset.internal->first = first;
+    // The number of results which made it into the merged MSet, including
+    // the first "first" which we skip.
+    Xapian::doccount n_kept = 0;
     while (!msets.empty() && merged_mset.size() != maxitems) {
 	auto& front = msets.front();
 	auto& result = front.first.internal->items[front.second];
@@ -749,6 +1031,7 @@ Matcher::get_mset(Xapian::doccount first,
 	    }
 	}
 	if (!collapser || collapser.add(result.get_collapse_key())) {
+	    ++n_kept;
 	    if (first) {
 		// Skip the first "first" results from the merge - we had to
 		// also fetch the first "first" results from each shard, as
@@ -769,6 +1052,28 @@ Matcher::get_mset(Xapian::doccount first,
 	}
     }
 
+    if (percent_threshold) {
+	// The shards were matched without the percentage cutoff, so their
+	// counts need adjusting in the same way as ProtoMSet::finalise() does.
+	auto mseti = merged_mset.internal;
+	if (merged_mset.size() != maxitems && all_shards_complete &&
+	    !collapser) {
+	    // We've seen every match, and stopped at the cutoff.
+	    mseti->matches_lower_bound = n_kept;
+	    mseti->matches_estimated = n_kept;
+	    mseti->matches_upper_bound = n_kept;
+	} else {
+	    mseti->matches_lower_bound = n_kept;
+	    // Scale the estimate assuming that document weights are evenly
+	    // distributed from 0 to the maximum weight seen.
+	    auto e = Xapian::doccount(mseti->matches_estimated *
+				      (1.0 - percent_threshold_factor) + 0.5);
+	    mseti->matches_estimated = std::clamp(e,
+						  mseti->matches_lower_bound,
+						  mseti->matches_upper_bound);
+	}
+    }
+
     if (collapser) {
 	auto todo = check_at_least - maxitems;
 	if (merged_mset.size() != maxitems) {
@@ -849,7 +1154,4 @@ Matcher::get_mset(Xapian::doccount first,
     }
 
     return merged_mset;
-#else
-    return local_mset;
-#endif
 }
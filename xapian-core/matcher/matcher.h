@@ -87,6 +87,13 @@ class Matcher {
 # endif
 #endif
 
+    /** Can the local shards be matched in parallel?
+     *
+     *  True if there are at least two local shards and they're all distinct
+     *  objects (so no two threads would share a Database::Internal).
+     */
+    bool locals_can_run_in_parallel = false;
+
     Matcher(const Matcher&) = delete;
 
     Matcher& operator=(const Matcher&) = delete;
@@ -109,6 +116,35 @@ class Matcher {
 				double time_limit,
 				const std::vector<opt_ptr_spy>& matchspies);
 
+    /** Run the match over the local shards in parallel.
+     *
+     *  Each local shard is matched with its own PostListTree and ProtoMSet
+     *  using up to @a n_threads threads (including the calling thread) and
+     *  the resulting MSet objects are appended to @a msets to be merged.
+     *  When the primary ordering is by relevance and we aren't collapsing, the
+     *  minimum weight needed to make the MSet is shared between the threads.
+     *
+     *  As for remote shards, any percentage cutoff and collapsing across
+     *  shards is applied when the MSet objects are merged.  Calls to
+     *  @a mdecider and @a matchspies are serialised with a mutex.
+     */
+    void get_local_msets(Xapian::doccount maxitems,
+			 Xapian::doccount check_at_least,
+			 const Xapian::Weight& wtscheme,
+			 const Xapian::MatchDecider* mdecider,
+			 const Xapian::KeyMaker* sorter,
+			 Xapian::valueno collapse_key,
+			 Xapian::doccount collapse_max,
+			 double weight_threshold,
+			 Xapian::Enquire::docid_order order,
+			 Xapian::valueno sort_key,
+			 Xapian::Enquire::Internal::sort_setting sort_by,
+			 bool sort_val_reverse,
+			 double time_limit,
+			 const std::vector<opt_ptr_spy>& matchspies,
+			 unsigned n_threads,
+			 std::vector<Xapian::MSet>& msets);
+
     /// Perform action on remotes as they become ready using poll() or select().
     template<typename Action> void for_all_remotes(Action action);
 
@@ -189,6 +225,9 @@ class Matcher {
      *  @param time_limit	time in seconds after which to disable
      *				check_at_least (0.0 means don't).
      *  @param matchspies	MatchSpy objects to use
+     *  @param match_threads	Maximum number of threads to use to match
+     *				local shards (1 means match them in turn in
+     *				the calling thread)
      */
     Xapian::MSet get_mset(Xapian::doccount first,
 			  Xapian::doccount maxitems,
@@ -206,7 +245,8 @@ class Matcher {
 			  Xapian::Enquire::Internal::sort_setting sort_by,
 			  bool sort_val_reverse,
 			  double time_limit,
-			  const std::vector<opt_ptr_spy>& matchspies);
+			  const std::vector<opt_ptr_spy>& matchspies,
+			  unsigned match_threads);
 };
 
 #endif // XAPIAN_INCLUDED_MATCHER_H
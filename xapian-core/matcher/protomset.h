@@ -32,6 +32,7 @@
 #include "spymaster.h"
 
 #include <algorithm>
+#include <atomic>
 
 using Xapian::Internal::intrusive_ptr;
 
@@ -85,6 +86,22 @@ class ProtoMSet {
 
     bool min_weight_pending = false;
 
+    /** Minimum weight threshold shared with other ProtoMSet objects.
+     *
+     *  Used when shards are matched in parallel, each with its own ProtoMSet.
+     *  Each raises this to its own @a min_weight, and uses it in place of its
+     *  own @a min_weight when it is higher.  NULL when not matching in
+     *  parallel.
+     */
+    std::atomic<double>* shared_min_weight = nullptr;
+
+    /** Has @a shared_min_weight been used to prune candidates?
+     *
+     *  If so, we can't assume we've seen all the matching documents just
+     *  because we didn't fill the ProtoMSet.
+     */
+    bool used_shared_min_weight = false;
+
     /** Count of how many known matching documents have been processed so far.
      *
      *  Used to implement "check_at_least".
@@ -171,7 +188,35 @@ class ProtoMSet {
 
     bool full() const { return size() == max_size; }
 
-    double get_min_weight() const { return min_weight; }
+    /** Share the minimum weight threshold with other ProtoMSet objects.
+     *
+     *  This is only valid if results are ordered primarily by weight and
+     *  we're not collapsing, and each ProtoMSet must be for the full
+     *  first + maxitems wanted (i.e. with first set to 0).
+     */
+    void set_shared_min_weight(std::atomic<double>* shared) {
+	shared_min_weight = shared;
+    }
+
+    double get_min_weight() {
+	if (shared_min_weight) {
+	    double shared = shared_min_weight->load(std::memory_order_relaxed);
+	    if (shared > min_weight) {
+		used_shared_min_weight = true;
+		return shared;
+	    }
+	    if (shared < min_weight) {
+		// Publish our higher threshold.  Retry if another thread
+		// raised the shared value meanwhile, unless it's now at least
+		// as high as ours.
+		while (!shared_min_weight->compare_exchange_weak(
+			   shared, min_weight, std::memory_order_relaxed)) {
+		    if (shared >= min_weight) break;
+		}
+	    }
+	}
+	return min_weight;
+    }
 
     void update_max_weight(double weight) {
 	if (weight <= max_weight)
@@ -327,9 +372,10 @@ class ProtoMSet {
 		    break;
 	    }
 
+	    Xapian::docid did = new_item.get_docid();
 	    auto elt = add(std::move(new_item));
-	    if (res != EMPTY && elt != Xapian::doccount(-1)) {
-		collapser.process(res, elt);
+	    if (res != EMPTY) {
+		collapser.process(res, elt, did);
 	    }
 	}
 
@@ -500,7 +546,12 @@ class ProtoMSet {
 	Xapian::doccount uncollapsed_estimated;
 	Xapian::doccount uncollapsed_upper_bound;
 
-	if (!collapser && (!full() || known_matching_docs < check_at_least)) {
+	// If candidates were pruned using a threshold from another ProtoMSet
+	// then not being full or not reaching check_at_least doesn't mean we've
+	// seen all the matching documents.
+	bool seen_all = !used_shared_min_weight &&
+			(!full() || known_matching_docs < check_at_least);
+	if (!collapser && seen_all) {
 	    // Under these conditions we know exactly how many matching docs
 	    // there are for the full match so we don't need to resolve the
 	    // EstimateOp stack.
@@ -529,6 +580,15 @@ class ProtoMSet {
 	    uncollapsed_lower_bound = matches_lower_bound;
 	    uncollapsed_estimated = matches_estimated;
 	    uncollapsed_upper_bound = matches_upper_bound;
+	} else if (collapser && seen_all && !percent_threshold) {
+	    // Every matching document has been checked by the collapser, so
+	    // it knows exactly how many there are with and without collapsing.
+	    matches_lower_bound = collapser.get_matches_lower_bound();
+	    matches_estimated = matches_upper_bound = matches_lower_bound;
+
+	    uncollapsed_lower_bound = collapser.get_docs_considered();
+	    uncollapsed_estimated = uncollapsed_upper_bound =
+		uncollapsed_lower_bound;
 	} else {
 	    matches_lower_bound = 0;
 	    matches_estimated = 0;
@@ -550,7 +610,7 @@ class ProtoMSet {
 	    uncollapsed_estimated = matches_estimated;
 	    uncollapsed_upper_bound = matches_upper_bound;
 
-	    if (!full()) {
+	    if (!full() && !used_shared_min_weight) {
 		// We didn't get all the results requested, so we know that we've
 		// got all there are, and the bounds and estimate are all equal to
 		// that number.
@@ -26,6 +26,7 @@
 #include "backends/leafpostlist.h"
 #include "backends/postlist.h"
 #include "localsubmatch.h"
+#include "wordpairs.h"
 
 class LeafPostList;
 class PostListTree;
@@ -55,6 +56,9 @@ class QueryOptimiser {
 
     bool no_estimates = false;
 
+    /// Does every document have word pair terms?  (-1 means not checked yet)
+    int word_pairs = -1;
+
   public:
     bool need_positions = false;
 
@@ -89,6 +93,19 @@ class QueryOptimiser {
 
     bool get_no_estimates() const { return no_estimates; }
 
+    /** Are there word pair terms for every document in this shard?
+     *
+     *  See TermGenerator::FLAG_WORD_PAIRS.
+     */
+    bool has_word_pairs() {
+	if (word_pairs < 0) {
+	    Xapian::doccount tf;
+	    db.get_freqs(WORD_PAIR_MARKER, &tf, NULL);
+	    word_pairs = (tf == db_size);
+	}
+	return word_pairs;
+    }
+
     void set_no_estimates(bool f) { no_estimates = f; }
 
     /** Create a PostList object for @a term.
@@ -24,6 +24,7 @@
 #include <xapian/intrusive_ptr.h>
 #include <xapian/matchspy.h>
 
+#include <mutex>
 #include <vector>
 
 class SpyMaster {
@@ -32,9 +33,17 @@ class SpyMaster {
     /// The MatchSpy objects to apply.
     const std::vector<opt_ptr_spy>* spies;
 
+    /** Mutex to hold while calling the MatchSpy objects, or NULL.
+     *
+     *  Used when several threads are matching at once, since MatchSpy
+     *  subclasses aren't required to be thread-safe.
+     */
+    std::mutex* spy_mutex;
+
   public:
-    explicit SpyMaster(const std::vector<opt_ptr_spy>* spies_)
-	: spies(spies_->empty() ? NULL : spies_)
+    explicit SpyMaster(const std::vector<opt_ptr_spy>* spies_,
+		       std::mutex* spy_mutex_ = NULL)
+	: spies(spies_->empty() ? NULL : spies_), spy_mutex(spy_mutex_)
     {}
 
     operator bool() const { return spies != NULL; }
@@ -42,6 +51,8 @@ class SpyMaster {
     void operator()(const Xapian::Document& doc,
 		    double weight) {
 	if (spies != NULL) {
+	    std::unique_lock<std::mutex> lock;
+	    if (spy_mutex) lock = std::unique_lock<std::mutex>(*spy_mutex);
 	    for (auto spy : *spies) {
 		(*spy)(doc, weight);
 	    }
@@ -629,6 +629,63 @@ RemoteConnection::get_message(string &result, double end_time)
     RETURN(type);
 }
 
+int
+RemoteConnection::peek_message_type() const
+{
+    if (buffer.size() < 2)
+	return -1;
+    // This code makes the same assumptions about the pack_uint() encoding as
+    // get_message() does.
+    size_t len = static_cast<unsigned char>(buffer[1]);
+    if (len < 128)
+	return buffer.size() >= len + 2 ? static_cast<unsigned char>(buffer[0])
+					: -1;
+    const char* p = buffer.data() + 1;
+    const char* p_end = buffer.data() + buffer.size();
+    if (!unpack_uint(&p, p_end, &len) || size_t(p_end - p) < len)
+	return -1;
+    return static_cast<unsigned char>(buffer[0]);
+}
+
+bool
+RemoteConnection::read_available()
+{
+    LOGCALL(REMOTE, bool, "RemoteConnection::read_available", NO_ARGS);
+    if (fdin == -1)
+	throw_database_closed();
+
+#ifdef __WIN32__
+    // This is only used by TcpServer::run_threaded(), which needs epoll.
+    throw Xapian::UnimplementedError("read_available() not implemented on "
+				     "this platform");
+#else
+    if (fcntl(fdin, F_SETFL, O_NONBLOCK) < 0) {
+	throw Xapian::NetworkError("Failed to set fdin non-blocking-ness",
+				   context, errno);
+    }
+
+    while (true) {
+	char buf[CHUNKSIZE];
+	ssize_t received = read(fdin, buf, sizeof(buf));
+
+	if (received > 0) {
+	    buffer.append(buf, received);
+	    continue;
+	}
+
+	if (received == 0) {
+	    RETURN(false);
+	}
+
+	LOGLINE(REMOTE, "read gave errno = " << errno);
+	if (errno == EINTR) continue;
+	if (errno == EAGAIN) RETURN(true);
+
+	throw Xapian::NetworkError("read failed", context, errno);
+    }
+#endif
+}
+
 int
 RemoteConnection::get_message_chunked(double end_time)
 {
@@ -177,6 +177,25 @@ class RemoteConnection {
      */
     int get_message(std::string &result, double end_time);
 
+    /** Is there a complete message already read into our buffer?
+     *
+     *  If so, get_message() can return it without reading from fdin.
+     */
+    bool message_buffered() const { return peek_message_type() >= 0; }
+
+    /** Get the type of the next message if it's already read into our buffer.
+     *
+     *  @return The message type, or -1 if there isn't a complete message in
+     *		the buffer.
+     */
+    int peek_message_type() const;
+
+    /** Read whatever data is available from fdin without blocking.
+     *
+     *  @return false if EOF was reached, true otherwise.
+     */
+    bool read_available();
+
     /** Prepare to read one message from fdin in chunks.
      *
      *  Sometimes a message can be sufficiently large that you don't want to
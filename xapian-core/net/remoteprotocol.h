@@ -61,7 +61,9 @@
 // 46: pre-2.0.0 Drop unused fields; front-code term names in serialised stats
 // 46.1: pre-2.0.0 MSG_REQUESTDOCUMENT added
 // 47: 2.0.0 Updated Weight::Internal serialisation for db_*_bound
-#define XAPIAN_REMOTE_PROTOCOL_MAJOR_VERSION 47
+// 48: 2.0.0 MSG_REQUESTDOCUMENT tagged with a request id and answered by
+//     REPLY_DOCUMENT, so document fetches can be pipelined
+#define XAPIAN_REMOTE_PROTOCOL_MAJOR_VERSION 48
 #define XAPIAN_REMOTE_PROTOCOL_MINOR_VERSION 0
 
 /** Message types (client -> server).
@@ -109,7 +111,7 @@ enum message_type {
     MSG_ADDSYNONYM,		// Add a synonym
     MSG_REMOVESYNONYM,		// Remove a synonym
     MSG_CLEARSYNONYMS,		// Clear synonyms for a term
-    MSG_REQUESTDOCUMENT,        // Request a document (pre-read hint)
+    MSG_REQUESTDOCUMENT,        // Request a document (pipelined)
     MSG_MAX
 };
 
@@ -145,6 +147,7 @@ enum reply_type {
     REPLY_RECONSTRUCTTEXT,	// Reconstruct document text
     REPLY_SYNONYMTERMLIST,	// Get synonyms for a term
     REPLY_SYNONYMKEYLIST,	// Get terms with an entry in synonym table
+    REPLY_DOCUMENT,		// Requested document (pipelined)
     REPLY_MAX
 };
 
@@ -32,6 +32,7 @@
 #include "xapian/valueiterator.h"
 
 #include <signal.h>
+#include <algorithm>
 #include <cerrno>
 #include <cstdlib>
 #include <memory>
@@ -155,167 +156,196 @@ RemoteServer::send_message(reply_type type, string_view message)
 
 typedef void (RemoteServer::* dispatch_func)(const string &);
 
-void
-RemoteServer::run()
+bool
+RemoteServer::run_one()
 {
-    while (true) {
-	try {
-	    string message;
-	    size_t type = get_message(idle_timeout, message);
-	    switch (type) {
-		case MSG_ALLTERMS:
-		    msg_allterms(message);
-		    continue;
-		case MSG_COLLFREQ:
-		    msg_collfreq(message);
-		    continue;
-		case MSG_DOCUMENT:
-		    msg_document(message);
-		    continue;
-		case MSG_TERMEXISTS:
-		    msg_termexists(message);
-		    continue;
-		case MSG_TERMFREQ:
-		    msg_termfreq(message);
-		    continue;
-		case MSG_VALUESTATS:
-		    msg_valuestats(message);
-		    continue;
-		case MSG_KEEPALIVE:
-		    msg_keepalive(message);
-		    continue;
-		case MSG_DOCLENGTH:
-		    msg_doclength(message);
-		    continue;
-		case MSG_QUERY:
-		    msg_query(message);
-		    continue;
-		case MSG_TERMLIST:
-		    msg_termlist(message);
-		    continue;
-		case MSG_POSITIONLIST:
-		    msg_positionlist(message);
-		    continue;
-		case MSG_POSTLIST:
-		    msg_postlist(message);
-		    continue;
-		case MSG_REOPEN:
-		    msg_reopen(message);
-		    continue;
-		case MSG_UPDATE:
-		    msg_update(message);
-		    continue;
-		case MSG_ADDDOCUMENT:
-		    msg_adddocument(message);
-		    continue;
-		case MSG_CANCEL:
-		    msg_cancel(message);
-		    continue;
-		case MSG_DELETEDOCUMENTTERM:
-		    msg_deletedocumentterm(message);
-		    continue;
-		case MSG_COMMIT:
-		    msg_commit(message);
-		    continue;
-		case MSG_REPLACEDOCUMENT:
-		    msg_replacedocument(message);
-		    continue;
-		case MSG_REPLACEDOCUMENTTERM:
-		    msg_replacedocumentterm(message);
-		    continue;
-		case MSG_DELETEDOCUMENT:
-		    msg_deletedocument(message);
-		    continue;
-		case MSG_WRITEACCESS:
-		    msg_writeaccess(message);
-		    continue;
-		case MSG_GETMETADATA:
-		    msg_getmetadata(message);
-		    continue;
-		case MSG_SETMETADATA:
-		    msg_setmetadata(message);
-		    continue;
-		case MSG_REQUESTDOCUMENT:
-		    msg_requestdocument(message);
-		    continue;
-		case MSG_ADDSPELLING:
-		    msg_addspelling(message);
-		    continue;
-		case MSG_REMOVESPELLING:
-		    msg_removespelling(message);
-		    continue;
-		case MSG_METADATAKEYLIST:
-		    msg_metadatakeylist(message);
-		    continue;
-		case MSG_FREQS:
-		    msg_freqs(message);
-		    continue;
-		case MSG_UNIQUETERMS:
-		    msg_uniqueterms(message);
-		    continue;
-		case MSG_WDFDOCMAX:
-		    msg_wdfdocmax(message);
-		    continue;
-		case MSG_POSITIONLISTCOUNT:
-		    msg_positionlistcount(message);
-		    continue;
-		case MSG_RECONSTRUCTTEXT:
-		    msg_reconstructtext(message);
-		    continue;
-		case MSG_SYNONYMTERMLIST:
-		    msg_synonymtermlist(message);
-		    continue;
-		case MSG_SYNONYMKEYLIST:
-		    msg_synonymkeylist(message);
-		    continue;
-		case MSG_ADDSYNONYM:
-		    msg_addsynonym(message);
-		    continue;
-		case MSG_REMOVESYNONYM:
-		    msg_removesynonym(message);
-		    continue;
-		case MSG_CLEARSYNONYMS:
-		    msg_clearsynonyms(message);
-		    continue;
-		default: {
-		    // MSG_GETMSET - used during a conversation.
-		    // MSG_SHUTDOWN - handled by get_message().
-		    string errmsg("Unexpected message type ");
-		    errmsg += str(type);
-		    throw Xapian::InvalidArgumentError(errmsg);
-		}
-	    }
-	} catch (const Xapian::NetworkTimeoutError & e) {
-	    try {
-		// We've had a timeout, so the client may not be listening, so
-		// set the end_time to 1 and if we can't send the message right
-		// away, just exit and the client will cope.
-		send_message(REPLY_EXCEPTION, serialise_error(e), 1.0);
-	    } catch (...) {
+    try {
+	string message;
+	size_t type = get_message(idle_timeout, message);
+	switch (type) {
+	    case MSG_ALLTERMS:
+		msg_allterms(message);
+		return true;
+	    case MSG_COLLFREQ:
+		msg_collfreq(message);
+		return true;
+	    case MSG_DOCUMENT:
+		msg_document(message);
+		return true;
+	    case MSG_TERMEXISTS:
+		msg_termexists(message);
+		return true;
+	    case MSG_TERMFREQ:
+		msg_termfreq(message);
+		return true;
+	    case MSG_VALUESTATS:
+		msg_valuestats(message);
+		return true;
+	    case MSG_KEEPALIVE:
+		msg_keepalive(message);
+		return true;
+	    case MSG_DOCLENGTH:
+		msg_doclength(message);
+		return true;
+	    case MSG_QUERY:
+		msg_query(message);
+		return true;
+	    case MSG_TERMLIST:
+		msg_termlist(message);
+		return true;
+	    case MSG_POSITIONLIST:
+		msg_positionlist(message);
+		return true;
+	    case MSG_POSTLIST:
+		msg_postlist(message);
+		return true;
+	    case MSG_REOPEN:
+		msg_reopen(message);
+		return true;
+	    case MSG_UPDATE:
+		msg_update(message);
+		return true;
+	    case MSG_ADDDOCUMENT:
+		msg_adddocument(message);
+		return true;
+	    case MSG_CANCEL:
+		msg_cancel(message);
+		return true;
+	    case MSG_DELETEDOCUMENTTERM:
+		msg_deletedocumentterm(message);
+		return true;
+	    case MSG_COMMIT:
+		msg_commit(message);
+		return true;
+	    case MSG_REPLACEDOCUMENT:
+		msg_replacedocument(message);
+		return true;
+	    case MSG_REPLACEDOCUMENTTERM:
+		msg_replacedocumentterm(message);
+		return true;
+	    case MSG_DELETEDOCUMENT:
+		msg_deletedocument(message);
+		return true;
+	    case MSG_WRITEACCESS:
+		msg_writeaccess(message);
+		return true;
+	    case MSG_GETMETADATA:
+		msg_getmetadata(message);
+		return true;
+	    case MSG_SETMETADATA:
+		msg_setmetadata(message);
+		return true;
+	    case MSG_REQUESTDOCUMENT:
+		msg_requestdocument(message);
+		return true;
+	    case MSG_ADDSPELLING:
+		msg_addspelling(message);
+		return true;
+	    case MSG_REMOVESPELLING:
+		msg_removespelling(message);
+		return true;
+	    case MSG_METADATAKEYLIST:
+		msg_metadatakeylist(message);
+		return true;
+	    case MSG_FREQS:
+		msg_freqs(message);
+		return true;
+	    case MSG_UNIQUETERMS:
+		msg_uniqueterms(message);
+		return true;
+	    case MSG_WDFDOCMAX:
+		msg_wdfdocmax(message);
+		return true;
+	    case MSG_POSITIONLISTCOUNT:
+		msg_positionlistcount(message);
+		return true;
+	    case MSG_RECONSTRUCTTEXT:
+		msg_reconstructtext(message);
+		return true;
+	    case MSG_SYNONYMTERMLIST:
+		msg_synonymtermlist(message);
+		return true;
+	    case MSG_SYNONYMKEYLIST:
+		msg_synonymkeylist(message);
+		return true;
+	    case MSG_ADDSYNONYM:
+		msg_addsynonym(message);
+		return true;
+	    case MSG_REMOVESYNONYM:
+		msg_removesynonym(message);
+		return true;
+	    case MSG_CLEARSYNONYMS:
+		msg_clearsynonyms(message);
+		return true;
+	    default: {
+		// MSG_GETMSET - used during a conversation.
+		// MSG_SHUTDOWN - handled by get_message().
+		string errmsg("Unexpected message type ");
+		errmsg += str(type);
+		throw Xapian::InvalidArgumentError(errmsg);
 	    }
-	    // And rethrow it so our caller can log it and close the
-	    // connection.
-	    throw;
-	} catch (const Xapian::NetworkError &) {
-	    // All other network errors mean we are fatally confused and are
-	    // unlikely to be able to communicate further across this
-	    // connection.  So we don't try to propagate the error to the
-	    // client, but instead just rethrow the exception so our caller can
-	    // log it and close the connection.
-	    throw;
-	} catch (const Xapian::Error &e) {
-	    // Propagate the exception to the client, then return to the main
-	    // message handling loop.
-	    send_message(REPLY_EXCEPTION, serialise_error(e));
-	} catch (ConnectionClosed &) {
-	    return;
+	}
+    } catch (const Xapian::NetworkTimeoutError & e) {
+	try {
+	    // We've had a timeout, so the client may not be listening, so
+	    // set the end_time to 1 and if we can't send the message right
+	    // away, just exit and the client will cope.
+	    send_message(REPLY_EXCEPTION, serialise_error(e), 1.0);
 	} catch (...) {
-	    // Propagate an unknown exception to the client.
-	    send_message(REPLY_EXCEPTION, {});
-	    // And rethrow it so our caller can log it and close the
-	    // connection.
-	    throw;
 	}
+	// And rethrow it so our caller can log it and close the
+	// connection.
+	throw;
+    } catch (const Xapian::NetworkError &) {
+	// All other network errors mean we are fatally confused and are
+	// unlikely to be able to communicate further across this
+	// connection.  So we don't try to propagate the error to the
+	// client, but instead just rethrow the exception so our caller can
+	// log it and close the connection.
+	throw;
+    } catch (const Xapian::Error &e) {
+	// Propagate the exception to the client, then return to the main
+	// message handling loop.
+	send_message(REPLY_EXCEPTION, serialise_error(e));
+    } catch (ConnectionClosed &) {
+	return false;
+    } catch (...) {
+	// Propagate an unknown exception to the client.
+	send_message(REPLY_EXCEPTION, {});
+	// And rethrow it so our caller can log it and close the
+	// connection.
+	throw;
+    }
+    return true;
+}
+
+void
+RemoteServer::run()
+{
+    while (run_one()) { }
+}
+
+bool
+RemoteServer::message_buffered() const
+{
+    return RemoteConnection::message_buffered();
+}
+
+bool
+RemoteServer::read_available()
+{
+    return RemoteConnection::read_available();
+}
+
+void
+RemoteServer::idle_timeout_expired()
+{
+    Xapian::NetworkTimeoutError e("Timeout expired while trying to read",
+				  context);
+    try {
+	// As in run_one(), the client may not be listening so don't wait.
+	send_message(REPLY_EXCEPTION, serialise_error(e), 1.0);
+    } catch (...) {
     }
 }
 
@@ -660,7 +690,7 @@ RemoteServer::msg_query(const string &message_in)
 					 percent_threshold, weight_threshold,
 					 order,
 					 sort_key, sort_by, sort_value_forward,
-					 time_limit, matchspies);
+					 time_limit, matchspies, 1);
     // FIXME: The local side already has these stats, except for the maxpart
     // information.
     mset.internal->set_stats(total_stats.release());
@@ -964,15 +994,54 @@ RemoteServer::msg_setmetadata(const string & message)
 void
 RemoteServer::msg_requestdocument(const string& message)
 {
-    const char* p = message.data();
-    const char* p_end = p + message.size();
-    Xapian::docid did;
-    if (!unpack_uint_last(&p, p_end, &did)) {
-	throw Xapian::NetworkError("Bad MSG_REQUESTDOCUMENT");
+    // The client doesn't wait for the reply before sending its next message,
+    // so gather up all the document requests which have already arrived and
+    // answer them together.  Each reply is tagged with the request id so we
+    // can reply in whatever order is most efficient - we use docid order
+    // which gives better locality of reference.
+    vector<pair<Xapian::docid, unsigned>> requests;
+    string msg = message;
+    while (true) {
+	const char* p = msg.data();
+	const char* p_end = p + msg.size();
+	unsigned request_id;
+	Xapian::docid did;
+	if (!unpack_uint(&p, p_end, &request_id) ||
+	    !unpack_uint_last(&p, p_end, &did)) {
+	    throw Xapian::NetworkError("Bad MSG_REQUESTDOCUMENT");
+	}
+	requests.emplace_back(did, request_id);
+	if (RemoteConnection::peek_message_type() != MSG_REQUESTDOCUMENT)
+	    break;
+	get_message(active_timeout, msg, MSG_REQUESTDOCUMENT);
+    }
+
+    sort(requests.begin(), requests.end());
+    // Let the backend know which documents we're going to want.
+    for (auto&& request : requests) {
+	if (request.first) db->internal->request_document(request.first);
     }
-    db->internal->request_document(did);
 
-    send_message(REPLY_DONE, string());
+    for (auto&& request : requests) {
+	string reply;
+	pack_uint(reply, request.second);
+	try {
+	    Xapian::Document doc = db->get_document(request.first);
+	    reply += '\0';
+	    pack_string(reply, doc.get_data());
+	    for (auto i = doc.values_begin(); i != doc.values_end(); ++i) {
+		pack_uint(reply, i.get_valueno());
+		pack_string(reply, *i);
+	    }
+	} catch (const Xapian::Error& e) {
+	    // Report the error when the client tries to use the document.
+	    reply.resize(0);
+	    pack_uint(reply, request.second);
+	    reply += '\1';
+	    reply += serialise_error(e);
+	}
+	send_message(REPLY_DOCUMENT, reply);
+    }
 }
 
 void
@@ -267,6 +267,36 @@ class XAPIAN_VISIBILITY_DEFAULT RemoteServer : private RemoteConnection {
      */
     void run();
 
+    /** Accept a single message from the client and process it.
+     *
+     *  @return false if the client closed the connection, true otherwise.
+     *
+     *  Exceptions are handled as for run().
+     */
+    bool run_one();
+
+    /** Is there a complete message from the client already buffered?
+     *
+     *  If so, run_one() can be called to process it without waiting for
+     *  the socket to become readable.
+     */
+    bool message_buffered() const;
+
+    /** Read whatever data from the client is available without blocking.
+     *
+     *  @return false if the client has closed the connection, true
+     *		otherwise.
+     */
+    bool read_available();
+
+    /** Tell the client that the connection has been idle for too long.
+     *
+     *  This sends the same exception run() would have when the idle timeout
+     *  expires.  Any error sending it is ignored since the client may have
+     *  gone away.
+     */
+    void idle_timeout_expired();
+
     /// Set the registry used for (un)serialisation.
     void set_registry(const Xapian::Registry & reg_) { reg = reg_; }
 };
@@ -43,6 +43,18 @@
 # include <sys/wait.h>
 #endif
 
+#ifdef HAVE_EPOLL_CREATE1
+# include <sys/epoll.h>
+# include "realtime.h"
+# include <condition_variable>
+# include <deque>
+# include <mutex>
+# include <system_error>
+# include <thread>
+# include <unordered_map>
+# include <vector>
+#endif
+
 #include <iostream>
 #include <limits>
 
@@ -459,6 +471,294 @@ TcpServer::run()
 # error Neither HAVE_FORK nor __WIN32__ are defined.
 #endif
 
+unique_ptr<TcpServer::ThreadedWorker>
+TcpServer::create_worker()
+{
+    throw Xapian::UnimplementedError("This server doesn't support threaded "
+				     "mode");
+}
+
+unique_ptr<TcpServer::ThreadedConnection>
+TcpServer::open_connection(int, ThreadedWorker&)
+{
+    throw Xapian::UnimplementedError("This server doesn't support threaded "
+				     "mode");
+}
+
+#ifdef HAVE_EPOLL_CREATE1
+
+namespace {
+
+/// A connection being serviced by run_threaded().
+struct ThreadedSlot {
+    int fd;
+
+    /// NULL until open_connection() has been called.
+    unique_ptr<TcpServer::ThreadedConnection> conn;
+
+    /// Is a worker thread servicing (or queued to service) this connection?
+    bool busy = true;
+
+    /// Has fd been added to the epoll set?
+    bool registered = false;
+
+    /// When the connection will be closed if no request arrives (0 = never).
+    double deadline = 0.0;
+
+    explicit ThreadedSlot(int fd_) : fd(fd_) { }
+};
+
+/** State shared between the main thread and the workers in run_threaded().
+ *
+ *  A connection's fd is only armed in the epoll set while no worker is
+ *  servicing it (we use EPOLLONESHOT), so each connection is only ever
+ *  touched by one thread at a time.
+ */
+class ThreadPool {
+    TcpServer& server;
+
+    int epfd;
+
+    double idle_timeout;
+
+    bool verbose;
+
+    /// Protects all the members below.
+    mutex m;
+
+    condition_variable cv;
+
+    unordered_map<int, unique_ptr<ThreadedSlot>> slots;
+
+    /// Connections waiting for a worker.
+    deque<ThreadedSlot*> queue;
+
+    bool stopping = false;
+
+    /// Close a connection.  The caller must hold m.
+    void close_slot(ThreadedSlot* slot) {
+	int fd = slot->fd;
+	// Closing fd removes it from the epoll set.
+	slots.erase(fd);
+	close(fd);
+	if (verbose) cout << "Connection closed.\n";
+    }
+
+  public:
+    ThreadPool(TcpServer& server_, int epfd_, double idle_timeout_,
+	       bool verbose_)
+	: server(server_), epfd(epfd_), idle_timeout(idle_timeout_),
+	  verbose(verbose_) { }
+
+    ~ThreadPool() {
+	for (auto& i : slots) {
+	    close(i.first);
+	}
+    }
+
+    /// Hand a connection to a worker.  The caller must hold m.
+    void dispatch(ThreadedSlot* slot) {
+	slot->busy = true;
+	queue.push_back(slot);
+	cv.notify_one();
+    }
+
+    /// Add a newly accepted connection.
+    void add(int fd) {
+	lock_guard<mutex> lock(m);
+	auto slot = new ThreadedSlot(fd);
+	slots[fd].reset(slot);
+	dispatch(slot);
+    }
+
+    /// Handle epoll reporting fd as readable (or closed).
+    void ready(int fd) {
+	lock_guard<mutex> lock(m);
+	auto i = slots.find(fd);
+	if (i != slots.end() && !i->second->busy)
+	    dispatch(i->second.get());
+    }
+
+    /// Close connections which have been idle for too long.
+    void close_idle(double now) {
+	if (idle_timeout == 0.0) return;
+	vector<unique_ptr<ThreadedSlot>> expired;
+	{
+	    lock_guard<mutex> lock(m);
+	    for (auto i = slots.begin(); i != slots.end(); ) {
+		ThreadedSlot* slot = i->second.get();
+		if (slot->busy || slot->deadline > now) {
+		    ++i;
+		    continue;
+		}
+		(void)epoll_ctl(epfd, EPOLL_CTL_DEL, slot->fd, nullptr);
+		expired.push_back(std::move(i->second));
+		i = slots.erase(i);
+	    }
+	}
+	// No other thread can see these connections now, so we can talk to
+	// the clients without holding the lock.
+	for (auto& slot : expired) {
+	    try {
+		slot->conn->idle_timeout();
+	    } catch (...) {
+	    }
+	    slot->conn.reset();
+	    close(slot->fd);
+	    if (verbose) cout << "Connection closed (idle).\n";
+	}
+    }
+
+    /// Tell the workers to exit.
+    void stop() {
+	lock_guard<mutex> lock(m);
+	stopping = true;
+	cv.notify_all();
+    }
+
+    /// The main loop of a worker thread.
+    void work(TcpServer::ThreadedWorker& worker) {
+	while (true) {
+	    ThreadedSlot* slot;
+	    {
+		unique_lock<mutex> lock(m);
+		cv.wait(lock, [this]() { return stopping || !queue.empty(); });
+		if (stopping) return;
+		slot = queue.front();
+		queue.pop_front();
+	    }
+
+	    bool keep = false;
+	    try {
+		if (!slot->conn) {
+		    slot->conn = server.open_connection(slot->fd, worker);
+		    keep = true;
+		} else {
+		    keep = slot->conn->handle_requests(worker);
+		}
+	    } catch (const Xapian::Error& e) {
+		cerr << "Caught " << e.get_description() << '\n';
+	    } catch (...) {
+		cerr << "Caught unknown exception\n";
+	    }
+
+	    lock_guard<mutex> lock(m);
+	    if (keep) {
+		epoll_event ev;
+		ev.events = EPOLLIN | EPOLLONESHOT;
+		ev.data.fd = slot->fd;
+		int op = slot->registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+		if (epoll_ctl(epfd, op, slot->fd, &ev) == 0) {
+		    slot->registered = true;
+		    slot->busy = false;
+		    slot->deadline = RealTime::end_time(idle_timeout);
+		    continue;
+		}
+		cerr << "Caught NetworkError: epoll_ctl failed ("
+		     << strerror(errno) << ")\n";
+	    }
+	    close_slot(slot);
+	}
+    }
+};
+
+}
+
+void
+TcpServer::run_threaded(unsigned n_threads, double idle_timeout)
+{
+    if (n_threads == 0) {
+	throw Xapian::InvalidArgumentError("n_threads must be at least 1");
+    }
+
+    // Create the per-thread state up front so that errors (e.g. failing to
+    // open a database) are reported to our caller.
+    vector<unique_ptr<ThreadedWorker>> workers;
+    for (unsigned i = 0; i != n_threads; ++i) {
+	workers.push_back(create_worker());
+    }
+
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0) {
+	throw Xapian::NetworkError("epoll_create1 failed", errno);
+    }
+
+    epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = listener;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, listener, &ev) < 0) {
+	int epoll_errno = errno;
+	close(epfd);
+	throw Xapian::NetworkError("epoll_ctl failed", epoll_errno);
+    }
+
+    ThreadPool pool(*this, epfd, idle_timeout, verbose);
+    vector<thread> threads;
+    threads.reserve(n_threads);
+    for (auto& worker : workers) {
+	try {
+	    threads.emplace_back([&pool, &worker]() { pool.work(*worker); });
+	} catch (const std::system_error&) {
+	    // Run with the threads we managed to create.
+	    if (threads.empty()) {
+		close(epfd);
+		throw Xapian::NetworkError("Couldn't create any threads");
+	    }
+	    break;
+	}
+    }
+
+    // How often to check for idle connections (in seconds).
+    const int IDLE_CHECK_INTERVAL = 1;
+    double next_idle_check = RealTime::now() + IDLE_CHECK_INTERVAL;
+    try {
+	const int MAX_EVENTS = 64;
+	epoll_event events[MAX_EVENTS];
+	while (true) {
+	    int n = epoll_wait(epfd, events, MAX_EVENTS,
+			       IDLE_CHECK_INTERVAL * 1000);
+	    if (n < 0) {
+		if (errno == EINTR) continue;
+		throw Xapian::NetworkError("epoll_wait failed", errno);
+	    }
+	    for (int i = 0; i != n; ++i) {
+		int fd = events[i].data.fd;
+		if (fd != listener) {
+		    pool.ready(fd);
+		    continue;
+		}
+		try {
+		    pool.add(accept_connection());
+		} catch (const Xapian::Error& e) {
+		    cerr << "Caught " << e.get_description() << '\n';
+		}
+	    }
+	    double now = RealTime::now();
+	    if (now >= next_idle_check) {
+		pool.close_idle(now);
+		next_idle_check = now + IDLE_CHECK_INTERVAL;
+	    }
+	}
+    } catch (...) {
+	pool.stop();
+	for (auto& t : threads) {
+	    t.join();
+	}
+	close(epfd);
+	throw;
+    }
+}
+
+#else
+
+void
+TcpServer::run_threaded(unsigned, double)
+{
+    throw Xapian::UnimplementedError("Threaded mode requires epoll");
+}
+
+#endif
+
 void
 TcpServer::run_once()
 {
@@ -30,6 +30,7 @@
 
 #include <xapian/visibility.h>
 
+#include <memory>
 #include <string>
 
 /** Generic TCP/IP socket based server base class. */
@@ -83,11 +84,87 @@ class XAPIAN_VISIBILITY_DEFAULT TcpServer SOCKET_INITIALIZER_MIXIN {
     /** Accept a single connection, service requests on it, then stop.  */
     void run_once();
 
+    /** Per-thread state for run_threaded().
+     *
+     *  Subclasses can use this to hold resources which are expensive to
+     *  create but can't be shared between threads (such as Database
+     *  objects).
+     */
+    class ThreadedWorker {
+      public:
+	virtual ~ThreadedWorker() { }
+    };
+
+    /** Per-connection state for run_threaded().
+     *
+     *  Each connection is only ever serviced by one thread at a time, but
+     *  may be serviced by a different thread each time it becomes readable.
+     */
+    class ThreadedConnection {
+      public:
+	virtual ~ThreadedConnection() { }
+
+	/** Service requests which are waiting on the connection.
+	 *
+	 *  Called when the socket is readable.  This should process all the
+	 *  requests which can be processed without blocking, then return.
+	 *
+	 *  @param worker	The state for the thread calling this method.
+	 *
+	 *  @return true to keep the connection open, or false to close it.
+	 */
+	virtual bool handle_requests(ThreadedWorker& worker) = 0;
+
+	/// Called before a connection is closed due to being idle.
+	virtual void idle_timeout() { }
+    };
+
+    /** Accept connections and service requests indefinitely using threads.
+     *
+     *  Rather than using a process or thread per connection like run()
+     *  does, the connections are monitored using epoll and serviced by a
+     *  fixed-size pool of threads as requests arrive, so idle connections
+     *  are cheap.
+     *
+     *  This is currently only supported on platforms with epoll (e.g.
+     *  Linux) - elsewhere Xapian::UnimplementedError is thrown.
+     *
+     *  @param n_threads	The number of threads to use to service
+     *				requests (must be at least 1).
+     *  @param idle_timeout	Close connections which have been idle for
+     *				this long (in seconds).
+     */
+    void run_threaded(unsigned n_threads, double idle_timeout);
+
     /// Should we produce output when connections are made or lost?
     bool get_verbose() const { return verbose; }
 
     /// Handle a single connection on an already connected socket.
     virtual void handle_one_connection(int socket) = 0;
+
+    /** Create the per-thread state for run_threaded().
+     *
+     *  This is called in the thread calling run_threaded() once for each
+     *  thread, before any connections are accepted, so any exception thrown
+     *  will propagate out of run_threaded().
+     *
+     *  The default implementation throws Xapian::UnimplementedError.
+     */
+    virtual std::unique_ptr<ThreadedWorker> create_worker();
+
+    /** Start servicing a new connection for run_threaded().
+     *
+     *  This is called in a worker thread soon after the connection is
+     *  accepted, so can send a greeting to the client if the protocol
+     *  requires one.
+     *
+     *  @param socket	The connected socket.
+     *  @param worker	The state for the thread calling this method.
+     *
+     *  The default implementation throws Xapian::UnimplementedError.
+     */
+    virtual std::unique_ptr<ThreadedConnection>
+    open_connection(int socket, ThreadedWorker& worker);
 };
 
 #endif // XAPIAN_INCLUDED_TCPSERVER_H
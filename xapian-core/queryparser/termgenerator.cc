@@ -64,6 +64,9 @@ TermGenerator::set_document(const Xapian::Document & doc)
 {
     internal->doc = doc;
     internal->cur_pos = 0;
+    internal->pair_pos = 0;
+    internal->pair_prev.clear();
+    internal->pair_cur.clear();
 }
 
 const Xapian::Document &
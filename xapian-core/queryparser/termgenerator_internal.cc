@@ -31,6 +31,7 @@
 #include <xapian/unicode.h>
 
 #include "stringutils.h"
+#include "wordpairs.h"
 
 #include <algorithm>
 #include <cmath>
@@ -284,6 +285,33 @@ endofterm:
     }
 }
 
+void
+TermGenerator::Internal::add_posting(const string& term,
+				     termpos pos,
+				     termcount wdf_inc)
+{
+    doc.add_posting(term, pos, wdf_inc);
+    if (!(flags & FLAG_WORD_PAIRS)) return;
+
+    if (pos != pair_pos) {
+	if (pos == pair_pos + 1) {
+	    swap(pair_prev, pair_cur);
+	} else {
+	    pair_prev.clear();
+	}
+	pair_cur.clear();
+	pair_pos = pos;
+    }
+    // Word pair terms have wdf 0 so they don't change document lengths (and
+    // so don't affect weighting).
+    string pair;
+    for (const string& prev : pair_prev) {
+	if (make_word_pair(pair, prev, term))
+	    doc.add_term(pair, 0);
+    }
+    pair_cur.push_back(term);
+}
+
 void
 TermGenerator::Internal::index_text(Utf8Iterator itor, termcount wdf_inc,
 				    string_view prefix, bool with_positions)
@@ -322,6 +350,9 @@ TermGenerator::Internal::index_text(Utf8Iterator itor, termcount wdf_inc,
     prefixed_stemmed_term.append(prefix);
     auto prefixed_stemmed_size = prefixed_stemmed_term.size();
 
+    if (with_positions && (flags & FLAG_WORD_PAIRS))
+	doc.add_term(WORD_PAIR_MARKER, 0);
+
     parse_terms(itor, break_flags, with_positions,
 	[=, &prefixed_term, &prefixed_stemmed_term
 #if __cplusplus >= 201907L
@@ -344,7 +375,7 @@ TermGenerator::Internal::index_text(Utf8Iterator itor, termcount wdf_inc,
 		if (positional) {
 		    if (rare(cur_pos >= pos_limit))
 			throw Xapian::RangeError("termpos limit exceeded");
-		    doc.add_posting(prefixed_term, ++cur_pos, wdf_inc);
+		    add_posting(prefixed_term, ++cur_pos, wdf_inc);
 		} else {
 		    doc.add_term(prefixed_term, wdf_inc);
 		}
@@ -380,7 +411,7 @@ TermGenerator::Internal::index_text(Utf8Iterator itor, termcount wdf_inc,
 			throw Xapian::RangeError("termpos limit exceeded");
 		    ++cur_pos;
 		}
-		doc.add_posting(prefixed_stemmed_term, cur_pos, wdf_inc);
+		add_posting(prefixed_stemmed_term, cur_pos, wdf_inc);
 	    } else {
 		doc.add_term(prefixed_stemmed_term, wdf_inc);
 	    }
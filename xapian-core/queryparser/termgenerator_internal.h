@@ -28,6 +28,9 @@
 #include <xapian/queryparser.h> // For Xapian::Stopper
 #include <xapian/stem.h>
 
+#include <string>
+#include <vector>
+
 namespace Xapian {
 
 class Stopper;
@@ -45,6 +48,18 @@ class TermGenerator::Internal : public Xapian::Internal::intrusive_base {
     unsigned max_word_length = 64;
     WritableDatabase db;
 
+    /// Position of the terms in pair_cur (for FLAG_WORD_PAIRS).
+    termpos pair_pos = 0;
+
+    /// Terms at position pair_pos - 1 (for FLAG_WORD_PAIRS).
+    std::vector<std::string> pair_prev;
+
+    /// Terms at position pair_pos (for FLAG_WORD_PAIRS).
+    std::vector<std::string> pair_cur;
+
+    /// Add a term with positional information.
+    void add_posting(const std::string& term, termpos pos, termcount wdf_inc);
+
   public:
     Internal() { }
 
@@ -1057,6 +1057,39 @@ DEFINE_TESTCASE(fetchdocs1, backend) {
     TEST_EQUAL(it1, mymset2.end());
 }
 
+/** Test fetching documents interleaved with other requests.
+ *
+ *  With the remote backend, fetched documents are pipelined and the replies
+ *  may arrive before the replies to other requests.
+ */
+DEFINE_TESTCASE(fetchdocs2, backend) {
+    Xapian::Database db(get_database("apitest_simpledata"));
+    Xapian::Enquire enquire(db);
+    enquire.set_query(Xapian::Query("this"));
+    Xapian::MSet mset = enquire.get_mset(0, 10);
+    TEST(mset.size() > 2);
+
+    mset.fetch();
+    // Fetching again should be harmless.
+    mset.fetch();
+    TEST_EQUAL(db.get_termfreq("this"), mset.get_termfreq("this"));
+    // Open the documents in reverse order.
+    Xapian::doccount i = mset.size();
+    while (i-- > 0) {
+	Xapian::docid did = *mset[i];
+	Xapian::Document doc = mset[i].get_document();
+	TEST_EQUAL(doc.get_data(), db.get_document(did).get_data());
+	TEST_EQUAL(doc.values_count(), db.get_document(did).values_count());
+	TEST(db.get_doclength(did) > 0);
+    }
+
+    // Documents fetched before reopen() should still be readable after.
+    mset.fetch();
+    db.reopen();
+    TEST_EQUAL(mset[0].get_document().get_data(),
+	       db.get_document(*mset[0]).get_data());
+}
+
 // test that searching for a term not in the database fails nicely
 DEFINE_TESTCASE(absentterm1, backend) {
     Xapian::Enquire enquire(get_database("apitest_simpledata"));
@@ -2298,3 +2331,174 @@ DEFINE_TESTCASE(uuid1, backend && !multi) {
     TEST(db2.get_uuid().empty());
 #endif
 }
+
+// Check matching shards in parallel gives the same results as in turn.
+DEFINE_TESTCASE(matchthreads1, backend) {
+    Xapian::Database db = get_database("etext");
+    Xapian::Enquire enquire(db);
+    Xapian::Enquire enquire_threaded(db);
+    enquire_threaded.set_match_threads(4);
+
+    const Xapian::Query queries[] = {
+	Xapian::Query("prussian"),
+	Xapian::Query(Xapian::Query::OP_OR,
+		      Xapian::Query("the"), Xapian::Query("king")),
+	Xapian::Query(Xapian::Query::OP_AND,
+		      Xapian::Query("the"), Xapian::Query("of")),
+	Xapian::Query(Xapian::Query::OP_AND_MAYBE,
+		      Xapian::Query("war"), Xapian::Query("peace")),
+	Xapian::Query(Xapian::Query::OP_SCALE_WEIGHT,
+		      Xapian::Query("the"), 0.0),
+    };
+    Xapian::doccount db_size = db.get_doccount();
+    for (auto&& q : queries) {
+	enquire.set_query(q);
+	enquire_threaded.set_query(q);
+	for (int setting = 0; setting < 7; ++setting) {
+	    for (auto e : { &enquire, &enquire_threaded }) {
+		e->set_sort_by_relevance();
+		e->set_docid_order(Xapian::Enquire::ASCENDING);
+		e->set_collapse_key(Xapian::BAD_VALUENO);
+		e->set_cutoff(0);
+		switch (setting) {
+		    case 1:
+			e->set_docid_order(Xapian::Enquire::DESCENDING);
+			break;
+		    case 2:
+			e->set_sort_by_value(11, true);
+			break;
+		    case 3:
+			e->set_sort_by_relevance_then_value(1, false);
+			break;
+		    case 4:
+			e->set_collapse_key(12);
+			break;
+		    case 5:
+			e->set_collapse_key(1, 2);
+			e->set_sort_by_value_then_relevance(11, false);
+			break;
+		    case 6:
+			e->set_cutoff(40);
+			break;
+		}
+	    }
+	    for (Xapian::doccount first : { 0, 3 }) {
+		for (Xapian::doccount check_at_least : { 0u, 20u, db_size }) {
+		    tout << q.get_description() << " setting " << setting
+			 << " first " << first
+			 << " check_at_least " << check_at_least << '\n';
+		    auto mset = enquire.get_mset(first, 10, check_at_least);
+		    auto mset_threaded = enquire_threaded.get_mset(first, 10,
+								   check_at_least);
+		    if (setting == 6 && check_at_least != db_size &&
+			db.size() > 1) {
+			// When matching in turn, a percentage cutoff is
+			// applied using the highest weight seen so far, so
+			// unless every document is checked the results depend
+			// on the order they're seen in.  Merging the shards
+			// applies the cutoff using the highest weight overall,
+			// which gives the same results as checking everything.
+			auto mset_all = enquire.get_mset(first, 10, db_size);
+			TEST_EQUAL(mset_all.size(), mset_threaded.size());
+			if (!mset_all.empty()) {
+			    TEST(mset_range_is_same(mset_all, 0,
+						    mset_threaded, 0,
+						    mset_all.size()));
+			}
+			continue;
+		    }
+		    TEST_EQUAL(mset.size(), mset_threaded.size());
+		    if (!mset.empty()) {
+			TEST(mset_range_is_same(mset, 0, mset_threaded, 0,
+						mset.size()));
+			TEST(mset_range_is_same_weights(mset, 0,
+							mset_threaded, 0,
+							mset.size()));
+		    }
+		    for (Xapian::doccount i = 0; i != mset.size(); ++i) {
+			TEST_EQUAL(mset[i].get_percent(),
+				   mset_threaded[i].get_percent());
+		    }
+		    TEST_EQUAL_DOUBLE(mset.get_max_possible(),
+				      mset_threaded.get_max_possible());
+		    TEST_EQUAL_DOUBLE(mset.get_max_attained(),
+				      mset_threaded.get_max_attained());
+		    TEST_REL(mset_threaded.get_matches_lower_bound(), <=,
+			     mset.get_matches_upper_bound());
+		    TEST_REL(mset_threaded.get_matches_upper_bound(), >=,
+			     mset.get_matches_lower_bound());
+		    if (check_at_least == db_size && setting != 6) {
+			// Everything was checked so the counts should be
+			// exact (with a percentage cutoff, matching in turn
+			// counts documents which pass the cutoff by weight so
+			// may include some which fail it by percentage).
+			TEST_EQUAL(mset.get_matches_lower_bound(),
+				   mset_threaded.get_matches_lower_bound());
+			TEST_EQUAL(mset.get_matches_estimated(),
+				   mset_threaded.get_matches_estimated());
+			TEST_EQUAL(mset.get_matches_upper_bound(),
+				   mset_threaded.get_matches_upper_bound());
+		    }
+		}
+	    }
+	}
+    }
+}
+
+/// MatchDecider which accepts documents with an even length value slot 11.
+class EvenValueMatchDecider : public Xapian::MatchDecider {
+  public:
+    mutable Xapian::doccount calls = 0;
+
+    bool operator()(const Xapian::Document& doc) const override {
+	++calls;
+	return doc.get_value(11).size() % 2 == 0;
+    }
+};
+
+// Check parallel matching with a MatchDecider and MatchSpy.
+DEFINE_TESTCASE(matchthreads2, backend && !remote) {
+    Xapian::Database db = get_database("etext");
+    Xapian::doccount db_size = db.get_doccount();
+    Xapian::Query query(Xapian::Query::OP_OR,
+			Xapian::Query("the"), Xapian::Query("king"));
+
+    Xapian::Enquire enquire(db);
+    enquire.set_query(query);
+    Xapian::ValueCountMatchSpy spy(1);
+    enquire.add_matchspy(&spy);
+    EvenValueMatchDecider decider;
+    auto mset = enquire.get_mset(0, 10, db_size, NULL, &decider);
+
+    Xapian::Enquire enquire_threaded(db);
+    enquire_threaded.set_query(query);
+    enquire_threaded.set_match_threads(4);
+    Xapian::ValueCountMatchSpy spy_threaded(1);
+    enquire_threaded.add_matchspy(&spy_threaded);
+    EvenValueMatchDecider decider_threaded;
+    auto mset_threaded = enquire_threaded.get_mset(0, 10, db_size, NULL,
+						   &decider_threaded);
+
+    TEST_EQUAL(mset.size(), mset_threaded.size());
+    TEST(mset_range_is_same(mset, 0, mset_threaded, 0, mset.size()));
+    TEST_EQUAL(mset.get_matches_lower_bound(),
+	       mset_threaded.get_matches_lower_bound());
+    TEST_EQUAL(mset.get_matches_estimated(),
+	       mset_threaded.get_matches_estimated());
+    TEST_EQUAL(mset.get_matches_upper_bound(),
+	       mset_threaded.get_matches_upper_bound());
+    TEST_EQUAL(decider.calls, decider_threaded.calls);
+    TEST_REL(mset.get_matches_estimated(), <, decider.calls);
+    TEST_EQUAL(spy.get_total(), spy_threaded.get_total());
+    TEST_EQUAL(spy.get_total(), mset.get_matches_estimated());
+    auto i = spy.values_begin();
+    auto j = spy_threaded.values_begin();
+    while (i != spy.values_end()) {
+	TEST(j != spy_threaded.values_end());
+	TEST_EQUAL(*i, *j);
+	TEST_EQUAL(i.get_termfreq(), j.get_termfreq());
+	++i;
+	++j;
+    }
+    TEST(j == spy_threaded.values_end());
+}
@@ -48,9 +48,13 @@
 # include "safesyswait.h"
 #endif
 
+#include <algorithm>
+#include <atomic>
 #include <cerrno>
 #include <fstream>
 #include <iterator>
+#include <thread>
+#include <vector>
 
 using namespace std;
 
@@ -602,10 +606,13 @@ DEFINE_TESTCASE(replacedoc9, writable) {
 }
 
 /// Test coverage for DatabaseModifiedError.
-DEFINE_TESTCASE(databasemodified1, writable && !inmemory && !multi) {
+DEFINE_TESTCASE(databasemodified1, writable && !inmemory && !multi && !tiered) {
     // The inmemory backend doesn't support revisions.
     //
     // With multi, DatabaseModifiedError doesn't trigger as easily.
+    //
+    // With tiered, a reader only has the head open for writes since it last
+    // reopened, and frozen heads are never modified.
     Xapian::WritableDatabase db(get_writable_database());
     Xapian::Document doc;
     doc.set_data("cargo");
@@ -2010,6 +2017,89 @@ DEFINE_TESTCASE(remoteportreuse1, remotetcp) {
     }
 }
 
+/// Run queries against a remote database, counting inconsistent results.
+static void
+threadedremote_client(int port, atomic<unsigned>& ok, atomic<unsigned>& bad)
+{
+    try {
+	Xapian::Database db = Xapian::Remote::open("127.0.0.1", port);
+	for (int i = 0; i != 40; ++i) {
+	    try {
+		Xapian::Enquire enq(db);
+		enq.set_query(Xapian::Query("t"));
+		Xapian::MSet mset = enq.get_mset(0, 100);
+		// Revision N of the database has 10 + N documents, all of
+		// which have data N.
+		Xapian::doccount n = db.get_doccount();
+		bool consistent = (mset.size() == n &&
+				   mset.get_matches_estimated() == n);
+		for (auto m = mset.begin(); m != mset.end(); ++m) {
+		    if (m.get_document().get_data() != str(n - 10))
+			consistent = false;
+		}
+		++(consistent ? ok : bad);
+	    } catch (const Xapian::DatabaseModifiedError&) {
+		db.reopen();
+	    }
+	    if (i % 4 == 3) db.reopen();
+	}
+    } catch (const Xapian::Error& e) {
+	tout << e.get_description() << '\n';
+	++bad;
+    }
+}
+
+/** Check a threaded server gives each connection a consistent snapshot.
+ *
+ *  Several clients run queries against a server with fewer threads than
+ *  there are clients while the database is being updated.  Each client
+ *  should see a consistent revision until it reopens the database.
+ */
+DEFINE_TESTCASE(threadedremote1, remotetcp) {
+#ifndef HAVE_EPOLL_CREATE1
+    SKIP_TEST("xapian-tcpsrv --threads not supported on this platform");
+#else
+    Xapian::WritableDatabase wdb =
+	get_named_writable_database("threadedremote1");
+    Xapian::Document doc;
+    doc.add_term("t");
+    doc.set_data("0");
+    for (int i = 0; i != 10; ++i) wdb.add_document(doc);
+    wdb.commit();
+
+    int port;
+    Xapian::Database db =
+	get_threaded_remote_database("threadedremote1", 2, &port);
+    TEST_EQUAL(db.get_doccount(), 10);
+
+    atomic<unsigned> ok{0}, bad{0};
+    vector<thread> clients;
+    for (int i = 0; i != 4; ++i) {
+	clients.emplace_back(threadedremote_client, port, ref(ok), ref(bad));
+    }
+
+    for (unsigned generation = 1; generation != 30; ++generation) {
+	doc.set_data(str(generation));
+	for (Xapian::docid did = 1; did <= wdb.get_lastdocid(); ++did) {
+	    wdb.replace_document(did, doc);
+	}
+	wdb.add_document(doc);
+	wdb.commit();
+    }
+
+    for (auto& client : clients) client.join();
+    tout << ok << " consistent results, " << bad << " inconsistent\n";
+    TEST_EQUAL(bad, 0);
+    TEST_REL(ok, >, 0);
+
+    // The connection opened first should only see the latest revision once
+    // it reopens.
+    TEST_EQUAL(db.get_doccount(), 10);
+    TEST(db.reopen());
+    TEST_EQUAL(db.get_doccount(), 39);
+#endif
+}
+
 // Test exception for check() on remote via stub.
 DEFINE_TESTCASE(unsupportedcheck1, path) {
     mkdir(".stub", 0755);
@@ -2074,3 +2164,247 @@ DEFINE_TESTCASE(corruptglass1, glass) {
 		       Xapian::Database::check(db_path));
     }
 }
+
+/// Check opening with DB_MMAP gives the same results.
+DEFINE_TESTCASE(mmap1, path) {
+    Xapian::Database db = get_database("etext");
+    Xapian::Database db_mmap(get_database_path("etext"), Xapian::DB_MMAP);
+    TEST_EQUAL(db.get_doccount(), db_mmap.get_doccount());
+    TEST_EQUAL(db.get_total_length(), db_mmap.get_total_length());
+
+    for (Xapian::docid did = 1; did <= db.get_lastdocid(); did += 7) {
+	Xapian::Document doc = db.get_document(did);
+	Xapian::Document doc_mmap = db_mmap.get_document(did);
+	TEST_EQUAL(doc.get_data(), doc_mmap.get_data());
+	TEST_EQUAL(doc.termlist_count(), doc_mmap.termlist_count());
+	auto t = db_mmap.termlist_begin(did);
+	for (auto i = db.termlist_begin(did); i != db.termlist_end(did); ++i) {
+	    TEST(t != db_mmap.termlist_end(did));
+	    TEST_EQUAL(*t, *i);
+	    TEST_EQUAL(t.get_wdf(), i.get_wdf());
+	    ++t;
+	}
+	TEST(t == db_mmap.termlist_end(did));
+    }
+
+    auto t = db_mmap.allterms_begin();
+    for (auto i = db.allterms_begin(); i != db.allterms_end(); ++i) {
+	TEST(t != db_mmap.allterms_end());
+	TEST_EQUAL(*t, *i);
+	TEST_EQUAL(t.get_termfreq(), i.get_termfreq());
+	++t;
+    }
+    TEST(t == db_mmap.allterms_end());
+
+    Xapian::Enquire enquire(db);
+    Xapian::Enquire enquire_mmap(db_mmap);
+    Xapian::Query query(Xapian::Query::OP_OR,
+			Xapian::Query("the"), Xapian::Query("king"));
+    enquire.set_query(query);
+    enquire_mmap.set_query(query);
+    Xapian::MSet mset = enquire.get_mset(0, 20);
+    Xapian::MSet mset_mmap = enquire_mmap.get_mset(0, 20);
+    TEST_EQUAL(mset.size(), mset_mmap.size());
+    TEST(mset_range_is_same(mset, 0, mset_mmap, 0, mset.size()));
+    TEST(mset_range_is_same_weights(mset, 0, mset_mmap, 0, mset.size()));
+}
+
+/// Check DB_MMAP with glass when the database is modified after opening.
+DEFINE_TESTCASE(mmap2, glass) {
+    Xapian::WritableDatabase wdb = get_named_writable_database("mmap2");
+    Xapian::Document doc;
+    doc.add_term("foo");
+    doc.set_data("first");
+    wdb.add_document(doc);
+    wdb.commit();
+
+    Xapian::Database db(get_named_writable_database_path("mmap2"),
+			Xapian::DB_MMAP);
+    TEST_EQUAL(db.get_doccount(), 1);
+
+    // Extend the files.
+    for (int i = 0; i < 1000; ++i) {
+	doc.set_data(string(100, 'a' + i % 26));
+	doc.add_term("bar" + str(i));
+	wdb.add_document(doc);
+    }
+    wdb.commit();
+
+    // The revision which was opened should still be readable.
+    TEST_EQUAL(db.get_doccount(), 1);
+    TEST_EQUAL(db.get_document(1).get_data(), "first");
+    TEST_EQUAL(db.get_termfreq("foo"), 1);
+
+    TEST(db.reopen());
+    TEST_EQUAL(db.get_doccount(), 1001);
+    TEST_EQUAL(db.get_document(1).get_data(), "first");
+    TEST_EQUAL(db.get_document(1001).get_data(), string(100, 'a' + 999 % 26));
+    TEST_EQUAL(db.get_termfreq("foo"), 1001);
+    TEST_EQUAL(db.get_termfreq("bar999"), 1);
+    TEST_EQUAL(db.get_document(1001).termlist_count(), 1001);
+}
+
+/// Test the shared block cache.
+DEFINE_TESTCASE(blockcache1, glass) {
+    Xapian::WritableDatabase wdb = get_named_writable_database("blockcache1");
+    Xapian::Document doc;
+    for (int i = 0; i < 1000; ++i) {
+	doc.set_data(string(100, 'a' + i % 26));
+	doc.add_term("foo" + str(i % 7));
+	wdb.add_document(doc);
+    }
+    wdb.commit();
+
+    const string& path = get_named_writable_database_path("blockcache1");
+    Xapian::Database::set_block_cache_size(1024 * 1024);
+    unsigned long long hits0, misses0;
+    Xapian::Database::get_block_cache_stats(hits0, misses0);
+
+    Xapian::Database db1(path);
+    Xapian::Enquire enq1(db1);
+    enq1.set_query(Xapian::Query("foo3"));
+    Xapian::MSet mset1 = enq1.get_mset(0, 20);
+    TEST_EQUAL(db1.get_document(1000).get_data(), string(100, 'a' + 999 % 26));
+
+    unsigned long long hits1, misses1;
+    Xapian::Database::get_block_cache_stats(hits1, misses1);
+    TEST_REL(misses1, >, misses0);
+
+    // A second Database object should find the blocks in the cache.
+    Xapian::Database db2(path);
+    Xapian::Enquire enq2(db2);
+    enq2.set_query(Xapian::Query("foo3"));
+    Xapian::MSet mset2 = enq2.get_mset(0, 20);
+    TEST(mset_range_is_same(mset1, 0, mset2, 0, mset1.size()));
+    TEST_EQUAL(db2.get_document(1000).get_data(), string(100, 'a' + 999 % 26));
+
+    unsigned long long hits2, misses2;
+    Xapian::Database::get_block_cache_stats(hits2, misses2);
+    TEST_REL(hits2, >, hits1);
+
+    // Blocks are cached per revision, so changes must be seen on reopen.
+    doc.set_data("changed");
+    wdb.replace_document(1000, doc);
+    wdb.commit();
+    TEST_EQUAL(db2.get_document(1000).get_data(), string(100, 'a' + 999 % 26));
+    TEST(db2.reopen());
+    TEST_EQUAL(db2.get_document(1000).get_data(), "changed");
+
+    Xapian::Database::set_block_cache_size(0);
+    TEST_EQUAL(db1.get_document(1000).get_data(), string(100, 'a' + 999 % 26));
+}
+
+/** Test prefetching documents from a larger database.
+ *
+ *  With glass, the document data table has branch levels here so fetching
+ *  several documents exercises descending the B-tree to prefetch them.
+ */
+DEFINE_TESTCASE(fetchdocs3, backend) {
+    Xapian::Database db = get_database("fetchdocs3",
+				       [](Xapian::WritableDatabase& wdb,
+					  const string&)
+				       {
+					   Xapian::Document doc;
+					   for (int i = 0; i < 3000; ++i) {
+					       doc.set_data(str(i) +
+							    string(200, 'x'));
+					       doc.clear_terms();
+					       doc.add_term("foo" + str(i % 7));
+					       doc.add_term("bar" + str(i % 11));
+					       wdb.add_document(doc);
+					   }
+				       });
+    Xapian::Enquire enquire(db);
+    enquire.set_query(Xapian::Query(Xapian::Query::OP_OR,
+				    Xapian::Query("foo3"),
+				    Xapian::Query("bar5")));
+    Xapian::MSet mset = enquire.get_mset(0, 100);
+    TEST_EQUAL(mset.size(), 100);
+
+    mset.fetch();
+    mset.fetch(mset[50], mset[80]);
+    mset.fetch(mset[99]);
+    for (Xapian::doccount i = 0; i != mset.size(); ++i) {
+	Xapian::docid did = *mset[i];
+	TEST_EQUAL(mset[i].get_document().get_data(),
+		   str(did - 1) + string(200, 'x'));
+    }
+}
+
+/// Test replacing and deleting documents across the tiers of a tiered DB.
+DEFINE_TESTCASE(tiered1, tiered) {
+    // The test harness sets a low freeze threshold, so these documents
+    // are spread over several segments as well as the head.
+    Xapian::WritableDatabase wdb = get_named_writable_database("tiered1");
+    const string path = get_named_writable_database_path("tiered1");
+    for (int i = 1; i <= 20; ++i) {
+	Xapian::Document doc;
+	doc.set_data(str(i));
+	doc.add_term("all");
+	doc.add_term("mod" + str(i % 4));
+	doc.add_value(0, str(i % 10));
+	wdb.add_document(doc);
+    }
+    wdb.set_metadata("user", "value");
+    wdb.commit();
+
+    Xapian::Database db(path);
+    TEST_EQUAL(db.get_doccount(), 20);
+    TEST_EQUAL(db.get_termfreq("mod2"), 5);
+
+    // Document 2 will be in a segment by now, and document 19 in the head.
+    Xapian::Document doc;
+    doc.set_data("replaced");
+    doc.add_term("new");
+    wdb.replace_document(2, doc);
+    wdb.delete_document(5);
+    wdb.delete_document(19);
+    wdb.commit();
+
+    // Documents in the tiers must not show through before reopening.
+    TEST_EQUAL(db.get_doccount(), 20);
+    TEST(db.reopen());
+
+    auto check = [](const Xapian::Database& d) {
+	TEST_EQUAL(d.get_doccount(), 18);
+	TEST_EQUAL(d.get_lastdocid(), 20);
+	TEST_EQUAL(d.get_termfreq("all"), 17);
+	TEST_EQUAL(d.get_termfreq("mod2"), 4);
+	TEST_EQUAL(d.get_termfreq("new"), 1);
+	TEST_EQUAL(d.get_value_freq(0), 17);
+	vector<Xapian::docid> docids(d.postlist_begin("all"),
+				     d.postlist_end("all"));
+	TEST_EQUAL(docids.size(), 17);
+	TEST(find(docids.begin(), docids.end(), 2) == docids.end());
+	TEST(find(docids.begin(), docids.end(), 5) == docids.end());
+	TEST(find(docids.begin(), docids.end(), 19) == docids.end());
+	TEST_EQUAL(d.get_document(2).get_data(), "replaced");
+	TEST_EQUAL(*d.termlist_begin(2), "new");
+	TEST_EXCEPTION(Xapian::DocNotFoundError, d.get_document(5));
+	TEST_EXCEPTION(Xapian::DocNotFoundError, d.get_document(19));
+	TEST_EQUAL(d.get_metadata("user"), "value");
+	// Only the user's metadata should be visible.
+	Xapian::TermIterator t = d.metadata_keys_begin();
+	TEST(t != d.metadata_keys_end());
+	TEST_EQUAL(*t, "user");
+	TEST(++t == d.metadata_keys_end());
+    };
+    check(db);
+    check(wdb);
+
+    // Keys used by the backend are reserved.
+    TEST_EXCEPTION(Xapian::InvalidArgumentError,
+		   wdb.set_metadata(string("\0tieredx", 8), "value"));
+
+    // Closing waits for any background merges to finish.
+    wdb.close();
+    check(Xapian::Database(path));
+    TEST_EQUAL(Xapian::Database::check(path, 0, &tout), 0);
+
+    // Reopening for writing should find the hidden documents again.
+    wdb = Xapian::WritableDatabase(path, Xapian::DB_OPEN);
+    check(wdb);
+    wdb.add_document(doc);
+    TEST_EQUAL(wdb.get_lastdocid(), 21);
+    TEST_EQUAL(wdb.get_termfreq("new"), 2);
+}
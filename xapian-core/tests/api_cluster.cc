@@ -24,6 +24,9 @@
 
 #include <xapian.h>
 
+#include <algorithm>
+#include <vector>
+
 #include "apitest.h"
 #include "testsuite.h"
 #include "testutils.h"
@@ -152,6 +155,53 @@ DEFINE_TESTCASE(round_robin1, backend)
     }
 }
 
+/// Return the documents in each cluster of @a cset, sorted.
+static std::vector<std::vector<Xapian::docid>>
+cluster_docids(const Xapian::ClusterSet& cset)
+{
+    std::vector<std::vector<Xapian::docid>> result;
+    for (Xapian::doccount c = 0; c < cset.size(); ++c) {
+	Xapian::DocumentSet d = cset[c].get_documents();
+	std::vector<Xapian::docid> docids;
+	for (Xapian::doccount i = 0; i < d.size(); ++i)
+	    docids.push_back(d[i].get_docid());
+	std::sort(docids.begin(), docids.end());
+	result.push_back(docids);
+    }
+    return result;
+}
+
+/** KMeans Test
+ *  Test that using several threads gives the same clusters as one thread, and
+ *  that the mini-batch mode puts each document in exactly one cluster.
+ */
+DEFINE_TESTCASE(kmeans1, backend)
+{
+    Xapian::Database db = get_database("stemmed_cluster", make_stemmed_cluster_db);
+    Xapian::Enquire enq(db);
+    enq.set_query(Xapian::Query("cluster"));
+    Xapian::MSet matches = enq.get_mset(0, 4);
+
+    Xapian::KMeans kmeans(2);
+    TEST_EQUAL(kmeans.get_threads(), 0);
+    auto expected = cluster_docids(kmeans.cluster(matches));
+    TEST_EQUAL(expected.size(), 2);
+
+    kmeans.set_threads(4);
+    TEST_EQUAL(kmeans.get_threads(), 4);
+    TEST(cluster_docids(kmeans.cluster(matches)) == expected);
+
+    kmeans.set_batch_size(2);
+    auto clusters = cluster_docids(kmeans.cluster(matches));
+    TEST_EQUAL(clusters.size(), 2);
+    std::vector<Xapian::docid> all;
+    for (auto& c : clusters)
+	all.insert(all.end(), c.begin(), c.end());
+    std::sort(all.begin(), all.end());
+    TEST_EQUAL(all.size(), matches.size());
+    TEST(std::adjacent_find(all.begin(), all.end()) == all.end());
+}
+
 DEFINE_TESTCASE(stem_stopper1, !backend)
 {
     Xapian::Stem stemmer("english");
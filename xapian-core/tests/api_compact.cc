@@ -33,9 +33,13 @@
 #include "testsuite.h"
 #include "testutils.h"
 
+#include <algorithm>
 #include <cerrno>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <sstream>
 
 #include <sys/types.h>
 #include "safesysstat.h"
@@ -753,3 +757,457 @@ DEFINE_TESTCASE(compact2, compact) {
 
     TEST_EQUAL(Xapian::Database(output).get_doccount(), db_size);
 }
+
+static void
+make_compactthreads_db(Xapian::WritableDatabase& db, const string&)
+{
+    for (unsigned i = 1; i <= 3000; ++i) {
+	Xapian::Document doc;
+	doc.set_data(str(i));
+	doc.add_boolean_term("Q" + str(i));
+	doc.add_term("t" + str(i % 500), i % 3 + 1);
+	doc.add_posting(string(1, char('a' + i % 26)) + str(i % 71), i % 5 + 1);
+	doc.add_value(0, str(i % 97));
+	db.add_document(doc);
+    }
+    db.set_metadata("foo", "bar");
+    db.add_spelling("hello");
+    db.add_synonym("hello", "hi");
+    db.commit();
+}
+
+static string
+read_file(const string& path)
+{
+    ifstream in(path, fstream::binary);
+    ostringstream out;
+    out << in.rdbuf();
+    return out.str();
+}
+
+// Check compacting using several threads gives the same output.
+DEFINE_TESTCASE(compactthreads1, compact && !multi) {
+    string indbpath = get_database_path("compactthreads1",
+					make_compactthreads_db);
+    string outdbpath = get_compaction_output_path("compactthreads1out");
+    string outdbpath_mt = get_compaction_output_path("compactthreads1outmt");
+    rm_rf(outdbpath);
+    rm_rf(outdbpath_mt);
+
+    {
+	Xapian::Database db;
+	db.add_database(Xapian::Database(indbpath));
+	db.add_database(Xapian::Database(indbpath));
+	db.compact(outdbpath);
+
+	Xapian::Compactor compactor;
+	compactor.set_threads(4);
+	TEST_EQUAL(compactor.get_threads(), 4);
+	db.compact(outdbpath_mt, 0, 0, compactor);
+    }
+
+    TEST_EQUAL(Xapian::Database::check(outdbpath_mt, 0, &tout), 0);
+    Xapian::Database outdb(outdbpath_mt);
+    TEST_EQUAL(outdb.get_doccount(), 6000);
+    dbcheck(outdb, 6000, 6000);
+
+    // The tables should be identical to those from compacting with one
+    // thread.
+    static const char* const tables[] = {
+	"postlist", "docdata", "termlist", "position", "spelling", "synonym"
+    };
+    string backend = get_dbtype();
+    if (startswith(backend, "singlefile_"))
+	backend.erase(0, CONST_STRLEN("singlefile_"));
+    for (auto table : tables) {
+	string suffix = "/";
+	suffix += table;
+	suffix += '.';
+	suffix += backend;
+	tout << suffix << '\n';
+	TEST(file_exists(outdbpath + suffix));
+	TEST(read_file(outdbpath + suffix) == read_file(outdbpath_mt + suffix));
+    }
+}
+
+/// Compactor which records the status reports for each table.
+class StatusCompactor : public Xapian::Compactor {
+  public:
+    vector<string> reports;
+
+    void set_status(const string& table, const string& status) override {
+	reports.push_back(table + ": " + status);
+    }
+};
+
+// Check status is reported for each table when compacting with threads.
+DEFINE_TESTCASE(compactthreads2, compact && !multi) {
+    string indbpath = get_database_path("compactthreads1",
+					make_compactthreads_db);
+    string outdbpath = get_compaction_output_path("compactthreads2out");
+    string outdbpath_mt = get_compaction_output_path("compactthreads2outmt");
+    rm_rf(outdbpath);
+    rm_rf(outdbpath_mt);
+
+    Xapian::Database db;
+    db.add_database(Xapian::Database(indbpath));
+    db.add_database(Xapian::Database(indbpath));
+    StatusCompactor compactor;
+    db.compact(outdbpath, 0, 0, compactor);
+    StatusCompactor compactor_mt;
+    compactor_mt.set_threads(4);
+    db.compact(outdbpath_mt, 0, 0, compactor_mt);
+
+    // Each table should be reported as started and then immediately as
+    // finished, though the tables may finish in a different order.  As the
+    // output is the same the reported sizes should be too.
+    auto& reports = compactor.reports;
+    auto& reports_mt = compactor_mt.reports;
+    TEST_EQUAL(reports.size(), reports_mt.size());
+    // Honey also reports the total size at the end.
+    if (startswith(reports_mt.back(), "Total: ")) {
+	TEST_EQUAL(reports.back(), reports_mt.back());
+	reports.pop_back();
+	reports_mt.pop_back();
+    }
+    TEST_EQUAL(reports_mt.size() % 2, 0);
+    for (size_t i = 0; i != reports_mt.size(); i += 2) {
+	tout << reports_mt[i] << reports_mt[i + 1] << '\n';
+	TEST(endswith(reports_mt[i], ": "));
+	TEST(startswith(reports_mt[i + 1], reports_mt[i]));
+	TEST(!endswith(reports_mt[i + 1], ": "));
+    }
+    sort(reports.begin(), reports.end());
+    sort(reports_mt.begin(), reports_mt.end());
+    TEST(reports == reports_mt);
+}
+
+/// Compactor which fails when merging the user metadata.
+class FailingCompactor : public Xapian::Compactor {
+  public:
+    string resolve_duplicate_metadata(const string&, size_t,
+				      const string[]) override {
+	throw Xapian::InvalidOperationError("Duplicate metadata");
+    }
+};
+
+// Check temporary tables are removed if threaded compaction fails.
+DEFINE_TESTCASE(compactthreads3, compact && !multi) {
+    string indbpath = get_database_path("compactthreads1",
+					make_compactthreads_db);
+    string outdbpath = get_compaction_output_path("compactthreads3out");
+    rm_rf(outdbpath);
+
+    Xapian::Database db;
+    db.add_database(Xapian::Database(indbpath));
+    db.add_database(Xapian::Database(indbpath));
+    FailingCompactor compactor;
+    compactor.set_threads(4);
+    TEST_EXCEPTION(Xapian::InvalidOperationError,
+		   db.compact(outdbpath, 0, 0, compactor));
+
+    string backend = get_dbtype();
+    if (startswith(backend, "singlefile_"))
+	backend.erase(0, CONST_STRLEN("singlefile_"));
+    for (int r = 1; r <= 4; ++r) {
+	string tmp = outdbpath + "/tmprange" + str(r) + "." + backend;
+	tout << tmp << '\n';
+	TEST(!file_exists(tmp));
+    }
+}
+
+/// Check wildcards expand to the same terms as without a wildcard index.
+static void
+check_wildcard_expansion(const Xapian::Database& db,
+			 const Xapian::Database& refdb)
+{
+    static const char* const patterns[] = {
+	"*is", "*ar*", "*ph", "p*ph", "*r?p*", "*e*a*", "*rd", "*xyzzy*",
+	"t*s", "*ldcar*"
+    };
+    const int flags = Xapian::Query::WILDCARD_PATTERN_MULTI |
+		      Xapian::Query::WILDCARD_PATTERN_SINGLE;
+    Xapian::Enquire enq(db), refenq(refdb);
+    for (auto pattern : patterns) {
+	tout << pattern << '\n';
+	for (int limit : { Xapian::Query::WILDCARD_LIMIT_ERROR,
+			   Xapian::Query::WILDCARD_LIMIT_FIRST }) {
+	    Xapian::termcount max = limit ? 2 : 0;
+	    Xapian::Query q(Xapian::Query::OP_WILDCARD, pattern, max,
+			    flags | limit);
+	    enq.set_query(q);
+	    refenq.set_query(q);
+	    Xapian::MSet mset = enq.get_mset(0, 100);
+	    Xapian::MSet refmset = refenq.get_mset(0, 100);
+	    TEST(mset_range_is_same(mset, 0, refmset, 0, refmset.size()));
+	    TEST_EQUAL(mset.size(), refmset.size());
+	}
+    }
+}
+
+DEFINE_TESTCASE(compactwildcardindex1, compact && !multi) {
+    string indbpath = get_database_path("apitest_simpledata");
+    string outdbpath = get_compaction_output_path("compactwildcardindex1out");
+    string refdbpath = get_compaction_output_path("compactwildcardindex1ref");
+    rm_rf(outdbpath);
+    rm_rf(refdbpath);
+
+    unsigned flags = 0;
+    if (startswith(get_dbtype(), "singlefile_"))
+	flags = Xapian::DBCOMPACT_SINGLE_FILE;
+    Xapian::Database indb(indbpath);
+    indb.compact(outdbpath, flags | Xapian::DBCOMPACT_WILDCARD_INDEX);
+    indb.compact(refdbpath, flags);
+    TEST_EQUAL(Xapian::Database::check(outdbpath, 0, &tout), 0);
+
+    check_wildcard_expansion(Xapian::Database(outdbpath), indb);
+
+    if (get_dbtype() != "glass") return;
+
+    // Check the index is kept up to date as the database is modified.
+    Xapian::WritableDatabase db(outdbpath);
+    Xapian::WritableDatabase refdb(refdbpath);
+    for (auto w : { &db, &refdb }) {
+	Xapian::Document doc;
+	doc.add_term("wildcard");
+	doc.add_term("paragraphs");
+	w->add_document(doc);
+	w->delete_document(1);
+	w->delete_document(2);
+    }
+    // Check before committing too.
+    check_wildcard_expansion(db, refdb);
+    db.commit();
+    refdb.commit();
+    check_wildcard_expansion(db, refdb);
+    db.close();
+    TEST_EQUAL(Xapian::Database::check(outdbpath, 0, &tout), 0);
+
+    // The index should be kept when compacting a database which has one.
+    string out2dbpath = get_compaction_output_path("compactwildcardindex1out2");
+    rm_rf(out2dbpath);
+    Xapian::Database(outdbpath).compact(out2dbpath,
+					Xapian::DBCOMPACT_NO_RENUMBER);
+    TEST_EQUAL(Xapian::Database::check(out2dbpath, 0, &tout), 0);
+    check_wildcard_expansion(Xapian::Database(out2dbpath), refdb);
+}
+
+/// Check that bloom filters don't stop terms which are present being found.
+DEFINE_TESTCASE(compactbloomfilter1, compact && !multi) {
+    string indbpath = get_database_path("apitest_simpledata");
+    string outdbpath = get_compaction_output_path("compactbloomfilter1out");
+    rm_rf(outdbpath);
+
+    unsigned flags = Xapian::DBCOMPACT_BLOOM_FILTER;
+    if (startswith(get_dbtype(), "singlefile_"))
+	flags |= Xapian::DBCOMPACT_SINGLE_FILE;
+    Xapian::Database indb(indbpath);
+    indb.compact(outdbpath, flags);
+    TEST_EQUAL(Xapian::Database::check(outdbpath, 0, &tout), 0);
+
+    Xapian::Database db(outdbpath);
+    Xapian::termcount n_terms = 0;
+    for (auto t = indb.allterms_begin(); t != indb.allterms_end(); ++t) {
+	TEST(db.term_exists(*t));
+	TEST_EQUAL(db.get_termfreq(*t), t.get_termfreq());
+	TEST_EQUAL(*db.postlist_begin(*t), *indb.postlist_begin(*t));
+	++n_terms;
+    }
+    TEST_REL(n_terms, >, 0);
+
+    for (int i = 0; i < 1000; ++i) {
+	string term = "absent" + str(i);
+	TEST(!db.term_exists(term));
+	TEST_EQUAL(db.get_termfreq(term), 0);
+	TEST(db.postlist_begin(term) == db.postlist_end(term));
+    }
+
+    Xapian::Enquire enq(db);
+    enq.set_query(Xapian::Query(Xapian::Query::OP_OR,
+				Xapian::Query("absent"),
+				Xapian::Query("this")));
+    TEST_EQUAL(enq.get_mset(0, 10).get_matches_estimated(),
+	       indb.get_termfreq("this"));
+
+    if (get_dbtype().find("honey") == string::npos) return;
+
+    // Check a bloom filter was actually written for the postlist table, and
+    // that it rejects most keys which aren't present.
+    ostringstream stats;
+    TEST_EQUAL(Xapian::Database::check(outdbpath, Xapian::DBCHECK_SHOW_STATS,
+				       &stats), 0);
+    string s = stats.str();
+    tout << s;
+    auto i = s.find("postlist:\n");
+    TEST(i != string::npos);
+    i = s.find("\nbloomfilter=", i);
+    TEST(i != string::npos);
+    unsigned long size, rejected, absent;
+    TEST_EQUAL(sscanf(s.c_str() + i, "\nbloomfilter=%lu rejected=%lu/%lu",
+		      &size, &rejected, &absent), 3);
+    TEST_REL(size, >, 0);
+    TEST_REL(absent, >, 0);
+    TEST_REL(rejected, >, absent * 9 / 10);
+}
+
+static void
+make_honeyindex_db(Xapian::WritableDatabase& db, const string&)
+{
+    char buf[32];
+    for (unsigned i = 1; i <= 100000; ++i) {
+	Xapian::Document doc;
+	snprintf(buf, sizeof(buf), "XURLexample.org/%06u", i);
+	doc.add_boolean_term(buf);
+	doc.add_term("all");
+	db.add_document(doc);
+    }
+    db.commit();
+}
+
+/** Check lookups in a honey table with lots of keys with the same prefix.
+ *
+ *  The compactor should use a partitioned index for the postlist table, as
+ *  most of the keys start with "X".
+ */
+DEFINE_TESTCASE(honeyindex1, honey) {
+    string dbpath = get_database_path("honeyindex1", make_honeyindex_db);
+    ostringstream stats;
+    TEST_EQUAL(Xapian::Database::check(dbpath, Xapian::DBCHECK_SHOW_STATS,
+				       &stats), 0);
+    tout << stats.str();
+    // The postlist table should use the partitioned index (type 3).
+    string s = stats.str();
+    auto pos = s.find("postlist:\nitems=");
+    TEST(pos != string::npos);
+    pos = s.find('\n', pos + CONST_STRLEN("postlist:\n"));
+    TEST(pos != string::npos);
+    TEST(endswith(string_view(s.data(), pos), " index=3"));
+    Xapian::Database db(dbpath);
+
+    char buf[32];
+    for (unsigned i = 1; i <= 100000; i += 7) {
+	snprintf(buf, sizeof(buf), "XURLexample.org/%06u", i);
+	TEST(db.term_exists(buf));
+	TEST_EQUAL(db.get_termfreq(buf), 1);
+	TEST_EQUAL(*db.postlist_begin(buf), i);
+	// Keys which would sort between two which are present.
+	TEST(!db.term_exists(string(buf) + "~"));
+	TEST(!db.term_exists(string(buf, strlen(buf) - 1)));
+    }
+    TEST(!db.term_exists("XURLexample.org/"));
+    TEST(!db.term_exists("XURLexample.org/999999"));
+    TEST(!db.term_exists("A"));
+    TEST(!db.term_exists("Z"));
+
+    // Iterating with a prefix uses a cursor.
+    Xapian::termcount n = 0;
+    for (auto t = db.allterms_begin("XURLexample.org/01");
+	 t != db.allterms_end("XURLexample.org/01"); ++t) {
+	snprintf(buf, sizeof(buf), "XURLexample.org/%06u", 10000 + n);
+	TEST_EQUAL(*t, buf);
+	++n;
+    }
+    TEST_EQUAL(n, 10000);
+
+    auto t = db.allterms_begin("X");
+    for (unsigned i = 2; i <= 100000; i += 997) {
+	snprintf(buf, sizeof(buf), "XURLexample.org/%06u", i);
+	t.skip_to(string(buf) + "!");
+	TEST(t != db.allterms_end("X"));
+	snprintf(buf, sizeof(buf), "XURLexample.org/%06u", i + 1);
+	TEST_EQUAL(*t, buf);
+    }
+    t.skip_to("XURLexample.org/100000~");
+    TEST(t == db.allterms_end("X"));
+
+    // Check the postlist for a term which isn't in the prefixed range.
+    auto p = db.postlist_begin("all");
+    p.skip_to(54321);
+    TEST(p != db.postlist_end("all"));
+    TEST_EQUAL(*p, 54321);
+}
+
+static void
+make_compression_db(Xapian::WritableDatabase& db, const string&)
+{
+    for (unsigned i = 1; i <= 2000; ++i) {
+	Xapian::Document doc;
+	doc.set_data("url=https://example.org/docs/page" + str(i) + ".html\n"
+		     "caption=Example page number " + str(i) + "\n"
+		     "type=text/html\n"
+		     "language=en\n");
+	doc.add_boolean_term("Q" + str(i));
+	doc.add_term("example");
+	doc.add_term("page");
+	doc.add_term("number");
+	doc.add_term(str(i));
+	doc.add_term("n" + str(i % 37));
+	db.add_document(doc);
+    }
+    db.commit();
+}
+
+/// Check @a db has the same documents as @a ref.
+static void
+check_same_documents(const Xapian::Database& db, const Xapian::Database& ref)
+{
+    TEST_EQUAL(db.get_doccount(), ref.get_doccount());
+    for (Xapian::docid did = 1; did <= ref.get_lastdocid(); ++did) {
+	Xapian::Document doc = db.get_document(did);
+	Xapian::Document ref_doc = ref.get_document(did);
+	TEST_EQUAL(doc.get_data(), ref_doc.get_data());
+	auto t = db.termlist_begin(did);
+	for (auto r = ref.termlist_begin(did); r != ref.termlist_end(did); ++r) {
+	    TEST(t != db.termlist_end(did));
+	    TEST_EQUAL(*t, *r);
+	    TEST_EQUAL(t.get_wdf(), r.get_wdf());
+	    ++t;
+	}
+	TEST(t == db.termlist_end(did));
+    }
+}
+
+/// Check compacting with zstd and LZ4 compression.
+DEFINE_TESTCASE(compactcompression1, compact && !multi) {
+    string indbpath = get_database_path("compactcompression1",
+					make_compression_db);
+    Xapian::Database indb(indbpath);
+
+    static const unsigned methods[] = {
+	Xapian::DBCOMPACT_ZSTD,
+	Xapian::DBCOMPACT_LZ4,
+	Xapian::DBCOMPACT_ZSTD | Xapian::DBCOMPACT_LZ4
+    };
+    bool tested = false;
+    for (unsigned method : methods) {
+	unsigned flags = method;
+	if (startswith(get_dbtype(), "singlefile_"))
+	    flags |= Xapian::DBCOMPACT_SINGLE_FILE;
+	string outdbpath =
+	    get_compaction_output_path("compactcompression1out" + str(method));
+	rm_rf(outdbpath);
+	try {
+	    indb.compact(outdbpath, flags);
+	} catch (const Xapian::FeatureUnavailableError&) {
+	    // Xapian was built without support for this compression method.
+	    continue;
+	}
+	tested = true;
+	TEST_EQUAL(Xapian::Database::check(outdbpath, 0, &tout), 0);
+	Xapian::Database outdb(outdbpath);
+	check_same_documents(outdb, indb);
+
+	// Compact again with the same method (so tags can be copied over
+	// without recompressing them) and with zlib (so they can't).
+	for (unsigned flags2 : { flags, flags & ~method }) {
+	    string out2dbpath =
+		get_compaction_output_path("compactcompression1out2");
+	    rm_rf(out2dbpath);
+	    outdb.compact(out2dbpath, flags2);
+	    TEST_EQUAL(Xapian::Database::check(out2dbpath, 0, &tout), 0);
+	    check_same_documents(Xapian::Database(out2dbpath), indb);
+	}
+    }
+    if (!tested) SKIP_TEST("Built without zstd or LZ4 support");
+}
+
@@ -24,6 +24,7 @@
 
 #include "api_posdb.h"
 
+#include <iterator>
 #include <string>
 #include <vector>
 
@@ -624,3 +625,98 @@ DEFINE_TESTCASE(positfromtermit1, positional) {
     TEST_NOT_EQUAL(t, db.termlist_end(7));
     TEST_EQUAL(t.positionlist_count(), 2);
 }
+
+static void
+gen_wordpair_db(Xapian::WritableDatabase& db, int flags, bool last_without)
+{
+    static const char* const texts[] = {
+	"to be or not to be that is the question",
+	"not to be outdone",
+	"to be honest",
+	"be to or",
+	"the question is to be or not",
+	"or not to be"
+    };
+    Xapian::TermGenerator termgen;
+    termgen.set_stemmer(Xapian::Stem("en"));
+    for (auto text : texts) {
+	if (last_without && text == texts[std::size(texts) - 1]) flags = 0;
+	termgen.set_flags(flags);
+	Xapian::Document doc;
+	termgen.set_document(doc);
+	termgen.index_text(text);
+	db.add_document(doc);
+    }
+}
+
+/// Test phrase searches using the terms from TermGenerator::FLAG_WORD_PAIRS.
+DEFINE_TESTCASE(wordpairphrase1, positional) {
+    Xapian::Database db_pairs =
+	get_database("wordpairphrase1",
+		     [](Xapian::WritableDatabase& db, const string&) {
+			 gen_wordpair_db(db, Xapian::TermGenerator::FLAG_WORD_PAIRS,
+					 false);
+		     });
+    Xapian::Database db_mixed =
+	get_database("wordpairphrase1_mixed",
+		     [](Xapian::WritableDatabase& db, const string&) {
+			 gen_wordpair_db(db, Xapian::TermGenerator::FLAG_WORD_PAIRS,
+					 true);
+		     });
+    Xapian::Database db_plain =
+	get_database("wordpairphrase1_plain",
+		     [](Xapian::WritableDatabase& db, const string&) {
+			 gen_wordpair_db(db, 0, false);
+		     });
+
+    static const char* const phrases[][7] = {
+	{ "to", "be", 0 },
+	{ "be", "to", 0 },
+	{ "not", "to", "be", 0 },
+	{ "to", "be", "or", "not", "to", "be", 0 },
+	{ "or", "not", 0 },
+	{ "to", "be", "that", "question", 0 },
+	{ "question", "is", 0 },
+	{ "be", "outdone", "honest", 0 },
+	{ "missing", "to", 0 },
+    };
+    auto OP_PHRASE = Xapian::Query::OP_PHRASE;
+    vector<Xapian::Query> queries;
+    for (auto& phrase : phrases) {
+	size_t n = 0;
+	while (phrase[n]) ++n;
+	queries.emplace_back(OP_PHRASE, phrase, phrase + n);
+	// Sloppy phrases can't use the word pair terms.
+	queries.emplace_back(OP_PHRASE, phrase, phrase + n, n + 1);
+	queries.emplace_back(Xapian::Query::OP_NEAR, phrase, phrase + n);
+    }
+    Xapian::Query to_or_not(Xapian::Query::OP_OR,
+			    Xapian::Query("to"), Xapian::Query("not"));
+    queries.emplace_back(OP_PHRASE, to_or_not, Xapian::Query("be"));
+    Xapian::Query be_or_be[] = {
+	Xapian::Query("be"), to_or_not, Xapian::Query("be")
+    };
+    queries.emplace_back(OP_PHRASE, be_or_be, be_or_be + 3);
+    queries.emplace_back(Xapian::Query::OP_AND,
+			 Xapian::Query(OP_PHRASE, phrases[0], phrases[0] + 2),
+			 Xapian::Query("question"));
+
+    Xapian::Enquire enq_pairs(db_pairs);
+    Xapian::Enquire enq_mixed(db_mixed);
+    Xapian::Enquire enq_plain(db_plain);
+    for (auto& q : queries) {
+	tout << q.get_description() << '\n';
+	enq_pairs.set_query(q);
+	enq_mixed.set_query(q);
+	enq_plain.set_query(q);
+	Xapian::MSet mset_plain = enq_plain.get_mset(0, 10);
+	Xapian::MSet mset_pairs = enq_pairs.get_mset(0, 10);
+	Xapian::MSet mset_mixed = enq_mixed.get_mset(0, 10);
+	TEST_EQUAL(mset_pairs.size(), mset_plain.size());
+	TEST(mset_range_is_same(mset_pairs, 0, mset_plain, 0,
+				mset_plain.size()));
+	TEST_EQUAL(mset_mixed.size(), mset_plain.size());
+	TEST(mset_range_is_same(mset_mixed, 0, mset_plain, 0,
+				mset_plain.size()));
+    }
+}
@@ -24,6 +24,11 @@
 
 #include <xapian.h>
 
+#include <algorithm>
+#include <set>
+#include <string_view>
+#include <vector>
+
 #include "testsuite.h"
 #include "testutils.h"
 
@@ -924,6 +929,82 @@ DEFINE_TESTCASE(editdist2, backend) {
     }
 }
 
+/// Edit distance with transpositions, calculated the simple way.
+static unsigned
+simple_edit_distance(const string& a, const string& b)
+{
+    vector<unsigned> s{Xapian::Utf8Iterator(a), Xapian::Utf8Iterator()};
+    vector<unsigned> t{Xapian::Utf8Iterator(b), Xapian::Utf8Iterator()};
+    vector<vector<unsigned>> d(s.size() + 1, vector<unsigned>(t.size() + 1));
+    for (size_t i = 0; i <= s.size(); ++i) {
+	for (size_t j = 0; j <= t.size(); ++j) {
+	    if (i == 0 || j == 0) {
+		d[i][j] = unsigned(i + j);
+		continue;
+	    }
+	    d[i][j] = min({d[i - 1][j] + 1,
+			   d[i][j - 1] + 1,
+			   d[i - 1][j - 1] + (s[i - 1] != t[j - 1])});
+	    if (i > 1 && j > 1 && s[i - 1] == t[j - 2] && s[i - 2] == t[j - 1])
+		d[i][j] = min(d[i][j], d[i - 2][j - 2] + 1);
+	}
+    }
+    return d[s.size()][t.size()];
+}
+
+/// Test edit distance expansion skipping over ranges of terms.
+DEFINE_TESTCASE(editdist3, backend) {
+    static const char* const words[] = {
+	"abacus", "abba", "cabbage", "cab", "cat", "cart", "carts", "chart",
+	"coat", "cot", "dog", "doge", "edit", "editor", "tide", "zebra",
+	"zz", "\xff", "a\xff\xff", "ab\xff", "ca\xc3", "ca\xc3\xa9",
+	"caf\xc3\xa9", "cafe", "caff", "ca\xe2\x82\xac", "cb\xc3\xa9",
+	"\xc3\xa9t\xc3\xa9", "\xc3\xa9te", "\xe2\x82\xac", "a\xe2\x82\xact",
+	"\x80\x80", "c\x80t", "Zcat", "Xcart", "aeo\xc3to", "aeo\xc3\xa9" "bce"
+    };
+    Xapian::Database db = get_database("editdist3",
+				       [](Xapian::WritableDatabase& wdb,
+					  const string&)
+				       {
+					   for (auto word : words) {
+					       Xapian::Document doc;
+					       doc.add_term(word);
+					       wdb.add_document(doc);
+					   }
+				       });
+    static const char* const targets[] = {
+	"cat", "cart", "abba", "caf\xc3\xa9", "\xc3\xa9t\xc3\xa9", "zz", "tac",
+	"a\xe2\x82\xac", "c\xc3\x80t", "x", "doge", "aocbce"
+    };
+    Xapian::Enquire enq(db);
+    for (auto target : targets) {
+	for (unsigned edit_distance = 0; edit_distance <= 3; ++edit_distance) {
+	    for (size_t prefix_len = 0; prefix_len <= 1; ++prefix_len) {
+		Xapian::Query q(Xapian::Query::OP_EDIT_DISTANCE, target, 0, 0,
+				Xapian::Query::OP_OR, edit_distance,
+				prefix_len);
+		tout << q.get_description() << '\n';
+		enq.set_query(q);
+		Xapian::MSet mset = enq.get_mset(0, db.get_doccount());
+		set<Xapian::docid> result(mset.begin(), mset.end());
+		set<Xapian::docid> expected;
+		Xapian::docid did = 0;
+		for (auto word : words) {
+		    ++did;
+		    if (prefix_len == 0 && word[0] >= 'A' && word[0] <= 'Z')
+			continue;
+		    if (string_view(word).substr(0, prefix_len) !=
+			string_view(target).substr(0, prefix_len))
+			continue;
+		    if (simple_edit_distance(word, target) <= edit_distance)
+			expected.insert(did);
+		}
+		TEST(result == expected);
+	    }
+	}
+    }
+}
+
 DEFINE_TESTCASE(dualprefixeditdist1, backend) {
     Xapian::Database db = get_database("dualprefixeditdist1",
 				       [](Xapian::WritableDatabase& wdb,
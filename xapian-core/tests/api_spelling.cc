@@ -339,3 +339,43 @@ DEFINE_TESTCASE(spell10, spelling) {
 				       });
     TEST_EQUAL(db.get_spelling_suggestion("Schtuhl", 3), "Stuhl");
 }
+
+/// Test get_spelling_suggestions() gives the same answers as repeated calls.
+DEFINE_TESTCASE(spell11, spelling) {
+    Xapian::Database db = get_database("spell11",
+				       [](Xapian::WritableDatabase& wdb,
+					  const string&) {
+					   wdb.add_spelling("hello", 3);
+					   wdb.add_spelling("cell", 2);
+					   wdb.add_spelling("zig");
+					   wdb.add_spelling("ch");
+					   wdb.add_spelling("word", 2);
+					   wdb.add_spelling("ward");
+					   wdb.add_spelling("h\xc3\xb6hle");
+				       });
+    const vector<string> words = {
+	"hell", "izg", "zg", "ziga", "hc", "qh", "c", "", "cll", "helol",
+	"shelolx", "hollo", "ward", "words", "wrod", "hohle", "h\xc3\xb6hl",
+	"hell", "xyzzy"
+    };
+    for (unsigned max_edist = 0; max_edist <= 3; ++max_edist) {
+	vector<string> suggestions =
+	    db.get_spelling_suggestions(words, max_edist);
+	TEST_EQUAL(suggestions.size(), words.size());
+	for (size_t i = 0; i != words.size(); ++i) {
+	    tout << words[i] << " max_edist=" << max_edist << '\n';
+	    TEST_EQUAL(suggestions[i],
+		       db.get_spelling_suggestion(words[i], max_edist));
+	}
+    }
+    vector<string> suggestions = db.get_spelling_suggestions(words);
+    TEST_EQUAL(suggestions[0], "hello");
+    TEST_EQUAL(suggestions[1], "zig");
+    // "ward" is a spelling target, but "word" is more frequent.
+    TEST_EQUAL(suggestions[12], "word");
+    TEST_EQUAL(suggestions[18], "");
+    TEST_EQUAL(suggestions[14], "word");
+    TEST_EQUAL(suggestions[15], "h\xc3\xb6hle");
+
+    TEST(db.get_spelling_suggestions(vector<string>()).empty());
+}
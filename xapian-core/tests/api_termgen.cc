@@ -25,6 +25,7 @@
 
 #include <xapian.h>
 
+#include <algorithm>
 #include <string>
 #include <array>
 
@@ -955,6 +956,41 @@ DEFINE_TESTCASE(tg_max_word_length1, !backend) {
 		       "Zcup:1 Zmug:1 cups[1] mugs[2]");
 }
 
+/// Feature test for TermGenerator::FLAG_WORD_PAIRS.
+DEFINE_TESTCASE(tg_word_pairs1, !backend) {
+    Xapian::TermGenerator termgen;
+    termgen.set_flags(termgen.FLAG_WORD_PAIRS);
+    termgen.set_stemmer(Xapian::Stem("en"));
+    termgen.set_stemming_strategy(termgen.STEM_SOME_FULL_POS);
+
+    Xapian::Document doc;
+    termgen.set_document(doc);
+    termgen.index_text("to be or");
+    // Terms at adjacent positions are paired across calls and prefixes.
+    termgen.index_text("nothing", 1, "S");
+    termgen.increase_termpos();
+    termgen.index_text("to be");
+    termgen.index_text_without_positions("other words");
+
+    string output = format_doc_termlist(doc);
+    replace(output.begin(), output.end(), '\0', '|');
+    TEST_STRINGS_EQUAL(output,
+		       "Snothing[4] Z| Z|Zbe|Zor Z|Zbe|or Z|Zor|Snothing "
+		       "Z|Zor|ZSnoth Z|Zto|Zbe Z|Zto|be Z|be|Zor Z|be|or "
+		       "Z|or|Snothing Z|or|ZSnoth Z|to|Zbe Z|to|be ZSnoth[4] "
+		       "Zbe[2,106] Zor[3] Zother:1 Zto[1,105] Zword:1 "
+		       "be[2,106] or[3] other:1 to[1,105] words:1");
+
+    // set_document() should reset which terms are paired with the next one.
+    Xapian::Document doc2;
+    termgen.set_document(doc2);
+    termgen.set_stemming_strategy(termgen.STEM_NONE);
+    termgen.index_text("be");
+    output = format_doc_termlist(doc2);
+    replace(output.begin(), output.end(), '\0', '|');
+    TEST_STRINGS_EQUAL(output, "Z| be[1]");
+}
+
 /// Feature tests for TermGenerator termpos methods.
 DEFINE_TESTCASE(tg_termpos1, !backend) {
     Xapian::TermGenerator termgen;
@@ -1845,3 +1845,155 @@ DEFINE_TESTCASE(diceweight3, backend) {
     // = 6.0 * 2.0 * 1 / (2 + 4) = 2.0
     TEST_EQUAL_DOUBLE(mset[0].get_weight(), 2.0);
 }
+
+/// Check that pruning using block bounds doesn't change the top results.
+DEFINE_TESTCASE(blockmax1, backend) {
+    Xapian::Database db = get_database("blockmax1",
+				       [](Xapian::WritableDatabase& wdb,
+					  const string&) {
+					   for (unsigned i = 1; i <= 5000; ++i) {
+					       Xapian::Document doc;
+					       doc.add_term("common", 1 + i % 7);
+					       if (i % 3 == 0)
+						   doc.add_term("third",
+								1 + i % 5);
+					       if (i % 2 == 0)
+						   doc.add_term("even", 3);
+					       doc.add_term("pad",
+							    1 + (i * 37) % 50);
+					       wdb.add_document(doc);
+					   }
+				       });
+    // Check iterating and skipping a multi-chunk postlist with flat wdf.
+    Xapian::PostingIterator p = db.postlist_begin("even");
+    TEST_EQUAL(*p, 2);
+    TEST_EQUAL(p.get_wdf(), 3);
+    p.skip_to(4001);
+    TEST_EQUAL(*p, 4002);
+    TEST_EQUAL(p.get_wdf(), 3);
+
+    Xapian::Enquire enquire(db);
+    static const char* const queries[][2] = {
+	{ "common", "third" },
+	{ "common", "even" },
+	{ "third", "even" },
+	{ "third", "pad" },
+    };
+    for (int wt = 0; wt != 2; ++wt) {
+	if (wt == 0) {
+	    enquire.set_weighting_scheme(Xapian::BM25Weight());
+	} else {
+	    enquire.set_weighting_scheme(Xapian::BM25PlusWeight());
+	}
+	for (auto& terms : queries) {
+	    Xapian::Query query(Xapian::Query::OP_OR, terms, std::end(terms));
+	    enquire.set_query(query);
+	    tout << query.get_description() << '\n';
+	    Xapian::MSet pruned = enquire.get_mset(0, 10);
+	    // Setting check_at_least to the number of documents means we
+	    // consider every match.
+	    Xapian::MSet full = enquire.get_mset(0, 10, db.get_doccount());
+	    TEST_EQUAL(pruned.size(), full.size());
+	    for (Xapian::doccount i = 0; i != pruned.size(); ++i) {
+		TEST_EQUAL(*pruned[i], *full[i]);
+		TEST_EQUAL_DOUBLE(pruned[i].get_weight(), full[i].get_weight());
+	    }
+	}
+    }
+}
+
+// Check weights calculated a block of postings at a time.
+DEFINE_TESTCASE(blockweight1, backend) {
+    Xapian::Database db = get_database("blockweight1",
+				       [](Xapian::WritableDatabase& wdb,
+					  const string&) {
+					   for (unsigned i = 1; i <= 300; ++i) {
+					       Xapian::Document doc;
+					       if (i % 17 != 0)
+						   doc.add_term("most", 1 + i % 11);
+					       doc.add_term("pad",
+							    1 + (i * 37) % 50);
+					       if (i % 13 == 0)
+						   doc.add_term("rare", i % 4 + 1);
+					       wdb.add_document(doc);
+					   }
+				       });
+    double N = db.get_doccount();
+    double avlen = db.get_avlength();
+    double tf = db.get_termfreq("most");
+    double tf_rare = db.get_termfreq("rare");
+
+    Xapian::Enquire enquire(db);
+    Xapian::Query query("most");
+    enquire.set_query(query);
+    for (int wt = 0; wt != 5; ++wt) {
+	switch (wt) {
+	    case 0:
+		enquire.set_weighting_scheme(Xapian::BM25Weight());
+		break;
+	    case 1:
+		enquire.set_weighting_scheme(Xapian::BM25PlusWeight());
+		break;
+	    case 2:
+		enquire.set_weighting_scheme(Xapian::TfIdfWeight("ntn"));
+		break;
+	    case 3:
+		enquire.set_weighting_scheme(Xapian::TfIdfWeight("ltn"));
+		break;
+	    case 4:
+		// With b = 0, BM25 doesn't need the document length.
+		enquire.set_weighting_scheme(Xapian::BM25Weight(1, 0, 1, 0,
+								0.5));
+		break;
+	}
+	Xapian::MSet mset = enquire.get_mset(0, db.get_doccount());
+	TEST_EQUAL(mset.size(), tf);
+	for (auto i = mset.begin(); i != mset.end(); ++i) {
+	    Xapian::docid did = *i;
+	    double wdf = 1 + did % 11;
+	    double normlen = max(db.get_doclength(did) / avlen, 0.5);
+	    double expect = 0;
+	    switch (wt) {
+		case 0: {
+		    double tw = (N - tf + 0.5) / (tf + 0.5);
+		    if (tw < 2) tw = tw * 0.5 + 1;
+		    double denom = normlen * 0.5 + 0.5 + wdf;
+		    expect = log(tw) * 2 * wdf / denom;
+		    break;
+		}
+		case 1: {
+		    double denom = normlen * 0.5 + 0.5 + wdf;
+		    expect = log((N + 1) / tf) * (2 * wdf / denom + 1);
+		    break;
+		}
+		case 2:
+		    expect = wdf * log(N / tf);
+		    break;
+		case 3:
+		    expect = (1 + log(wdf)) * log(N / tf);
+		    break;
+		case 4: {
+		    double tw = (N - tf + 0.5) / (tf + 0.5);
+		    if (tw < 2) tw = tw * 0.5 + 1;
+		    expect = log(tw) * 2 * wdf / (1 + wdf);
+		    break;
+		}
+	    }
+	    TEST_EQUAL_DOUBLE(i.get_weight(), expect);
+	}
+    }
+
+    // Check a conjunction, where postlists are skipped through.
+    enquire.set_weighting_scheme(Xapian::TfIdfWeight("ntn"));
+    enquire.set_query(Xapian::Query(Xapian::Query::OP_AND,
+				    query, Xapian::Query("rare")));
+    Xapian::MSet mset = enquire.get_mset(0, db.get_doccount());
+    // Multiples of 13 which aren't multiples of 17.
+    TEST_EQUAL(mset.size(), 300 / 13 - 1);
+    for (auto i = mset.begin(); i != mset.end(); ++i) {
+	Xapian::docid did = *i;
+	double expect = (1 + did % 11) * log(N / tf) +
+			(did % 4 + 1) * log(N / tf_rare);
+	TEST_EQUAL_DOUBLE(i.get_weight(), expect);
+    }
+}
@@ -2036,3 +2036,217 @@ DEFINE_TESTCASE(corruptglass2, glass) {
 		       wdb.add_document(doc));
     }
 }
+
+/// Test WritableDatabase::set_flush_memory_limit().
+DEFINE_TESTCASE(flushmemorylimit1, glass) {
+    Xapian::WritableDatabase wdb = get_writable_database();
+    Xapian::Database rdb(get_writable_database_as_database());
+
+    Xapian::Document doc;
+    doc.add_posting("hello", 1);
+    doc.add_posting("world", 2);
+    wdb.add_document(doc);
+    // Not enough changes to trigger an automatic commit.
+    rdb.reopen();
+    TEST_EQUAL(rdb.get_doccount(), 0);
+
+    // With a tiny limit the next change should trigger one.
+    wdb.set_flush_memory_limit(1);
+    wdb.add_document(doc);
+    rdb.reopen();
+    TEST_EQUAL(rdb.get_doccount(), 2);
+
+    // Inside a transaction the changes should be flushed, but not committed.
+    wdb.begin_transaction();
+    for (int i = 0; i < 10; ++i) {
+	doc.set_data(string(i * 100, 'x'));
+	wdb.add_document(doc);
+    }
+    rdb.reopen();
+    TEST_EQUAL(rdb.get_doccount(), 2);
+    wdb.commit_transaction();
+    rdb.reopen();
+    TEST_EQUAL(rdb.get_doccount(), 12);
+
+    // Setting the limit back to 0 means no limit.
+    wdb.set_flush_memory_limit(0);
+    wdb.add_document(doc);
+    rdb.reopen();
+    TEST_EQUAL(rdb.get_doccount(), 12);
+    wdb.commit();
+    rdb.reopen();
+    TEST_EQUAL(rdb.get_doccount(), 13);
+}
+
+/// Check flushing changes for one term reduces the memory use counted.
+DEFINE_TESTCASE(flushmemorylimit2, glass) {
+    Xapian::Document doc;
+    doc.add_term("common");
+
+    // Find how many documents it takes to trigger an automatic commit.
+    const size_t limit = 10000;
+    Xapian::doccount n;
+    {
+	Xapian::WritableDatabase wdb = get_named_writable_database("fml2a");
+	Xapian::Database rdb(get_named_writable_database_path("fml2a"));
+	wdb.set_flush_memory_limit(limit);
+	n = 0;
+	do {
+	    wdb.add_document(doc);
+	    ++n;
+	    rdb.reopen();
+	} while (rdb.get_doccount() == 0);
+	TEST_REL(n, >, 2);
+    }
+
+    Xapian::WritableDatabase wdb = get_named_writable_database("fml2b");
+    Xapian::Database rdb(get_named_writable_database_path("fml2b"));
+    wdb.set_flush_memory_limit(limit);
+    for (Xapian::doccount i = 1; i != n; ++i) {
+	wdb.add_document(doc);
+    }
+    // Reading the postlist flushes the buffered changes for that term,
+    // which should reduce the memory use enough that adding another
+    // document doesn't trigger a commit.
+    auto p = wdb.postlist_begin("common");
+    TEST(p != wdb.postlist_end("common"));
+    wdb.add_document(doc);
+    rdb.reopen();
+    TEST_EQUAL(rdb.get_doccount(), 0);
+    wdb.commit();
+    rdb.reopen();
+    TEST_EQUAL(rdb.get_doccount(), n);
+}
+
+/// Check add_documents() checks the flush memory limit during a batch.
+DEFINE_TESTCASE(flushmemorylimit3, glass) {
+    vector<Xapian::Document> docs;
+    Xapian::TermGenerator indexer;
+    for (int i = 0; i < 1000; ++i) {
+	Xapian::Document doc;
+	indexer.set_document(doc);
+	indexer.index_text("the quick brown fox jumped over the lazy dog " +
+			   str(i));
+	docs.push_back(doc);
+    }
+
+    for (unsigned n_threads : {1, 4}) {
+	Xapian::WritableDatabase wdb = get_writable_database();
+	Xapian::Database rdb(get_writable_database_as_database());
+	wdb.set_flush_memory_limit(100000);
+	wdb.add_documents(docs, n_threads);
+	// Some of the documents should have been committed part way through
+	// the batch, but not all of them.
+	rdb.reopen();
+	tout << n_threads << " threads: " << rdb.get_doccount() << '\n';
+	TEST_REL(rdb.get_doccount(), >, 0);
+	TEST_REL(rdb.get_doccount(), <, docs.size());
+	wdb.commit();
+	rdb.reopen();
+	TEST_EQUAL(rdb.get_doccount(), docs.size());
+    }
+}
+
+/** Test fetching more documents than are kept pipelined, and modifying
+ *  documents after fetching them.
+ */
+DEFINE_TESTCASE(fetchdocs4, writable) {
+    Xapian::WritableDatabase db = get_writable_database();
+    Xapian::Document doc;
+    doc.add_term("t");
+    for (int i = 1; i <= 1200; ++i) {
+	doc.set_data(str(i));
+	db.add_document(doc);
+    }
+    db.commit();
+
+    Xapian::Enquire enquire(db);
+    enquire.set_query(Xapian::Query("t"));
+    enquire.set_docid_order(Xapian::Enquire::ASCENDING);
+    Xapian::MSet mset = enquire.get_mset(0, 1200);
+    TEST_EQUAL(mset.size(), 1200);
+
+    // With the remote backend, the oldest requests get discarded, so those
+    // documents need to be fetched again.
+    mset.fetch();
+    for (auto i = mset.begin(); i != mset.end(); ++i) {
+	TEST_EQUAL(i.get_document().get_data(), str(*i));
+    }
+
+    // Changes made after a document has been fetched should be visible.
+    mset.fetch(mset.begin(), mset[10]);
+    doc.set_data("changed");
+    db.replace_document(5, doc);
+    db.delete_document(6);
+    TEST_EQUAL(db.get_document(5).get_data(), "changed");
+    TEST_EXCEPTION(Xapian::DocNotFoundError, db.get_document(6));
+    TEST_EQUAL(db.get_document(7).get_data(), "7");
+}
+
+/// Test WritableDatabase::add_documents().
+DEFINE_TESTCASE(adddocuments1, writable) {
+    vector<Xapian::Document> docs;
+    Xapian::TermGenerator indexer;
+    for (int i = 0; i < 100; ++i) {
+	Xapian::Document doc;
+	indexer.set_document(doc);
+	indexer.index_text("the quick brown fox jumped over the lazy dog " +
+			   str(i % 7) + " " + str(i));
+	doc.set_data("doc " + str(i));
+	doc.add_value(1, str(i));
+	docs.push_back(doc);
+    }
+
+    // Add the same documents one at a time to compare with.
+    Xapian::WritableDatabase db1 = get_named_writable_database("adddocuments1");
+    for (auto&& doc : docs) {
+	db1.add_document(doc);
+    }
+    db1.commit();
+
+    for (unsigned n_threads : {1, 4}) {
+	Xapian::WritableDatabase db = get_writable_database();
+	db.add_document(docs[0]);
+	TEST_EQUAL(db.add_documents(docs, n_threads), 2);
+	TEST_EQUAL(db.add_documents(vector<Xapian::Document>(), n_threads), 0);
+	db.commit();
+	TEST_EQUAL(db.get_doccount(), 101);
+	TEST_EQUAL(db.get_lastdocid(), 101);
+	TEST_EQUAL(db.get_total_length(),
+		   db1.get_total_length() + db1.get_doclength(1));
+	for (Xapian::docid did = 1; did <= 100; ++did) {
+	    Xapian::Document doc = db.get_document(did + 1);
+	    Xapian::Document doc1 = db1.get_document(did);
+	    TEST_EQUAL(doc.get_data(), doc1.get_data());
+	    TEST_EQUAL(doc.get_value(1), doc1.get_value(1));
+	    TEST_EQUAL(db.get_doclength(did + 1), db1.get_doclength(did));
+	    TEST_EQUAL(doc.termlist_count(), doc1.termlist_count());
+	}
+	for (auto t = db1.allterms_begin(); t != db1.allterms_end(); ++t) {
+	    const string& term = *t;
+	    Xapian::TermIterator tl = docs[0].termlist_begin();
+	    tl.skip_to(term);
+	    bool in_first = (tl != docs[0].termlist_end() && *tl == term);
+	    TEST_EQUAL(db.get_termfreq(term),
+		       t.get_termfreq() + (in_first ? 1 : 0));
+	    auto p1 = db1.postlist_begin(term);
+	    auto p = db.postlist_begin(term);
+	    if (*p == 1) ++p;
+	    while (p1 != db1.postlist_end(term)) {
+		TEST(p != db.postlist_end(term));
+		TEST_EQUAL(*p, *p1 + 1);
+		TEST_EQUAL(p.get_wdf(), p1.get_wdf());
+		if (db.has_positions()) {
+		    vector<Xapian::termpos> pos(p.positionlist_begin(),
+						p.positionlist_end());
+		    vector<Xapian::termpos> pos1(p1.positionlist_begin(),
+						 p1.positionlist_end());
+		    TEST(pos == pos1);
+		}
+		++p;
+		++p1;
+	    }
+	    TEST(p == db.postlist_end(term));
+	}
+    }
+}
@@ -116,6 +116,16 @@ get_remote_database(const string& dbname,
     return backendmanager->get_remote_database(dbnames, timeout, port_ptr);
 }
 
+Xapian::Database
+get_threaded_remote_database(const string& name,
+			     unsigned n_threads,
+			     int* port_ptr)
+{
+    return backendmanager->get_threaded_remote_database("dbw__" + name,
+							n_threads,
+							port_ptr);
+}
+
 void
 kill_remote(const Xapian::Database& db)
 {
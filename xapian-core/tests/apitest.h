@@ -55,6 +55,17 @@ Xapian::Database get_remote_database(const std::string& db,
 				     unsigned timeout,
 				     int* port_ptr = nullptr);
 
+/** Get a remote database for named writable database @a name, served by a
+ *  pool of threads.
+ *
+ *  Currently only supported for remotetcp.  The server keeps running until
+ *  the end of the testcase, so further connections can be made to the port
+ *  stored in *port_ptr.
+ */
+Xapian::Database get_threaded_remote_database(const std::string& name,
+					      unsigned n_threads,
+					      int* port_ptr);
+
 /** Kill the server associated with remote database @a db.
  *
  *  Currently only supported for remotetcp and only for a database with a
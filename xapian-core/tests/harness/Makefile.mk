@@ -11,6 +11,7 @@ noinst_HEADERS +=\
 	harness/backendmanager_remoteprog.h\
 	harness/backendmanager_remotetcp.h\
 	harness/backendmanager_singlefile.h\
+	harness/backendmanager_tiered.h\
 	harness/cputimer.h\
 	harness/fdtracker.h\
 	harness/index_utils.h\
@@ -53,6 +54,11 @@ testharness_sources +=\
 	harness/backendmanager_honey.cc
 endif
 
+if BUILD_BACKEND_TIERED
+testharness_sources +=\
+	harness/backendmanager_tiered.cc
+endif
+
 if BUILD_BACKEND_INMEMORY
 testharness_sources += harness/backendmanager_inmemory.cc
 endif
@@ -261,6 +261,18 @@ BackendManager::get_remote_database(const vector<string>&,
     throw Xapian::InvalidOperationError(msg);
 }
 
+Xapian::Database
+BackendManager::get_threaded_remote_database(const string&,
+					     unsigned,
+					     int*)
+{
+    string msg = "BackendManager::get_threaded_remote_database() called for "
+		 "non-remotetcp database (type is ";
+    msg += get_dbtype();
+    msg += ')';
+    throw Xapian::InvalidOperationError(msg);
+}
+
 string
 BackendManager::get_writable_database_args(const std::string&,
 					   unsigned int)
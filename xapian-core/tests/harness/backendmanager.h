@@ -147,6 +147,17 @@ class BackendManager {
 			unsigned int timeout,
 			int* port_ptr);
 
+    /** Get a remote database instance for writable database @a name served
+     *  by a pool of threads.
+     *
+     *  The server keeps running after the returned Database is closed, so
+     *  further connections can be made to the port stored in *port_ptr.
+     */
+    virtual Xapian::Database
+    get_threaded_remote_database(const std::string& name,
+				 unsigned n_threads,
+				 int* port_ptr);
+
     /** Get the args for opening a writable remote database with the
      *  specified timeout.
      */
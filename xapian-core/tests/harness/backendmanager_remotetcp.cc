@@ -95,17 +95,60 @@ class ServerData {
      */
     const void* db_internal;
 
+    /** Does the server exit once it has handled one connection?
+     *
+     *  If not, clean_up() needs to kill it.
+     */
+    bool one_shot;
+
+    /// Kill the server.
+    void kill_server() {
+#ifdef HAVE_FORK
+	// Kill the process group that we put the server in so that we kill
+	// the server itself and not just the /bin/sh that launched it.
+	if (kill(-pid, SIGKILL) < 0) {
+	    throw Xapian::DatabaseError("Couldn't kill remote server",
+					errno);
+	}
+#elif defined __WIN32__
+	// We want to kill the whole process group so we need to use
+	// GenerateConsoleCtrlEvent() - TerminateProcess() can only
+	// terminate one process given its handle.
+	if (!GenerateConsoleCtrlEvent(CTRL_BREAK_EVENT, pid)) {
+	    throw Xapian::DatabaseError("Couldn't kill remote server",
+					-int(GetLastError()));
+	}
+#endif
+    }
+
+    /// Wait for the server to exit.
+    void wait_for_exit() {
+#ifdef HAVE_FORK
+	int status;
+	while (waitpid(pid, &status, 0) == -1 && errno == EINTR) { }
+	// Other possible error from waitpid is ECHILD, which it seems can
+	// only mean that the child has already exited and SIGCHLD was set
+	// to SIG_IGN.  If we did somehow see that, it seems reasonable to
+	// treat the child as successfully cleaned up.
+#elif defined __WIN32__
+	WaitForSingleObject(handle, INFINITE);
+	CloseHandle(handle);
+#endif
+    }
+
   public:
 #ifndef __WIN32__
-    void init(pid_type pid_) {
+    void init(pid_type pid_, bool one_shot_) {
 	pid = pid_;
 	db_internal = nullptr;
+	one_shot = one_shot_;
     }
 #else
-    void init(pid_type pid_, HANDLE handle_) {
+    void init(pid_type pid_, HANDLE handle_, bool one_shot_) {
 	pid = pid_;
 	handle = handle_;
 	db_internal = nullptr;
+	one_shot = one_shot_;
     }
 #endif
 
@@ -113,38 +156,14 @@ class ServerData {
 
     void clean_up() {
 	if (pid == DEAD_PID) return;
-#ifdef HAVE_FORK
-	int status;
-	while (waitpid(pid, &status, 0) == -1 && errno == EINTR) { }
-	// Other possible error from waitpid is ECHILD, which it seems can
-	// only mean that the child has already exited and SIGCHLD was set
-	// to SIG_IGN.  If we did somehow see that, it seems reasonable to
-	// treat the child as successfully cleaned up.
-#elif defined __WIN32__
-	WaitForSingleObject(handle, INFINITE);
-	CloseHandle(handle);
-#endif
+	if (!one_shot) kill_server();
+	wait_for_exit();
     }
 
     bool kill_remote(const void* dbi) {
 	if (pid == DEAD_PID || dbi != db_internal) return false;
-#ifdef HAVE_FORK
-	// Kill the process group that we put the server in so that we kill
-	// the server itself and not just the /bin/sh that launched it.
-	if (kill(-pid, SIGKILL) < 0) {
-	    throw Xapian::DatabaseError("Couldn't kill remote server",
-					errno);
-	}
-#elif defined __WIN32__
-	// We want to kill the whole process group so we need to use
-	// GenerateConsoleCtrlEvent() - TerminateProcess() can only
-	// terminate one process given its handle.
-	if (!GenerateConsoleCtrlEvent(CTRL_BREAK_EVENT, pid)) {
-	    throw Xapian::DatabaseError("Couldn't kill remote server",
-					-int(GetLastError()));
-	}
-#endif
-	clean_up();
+	kill_server();
+	wait_for_exit();
 	pid = DEAD_PID;
 	return true;
     }
@@ -167,12 +186,14 @@ static unsigned first_unused_server_data = 0;
 #ifdef HAVE_FORK
 
 static std::pair<int, ServerData&>
-launch_xapian_tcpsrv(const string & args)
+launch_xapian_tcpsrv(const string & args, bool one_shot = true)
 {
     int port = DEFAULT_PORT;
 
 try_next_port:
-    string cmd = XAPIAN_TCPSRV " --one-shot --interface " LOCALHOST " --port ";
+    string cmd = XAPIAN_TCPSRV;
+    if (one_shot) cmd += " --one-shot";
+    cmd += " --interface " LOCALHOST " --port ";
     cmd += str(port);
     cmd += " ";
     cmd += args;
@@ -273,7 +294,7 @@ try_next_port:
     }
 
     auto& data = server_data[first_unused_server_data++];
-    data.init(child);
+    data.init(child, one_shot);
     return {port, data};
 }
 
@@ -303,12 +324,14 @@ static void win32_throw_error_string(const char * str)
 // This implementation uses the WIN32 API to start xapian-tcpsrv as a child
 // process and read its output using a pipe.
 static std::pair<int, ServerData&>
-launch_xapian_tcpsrv(const string & args)
+launch_xapian_tcpsrv(const string & args, bool one_shot = true)
 {
     int port = DEFAULT_PORT;
 
 try_next_port:
-    string cmd = XAPIAN_TCPSRV " --one-shot --interface " LOCALHOST " --port ";
+    string cmd = XAPIAN_TCPSRV;
+    if (one_shot) cmd += " --one-shot";
+    cmd += " --interface " LOCALHOST " --port ";
     cmd += str(port);
     cmd += " ";
     cmd += args;
@@ -381,7 +404,7 @@ try_next_port:
     }
 
     auto& data = server_data[first_unused_server_data++];
-    data.init(procinfo.dwProcessId, procinfo.hProcess);
+    data.init(procinfo.dwProcessId, procinfo.hProcess, one_shot);
     return {port, data};
 }
 
@@ -454,6 +477,23 @@ BackendManagerRemoteTcp::get_writable_database_again()
     return get_remotetcp_writable_db(get_writable_database_again_args());
 }
 
+Xapian::Database
+BackendManagerRemoteTcp::get_threaded_remote_database(const string& name,
+						      unsigned n_threads,
+						      int* port_ptr)
+{
+    string args = "--threads ";
+    args += str(n_threads);
+    args += ' ';
+    args += get_remote_database_args(get_generated_database_path(name),
+				     300000);
+    auto [port, server] = launch_xapian_tcpsrv(args, false);
+    if (port_ptr) *port_ptr = port;
+    auto db = Xapian::Remote::open(LOCALHOST, port);
+    server.set_db_internal(db.internal.get());
+    return db;
+}
+
 void
 BackendManagerRemoteTcp::kill_remote(const Xapian::Database& db)
 {
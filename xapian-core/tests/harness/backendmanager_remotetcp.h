@@ -58,6 +58,16 @@ class BackendManagerRemoteTcp : public BackendManagerRemote {
 					 unsigned int timeout,
 					 int* port_ptr);
 
+    /** Create a RemoteTcp Xapian::Database for writable database @a name
+     *  using a server which services connections from a pool of
+     *  @a n_threads threads.
+     *
+     *  The server keeps running until clean_up() is called.
+     */
+    Xapian::Database get_threaded_remote_database(const std::string& name,
+						  unsigned n_threads,
+						  int* port_ptr);
+
     /// Get a RemoteTcp Xapian::Database instance of the database at path
     Xapian::Database get_database_by_path(const std::string& path);
 
@@ -0,0 +1,116 @@
+/** @file
+ * @brief BackendManager subclass for tiered databases.
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "backendmanager_tiered.h"
+
+#include "filetests.h"
+#include "setenv.h"
+#include "unixcmds.h"
+
+#include <cerrno>
+#include <cstdio> // For rename().
+
+using namespace std;
+
+#define CACHE_DIRECTORY ".tiered"
+
+BackendManagerTiered::BackendManagerTiered(const string& datadir_)
+    : BackendManager(datadir_, "tiered")
+{
+    // Freeze the head after a few documents so the test databases are spread
+    // over several segments, and merge after two so merging gets exercised.
+    setenv("XAPIAN_TIERED_FREEZE_THRESHOLD", "3", 0);
+    setenv("XAPIAN_TIERED_MERGE_FACTOR", "2", 0);
+
+    // Ensure the directory we store cached test databases in exists.
+    (void)create_dir_if_needed(CACHE_DIRECTORY);
+}
+
+string
+BackendManagerTiered::do_get_database_path(const vector<string>& files)
+{
+    string db_path = CACHE_DIRECTORY "/db";
+    for (const string& file : files) {
+	db_path += "__";
+	db_path += file;
+    }
+
+    if (!dir_exists(db_path)) {
+	// No cached DB exists.  Create at a temporary path and rename
+	// so we don't leave a partial DB in place upon failure.
+	string tmp_path = db_path + ".tmp";
+	// Make sure there's nothing existing at our temporary path.
+	rm_rf(tmp_path);
+	auto flags = Xapian::DB_CREATE|Xapian::DB_BACKEND_TIERED;
+	Xapian::WritableDatabase wdb(tmp_path, flags);
+	index_files_to_database(wdb, files);
+	wdb.close();
+	if (rename(tmp_path.c_str(), db_path.c_str()) < 0) {
+	    throw Xapian::DatabaseError("rename failed", errno);
+	}
+    }
+
+    return db_path;
+}
+
+Xapian::WritableDatabase
+BackendManagerTiered::get_writable_database(const string& name,
+					    const string& file)
+{
+    last_wdb_name = name;
+    string db_path = CACHE_DIRECTORY "/" + name;
+
+    // We can't use a cached version, as it may have been modified by the
+    // testcase.
+    rm_rf(db_path);
+
+    auto flags = Xapian::DB_CREATE|Xapian::DB_BACKEND_TIERED;
+    Xapian::WritableDatabase wdb(db_path, flags);
+    index_files_to_database(wdb, vector<string>(1, file));
+
+    return wdb;
+}
+
+string
+BackendManagerTiered::get_writable_database_path(const string& name)
+{
+    return CACHE_DIRECTORY "/" + name;
+}
+
+string
+BackendManagerTiered::get_generated_database_path(const string& name)
+{
+    return BackendManagerTiered::get_writable_database_path(name);
+}
+
+Xapian::WritableDatabase
+BackendManagerTiered::get_writable_database_again()
+{
+    return Xapian::WritableDatabase(CACHE_DIRECTORY "/" + last_wdb_name,
+				    Xapian::DB_OPEN|Xapian::DB_BACKEND_TIERED);
+}
+
+string
+BackendManagerTiered::get_writable_database_path_again()
+{
+    return CACHE_DIRECTORY "/" + last_wdb_name;
+}
@@ -0,0 +1,62 @@
+/** @file
+ * @brief BackendManager subclass for tiered databases.
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef XAPIAN_INCLUDED_BACKENDMANAGER_TIERED_H
+#define XAPIAN_INCLUDED_BACKENDMANAGER_TIERED_H
+
+#include "backendmanager.h"
+
+#include <string>
+
+/// BackendManager subclass for tiered databases.
+class BackendManagerTiered : public BackendManager {
+    /// Don't allow assignment.
+    void operator=(const BackendManagerTiered&) = delete;
+
+    /// Don't allow copying.
+    BackendManagerTiered(const BackendManagerTiered&) = delete;
+
+    /// The path of the last writable database used.
+    std::string last_wdb_name;
+
+    /// Get the path of a tiered Xapian::Database instance.
+    std::string do_get_database_path(const std::vector<std::string>& files);
+
+  public:
+    explicit BackendManagerTiered(const std::string& datadir_);
+
+    /// Create a tiered Xapian::WritableDatabase object indexing a single file.
+    Xapian::WritableDatabase get_writable_database(const std::string& name,
+						   const std::string& file);
+
+    /// Get the path of a tiered Xapian::WritableDatabase instance.
+    std::string get_writable_database_path(const std::string& name);
+
+    /// Get the path to use for generating a database, if supported.
+    std::string get_generated_database_path(const std::string& name);
+
+    /// Create a WritableDatabase object for the last opened WritableDatabase.
+    Xapian::WritableDatabase get_writable_database_again();
+
+    /// Get the path of the last opened WritableDatabase.
+    std::string get_writable_database_path_again();
+};
+
+#endif // XAPIAN_INCLUDED_BACKENDMANAGER_TIERED_H
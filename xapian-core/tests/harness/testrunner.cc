@@ -32,6 +32,7 @@
 #include "backendmanager_remoteprog.h"
 #include "backendmanager_remotetcp.h"
 #include "backendmanager_singlefile.h"
+#include "backendmanager_tiered.h"
 
 #include "stringutils.h"
 #include <iostream>
@@ -102,6 +103,10 @@ TestRunner::set_properties_for_backend(const string & backend_name)
 	    BACKEND|POSITIONAL|METADATA|SPELLING|SYNONYMS|VALUESTATS|
 	    CHECK|COMPACT|PATH
 	},
+	{ "tiered", TIERED|
+	    BACKEND|TRANSACTIONS|POSITIONAL|WRITABLE|SPELLING|METADATA|
+	    SYNONYMS|VALUESTATS|PATH
+	},
 	{ NULL, 0 }
     };
 
@@ -182,6 +187,10 @@ TestRunner::run_tests(int argc, char ** argv)
 # endif
 	}
 #endif
+
+#ifdef XAPIAN_HAS_TIERED_BACKEND
+	do_tests_for_backend(BackendManagerTiered(datadir));
+#endif
     } catch (const std::exception& e) {
 	cerr << "\nTest harness failed with std::exception: " << e.what()
 	     << '\n';
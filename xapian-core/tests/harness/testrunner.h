@@ -91,6 +91,7 @@ class TestRunner {
 	REMOTETCP	= 0x00020000,
 	/// Supports Xapian::Database::check().
 	CHECK		= 0x00040000,
+	TIERED		= 0x00080000,
     };
 
   public:
@@ -27,6 +27,7 @@
 #include <climits>
 #include <cmath>
 #include <cstring>
+#include <algorithm>
 #include <iostream>
 #include <limits>
 #include <memory>
@@ -75,6 +76,7 @@ static const char * unittest_assertion_failed = NULL;
 // Code we're unit testing:
 #include "../backends/uuids.cc"
 #include "../common/closefrom.cc"
+#include "../common/compression_stream.cc"
 #include "../common/errno_to_string.cc"
 #include "../common/io_utils.cc"
 #include "../common/fileutils.cc"
@@ -96,6 +98,9 @@ static const char * unittest_assertion_failed = NULL;
 // The UUID code uses hex_decode().
 #include "../api/constinfo.cc"
 
+// WildcardKeys is a header-only template.
+#include "../backends/wildcardindex.h"
+
 using namespace std;
 
 // Stub replacement, which doesn't deal with escaping or producing valid UTF-8.
@@ -1015,6 +1020,33 @@ try {
     throw e.get_description();
 }
 
+/// Check corrupt sizes in compressed tags are rejected before allocating.
+DEFINE_TESTCASE(corruptcompressed1) {
+#if !defined HAVE_ZSTD && !defined HAVE_LZ4
+    SKIP_TEST("Built without zstd or LZ4 support");
+#else
+    auto& stream = CompressionStream::get_thread_local();
+    string buf;
+# ifdef HAVE_ZSTD
+    // A zstd frame header claiming 2**61 bytes of content.
+    static const char zstd_frame[] = "\x28\xb5\x2f\xfd\xe0"
+				     "\0\0\0\0\0\0\0\x20";
+    TEST_EXCEPTION(Xapian::DatabaseCorruptError,
+		   stream.decompress(COMPRESSION_ZSTD, nullptr, zstd_frame,
+				     sizeof(zstd_frame) - 1, buf));
+# endif
+# ifdef HAVE_LZ4
+    // An LZ4 tag claiming 1MB of content from 2 bytes.
+    string lz4_tag;
+    pack_uint(lz4_tag, 1000000u);
+    lz4_tag += "\x10x";
+    TEST_EXCEPTION(Xapian::DatabaseCorruptError,
+		   stream.decompress(COMPRESSION_LZ4, nullptr, lz4_tag.data(),
+				     lz4_tag.size(), buf));
+# endif
+#endif
+}
+
 DEFINE_TESTCASE(vec1) {
     Xapian::Vec<int> v_int;
     Xapian::Vec<double> v_double;
@@ -1038,6 +1070,77 @@ DEFINE_TESTCASE(vecdeleter1) {
     }
 }
 
+namespace {
+
+/// Stands in for a temporary table in wildcardkeys1.
+struct FakeRun {
+    vector<string> entries;
+
+    string get_path() const { return string(); }
+
+    void add(string_view key, const string&) { entries.emplace_back(key); }
+};
+
+/// Stands in for a cursor on a temporary table in wildcardkeys1.
+struct FakeRunCursor {
+    const FakeRun* run;
+
+    size_t i = 0;
+
+    string current_key;
+
+    explicit FakeRunCursor(const FakeRun* run_) : run(run_) { }
+
+    void rewind() { i = 0; }
+
+    bool next() {
+	if (i == run->entries.size()) return false;
+	current_key = run->entries[i++];
+	return true;
+    }
+};
+
+}
+
+/// Check WildcardKeys sorts and deduplicates keys spilled to several runs.
+DEFINE_TESTCASE(wildcardkeys1) {
+    vector<string> added;
+    for (unsigned n = 0; n != 1000; ++n) {
+	// Scatter the keys, and add some more than once.
+	added.push_back(str(n * 7919 % 1000));
+	if (n % 3 == 0) added.push_back(str(n));
+    }
+    for (size_t run_size : { size_t(0), size_t(200), size_t(1000000) }) {
+	auto end_run = [](FakeRun*) { };
+	unsigned n_runs = 0;
+	auto new_run = [&](unsigned n) {
+	    TEST_EQUAL(n, n_runs);
+	    ++n_runs;
+	    return new FakeRun;
+	};
+	WildcardKeys<FakeRun, FakeRunCursor> keys(new_run, end_run, run_size);
+	for (auto& key : added) keys.add(key);
+	keys.start();
+	TEST_EQUAL(keys.get_run_count(), n_runs);
+	if (run_size == 1000000) {
+	    TEST_EQUAL(n_runs, 0);
+	} else {
+	    TEST_REL(n_runs, >, 10);
+	}
+	vector<string> result;
+	while (const string* key = keys.get()) {
+	    result.push_back(*key);
+	    keys.next();
+	}
+	vector<string> expected = added;
+	sort(expected.begin(), expected.end());
+	expected.erase(unique(expected.begin(), expected.end()),
+		       expected.end());
+	TEST_EQUAL(result.size(), 1000);
+	TEST(result == expected);
+    }
+}
+
 static const test_desc tests[] = {
     TESTCASE(simple_exceptions_work1),
     TESTCASE(class_exceptions_work1),
@@ -1062,8 +1165,10 @@ static const test_desc tests[] = {
     TESTCASE(parseunsigned1),
     TESTCASE(parsesigned1),
     TESTCASE(ioblock1),
+    TESTCASE(corruptcompressed1),
     TESTCASE(vec1),
     TESTCASE(vecdeleter1),
+    TESTCASE(wildcardkeys1),
     END_OF_TESTCASES
 };
 
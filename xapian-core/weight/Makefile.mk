@@ -1,4 +1,5 @@
 noinst_HEADERS +=\
+	weight/weightblock.h\
 	weight/weightinternal.h
 
 EXTRA_DIST +=\
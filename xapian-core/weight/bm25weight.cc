@@ -21,6 +21,7 @@
 #include <config.h>
 
 #include "xapian/weight.h"
+#include "weightblock.h"
 #include "weightinternal.h"
 
 #include "debuglog.h"
@@ -174,12 +175,66 @@ BM25Weight::get_sumpart(Xapian::termcount wdf, Xapian::termcount len,
     RETURN(termweight * (wdf_double / denom));
 }
 
+void
+BM25Weight::get_sumpart_block(size_t n,
+			      const Xapian::termcount* wdf,
+			      const Xapian::termcount* len,
+			      const Xapian::termcount*,
+			      const Xapian::termcount*,
+			      double* out) const
+{
+    LOGCALL_VOID(WTCALC, "BM25Weight::get_sumpart_block", n);
+    // This needs to calculate exactly the same values as get_sumpart().
+    double one_minus_b = 1 - param_b;
+    size_t i = 0;
+#ifdef __SSE2__
+    if (TERMCOUNTS_PD_OK) {
+	const __m128d v_len_factor = _mm_set1_pd(len_factor);
+	const __m128d v_min_normlen = _mm_set1_pd(param_min_normlen);
+	const __m128d v_b = _mm_set1_pd(param_b);
+	const __m128d v_one_minus_b = _mm_set1_pd(one_minus_b);
+	const __m128d v_k1 = _mm_set1_pd(param_k1);
+	const __m128d v_termweight = _mm_set1_pd(termweight);
+	for ( ; i + 2 <= n; i += 2) {
+	    __m128d v_wdf = load_termcounts_pd(wdf + i);
+	    __m128d normlen = _mm_mul_pd(load_termcounts_pd(len + i),
+					 v_len_factor);
+	    normlen = _mm_max_pd(normlen, v_min_normlen);
+	    __m128d denom = _mm_add_pd(_mm_mul_pd(normlen, v_b),
+				       v_one_minus_b);
+	    denom = _mm_add_pd(_mm_mul_pd(v_k1, denom), v_wdf);
+	    _mm_storeu_pd(out + i,
+			  _mm_mul_pd(v_termweight, _mm_div_pd(v_wdf, denom)));
+	}
+    }
+#endif
+    for ( ; i != n; ++i) {
+	Xapian::doclength normlen = max(len[i] * len_factor, param_min_normlen);
+	double wdf_double = wdf[i];
+	double denom = param_k1 * (normlen * param_b + one_minus_b) + wdf_double;
+	AssertRel(denom,>,0);
+	out[i] = termweight * (wdf_double / denom);
+    }
+}
+
 double
 BM25Weight::get_maxpart() const
 {
     LOGCALL(WTCALC, double, "BM25Weight::get_maxpart", NO_ARGS);
+    RETURN(BM25Weight::get_block_maxpart(get_wdf_upper_bound(),
+					 get_doclength_lower_bound()));
+}
+
+double
+BM25Weight::get_block_maxpart(Xapian::termcount wdf_max,
+			      Xapian::termcount doclen_min) const
+{
+    LOGCALL(WTCALC, double, "BM25Weight::get_block_maxpart",
+	    wdf_max | doclen_min);
+    // The shard-wide bounds may be tighter than those for the block.
+    wdf_max = min(wdf_max, get_wdf_upper_bound());
+    doclen_min = max(doclen_min, get_doclength_lower_bound());
     double denom = param_k1;
-    Xapian::termcount wdf_max = get_wdf_upper_bound();
     if (param_k1 != 0.0) {
 	if (param_b != 0.0) {
 	    // "Upper-bound Approximations for Dynamic Pruning" Craig
@@ -191,8 +246,7 @@ BM25Weight::get_maxpart() const
 	    // better bound can be found by simply evaluating at
 	    // doclen=doclen_min and wdf=wdf_max.
 	    Xapian::doclength normlen_lb =
-		 max(max(wdf_max, get_doclength_lower_bound()) * len_factor,
-		     param_min_normlen);
+		 max(max(wdf_max, doclen_min) * len_factor, param_min_normlen);
 	    denom *= (normlen_lb * param_b + (1 - param_b));
 	}
     }
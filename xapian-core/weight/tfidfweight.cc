@@ -26,6 +26,7 @@
 #include "keyword.h"
 #include "weight/idf-norm-dispatch.h"
 #include "weight/wdf-norm-dispatch.h"
+#include "weightblock.h"
 #include "weightinternal.h"
 #include <cmath>
 #include <cstring>
@@ -125,6 +126,7 @@ TfIdfWeight::TfIdfWeight(wdf_norm wdf_normalization,
     need_stat(WDF);
     need_stat(WDF_MAX);
     need_stat(WQF);
+    need_stat(HAS_SUMPART_BLOCK_);
     if (wdf_norm_ == wdf_norm::PIVOTED || idf_norm_ == idf_norm::PIVOTED) {
 	need_stat(AVERAGE_LENGTH);
 	need_stat(DOC_LENGTH);
@@ -212,6 +214,41 @@ TfIdfWeight::get_sumpart(Xapian::termcount wdf,
     return get_wtn(wdfn * idfn, wt_norm_) * wqf_factor;
 }
 
+void
+TfIdfWeight::get_sumpart_block(size_t n,
+			       const Xapian::termcount* wdf,
+			       const Xapian::termcount* doclen,
+			       const Xapian::termcount* uniqterms,
+			       const Xapian::termcount* wdfdocmax,
+			       double* out) const
+{
+    // This needs to calculate exactly the same values as get_sumpart().
+    size_t i = 0;
+    if (wdf_norm_ == wdf_norm::NONE && wt_norm_ == wt_norm::NONE) {
+	// The default normalisation, and simple enough to vectorise.
+#ifdef __SSE2__
+	if (TERMCOUNTS_PD_OK) {
+	    const __m128d v_idfn = _mm_set1_pd(idfn);
+	    const __m128d v_wqf_factor = _mm_set1_pd(wqf_factor);
+	    for ( ; i + 2 <= n; i += 2) {
+		__m128d w = _mm_mul_pd(load_termcounts_pd(wdf + i), v_idfn);
+		_mm_storeu_pd(out + i, _mm_mul_pd(w, v_wqf_factor));
+	    }
+	}
+#endif
+	for ( ; i != n; ++i) {
+	    out[i] = (double(wdf[i]) * idfn) * wqf_factor;
+	}
+	return;
+    }
+
+    for ( ; i != n; ++i) {
+	double wdfn = get_wdfn(wdf[i], doclen[i], uniqterms[i], wdfdocmax[i],
+			       wdf_norm_);
+	out[i] = get_wtn(wdfn * idfn, wt_norm_) * wqf_factor;
+    }
+}
+
 // An upper bound can be calculated simply on the basis of wdf_max as termfreq
 // and N are constants.
 double
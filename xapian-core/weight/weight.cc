@@ -200,6 +200,25 @@ Weight::unserialise(const string &) const
     throw Xapian::UnimplementedError("unserialise() not supported for this Xapian::Weight subclass");
 }
 
+void
+Weight::get_sumpart_block(size_t n,
+			  const Xapian::termcount* wdf,
+			  const Xapian::termcount* doclen,
+			  const Xapian::termcount* uniqterms,
+			  const Xapian::termcount* wdfdocmax,
+			  double* out) const
+{
+    for (size_t i = 0; i != n; ++i) {
+	out[i] = get_sumpart(wdf[i], doclen[i], uniqterms[i], wdfdocmax[i]);
+    }
+}
+
+double
+Weight::get_block_maxpart(Xapian::termcount, Xapian::termcount) const
+{
+    return get_maxpart();
+}
+
 double
 Weight::get_sumextra(Xapian::termcount,
 		     Xapian::termcount,
@@ -0,0 +1,52 @@
+/** @file
+ * @brief Helpers for implementing Weight::get_sumpart_block()
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef XAPIAN_INCLUDED_WEIGHTBLOCK_H
+#define XAPIAN_INCLUDED_WEIGHTBLOCK_H
+
+#include "xapian/types.h"
+
+#ifdef __SSE2__
+# include <emmintrin.h>
+
+/** Can load_termcounts_pd() be used?
+ *
+ *  It assumes a 32-bit termcount, which isn't the case if Xapian was
+ *  configured with --enable-64bit-termcount.
+ */
+constexpr bool TERMCOUNTS_PD_OK = (sizeof(Xapian::termcount) == 4);
+
+/** Load two termcount values and convert them to doubles.
+ *
+ *  SSE2 only has a signed 32-bit integer to double conversion, so we flip the
+ *  top bit to map the unsigned range onto the signed range, convert, and then
+ *  add back the offset.  All the values involved are exactly representable
+ *  as doubles so the result is exact.
+ */
+inline __m128d
+load_termcounts_pd(const Xapian::termcount* p)
+{
+    __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+    v = _mm_xor_si128(v, _mm_set1_epi32(static_cast<int>(0x80000000)));
+    return _mm_add_pd(_mm_cvtepi32_pd(v), _mm_set1_pd(2147483648.0));
+}
+#endif
+
+#endif // XAPIAN_INCLUDED_WEIGHTBLOCK_H
@@ -23,66 +23,82 @@
 #include "xapian-letor/feature.h"
 #include "feature_internal.h"
 
-#include <cmath>
-#include <cstdio>
-#include <cstdlib>
-#include <cstring>
+#include <algorithm>
 #include "debuglog.h"
 
 using namespace std;
 using namespace Xapian;
 
+size_t
+Feature::Internal::term_index(const std::string& term) const
+{
+    auto it = lower_bound(query_terms.begin(), query_terms.end(), term);
+    if (it != query_terms.end() && *it == term) {
+	return it - query_terms.begin();
+    }
+    return query_terms.size();
+}
+
+Feature::Internal::part
+Feature::Internal::part_from_name(const std::string& name)
+{
+    if (name == "title") return TITLE;
+    if (name == "body") return BODY;
+    if (name == "whole") return WHOLE;
+    return N_PARTS;
+}
+
+void
+Feature::Internal::set_query(const Xapian::Database& db,
+			     const Xapian::Query& query)
+{
+    feature_db = db;
+    feature_query = query;
+    feature_doc = Xapian::Document();
+    // The unique terms are returned in ascending order.
+    query_terms.assign(query.get_unique_terms_begin(), query.get_terms_end());
+    termfreq.clear();
+    inverse_doc_freq.clear();
+    collection_termfreq.clear();
+    for (int p = 0; p != N_PARTS; ++p) {
+	doc_length[p] = 0;
+	collection_length[p] = 0;
+    }
+}
+
 Xapian::termcount
 Feature::Internal::get_termfreq(const std::string& term) const
 {
     LOGCALL(API, Xapian::termcount, "Feature::Internal::get_termfreq", term);
-    auto termfreq_iterator = termfreq.find(term);
-    if (termfreq_iterator != termfreq.end()) {
-	return termfreq_iterator->second;
-    }
-    return 0;
+    return get_termfreq(term_index(term));
 }
 
 double
 Feature::Internal::get_inverse_doc_freq(const std::string& term) const
 {
     LOGCALL(API, double, "Feature::Internal::get_inverse_doc_freq", term);
-    auto inverse_doc_freq_iterator = inverse_doc_freq.find(term);
-    if (inverse_doc_freq_iterator != inverse_doc_freq.end()) {
-	return inverse_doc_freq_iterator->second;
-    }
-    return 0;
+    return get_inverse_doc_freq(term_index(term));
 }
 
 Xapian::termcount
-Feature::Internal::get_doc_length(const std::string& term) const
+Feature::Internal::get_doc_length(const std::string& name) const
 {
-    LOGCALL(API, Xapian::termcount, "Feature::Internal::get_doc_length", term);
-    auto doc_length_iterator = doc_length.find(term);
-    if (doc_length_iterator != doc_length.end()) {
-	return doc_length_iterator->second;
-    }
-    return 0;
+    LOGCALL(API, Xapian::termcount, "Feature::Internal::get_doc_length", name);
+    part p = part_from_name(name);
+    return p == N_PARTS ? 0 : doc_length[p];
 }
 
 Xapian::termcount
-Feature::Internal::get_collection_length(const std::string& term) const
+Feature::Internal::get_collection_length(const std::string& name) const
 {
-    LOGCALL(API, Xapian::termcount, "Feature::Internal::get_collection_length", term);
-    auto collection_length_iterator = collection_length.find(term);
-    if (collection_length_iterator != collection_length.end()) {
-	return collection_length_iterator->second;
-    }
-    return 0;
+    LOGCALL(API, Xapian::termcount, "Feature::Internal::get_collection_length", name);
+    part p = part_from_name(name);
+    return p == N_PARTS ? 0 : collection_length[p];
 }
 
 Xapian::termcount
 Feature::Internal::get_collection_termfreq(const std::string& term) const
 {
     LOGCALL(API, Xapian::termcount, "Feature::Internal::get_collection_termfreq", term);
-    auto collection_termfreq_iterator = collection_termfreq.find(term);
-    if (collection_termfreq_iterator != collection_termfreq.end()) {
-	return collection_termfreq_iterator->second;
-    }
-    return 0;
+    return get_collection_termfreq(term_index(term));
 }
@@ -24,14 +24,25 @@
 #include "xapian-letor/feature.h"
 #include "xapian-letor/featurelist.h"
 
-#include <map>
+#include <string>
+#include <vector>
 
 namespace Xapian {
 
-/** Class defining internals of Feature class. */
+/** Class defining internals of Feature class.
+ *
+ *  The per-term statistics are stored in vectors parallel to the unique
+ *  terms of the query, so features can work through the query terms by
+ *  index rather than looking each term up.
+ */
 class Feature::Internal : public Xapian::Internal::intrusive_base {
     friend class Feature;
 
+  public:
+    /// The parts of a document or collection we have lengths for.
+    typedef enum { TITLE, BODY, WHOLE, N_PARTS } part;
+
+  private:
     /// Xapian::Database using which features will be calculated.
     Database feature_db;
 
@@ -41,34 +52,40 @@ class Feature::Internal : public Xapian::Internal::intrusive_base {
     /// Xapian::Document using which features will be calculated.
     Document feature_doc;
 
-    /// Frequency of the Query Terms in the specified documents.
-    std::map<std::string, Xapian::termcount> termfreq;
+    /// The unique terms in the query, in ascending order.
+    std::vector<std::string> query_terms;
 
-    /// Inverse Document Frequency of Query terms in the database.
-    std::map<std::string, double> inverse_doc_freq;
+    /// Frequency of each query term in the specified document.
+    std::vector<Xapian::termcount> termfreq;
 
-    /** Length of the document as number of terms for different parts like
-     *  'title', 'body' and 'whole'.
-     */
-    std::map<std::string, Xapian::termcount> doc_length;
+    /// Inverse Document Frequency of each query term in the database.
+    std::vector<double> inverse_doc_freq;
+
+    /// Length of the document as number of terms for each part.
+    Xapian::termcount doc_length[N_PARTS] = {};
+
+    /// Length of the collection in number of terms for each part.
+    Xapian::termcount collection_length[N_PARTS] = {};
+
+    /// Frequency of each query term in the whole database.
+    std::vector<Xapian::termcount> collection_termfreq;
 
-    /** Length of the collection in number of terms for different parts like
-     * 'title', 'body' and 'whole'.
+    /** Find the index of @a term in query_terms.
+     *
+     *  @return The index, or query_terms.size() if @a term isn't a query term.
      */
-    std::map<std::string, Xapian::termcount> collection_length;
+    size_t term_index(const std::string& term) const;
 
-    /// Frequency of the Query Terms in the whole database
-    std::map<std::string, Xapian::termcount> collection_termfreq;
+    /** Convert a part name ("title", "body" or "whole") to a part.
+     *
+     *  @return The part, or N_PARTS if @a name isn't recognised.
+     */
+    static part part_from_name(const std::string& name);
 
   public:
     /// Default constructor
     Internal() {}
 
-    /// Constructor creating an object instantiated with db,query and doc
-    Internal(const Xapian::Database& db, const Xapian::Query& query,
-	     const Xapian::Document& doc)
-	 : feature_db(db), feature_query(query), feature_doc(doc) {}
-
     /// get database
     Database get_database() const {
 	return feature_db;
@@ -84,49 +101,81 @@ class Feature::Internal : public Xapian::Internal::intrusive_base {
 	return feature_doc;
     }
 
+    /// Get the unique terms in the query, in ascending order.
+    const std::vector<std::string>& get_query_terms() const {
+	return query_terms;
+    }
+
     /// Get termfreq
     Xapian::termcount get_termfreq(const std::string& term) const;
 
+    /// Get termfreq of the query term with index @a i.
+    Xapian::termcount get_termfreq(size_t i) const {
+	return i < termfreq.size() ? termfreq[i] : 0;
+    }
+
     /// Get inverse_doc_freq
     double get_inverse_doc_freq(const std::string& term) const;
 
+    /// Get inverse_doc_freq of the query term with index @a i.
+    double get_inverse_doc_freq(size_t i) const {
+	return i < inverse_doc_freq.size() ? inverse_doc_freq[i] : 0;
+    }
+
     /// Get doc_length
-    Xapian::termcount get_doc_length(const std::string& term) const;
+    Xapian::termcount get_doc_length(const std::string& name) const;
+
+    /// Get doc_length of part @a p.
+    Xapian::termcount get_doc_length(part p) const {
+	return doc_length[p];
+    }
 
     /// Get collection_length
-    Xapian::termcount get_collection_length(const std::string& term) const;
+    Xapian::termcount get_collection_length(const std::string& name) const;
+
+    /// Get collection_length of part @a p.
+    Xapian::termcount get_collection_length(part p) const {
+	return collection_length[p];
+    }
 
     /// Get collection_termfreq
     Xapian::termcount get_collection_termfreq(const std::string& term) const;
 
-    /// Set the term frequency to use for Feature building.
-    void set_termfreq(std::map<std::string, Xapian::termcount>&& tf) {
-	termfreq = tf;
+    /// Get collection_termfreq of the query term with index @a i.
+    Xapian::termcount get_collection_termfreq(size_t i) const {
+	return i < collection_termfreq.size() ? collection_termfreq[i] : 0;
     }
 
-    /// Set the inverse_doc_freq to use for Feature building.
-    void set_inverse_doc_freq(std::map<std::string, double>&& idf) {
-	inverse_doc_freq = idf;
-    }
-
-    /** Set the doc_length to use for Feature building.
+    /** Set the database and query to use for Feature building.
      *
-     *  This is used by Feature::Internal while populating Statistics.
+     *  This also sets the query terms and clears all the statistics.
      */
-    void set_doc_length(std::map<std::string, Xapian::termcount>&& doc_len) {
-	doc_length = doc_len;
+    void set_query(const Xapian::Database& db, const Xapian::Query& query);
+
+    /// Set the document to use for Feature building.
+    void set_document(const Xapian::Document& doc) {
+	feature_doc = doc;
+    }
+
+    /// Get writable access to the term frequencies of the query terms.
+    std::vector<Xapian::termcount>& termfreqs() { return termfreq; }
+
+    /// Get writable access to the idfs of the query terms.
+    std::vector<double>& inverse_doc_freqs() { return inverse_doc_freq; }
+
+    /// Set the doc_length of part @a p.
+    void set_doc_length(part p, Xapian::termcount len) {
+	doc_length[p] = len;
     }
 
-    /// Set the collection_length to use for Feature building.
-    void set_collection_length(std::map<std::string,
-					Xapian::termcount>&& collection_len) {
-	collection_length = collection_len;
+    /// Set the collection_length of part @a p.
+    void set_collection_length(part p, Xapian::termcount len) {
+	collection_length[p] = len;
     }
 
-    /// Set the collection_termfreq to use for Feature building.
-    void set_collection_termfreq(std::map<std::string,
-					  Xapian::termcount>&& collection_tf) {
-	collection_termfreq = collection_tf;
+    /// Get writable access to the collection term frequencies.
+    std::vector<Xapian::termcount>& collection_termfreqs() {
+	return collection_termfreq;
     }
 };
 
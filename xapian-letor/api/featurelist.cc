@@ -29,6 +29,7 @@
 
 #include "debuglog.h"
 #include "omassert.h"
+#include "str.h"
 
 using namespace std;
 
@@ -72,25 +73,48 @@ FeatureList::~FeatureList()
 }
 
 void
-FeatureList::normalise(std::vector<FeatureVector>& fvec) const
+FeatureList::update_statistics(Xapian::WritableDatabase& db)
 {
-    LOGCALL_VOID(API, "FeatureList::normalise", fvec);
-    int num_features = fvec[0].get_fcount();
-    for (int j = 0; j < num_features; ++j) {
-	// Find the maximum value of this feature.
-	double max_fval = 0.0;
-	for (const auto& v : fvec) {
-	    max_fval = max(max_fval, v.get_fvals()[j]);
-	}
+    LOGCALL_STATIC_VOID(API, "FeatureList::update_statistics", db);
+    auto len = Internal::calculate_collection_length(db);
+    db.set_metadata("collection_len_title", str(len["title"]));
+    db.set_metadata("collection_len_body", str(len["body"]));
+    db.set_metadata("collection_len_whole", str(len["whole"]));
+    // Record the revision the statistics are for, which is the one the
+    // commit below will create.
+    string revision;
+    try {
+	revision = str(db.get_revision() + 1);
+    } catch (const Xapian::InvalidOperationError&) {
+    } catch (const Xapian::UnimplementedError&) {
+    }
+    db.set_metadata("collection_len_revision", revision);
+    db.commit();
+}
 
-	if (max_fval == 0.0) {
-	    // Skip scaling step if we'd divide by zero.
-	    continue;
+/** Scale each column of a matrix so that its maximum value is 1.
+ *
+ *  Columns with a maximum value of 0 are left unchanged.
+ *
+ *  @param fmatrix	The matrix, stored by row.
+ *  @param n_cols	The number of columns.
+ */
+static void
+normalise(vector<double>& fmatrix, size_t n_cols)
+{
+    // Find the maximum value of each feature.
+    vector<double> max_fval(n_cols, 0.0);
+    for (size_t k = 0; k != fmatrix.size(); k += n_cols) {
+	for (size_t j = 0; j != n_cols; ++j) {
+	    max_fval[j] = max(max_fval[j], fmatrix[k + j]);
 	}
+    }
 
-	// Scale all values of this feature such that the max is 1.
-	for (auto& v : fvec) {
-	    v.set_feature_value(j, v.get_feature_value(j) / max_fval);
+    // Scale all values of each feature such that the max is 1, skipping
+    // features where we'd divide by zero.
+    for (size_t k = 0; k != fmatrix.size(); k += n_cols) {
+	for (size_t j = 0; j != n_cols; ++j) {
+	    if (max_fval[j] != 0.0) fmatrix[k + j] /= max_fval[j];
 	}
     }
 }
@@ -103,32 +127,48 @@ FeatureList::create_feature_vectors(const Xapian::MSet & mset,
     LOGCALL(API, std::vector<FeatureVector>, "FeatureList::create_feature_vectors", mset | letor_query | letor_db);
     if (mset.empty())
 	return vector<FeatureVector>();
-    std::vector<FeatureVector> fvec;
     Assert(!internal->feature.empty());
 
+    // We're going to need all the documents, so ask for them all up front.
+    mset.fetch(mset.begin(), mset.end());
+
+    internal->compute_query_stats(letor_query, letor_db);
+    for (Feature* it : internal->feature) {
+	it->internal = internal->stats;
+    }
+
+    // The feature values for all the documents, stored by row.
+    vector<double> fmatrix;
+    size_t n_cols = 0;
+    vector<Xapian::docid> dids;
+    dids.reserve(mset.size());
     for (Xapian::MSetIterator i = mset.begin(); i != mset.end(); ++i) {
 	Xapian::Document doc = i.get_document();
-	std::vector<double> fvals;
-	internal->set_data(letor_query, letor_db, doc);
-	auto internal_feature = new Feature::Internal(letor_db,
-						      letor_query, doc);
-	// Computes and populates the Feature::Internal with required stats.
-	internal->populate_feature_internal(internal_feature);
+	// Computes the per-document stats needed by the features.
+	internal->compute_doc_stats(doc);
 	for (Feature* it : internal->feature) {
-	    it->internal = internal_feature;
 	    const vector<double>& values = it->get_values();
 	    // Append feature values
-	    fvals.insert(fvals.end(), values.begin(), values.end());
+	    fmatrix.insert(fmatrix.end(), values.begin(), values.end());
 	}
-	double wt = i.get_weight();
 	// Weight is added as a feature by default.
-	fvals.push_back(wt);
-	Xapian::docid did = doc.get_docid();
-	// construct a FeatureVector object using did and fvals.
-	Xapian::FeatureVector fv(did, fvals);
-	fvec.push_back(fv);
+	fmatrix.push_back(i.get_weight());
+	if (n_cols == 0) {
+	    n_cols = fmatrix.size();
+	    fmatrix.reserve(n_cols * mset.size());
+	}
+	AssertEq(fmatrix.size(), n_cols * (dids.size() + 1));
+	dids.push_back(doc.get_docid());
+    }
+    normalise(fmatrix, n_cols);
+
+    std::vector<FeatureVector> fvec;
+    fvec.reserve(dids.size());
+    auto row = fmatrix.begin();
+    for (Xapian::docid did : dids) {
+	fvec.emplace_back(did, vector<double>(row, row + n_cols));
+	row += n_cols;
     }
-    normalise(fvec);
     return fvec;
 }
 
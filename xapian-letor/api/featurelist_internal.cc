@@ -31,69 +31,55 @@
 #include <cstdlib>
 #include <cstring>
 #include "debuglog.h"
+#include "str.h"
 
 using namespace std;
 using namespace Xapian;
 
 void
-FeatureList::Internal::set_data(const Xapian::Query & letor_query,
-				const Xapian::Database & letor_db,
-				const Xapian::Document & letor_doc)
+FeatureList::Internal::compute_inverse_doc_freq()
 {
-    set_query(letor_query);
-    set_doc(letor_doc);
-    set_database(letor_db);
-}
+    const vector<string>& terms = stats->get_query_terms();
+    vector<double>& idf = stats->inverse_doc_freqs();
+    idf.assign(terms.size(), 0.0);
+    Xapian::doccount totaldocs = featurelist_db.get_doccount();
 
-std::map<std::string, Xapian::termcount>
-FeatureList::Internal::compute_termfreq() const
-{
-    std::map<std::string, Xapian::termcount> tf;
-
-    Xapian::TermIterator docterms = featurelist_doc.termlist_begin();
-    for (Xapian::TermIterator qt = featurelist_query.get_unique_terms_begin();
-	 qt != featurelist_query.get_terms_end(); ++qt) {
-	docterms.skip_to(*qt);
-	if (docterms != featurelist_doc.termlist_end() && *qt == *docterms)
-	    tf[*qt] = docterms.get_wdf();
+    for (size_t i = 0; i != terms.size(); ++i) {
+	Xapian::doccount df = featurelist_db.get_termfreq(terms[i]);
+	if (df != 0)
+	    idf[i] = log10((double)totaldocs / (double)(1 + df));
     }
-    return tf;
 }
 
-std::map<std::string, double>
-FeatureList::Internal::compute_inverse_doc_freq() const
+/** Return the revision of @a db as a string.
+ *
+ *  Returns an empty string if the revision isn't available (e.g. for a
+ *  database with more than one shard).
+ */
+static string
+revision_string(const Xapian::Database& db)
 {
-    std::map<std::string, double> idf;
-    Xapian::doccount totaldocs = featurelist_db.get_doccount();
-
-    for (Xapian::TermIterator qt = featurelist_query.get_unique_terms_begin();
-	 qt != featurelist_query.get_terms_end(); ++qt) {
-	Xapian::doccount df = featurelist_db.get_termfreq(*qt);
-	if (df != 0)
-	    idf[*qt] = log10((double)totaldocs / (double)(1 + df));
+    try {
+	return str(db.get_revision());
+    } catch (const Xapian::InvalidOperationError&) {
+    } catch (const Xapian::UnimplementedError&) {
     }
-    return idf;
+    return string();
 }
 
 std::map<std::string, Xapian::termcount>
-FeatureList::Internal::compute_doc_length() const
+FeatureList::Internal::calculate_collection_length(const Xapian::Database& db)
 {
     std::map<std::string, Xapian::termcount> len;
-
     Xapian::termcount title_len = 0;
-    Xapian::TermIterator dt = featurelist_doc.termlist_begin();
-    // reach the iterator to the start of the title terms i.e. prefix "S"
-    dt.skip_to("S");
-    for ( ; dt != featurelist_doc.termlist_end(); ++dt) {
-	if ((*dt)[0] != 'S') {
-	    // We've reached the end of the S-prefixed terms.
-	    break;
-	}
-	title_len += dt.get_wdf();
+    Xapian::TermIterator dt = db.allterms_begin("S");
+    for ( ; dt != db.allterms_end("S"); ++dt) {
+	//  because we don't want the unique terms so we want their
+	// original frequencies and i.e. the total size of the title collection.
+	title_len += db.get_collection_freq(*dt);
     }
     len["title"] = title_len;
-    Xapian::termcount whole_len =
-	    featurelist_db.get_doclength(featurelist_doc.get_docid());
+    Xapian::termcount whole_len = db.get_total_length();
     len["whole"] = whole_len;
     len["body"] = whole_len - title_len;
     return len;
@@ -102,66 +88,130 @@ FeatureList::Internal::compute_doc_length() const
 std::map<std::string, Xapian::termcount>
 FeatureList::Internal::compute_collection_length() const
 {
-    std::map<std::string, Xapian::termcount> len;
+    const Xapian::Database& db = featurelist_db;
+    string revision = revision_string(db);
+    Xapian::totallength total_len = db.get_total_length();
+
+    // We can only safely reuse the cached values if we can tell if db is the
+    // same database at the same revision.
+    string key = db.get_uuid();
+    if (!key.empty() || !revision.empty()) {
+	key += '\0';
+	key += revision;
+	key += '\0';
+	key += str(total_len);
+	key += '\0';
+	key += str(db.get_doccount());
+	if (key == collection_len_key) {
+	    return collection_len;
+	}
+    }
 
-    if (!featurelist_db.get_metadata("collection_len_title").empty() &&
-	!featurelist_db.get_metadata("collection_len_body").empty() &&
-	!featurelist_db.get_metadata("collection_len_whole").empty()) {
-	len["title"] =
-	    atol(featurelist_db.get_metadata("collection_len_title").c_str());
-	len["body"] =
-	    atol(featurelist_db.get_metadata("collection_len_body").c_str());
-	len["whole"] =
-	    atol(featurelist_db.get_metadata("collection_len_whole").c_str());
+    std::map<std::string, Xapian::termcount> len;
+    // Only use the stored values if they're for the current revision.  If
+    // the revision wasn't available when they were stored (or they were
+    // stored by an older version) we can at least check the total length.
+    string stored_rev = db.get_metadata("collection_len_revision");
+    string title = db.get_metadata("collection_len_title");
+    string body = db.get_metadata("collection_len_body");
+    string whole = db.get_metadata("collection_len_whole");
+    if (!title.empty() && !body.empty() && !whole.empty() &&
+	(stored_rev.empty() || stored_rev == revision) &&
+	strtoull(whole.c_str(), NULL, 10) == total_len) {
+	len["title"] = atol(title.c_str());
+	len["body"] = atol(body.c_str());
+	len["whole"] = atol(whole.c_str());
     } else {
-	Xapian::termcount title_len = 0;
-	Xapian::TermIterator dt = featurelist_db.allterms_begin("S");
-	for ( ; dt != featurelist_db.allterms_end("S"); ++dt) {
-	    //  because we don't want the unique terms so we want their
-	    // original frequencies and i.e. the total size of the title collection.
-	    title_len += featurelist_db.get_collection_freq(*dt);
-	}
-	len["title"] = title_len;
-	Xapian::termcount whole_len = featurelist_db.get_avlength() *
-		featurelist_db.get_doccount();
-	len["whole"] = whole_len;
-	len["body"] = whole_len - title_len;
+	len = calculate_collection_length(db);
     }
+
+    collection_len_key = key;
+    collection_len = len;
     return len;
 }
 
-std::map<std::string, Xapian::termcount>
-FeatureList::Internal::compute_collection_termfreq() const
+void
+FeatureList::Internal::compute_collection_termfreq()
 {
-    std::map<std::string, Xapian::termcount> tf;
-
-    for (Xapian::TermIterator qt = featurelist_query.get_unique_terms_begin();
-	 qt != featurelist_query.get_terms_end(); ++qt) {
-	Xapian::termcount coll_tf = featurelist_db.get_collection_freq(*qt);
-	if (coll_tf != 0)
-	    tf[*qt] = coll_tf;
+    const vector<string>& terms = stats->get_query_terms();
+    vector<Xapian::termcount>& tf = stats->collection_termfreqs();
+    tf.resize(terms.size());
+    for (size_t i = 0; i != terms.size(); ++i) {
+	tf[i] = featurelist_db.get_collection_freq(terms[i]);
     }
-    return tf;
 }
 
 void
-FeatureList::Internal::populate_feature_internal(Feature::Internal*
-						 internal_feature)
+FeatureList::Internal::compute_query_stats(const Xapian::Query& query,
+					   const Xapian::Database& db)
 {
-    if (stats_needed & TERM_FREQUENCY) {
-	internal_feature->set_termfreq(compute_termfreq());
-    }
+    featurelist_query = query;
+    featurelist_db = db;
+    if (!stats) stats = new Feature::Internal();
+    stats->set_query(db, query);
+
     if (stats_needed & INVERSE_DOCUMENT_FREQUENCY) {
-	internal_feature->set_inverse_doc_freq(compute_inverse_doc_freq());
-    }
-    if (stats_needed & DOCUMENT_LENGTH) {
-	internal_feature->set_doc_length(compute_doc_length());
+	compute_inverse_doc_freq();
     }
     if (stats_needed & COLLECTION_LENGTH) {
-	internal_feature->set_collection_length(compute_collection_length());
+	auto len = compute_collection_length();
+	stats->set_collection_length(Feature::Internal::TITLE, len["title"]);
+	stats->set_collection_length(Feature::Internal::BODY, len["body"]);
+	stats->set_collection_length(Feature::Internal::WHOLE, len["whole"]);
     }
     if (stats_needed & COLLECTION_TERM_FREQ) {
-	internal_feature->set_collection_termfreq(
-			  compute_collection_termfreq());
+	compute_collection_termfreq();
+    }
+}
+
+void
+FeatureList::Internal::compute_doc_stats(const Xapian::Document& doc)
+{
+    stats->set_document(doc);
+    if (!(stats_needed & (TERM_FREQUENCY | DOCUMENT_LENGTH))) return;
+
+    const vector<string>& terms = stats->get_query_terms();
+    vector<Xapian::termcount>& tf = stats->termfreqs();
+    tf.assign(terms.size(), 0);
+
+    Xapian::TermIterator t = doc.termlist_begin();
+    Xapian::TermIterator t_end = doc.termlist_end();
+    size_t i = 0;
+    // Query terms which sort before the title terms.
+    for ( ; i != terms.size() && terms[i] < "S"; ++i) {
+	t.skip_to(terms[i]);
+	if (t != t_end && *t == terms[i])
+	    tf[i] = t.get_wdf();
+    }
+
+    // The title terms, which we need the total wdf of and which may include
+    // some of the query terms.
+    Xapian::termcount title_len = 0;
+    for (t.skip_to("S"); t != t_end; ++t) {
+	string term = *t;
+	if (term[0] != 'S') {
+	    // We've reached the end of the S-prefixed terms.
+	    break;
+	}
+	Xapian::termcount wdf = t.get_wdf();
+	title_len += wdf;
+	while (i != terms.size() && terms[i] < term) ++i;
+	if (i != terms.size() && terms[i] == term)
+	    tf[i++] = wdf;
+    }
+
+    // The remaining query terms.
+    for ( ; i != terms.size(); ++i) {
+	t.skip_to(terms[i]);
+	if (t != t_end && *t == terms[i])
+	    tf[i] = t.get_wdf();
+    }
+
+    if (stats_needed & DOCUMENT_LENGTH) {
+	Xapian::termcount whole_len =
+	    featurelist_db.get_doclength(doc.get_docid());
+	stats->set_doc_length(Feature::Internal::TITLE, title_len);
+	stats->set_doc_length(Feature::Internal::BODY, whole_len - title_len);
+	stats->set_doc_length(Feature::Internal::WHOLE, whole_len);
     }
 }
@@ -57,63 +57,45 @@ class FeatureList::Internal : public Xapian::Internal::intrusive_base {
     /// Xapian::Query using which features will be calculated.
     Query featurelist_query;
 
-    /// Xapian::Document using which features will be calculated.
-    Document featurelist_doc;
-
-    /** This method finds the frequency of the query terms in the
-     *  specified documents.
+    /** Identifies the database state which collection_len is for.
      *
-     *  This method is a helper method and statistics gathered through
-     *  this method are used in feature value calculation.
+     *  Empty if collection_len hasn't been calculated yet.
+     */
+    mutable std::string collection_len_key;
+
+    /// Cached result of compute_collection_length().
+    mutable std::map<std::string, Xapian::termcount> collection_len;
+
+    /** The statistics for the current query and document.
      *
-     *  @return A map from query terms to their term frequencies.
+     *  This is shared by all the Features in the list.
      */
-    std::map<std::string, Xapian::termcount> compute_termfreq() const;
+    Xapian::Internal::intrusive_ptr<Feature::Internal> stats;
 
     /** This method calculates the inverse document frequency(idf) of query
      *  terms in the database.
      *
-     *  This method is a helper method and statistics gathered through
-     *  this method are used in feature value calculation.
-     *
-     *  @return A map from query terms to their inverse document frequencies.
      *  Note: idf of a term 't' is calculated as below:
      *
      *  idf(t) = log(N/df(t))
      *  Where,
      *  N = Total number of documents in database and
      *  df(t) = number of documents containing term 't'
-     */
-    std::map<std::string, double> compute_inverse_doc_freq() const;
-
-    /** This method calculates the length of the documents as number of 'terms'.
-     *  It calculates the length for three different parts:
-     *  title, body and whole document.
-     *
-     *  This method is a helper method and statistics gathered through
-     *  this method are used in feature value calculation.
      *
-     *  @return A map from query terms to their document lengths.
-     *  @code
-     *  map<string, long int> len;
-     *  len["title"];
-     *  len["body"];
-     *  len["whole"];
-     *  @endcode
+     *  The idf of a term which doesn't occur in the database is 0.
      */
-    std::map<std::string, Xapian::termcount> compute_doc_length() const;
+    void compute_inverse_doc_freq();
 
     /** This method calculates the length of the collection in number of terms
      *  for different parts like 'title', 'body' and 'whole'.
      *
-     *  This is calculated as a stored user metadata in omindex otherwise
-     *  it is calculated out of scratch
-     *  (this might take some time depending upon the size of the database).
-     *
-     *  This method is a helper method and statistics gathered through
-     *  this method are used in feature value calculation.
+     *  This is read from the user metadata stored by
+     *  FeatureList::update_statistics() if that is present and up to date,
+     *  otherwise it is calculated from scratch (this might take some time
+     *  depending upon the size of the database).  The result is cached and
+     *  reused until the revision of the database changes.
      *
-     *  @return A map from query terms to their collection lengths.
+     *  @return A map from part names to their collection lengths.
      *  @code
      *  map<string, long int> len;
      *  len["title"];
@@ -124,43 +106,30 @@ class FeatureList::Internal : public Xapian::Internal::intrusive_base {
      */
     std::map<std::string, Xapian::termcount> compute_collection_length() const;
 
-    /** This method calculates the frequency of query terms in
-     *  the whole database.
+    /** Calculate the collection lengths for @a db from scratch.
      *
-     *  This method is a helper method and statistics gathered through
-     *  this method are used in feature value calculation.
-     *
-     *  @return A map from query terms to their collection term frequencies.
+     *  This iterates over all the title terms in the database.
      */
-    std::map<std::string, Xapian::termcount> compute_collection_termfreq()
-								const;
+    static std::map<std::string, Xapian::termcount>
+    calculate_collection_length(const Xapian::Database& db);
 
-    /** Specify the database to use for feature building.
-     *
-     *  This will be used by the Internal class.
-     */
-    void set_database(const Xapian::Database& db) {
-	featurelist_db = db;
-    }
+    /// Calculate the frequency of the query terms in the whole database.
+    void compute_collection_termfreq();
 
-    /** Specify the query to use for feature building.
+    /** Compute the stats which are the same for every document.
      *
-     *  This will be used by the Internal class.
+     *  Must be called for each new query or database before
+     *  compute_doc_stats().
      */
-    void set_query(const Xapian::Query& query) {
-	featurelist_query = query;
-    }
+    void compute_query_stats(const Xapian::Query& query,
+			     const Xapian::Database& db);
 
-    /** Specify the document to use for feature building.
+    /** Compute the stats for document @a doc.
      *
-     *  This will be used by the Internal class.
+     *  The frequencies of the query terms and the lengths of the parts of
+     *  the document are found in a single pass over its termlist.
      */
-    void set_doc(const Xapian::Document& doc) {
-	featurelist_doc = doc;
-    }
-
-    /// Computes and populates the stats needed by a Feature.
-    void populate_feature_internal(Feature::Internal* internal_feature);
+    void compute_doc_stats(const Xapian::Document& doc);
 
   public:
 
@@ -168,11 +137,6 @@ class FeatureList::Internal : public Xapian::Internal::intrusive_base {
      *  Each will be used to return feature value.
      */
     std::vector<Feature *> feature;
-
-    /// This method sets all the data members required for computing stats.
-    void set_data(const Xapian::Query& query,
-		  const Xapian::Database& db,
-		  const Xapian::Document& doc);
 };
 
 }
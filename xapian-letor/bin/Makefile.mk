@@ -6,7 +6,7 @@ bin_PROGRAMS +=\
 
 bin_xapian_letor_update_SOURCES =\
 	bin/xapian-letor-update.cc
-bin_xapian_letor_update_LDADD = libcommon_str.la libgetopt.la $(XAPIAN_LIBS)
+bin_xapian_letor_update_LDADD = libgetopt.la libxapianletor.la $(XAPIAN_LIBS)
 
 bin_xapian_prepare_trainingfile_SOURCES =\
 	bin/xapian-prepare-trainingfile.cc
@@ -22,12 +22,12 @@
 #include <config.h>
 
 #include <xapian.h>
+#include <xapian-letor.h>
 
 #include <cstdlib>
 #include <iostream>
 
 #include "gnu_getopt.h"
-#include "str.h"
 
 using namespace std;
 
@@ -85,19 +85,7 @@ try {
 
     // Calculate some extra collection statistics used to calculate features
     // used by Letor, and store them as user metadata.
-
-    Xapian::termcount total_title_len = 0;
-    Xapian::TermIterator t;
-    for (t = db.allterms_begin("S"); t != db.allterms_end("S"); ++t) {
-	total_title_len += db.get_collection_freq(*t);
-    }
-
-    Xapian::totallength total_len = db.get_total_length();
-
-    db.set_metadata("collection_len_title", str(total_title_len));
-    db.set_metadata("collection_len_body", str(total_len - total_title_len));
-    db.set_metadata("collection_len_whole", str(total_len));
-    db.commit();
+    Xapian::FeatureList::update_statistics(db);
 } catch (const Xapian::Error & e) {
     cout << e.get_description() << '\n';
     exit(1);
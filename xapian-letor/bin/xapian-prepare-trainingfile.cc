@@ -39,12 +39,14 @@ using namespace std;
 
 #define OPT_HELP 1
 #define OPT_VERSION 2
+#define OPT_BINARY 3
 
 static void show_usage() {
     cout << "Usage: " PROG_NAME " [OPTIONS] PATH_TO_QUERY_FILE PATH_TO_QREL_FILE PATH_TO_TRAINING_FILE\n"
     "Options:\n"
     "  -d, --db=DIRECTORY  path to database to search\n"
     "  -m, --msize=MSIZE   maximum number of matches to return\n"
+    "      --binary        write the training file in binary format\n"
     "      --help          display this help and exit\n"
     "      --version       output version information and exit\n";
 }
@@ -56,6 +58,7 @@ try {
     static const struct option long_opts[] = {
 	{ "db",		required_argument, 0, 'd' },
 	{ "msize",	required_argument, 0, 'm' },
+	{ "binary",	no_argument, 0, OPT_BINARY },
 	{ "help",	no_argument, 0, OPT_HELP },
 	{ "version",	no_argument, 0, OPT_VERSION },
 	{ NULL,		0, 0, 0}
@@ -65,6 +68,8 @@ try {
 
     bool have_database = false;
 
+    bool binary = false;
+
     string db_path;
 
     int c;
@@ -80,6 +85,9 @@ try {
 		    exit(1);
 		}
 		break;
+	    case OPT_BINARY:
+		binary = true;
+		break;
 	    case OPT_HELP:
 		cout << PROG_NAME " - " PROG_DESC "\n\n";
 		show_usage();
@@ -109,7 +117,8 @@ try {
     }
 
     // Prepare the training file.
-    Xapian::prepare_training_file(db_path, queryfile, qrelfile, msize, trainingfile);
+    Xapian::prepare_training_file(db_path, queryfile, qrelfile, msize, trainingfile,
+				  Xapian::FeatureList(), binary);
 
     cout << flush;
 
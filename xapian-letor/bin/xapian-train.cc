@@ -24,6 +24,7 @@
 
 #include <xapian.h>
 #include <xapian-letor.h>
+#include "parseint.h"
 
 #include <iostream>
 #include <string>
@@ -37,11 +38,13 @@ using namespace std;
 
 #define OPT_HELP 1
 #define OPT_VERSION 2
+#define OPT_THREADS 3
 
 static void show_usage() {
     cout << "Usage: " PROG_NAME " [OPTIONS] PATH_TO_TRAINING_FILE MODEL_METADATA_KEY\n"
     "Options:\n"
     "  -d, --db=DIRECTORY  path to database to search\n"
+    "      --threads=N     use up to N threads for training\n"
     "      --help          display this help and exit\n"
     "      --version       output version information and exit\n";
 }
@@ -52,6 +55,7 @@ try {
     const char * opts = "d:h:v";
     static const struct option long_opts[] = {
 	{ "db",		required_argument, 0, 'd' },
+	{ "threads",	required_argument, 0, OPT_THREADS },
 	{ "help",	no_argument, 0, OPT_HELP },
 	{ "version",	no_argument, 0, OPT_VERSION },
 	{ NULL,		0, 0, 0}
@@ -61,6 +65,8 @@ try {
 
     string db_path;
 
+    unsigned threads = 0;
+
     int c;
     while ((c = gnu_getopt_long(argc, argv, opts, long_opts, 0)) != -1) {
 	switch (c) {
@@ -68,6 +74,12 @@ try {
 		db_path = optarg;
 		have_database = true;
 		break;
+	    case OPT_THREADS:
+		if (!parse_unsigned(optarg, threads)) {
+		    cerr << "Number of threads must be >= 0\n";
+		    exit(1);
+		}
+		break;
 	    case OPT_HELP:
 		cout << PROG_NAME " - " PROG_DESC "\n\n";
 		show_usage();
@@ -102,6 +114,8 @@ try {
     // Set database
     ranker->set_database_path(db_path);
 
+    ranker->set_threads(threads);
+
     // Perform training and save model as database metadata with key "model_metadata_key"
     ranker->train_model(trainingfile, model_metadata_key);
 
@@ -53,38 +53,20 @@ IdfFeature::get_values() const
 {
     LOGCALL(API, vector<double>, "IdfFeature::get_values", NO_ARGS);
 
-    vector<double> values;
-    double value = 0;
-
-    Xapian::Query feature_query = internal->get_query();
-    for (Xapian::TermIterator qt = feature_query.get_unique_terms_begin();
-	 qt != feature_query.get_terms_end(); ++qt) {
-	if (is_title_term((*qt))) {
-	    double idf = internal->get_inverse_doc_freq(*qt);
-	    value += log10(1 + idf);
-	}
-    }
-    values.push_back(value);
-    value = 0;
-
-    for (Xapian::TermIterator qt = feature_query.get_unique_terms_begin();
-	 qt != feature_query.get_terms_end(); ++qt) {
-	if (!is_title_term((*qt))) {
-	    double idf = internal->get_inverse_doc_freq(*qt);
-	    value += log10(1 + idf);
+    double values[Feature::Internal::N_PARTS] = {};
+    const vector<string>& terms = internal->get_query_terms();
+    for (size_t i = 0; i != terms.size(); ++i) {
+	double idf = internal->get_inverse_doc_freq(i);
+	double value = log10(1 + idf);
+	if (is_title_term(terms[i])) {
+	    values[Feature::Internal::TITLE] += value;
+	} else {
+	    values[Feature::Internal::BODY] += value;
 	}
+	values[Feature::Internal::WHOLE] += value;
     }
-    values.push_back(value);
-    value = 0;
-
-    for (Xapian::TermIterator qt = feature_query.get_unique_terms_begin();
-	 qt != feature_query.get_terms_end(); ++qt) {
-	double idf = internal->get_inverse_doc_freq(*qt);
-	value += log10(1 + idf);
-    }
-    values.push_back(value);
 
-    return values;
+    return vector<double>(values, values + Feature::Internal::N_PARTS);
 }
 
 }
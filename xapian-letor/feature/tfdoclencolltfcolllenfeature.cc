@@ -53,47 +53,28 @@ TfDoclenCollTfCollLenFeature::get_values() const
 {
     LOGCALL(API, vector<double>, "TfDoclenCollTfCollLenFeature::get_values", NO_ARGS);
 
-    vector<double> values;
-    double value = 0;
-    double coll_len = internal->get_collection_length("title");
-    double doc_len = internal->get_doc_length("title");
-
-    Xapian::Query feature_query = internal->get_query();
-    for (TermIterator qt = feature_query.get_unique_terms_begin();
-	 qt != feature_query.get_terms_end(); ++qt) {
-	if (is_title_term((*qt))) {
-	    double tf = internal->get_termfreq(*qt);
-	    double coll_tf = internal->get_collection_termfreq(*qt);
-	    value += log10(1 + ((tf * coll_len) / (1 + (doc_len * coll_tf))));
-	}
+    double coll_len[Feature::Internal::N_PARTS];
+    double doc_len[Feature::Internal::N_PARTS];
+    for (int p = 0; p != Feature::Internal::N_PARTS; ++p) {
+	auto part = Feature::Internal::part(p);
+	coll_len[p] = internal->get_collection_length(part);
+	doc_len[p] = internal->get_doc_length(part);
     }
-    values.push_back(value);
-    value = 0;
-    coll_len = internal->get_collection_length("body");
-    doc_len = internal->get_doc_length("body");
 
-    for (Xapian::TermIterator qt = feature_query.get_unique_terms_begin();
-	 qt != feature_query.get_terms_end(); ++qt) {
-	if (!is_title_term((*qt))) {
-	    double tf = internal->get_termfreq(*qt);
-	    double coll_tf = internal->get_collection_termfreq(*qt);
-	    value += log10(1 + ((tf * coll_len) / (1 + (doc_len * coll_tf))));
+    double values[Feature::Internal::N_PARTS] = {};
+    const vector<string>& terms = internal->get_query_terms();
+    for (size_t i = 0; i != terms.size(); ++i) {
+	double tf = internal->get_termfreq(i);
+	double coll_tf = internal->get_collection_termfreq(i);
+	int part = is_title_term(terms[i]) ?
+		   Feature::Internal::TITLE : Feature::Internal::BODY;
+	for (int p : {part, int(Feature::Internal::WHOLE)}) {
+	    values[p] +=
+		log10(1 + ((tf * coll_len[p]) / (1 + (doc_len[p] * coll_tf))));
 	}
     }
-    values.push_back(value);
-    value = 0;
-    coll_len = internal->get_collection_length("whole");
-    doc_len = internal->get_doc_length("whole");
-
-    for (Xapian::TermIterator qt = feature_query.get_unique_terms_begin();
-	 qt != feature_query.get_terms_end(); ++qt) {
-	double tf = internal->get_termfreq(*qt);
-	double coll_tf = internal->get_collection_termfreq(*qt);
-	value += log10(1 + ((tf * coll_len) / (1 + (doc_len * coll_tf))));
-    }
-    values.push_back(value);
 
-    return values;
+    return vector<double>(values, values + Feature::Internal::N_PARTS);
 }
 
 }
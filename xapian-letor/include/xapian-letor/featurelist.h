@@ -89,9 +89,24 @@ class XAPIAN_VISIBILITY_DEFAULT FeatureList {
 			   const Xapian::Query & letor_query,
 			   const Xapian::Database & letor_db) const;
 
-  private:
-    /// Perform query-level normalisation of FeatureVectors.
-    void normalise(std::vector<FeatureVector> & fvec) const;
+    /** Store the collection statistics used by features in a database.
+     *
+     *  Some features need the total length of the title terms in the
+     *  collection, and finding this means iterating over all the title
+     *  terms.  This method calculates these statistics and stores them in
+     *  the user metadata of @a db along with the database revision they are
+     *  for, then commits @a db.
+     *
+     *  The stored statistics are only used while they match the database, so
+     *  this should be called again after the database is modified.
+     *  Otherwise create_feature_vectors() has to calculate them, though it
+     *  only does so once for each revision of the database.
+     *
+     *  The xapian-letor-update tool provides a way to call this method.
+     *
+     *  @param  db	The database to store statistics for.
+     */
+    static void update_statistics(Xapian::WritableDatabase & db);
 };
 
 }
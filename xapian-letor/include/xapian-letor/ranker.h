@@ -53,6 +53,10 @@ namespace Xapian {
  *  shown in the last column. The second column is query id and in between
  *  there are 19 feature values.
  *
+ *  If @a binary is true, the same information is written in a compact binary
+ *  format instead, which is much quicker to load for training.
+ *  Ranker::train_model() accepts either format.
+ *
  *  @param  db_path	Path to Xapian::Database to be used.
  *  @param  query_file	Here you have to give a path to the file
  *			(in free text form) containing training queries
@@ -74,6 +78,8 @@ namespace Xapian {
  *			Features by default. To use a custom set of
  *			features, pass a customised Xapian::FeatureList
  *			object.
+ *  @param  binary	Write the binary format rather than text (default:
+ *			false).
  *
  *  @exception FileNotFoundError will be thrown if file not found at
  *	       supplied path
@@ -87,7 +93,8 @@ prepare_training_file(const std::string & db_path,
 		      const std::string & qrel_file,
 		      Xapian::doccount msetsize,
 		      const std::string & filename,
-		      const Xapian::FeatureList & flist = FeatureList());
+		      const Xapian::FeatureList & flist = FeatureList(),
+		      bool binary = false);
 
 class XAPIAN_VISIBILITY_DEFAULT Ranker : public Xapian::Internal::intrusive_base {
     /// Path to Xapian::Database instance to be used.
@@ -95,6 +102,9 @@ class XAPIAN_VISIBILITY_DEFAULT Ranker : public Xapian::Internal::intrusive_base
     /// Xapian::Query to be ranked using Ranking model.
     Xapian::Query letor_query;
 
+    /// Maximum number of threads to use for training.
+    unsigned threads = 0;
+
   public:
     /// Default constructor
     Ranker();
@@ -120,11 +130,31 @@ class XAPIAN_VISIBILITY_DEFAULT Ranker : public Xapian::Internal::intrusive_base
      */
     void set_query(const Xapian::Query & query);
 
+    /** Set the maximum number of threads to use for training.
+     *
+     *  With more than one thread, train_model() computes the gradients for
+     *  groups of queries concurrently, all starting from the same model
+     *  parameters, and then applies them in query order.  With one thread
+     *  the parameters are updated after each query, so the trained model
+     *  may differ slightly depending on the number of threads.
+     *
+     *  @param n_threads	Maximum number of threads to use (including the
+     *			calling thread).  0 is treated the same as 1, which
+     *			means not to use any extra threads (this is the
+     *			default).
+     */
+    void set_threads(unsigned n_threads) { threads = n_threads; }
+
+    /// Get the maximum number of threads to use for training.
+    unsigned get_threads() const { return threads; }
+
     /** Learns the model using the training file.
      *
      *  Model file is saved as DB metadata.
      *
-     *  @param  input_filename   Path to training file.
+     *  @param  input_filename   Path to training file, which can be in
+     *				 either the text or the binary format written
+     *				 by prepare_training_file().
      *
      *  @param  model_key	 Metadata key using which the model is to be
      *				 loaded. If no model_key is supplied, ranker
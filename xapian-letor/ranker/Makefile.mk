@@ -1,5 +1,7 @@
 noinst_HEADERS +=\
-	common/serialise-double.h
+	common/pack.h\
+	common/serialise-double.h\
+	ranker/training.h
 
 EXTRA_DIST +=\
 	ranker/Makefile
@@ -8,4 +10,5 @@ lib_src +=\
 	ranker/listmle_ranker.cc\
 	ranker/listnet_ranker.cc\
 	ranker/ranker.cc\
+	ranker/training.cc\
 	common/serialise-double.cc
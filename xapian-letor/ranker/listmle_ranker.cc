@@ -31,12 +31,13 @@
 
 #include "debuglog.h"
 #include "serialise-double.h"
+#include "training.h"
 
 #include <xapian.h>
 
 #include <algorithm>
 #include <cmath>
-#include <stdlib.h>
+#include <vector>
 
 using namespace std;
 using namespace Xapian;
@@ -46,112 +47,75 @@ ListMLERanker::~ListMLERanker()
     LOGCALL_DTOR(API, "ListMLERanker");
 }
 
-static bool
-label_comparer(const FeatureVector& firstfv,
-	       const FeatureVector& secondfv)
-{
-    return firstfv.get_label() > secondfv.get_label();
-}
-
-static double
-calculate_inner_product(const vector<double>& parameters,
-			const vector<double>& feature_sets)
-{
-    double inner_product = 0.0;
-    for (size_t i = 0; i < parameters.size(); ++i) {
-	inner_product += parameters[i] * feature_sets[i];
-    }
-    return inner_product;
-}
-
-static vector<double>
-calculate_gradient(const vector<FeatureVector>& sorted_feature_vectors,
-		   const vector<double>& new_parameters)
+/* Calculate the gradient for query @a q, whose rows must be sorted by
+ * descending label.
+ */
+static void
+calculate_gradient(const TrainingSet& data, size_t q,
+		   const vector<double>& new_parameters,
+		   vector<double>& gradient)
 {
-    vector<double> gradient(sorted_feature_vectors[0].get_fcount(), 0);
-
-    size_t list_length = sorted_feature_vectors.size();
+    size_t fcount = data.get_fcount();
+    size_t first = data.begin(q);
+    size_t list_length = data.end(q) - first;
 
-    vector<double> exponents;
+    vector<double> exponents(list_length);
     double expsum = 0.0;
 
     for (size_t i = 0; i < list_length; ++i) {
-	const auto& fvals = sorted_feature_vectors[i].get_fvals();
-	double exponent = exp(calculate_inner_product(new_parameters, fvals));
-	exponents.push_back(exponent);
+	double exponent = exp(dot_product(new_parameters.data(),
+					  data.row(first + i), fcount));
+	exponents[i] = exponent;
 	expsum += exponent;
     }
 
+    // FIXME: The gradient for the last feature is always zero so its
+    // parameter is never updated.
+    gradient.assign(fcount, 0.0);
     for (size_t i = 0; i < list_length; ++i) {
-	vector<double> feature_sets = sorted_feature_vectors[i].get_fvals();
-	for (size_t j = 0; j < feature_sets.size() - 1; ++j) {
-	    gradient[j] += feature_sets[j] * exponents[i] / expsum;
+	const double* feature_sets = data.row(first + i);
+	double p = exponents[i] / expsum;
+	for (size_t j = 0; j < fcount - 1; ++j) {
+	    gradient[j] += feature_sets[j] * p;
 	}
     }
 
-    vector<double> first_place_in_ground_truth_feature_sets =
-	    sorted_feature_vectors[0].get_fvals();
-
-    for (size_t i = 0; i < first_place_in_ground_truth_feature_sets.size() - 1;
-	 ++i) {
+    const double* first_place_in_ground_truth_feature_sets = data.row(first);
+    for (size_t i = 0; i < fcount - 1; ++i) {
 	gradient[i] -= first_place_in_ground_truth_feature_sets[i];
     }
-
-    return gradient;
-}
-
-static void
-update_parameters(vector<double>& new_parameters,
-		  const vector<double>& gradient,
-		  double learning_rate)
-{
-    size_t num = new_parameters.size();
-    for (size_t i = 0; i < num; ++i) {
-	new_parameters[i] -= gradient[i] * learning_rate;
-    }
-}
-
-/* Updates new_parameters after calculating the gradient.
- * new_parameters(w) is updated as: w = w - gradient * learningRate
- */
-static void
-batch_learning(vector<FeatureVector> feature_vectors,
-	       vector<double> & new_parameters,
-	       double learning_rate)
-{
-    sort(feature_vectors.begin(), feature_vectors.end(), label_comparer);
-    const auto& gradient = calculate_gradient(feature_vectors, new_parameters);
-    update_parameters(new_parameters, gradient, learning_rate);
 }
 
 void
 ListMLERanker::train(const vector<vector<FeatureVector>>& training_data)
 {
     LOGCALL_VOID(API, "ListMLERanker::train", training_data);
-    if (training_data.empty() || training_data[0].empty())
-	throw InvalidArgumentError("Cannot train: no training data");
-    int feature_cnt = training_data[0][0].get_fcount();
+    TrainingSet data(training_data);
+    data.sort_by_label();
+    size_t fcount = data.get_fcount();
+    size_t n_queries = data.get_query_count();
 
     // Initialize the parameters for neural network
-    vector<double> new_parameters;
-    for (int feature_num = 0; feature_num < feature_cnt; ++feature_num) {
-	new_parameters.push_back(0.0);
-    }
-
-    for (auto& item1 : training_data) {
-	for (auto& item2 : item1) {
-	    if (item2.get_fcount() != feature_cnt) {
-		throw InvalidArgumentError("Cannot train: training data has "
-					   "uneven set of features. Make sure "
-					   "that you are using the same set "
-					   "of Features for all the queries");
-	    }
-	}
-    }
-
+    vector<double> new_parameters(fcount, 0.0);
+
+    // With more than one thread, we compute the gradients for a group of
+    // queries in parallel from the same parameters and then apply them in
+    // order.
+    WorkerPool pool(get_threads());
+    size_t group_size = max(get_threads(), 1u);
+    vector<vector<double>> gradients(group_size);
     for (int iter_num = 1; iter_num <= iterations; ++iter_num) {
-	for (auto& item : training_data) {
-	    batch_learning(item, new_parameters, learning_rate);
+	for (size_t q = 0; q < n_queries; q += group_size) {
+	    size_t n = min(group_size, n_queries - q);
+	    pool.run(n, [&](size_t i) {
+		calculate_gradient(data, q + i, new_parameters, gradients[i]);
+	    });
+	    // w = w - gradient * learningRate
+	    for (size_t i = 0; i != n; ++i) {
+		for (size_t k = 0; k != fcount; ++k) {
+		    new_parameters[k] -= gradients[i][k] * learning_rate;
+		}
+	    }
 	}
     }
 
@@ -201,16 +165,14 @@ ListMLERanker::rank_fvv(const std::vector<FeatureVector>& fvv) const
     LOGCALL(API, std::vector<FeatureVector>, "ListMLERanker::rank_fvv", fvv);
     std::vector<FeatureVector> testfvv = fvv;
     for (size_t i = 0; i < testfvv.size(); ++i) {
-	double listmle_score = 0;
 	const auto& fvals = testfvv[i].get_fvals();
 	if (fvals.size() != parameters.size())
 	    throw InvalidArgumentError("Model incompatible. Make sure that "
 				       "you are using the same set of "
 				       "Features using which the model "
 				       "was created.");
-	for (size_t j = 0; j < fvals.size(); ++j)
-	    listmle_score += fvals[j] * parameters[j];
-	testfvv[i].set_score(listmle_score);
+	testfvv[i].set_score(dot_product(fvals.data(), parameters.data(),
+					 fvals.size()));
     }
     return testfvv;
 }
@@ -31,6 +31,7 @@
 
 #include "debuglog.h"
 #include "serialise-double.h"
+#include "training.h"
 
 #include <algorithm>
 #include <cmath>
@@ -44,84 +45,45 @@
 using namespace std;
 using namespace Xapian;
 
-/// A vector holding ground truth and prediction score probability distribution vectors.
-typedef vector<vector<double>> prob_distrib_vector;
-
 ListNETRanker::~ListNETRanker() {
     LOGCALL_DTOR(API, "ListNETRanker");
 }
 
-static double
-calculate_inner_product(const vector<double> &parameters, const vector<double> &fvals) {
-    LOGCALL_STATIC_VOID(API, "calculate_inner_product", parameters | fvals);
-    double inner_product = 0.0;
-    for (size_t i = 0; i < fvals.size(); ++i)
-	inner_product += parameters[i] * fvals[i];
-    return inner_product;
-}
-
-// From Theorem (8) in Cao et al. "Learning to rank: from pairwise approach to listwise approach."
-static prob_distrib_vector
-init_probability(const vector<FeatureVector> &feature_vectors, const vector<double> &new_parameters) {
-    LOGCALL_STATIC_VOID(API, "init_probability", feature_vectors | new_parameters);
+// Equation (6) in paper Cao et al. "Learning to rank: from pairwise approach
+// to listwise approach", using the probability distributions from Theorem (8).
+//
+// The gradient is normalised by the number of documents for the query.
+static void
+calculate_gradient(const TrainingSet& data, size_t q,
+		   const vector<double>& params,
+		   vector<double>& gradient)
+{
+    size_t fcount = data.get_fcount();
+    size_t first = data.begin(q);
+    size_t n = data.end(q) - first;
 
-    // probability distribution, y is ground truth, while z is predict score
-    vector<double> prob_y;
-    vector<double> prob_z;
+    // Exponentiated ground truth (y) and predicted scores (z).
+    vector<double> exp_y(n), exp_z(n);
     double expsum_y = 0.0;
     double expsum_z = 0.0;
-
-    for (auto&& v : feature_vectors) {
-	expsum_y += exp(v.get_label());
-	expsum_z += exp(calculate_inner_product(new_parameters, v.get_fvals()));
+    for (size_t i = 0; i != n; ++i) {
+	exp_y[i] = exp(data.label(first + i));
+	expsum_y += exp_y[i];
+	exp_z[i] = exp(dot_product(params.data(), data.row(first + i), fcount));
+	expsum_z += exp_z[i];
     }
-    for (auto&& v : feature_vectors) {
-	prob_y.push_back(exp(v.get_label()) / expsum_y);
-	prob_z.push_back(exp(calculate_inner_product(new_parameters, v.get_fvals())) / expsum_z);
-    }
-    vector<vector<double>> prob;
-    prob.push_back(prob_y);
-    prob.push_back(prob_z);
-    return prob;
-}
-
-// Equation (6) in paper Cao et al. "Learning to rank: from pairwise approach to listwise approach."
-static vector<double>
-calculate_gradient(const vector<FeatureVector> &feature_vectors, const prob_distrib_vector &prob) {
-    LOGCALL_STATIC_VOID(API, "calculate_gradient", feature_vectors | prob);
-
-    vector<double> gradient(feature_vectors[0].get_fcount(), 0);
-
-    // Hold ground truth probability distribution
-    const vector<double> prob_y(prob[0]);
-    // Hold prediction score probability distribution
-    const vector<double> prob_z(prob[1]);
-
-    for (size_t i = 0; i < feature_vectors.size(); ++i) {
-	vector<double> fvals = feature_vectors[i].get_fvals();
-	for (size_t k = 0; k < fvals.size(); ++k) {
-	    double first_term = - prob_y[i] * fvals[k];
-	    gradient[k] += first_term;
 
-	    double second_term = prob_z[i] * fvals[k];
-	    gradient[k] += second_term;
+    gradient.assign(fcount, 0.0);
+    for (size_t i = 0; i != n; ++i) {
+	double prob_y = exp_y[i] / expsum_y;
+	double prob_z = exp_z[i] / expsum_z;
+	const double* fvals = data.row(first + i);
+	for (size_t k = 0; k != fcount; ++k) {
+	    gradient[k] += (prob_z - prob_y) * fvals[k];
 	}
     }
-    return gradient;
-}
-
-static void
-update_parameters(vector<double> &new_parameters, const vector<double> &gradient, double learning_rate) {
-    LOGCALL_STATIC_VOID(API, "update_parameters", new_parameters | gradient | learning_rate);
-    for (size_t i = 0; i < new_parameters.size(); ++i) {
-	new_parameters[i] -= gradient[i] * learning_rate;
-    }
-}
-
-static void
-normalize(vector<double>& gradient, size_t size) {
     for (auto& item : gradient) {
-	item /= size;
+	item /= n;
     }
 }
 
@@ -129,34 +91,31 @@ void
 ListNETRanker::train(const vector<vector<Xapian::FeatureVector>>& training_data)
 {
     LOGCALL_VOID(API, "ListNETRanker::train", training_data);
-    if (training_data.empty() || training_data[0].empty())
-	throw InvalidArgumentError("Cannot train: no training data");
-    int feature_cnt = training_data[0][0].get_fcount();
+    TrainingSet data(training_data);
+    size_t fcount = data.get_fcount();
+    size_t n_queries = data.get_query_count();
 
     // initialize the parameters for neural network
-    vector<double> new_parameters(feature_cnt, 0.0);
-
-    for (auto& item1 : training_data) {
-	for (auto& item2 : item1) {
-	    if (item2.get_fcount() != feature_cnt) {
-		throw InvalidArgumentError("Cannot train: training data has "
-					   "uneven set of features. Make sure "
-					   "that you are using the same set "
-					   "of Features for all the queries");
-	    }
-	}
-    }
-    // iterations
+    vector<double> new_parameters(fcount, 0.0);
+
+    // With more than one thread, we compute the gradients for a group of
+    // queries in parallel from the same parameters and then apply them in
+    // order.  With one thread, this is stochastic gradient descent.
+    WorkerPool pool(get_threads());
+    size_t group_size = max(get_threads(), 1u);
+    vector<vector<double>> gradients(group_size);
     for (int iter_num = 1; iter_num <= iterations; ++iter_num) {
-	for (auto& item : training_data) {
-	    // Initialize probability distributions of y and z.
-	    prob_distrib_vector prob = init_probability(item, new_parameters);
-	    // Compute gradient
-	    vector<double> gradient = calculate_gradient(item, prob);
-	    // Normalize gradient
-	    normalize(gradient, item.size());
+	for (size_t q = 0; q < n_queries; q += group_size) {
+	    size_t n = min(group_size, n_queries - q);
+	    pool.run(n, [&](size_t i) {
+		calculate_gradient(data, q + i, new_parameters, gradients[i]);
+	    });
 	    // Update parameters: w = w - gradient * learningRate
-	    update_parameters(new_parameters, gradient, learning_rate);
+	    for (size_t i = 0; i != n; ++i) {
+		for (size_t k = 0; k != fcount; ++k) {
+		    new_parameters[k] -= gradients[i][k] * learning_rate;
+		}
+	    }
 	}
     }
     swap(parameters, new_parameters);
@@ -203,14 +162,12 @@ ListNETRanker::rank_fvv(const std::vector<FeatureVector> & fvv) const {
     LOGCALL(API, std::vector<FeatureVector>, "ListNETRanker::rank_fvv", fvv);
     std::vector<FeatureVector> testfvv = fvv;
     for (size_t i = 0; i < testfvv.size(); ++i) {
-	double listnet_score = 0;
-	std::vector<double> fvals = testfvv[i].get_fvals();
+	const std::vector<double>& fvals = testfvv[i].get_fvals();
 	if (fvals.size() != parameters.size())
 	    throw LetorInternalError("Model incompatible. Make sure that you are using "
 				     "the same set of Features using which the model was created.");
-	for (size_t j = 0; j < fvals.size(); ++j)
-	    listnet_score += fvals[j] * parameters[j];
-	testfvv[i].set_score(listnet_score);
+	testfvv[i].set_score(dot_product(fvals.data(), parameters.data(),
+					 fvals.size()));
     }
     return testfvv;
 }
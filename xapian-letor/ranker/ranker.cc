@@ -30,6 +30,8 @@
 
 #include "debuglog.h"
 #include "omassert.h"
+#include "pack.h"
+#include "serialise-double.h"
 #include "str.h"
 
 #include <cstdio>
@@ -63,14 +65,78 @@ static const char * sw[] = {
     "was", "what", "when", "where", "which", "who", "why", "will", "with"
 };
 
+/* The binary training file format starts with this magic string.  The
+ * leading zero byte can't start a text training file.
+ *
+ * Then for each query there's:
+ *
+ *  - the qid (pack_string())
+ *  - the number of documents (pack_uint())
+ *  - the number of features (pack_uint())
+ *  - for each document: the label (serialise_double()), the docid
+ *    (pack_uint()) and then the feature values (serialise_double()).
+ */
+static const char BINARY_TRAINING_MAGIC[] = "\0xapian-letor-training\x01";
+
+/// Length of BINARY_TRAINING_MAGIC (which contains a zero byte).
+static constexpr size_t BINARY_TRAINING_MAGIC_LEN =
+    sizeof(BINARY_TRAINING_MAGIC) - 1;
+
+static void
+load_binary_fvecs(istream& train_file,
+		  std::map<string, vector<FeatureVector>>& fvv)
+{
+    string data(istreambuf_iterator<char>(train_file), {});
+    const char* p = data.data();
+    const char* end = p + data.size();
+    string qid;
+    vector<double> fvals;
+    while (p != end) {
+	size_t n_docs, fcount;
+	if (!unpack_string(&p, end, qid) ||
+	    !unpack_uint(&p, end, &n_docs) ||
+	    !unpack_uint(&p, end, &fcount)) {
+	    throw LetorParseError("Bad binary training file");
+	}
+	vector<FeatureVector>& v = fvv[qid];
+	for (size_t i = 0; i != n_docs; ++i) {
+	    FeatureVector fv;
+	    fv.set_label(unserialise_double(&p, end));
+	    Xapian::docid did;
+	    if (!unpack_uint(&p, end, &did))
+		throw LetorParseError("Bad binary training file");
+	    fv.set_did(did);
+	    fvals.resize(fcount);
+	    for (auto& fval : fvals) {
+		fval = unserialise_double(&p, end);
+	    }
+	    fv.set_fvals(fvals);
+	    fv.set_score(0);
+	    v.push_back(fv);
+	}
+    }
+}
+
 static vector<vector<FeatureVector>>
 load_list_fvecs(const string & filename)
 {
-    fstream train_file(filename, ios::in);
+    fstream train_file(filename, ios::in | ios::binary);
     if (!train_file.good())
 	throw Xapian::FileNotFoundError("No training file found. Check path.");
 
     std::map<string, vector<FeatureVector>> fvv;
+    char magic[BINARY_TRAINING_MAGIC_LEN];
+    if (train_file.read(magic, sizeof(magic)) &&
+	memcmp(magic, BINARY_TRAINING_MAGIC, sizeof(magic)) == 0) {
+	try {
+	    load_binary_fvecs(train_file, fvv);
+	} catch (const Xapian::SerialisationError&) {
+	    throw LetorParseError("Bad binary training file");
+	}
+    } else {
+	train_file.clear();
+	train_file.seekg(0);
+    }
     while (train_file.peek() != EOF) {
 	// A training file looks like this:
 	// <label> qid:<xxx> n:<fval> #docid:<xxx>
@@ -196,6 +262,31 @@ write_to_file(const std::vector<Xapian::FeatureVector> & list_fvecs, const strin
     }
 }
 
+static void
+write_to_binary_file(const std::vector<Xapian::FeatureVector>& list_fvecs,
+		     const string& qid, ofstream& train_file)
+{
+    if (list_fvecs.empty()) return;
+    string data;
+    pack_string(data, qid);
+    pack_uint(data, list_fvecs.size());
+    pack_uint(data, size_t(list_fvecs[0].get_fcount()));
+    for (auto&& fv : list_fvecs) {
+	const std::vector<double>& fvals = fv.get_fvals();
+	if (fvals.size() != size_t(list_fvecs[0].get_fcount())) {
+	    throw Xapian::InvalidArgumentError("Feature vectors for a query "
+					       "have different numbers of "
+					       "features");
+	}
+	data += serialise_double(fv.get_label());
+	pack_uint(data, fv.get_did());
+	for (double fval : fvals) {
+	    data += serialise_double(fval);
+	}
+    }
+    train_file.write(data.data(), data.size());
+}
+
 // Query file is in the format: <qid> '<query_string>'
 // Although it will accept any number of arbitrary characters between
 // the first space and the first single quote.
@@ -249,7 +340,8 @@ initialise_queryparser(const Xapian::Database & db)
 void
 Xapian::prepare_training_file(const string & db_path, const string & queryfile,
 		      const string & qrel_file, Xapian::doccount msetsize,
-		      const string & filename, const FeatureList & flist)
+		      const string & filename, const FeatureList & flist,
+		      bool binary)
 {
     // Set db
     Xapian::Database letor_db(db_path);
@@ -259,7 +351,12 @@ Xapian::prepare_training_file(const string & db_path, const string & queryfile,
     qrel = load_relevance(qrel_file);
 
     ofstream train_file;
-    train_file.open(filename);
+    if (binary) {
+	train_file.open(filename, ios::binary);
+	train_file.write(BINARY_TRAINING_MAGIC, BINARY_TRAINING_MAGIC_LEN);
+    } else {
+	train_file.open(filename);
+    }
 
     string str1;
     ifstream myfile1;
@@ -313,7 +410,11 @@ Xapian::prepare_training_file(const string & db_path, const string & queryfile,
 	    }
 	    ++k;
 	}
-	write_to_file(fvv_qrel, qid, train_file);
+	if (binary) {
+	    write_to_binary_file(fvv_qrel, qid, train_file);
+	} else {
+	    write_to_file(fvv_qrel, qid, train_file);
+	}
     }
     myfile1.close();
     train_file.close();
@@ -0,0 +1,188 @@
+/** @file
+ * @brief Helpers for training rankers
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "training.h"
+
+#include "xapian/error.h"
+
+#include <algorithm>
+#include <numeric>
+#include <system_error>
+
+using namespace std;
+
+TrainingSet::TrainingSet(const vector<vector<Xapian::FeatureVector>>&
+			 training_data)
+{
+    if (training_data.empty() || training_data[0].empty())
+	throw Xapian::InvalidArgumentError("Cannot train: no training data");
+    n_features = training_data[0][0].get_fcount();
+
+    size_t n_rows = 0;
+    for (auto& item1 : training_data) {
+	for (auto& item2 : item1) {
+	    if (size_t(item2.get_fcount()) != n_features) {
+		throw Xapian::InvalidArgumentError("Cannot train: training "
+						   "data has uneven set of "
+						   "features. Make sure that "
+						   "you are using the same set "
+						   "of Features for all the "
+						   "queries");
+	    }
+	}
+	n_rows += item1.size();
+    }
+
+    fvals.reserve(n_rows * n_features);
+    labels.reserve(n_rows);
+    query_start.reserve(training_data.size() + 1);
+    for (auto& item1 : training_data) {
+	query_start.push_back(labels.size());
+	for (auto& item2 : item1) {
+	    const vector<double>& v = item2.get_fvals();
+	    fvals.insert(fvals.end(), v.begin(), v.end());
+	    labels.push_back(item2.get_label());
+	}
+    }
+    query_start.push_back(labels.size());
+}
+
+void
+TrainingSet::sort_by_label()
+{
+    vector<size_t> order;
+    vector<double> new_fvals;
+    new_fvals.reserve(fvals.size());
+    vector<double> new_labels;
+    new_labels.reserve(labels.size());
+    for (size_t q = 0; q != get_query_count(); ++q) {
+	order.resize(end(q) - begin(q));
+	iota(order.begin(), order.end(), begin(q));
+	stable_sort(order.begin(), order.end(),
+		    [this](size_t a, size_t b) {
+			return labels[a] > labels[b];
+		    });
+	for (size_t i : order) {
+	    new_fvals.insert(new_fvals.end(), row(i), row(i) + n_features);
+	    new_labels.push_back(labels[i]);
+	}
+    }
+    swap(fvals, new_fvals);
+    swap(labels, new_labels);
+}
+
+WorkerPool::WorkerPool(unsigned n_threads)
+{
+    if (n_threads > 1) {
+	threads.reserve(n_threads - 1);
+	try {
+	    while (threads.size() != n_threads - 1) {
+		threads.emplace_back(&WorkerPool::worker, this);
+	    }
+	} catch (const system_error&) {
+	    // Failing to create a thread isn't fatal.
+	}
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+	lock_guard<std::mutex> lock(pool_mutex);
+	stopping = true;
+    }
+    start_cond.notify_all();
+    for (auto&& t : threads) {
+	t.join();
+    }
+}
+
+void
+WorkerPool::run_tasks(unique_lock<std::mutex>& lock)
+{
+    const function<void(size_t)>& f = *task;
+    while (next_task < n_tasks) {
+	size_t i = next_task++;
+	lock.unlock();
+	exception_ptr e;
+	try {
+	    f(i);
+	} catch (...) {
+	    e = current_exception();
+	}
+	lock.lock();
+	if (e && (!error || i < error_task)) {
+	    error = e;
+	    error_task = i;
+	}
+    }
+}
+
+void
+WorkerPool::worker()
+{
+    unique_lock<std::mutex> lock(pool_mutex);
+    unsigned long last_batch = 0;
+    while (true) {
+	start_cond.wait(lock, [&]() {
+	    return stopping || batch != last_batch;
+	});
+	if (stopping) return;
+	last_batch = batch;
+	run_tasks(lock);
+	if (--busy == 0) done_cond.notify_one();
+    }
+}
+
+void
+WorkerPool::run(size_t n, const function<void(size_t)>& f)
+{
+    if (threads.empty() || n <= 1) {
+	exception_ptr e;
+	for (size_t i = 0; i != n; ++i) {
+	    try {
+		f(i);
+	    } catch (...) {
+		if (!e) e = current_exception();
+	    }
+	}
+	if (e) rethrow_exception(e);
+	return;
+    }
+
+    unique_lock<std::mutex> lock(pool_mutex);
+    task = &f;
+    n_tasks = n;
+    next_task = 0;
+    busy = threads.size();
+    error = nullptr;
+    ++batch;
+    start_cond.notify_all();
+    run_tasks(lock);
+    done_cond.wait(lock, [&]() { return busy == 0; });
+    task = nullptr;
+    if (error) {
+	exception_ptr e = error;
+	error = nullptr;
+	rethrow_exception(e);
+    }
+}
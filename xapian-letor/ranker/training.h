@@ -0,0 +1,179 @@
+/** @file
+ * @brief Helpers for training rankers
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef XAPIAN_INCLUDED_TRAINING_H
+#define XAPIAN_INCLUDED_TRAINING_H
+
+#include "xapian-letor/featurevector.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/** Calculate the dot product of two vectors of length @a n.
+ *
+ *  We sum into several independent accumulators, which allows the compiler
+ *  to use SIMD instructions (it can't reorder a single floating point sum
+ *  itself).
+ */
+inline double
+dot_product(const double* a, const double* b, size_t n)
+{
+    double sum[4] = { 0.0, 0.0, 0.0, 0.0 };
+    size_t i = 0;
+    for ( ; i + 4 <= n; i += 4) {
+	sum[0] += a[i] * b[i];
+	sum[1] += a[i + 1] * b[i + 1];
+	sum[2] += a[i + 2] * b[i + 2];
+	sum[3] += a[i + 3] * b[i + 3];
+    }
+    for ( ; i != n; ++i) {
+	sum[0] += a[i] * b[i];
+    }
+    return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+}
+
+/** Training data stored contiguously.
+ *
+ *  The feature values for every document are stored in one row-major matrix,
+ *  with the documents for each query in consecutive rows.
+ */
+class TrainingSet {
+    /// The number of features for each document.
+    size_t n_features;
+
+    /// The feature values, one row per document.
+    std::vector<double> fvals;
+
+    /// The relevance label of each document.
+    std::vector<double> labels;
+
+    /// The first row for each query, followed by the number of rows.
+    std::vector<size_t> query_start;
+
+  public:
+    /** Construct from the training data passed to Ranker::train().
+     *
+     *  @exception InvalidArgumentError if @a training_data is empty, or
+     *		   the feature vectors don't all have the same number of
+     *		   features.
+     */
+    explicit
+    TrainingSet(const std::vector<std::vector<Xapian::FeatureVector>>&
+		training_data);
+
+    /// Return the number of features for each document.
+    size_t get_fcount() const { return n_features; }
+
+    /// Return the number of queries.
+    size_t get_query_count() const { return query_start.size() - 1; }
+
+    /// Return the first row for query @a q.
+    size_t begin(size_t q) const { return query_start[q]; }
+
+    /// Return the row after the last for query @a q.
+    size_t end(size_t q) const { return query_start[q + 1]; }
+
+    /// Return the feature values for row @a i.
+    const double* row(size_t i) const { return &fvals[i * n_features]; }
+
+    /// Return the label for row @a i.
+    double label(size_t i) const { return labels[i]; }
+
+    /** Sort the rows for each query by descending label.
+     *
+     *  The sort is stable.
+     */
+    void sort_by_label();
+};
+
+/** A pool of threads for running tasks in parallel.
+ *
+ *  The threads are reused by each call to run(), which avoids the overhead
+ *  of creating threads when each batch of tasks is small.
+ */
+class WorkerPool {
+    /// The worker threads (the calling thread also runs tasks).
+    std::vector<std::thread> threads;
+
+    /// Protects the members below.
+    std::mutex pool_mutex;
+
+    /// Signalled when there's a new batch of tasks, or we're stopping.
+    std::condition_variable start_cond;
+
+    /// Signalled when a worker has finished its part of a batch.
+    std::condition_variable done_cond;
+
+    /// The task function for the current batch.
+    const std::function<void(size_t)>* task = nullptr;
+
+    /// The number of tasks in the current batch.
+    size_t n_tasks = 0;
+
+    /// The next task to run.
+    size_t next_task = 0;
+
+    /// Incremented for each new batch.
+    unsigned long batch = 0;
+
+    /// The number of workers still working on the current batch.
+    size_t busy = 0;
+
+    /// True when the workers should exit.
+    bool stopping = false;
+
+    /// The exception from the lowest numbered task which threw, if any.
+    std::exception_ptr error;
+
+    /// The task number which error came from.
+    size_t error_task = 0;
+
+    /// Run tasks from the current batch until there are none left.
+    void run_tasks(std::unique_lock<std::mutex>& lock);
+
+    /// The function each worker thread runs.
+    void worker();
+
+  public:
+    /** Construct a pool.
+     *
+     *  @param n_threads	The total number of threads to use, including
+     *			the one which calls run().  0 is treated as 1.
+     *			Failing to create a thread isn't fatal - we just
+     *			end up using fewer threads.
+     */
+    explicit WorkerPool(unsigned n_threads);
+
+    ~WorkerPool();
+
+    /** Call @a f(i) for each i in [0, @a n) and wait for them all to finish.
+     *
+     *  If any calls throw an exception, the other tasks are still run, and
+     *  then the exception from the call with the lowest i is rethrown.
+     */
+    void run(size_t n, const std::function<void(size_t)>& f);
+};
+
+#endif // XAPIAN_INCLUDED_TRAINING_H
@@ -25,6 +25,7 @@
 
 #include <cstdlib>
 #include <fstream>
+#include <iterator>
 #include <sstream>
 
 #include <xapian.h>
@@ -33,6 +34,7 @@
 #include "apitest.h"
 #include "filetests.h"
 #include "safeunistd.h"
+#include "str.h"
 #include "testutils.h"
 
 using namespace std;
@@ -835,6 +837,120 @@ DEFINE_TESTCASE(listmle_ranker_three_correct, path && writable)
     unlink("err_output_listmle_3.txt");
 }
 
+// Write a training file with several copies of the query in training_data.txt.
+static void
+write_multi_query_training_file(const string& filename, int n_queries)
+{
+    string data_directory = test_driver::get_srcdir() + "/testdata/";
+    ifstream in(data_directory + "training_data.txt");
+    string lines((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    ofstream out(filename);
+    for (int q = 1; q <= n_queries; ++q) {
+	string qid_lines = lines;
+	string::size_type i;
+	while ((i = qid_lines.find("qid:20001")) != string::npos) {
+	    qid_lines.replace(i, 9, "qid:" + str(q));
+	}
+	out << qid_lines;
+    }
+}
+
+// Test training with multiple threads.
+DEFINE_TESTCASE(ranker_threads, path && writable)
+{
+    string db_path = get_database_path("db_index_two_documents",
+				       db_index_two_documents);
+    Xapian::Enquire enquire((Xapian::Database(db_path)));
+    enquire.set_query(Xapian::Query("lions"));
+    Xapian::MSet orig_mset = enquire.get_mset(0, 10);
+    Xapian::docid doc1 = *orig_mset[0];
+    Xapian::docid doc2 = *orig_mset[1];
+
+    const string training_data = "training_data_multi.txt";
+    write_multi_query_training_file(training_data, 7);
+
+    Xapian::ListNETRanker listnet;
+    Xapian::ListMLERanker listmle;
+    for (Xapian::Ranker* ranker : { (Xapian::Ranker*)&listnet,
+				    (Xapian::Ranker*)&listmle }) {
+	TEST_EQUAL(ranker->get_threads(), 0);
+	ranker->set_database_path(db_path);
+	ranker->set_query(Xapian::Query("lions"));
+	ranker->train_model(training_data, "ranker_threads_1");
+	ranker->set_threads(3);
+	TEST_EQUAL(ranker->get_threads(), 3);
+	ranker->train_model(training_data, "ranker_threads_3a");
+	ranker->train_model(training_data, "ranker_threads_3b");
+
+	// The result shouldn't depend on how the threads get scheduled.
+	Xapian::Database db(db_path);
+	TEST_EQUAL(db.get_metadata("ranker_threads_3a"),
+		   db.get_metadata("ranker_threads_3b"));
+
+	for (auto key : { "ranker_threads_1", "ranker_threads_3a" }) {
+	    Xapian::MSet mymset = enquire.get_mset(0, 10);
+	    ranker->rank(mymset, key);
+	    TEST_EQUAL(doc1, *mymset[1]);
+	    TEST_EQUAL(doc2, *mymset[0]);
+	}
+    }
+    unlink(training_data.c_str());
+}
+
+// Test the binary training file format.
+DEFINE_TESTCASE(binarytrainingfile, path && writable)
+{
+    string db_path = get_database_path("db_index_two_documents",
+				       db_index_two_documents);
+    string data_directory = test_driver::get_srcdir() + "/testdata/";
+    string query = data_directory + "query.txt";
+    string qrel = data_directory + "qrel.txt";
+    const string text_file = "training_output_text.txt";
+    const string binary_file = "training_output_binary.dat";
+    Xapian::FeatureList flist;
+    Xapian::prepare_training_file(db_path, query, qrel, 10, text_file, flist);
+    Xapian::prepare_training_file(db_path, query, qrel, 10, binary_file,
+				  flist, true);
+    TEST(file_exists(binary_file));
+    TEST_REL(file_size(binary_file), <, file_size(text_file));
+
+    Xapian::ListNETRanker ranker;
+    ranker.set_database_path(db_path);
+    ranker.set_query(Xapian::Query("lions"));
+    ranker.train_model(text_file, "ListNet_text");
+    ranker.train_model(binary_file, "ListNet_binary");
+
+    // The text format rounds the feature values, so the models won't be
+    // identical, but the weights they give should be very close.
+    Xapian::Enquire enquire((Xapian::Database(db_path)));
+    enquire.set_query(Xapian::Query("lions"));
+    Xapian::MSet mset_text = enquire.get_mset(0, 10);
+    ranker.rank(mset_text, "ListNet_text");
+    Xapian::MSet mset_binary = enquire.get_mset(0, 10);
+    ranker.rank(mset_binary, "ListNet_binary");
+    TEST_EQUAL(mset_text.size(), 2);
+    TEST_EQUAL(mset_binary.size(), 2);
+    for (Xapian::doccount i = 0; i != mset_text.size(); ++i) {
+	TEST_EQUAL(*mset_text[i], *mset_binary[i]);
+	TEST_REL(abs(mset_text[i].get_weight() - mset_binary[i].get_weight()),
+		 <, 1e-6);
+    }
+
+    // Check a truncated binary file is reported.
+    {
+	ifstream in(binary_file, ios::binary);
+	string data((istreambuf_iterator<char>(in)),
+		    istreambuf_iterator<char>());
+	ofstream out(binary_file, ios::binary | ios::trunc);
+	out.write(data.data(), data.size() - 3);
+    }
+    TEST_EXCEPTION(Xapian::LetorParseError,
+		   ranker.train_model(binary_file, "ListNet_binary"));
+
+    unlink(text_file.c_str());
+    unlink(binary_file.c_str());
+}
+
 // Featurename check
 DEFINE_TESTCASE(featurename, !backend)
 {
@@ -1372,6 +1488,98 @@ DEFINE_TESTCASE(createfeaturevector_tfdoclencolllfcolllen, backend)
     TEST_EQUAL_DOUBLE(fvals_doc2[3], test_vals_doc2[3] / max_val[3]);
 }
 
+static vector<Xapian::FeatureVector>
+collection_length_features(const Xapian::Database& db,
+			   const Xapian::FeatureList& fl)
+{
+    Xapian::QueryParser queryparser;
+    queryparser.set_stemmer(Xapian::Stem("en"));
+    queryparser.set_stemming_strategy(queryparser.STEM_ALL_Z);
+    queryparser.add_prefix("title", "S");
+    queryparser.add_prefix("description", "XD");
+    string querystring = "title:score description:score score";
+    Xapian::Query query = queryparser.parse_query(querystring);
+
+    Xapian::Enquire enquire(db);
+    enquire.set_query(Xapian::Query("score"));
+    Xapian::MSet mset = enquire.get_mset(0, 10);
+    return fl.create_feature_vectors(mset, query, db);
+}
+
+static void
+check_same_features(const vector<Xapian::FeatureVector>& a,
+		    const vector<Xapian::FeatureVector>& b)
+{
+    TEST_EQUAL(a.size(), b.size());
+    for (size_t i = 0; i != a.size(); ++i) {
+	TEST_EQUAL(a[i].get_did(), b[i].get_did());
+	vector<double> a_fvals = a[i].get_fvals();
+	vector<double> b_fvals = b[i].get_fvals();
+	TEST_EQUAL(a_fvals.size(), b_fvals.size());
+	for (size_t j = 0; j != a_fvals.size(); ++j) {
+	    TEST_EQUAL_DOUBLE(a_fvals[j], b_fvals[j]);
+	}
+    }
+}
+
+// Test FeatureList::update_statistics() and that stale statistics are ignored.
+DEFINE_TESTCASE(updatestatistics, writable)
+{
+    Xapian::WritableDatabase db = get_writable_database();
+    db_index_three_documents(db, string());
+    db.commit();
+
+    Xapian::FeatureList fl({new Xapian::TfDoclenCollTfCollLenFeature()});
+    auto fv_calculated = collection_length_features(db, fl);
+
+    Xapian::FeatureList::update_statistics(db);
+    Xapian::termcount title_len = 0;
+    for (auto t = db.allterms_begin("S"); t != db.allterms_end("S"); ++t) {
+	title_len += db.get_collection_freq(*t);
+    }
+    Xapian::totallength total_len = db.get_total_length();
+    TEST_EQUAL(db.get_metadata("collection_len_title"), str(title_len));
+    TEST_EQUAL(db.get_metadata("collection_len_body"),
+	       str(total_len - title_len));
+    TEST_EQUAL(db.get_metadata("collection_len_whole"), str(total_len));
+    string rev;
+    try {
+	rev = str(db.get_revision());
+    } catch (const Xapian::InvalidOperationError&) {
+    } catch (const Xapian::UnimplementedError&) {
+    }
+    TEST_EQUAL(db.get_metadata("collection_len_revision"), rev);
+
+    // The stored statistics should give the same results as calculating them.
+    Xapian::FeatureList fl2({new Xapian::TfDoclenCollTfCollLenFeature()});
+    check_same_features(collection_length_features(db, fl2), fv_calculated);
+
+    // Modify the database so the stored statistics and those cached by fl are
+    // out of date.
+    Xapian::Document doc;
+    Xapian::TermGenerator termgenerator;
+    termgenerator.set_document(doc);
+    termgenerator.set_stemmer(Xapian::Stem("en"));
+    termgenerator.index_text("Score, scoring and scorers: a long title about "
+			     "keeping score", 1, "S");
+    termgenerator.index_text("Score.", 1, "XD");
+    termgenerator.index_text("Score.");
+    db.add_document(doc);
+    db.commit();
+    auto fv_stale = collection_length_features(db, fl);
+
+    // Compare with calculating the statistics from scratch.
+    db.set_metadata("collection_len_title", string());
+    db.set_metadata("collection_len_body", string());
+    db.set_metadata("collection_len_whole", string());
+    db.set_metadata("collection_len_revision", string());
+    db.commit();
+    Xapian::FeatureList fl3({new Xapian::TfDoclenCollTfCollLenFeature()});
+    auto fv_new = collection_length_features(db, fl3);
+    TEST_EQUAL(fv_new.size(), 3);
+    check_same_features(fv_stale, fv_new);
+}
+
 class CustomFeature : public Xapian::Feature {
   public:
     CustomFeature() {
@@ -1445,3 +1653,63 @@ DEFINE_TESTCASE(populatefeature, backend) {
 
     custom_feature->test_stats();
 }
+
+class DocStatsFeature : public Xapian::Feature {
+  public:
+    DocStatsFeature() {
+	need_stat(Xapian::Feature::TERM_FREQUENCY);
+	need_stat(Xapian::Feature::DOCUMENT_LENGTH);
+    }
+    std::vector<double> get_values() const override {
+	return vector<double>();
+    }
+    std::string name() const override {
+	return "DocStatsFeature";
+    }
+    void test_stats() {
+	TEST_EQUAL(get_termfreq("Ka"), 2);
+	TEST_EQUAL(get_termfreq("Kb"), 0);
+	TEST_EQUAL(get_termfreq("S"), 0);
+	TEST_EQUAL(get_termfreq("Sbar"), 1);
+	TEST_EQUAL(get_termfreq("Sbaz"), 0);
+	TEST_EQUAL(get_termfreq("Szz"), 4);
+	TEST_EQUAL(get_termfreq("Szzz"), 0);
+	TEST_EQUAL(get_termfreq("foo"), 5);
+	// Not a query term.
+	TEST_EQUAL(get_termfreq("Sfoo"), 0);
+
+	TEST_EQUAL(get_doc_length("title"), 8);
+	TEST_EQUAL(get_doc_length("body"), 7);
+	TEST_EQUAL(get_doc_length("whole"), 15);
+    }
+};
+
+// Check finding the wdf of query terms before, among and after the title terms.
+DEFINE_TESTCASE(featurelist_docstats, writable) {
+    Xapian::WritableDatabase db = get_writable_database();
+    Xapian::Document doc;
+    doc.add_term("Ka", 2);
+    doc.add_term("Sbar", 1);
+    doc.add_term("Sfoo", 3);
+    doc.add_term("Szz", 4);
+    doc.add_term("foo", 5);
+    db.add_document(doc);
+    db.commit();
+
+    DocStatsFeature* stats_feature = new DocStatsFeature();
+    Xapian::FeatureList fl({stats_feature});
+
+    Xapian::Enquire enquire(db);
+    enquire.set_query(Xapian::Query("foo"));
+    Xapian::MSet mset = enquire.get_mset(0, 10);
+    TEST_EQUAL(mset.size(), 1);
+
+    static const char* const terms[] = {
+	"Ka", "Kb", "S", "Sbar", "Sbaz", "Szz", "Szzz", "foo"
+    };
+    Xapian::Query query(Xapian::Query::OP_OR, terms, std::end(terms));
+    auto fv = fl.create_feature_vectors(mset, query, db);
+    TEST_EQUAL(fv.size(), 1);
+
+    stats_feature->test_stats();
+}